@@ -39,20 +39,85 @@ add_subdirectory(${CMAKE_BINARY_DIR}/googletest-src
 # --------------------------------------------------------------------------------------------------
 # libipmctl tests
 # --------------------------------------------------------------------------------------------------
+# The suites call into library internals that libipmctl.so does not export, so they link a static
+# build of the same sources
+add_library(ipmctl_unit STATIC ${LIBIPMCTL_SOURCE_FILES})
+
+target_include_directories(ipmctl_unit PUBLIC
+	$<TARGET_PROPERTY:ipmctl,INCLUDE_DIRECTORIES>
+	src/os/${OS_TYPE}
+	)
+
+target_compile_options(ipmctl_unit PRIVATE
+	-include AutoGen.h
+	)
+
+add_dependencies(ipmctl_unit
+	stringdefs
+	iniconfig
+	)
+
+target_link_libraries(ipmctl_unit
+	ipmctl_os_interface
+	${NDCTL_LIBRARIES}
+	)
+
 file(GLOB CORE_TEST_SRC
-	src/os/nvm_api/unittest/*
+	src/os/nvm_api/unittest/AcpiEventMonitor_Tests.cpp
+	src/os/nvm_api/unittest/BsTimer_Tests.cpp
+	src/os/nvm_api/unittest/Btt_Tests.cpp
+	src/os/nvm_api/unittest/Checksum_Tests.cpp
+	src/os/nvm_api/unittest/DataSet_Tests.cpp
+	src/os/nvm_api/unittest/DebugLog_Tests.cpp
+	src/os/nvm_api/unittest/JsonOutput_Tests.cpp
+	src/os/nvm_api/unittest/LargePayload_Tests.cpp
+	src/os/nvm_api/unittest/NlogDecode_Tests.cpp
+	src/os/nvm_api/unittest/NvmApi_Tests.cpp
+	src/os/nvm_api/unittest/PassthroughSession_Tests.cpp
+	src/os/nvm_api/unittest/PbrSession_Tests.cpp
+	src/os/nvm_api/unittest/TextTable_Tests.cpp
+	src/os/nvm_api/unittest/XmlOutput_Tests.cpp
 	)
 
 message(TESTS: ${CORE_TEST_SRC})
 add_executable(ipmctl_test ${CORE_TEST_SRC})
 
+# The EDK2 headers use C string idioms that C++ only warns about
+target_compile_options(ipmctl_test PRIVATE -Wno-write-strings -Wno-literal-suffix)
+
+# Golden files of the CLI output format suites
+target_compile_definitions(ipmctl_test PRIVATE
+	CLI_OUTPUT_GOLDEN_DIR="${ROOT}/src/os/nvm_api/unittest/cli_output"
+	)
+
 target_link_libraries(ipmctl_test
 	gtest
 	gtest_main
 	gmock
-	ipmctl
+	ipmctl_unit
+	)
+
+# --------------------------------------------------------------------------------------------------
+# libipmctl benchmarks
+# --------------------------------------------------------------------------------------------------
+# Timings only, kept out of ipmctl_test so the unit tests stay pass/fail
+file(GLOB CORE_BENCH_SRC
+	src/os/nvm_api/benchmark/Btt_Bench.cpp
+	src/os/nvm_api/benchmark/Checksum_Bench.cpp
+	src/os/nvm_api/benchmark/DataSet_Bench.cpp
+	src/os/nvm_api/benchmark/DebugLog_Bench.cpp
+	src/os/nvm_api/benchmark/LargePayload_Bench.cpp
+	src/os/nvm_api/benchmark/NlogDecode_Bench.cpp
+	src/os/nvm_api/benchmark/PassthroughSession_Bench.cpp
+	src/os/nvm_api/benchmark/PbrSession_Bench.cpp
 	)
 
-include_directories(ipmctl_test SYSTEM PUBLIC
-	src/os/nvm_api
+add_executable(ipmctl_bench ${CORE_BENCH_SRC})
+
+target_compile_options(ipmctl_bench PRIVATE -Wno-write-strings -Wno-literal-suffix)
+
+target_link_libraries(ipmctl_bench
+	gtest
+	gtest_main
+	ipmctl_unit
 	)
@@ -82,7 +82,10 @@
 #define OUTPUT_OPTION_NVMXML            L"nvmxml"                              //!< 'output' option value for nvmxml
 #define OUTPUT_OPTION_ESX_XML           L"esx"                                 //!< 'output' option value for esx xml
 #define OUTPUT_OPTION_ESX_TABLE_XML     L"esxtable"                            //!< 'output' option value for esx xml
-#define OUTPUT_OPTION_HELP              L"text|nvmxml"                         //!< 'output' option help text
+#define OUTPUT_OPTION_JSON              L"json"                                //!< 'output' option value for json
+#define OUTPUT_OPTION_NDJSON            L"ndjson"                              //!< 'output' option value for newline-delimited json
+#define OUTPUT_OPTION_TEXT_STREAM       L"stream"                              //!< 'output' option value for fixed width text tables written as they are built
+#define OUTPUT_OPTION_HELP              L"text|nvmxml|json|ndjson"             //!< 'output' option help text
 #define VERBOSE_OPTION_SHORT            L"-v"                                  //!< 'verbose' option short form
 #define VERBOSE_OPTION                  L"-verbose"                            //!< 'verbose' option name
 #define MASTER_OPTION                   L"-master"                             //!< 'master' option name
@@ -110,7 +113,9 @@
 #define SENSOR_TARGET                        L"-sensor"                  //!< 'sensor' target name
 #define ERROR_TARGET                         L"-error"                   //!< 'error' target name
 #define CEL_TARGET                         L"-cel"                   //!< 'cel' target name
+#define FW_CMD_STATS_TARGET                  L"-fwcmdstats"              //!< 'fwcmdstats' target name
 #define DEBUG_TARGET                         L"-debug"                   //!< 'debug' target name
+#define DBG_LOG_TARGET                       L"-dbglog"                  //!< 'dbglog' target name
 #define REGISTER_TARGET                      L"-register"                //!< 'register' target name
 #define FIRMWARE_TARGET                      L"-firmware"                //!< 'firmware' target name
 #define PCD_TARGET                           L"-pcd"                     //!< 'pcd' target name
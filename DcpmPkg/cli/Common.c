@@ -1529,6 +1529,167 @@ Finish:
 #endif
 }
 
+/**
+  Create a file to be written in several pieces, any existing file is replaced
+
+  @param[in] pDumpUserPath - destination file path
+  @param[out] pDumpFile - handle for WriteDumpFile and CloseDumpFile
+
+  @retval - Appropriate EFI return code
+**/
+EFI_STATUS
+OpenDumpFile(
+  IN     CHAR16* pDumpUserPath,
+     OUT DUMP_FILE_HANDLE* pDumpFile
+)
+{
+#ifdef OS_BUILD
+  CHAR8 *path = NULL;
+  FILE *destFile = NULL;
+
+  if (pDumpUserPath == NULL || pDumpFile == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  path = (CHAR8 *)AllocatePool(StrLen(pDumpUserPath) + 1);
+  if (NULL == path) {
+    NVDIMM_WARN("Failed to allocate enough memory.");
+    return EFI_OUT_OF_RESOURCES;
+  }
+  UnicodeStrToAsciiStrS(pDumpUserPath, path, StrLen(pDumpUserPath) + 1);
+  destFile = fopen(path, "wb+");
+  if (NULL == destFile) {
+    NVDIMM_WARN("Failed to open file (%s) errno: (%d)", path, errno);
+    FreePool(path);
+    return EFI_INVALID_PARAMETER;
+  }
+
+  FreePool(path);
+  *pDumpFile = destFile;
+  return EFI_SUCCESS;
+#else
+  EFI_DEVICE_PATH_PROTOCOL *pDevicePathProtocol = NULL;
+  EFI_FILE_HANDLE pFileHandle = NULL;
+  EFI_STATUS ReturnCode = EFI_INVALID_PARAMETER;
+  CHAR16 *pDumpFilePath = NULL;
+  UINT64 FileSize = 0;
+  NVDIMM_ENTRY();
+
+  if (pDumpUserPath == NULL || pDumpFile == NULL) {
+    goto Finish;
+  }
+
+  pDumpFilePath = AllocateZeroPool(OPTION_VALUE_LEN * sizeof(*pDumpFilePath));
+  if (pDumpFilePath == NULL) {
+    NVDIMM_CRIT("Out of memory\n");
+    ReturnCode = EFI_OUT_OF_RESOURCES;
+    goto Finish;
+  }
+
+  ReturnCode = GetDeviceAndFilePath(pDumpUserPath, pDumpFilePath, &pDevicePathProtocol);
+  if (EFI_ERROR(ReturnCode)) {
+    NVDIMM_WARN("Failed to get file path (" FORMAT_EFI_STATUS ")", ReturnCode);
+    goto Finish;
+  }
+
+  ReturnCode = OpenFileByDevice(pDumpFilePath, pDevicePathProtocol, TRUE, &pFileHandle);
+  if (EFI_ERROR(ReturnCode)) {
+    NVDIMM_WARN("Failed to open file (" FORMAT_EFI_STATUS ") (%s)", ReturnCode, pDumpFilePath);
+    goto Finish;
+  }
+
+  // Start from an empty file
+  ReturnCode = GetFileSize(pFileHandle, &FileSize);
+  if (!EFI_ERROR(ReturnCode) && FileSize != 0) {
+    ReturnCode = pFileHandle->Delete(pFileHandle);
+    pFileHandle = NULL;
+    if (EFI_ERROR(ReturnCode)) {
+      NVDIMM_WARN("Failed deleting old dump file (" FORMAT_EFI_STATUS ")", ReturnCode);
+      goto Finish;
+    }
+
+    ReturnCode = OpenFileByDevice(pDumpFilePath, pDevicePathProtocol, TRUE, &pFileHandle);
+    if (EFI_ERROR(ReturnCode)) {
+      NVDIMM_WARN("Failed to create dump file (" FORMAT_EFI_STATUS ")", ReturnCode);
+      goto Finish;
+    }
+  }
+
+  *pDumpFile = pFileHandle;
+  ReturnCode = EFI_SUCCESS;
+
+Finish:
+  FREE_POOL_SAFE(pDumpFilePath);
+  NVDIMM_EXIT_I64(ReturnCode);
+  return ReturnCode;
+#endif
+}
+
+/**
+  Write data at the current end of a file created by OpenDumpFile
+
+  @param[in] DumpFile - handle from OpenDumpFile
+  @param[in] BufferSize - data size to write
+  @param[in] pBuffer - pointer to buffer
+
+  @retval - Appropriate EFI return code
+**/
+EFI_STATUS
+WriteDumpFile(
+  IN     DUMP_FILE_HANDLE DumpFile,
+  IN     UINT64 BufferSize,
+  IN     VOID* pBuffer
+)
+{
+#ifdef OS_BUILD
+  if (DumpFile == NULL || pBuffer == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  size_t bytes_written = fwrite(pBuffer, 1, (size_t)BufferSize, (FILE *)DumpFile);
+  if (bytes_written != BufferSize) {
+    NVDIMM_WARN("Failed to write file errno: (%d)", errno);
+    return EFI_INVALID_PARAMETER;
+  }
+  return EFI_SUCCESS;
+#else
+  EFI_FILE_HANDLE pFileHandle = (EFI_FILE_HANDLE)DumpFile;
+  UINT64 SizeToWrite = BufferSize;
+
+  if (pFileHandle == NULL || pBuffer == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  return pFileHandle->Write(pFileHandle, &SizeToWrite, pBuffer);
+#endif
+}
+
+/**
+  Close a file created by OpenDumpFile
+
+  @param[in] DumpFile - handle from OpenDumpFile
+
+  @retval - Appropriate EFI return code
+**/
+EFI_STATUS
+CloseDumpFile(
+  IN     DUMP_FILE_HANDLE DumpFile
+)
+{
+  if (DumpFile == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+#ifdef OS_BUILD
+  if (0 != fclose((FILE *)DumpFile)) {
+    NVDIMM_WARN("Failed to close file errno: (%d)", errno);
+    return EFI_INVALID_PARAMETER;
+  }
+  return EFI_SUCCESS;
+#else
+  return ((EFI_FILE_HANDLE)DumpFile)->Close((EFI_FILE_HANDLE)DumpFile);
+#endif
+}
+
 /**
   Prints supported or recommended appdirect settings
 
@@ -2422,6 +2583,16 @@ ReadCmdLinePrintOptions(
       else if (0 == StrICmp(Toks[Index], OUTPUT_OPTION_NVMXML)) {
         *pFormatType = XML;
       }
+      else if (0 == StrICmp(Toks[Index], OUTPUT_OPTION_JSON)) {
+        *pFormatType = JSON;
+      }
+      else if (0 == StrICmp(Toks[Index], OUTPUT_OPTION_NDJSON)) {
+        *pFormatType = JSON;
+        PRINTER_ENABLE_NDJSON_FORMAT(pCmd->pPrintCtx);
+      }
+      else if (0 == StrICmp(Toks[Index], OUTPUT_OPTION_TEXT_STREAM)) {
+        PRINTER_ENABLE_TEXT_TABLE_STREAMING(pCmd->pPrintCtx);
+      }
       else if (0 == StrICmp(Toks[Index], OUTPUT_OPTION_ESX_XML)) {
         *pFormatType = XML;
         PRINTER_ENABLE_ESX_XML_FORMAT(pCmd->pPrintCtx);
@@ -2475,14 +2646,22 @@ CreateCmdLineOutputStr(
     return EFI_INVALID_PARAMETER;
   }
 
-  if (XML != pCmd->pPrintCtx->FormatType) {
+  if (!PRINTER_STRUCTURED_FORMAT_ENABLED(pCmd->pPrintCtx)) {
     *ppOutputStr = CatSPrint(NULL, L"");
     return EFI_SUCCESS;
   }
 
   *ppOutputStr = CatSPrint(*ppOutputStr, OUTPUT_OPTION_SHORT L" ");
 
-  if (pCmd->pPrintCtx->FormatTypeFlags.Flags.EsxCustom) {
+  if (JSON == pCmd->pPrintCtx->FormatType) {
+    if (pCmd->pPrintCtx->FormatTypeFlags.Flags.Ndjson) {
+      *ppOutputStr = CatSPrintClean(*ppOutputStr, OUTPUT_OPTION_NDJSON L" ");
+    }
+    else {
+      *ppOutputStr = CatSPrintClean(*ppOutputStr, OUTPUT_OPTION_JSON L" ");
+    }
+  }
+  else if (pCmd->pPrintCtx->FormatTypeFlags.Flags.EsxCustom) {
     *ppOutputStr = CatSPrintClean(*ppOutputStr, OUTPUT_OPTION_ESX_TABLE_XML L" ");
   }
   else if (pCmd->pPrintCtx->FormatTypeFlags.Flags.EsxKeyVal) {
@@ -15,6 +15,9 @@ extern OBJECT_STATUS gAllWarningNvmStatuses;
 extern EFI_GUID gNvmDimmConfigProtocolGuid;
 extern EFI_GUID gNvmDimmPbrProtocolGuid;
 
+/** File written in several pieces, a FILE * in the OS build **/
+typedef VOID *DUMP_FILE_HANDLE;
+
 typedef struct _CMD_DISPLAY_OPTIONS {
   BOOLEAN DisplayOptionSet;
   BOOLEAN AllOptionSet;
@@ -193,6 +196,7 @@ typedef struct _CMD_DISPLAY_OPTIONS {
 #define CLI_INFO_LOAD_RECOVER_INVALID_DIMM                    L"The specified " PMEM_MODULE_STR L" does not exist or is not in a non-functional state."
 #define CLI_INFO_ON                                           L" on"
 #define CLI_PROGRESS_STR                                      L"\rOperation on " PMEM_MODULE_STR L" 0x%04x Progress: %d%%"
+#define CLI_INFO_FW_UPDATE_TIMING                             L"Image sent to " PMEM_MODULE_STR L" " FORMAT_STR L" in %lld ms, staged after %lld ms (%d ARS retries)"
 
 #define CLI_LOAD_MFG_FW                                       L"MFG Load Prod FW"
 #define CLI_INJECT_MFG                                        L"MFG Inject command"
@@ -235,6 +239,10 @@ typedef struct _CMD_DISPLAY_OPTIONS {
 #define CLI_FORMAT_DIMM_STARTING_FORMAT                       L"Formatting " PMEM_MODULE_STR L"(s)..."
 
 #define CLI_INFO_DUMP_SUPPORT_SUCCESS                         L"Dump support data successfully written to " FORMAT_STR L"."
+#define CLI_INFO_DUMP_DBG_LOG_SUCCESS                         L"Debug log successfully written to " FORMAT_STR L"."
+#define CLI_ERR_NO_DBG_LOG_SOURCE                             L"Error: No binary debug log. Set DBG_LOG_RING_FILE in the configuration file or use the -source option."
+#define CLI_ERR_DBG_LOG_NOT_FOUND                             L"Error: Failed to open the binary debug log " FORMAT_STR L"."
+#define CLI_ERR_DBG_LOG_CORRUPTED                             L"Error: " FORMAT_STR L" is not a binary debug log."
 #define CLI_INFO_DUMP_CONFIG_SUCCESS                          L"Successfully dumped system configuration to file: " FORMAT_STR_NL
 
 #define CLI_ERR_INJECT_FATAL_ERROR_UNSUPPORTED_ON_OS          L"Injecting a Fatal Media error is unsupported on this OS.\nPlease contact your OSV for assistance in performing this action."
@@ -660,6 +668,48 @@ DumpToFile (
   IN     BOOLEAN Overwrite
   );
 
+/**
+  Create a file to be written in several pieces, any existing file is replaced
+
+  @param[in] pDumpUserPath - destination file path
+  @param[out] pDumpFile - handle for WriteDumpFile and CloseDumpFile
+
+  @retval - Appropriate EFI return code
+**/
+EFI_STATUS
+OpenDumpFile (
+  IN     CHAR16* pDumpUserPath,
+     OUT DUMP_FILE_HANDLE* pDumpFile
+  );
+
+/**
+  Write data at the current end of a file created by OpenDumpFile
+
+  @param[in] DumpFile - handle from OpenDumpFile
+  @param[in] BufferSize - data size to write
+  @param[in] pBuffer - pointer to buffer
+
+  @retval - Appropriate EFI return code
+**/
+EFI_STATUS
+WriteDumpFile (
+  IN     DUMP_FILE_HANDLE DumpFile,
+  IN     UINT64 BufferSize,
+  IN     VOID* pBuffer
+  );
+
+/**
+  Close a file created by OpenDumpFile
+
+  @param[in] DumpFile - handle from OpenDumpFile
+
+  @retval - Appropriate EFI return code
+**/
+EFI_STATUS
+CloseDumpFile (
+  IN     DUMP_FILE_HANDLE DumpFile
+  );
+
 /**
   Prints supported or recommended appdirect settings
 
@@ -462,7 +462,7 @@ CreateGoal(
     goto Finish;
   }
 
-  if (containsOption(pCmd, FORCE_OPTION) || containsOption(pCmd, FORCE_OPTION_SHORT) || XML == pPrinterCtx->FormatType) {
+  if (containsOption(pCmd, FORCE_OPTION) || containsOption(pCmd, FORCE_OPTION_SHORT) || PRINTER_STRUCTURED_FORMAT_ENABLED(pPrinterCtx)) {
     Force = TRUE;
   }
 
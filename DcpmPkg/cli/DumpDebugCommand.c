@@ -80,12 +80,11 @@ DumpDebugCommand(
   CHAR16 *pDumpUserPath = NULL;
   DIMM_INFO *pDimms = NULL;
   UINT32 Index = 0;
-  nlog_dict_entry * next;
   BOOLEAN dictExists = FALSE;
   CHAR16 *pDictUserPath = NULL;
   CHAR16 *raw_file_name = NULL;
   CHAR16 *decoded_file_name = NULL;
-  nlog_dict_entry* dict_head = NULL;
+  nlog_dict* dict = NULL;
   UINT32 dict_version;
   UINT64 dict_entries;
   PRINT_CONTEXT *pPrinterCtx = NULL;
@@ -180,8 +179,8 @@ DumpDebugCommand(
   // Only load the dictionary once
   if (dictExists)
   {
-    dict_head = load_nlog_dict(pCmd, pDictUserPath, &dict_version, &dict_entries);
-    if (!dict_head)
+    dict = load_nlog_dict(pCmd, pDictUserPath, &dict_version, &dict_entries);
+    if (!dict)
     {
       ReturnCode = EFI_LOAD_ERROR;
       PRINTER_SET_MSG(pPrinterCtx, ReturnCode, L"Failed to load the dictionary file " FORMAT_STR L"\n", pDictUserPath);
@@ -272,7 +271,7 @@ DumpDebugCommand(
       /** Decode FW debug log **/
       if (dictExists) {
         decode_nlog_binary(pCmd, decoded_file_name, RawLogBuffer, RawLogBufferSizeBytes,
-            dict_version, dict_head);
+            dict);
       }
 
       SuccessesPerDimm[Index]++;
@@ -298,15 +297,7 @@ FreeAndContinue:
 Finish:
   PRINTER_PROCESS_SET_BUFFER(pPrinterCtx);
 
-  while (dict_head)
-  {
-    next = dict_head->next;
-    FREE_POOL_SAFE(dict_head->LogLevel);
-    FREE_POOL_SAFE(dict_head->LogString);
-    FREE_POOL_SAFE(dict_head->FileName);
-    FREE_POOL_SAFE(dict_head);
-    dict_head = next;
-  }
+  free_nlog_dict(dict);
 
   FREE_POOL_SAFE(pDimms);
   FREE_POOL_SAFE(pDimmIds);
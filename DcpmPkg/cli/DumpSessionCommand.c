@@ -13,6 +13,7 @@
 #include "DumpSessionCommand.h"
 #include "Common.h"
 #include <PbrDcpmm.h>
+#include <Checksum.h>
 #ifdef OS_BUILD
 #include <os.h>
 #endif
@@ -57,7 +58,7 @@ DumpSession(
   UINT32 BufferSz = 0;
   VOID *pBuffer = NULL;
   PRINT_CONTEXT *pPrinterCtx = NULL;
-  PbrHeader *pHeader = NULL;
+  PbrSessionHeader *pHeader = NULL;
 
   NVDIMM_ENTRY();
 
@@ -104,7 +105,7 @@ DumpSession(
   }
 
   //fill in run-time versioning info
-  pHeader = (PbrHeader*)pBuffer;
+  pHeader = (PbrSessionHeader*)pBuffer;
 #ifdef OS_BUILD
   os_get_os_name(pHeader->OsName, PBR_OS_NAME_MAX);
   os_get_os_version(pHeader->OsVersion, PBR_OS_VERSION_MAX);
@@ -113,6 +114,7 @@ DumpSession(
   AsciiSPrint(pHeader->OsName, PBR_OS_NAME_MAX, "UEFI");
   UnicodeStrToAsciiStrS(NVMDIMM_VERSION_STRING, pHeader->SwVersion, PBR_SW_VERSION_MAX);
 #endif
+  pHeader->HeaderChecksum = Fletcher64(pHeader, OFFSET_OF(PbrSessionHeader, HeaderChecksum));
 
   //dump the buffer to a file
   ReturnCode = DumpToFile(pDumpUserPath, BufferSz, pBuffer, TRUE);
@@ -108,6 +108,10 @@ Load(
   BOOLEAN Confirmation = 0;
   EFI_STATUS ReturnCodes[MAX_DIMMS];
   NVM_STATUS NvmCodes[MAX_DIMMS];
+  UINT32 UpdateIndexes[MAX_DIMMS];
+  UINT32 UpdateIndexesNum = 0;
+  UINT32 ForceIndexes[MAX_DIMMS];
+  UINT32 ForceIndexesNum = 0;
   NVM_STATUS generalNvmStatus = NVM_SUCCESS;
 
 #ifndef OS_BUILD
@@ -117,7 +121,7 @@ Load(
 #endif
 
   if ((NULL != pCmd) && (NULL != pCmd->pPrintCtx)) {
-    if (pCmd->pPrintCtx->FormatType == XML) {
+    if (PRINTER_STRUCTURED_FORMAT_ENABLED(pCmd->pPrintCtx)) {
       PRINTER_CONFIGURE_BUFFERING(pCmd->pPrintCtx, ON);
     }
     else {
@@ -307,32 +311,35 @@ Load(
     gBS->SetTimer(ProgressEvent, TimerPeriodic, PROGRESS_EVENT_TIMEOUT);
   }
 
-  for (Index = 0; Index < DimmTargetsNum; Index++) {
-
-    pCommandStatus->GeneralStatus = NVM_SUCCESS; //ensure that only the last error gets reported
+  if (Examine) {
+    for (Index = 0; Index < DimmTargetsNum; Index++) {
+      pCommandStatus->GeneralStatus = NVM_SUCCESS; //ensure that only the last error gets reported
 
-    //if the FW is already staged and this isn't an examine operation, the outcome is already known
-    if (FALSE == Examine && TRUE == FwHasBeenStaged(pCmd, pNvmDimmConfigProtocol, pDimmTargets[Index].DimmID)) {
-      pCommandStatus->GeneralStatus = NVM_ERR_FIRMWARE_ALREADY_LOADED;
+      ReturnCodes[Index] = pNvmDimmConfigProtocol->UpdateFw(pNvmDimmConfigProtocol, &pDimmTargetIds[Index], 1, pRelativeFileName,
+          (CHAR16 *)pWorkingDirectory, Examine, Force, Recovery, FALSE, pFwImageInfo, pCommandStatus);
       NvmCodes[Index] = pCommandStatus->GeneralStatus;
-      ReturnCodes[Index] = MatchCliReturnCode(NvmCodes[Index]);
-      SetObjStatusForDimmInfoWithErase(pCommandStatus, &pDimmTargets[Index], NvmCodes[Index], TRUE);
-      continue;
-    }
-
-    ReturnCodes[Index] = pNvmDimmConfigProtocol->UpdateFw(pNvmDimmConfigProtocol, &pDimmTargetIds[Index], 1, pRelativeFileName,
-        (CHAR16 *)pWorkingDirectory, Examine, Force, Recovery, FALSE, pFwImageInfo, pCommandStatus);
-    NvmCodes[Index] = pCommandStatus->GeneralStatus;
 
-    if (Examine) {
       if (NvmCodes[Index] == NVM_ERR_FIRMWARE_TOO_LOW_FORCE_REQUIRED) {
         ReturnCodes[Index] = EFI_SUCCESS;
         NvmCodes[Index] = NVM_SUCCESS;
       }
-      continue;
+    }
+  } else {
+    for (Index = 0; Index < DimmTargetsNum; Index++) {
+      UpdateIndexes[UpdateIndexesNum++] = Index;
     }
 
-    if (pCommandStatus->GeneralStatus == NVM_ERR_FIRMWARE_TOO_LOW_FORCE_REQUIRED) {
+    // All the modules at once, the image is loaded and verified once and sent
+    // to all of them concurrently. The driver fails the ones that already
+    // have an image staged with NVM_ERR_FIRMWARE_ALREADY_LOADED.
+    UpdateFwOnDimms(pNvmDimmConfigProtocol, pCommandStatus, pRelativeFileName, (CHAR16 *)pWorkingDirectory, Force, Recovery,
+      pDimmTargets, UpdateIndexes, UpdateIndexesNum, ReturnCodes, NvmCodes);
+
+    for (Index2 = 0; Index2 < UpdateIndexesNum; Index2++) {
+      Index = UpdateIndexes[Index2];
+      if (NvmCodes[Index] != NVM_ERR_FIRMWARE_TOO_LOW_FORCE_REQUIRED) {
+        continue;
+      }
 
       ReturnCodes[Index] = GetDimmHandleByPid(pDimmTargetIds[Index], pDimmTargets, DimmTargetsNum, &DimmHandle, &DimmIndex);
       if (EFI_ERROR(ReturnCodes[Index])) {
@@ -357,18 +364,19 @@ Load(
         SetObjStatusForDimmInfoWithErase(pCommandStatus, &pDimmTargets[Index], NvmCodes[Index], TRUE);
         continue;
       }
+      ForceIndexes[ForceIndexesNum++] = Index;
+    }
 
-      ReturnCodes[Index] = pNvmDimmConfigProtocol->UpdateFw(pNvmDimmConfigProtocol, &pDimmTargetIds[Index], 1, pRelativeFileName,
-        (CHAR16 *)pWorkingDirectory, Examine, TRUE, Recovery, FALSE, pFwImageInfo, pCommandStatus);
-      if (EFI_ERROR(ReturnCodes[Index])) {
-        continue;
+    // The confirmed downgrades, again all at once
+    UpdateFwOnDimms(pNvmDimmConfigProtocol, pCommandStatus, pRelativeFileName, (CHAR16 *)pWorkingDirectory, TRUE, Recovery,
+      pDimmTargets, ForceIndexes, ForceIndexesNum, ReturnCodes, NvmCodes);
+
+    for (Index2 = 0; Index2 < UpdateIndexesNum; Index2++) {
+      if (!EFI_ERROR(ReturnCodes[UpdateIndexes[Index2]])) {
+        StagedFwUpdates++;
       }
-    } else if (EFI_ERROR(ReturnCodes[Index])) {
-      continue;
     }
-
-    StagedFwUpdates++;
-  } //for loop
+  }
 
 
   if (Examine) {
@@ -393,6 +401,9 @@ Load(
       */
       TempReturnCode = BlockForFwStage(pCmd, pCommandStatus, pNvmDimmConfigProtocol,
         &ReturnCodes[0], &NvmCodes[0], &pDimmTargets[0], DimmTargetsNum);
+      if (containsOption(pCmd, VERBOSE_OPTION) || containsOption(pCmd, VERBOSE_OPTION_SHORT)) {
+        PrintFwUpdateTiming(pCmd, pNvmDimmConfigProtocol, pDimmTargets, UpdateIndexes, UpdateIndexesNum);
+      }
       if (EFI_ERROR(TempReturnCode)) {
         ReturnCode = TempReturnCode;
         goto Finish;
@@ -519,6 +530,7 @@ BlockForFwStage(
   EFI_STATUS LongOpEfiStatus = EFI_SUCCESS;
   UINT8 TransmitFwNeverHappened = 0xFF;
   UINT8 UnknownStatus = 0xFD;
+  FW_UPDATE_STATUS FwUpdateStatus;
   volatile UINT32 Index = 0;
 
   NVDIMM_ENTRY();
@@ -573,7 +585,10 @@ BlockForFwStage(
         continue;
       }
 
-      if (FwHasBeenStaged(pCmd, pNvmDimmConfigProtocol, pDimmTargets[Index].DimmID) == TRUE) {
+      // The driver checks the DIMM for the staged image while it is staging
+      ZeroMem(&FwUpdateStatus, sizeof(FwUpdateStatus));
+      pNvmDimmConfigProtocol->GetFwUpdateStatus(pNvmDimmConfigProtocol, pDimmTargets[Index].DimmID, &FwUpdateStatus);
+      if (FwUpdateStatus.State == FwUpdateStateStaged) {
         pNvmCodes[Index] = NVM_SUCCESS_FW_RESET_REQUIRED;
         pReturnCodes[Index] = EFI_SUCCESS;
         SetObjStatusForDimmInfoWithErase(pCommandStatus, &pDimmTargets[Index], pNvmCodes[Index], TRUE);
@@ -639,31 +654,137 @@ Finish:
 }
 
 /**
-Check to see if a FW has already been staged on a DIMM
+  Update the FW of several DIMMs with a single UpdateFw call per DIMM generation,
+  so the image is loaded and verified once and sent to the DIMMs concurrently.
+  The outcome of each DIMM is taken from its FW update status.
 
-@param[in] pCmd - The command object
-@param[in] pNvmDimmConfigProtocol - The open config protocol
-@param[in] DimmID - The ID of the dimm to check. Must be a functional DIMM
+  @param[in] pNvmDimmConfigProtocol - The open config protocol
+  @param[in] pCommandStatus - The command status object
+  @param[in] pFileName - The FW image file
+  @param[in] pWorkingDirectory - Working directory of the FW image file
+  @param[in] Force - Allow downgrades
+  @param[in] Recovery - Update the non-functional DIMMs only
+  @param[in] pDimmTargets - The list of target DIMMs
+  @param[in] pIndexes - Indexes into pDimmTargets of the DIMMs to update
+  @param[in] IndexesNum - The list length of pIndexes
+  @param[in, out] pReturnCodes - The return code of each target DIMM, the ones listed in pIndexes are set
+  @param[in, out] pNvmCodes - The NVM code of each target DIMM, the ones listed in pIndexes are set
 **/
-BOOLEAN
-FwHasBeenStaged(
-  IN   struct Command *pCmd,
-  IN   EFI_DCPMM_CONFIG2_PROTOCOL *pNvmDimmConfigProtocol,
-  IN   UINT16 DimmID
-) {
+VOID
+UpdateFwOnDimms(
+  IN     EFI_DCPMM_CONFIG2_PROTOCOL *pNvmDimmConfigProtocol,
+  IN     COMMAND_STATUS *pCommandStatus,
+  IN     CHAR16 *pFileName,
+  IN     CHAR16 *pWorkingDirectory,
+  IN     BOOLEAN Force,
+  IN     BOOLEAN Recovery,
+  IN     DIMM_INFO *pDimmTargets,
+  IN     UINT32 *pIndexes,
+  IN     UINT32 IndexesNum,
+  IN OUT EFI_STATUS *pReturnCodes,
+  IN OUT NVM_STATUS *pNvmCodes
+)
+{
+  EFI_STATUS ReturnCode = EFI_SUCCESS;
+  UINT16 BatchIds[MAX_DIMMS];
+  UINT32 BatchIndexes[MAX_DIMMS];
+  BOOLEAN Batched[MAX_DIMMS];
+  UINT32 BatchNum = 0;
+  UINT16 SubsystemDeviceId = 0;
+  FW_UPDATE_STATUS FwUpdateStatus;
+  UINT32 Index = 0;
+  UINT32 Index2 = 0;
 
-  BOOLEAN         RetBool = FALSE;
-  EFI_STATUS      ReturnCode = EFI_SUCCESS;
-  DIMM_INFO Dimm;
   NVDIMM_ENTRY();
 
-  CHECK_RESULT((pNvmDimmConfigProtocol->GetDimm(pNvmDimmConfigProtocol, DimmID, DIMM_INFO_CATEGORY_FW_IMAGE_INFO, &Dimm)), Finish);
-  if (FALSE == FW_VERSION_UNDEFINED(Dimm.StagedFwVersion)) {
-    RetBool = TRUE;
+  if (IndexesNum > MAX_DIMMS) {
+    NVDIMM_DBG("Number of target DIMMs is greater than max DIMMs number.");
+    goto Finish;
   }
 
+  ZeroMem(Batched, sizeof(Batched));
+
+  // UpdateFw() only takes DIMMs of one generation at a time
+  for (Index = 0; Index < IndexesNum; Index++) {
+    if (Batched[Index]) {
+      continue;
+    }
+
+    SubsystemDeviceId = pDimmTargets[pIndexes[Index]].SubsystemDeviceId;
+    BatchNum = 0;
+    for (Index2 = Index; Index2 < IndexesNum; Index2++) {
+      if (!Batched[Index2] && pDimmTargets[pIndexes[Index2]].SubsystemDeviceId == SubsystemDeviceId) {
+        BatchIndexes[BatchNum] = pIndexes[Index2];
+        BatchIds[BatchNum] = pDimmTargets[pIndexes[Index2]].DimmID;
+        BatchNum++;
+        Batched[Index2] = TRUE;
+      }
+    }
+
+    pCommandStatus->GeneralStatus = NVM_SUCCESS; //ensure that only the last error gets reported
+    ReturnCode = pNvmDimmConfigProtocol->UpdateFw(pNvmDimmConfigProtocol, BatchIds, BatchNum, pFileName,
+      pWorkingDirectory, FALSE, Force, Recovery, FALSE, NULL, pCommandStatus);
+
+    for (Index2 = 0; Index2 < BatchNum; Index2++) {
+      ZeroMem(&FwUpdateStatus, sizeof(FwUpdateStatus));
+      pNvmDimmConfigProtocol->GetFwUpdateStatus(pNvmDimmConfigProtocol, BatchIds[Index2], &FwUpdateStatus);
+
+      if (FwUpdateStatus.State == FwUpdateStateNone) {
+        // Never got to the DIMM, the whole command failed
+        pReturnCodes[BatchIndexes[Index2]] = ReturnCode;
+        pNvmCodes[BatchIndexes[Index2]] = pCommandStatus->GeneralStatus;
+      } else if (FwUpdateStatus.State == FwUpdateStateFailed) {
+        pReturnCodes[BatchIndexes[Index2]] = EFI_ABORTED;
+        pNvmCodes[BatchIndexes[Index2]] = FwUpdateStatus.NvmStatus;
+      } else {
+        // BlockForFwStage() confirms the staged image
+        pReturnCodes[BatchIndexes[Index2]] = EFI_SUCCESS;
+        pNvmCodes[BatchIndexes[Index2]] = NVM_SUCCESS;
+      }
+    }
+  }
 
 Finish:
-  NVDIMM_EXIT_I64(ReturnCode);
-  return RetBool;
+  NVDIMM_EXIT();
+}
+
+/**
+  Print how long sending and staging the image took on each updated DIMM
+
+  @param[in] pCmd - The command object
+  @param[in] pNvmDimmConfigProtocol - The open config protocol
+  @param[in] pDimmTargets - The list of target DIMMs
+  @param[in] pIndexes - Indexes into pDimmTargets of the updated DIMMs
+  @param[in] IndexesNum - The list length of pIndexes
+**/
+VOID
+PrintFwUpdateTiming(
+  IN     struct Command *pCmd,
+  IN     EFI_DCPMM_CONFIG2_PROTOCOL *pNvmDimmConfigProtocol,
+  IN     DIMM_INFO *pDimmTargets,
+  IN     UINT32 *pIndexes,
+  IN     UINT32 IndexesNum
+)
+{
+  FW_UPDATE_STATUS FwUpdateStatus;
+  CHAR16 DimmStr[MAX_DIMM_UID_LENGTH];
+  DIMM_INFO *pDimm = NULL;
+  UINT32 Index = 0;
+
+  NVDIMM_ENTRY();
+
+  for (Index = 0; Index < IndexesNum; Index++) {
+    pDimm = &pDimmTargets[pIndexes[Index]];
+    if (EFI_ERROR(pNvmDimmConfigProtocol->GetFwUpdateStatus(pNvmDimmConfigProtocol, pDimm->DimmID, &FwUpdateStatus)) ||
+        FwUpdateStatus.State != FwUpdateStateStaged) {
+      continue;
+    }
+    if (EFI_ERROR(GetPreferredDimmIdAsString(pDimm->DimmHandle, pDimm->DimmUid, DimmStr, MAX_DIMM_UID_LENGTH))) {
+      continue;
+    }
+    PrinterSetMsg(pCmd->pPrintCtx, EFI_SUCCESS, CLI_INFO_FW_UPDATE_TIMING, DimmStr,
+      FwUpdateStatus.TransferTimeMs, FwUpdateStatus.StageTimeMs, FwUpdateStatus.ArsRetries);
+  }
+
+  NVDIMM_EXIT();
 }
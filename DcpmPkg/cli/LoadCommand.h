@@ -80,16 +80,52 @@ BlockForFwStage(
 );
 
 /**
-Check to see if a FW has already been staged on a DIMM
+  Update the FW of several DIMMs with a single UpdateFw call per DIMM generation,
+  so the image is loaded and verified once and sent to the DIMMs concurrently.
+  The outcome of each DIMM is taken from its FW update status.
 
-@param[in] pCmd - The command object
-@param[in] pNvmDimmConfigProtocol - The open config protocol
-@param[in] DimmID - The ID of the dimm to check. Must be a functional DIMM
+  @param[in] pNvmDimmConfigProtocol - The open config protocol
+  @param[in] pCommandStatus - The command status object
+  @param[in] pFileName - The FW image file
+  @param[in] pWorkingDirectory - Working directory of the FW image file
+  @param[in] Force - Allow downgrades
+  @param[in] Recovery - Update the non-functional DIMMs only
+  @param[in] pDimmTargets - The list of target DIMMs
+  @param[in] pIndexes - Indexes into pDimmTargets of the DIMMs to update
+  @param[in] IndexesNum - The list length of pIndexes
+  @param[in, out] pReturnCodes - The return code of each target DIMM, the ones listed in pIndexes are set
+  @param[in, out] pNvmCodes - The NVM code of each target DIMM, the ones listed in pIndexes are set
 **/
-BOOLEAN
-FwHasBeenStaged(
-  IN   struct Command *pCmd,
-  IN   EFI_DCPMM_CONFIG2_PROTOCOL *pNvmDimmConfigProtocol,
-  IN   UINT16 DimmID
+VOID
+UpdateFwOnDimms(
+  IN     EFI_DCPMM_CONFIG2_PROTOCOL *pNvmDimmConfigProtocol,
+  IN     COMMAND_STATUS *pCommandStatus,
+  IN     CHAR16 *pFileName,
+  IN     CHAR16 *pWorkingDirectory,
+  IN     BOOLEAN Force,
+  IN     BOOLEAN Recovery,
+  IN     DIMM_INFO *pDimmTargets,
+  IN     UINT32 *pIndexes,
+  IN     UINT32 IndexesNum,
+  IN OUT EFI_STATUS *pReturnCodes,
+  IN OUT NVM_STATUS *pNvmCodes
+);
+
+/**
+  Print how long sending and staging the image took on each updated DIMM
+
+  @param[in] pCmd - The command object
+  @param[in] pNvmDimmConfigProtocol - The open config protocol
+  @param[in] pDimmTargets - The list of target DIMMs
+  @param[in] pIndexes - Indexes into pDimmTargets of the updated DIMMs
+  @param[in] IndexesNum - The list length of pIndexes
+**/
+VOID
+PrintFwUpdateTiming(
+  IN     struct Command *pCmd,
+  IN     EFI_DCPMM_CONFIG2_PROTOCOL *pNvmDimmConfigProtocol,
+  IN     DIMM_INFO *pDimmTargets,
+  IN     UINT32 *pIndexes,
+  IN     UINT32 IndexesNum
 );
 #endif /** _LOADCOMMAND_H_ **/
@@ -140,7 +140,7 @@ LoadGoal(
     UnitsToDisplay = UnitsOption;
   }
 
-  if (containsOption(pCmd, FORCE_OPTION) || containsOption(pCmd, FORCE_OPTION_SHORT) || XML == pPrinterCtx->FormatType) {
+  if (containsOption(pCmd, FORCE_OPTION) || containsOption(pCmd, FORCE_OPTION_SHORT) || PRINTER_STRUCTURED_FORMAT_ENABLED(pPrinterCtx)) {
     Force = TRUE;
   }
 
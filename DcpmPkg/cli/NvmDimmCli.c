@@ -65,6 +65,7 @@
 #include "LoadSessionCommand.h"
 #ifdef OS_BUILD
 #include <Protocol/Driver/DriverBinding.h>
+#include <os_efi_shell_parameters_protocol.h>
 #else
 #include <Protocol/DriverBinding.h>
 #endif
@@ -80,6 +81,8 @@ extern int cov_dumpData(void);
 #endif
 #ifdef OS_BUILD
 #include "DumpSupportCommand.h"
+#include "ShowFwCmdStatsCommand.h"
+#include "DumpDbgLogCommand.h"
 #include <stdio.h>
 extern void nvm_current_cmd(struct Command Command);
 extern BOOLEAN ConfigIsDdrtProtocolDisabled();
@@ -295,6 +298,9 @@ UefiMain(
 
   ZeroMem(&Input, sizeof(Input));
   ZeroMem(&Command, sizeof(Command));
+  // Left set by the previous command when nvm_run_cli() is called again in the same process
+  HelpRequested = FALSE;
+  FullHelpRequested = FALSE;
 
 #ifndef OS_BUILD
   InitErrorAndWarningNvmStatusCodes();
@@ -573,7 +579,8 @@ UefiMain(
       } else {
 #ifdef OS_BUILD //WA, remove after all CMDs convert to "unified printing" mechanism
         if (Command.PrinterCtrlSupported) {
-          gOsShellParametersProtocol.StdOut = stdout;
+          // The printer renders XML itself, nothing left for process_output to wrap
+          stop_output_capture();
         }
 #endif
 
@@ -824,6 +831,16 @@ RegisterCommands(
   if (EFI_ERROR(Rc)) {
     goto done;
   }
+
+  Rc = RegisterShowFwCmdStatsCommand();
+  if (EFI_ERROR(Rc)) {
+    goto done;
+  }
+
+  Rc = RegisterDumpDbgLogCommand();
+  if (EFI_ERROR(Rc)) {
+    goto done;
+  }
 #endif // OS_BUILD
 
   // Debug Commands
@@ -0,0 +1,603 @@
+/*
+ * Copyright (c) 2018, Intel Corporation.
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+/**
+  Checksum kernels.
+
+  Fletcher64 adds each 32-bit word to Lo32 and then Lo32 to Hi32, so every word
+  depends on the one before it. The kernels run L independent lanes instead, each
+  lane j taking every L-th word starting at word j:
+
+    A[j] += w       B[j] += A[j]
+
+  After N words (a multiple of L) the lanes fold back into the serial result:
+
+    Lo32' = Lo32 + Sum(A[j])
+    Hi32' = Hi32 + N * Lo32 + Sum(L * B[j] - j * A[j])
+
+  everything modulo 2^32, which makes the result bit-exact with the serial loop.
+**/
+
+#if defined(OS_BUILD) && (defined(__x86_64__) || defined(_M_X64))
+#define CHECKSUM_X86_KERNELS
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define CHECKSUM_TARGET_AVX2
+#else
+#define CHECKSUM_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+#include <Library/BaseMemoryLib.h>
+#include <Debug.h>
+#include "Checksum.h"
+
+#define FLETCHER64_PORTABLE_LANES   4
+#define FLETCHER64_SSE2_LANES       8
+#define FLETCHER64_AVX2_LANES       16
+#define FLETCHER64_MAX_LANES        FLETCHER64_AVX2_LANES
+
+/**
+  Add whole 32-bit words to the Fletcher64 sums
+
+  @param[in] pData Words to add, no alignment required
+  @param[in] Words Number of words
+  @param[in, out] pLo32 Sum of the words
+  @param[in, out] pHi32 Sum of the running sums
+**/
+typedef
+VOID
+(*FLETCHER64_WORDS) (
+  IN     CONST UINT8 *pData,
+  IN     UINT64 Words,
+  IN OUT UINT32 *pLo32,
+  IN OUT UINT32 *pHi32
+  );
+
+/**
+  Sum bytes
+
+  @param[in] pData Bytes to sum
+  @param[in] Length Number of bytes
+
+  @retval The sum of the bytes
+**/
+typedef
+UINT64
+(*SUM8_BYTES) (
+  IN     CONST UINT8 *pData,
+  IN     UINT64 Length
+  );
+
+typedef struct _CHECKSUM_KERNEL_OPS {
+  FLETCHER64_WORDS pFletcher64Words;
+  SUM8_BYTES pSum8Bytes;
+} CHECKSUM_KERNEL_OPS;
+
+/**
+  Little endian 32-bit word at any alignment, compilers turn it into a single load
+**/
+STATIC
+UINT32
+LoadWord(
+  IN     CONST UINT8 *pData
+  )
+{
+  return (UINT32)pData[0] | ((UINT32)pData[1] << 8) | ((UINT32)pData[2] << 16) | ((UINT32)pData[3] << 24);
+}
+
+/**
+  Fold the lane sums of a kernel into the Fletcher64 sums
+
+  @param[in] pA Per lane sums of the words
+  @param[in] pB Per lane sums of the running sums
+  @param[in] Lanes Number of lanes
+  @param[in] Words Number of words the lanes took, a multiple of Lanes
+  @param[in, out] pLo32 Sum of the words
+  @param[in, out] pHi32 Sum of the running sums
+**/
+STATIC
+VOID
+Fletcher64FoldLanes(
+  IN     CONST UINT32 *pA,
+  IN     CONST UINT32 *pB,
+  IN     UINT32 Lanes,
+  IN     UINT64 Words,
+  IN OUT UINT32 *pLo32,
+  IN OUT UINT32 *pHi32
+  )
+{
+  UINT32 Sum = 0;
+  UINT32 Weighted = 0;
+  UINT32 Index = 0;
+
+  for (Index = 0; Index < Lanes; Index++) {
+    Sum += pA[Index];
+    Weighted += Lanes * pB[Index] - Index * pA[Index];
+  }
+
+  *pHi32 += (UINT32)Words * *pLo32 + Weighted;
+  *pLo32 += Sum;
+}
+
+/**
+  Serial Fletcher64 for the words left over by the lane kernels
+**/
+STATIC
+VOID
+Fletcher64Serial(
+  IN     CONST UINT8 *pData,
+  IN     UINT64 Words,
+  IN OUT UINT32 *pLo32,
+  IN OUT UINT32 *pHi32
+  )
+{
+  UINT32 Lo32 = *pLo32;
+  UINT32 Hi32 = *pHi32;
+  UINT64 Index = 0;
+
+  for (Index = 0; Index < Words; Index++) {
+    Lo32 += LoadWord(pData + Index * sizeof(UINT32));
+    Hi32 += Lo32;
+  }
+
+  *pLo32 = Lo32;
+  *pHi32 = Hi32;
+}
+
+STATIC
+VOID
+Fletcher64Portable(
+  IN     CONST UINT8 *pData,
+  IN     UINT64 Words,
+  IN OUT UINT32 *pLo32,
+  IN OUT UINT32 *pHi32
+  )
+{
+  UINT32 A[FLETCHER64_PORTABLE_LANES] = {0};
+  UINT32 B[FLETCHER64_PORTABLE_LANES] = {0};
+  UINT64 LaneWords = Words - Words % FLETCHER64_PORTABLE_LANES;
+  UINT64 Index = 0;
+
+  for (Index = 0; Index < LaneWords; Index += FLETCHER64_PORTABLE_LANES) {
+    A[0] += LoadWord(pData);
+    A[1] += LoadWord(pData + 4);
+    A[2] += LoadWord(pData + 8);
+    A[3] += LoadWord(pData + 12);
+    B[0] += A[0];
+    B[1] += A[1];
+    B[2] += A[2];
+    B[3] += A[3];
+    pData += FLETCHER64_PORTABLE_LANES * sizeof(UINT32);
+  }
+
+  Fletcher64FoldLanes(A, B, FLETCHER64_PORTABLE_LANES, LaneWords, pLo32, pHi32);
+  Fletcher64Serial(pData, Words - LaneWords, pLo32, pHi32);
+}
+
+STATIC
+UINT64
+Sum8Portable(
+  IN     CONST UINT8 *pData,
+  IN     UINT64 Length
+  )
+{
+  UINT64 Sum[4] = {0};
+  UINT64 Index = 0;
+
+  for (Index = 0; Index + 4 <= Length; Index += 4) {
+    Sum[0] += pData[Index];
+    Sum[1] += pData[Index + 1];
+    Sum[2] += pData[Index + 2];
+    Sum[3] += pData[Index + 3];
+  }
+  for (; Index < Length; Index++) {
+    Sum[0] += pData[Index];
+  }
+
+  return Sum[0] + Sum[1] + Sum[2] + Sum[3];
+}
+
+#ifdef CHECKSUM_X86_KERNELS
+/**
+  SSE2 is part of x86-64, two registers make eight lanes
+**/
+STATIC
+VOID
+Fletcher64Sse2(
+  IN     CONST UINT8 *pData,
+  IN     UINT64 Words,
+  IN OUT UINT32 *pLo32,
+  IN OUT UINT32 *pHi32
+  )
+{
+  __m128i A0 = _mm_setzero_si128();
+  __m128i A1 = _mm_setzero_si128();
+  __m128i B0 = _mm_setzero_si128();
+  __m128i B1 = _mm_setzero_si128();
+  UINT32 A[FLETCHER64_SSE2_LANES];
+  UINT32 B[FLETCHER64_SSE2_LANES];
+  UINT64 LaneWords = Words - Words % FLETCHER64_SSE2_LANES;
+  UINT64 Index = 0;
+
+  for (Index = 0; Index < LaneWords; Index += FLETCHER64_SSE2_LANES) {
+    A0 = _mm_add_epi32(A0, _mm_loadu_si128((CONST __m128i *)pData));
+    A1 = _mm_add_epi32(A1, _mm_loadu_si128((CONST __m128i *)(pData + 16)));
+    B0 = _mm_add_epi32(B0, A0);
+    B1 = _mm_add_epi32(B1, A1);
+    pData += FLETCHER64_SSE2_LANES * sizeof(UINT32);
+  }
+
+  _mm_storeu_si128((__m128i *)&A[0], A0);
+  _mm_storeu_si128((__m128i *)&A[4], A1);
+  _mm_storeu_si128((__m128i *)&B[0], B0);
+  _mm_storeu_si128((__m128i *)&B[4], B1);
+  Fletcher64FoldLanes(A, B, FLETCHER64_SSE2_LANES, LaneWords, pLo32, pHi32);
+  Fletcher64Serial(pData, Words - LaneWords, pLo32, pHi32);
+}
+
+STATIC
+UINT64
+Sum8Sse2(
+  IN     CONST UINT8 *pData,
+  IN     UINT64 Length
+  )
+{
+  __m128i Zero = _mm_setzero_si128();
+  __m128i Sum = _mm_setzero_si128();
+  UINT64 Parts[2];
+  UINT64 Index = 0;
+
+  // Each sum of absolute differences against zero adds up 8 bytes per 64-bit half
+  for (Index = 0; Index + 16 <= Length; Index += 16) {
+    Sum = _mm_add_epi64(Sum, _mm_sad_epu8(_mm_loadu_si128((CONST __m128i *)(pData + Index)), Zero));
+  }
+
+  _mm_storeu_si128((__m128i *)Parts, Sum);
+  return Parts[0] + Parts[1] + Sum8Portable(pData + Index, Length - Index);
+}
+
+CHECKSUM_TARGET_AVX2
+STATIC
+VOID
+Fletcher64Avx2(
+  IN     CONST UINT8 *pData,
+  IN     UINT64 Words,
+  IN OUT UINT32 *pLo32,
+  IN OUT UINT32 *pHi32
+  )
+{
+  __m256i A0 = _mm256_setzero_si256();
+  __m256i A1 = _mm256_setzero_si256();
+  __m256i B0 = _mm256_setzero_si256();
+  __m256i B1 = _mm256_setzero_si256();
+  UINT32 A[FLETCHER64_AVX2_LANES];
+  UINT32 B[FLETCHER64_AVX2_LANES];
+  UINT64 LaneWords = Words - Words % FLETCHER64_AVX2_LANES;
+  UINT64 Index = 0;
+
+  for (Index = 0; Index < LaneWords; Index += FLETCHER64_AVX2_LANES) {
+    A0 = _mm256_add_epi32(A0, _mm256_loadu_si256((CONST __m256i *)pData));
+    A1 = _mm256_add_epi32(A1, _mm256_loadu_si256((CONST __m256i *)(pData + 32)));
+    B0 = _mm256_add_epi32(B0, A0);
+    B1 = _mm256_add_epi32(B1, A1);
+    pData += FLETCHER64_AVX2_LANES * sizeof(UINT32);
+  }
+
+  _mm256_storeu_si256((__m256i *)&A[0], A0);
+  _mm256_storeu_si256((__m256i *)&A[8], A1);
+  _mm256_storeu_si256((__m256i *)&B[0], B0);
+  _mm256_storeu_si256((__m256i *)&B[8], B1);
+  Fletcher64FoldLanes(A, B, FLETCHER64_AVX2_LANES, LaneWords, pLo32, pHi32);
+  Fletcher64Serial(pData, Words - LaneWords, pLo32, pHi32);
+}
+
+CHECKSUM_TARGET_AVX2
+STATIC
+UINT64
+Sum8Avx2(
+  IN     CONST UINT8 *pData,
+  IN     UINT64 Length
+  )
+{
+  __m256i Zero = _mm256_setzero_si256();
+  __m256i Sum = _mm256_setzero_si256();
+  UINT64 Parts[4];
+  UINT64 Index = 0;
+
+  for (Index = 0; Index + 32 <= Length; Index += 32) {
+    Sum = _mm256_add_epi64(Sum, _mm256_sad_epu8(_mm256_loadu_si256((CONST __m256i *)(pData + Index)), Zero));
+  }
+
+  _mm256_storeu_si256((__m256i *)Parts, Sum);
+  return Parts[0] + Parts[1] + Parts[2] + Parts[3] + Sum8Portable(pData + Index, Length - Index);
+}
+
+/**
+  Check the CPU and the OS for AVX2, the OS has to save the YMM registers
+**/
+STATIC
+BOOLEAN
+CpuHasAvx2(
+  )
+{
+#ifdef _MSC_VER
+  int Regs[4] = {0};
+
+  __cpuid(Regs, 0);
+  if (Regs[0] < 7) {
+    return FALSE;
+  }
+  __cpuid(Regs, 1);
+  // OSXSAVE and AVX, then XMM and YMM state enabled in XCR0
+  if ((Regs[2] & (1 << 27)) == 0 || (Regs[2] & (1 << 28)) == 0 || (_xgetbv(0) & 0x6) != 0x6) {
+    return FALSE;
+  }
+  __cpuidex(Regs, 7, 0);
+  return (Regs[1] & (1 << 5)) != 0;
+#else
+  // Also checks the YMM state is enabled by the OS
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx2") ? TRUE : FALSE;
+#endif
+}
+#endif // CHECKSUM_X86_KERNELS
+
+STATIC CONST CHECKSUM_KERNEL_OPS gChecksumKernelOps[ChecksumKernelMax] = {
+  {NULL, NULL},                               // ChecksumKernelAuto
+  {Fletcher64Portable, Sum8Portable},         // ChecksumKernelPortable
+#ifdef CHECKSUM_X86_KERNELS
+  {Fletcher64Sse2, Sum8Sse2},                 // ChecksumKernelSse2
+  {Fletcher64Avx2, Sum8Avx2}                  // ChecksumKernelAvx2
+#else
+  {NULL, NULL},
+  {NULL, NULL}
+#endif
+};
+
+/**
+  Kernel in use, resolved on first use. Resolving is idempotent, so threads racing
+  on it all store the same value.
+**/
+STATIC CHECKSUM_KERNEL gChecksumKernel = ChecksumKernelAuto;
+
+/**
+  Check whether a kernel is built in and supported by the CPU
+**/
+STATIC
+BOOLEAN
+IsChecksumKernelSupported(
+  IN     CHECKSUM_KERNEL Kernel
+  )
+{
+  if (Kernel <= ChecksumKernelAuto || Kernel >= ChecksumKernelMax ||
+      gChecksumKernelOps[Kernel].pFletcher64Words == NULL) {
+    return FALSE;
+  }
+#ifdef CHECKSUM_X86_KERNELS
+  if (Kernel == ChecksumKernelAvx2) {
+    return CpuHasAvx2();
+  }
+#endif
+  return TRUE;
+}
+
+/**
+  Operations of the kernel in use
+**/
+STATIC
+CONST CHECKSUM_KERNEL_OPS *
+GetChecksumKernelOps(
+  )
+{
+  if (gChecksumKernel == ChecksumKernelAuto) {
+    ChecksumSelectKernel(ChecksumKernelAuto);
+  }
+  return &gChecksumKernelOps[gChecksumKernel];
+}
+
+/**
+  Select the kernel used by the checksum functions
+
+  @param[in] Kernel Kernel to use, ChecksumKernelAuto for the fastest supported one
+
+  @retval EFI_SUCCESS The kernel is used from now on
+  @retval EFI_INVALID_PARAMETER Kernel is not a valid kernel
+  @retval EFI_UNSUPPORTED The kernel is not built in or the CPU does not support it
+**/
+EFI_STATUS
+ChecksumSelectKernel(
+  IN     CHECKSUM_KERNEL Kernel
+  )
+{
+  INT32 Index = 0;
+
+  if (Kernel < ChecksumKernelAuto || Kernel >= ChecksumKernelMax) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if (Kernel == ChecksumKernelAuto) {
+    for (Index = ChecksumKernelMax - 1; Index > ChecksumKernelAuto; Index--) {
+      if (IsChecksumKernelSupported((CHECKSUM_KERNEL)Index)) {
+        gChecksumKernel = (CHECKSUM_KERNEL)Index;
+        NVDIMM_VERB("Checksum kernel %d selected", Index);
+        return EFI_SUCCESS;
+      }
+    }
+  }
+
+  if (!IsChecksumKernelSupported(Kernel)) {
+    return EFI_UNSUPPORTED;
+  }
+
+  gChecksumKernel = Kernel;
+  return EFI_SUCCESS;
+}
+
+/**
+  Get the kernel used by the checksum functions
+
+  @retval The kernel in use, never ChecksumKernelAuto
+**/
+CHECKSUM_KERNEL
+ChecksumGetKernel(
+  )
+{
+  GetChecksumKernelOps();
+  return gChecksumKernel;
+}
+
+/**
+  Start a Fletcher64 checksum
+
+  @param[out] pContext State of the checksum
+**/
+VOID
+Fletcher64Init(
+     OUT FLETCHER64_CONTEXT *pContext
+  )
+{
+  if (pContext == NULL) {
+    return;
+  }
+
+  ZeroMem(pContext, sizeof(*pContext));
+}
+
+/**
+  Add data to a Fletcher64 checksum. The data is taken as little endian 32-bit words,
+  a piece does not need to end on a word boundary.
+
+  @param[in, out] pContext State of the checksum
+  @param[in] pData Data to add, no alignment required
+  @param[in] Length Number of bytes to add
+**/
+VOID
+Fletcher64Update(
+  IN OUT FLETCHER64_CONTEXT *pContext,
+  IN     CONST VOID *pData,
+  IN     UINT64 Length
+  )
+{
+  CONST CHECKSUM_KERNEL_OPS *pOps = GetChecksumKernelOps();
+  CONST UINT8 *pBytes = pData;
+  UINT64 Words = 0;
+
+  if (pContext == NULL || pData == NULL) {
+    return;
+  }
+
+  // Complete the word the previous piece ended in
+  if (pContext->PendingLength > 0) {
+    while (pContext->PendingLength < sizeof(UINT32) && Length > 0) {
+      pContext->Pending[pContext->PendingLength++] = *pBytes++;
+      Length--;
+    }
+    if (pContext->PendingLength < sizeof(UINT32)) {
+      return;
+    }
+    Fletcher64Serial(pContext->Pending, 1, &pContext->Lo32, &pContext->Hi32);
+    pContext->PendingLength = 0;
+  }
+
+  Words = Length / sizeof(UINT32);
+  if (Words > 0) {
+    pOps->pFletcher64Words(pBytes, Words, &pContext->Lo32, &pContext->Hi32);
+    pBytes += Words * sizeof(UINT32);
+    Length -= Words * sizeof(UINT32);
+  }
+
+  while (Length > 0) {
+    pContext->Pending[pContext->PendingLength++] = *pBytes++;
+    Length--;
+  }
+}
+
+/**
+  Finish a Fletcher64 checksum. A last incomplete word is padded with zeros.
+
+  @param[in, out] pContext State of the checksum
+
+  @retval The checksum, the high 32 bits hold the sum of the running sums
+**/
+UINT64
+Fletcher64Final(
+  IN OUT FLETCHER64_CONTEXT *pContext
+  )
+{
+  if (pContext == NULL) {
+    return 0;
+  }
+
+  if (pContext->PendingLength > 0) {
+    ZeroMem(pContext->Pending + pContext->PendingLength, sizeof(UINT32) - pContext->PendingLength);
+    Fletcher64Serial(pContext->Pending, 1, &pContext->Lo32, &pContext->Hi32);
+    pContext->PendingLength = 0;
+  }
+
+  return (UINT64)pContext->Hi32 << 32 | pContext->Lo32;
+}
+
+/**
+  Fletcher64 checksum of a buffer
+
+  @param[in] pData Data to checksum
+  @param[in] Length Number of bytes
+
+  @retval The checksum
+**/
+UINT64
+Fletcher64(
+  IN     CONST VOID *pData,
+  IN     UINT64 Length
+  )
+{
+  FLETCHER64_CONTEXT Context;
+
+  Fletcher64Init(&Context);
+  Fletcher64Update(&Context, pData, Length);
+  return Fletcher64Final(&Context);
+}
+
+/**
+  Sum of a buffer taken as little endian 32-bit words, a last incomplete word
+  is padded with zeros. Sums of pieces starting on word boundaries add up.
+
+  @param[in] pData Data to sum
+  @param[in] Length Number of bytes
+
+  @retval The sum modulo 2^32
+**/
+UINT32
+ChecksumSum32(
+  IN     CONST VOID *pData,
+  IN     UINT64 Length
+  )
+{
+  // The low half of Fletcher64 is that sum
+  return (UINT32)Fletcher64(pData, Length);
+}
+
+/**
+  Sum of the bytes of a buffer. Sums of pieces add up.
+
+  @param[in] pData Data to sum
+  @param[in] Length Number of bytes
+
+  @retval The sum modulo 256
+**/
+UINT8
+ChecksumSum8(
+  IN     CONST VOID *pData,
+  IN     UINT64 Length
+  )
+{
+  if (pData == NULL) {
+    return 0;
+  }
+
+  return (UINT8)GetChecksumKernelOps()->pSum8Bytes(pData, Length);
+}
@@ -0,0 +1,137 @@
+/*
+ * Copyright (c) 2018, Intel Corporation.
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef _CHECKSUM_H_
+#define _CHECKSUM_H_
+
+#include <Uefi.h>
+#include <Types.h>
+
+/**
+  Implementations of the checksum kernels. AUTO picks the fastest one the CPU supports,
+  the vector kernels exist only in the OS build on x86-64.
+**/
+typedef enum {
+  ChecksumKernelAuto = 0,
+  ChecksumKernelPortable,
+  ChecksumKernelSse2,
+  ChecksumKernelAvx2,
+  ChecksumKernelMax
+} CHECKSUM_KERNEL;
+
+/**
+  Running state of a Fletcher64 checksum, the data may be fed in pieces of any size
+**/
+typedef struct _FLETCHER64_CONTEXT {
+  UINT32 Lo32;
+  UINT32 Hi32;
+  UINT8 Pending[sizeof(UINT32)];  //!< Bytes of a word not complete yet
+  UINT32 PendingLength;
+} FLETCHER64_CONTEXT;
+
+/**
+  Select the kernel used by the checksum functions
+
+  @param[in] Kernel Kernel to use, ChecksumKernelAuto for the fastest supported one
+
+  @retval EFI_SUCCESS The kernel is used from now on
+  @retval EFI_INVALID_PARAMETER Kernel is not a valid kernel
+  @retval EFI_UNSUPPORTED The kernel is not built in or the CPU does not support it
+**/
+EFI_STATUS
+ChecksumSelectKernel(
+  IN     CHECKSUM_KERNEL Kernel
+  );
+
+/**
+  Get the kernel used by the checksum functions
+
+  @retval The kernel in use, never ChecksumKernelAuto
+**/
+CHECKSUM_KERNEL
+ChecksumGetKernel(
+  );
+
+/**
+  Start a Fletcher64 checksum
+
+  @param[out] pContext State of the checksum
+**/
+VOID
+Fletcher64Init(
+     OUT FLETCHER64_CONTEXT *pContext
+  );
+
+/**
+  Add data to a Fletcher64 checksum. The data is taken as little endian 32-bit words,
+  a piece does not need to end on a word boundary.
+
+  @param[in, out] pContext State of the checksum
+  @param[in] pData Data to add, no alignment required
+  @param[in] Length Number of bytes to add
+**/
+VOID
+Fletcher64Update(
+  IN OUT FLETCHER64_CONTEXT *pContext,
+  IN     CONST VOID *pData,
+  IN     UINT64 Length
+  );
+
+/**
+  Finish a Fletcher64 checksum. A last incomplete word is padded with zeros.
+
+  @param[in, out] pContext State of the checksum
+
+  @retval The checksum, the high 32 bits hold the sum of the running sums
+**/
+UINT64
+Fletcher64Final(
+  IN OUT FLETCHER64_CONTEXT *pContext
+  );
+
+/**
+  Fletcher64 checksum of a buffer
+
+  @param[in] pData Data to checksum
+  @param[in] Length Number of bytes
+
+  @retval The checksum
+**/
+UINT64
+Fletcher64(
+  IN     CONST VOID *pData,
+  IN     UINT64 Length
+  );
+
+/**
+  Sum of a buffer taken as little endian 32-bit words, a last incomplete word
+  is padded with zeros. Sums of pieces starting on word boundaries add up.
+
+  @param[in] pData Data to sum
+  @param[in] Length Number of bytes
+
+  @retval The sum modulo 2^32
+**/
+UINT32
+ChecksumSum32(
+  IN     CONST VOID *pData,
+  IN     UINT64 Length
+  );
+
+/**
+  Sum of the bytes of a buffer. Sums of pieces add up.
+
+  @param[in] pData Data to sum
+  @param[in] Length Number of bytes
+
+  @retval The sum modulo 256
+**/
+UINT8
+ChecksumSum8(
+  IN     CONST VOID *pData,
+  IN     UINT64 Length
+  );
+
+#endif /** _CHECKSUM_H_ **/
@@ -5,15 +5,67 @@
 
 #include "DataSet.h"
 #include <Library/BaseMemoryLib.h>
+#include <Library/PrintLib.h>
 
 #define BOOL_TRUE_STR L"True"
 #define BOOL_FALSE_STR L"False"
 
+#define DATA_SET_ARENA_CHUNK_SIZE   (64 * 1024)
+#define DATA_SET_ARENA_ALIGN        8
+//Nodes with fewer children or keys than that are searched linearly
+#define DATA_SET_INDEX_MIN_ITEMS    8
+#define DATA_SET_INDEX_MIN_CAPACITY 16
+#define DATA_SET_PATH_BUFFER_LEN    256
+
+/*
+* Chunk of arena memory, the allocations follow the header
+*/
+typedef struct _DATA_SET_ARENA_CHUNK {
+  struct _DATA_SET_ARENA_CHUNK *Next;
+  UINT64 Reserved;    //keeps the allocations aligned
+}DATA_SET_ARENA_CHUNK;
+
+/*
+* Memory of the nodes, key/value pairs and names of a data set tree. Owned by the
+* root and released at once with it. Nodes and pairs freed ahead of the tree are
+* kept for reuse, names stay until the tree goes away.
+*/
+typedef struct _DATA_SET_ARENA {
+  DATA_SET_ARENA_CHUNK *Chunks;
+  UINT8 *Free;
+  UINTN Remaining;
+  VOID *FreeDataSets;
+  VOID *FreeKeyVals;
+}DATA_SET_ARENA;
+
+/*
+* Entry of a hashed child or key index. Children sharing a name are told apart by
+* their instance number, the entry of instance 0 counts them.
+*/
+typedef struct _DATA_SET_INDEX_ENTRY {
+  UINT32 Hash;
+  UINT32 Instance;
+  UINT32 InstanceCount;
+  CONST CHAR16 *Name;
+  VOID *Item;         //NULL marks an empty slot
+}DATA_SET_INDEX_ENTRY;
+
+/*
+* Open addressing hash table, built on first lookup once a node has enough items
+* and dropped whenever an item goes away.
+*/
+typedef struct _DATA_SET_INDEX {
+  DATA_SET_INDEX_ENTRY *Entries;
+  UINT32 Capacity;    //power of two
+  UINT32 Count;
+}DATA_SET_INDEX;
+
 typedef struct _KEY_VAL {
   LIST_ENTRY Link;
   KEY_VAL_INFO KeyValInfo;
   VOID *Value;
-  CHAR16 *ValueToString;
+  CHAR16 *ValueToString;  //formatted on first request, unless Value is a string
+  UINT64 InlineValue;     //storage of the numeric and boolean values
 }KEY_VAL;
 
 typedef struct _DATA_SET {
@@ -23,14 +75,15 @@ typedef struct _DATA_SET {
   VOID *DataSetParent;
   CHAR16 *Name;
   BOOLEAN Dirty;
+  BOOLEAN OwnsArena;
   VOID *UserData;
+  DATA_SET_ARENA *Arena;
+  UINT32 ChildCount;
+  UINT32 KeyCount;
+  DATA_SET_INDEX ChildIndex;
+  DATA_SET_INDEX KeyIndex;
 }DATA_SET;
 
-typedef struct _DS_NAME_INFO {
-  CHAR16 *Name;
-  UINT32 InstanceNum;
-}DS_NAME_INFO;
-
 #define DATA_SET_LIST_FOR_EACH_SAFE(Entry, NextEntry, ListHead) \
   for(Entry = (ListHead)->ForwardLink, NextEntry = Entry->ForwardLink; \
       Entry != (ListHead); \
@@ -48,19 +101,263 @@ do { \
     *RetVal = EFI_OUT_OF_RESOURCES; \
     break; \
   } \
-  KeyVal->ValueToString = CatSPrint(NULL, FormatString(ValTypeEnum, Base), *((ValType*)Val)); \
   KeyVal->KeyValInfo.Type = ValTypeEnum; \
+  KeyVal->KeyValInfo.Base = Base; \
   *RetVal = EFI_SUCCESS; \
 }while(0)
 
 VOID FreeAllKeyValuePairs(DATA_SET *DataSet);
+KEY_VAL * SetKeyValue(DATA_SET_CONTEXT *DataSetCtx, const CHAR16 *Key, VOID * Val, UINTN ValSize);
+
+/*
+* Create an arena for a new data set tree
+*/
+DATA_SET_ARENA * CreateDataSetArena() {
+  return (DATA_SET_ARENA*)AllocateZeroPool(sizeof(DATA_SET_ARENA));
+}
+
+/*
+* Release an arena and all the memory handed out from it
+*/
+VOID FreeDataSetArena(DATA_SET_ARENA *Arena) {
+  DATA_SET_ARENA_CHUNK *Chunk;
+
+  if (NULL == Arena) {
+    return;
+  }
+  while (NULL != (Chunk = Arena->Chunks)) {
+    Arena->Chunks = Chunk->Next;
+    FreePool(Chunk);
+  }
+  FreePool(Arena);
+}
+
+/*
+* Carve memory out of an arena. Requests too big to share a chunk get one of their
+* own, so the current chunk keeps its free space.
+*/
+VOID * DataSetArenaAlloc(DATA_SET_ARENA *Arena, UINTN Size) {
+  DATA_SET_ARENA_CHUNK *Chunk;
+  UINT8 *Mem;
+
+  Size = ALIGN_VALUE(Size, DATA_SET_ARENA_ALIGN);
+  if (Size > Arena->Remaining) {
+    if (Size > DATA_SET_ARENA_CHUNK_SIZE / 4) {
+      if (NULL == (Chunk = (DATA_SET_ARENA_CHUNK*)AllocatePool(sizeof(DATA_SET_ARENA_CHUNK) + Size))) {
+        return NULL;
+      }
+      if (NULL != Arena->Chunks) {
+        Chunk->Next = Arena->Chunks->Next;
+        Arena->Chunks->Next = Chunk;
+      }
+      else {
+        Chunk->Next = NULL;
+        Arena->Chunks = Chunk;
+      }
+      return (VOID*)(Chunk + 1);
+    }
+    if (NULL == (Chunk = (DATA_SET_ARENA_CHUNK*)AllocatePool(sizeof(DATA_SET_ARENA_CHUNK) + DATA_SET_ARENA_CHUNK_SIZE))) {
+      return NULL;
+    }
+    Chunk->Next = Arena->Chunks;
+    Arena->Chunks = Chunk;
+    Arena->Free = (UINT8*)(Chunk + 1);
+    Arena->Remaining = DATA_SET_ARENA_CHUNK_SIZE;
+  }
+  Mem = Arena->Free;
+  Arena->Free += Size;
+  Arena->Remaining -= Size;
+  return Mem;
+}
+
+/*
+* Get a zeroed object from an arena, reusing one from its free list if possible
+*/
+VOID * DataSetArenaAllocObject(DATA_SET_ARENA *Arena, VOID **FreeList, UINTN Size) {
+  VOID *Object = *FreeList;
+
+  if (NULL != Object) {
+    *FreeList = *(VOID**)Object;
+  }
+  else if (NULL == (Object = DataSetArenaAlloc(Arena, Size))) {
+    return NULL;
+  }
+  ZeroMem(Object, Size);
+  return Object;
+}
+
+/*
+* Put an object back on an arena free list
+*/
+VOID DataSetArenaRecycleObject(VOID **FreeList, VOID *Object) {
+  *(VOID**)Object = *FreeList;
+  *FreeList = Object;
+}
+
+/*
+* Copy a string into an arena
+*/
+CHAR16 * DataSetArenaStrDup(DATA_SET_ARENA *Arena, CONST CHAR16 *Str) {
+  UINTN Size = StrSize(Str);
+  CHAR16 *Copy;
+
+  if (NULL != (Copy = (CHAR16*)DataSetArenaAlloc(Arena, Size))) {
+    CopyMem(Copy, Str, Size);
+  }
+  return Copy;
+}
+
+/*
+* FNV-1a hash of a name, never 0
+*/
+UINT32 DataSetHashName(CONST CHAR16 *Name) {
+  UINT32 Hash = 2166136261u;
+
+  while (*Name) {
+    Hash ^= (UINT32)*Name++;
+    Hash *= 16777619u;
+  }
+  return Hash ? Hash : 1;
+}
+
+/*
+* Helper to locate the index entry of an item
+*/
+DATA_SET_INDEX_ENTRY * DataSetIndexFind(DATA_SET_INDEX *Index, CONST CHAR16 *Name, UINT32 Hash, UINT32 Instance) {
+  UINT32 Mask = Index->Capacity - 1;
+  UINT32 Slot = (Hash ^ (Instance * 0x9E3779B1u)) & Mask;
+  DATA_SET_INDEX_ENTRY *Entry;
+
+  if (NULL == Index->Entries) {
+    return NULL;
+  }
+  while (NULL != (Entry = &Index->Entries[Slot])->Item) {
+    if (Entry->Hash == Hash && Entry->Instance == Instance && 0 == StrCmp(Name, Entry->Name)) {
+      return Entry;
+    }
+    Slot = (Slot + 1) & Mask;
+  }
+  return NULL;
+}
+
+/*
+* Place an entry in the first free slot of its probe sequence
+*/
+DATA_SET_INDEX_ENTRY * DataSetIndexPlace(DATA_SET_INDEX *Index, DATA_SET_INDEX_ENTRY *NewEntry) {
+  UINT32 Mask = Index->Capacity - 1;
+  UINT32 Slot = (NewEntry->Hash ^ (NewEntry->Instance * 0x9E3779B1u)) & Mask;
+
+  while (NULL != Index->Entries[Slot].Item) {
+    Slot = (Slot + 1) & Mask;
+  }
+  Index->Entries[Slot] = *NewEntry;
+  ++Index->Count;
+  return &Index->Entries[Slot];
+}
+
+/*
+* Add an item to an index, growing it to keep the load under 3/4
+*/
+DATA_SET_INDEX_ENTRY * DataSetIndexInsert(DATA_SET_INDEX *Index, CONST CHAR16 *Name, UINT32 Hash, UINT32 Instance, VOID *Item) {
+  DATA_SET_INDEX_ENTRY NewEntry;
+  DATA_SET_INDEX_ENTRY *OldEntries = Index->Entries;
+  UINT32 OldCapacity = Index->Capacity;
+  UINT32 Slot = 0;
+
+  if ((Index->Count + 1) * 4 > Index->Capacity * 3) {
+    Index->Capacity = (0 == OldCapacity) ? DATA_SET_INDEX_MIN_CAPACITY : OldCapacity * 2;
+    if (NULL == (Index->Entries = AllocateZeroPool(Index->Capacity * sizeof(DATA_SET_INDEX_ENTRY)))) {
+      Index->Entries = OldEntries;
+      Index->Capacity = OldCapacity;
+      return NULL;
+    }
+    Index->Count = 0;
+    for (Slot = 0; Slot < OldCapacity; ++Slot) {
+      if (NULL != OldEntries[Slot].Item) {
+        DataSetIndexPlace(Index, &OldEntries[Slot]);
+      }
+    }
+    FREE_POOL_SAFE(OldEntries);
+  }
+
+  NewEntry.Hash = Hash;
+  NewEntry.Instance = Instance;
+  NewEntry.InstanceCount = 0;
+  NewEntry.Name = Name;
+  NewEntry.Item = Item;
+  return DataSetIndexPlace(Index, &NewEntry);
+}
+
+/*
+* Drop an index, it gets built again when needed
+*/
+VOID DataSetIndexFree(DATA_SET_INDEX *Index) {
+  FREE_POOL_SAFE(Index->Entries);
+  Index->Capacity = 0;
+  Index->Count = 0;
+}
+
+/*
+* Add a child, the last of its name, to the child index of its parent
+*/
+BOOLEAN ChildIndexAdd(DATA_SET *Parent, DATA_SET *Child) {
+  UINT32 Hash = DataSetHashName(Child->Name);
+  DATA_SET_INDEX_ENTRY *First;
+  UINT32 Instance = 0;
+
+  if (NULL != (First = DataSetIndexFind(&Parent->ChildIndex, Child->Name, Hash, 0))) {
+    Instance = First->InstanceCount++;
+  }
+  if (NULL == (First = DataSetIndexInsert(&Parent->ChildIndex, Child->Name, Hash, Instance, Child))) {
+    return FALSE;
+  }
+  if (0 == Instance) {
+    First->InstanceCount = 1;
+  }
+  return TRUE;
+}
+
+/*
+* Get the child index of a node, building it if the node has enough children.
+* Returns NULL when the children are to be searched linearly.
+*/
+DATA_SET_INDEX * GetChildIndex(DATA_SET *Parent) {
+  LIST_ENTRY  *Entry;
+  LIST_ENTRY  *NextEntry;
+
+  if (NULL == Parent->ChildIndex.Entries) {
+    if (Parent->ChildCount < DATA_SET_INDEX_MIN_ITEMS) {
+      return NULL;
+    }
+    DATA_SET_LIST_FOR_EACH_SAFE(Entry, NextEntry, &Parent->DataSetList) {
+      if (!ChildIndexAdd(Parent, BASE_CR(Entry, DATA_SET, Link))) {
+        DataSetIndexFree(&Parent->ChildIndex);
+        return NULL;
+      }
+    }
+  }
+  return &Parent->ChildIndex;
+}
+
+/*
+* Attach a new child as the last child of a node
+*/
+VOID LinkChildDataSet(DATA_SET *Parent, DATA_SET *Child) {
+  InsertTailList(&Parent->DataSetList, &Child->Link);
+  Child->DataSetParent = (VOID*)Parent;
+  ++Parent->ChildCount;
+  if (NULL != Parent->ChildIndex.Entries && !ChildIndexAdd(Parent, Child)) {
+    DataSetIndexFree(&Parent->ChildIndex);
+  }
+}
 
 /*
 * Set all data sets in the ancestry path to dirty.
 */
 VOID SetAncestorsDirty(DATA_SET_CONTEXT *DataSetCtx) {
   DATA_SET *DataSet = (DATA_SET*)DataSetCtx;
-  while (DataSet) {
+  //the ancestors of a dirty data set are dirty already
+  while (DataSet && !DataSet->Dirty) {
     DataSet->Dirty = TRUE;
     DataSet = DataSet->DataSetParent;
   }
@@ -73,6 +370,13 @@ DATA_SET * FindChildDataSetByIndex(DATA_SET *Parent, CHAR16 *Name, UINT32 Index)
   LIST_ENTRY  *Entry;
   LIST_ENTRY  *NextEntry;
   DATA_SET    *DataSet;
+  DATA_SET_INDEX *ChildIndex;
+  DATA_SET_INDEX_ENTRY *IndexEntry;
+
+  if (NULL != (ChildIndex = GetChildIndex(Parent))) {
+    IndexEntry = DataSetIndexFind(ChildIndex, Name, DataSetHashName(Name), Index);
+    return (NULL != IndexEntry) ? (DATA_SET*)IndexEntry->Item : NULL;
+  }
 
   DATA_SET_LIST_FOR_EACH_SAFE(Entry, NextEntry, &Parent->DataSetList) {
     DataSet = BASE_CR(Entry, DATA_SET, Link);
@@ -96,12 +400,15 @@ VOID FreeDataSetMem(DATA_SET *DataSet) {
     }
 
     FreeAllKeyValuePairs(DataSet);
+    DataSetIndexFree(&DataSet->ChildIndex);
 
-    if(DataSet->Name) {
-      FreePool(DataSet->Name);
+    //the name lives in the arena
+    if (DataSet->OwnsArena) {
+      FreeDataSetArena(DataSet->Arena);
+    }
+    else {
+      DataSetArenaRecycleObject(&DataSet->Arena->FreeDataSets, DataSet);
     }
-
-    FreePool(DataSet);
   }
 
 /*
@@ -111,6 +418,7 @@ VOID FreeAllDataSets(DATA_SET *DataSet) {
   LIST_ENTRY  *Entry;
   LIST_ENTRY  *NextEntry;
   DATA_SET *ChildDataSet;
+  DATA_SET *Parent;
 
   if (NULL == DataSet) {
     return;
@@ -122,6 +430,10 @@ VOID FreeAllDataSets(DATA_SET *DataSet) {
   }
   if(!IsListEmpty(&DataSet->Link)) {
     RemoveEntryList(&DataSet->Link);
+    if (NULL != (Parent = (DATA_SET*)DataSet->DataSetParent)) {
+      --Parent->ChildCount;
+      DataSetIndexFree(&Parent->ChildIndex);
+    }
   }
   FreeDataSetMem(DataSet);
 }
@@ -132,6 +444,7 @@ VOID FreeAllDataSets(DATA_SET *DataSet) {
 DATA_SET_CONTEXT* CreateDataSet(DATA_SET_CONTEXT *DataSetCtx, CHAR16 *Name, VOID *UserData) {
   DATA_SET *NewDataSet = NULL;
   DATA_SET *ParentCtx = (DATA_SET *)DataSetCtx;
+  DATA_SET_ARENA *Arena = NULL;
 
   if (NULL == Name) {
     return NULL;
@@ -141,15 +454,25 @@ DATA_SET_CONTEXT* CreateDataSet(DATA_SET_CONTEXT *DataSetCtx, CHAR16 *Name, VOID
     return NULL;
   }*/
 
-  if (NULL == (NewDataSet = (DATA_SET*)AllocateZeroPool(sizeof(DATA_SET)))) {
+  //a root brings the arena of its tree
+  if (ParentCtx) {
+    Arena = ParentCtx->Arena;
+  }
+  else if (NULL == (Arena = CreateDataSetArena())) {
     return NULL;
   }
 
-  if (NULL == (NewDataSet->Name = CatSPrint(NULL, Name))) {
-    FreePool(NewDataSet);
-    return NULL;
+  if (NULL == (NewDataSet = (DATA_SET*)DataSetArenaAllocObject(Arena, &Arena->FreeDataSets, sizeof(DATA_SET)))) {
+    goto Error;
+  }
+
+  if (NULL == (NewDataSet->Name = DataSetArenaStrDup(Arena, Name))) {
+    DataSetArenaRecycleObject(&Arena->FreeDataSets, NewDataSet);
+    goto Error;
   }
 
+  NewDataSet->Arena = Arena;
+  NewDataSet->OwnsArena = (NULL == ParentCtx);
   NewDataSet->UserData = UserData;
   InitializeListHead(&NewDataSet->KeyValueList);
   InitializeListHead(&NewDataSet->DataSetList);
@@ -157,50 +480,46 @@ DATA_SET_CONTEXT* CreateDataSet(DATA_SET_CONTEXT *DataSetCtx, CHAR16 *Name, VOID
   NewDataSet->Dirty = FALSE;
 
   if (DataSetCtx) {
-    InsertTailList(&ParentCtx->DataSetList, &NewDataSet->Link);
-    NewDataSet->DataSetParent = (VOID*)ParentCtx;
+    LinkChildDataSet(ParentCtx, NewDataSet);
   }
   else {
     InitializeListHead(&NewDataSet->Link);
   }
 
   return NewDataSet;
-}
 
-/*
-* Helper for GetDataSet
-*/
-VOID GetDataSetNameInfo(CHAR16 *Name, DS_NAME_INFO *NameInfo) {
-  CHAR16 **Toks = NULL;
-  CHAR16 **ToksSecondHalf;
-  UINT32 NumToks = 0;
-  UINT32 NumToksSecondHalf = 0;
-
-  if (NULL == (Toks = StrSplit(Name, L'[', &NumToks))) {
-    return;
-  }
-
-  if (1 == NumToks) {
-    NameInfo->Name = CatSPrint(NULL, Name);
-    NameInfo->InstanceNum = 0;
+Error:
+  if (NULL == ParentCtx) {
+    FreeDataSetArena(Arena);
   }
-  else {
-    NameInfo->Name = CatSPrint(NULL, Toks[0]);
-    if (NULL != (ToksSecondHalf = StrSplit(Toks[1], L']', &NumToksSecondHalf))) {
-      NameInfo->InstanceNum = (UINT32)StrDecimalToUint64(ToksSecondHalf[0]);
-      FreeStringArray(ToksSecondHalf, NumToksSecondHalf);
-    }
-  }
-  FreeStringArray(Toks, NumToks);
+  return NULL;
 }
 
 /*
-* Helper for GetDataSet.  Frees memory allocated by GetDataSetNameInfo.
+* Helper for GetDataSet. Cuts the next name off a path, terminating it in place.
+* Returns the rest of the path after the name, NULL if it was the last one.
 */
-void FreeDataSetNameInfo(DS_NAME_INFO *NameInfo) {
-  if (NULL != NameInfo->Name) {
-    FreePool(NameInfo->Name);
+CHAR16 * SplitDataSetPath(CHAR16 *Path, UINT32 *InstanceNum) {
+  CHAR16 *Rest = NULL;
+  CHAR16 *Instance = NULL;
+
+  *InstanceNum = 0;
+  for (; *Path != L'\0'; ++Path) {
+    if (*Path == L'/') {
+      *Path = L'\0';
+      Rest = Path + 1;
+      break;
+    }
+    //name[instance]
+    if (*Path == L'[' && NULL == Instance) {
+      *Path = L'\0';
+      Instance = Path + 1;
+    }
   }
+  if (NULL != Instance) {
+    *InstanceNum = (UINT32)StrDecimalToUint64(Instance);
+  }
+  return Rest;
 }
 
 /*
@@ -209,63 +528,65 @@ void FreeDataSetNameInfo(DS_NAME_INFO *NameInfo) {
 DATA_SET_CONTEXT *
 EFIAPI
 GetDataSet(DATA_SET_CONTEXT *Root, CHAR16 *NamePath, ...) {
-  CHAR16 **DataSetToks = NULL;
-  UINT32 NumDataSetToks = 0;
-  UINT32 Index = 0;
+  CHAR16 PathBuffer[DATA_SET_PATH_BUFFER_LEN];
+  CHAR16 *FormattedNamePath = PathBuffer;
+  CHAR16 *Name = NULL;
+  CHAR16 *Rest = NULL;
   DATA_SET *TempDataSet = (DATA_SET*)Root;
   DATA_SET *TempCreateNewDataSet = NULL;
-  DS_NAME_INFO NameInfo;
-  CHAR16 *FormattedNamePath;
   VA_LIST Args;
+  UINTN Length = 0;
+  UINT32 InstanceNum = 0;
   UINT32 CreateIndex = 0;
 
+  if (NULL == Root || NULL == NamePath) {
+    return NULL;
+  }
+
   ++NamePath;
   VA_START(Args, NamePath);
-  FormattedNamePath = CatVSPrint(NULL, NamePath, Args);
+  Length = UnicodeVSPrint(PathBuffer, sizeof(PathBuffer), NamePath, Args);
   VA_END(Args);
 
-  if (NULL == FormattedNamePath) {
-    return NULL;
-  }
-
-  //split path, result toks are data set names
-  if (NULL == (DataSetToks = StrSplit(FormattedNamePath, L'/', &NumDataSetToks))) {
-    FreePool(FormattedNamePath);
-    return NULL;
+  //paths that do not fit on the stack get formatted into pool memory
+  if (Length >= ARRAY_SIZE(PathBuffer) - 1) {
+    VA_START(Args, NamePath);
+    FormattedNamePath = CatVSPrint(NULL, NamePath, Args);
+    VA_END(Args);
+    if (NULL == FormattedNamePath) {
+      return NULL;
+    }
   }
-  FreePool(FormattedNamePath);
 
-  //Root data set must match first tok
-  //All other toks that don't exist will be created
-  GetDataSetNameInfo(DataSetToks[0], &NameInfo);
-  if (StrCmp(NameInfo.Name, GetDataSetName(Root))) {
+  //Root data set must match first name
+  //All other names that don't exist will be created
+  Name = FormattedNamePath;
+  Rest = SplitDataSetPath(Name, &InstanceNum);
+  if (StrCmp(Name, GetDataSetName(Root))) {
     TempDataSet = NULL;
-    FreeDataSetNameInfo(&NameInfo);
     goto Finish;
   }
-  FreeDataSetNameInfo(&NameInfo);
   //iterate through all data set names under the root
   //path: /sensorlist/dimm/sensor
-  //iterated toks: dimm, sensor
+  //iterated names: dimm, sensor
   //create data sets that don't exist
-  for (Index = 1; Index < NumDataSetToks; ++Index) {
-    //get info about current data set
-    GetDataSetNameInfo(DataSetToks[Index], &NameInfo);
-    for (CreateIndex = 0; CreateIndex <= NameInfo.InstanceNum; ++CreateIndex) {
-      if (NULL == (TempCreateNewDataSet = FindChildDataSetByIndex(TempDataSet, NameInfo.Name, NameInfo.InstanceNum))) {
+  while (NULL != (Name = Rest)) {
+    Rest = SplitDataSetPath(Name, &InstanceNum);
+    for (CreateIndex = 0; CreateIndex <= InstanceNum; ++CreateIndex) {
+      if (NULL == (TempCreateNewDataSet = FindChildDataSetByIndex(TempDataSet, Name, InstanceNum))) {
         //create a new data set and add it to the end
-        if (NULL == (TempCreateNewDataSet = CreateDataSet(TempDataSet, NameInfo.Name, NULL))) {
+        if (NULL == (TempCreateNewDataSet = CreateDataSet(TempDataSet, Name, NULL))) {
           TempDataSet = NULL;
-          FreeDataSetNameInfo(&NameInfo);
           goto Finish;
         }
       }
     }
-    FreeDataSetNameInfo(&NameInfo);
     TempDataSet = TempCreateNewDataSet;
   }
 Finish:
-  FreeStringArray(DataSetToks, NumDataSetToks);
+  if (FormattedNamePath != PathBuffer) {
+    FreePool(FormattedNamePath);
+  }
   return TempDataSet;
 }
 
@@ -297,6 +618,16 @@ DATA_SET_CONTEXT *GetNextChildDataSet(DATA_SET_CONTEXT *DataSetCtx, DATA_SET_CON
   return NULL;
 }
 
+/*
+* Get a child data set by name, Instance counting the children sharing it
+*/
+DATA_SET_CONTEXT *GetChildDataSet(DATA_SET_CONTEXT *DataSetCtx, CHAR16 *Name, UINT32 Instance) {
+  if (NULL == DataSetCtx || NULL == Name) {
+    return NULL;
+  }
+  return (DATA_SET_CONTEXT*)FindChildDataSetByIndex((DATA_SET *)DataSetCtx, Name, Instance);
+}
+
 /*
 * Does the data set contain children data sets?
 */
@@ -315,6 +646,19 @@ BOOLEAN IsLeaf(DATA_SET_CONTEXT *DataSetCtx) {
   return FALSE;
 }
 
+/*
+* Does the data set or any of its children contain key/val pairs?
+*/
+BOOLEAN IsDirty(DATA_SET_CONTEXT *DataSetCtx) {
+  DATA_SET *DataSet = (DATA_SET *)DataSetCtx;
+
+  if (NULL == DataSetCtx) {
+    return FALSE;
+  }
+
+  return DataSet->Dirty;
+}
+
 /*
 * Helper to walk a data set hierarchy
 */
@@ -373,7 +717,11 @@ VOID AddChildDataSet(DATA_SET_CONTEXT *Root, DATA_SET_CONTEXT *Child) {
   DATA_SET *RootDataSet = (DATA_SET*)Root;
   DATA_SET *ChildDataSet = (DATA_SET*)Child;
   if (NULL != Root && NULL != Child) {
-    InsertTailList(&RootDataSet->DataSetList, &ChildDataSet->Link);
+    //the child keeps its own arena, if any, and frees it along with itself
+    LinkChildDataSet(RootDataSet, ChildDataSet);
+    if (ChildDataSet->Dirty) {
+      SetAncestorsDirty(RootDataSet);
+    }
   }
 }
 
@@ -382,11 +730,16 @@ VOID AddChildDataSet(DATA_SET_CONTEXT *Root, DATA_SET_CONTEXT *Child) {
 */
 VOID SetDataSetName(DATA_SET_CONTEXT *DataSetCtx, CHAR16 *Name) {
   DATA_SET *DataSet = (DATA_SET*)DataSetCtx;
-  if (DataSet) {
-    if (DataSet->Name) {
-      FreePool(DataSet->Name);
+  CHAR16 *NewName = NULL;
+  if (DataSet && Name) {
+    //the previous name stays in the arena until the tree is freed
+    if (NULL == (NewName = DataSetArenaStrDup(DataSet->Arena, Name))) {
+      return;
+    }
+    DataSet->Name = NewName;
+    if (NULL != DataSet->DataSetParent) {
+      DataSetIndexFree(&((DATA_SET*)DataSet->DataSetParent)->ChildIndex);
     }
-    DataSet->Name = CatSPrint(NULL, Name);
   }
 }
 
@@ -516,6 +869,31 @@ CHAR16 * FormatString(KEY_TYPE KeyType, TO_STRING_BASE Base) {
   }
 }
 
+/*
+* Get the key index of a node, building it if the node has enough keys.
+* Returns NULL when the keys are to be searched linearly.
+*/
+DATA_SET_INDEX * GetKeyIndex(DATA_SET *DataSet) {
+  LIST_ENTRY  *Entry;
+  LIST_ENTRY  *NextEntry;
+  KEY_VAL *KeyVal;
+
+  if (NULL == DataSet->KeyIndex.Entries) {
+    if (DataSet->KeyCount < DATA_SET_INDEX_MIN_ITEMS) {
+      return NULL;
+    }
+    DATA_SET_LIST_FOR_EACH_SAFE(Entry, NextEntry, &DataSet->KeyValueList) {
+      KeyVal = BASE_CR(Entry, KEY_VAL, Link);
+      if (NULL == DataSetIndexInsert(&DataSet->KeyIndex, KeyVal->KeyValInfo.Key,
+        DataSetHashName(KeyVal->KeyValInfo.Key), 0, KeyVal)) {
+        DataSetIndexFree(&DataSet->KeyIndex);
+        return NULL;
+      }
+    }
+  }
+  return &DataSet->KeyIndex;
+}
+
 /*
 * Helper to locate a child node with a particular name
 */
@@ -523,6 +901,13 @@ KEY_VAL * FindKeyValuePair(DATA_SET *DataSet, const CHAR16 *Key) {
   LIST_ENTRY  *Entry;
   LIST_ENTRY  *NextEntry;
   KEY_VAL *KeyVal;
+  DATA_SET_INDEX *KeyIndex;
+  DATA_SET_INDEX_ENTRY *IndexEntry;
+
+  if (NULL != (KeyIndex = GetKeyIndex(DataSet))) {
+    IndexEntry = DataSetIndexFind(KeyIndex, Key, DataSetHashName(Key), 0);
+    return (NULL != IndexEntry) ? (KEY_VAL*)IndexEntry->Item : NULL;
+  }
 
   DATA_SET_LIST_FOR_EACH_SAFE(Entry, NextEntry, &DataSet->KeyValueList) {
     KeyVal = BASE_CR(Entry, KEY_VAL, Link);
@@ -534,25 +919,32 @@ KEY_VAL * FindKeyValuePair(DATA_SET *DataSet, const CHAR16 *Key) {
 }
 
 /*
-* Free a single KeyVal Struct
+* Free the value of a key and its string form
 */
-VOID FreeKeyValMem(KEY_VAL *KeyVal) {
-  if (NULL == KeyVal) {
-    return;
-  }
-  if (KeyVal->KeyValInfo.Key) {
-    FreePool(KeyVal->KeyValInfo.Key);
-  }
+VOID FreeKeyValValue(KEY_VAL *KeyVal) {
   if ((KeyVal->ValueToString) && (KeyVal->ValueToString != KeyVal->Value)) {
     FreePool(KeyVal->ValueToString);
   }
-  if (KeyVal->Value) {
+  if ((KeyVal->Value) && (KeyVal->Value != &KeyVal->InlineValue)) {
     FreePool(KeyVal->Value);
   }
+  KeyVal->ValueToString = NULL;
+  KeyVal->Value = NULL;
+}
+
+/*
+* Free a single KeyVal Struct
+*/
+VOID FreeKeyValMem(DATA_SET *DataSet, KEY_VAL *KeyVal) {
+  if (NULL == KeyVal) {
+    return;
+  }
+  //the key lives in the arena
+  FreeKeyValValue(KeyVal);
   if (KeyVal->KeyValInfo.UserData) {
     FreePool(KeyVal->KeyValInfo.UserData);
   }
-  FreePool(KeyVal);
+  DataSetArenaRecycleObject(&DataSet->Arena->FreeKeyVals, KeyVal);
 }
 
 /*
@@ -566,23 +958,94 @@ VOID FreeAllKeyValuePairs(DATA_SET *DataSet) {
   DATA_SET_LIST_FOR_EACH_SAFE(Entry, NextEntry, &DataSet->KeyValueList) {
     KeyVal = BASE_CR(Entry, KEY_VAL, Link);
     RemoveEntryList(&KeyVal->Link);
-    FreeKeyValMem(KeyVal);
+    FreeKeyValMem(DataSet, KeyVal);
   }
+  DataSet->KeyCount = 0;
+  DataSetIndexFree(&DataSet->KeyIndex);
 }
 
 /*
 * Create a new keyval struct
 */
-KEY_VAL * CreateKeyVal(DATA_SET_CONTEXT *DataSetCtx) {
+KEY_VAL * CreateKeyVal(DATA_SET_CONTEXT *DataSetCtx, const CHAR16 *Key) {
   DATA_SET *DataSet = (DATA_SET*)DataSetCtx;
-  KEY_VAL *KeyVal = (KEY_VAL*)AllocateZeroPool(sizeof(KEY_VAL));
+  DATA_SET_ARENA *Arena = DataSet->Arena;
+  KEY_VAL *KeyVal = (KEY_VAL*)DataSetArenaAllocObject(Arena, &Arena->FreeKeyVals, sizeof(KEY_VAL));
   if(NULL == KeyVal) {
     return NULL;
   }
+  if (NULL == (KeyVal->KeyValInfo.Key = DataSetArenaStrDup(Arena, Key))) {
+    DataSetArenaRecycleObject(&Arena->FreeKeyVals, KeyVal);
+    return NULL;
+  }
   InsertTailList(&DataSet->KeyValueList, &KeyVal->Link);
+  ++DataSet->KeyCount;
+  if (NULL != DataSet->KeyIndex.Entries &&
+    NULL == DataSetIndexInsert(&DataSet->KeyIndex, KeyVal->KeyValInfo.Key, DataSetHashName(Key), 0, KeyVal)) {
+    DataSetIndexFree(&DataSet->KeyIndex);
+  }
+  return KeyVal;
+}
+
+/*
+* Find a key, or create it if it does not exist yet, and free its previous value
+*/
+KEY_VAL * GetKeyValForUpdate(DATA_SET *DataSet, const CHAR16 *Key) {
+  KEY_VAL *KeyVal = NULL;
+
+  if (NULL == (KeyVal = FindKeyValuePair(DataSet, Key))) {
+    return CreateKeyVal(DataSet, Key);
+  }
+  FreeKeyValValue(KeyVal);
   return KeyVal;
 }
 
+/*
+* Get the string form of a value, formatting it on first use
+*/
+CHAR16 * GetKeyValToString(KEY_VAL *KeyVal) {
+  CHAR16 *Format = NULL;
+
+  if (NULL != KeyVal->ValueToString || NULL == KeyVal->Value) {
+    return KeyVal->ValueToString;
+  }
+
+  //integers smaller than an int are promoted when passed as variable arguments
+  Format = FormatString(KeyVal->KeyValInfo.Type, KeyVal->KeyValInfo.Base);
+  switch (KeyVal->KeyValInfo.Type) {
+  case KEY_BOOL:
+    KeyVal->ValueToString = CatSPrint(NULL, *((BOOLEAN*)KeyVal->Value) ? BOOL_TRUE_STR : BOOL_FALSE_STR);
+    break;
+  case KEY_UINT64:
+    KeyVal->ValueToString = CatSPrint(NULL, Format, *((UINT64*)KeyVal->Value));
+    break;
+  case KEY_INT64:
+    KeyVal->ValueToString = CatSPrint(NULL, Format, *((INT64*)KeyVal->Value));
+    break;
+  case KEY_UINT32:
+    KeyVal->ValueToString = CatSPrint(NULL, Format, *((UINT32*)KeyVal->Value));
+    break;
+  case KEY_INT32:
+    KeyVal->ValueToString = CatSPrint(NULL, Format, *((INT32*)KeyVal->Value));
+    break;
+  case KEY_UINT16:
+    KeyVal->ValueToString = CatSPrint(NULL, Format, *((UINT16*)KeyVal->Value));
+    break;
+  case KEY_INT16:
+    KeyVal->ValueToString = CatSPrint(NULL, Format, *((INT16*)KeyVal->Value));
+    break;
+  case KEY_UINT8:
+    KeyVal->ValueToString = CatSPrint(NULL, Format, *((UINT8*)KeyVal->Value));
+    break;
+  case KEY_INT8:
+    KeyVal->ValueToString = CatSPrint(NULL, Format, *((INT8*)KeyVal->Value));
+    break;
+  default:
+    break;
+  }
+  return KeyVal->ValueToString;
+}
+
 /*
 * Set a unicode string value
 */
@@ -619,22 +1082,8 @@ EFI_STATUS SetKeyValueWideStr(DATA_SET_CONTEXT *DataSetCtx, const CHAR16 *Key, c
   }
 
   //first try to find the key, but if not found create a new key/value entry
-  //and set the name of the key
-  if (NULL == (KeyVal = FindKeyValuePair(DataSet, Key))) {
-    if (NULL == (KeyVal = CreateKeyVal(DataSet))) {
-      return EFI_OUT_OF_RESOURCES;
-    }
-    KeyVal->KeyValInfo.Key = CatSPrint(NULL, Key);
-  }
-  //found the key, now free previous values (tostring and actual value)
-  else {
-    if ((KeyVal->ValueToString) && (KeyVal->ValueToString != KeyVal->Value)) {
-      FreePool(KeyVal->ValueToString);
-    }
-
-    if (KeyVal->Value) {
-      FreePool(KeyVal->Value);
-    }
+  if (NULL == (KeyVal = GetKeyValForUpdate(DataSet, Key))) {
+    return EFI_OUT_OF_RESOURCES;
   }
 
   if (NULL == (KeyVal->Value = AllocatePool(StrSize(Val)))) {
@@ -642,6 +1091,7 @@ EFI_STATUS SetKeyValueWideStr(DATA_SET_CONTEXT *DataSetCtx, const CHAR16 *Key, c
   }
   CopyMem(KeyVal->Value, (VOID*)Val, StrSize(Val));
   KeyVal->ValueToString = KeyVal->Value;
+  KeyVal->KeyValInfo.Type = KEY_W_STR;
   SetAncestorsDirty(DataSetCtx);
   return EFI_SUCCESS;
 }
@@ -660,7 +1110,7 @@ EFI_STATUS GetKeyValueWideStr(DATA_SET_CONTEXT *DataSetCtx, const CHAR16 *Key, C
     *Val = DefaultVal;
   }
   else {
-    *Val = KeyVal->ValueToString;
+    *Val = GetKeyValToString(KeyVal);
   }
   return EFI_SUCCESS;
 }
@@ -676,25 +1126,15 @@ KEY_VAL * SetKeyValue(DATA_SET_CONTEXT *DataSetCtx, const CHAR16 *Key, VOID * Va
     return NULL;
   }
 
-  if (NULL == (KeyVal = FindKeyValuePair(DataSet, Key))) {
-    if (NULL == (KeyVal = CreateKeyVal(DataSet))) {
-      return NULL;
-    }
-    KeyVal->KeyValInfo.Key = CatSPrint(NULL, Key);
-  }
-  else {
-    if ((KeyVal->ValueToString) && (KeyVal->ValueToString != KeyVal->Value)) {
-      FreePool(KeyVal->ValueToString);
-    }
-
-    if (KeyVal->Value) {
-      FreePool(KeyVal->Value);
-    }
+  if (NULL == (KeyVal = GetKeyValForUpdate(DataSet, Key))) {
+    return NULL;
   }
-  KeyVal->Value = AllocatePool(ValSize);
-  if(KeyVal->Value) {
-    CopyMem(KeyVal->Value, Val, ValSize);
+  //values are primitive types, at most 64 bits
+  if (ValSize > sizeof(KeyVal->InlineValue)) {
+    return NULL;
   }
+  KeyVal->Value = &KeyVal->InlineValue;
+  CopyMem(KeyVal->Value, Val, ValSize);
   KeyVal->KeyValInfo.ValueSize = (UINT32)ValSize;
 
   SetAncestorsDirty(DataSetCtx);
@@ -732,32 +1172,18 @@ EFI_STATUS GetKeyValue(DATA_SET_CONTEXT *DataSetCtx, const CHAR16 *Key, VOID *Va
 EFI_STATUS SetKeyValueBool(DATA_SET_CONTEXT *DataSetCtx, const CHAR16 *Key, BOOLEAN Val) {
   DATA_SET *DataSet = (DATA_SET*)DataSetCtx;
   KEY_VAL *KeyVal = NULL;
-  const CHAR16 *BoolVal = Val ? BOOL_TRUE_STR : BOOL_FALSE_STR;
 
   if (NULL == Key || NULL == DataSet) {
     return EFI_INVALID_PARAMETER;
   }
 
-  if (NULL == (KeyVal = FindKeyValuePair(DataSet, Key))) {
-    if (NULL == (KeyVal = CreateKeyVal(DataSet))) {
-      return EFI_OUT_OF_RESOURCES;
-    }
-    KeyVal->KeyValInfo.Key = CatSPrint(NULL, Key);
-  }
-  else {
-    if ((KeyVal->ValueToString) && (KeyVal->ValueToString != KeyVal->Value)) {
-      FreePool(KeyVal->ValueToString);
-    }
-
-    if (KeyVal->Value) {
-      FreePool(KeyVal->Value);
-    }
-  }
-  if (NULL == (KeyVal->Value = AllocatePool(sizeof(BOOLEAN)))) {
+  if (NULL == (KeyVal = GetKeyValForUpdate(DataSet, Key))) {
     return EFI_OUT_OF_RESOURCES;
   }
+  KeyVal->Value = &KeyVal->InlineValue;
   CopyMem(KeyVal->Value, (VOID*)&Val, sizeof(BOOLEAN));
-  KeyVal->ValueToString = CatSPrint(NULL, BoolVal);
+  KeyVal->KeyValInfo.Type = KEY_BOOL;
+  KeyVal->KeyValInfo.ValueSize = sizeof(BOOLEAN);
   SetAncestorsDirty(DataSetCtx);
   return EFI_SUCCESS;
 }
@@ -914,13 +1340,13 @@ KEY_VAL_INFO * GetNextKey(DATA_SET_CONTEXT *DataSetCtx, KEY_VAL_INFO *KeyInfo) {
     return &KeyVal->KeyValInfo;
   }
 
-  if (NULL != (KeyVal = FindKeyValuePair(DataSet, KeyInfo->Key))) {
-    if (NULL != (Entry = GetNextNode(&DataSet->KeyValueList, &KeyVal->Link))) {
-      //GetNextNode returns original list when Link is the last node in list.
-      if (Entry != &DataSet->KeyValueList) {
-        KeyVal = BASE_CR(Entry, KEY_VAL, Link);
-        return &KeyVal->KeyValInfo;
-      }
+  //KeyInfo is the one returned by the previous call, part of its key/val pair
+  KeyVal = BASE_CR(KeyInfo, KEY_VAL, KeyValInfo);
+  if (NULL != (Entry = GetNextNode(&DataSet->KeyValueList, &KeyVal->Link))) {
+    //GetNextNode returns original list when Link is the last node in list.
+    if (Entry != &DataSet->KeyValueList) {
+      KeyVal = BASE_CR(Entry, KEY_VAL, Link);
+      return &KeyVal->KeyValInfo;
     }
   }
   return NULL;
@@ -930,14 +1356,13 @@ KEY_VAL_INFO * GetNextKey(DATA_SET_CONTEXT *DataSetCtx, KEY_VAL_INFO *KeyInfo) {
 * Get the number of key/val pairs in a data set.
 */
 UINT32 GetKeyCount(DATA_SET_CONTEXT *DataSetCtx) {
-  KEY_VAL_INFO * pKeyInfo = NULL;
-  UINT32 Count = 0;
+  DATA_SET *DataSet = (DATA_SET *)DataSetCtx;
 
-  while (NULL != (pKeyInfo = GetNextKey(DataSetCtx, pKeyInfo))) {
-    ++Count;
+  if (NULL == DataSet) {
+    return 0;
   }
 
-  return Count;
+  return DataSet->KeyCount;
 }
 
 /*
@@ -64,6 +64,7 @@ typedef struct _KEY_VAL_INFO {
   KEY_TYPE Type;      //type of value associated with a particular key
   CHAR16 *Key;        //the name associated with a particular value
   UINT32 ValueSize;   //the binary size of the value
+  TO_STRING_BASE Base;//base numeric values are displayed in
   VOID *UserData;     //user data
 }KEY_VAL_INFO;
 
@@ -87,10 +88,18 @@ DATA_SET_CONTEXT *CreateDataSet(DATA_SET_CONTEXT *DataSetCtx, CHAR16 *Name, VOID
 */
 DATA_SET_CONTEXT *GetNextChildDataSet(DATA_SET_CONTEXT *DataSetCtx, DATA_SET_CONTEXT *CurrentChildDataSetCtx);
 /*
+* Get a child data set by name, Instance counting the children sharing it.
+*/
+DATA_SET_CONTEXT *GetChildDataSet(DATA_SET_CONTEXT *DataSetCtx, CHAR16 *Name, UINT32 Instance);
+/*
 * Does the data set contain children data sets?
 */
 BOOLEAN IsLeaf(DATA_SET_CONTEXT *DataSetCtx);
 /*
+* Does the data set or any of its children contain key/val pairs?
+*/
+BOOLEAN IsDirty(DATA_SET_CONTEXT *DataSetCtx);
+/*
 * Free a data set structure
 */
 VOID FreeDataSet(DATA_SET_CONTEXT *DataSetCtx);
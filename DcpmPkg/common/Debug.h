@@ -89,42 +89,42 @@ static INLINE CHAR16 *FileFromPath(CHAR16 *path)
 #ifdef DEBUG_BUILD
 #if defined(_MSC_VER) || defined(__GNUC__)
 #define NVDIMM_ENTRY() \
-DebugPrint(EFI_D_VERBOSE, "NVDIMM-VERB:Entering %s::%s()\n", \
+OS_DEBUG_PRINT(EFI_D_VERBOSE, "NVDIMM-VERB:Entering %s::%s()\n", \
            FileFromPath(__FILE__), __FUNCTION__)
 #define NVDIMM_EXIT() \
-DebugPrint(EFI_D_VERBOSE, "NVDIMM-VERB:Exiting %s::%s()\n", \
+OS_DEBUG_PRINT(EFI_D_VERBOSE, "NVDIMM-VERB:Exiting %s::%s()\n", \
            FileFromPath(__FILE__), __FUNCTION__)
 #define NVDIMM_EXIT_I(rc) \
-DebugPrint(EFI_D_VERBOSE, "NVDIMM-VERB:Exiting %s::%s(): 0x%x\n", \
+OS_DEBUG_PRINT(EFI_D_VERBOSE, "NVDIMM-VERB:Exiting %s::%s(): 0x%x\n", \
            FileFromPath(__FILE__), __FUNCTION__, rc)
 #define NVDIMM_EXIT_I64(rc) \
-DebugPrint(EFI_D_VERBOSE, "NVDIMM-VERB:Exiting %s::%s(): 0x%x\n", \
+OS_DEBUG_PRINT(EFI_D_VERBOSE, "NVDIMM-VERB:Exiting %s::%s(): 0x%x\n", \
            FileFromPath(__FILE__), __FUNCTION__, rc)
 #define NVDIMM_EXIT_CHECK_I64(rc) \
 if(rc) { \
-DebugPrint(EFI_D_VERBOSE, "NVDIMM-VERB:Exiting %s::%s(): 0x%x\n", \
+OS_DEBUG_PRINT(EFI_D_VERBOSE, "NVDIMM-VERB:Exiting %s::%s(): 0x%x\n", \
            FileFromPath(__FILE__), __FUNCTION__, rc); \
 }
 #else
 #define NVDIMM_ENTRY() \
-DebugPrint(EFI_D_VERBOSE, "NVDIMM-VERB:Entering %s::%s()\n", \
+OS_DEBUG_PRINT(EFI_D_VERBOSE, "NVDIMM-VERB:Entering %s::%s()\n", \
   FileFromPath(__FILE__), __FUNCTION__); \
   RegisterStackTrace((FileFromPath(__FILE__)), (__FUNCTION__))
 #define NVDIMM_EXIT() \
-DebugPrint(EFI_D_VERBOSE, "NVDIMM-VERB:Exiting %s::%s()\n", \
+OS_DEBUG_PRINT(EFI_D_VERBOSE, "NVDIMM-VERB:Exiting %s::%s()\n", \
   FileFromPath(__FILE__), __FUNCTION__); \
   PopStackTrace()
 #define NVDIMM_EXIT_I(rc) \
-DebugPrint(EFI_D_VERBOSE, "NVDIMM-VERB:Exiting %s::%s(): 0x%x\n", \
+OS_DEBUG_PRINT(EFI_D_VERBOSE, "NVDIMM-VERB:Exiting %s::%s(): 0x%x\n", \
   FileFromPath(__FILE__), __FUNCTION__, rc); \
   PopStackTrace()
 #define NVDIMM_EXIT_I64(rc) \
-DebugPrint(EFI_D_VERBOSE, "NVDIMM-VERB:Exiting %s::%s(): 0x%x\n", \
+OS_DEBUG_PRINT(EFI_D_VERBOSE, "NVDIMM-VERB:Exiting %s::%s(): 0x%x\n", \
   FileFromPath(__FILE__), __FUNCTION__, rc); \
   PopStackTrace()
 #define NVDIMM_EXIT_CHECK_I64(rc) \
 if(rc) { \
-DebugPrint(EFI_D_VERBOSE, "NVDIMM-VERB:Exiting %s::%s(): 0x%x\n", \
+OS_DEBUG_PRINT(EFI_D_VERBOSE, "NVDIMM-VERB:Exiting %s::%s(): 0x%x\n", \
            FileFromPath(__FILE__), __FUNCTION__, rc); \
 } \
   PopStackTrace()
@@ -9,6 +9,7 @@
 #include <Library/BaseMemoryLib.h>
 #include "FwUtility.h"
 #include "Utility.h"
+#include "Checksum.h"
 #include <Library/UefiLib.h>
 #include "Debug.h"
 #include "Version.h"
@@ -377,16 +378,11 @@ UINT32 RunningChecksum(
   IN UINT32 Csum)
 
 {
-  UINT32 Index;
-  UINT8 *pU8Buffer;
-
   Csum = (~(Csum) + 1);
 
-  pU8Buffer = pBuffer;
+  // Byte Index weighs 1 << (8 * (Index % 4)), which makes a sum of little endian words
+  Csum = Csum + ChecksumSum32(pBuffer, NumBytes);
 
-  for (Index = 0; Index < NumBytes; Index++) {
-    Csum = Csum + pU8Buffer[Index] * (1 << (8 * (Index % 4)));
-  }
   Csum = ~(Csum) + 1;
   return Csum;
 }
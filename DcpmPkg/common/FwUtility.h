@@ -7,6 +7,7 @@
 #define _FWUTILITY_H_
 
 #include "NvmTypes.h"
+#include "NvmStatus.h"
 
 #define MAX_FIRMWARE_IMAGE_SIZE_KB 788
 #define FIRMWARE_RECOVERY_IMAGE_SPI_GEN1_SIZE_KB 1024
@@ -84,9 +85,12 @@ typedef struct {
   // Additional buffer for potential OS special passthrough
   // See use of SubopExtVendorSpecific in PassThru()
   UINT8 InputPayload[IN_PAYLOAD_SIZE + IN_PAYLOAD_SIZE_EXT_PAD];
-  UINT8 LargeInputPayload[IN_MB_SIZE];
+  // Large mailboxes are not carried inline. When a Large*PayloadSize is set,
+  // the matching pointer must reference a buffer of at least that many bytes,
+  // usually lent by AcquireLargePayloadBuffer().
+  UINT8 *LargeInputPayload;
   UINT8 OutPayload[OUT_PAYLOAD_SIZE];
-  UINT8 LargeOutputPayload[OUT_MB_SIZE];
+  UINT8 *LargeOutputPayload;
   UINT32 DimmID;
   UINT8 Opcode;
   UINT8 SubOpcode;
@@ -98,6 +102,31 @@ typedef struct {
 
 #pragma pack(pop)
 
+#ifdef OS_BUILD
+#define FW_CMD_STATS_STATUS_BUCKETS   32  //!< One per FIS status code, the last one also counts the codes above it
+#define FW_CMD_STATS_LATENCY_BUCKETS  32  //!< Bucket N counts latencies of [2^N, 2^(N+1)) us, bucket 0 also the ones below 1 us
+
+/**
+  Counters of the firmware commands of one opcode/subopcode sent to a PMem module,
+  collected by the OS passthrough while FW_CMD_STATS_ENABLED is set
+**/
+typedef struct _FW_CMD_STATS {
+  UINT32 DimmHandle;                                //!< NFIT device handle of the PMem module
+  UINT8 Opcode;
+  UINT8 SubOpcode;
+  UINT64 Calls;                                     //!< Commands sent
+  UINT64 Retries;                                   //!< DSM retries suggested by the platform, not included in Calls
+  UINT64 Errors;                                    //!< Commands that failed
+  UINT64 BytesIn;                                   //!< Small and large input payload bytes sent
+  UINT64 BytesOut;                                  //!< Small and large output payload bytes received
+  UINT64 TotalUs;                                   //!< Sum of the latencies
+  UINT64 MinUs;
+  UINT64 MaxUs;
+  UINT64 FisStatus[FW_CMD_STATS_STATUS_BUCKETS];    //!< Commands per FIS mailbox status code
+  UINT64 LatencyUs[FW_CMD_STATS_LATENCY_BUCKETS];   //!< Log2 latency histogram
+} FW_CMD_STATS;
+#endif // OS_BUILD
+
 /**
   Version struct definition
 **/
@@ -287,6 +316,30 @@ typedef struct {
   UINT32 Size;          //!< Size of entire module (header, crypto, data) in DWORDs
 } NVM_FW_IMAGE_INFO;
 
+/**
+  Steps of the firmware update of a PMem module, see FW_UPDATE_STATUS
+**/
+typedef enum _FW_UPDATE_STATE {
+  FwUpdateStateNone = 0,    //!< No update attempted since the driver was loaded
+  FwUpdateStateQueued,      //!< Image accepted for the module, transfer not started yet
+  FwUpdateStateTransfer,    //!< Sending the image
+  FwUpdateStateVerify,      //!< Image sent, firmware authenticating and staging it (long operation)
+  FwUpdateStateStaged,      //!< Image staged, activated on the next reset
+  FwUpdateStateFailed       //!< Update failed, see NvmStatus
+} FW_UPDATE_STATE;
+
+/**
+  Progress and timing of the firmware update of a PMem module
+**/
+typedef struct _FW_UPDATE_STATUS {
+  UINT8 State;              //!< FW_UPDATE_STATE
+  UINT8 Progress;           //!< Percent of the image sent
+  UINT16 ArsRetries;        //!< Packets resent after ARS kept the module busy
+  NVM_STATUS NvmStatus;     //!< Outcome, once Staged or Failed
+  UINT64 TransferTimeMs;    //!< Time spent sending the image, 0 if not measured
+  UINT64 StageTimeMs;       //!< Time from the end of the transfer until GetFwUpdateStatus() saw the image staged, 0 if not measured
+} FW_UPDATE_STATUS;
+
 /**
   The persistent memory module type code (taken from FW image)
 **/
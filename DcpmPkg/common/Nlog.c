@@ -4,6 +4,164 @@
 */
 
 #include "Nlog.h"
+#include <Library/BaseMemoryLib.h>
+#include <Library/PrintLib.h>
+
+#define NLOG_V2_MAGIC_NUMBER        11928997
+#define NLOG_SECTION_SIZE           256
+#define NLOG_STREAM_CHUNK_SIZE      (1024 * 1024)
+#define NLOG_TIMESTAMP_WIDTH        28
+#define NLOG_FILE_NAME_WIDTH        27
+#define NLOG_LOG_LEVEL_WIDTH        7
+#define NLOG_TIME_STR_LEN           128
+#define NLOG_V1_MAX_ARGS            0xFF
+#define NLOG_V1_FORMAT_HEAD         "V1 Log module: 0x%X, line: %d, args: "
+#define NLOG_V1_FORMAT_ARG          "0x%X "
+#define NLOG_V1_FORMAT_LEN          (sizeof(NLOG_V1_FORMAT_HEAD) + (NLOG_V1_MAX_ARGS * (sizeof(NLOG_V1_FORMAT_ARG) - 1)))
+#define NLOG_INDEX_MIN_BITS         4
+#define NLOG_DECODE_HEADER          "TIMESTAMP ::              FILE           ::   LEVEL :: LOG\n" \
+                                    "=====================================================================================\n"
+
+/*
+Decoded output waiting to be written, flushed in NLOG_STREAM_CHUNK_SIZE chunks
+to a file kept open for the whole decode
+*/
+typedef struct {
+  CHAR16* FileName;
+  CHAR8* Buffer;
+  UINT64 Used;
+  DUMP_FILE_HANDLE File;
+  EFI_STATUS Status;
+} nlog_stream;
+
+/*
+Writes a block to the output file, the first one replaces any existing file
+*/
+STATIC
+VOID
+nlog_stream_put(
+  nlog_stream* stream,
+  VOID* data,
+  UINT64 len
+)
+{
+  if (EFI_ERROR(stream->Status) || 0 == len)
+  {
+    return;
+  }
+
+  if (NULL == stream->File)
+  {
+    stream->Status = OpenDumpFile(stream->FileName, &stream->File);
+    if (EFI_ERROR(stream->Status))
+    {
+      return;
+    }
+  }
+
+  stream->Status = WriteDumpFile(stream->File, len, data);
+}
+
+STATIC
+VOID
+nlog_stream_flush(
+  nlog_stream* stream
+)
+{
+  nlog_stream_put(stream, stream->Buffer, stream->Used);
+  stream->Used = 0;
+}
+
+STATIC
+VOID
+nlog_stream_write(
+  nlog_stream* stream,
+  CONST CHAR8* data,
+  UINT64 len
+)
+{
+  if (stream->Used + len > NLOG_STREAM_CHUNK_SIZE)
+  {
+    nlog_stream_flush(stream);
+  }
+
+  if (len > NLOG_STREAM_CHUNK_SIZE)
+  {
+    nlog_stream_put(stream, (VOID*)data, len);
+    return;
+  }
+
+  CopyMem_S(stream->Buffer + stream->Used, NLOG_STREAM_CHUNK_SIZE - stream->Used, data, len);
+  stream->Used += len;
+}
+
+/*
+Same output as pad_left without the allocations
+*/
+STATIC
+VOID
+nlog_stream_write_padded(
+  nlog_stream* stream,
+  CONST CHAR8* str,
+  UINT64 pad_len
+)
+{
+  CONST CHAR8 spaces[] = "                                ";
+  UINT64 len = string_length((CHAR8*)str);
+  UINT64 pad = 0;
+
+  if (len < pad_len)
+  {
+    pad = pad_len - len;
+    while (pad > 0)
+    {
+      nlog_stream_write(stream, spaces, MIN(pad, sizeof(spaces) - 1));
+      pad -= MIN(pad, sizeof(spaces) - 1);
+    }
+  }
+  nlog_stream_write(stream, str, len);
+}
+
+/*
+Makes sure there is room for count argument values
+*/
+STATIC
+BOOLEAN
+nlog_reserve_args(
+  UINT32** values,
+  UINT32*** value_ptrs,
+  UINT64* capacity,
+  UINT64 count
+)
+{
+  UINT64 x = 0;
+
+  if (count <= *capacity)
+  {
+    return TRUE;
+  }
+
+  FREE_POOL_SAFE(*values);
+  FREE_POOL_SAFE(*value_ptrs);
+  *capacity = 0;
+
+  *values = AllocateZeroPool(count * sizeof(UINT32));
+  *value_ptrs = AllocateZeroPool(count * sizeof(UINT32*));
+  if (NULL == *values || NULL == *value_ptrs)
+  {
+    FREE_POOL_SAFE(*values);
+    FREE_POOL_SAFE(*value_ptrs);
+    return FALSE;
+  }
+
+  // nlog_format takes the values by reference
+  for (x = 0; x < count; x++)
+  {
+    (*value_ptrs)[x] = &(*values)[x];
+  }
+  *capacity = count;
+  return TRUE;
+}
 
 VOID
 decode_nlog_binary(
@@ -11,44 +169,34 @@ decode_nlog_binary(
   CHAR16* decoded_file_name,
   UINT8* nlogbytes,
   UINT64 size,
-  UINT32 dict_version,
-  nlog_dict_entry* dict_head
+  nlog_dict* dict
 )
 {
-  EFI_STATUS status;
   BOOLEAN inv2section = FALSE;
-  UINT32 expectedMagicNum = 11928997;
   UINT64 x = 0;
   UINT64 y = 0;
-  UINT64 z = 0;
   nlog_dict_entry* entry = NULL;
-  nlog_record* record = NULL;
-  nlog_record* head = NULL;
-  nlog_record* tail = NULL;
-  UINT64 total_formatted_string_size = 0;
-  CHAR8* total_formatted_string = NULL;
-  UINT64 elements = 0;
-  CHAR8** append_strs = NULL;
-  UINT32** old_args = NULL;
-  UINT64 old_arg_count = 0;
   nlog_version_v1 v1;
   nlog_version_v2 v2;
   CHAR16* kernel_str = NULL;
-  CHAR8* ascii_kernel_str = NULL;
+  CHAR8 ascii_kernel_str[NLOG_TIME_STR_LEN];
   CHAR8* system_time_set_log = "System Time Set";
-  UINTN ascii_kernel_str_size = 0;
   UINT32 system_time_set = 0;
-  CHAR8* old_format_str = NULL;
-  CHAR8* decode_header = NULL;
-  UINT64 header_length = 0;
+  CHAR8 v1_format[NLOG_V1_FORMAT_LEN];
+  CHAR8* log_string = NULL;
+  CHAR8* file_name = NULL;
+  CHAR8* log_level = NULL;
+  CHAR8* formatted_string = NULL;
   UINT32 value;
+  UINT32 kernel_time = 0;
+  UINT64 args = 0;
+  UINT64 arg_offset = 0;
   UINT64 node_count = 0;
-  CHAR8* formatted_string_head = NULL;
-  UINT64 bytes_needed = 0;
-  UINT64 appended_count = 0;
-  BOOLEAN dictionary_entry_was_allocated_here = FALSE;
-  BOOLEAN hash_not_found = FALSE;
-  nlog_record* next;
+  BOOLEAN decoded_all = FALSE;
+  UINT32* arg_values = NULL;
+  UINT32** arg_value_ptrs = NULL;
+  UINT64 arg_capacity = 0;
+  nlog_stream stream;
   PRINT_CONTEXT *pPrinterCtx = NULL;
   EFI_STATUS ReturnCode = EFI_SUCCESS;
 
@@ -56,20 +204,27 @@ decode_nlog_binary(
     pPrinterCtx = pCmd->pPrintCtx;
   }
 
+  ZeroMem(&stream, sizeof(stream));
+  stream.FileName = decoded_file_name;
+  stream.Buffer = AllocatePool(NLOG_STREAM_CHUNK_SIZE);
+  if (NULL == stream.Buffer)
+  {
+    PRINTER_SET_MSG(pPrinterCtx, ReturnCode, L"Failed to allocate %lu bytes to dump the decoded output\n", (UINT64)NLOG_STREAM_CHUNK_SIZE);
+    goto Finish;
+  }
+
+  nlog_stream_write(&stream, NLOG_DECODE_HEADER, sizeof(NLOG_DECODE_HEADER) - 1);
+
   node_count = 0;
-  for (x = 0; x < size; x += 4)
+  for (x = 0; x < size && !EFI_ERROR(stream.Status); x += 4)
   {
-    record = NULL;
-    entry = NULL;
-    dictionary_entry_was_allocated_here = FALSE;
-    hash_not_found = FALSE;
     value = bytes_to_u32(&nlogbytes[x]);
-    if (x % 256 == 0)
+    if (x % NLOG_SECTION_SIZE == 0)
     {
       inv2section = FALSE;
       v2.rawData = value;
-      if (v2.data.magic_number == expectedMagicNum &&
-        v2.data.version == dict_version)
+      if (v2.data.magic_number == NLOG_V2_MAGIC_NUMBER &&
+        v2.data.version == dict->Version)
       {
         inv2section = TRUE;
         continue;
@@ -82,60 +237,40 @@ decode_nlog_binary(
     }
 
     /*
-    check for V2 dictionary entry if this is a V2 section. If there isn't one, create a fake one for logging purposes
+    check for V2 dictionary entry if this is a V2 section. If there isn't one, log the hash instead.
 
-    If this is a V1 section and the value is valid for a V1 section, create a fake entry for logging purposes
+    If this is a V1 section and the value is valid for a V1 section, log the module, line and arguments.
     */
+    arg_offset = 0;
     if (inv2section)
     {
-      entry = get_nlog_entry(value, dict_head);
+      entry = get_nlog_entry(value, dict);
       if (entry == NULL)
       {
-        hash_not_found = TRUE;
-        entry = AllocateZeroPool(sizeof(nlog_dict_entry));
-        if (NULL == entry)
-        {
-          PRINTER_SET_MSG(pPrinterCtx, ReturnCode, L"Failed to allocate space for decoded records\n");
-          goto Finish;
-        }
-
-        dictionary_entry_was_allocated_here = TRUE;
-
-        entry->Hash = value;
-        entry->Args = 1;
-        entry->LogLevel = string_copy("-");
-        entry->FileName = string_copy("-");
-        entry->LogString = string_copy("Hash %d not found in dictionary");
-        entry->next = NULL;
-        entry->prev = NULL;
-
-        record = AllocateZeroPool(sizeof(nlog_record));
-        if (NULL == record)
-        {
-          PRINTER_SET_MSG(pPrinterCtx, ReturnCode, L"Failed to allocate space for decoded records\n");
-          goto Finish;
-        }
-
-        record->DictEntry = entry;
-        record->KernelTime = 0;
-        record->ArgValues = AllocateZeroPool(record->DictEntry->Args * sizeof(UINT32*));
-        if (NULL == record->ArgValues)
+        // No timestamp nor arguments follow an unknown hash
+        if (!nlog_reserve_args(&arg_values, &arg_value_ptrs, &arg_capacity, 1))
         {
           PRINTER_SET_MSG(pPrinterCtx, ReturnCode, L"Failed to allocate space for decoded records\n");
           goto Finish;
         }
-        record->ArgValues[0] = AllocateZeroPool(sizeof(UINT32));
-        if (NULL == record->ArgValues[0])
+        arg_values[0] = value;
+        formatted_string = nlog_format("Hash %d not found in dictionary", arg_value_ptrs, 1);
+        if (NULL == formatted_string)
         {
           PRINTER_SET_MSG(pPrinterCtx, ReturnCode, L"Failed to allocate space for decoded records\n");
           goto Finish;
         }
-        *record->ArgValues[0] = entry->Hash;
-        record->KernelTime = 0;
-        record->FormattedString = NULL;
-        record->prev = NULL;
-        record->next = NULL;
+        nlog_stream_write(&stream, formatted_string, string_length(formatted_string));
+        nlog_stream_write(&stream, "\n", 1);
+        FREE_POOL_SAFE(formatted_string);
+        node_count++;
+        continue;
       }
+
+      args = entry->Args;
+      log_string = entry->LogString;
+      file_name = entry->FileName;
+      log_level = entry->LogLevel;
     }
     else
     {
@@ -145,374 +280,161 @@ decode_nlog_binary(
         continue;
       }
 
-      entry = AllocateZeroPool(sizeof(nlog_dict_entry));
-      if (NULL == entry)
+      // The module and line number go first
+      args = v1.data.args + 2;
+      arg_offset = 2;
+      file_name = "-";
+      log_level = "-";
+
+      CopyMem_S(v1_format, sizeof(v1_format), NLOG_V1_FORMAT_HEAD, sizeof(NLOG_V1_FORMAT_HEAD));
+      log_string = v1_format + sizeof(NLOG_V1_FORMAT_HEAD) - 1;
+      for (y = 0; y < v1.data.args; y++)
       {
-        PRINTER_SET_MSG(pPrinterCtx, ReturnCode, L"Failed to allocate space for decoded records\n");
-        goto Finish;
+        CopyMem_S(log_string, sizeof(NLOG_V1_FORMAT_ARG), NLOG_V1_FORMAT_ARG, sizeof(NLOG_V1_FORMAT_ARG));
+        log_string += sizeof(NLOG_V1_FORMAT_ARG) - 1;
       }
-
-      dictionary_entry_was_allocated_here = TRUE;
-
-      entry->Args = v1.data.args;
-      entry->Hash = 0;
-      entry->LogLevel = string_copy("-");
-      entry->FileName = string_copy("-");
-      entry->LogString = NULL;
-      entry->next = NULL;
-      entry->prev = NULL;
+      log_string = v1_format;
     }
 
-    //Move the pointer index to the next U32 and allocate space for a record
-    if (record == NULL)
+    if (!nlog_reserve_args(&arg_values, &arg_value_ptrs, &arg_capacity, MAX(args, 1)))
     {
-      record = AllocateZeroPool(sizeof(nlog_record));
-      if (NULL == record)
-      {
-        PRINTER_SET_MSG(pPrinterCtx, ReturnCode, L"Failed to allocate space for decoded records\n");
-        goto Finish;
-      }
-
-      record->id = node_count;
-      record->ArgValues = NULL;
-      record->FormattedString = NULL;
-      record->prev = NULL;
-      record->next = NULL;
-      record->KernelTime = 0;
+      PRINTER_SET_MSG(pPrinterCtx, ReturnCode, L"Failed to allocate space for decoded records\n");
+      goto Finish;
     }
-
-    if (record->DictEntry == NULL && entry != NULL) {
-      record->DictEntry = entry;
+    if (!inv2section)
+    {
+      arg_values[0] = v1.data.module_id;
+      arg_values[1] = v1.data.line_number;
     }
 
-    if (head == NULL) {
-      head = record;
-      tail = record;
-    }
-    else {
-      tail->next = record;
-      record->prev = tail;
-      tail = record;
+    //get the timestamp
+    x += 4;
+    if (x >= size)
+    {
+      PRINTER_SET_MSG(pPrinterCtx, ReturnCode, L"Unexpected end of buffer. 1\n");
+      goto Finish;
     }
+    kernel_time = bytes_to_u32(&nlogbytes[x]);
 
-    //get the timestamp
-    if (FALSE == hash_not_found)
+    /*
+    Gather the argument U32s according to the discovered count
+    */
+    for (y = arg_offset; y < args; y++)
     {
       x += 4;
       if (x >= size)
       {
-        PRINTER_SET_MSG(pPrinterCtx, ReturnCode, L"Unexpected end of buffer. 1\n");
+        PRINTER_SET_MSG(pPrinterCtx, ReturnCode, L"Unexpected end of buffer. 3\n");
         goto Finish;
       }
-      record->KernelTime = bytes_to_u32(&nlogbytes[x]);
-
-      /*
-      Gather the arument U32s according to the discovered count
-      */
-      if (record->DictEntry->Args > 0)
-      {
-        record->ArgValues = AllocateZeroPool(record->DictEntry->Args * sizeof(UINT32*));
-        if (NULL == record->ArgValues)
-        {
-          PRINTER_SET_MSG(pPrinterCtx, ReturnCode, L"Failed to allocate space for decoded records\n");
-          goto Finish;
-        }
-
-        for (y = 0; y < record->DictEntry->Args && x < size; y++)
-        {
-          x += 4;
-          if (x >= size)
-          {
-            PRINTER_SET_MSG(pPrinterCtx, ReturnCode, L"Unexpected end of buffer. 3\n");
-            goto Finish;
-          }
-          record->ArgValues[y] = AllocateZeroPool(sizeof(UINT32));
-          if (NULL == record->ArgValues[y])
-          {
-            PRINTER_SET_MSG(pPrinterCtx, ReturnCode, L"Failed to allocate space for decoded records\n");
-            goto Finish;
-          }
-
-          *record->ArgValues[y] = bytes_to_u32(&nlogbytes[x]);
-        }
-      }
-
-
-      if (FALSE == inv2section)
-      {
-        elements = 3 + record->DictEntry->Args;
-        append_strs = AllocateZeroPool(sizeof(CHAR8*) * elements);
-        if (NULL == append_strs)
-        {
-          PRINTER_SET_MSG(pPrinterCtx, ReturnCode, L"Failed to allocate space for decoded records\n");
-          goto Finish;
-        }
-
-        append_strs[0] = string_copy("V1 Log module: 0x%X, ");
-        append_strs[1] = string_copy("line: %d, ");
-        append_strs[2] = string_copy("args: ");
-        for (z = 3; z < elements; z++)
-        {
-          append_strs[z] = string_copy("0x%X ");
-        }
-
-        old_args = record->ArgValues;
-        old_arg_count = record->DictEntry->Args;
-
-        record->DictEntry->Args = old_arg_count + 2;
-        record->ArgValues = AllocateZeroPool(record->DictEntry->Args * sizeof(UINT32*));
-        if (NULL == record->ArgValues)
-        {
-          PRINTER_SET_MSG(pPrinterCtx, ReturnCode, L"Failed to allocate space for decoded records\n");
-          goto Finish;
-        }
-
-        record->ArgValues[0] = AllocateZeroPool(sizeof(UINT32));
-        if (NULL == record->ArgValues[0])
-        {
-          PRINTER_SET_MSG(pPrinterCtx, ReturnCode, L"Failed to allocate space for decoded records\n");
-          goto Finish;
-        }
-        record->ArgValues[1] = AllocateZeroPool(sizeof(UINT32));
-        if (NULL == record->ArgValues[1])
-        {
-          PRINTER_SET_MSG(pPrinterCtx, ReturnCode, L"Failed to allocate space for decoded records\n");
-          goto Finish;
-        }
-        *record->ArgValues[0] = v1.data.module_id;
-        *record->ArgValues[1] = v1.data.line_number;
-
-
-        for (z = 0; z < old_arg_count; z++)
-        {
-          record->ArgValues[z + 2] = AllocateZeroPool(sizeof(UINT32));
-          *record->ArgValues[z + 2] = *old_args[z];
-        }
-
-        for (z = 0; z < old_arg_count; z++)
-        {
-          FREE_POOL_SAFE(old_args[z]);
-        }
-
-        FREE_POOL_SAFE(old_args);
-
-        record->DictEntry->LogString = string_array_concat(append_strs, elements, TRUE, &z);
-      }
+      arg_values[y] = bytes_to_u32(&nlogbytes[x]);
     }
 
-    record->FormattedString = nlog_format(record->DictEntry->LogString, record->ArgValues, record->DictEntry->Args);
-
-    if (TRUE == hash_not_found)
-    {
-      elements = 2;
-      old_format_str = record->FormattedString;
-      append_strs = AllocateZeroPool(sizeof(CHAR8*) * elements);
-      if (NULL == append_strs)
-      {
-        PRINTER_SET_MSG(pPrinterCtx, ReturnCode, L"Failed to allocate space for decoded records\n");
-        goto Finish;
-      }
-      append_strs[0] = old_format_str;
-      append_strs[1] = string_copy("\n");
-      record->FormattedString = string_array_concat(append_strs, elements, FALSE, &record->FormattedStringLen);
-    }
-    else
+    formatted_string = nlog_format(log_string, (0 == args) ? NULL : arg_value_ptrs, args);
+    if (NULL == formatted_string)
     {
-      elements = 8;
-      old_format_str = record->FormattedString;
-      append_strs = AllocateZeroPool(sizeof(CHAR8*) * elements);
-      if (NULL == append_strs)
-      {
-        PRINTER_SET_MSG(pPrinterCtx, ReturnCode, L"Failed to allocate space for decoded records\n");
-        goto Finish;
-      }
-
-      // Look for log eg: \"System Time Set at boot. Time: 0x0_55bbb4a6\". Convert to time format string only for real kernel time and not system ticks.
-      if (((system_time_set != 0) && (record->KernelTime >= system_time_set)) || (AsciiStrnCmp(record->FormattedString + 1, system_time_set_log, string_length(system_time_set_log)) == 0))
-      {
-        system_time_set = record->KernelTime;
-        kernel_str = GetTimeFormatString((UINT64)record->KernelTime, TRUE);
-        if (NULL == kernel_str)
-        {
-          PRINTER_SET_MSG(pPrinterCtx, ReturnCode, L"Failed to convert the timestamp into readable string format\n");
-          goto Finish;
-        }
-        ascii_kernel_str_size = StrLen(kernel_str) + 1;
-        ascii_kernel_str = AllocateZeroPool(sizeof(CHAR8) * ascii_kernel_str_size);
-        UnicodeStrToAsciiStrS(kernel_str, ascii_kernel_str, ascii_kernel_str_size);
-        append_strs[0] = pad_left(ascii_kernel_str, 28, ' ', TRUE);
-      }
-      else
-      {
-        ascii_kernel_str = u32_to_a(record->KernelTime, FALSE, 0, FALSE);
-        append_strs[0] = pad_left(ascii_kernel_str, 28, ' ', TRUE);
-      }
-      append_strs[1] = string_copy(" :: ");
-      append_strs[2] = pad_left(record->DictEntry->FileName, 27, ' ', FALSE);
-      append_strs[3] = string_copy(" :: ");
-      append_strs[4] = pad_left(record->DictEntry->LogLevel, 7, ' ', FALSE);
-      append_strs[5] = string_copy(" :: ");
-      append_strs[6] = record->FormattedString;
-      append_strs[7] = string_copy("\n");
-
-      record->FormattedString = string_array_concat(append_strs, elements, FALSE, &record->FormattedStringLen);
+      PRINTER_SET_MSG(pPrinterCtx, ReturnCode, L"Failed to allocate space for decoded records\n");
+      goto Finish;
     }
 
-    total_formatted_string_size += record->FormattedStringLen;
-
-    FREE_POOL_SAFE(kernel_str);
-    if (append_strs)
+    // Look for log eg: \"System Time Set at boot. Time: 0x0_55bbb4a6\". Convert to time format string only for real kernel time and not system ticks.
+    if (((system_time_set != 0) && (kernel_time >= system_time_set)) ||
+      (formatted_string[0] != '\0' && AsciiStrnCmp(formatted_string + 1, system_time_set_log, string_length(system_time_set_log)) == 0))
     {
-      for (z = 0; z < elements; z++)
+      system_time_set = kernel_time;
+      kernel_str = GetTimeFormatString((UINT64)kernel_time, TRUE);
+      if (NULL == kernel_str)
       {
-        FREE_POOL_SAFE(append_strs[z]);
+        PRINTER_SET_MSG(pPrinterCtx, ReturnCode, L"Failed to convert the timestamp into readable string format\n");
+        goto Finish;
       }
-      FREE_POOL_SAFE(append_strs);
+      ascii_kernel_str[0] = '\0';
+      UnicodeStrToAsciiStrS(kernel_str, ascii_kernel_str, sizeof(ascii_kernel_str));
+      FREE_POOL_SAFE(kernel_str);
     }
-
-    if (record->ArgValues)
+    else
     {
-      for (z = 0; z < record->DictEntry->Args; z++)
-      {
-        FREE_POOL_SAFE(record->ArgValues[z]);
-      }
-
-      FREE_POOL_SAFE(record->ArgValues);
-      record->ArgValues = NULL;
+      AsciiSPrint(ascii_kernel_str, sizeof(ascii_kernel_str), "%u", kernel_time);
     }
 
-    if (entry != NULL && dictionary_entry_was_allocated_here)
-    {
-      FREE_POOL_SAFE(entry->FileName);
-      FREE_POOL_SAFE(entry->LogLevel);
-      FREE_POOL_SAFE(entry->LogString);
-      FREE_POOL_SAFE(entry);
-      entry = NULL;
-      record->DictEntry = NULL;
-    }
+    nlog_stream_write_padded(&stream, ascii_kernel_str, NLOG_TIMESTAMP_WIDTH);
+    nlog_stream_write(&stream, " :: ", 4);
+    nlog_stream_write_padded(&stream, file_name, NLOG_FILE_NAME_WIDTH);
+    nlog_stream_write(&stream, " :: ", 4);
+    nlog_stream_write_padded(&stream, log_level, NLOG_LOG_LEVEL_WIDTH);
+    nlog_stream_write(&stream, " :: ", 4);
+    nlog_stream_write(&stream, formatted_string, string_length(formatted_string));
+    nlog_stream_write(&stream, "\n", 1);
+    FREE_POOL_SAFE(formatted_string);
 
     node_count++;
   }
-
-  /*
-  build the output string and dump it to the file
-  */
-  decode_header = string_copy("TIMESTAMP ::              FILE           ::   LEVEL :: LOG\n=====================================================================================\n");
-  header_length = string_length(decode_header);
-  total_formatted_string_size += header_length;
-
-  bytes_needed = (sizeof(CHAR8*) * total_formatted_string_size) + sizeof(CHAR8*);
-
-  total_formatted_string = AllocateZeroPool(bytes_needed);
-  if (NULL == total_formatted_string)
-  {
-    PRINTER_SET_MSG(pPrinterCtx, ReturnCode, L"Failed to allocate %lu bytes to dump the decoded output\n", bytes_needed);
-    goto Finish;
-  }
-
-  formatted_string_head = total_formatted_string;
-  appended_count = 0;
-  if (header_length > 0)
-  {
-    MyMemCopy(formatted_string_head, header_length, decode_header);
-    formatted_string_head = formatted_string_head + header_length;
-  }
-  FREE_POOL_SAFE(decode_header);
-
-  record = head;
-  while (record)
-  {
-    if (record->FormattedStringLen > 0)
-    {
-      MyMemCopy(formatted_string_head, record->FormattedStringLen, record->FormattedString);
-      formatted_string_head = formatted_string_head + record->FormattedStringLen;
-    }
-
-    FREE_POOL_SAFE(record->FormattedString);
-    record->FormattedString = NULL;
-    appended_count++;
-    record = record->next;
-  }
-
-  status = DumpToFile(decoded_file_name, total_formatted_string_size, total_formatted_string, TRUE);
-  if (EFI_ERROR(status))
-  {
-    PRINTER_SET_MSG(pPrinterCtx, ReturnCode, L"Failed to write record to file %lu\n", status);
-    goto Finish;
-  }
-  PRINTER_SET_MSG(pPrinterCtx, ReturnCode, L"Decoded %lu records to file " FORMAT_STR "\n", node_count, decoded_file_name);
+  decoded_all = TRUE;
 
 Finish:
-
-  if (NULL != old_args)
-  {
-    for (z = 0; z < old_arg_count; z++)
-    {
-      FREE_POOL_SAFE(old_args[z]);
-    }
-    FREE_POOL_SAFE(old_args);
-  }
-
-  if (NULL != total_formatted_string)
-  {
-    FREE_POOL_SAFE(total_formatted_string);
-  }
-
-  if (NULL != append_strs)
-  {
-    for (z = 0; z < elements; z++)
-    {
-      FREE_POOL_SAFE(append_strs[z]);
-    }
-    FREE_POOL_SAFE(append_strs);
-  }
-
-  while (head != NULL)
+  // Keep whatever was decoded, even when the buffer ended mid record
+  if (NULL != stream.Buffer)
   {
-    next = head->next;
-    if (head->ArgValues)
+    nlog_stream_flush(&stream);
+    if (NULL != stream.File)
     {
-      for (z = 0; z < head->DictEntry->Args; z++)
+      EFI_STATUS CloseStatus = CloseDumpFile(stream.File);
+      if (!EFI_ERROR(stream.Status))
       {
-        FREE_POOL_SAFE(head->ArgValues[z]);
+        stream.Status = CloseStatus;
       }
-
-      FREE_POOL_SAFE(head->ArgValues);
     }
-
-    if (head->FormattedString)
+    if (EFI_ERROR(stream.Status))
     {
-      FREE_POOL_SAFE(head->FormattedString);
+      PRINTER_SET_MSG(pPrinterCtx, ReturnCode, L"Failed to write record to file %lu\n", stream.Status);
+    }
+    else if (decoded_all)
+    {
+      PRINTER_SET_MSG(pPrinterCtx, ReturnCode, L"Decoded %lu records to file " FORMAT_STR "\n", node_count, decoded_file_name);
     }
-
-    FREE_POOL_SAFE(head);
-    head = next;
   }
 
-  if (entry != NULL && dictionary_entry_was_allocated_here)
-  {
-    FREE_POOL_SAFE(entry->FileName);
-    FREE_POOL_SAFE(entry->LogLevel);
-    FREE_POOL_SAFE(entry->LogString);
-    FREE_POOL_SAFE(entry);
-  }
+  FREE_POOL_SAFE(formatted_string);
+  FREE_POOL_SAFE(kernel_str);
+  FREE_POOL_SAFE(arg_values);
+  FREE_POOL_SAFE(arg_value_ptrs);
+  FREE_POOL_SAFE(stream.Buffer);
+}
+
+/*
+Slot of a hash in the index, multiplicative hashing on the top bits
+*/
+STATIC
+UINT64
+nlog_index_slot(
+  UINT32 hashVal,
+  UINT32 index_bits
+)
+{
+  return (UINT64)(((UINT64)hashVal * 0x9E3779B97F4A7C15ULL) >> (64 - index_bits));
 }
 
 nlog_dict_entry*
 get_nlog_entry(
   UINT32 hashVal,
-  nlog_dict_entry* head
+  nlog_dict* dict
 )
 {
-  nlog_dict_entry* ret = head;
-  while (NULL != ret)
+  UINT64 mask = 0;
+  UINT64 slot = 0;
+
+  if (NULL == dict || NULL == dict->Index)
+  {
+    return NULL;
+  }
+
+  mask = (1ULL << dict->IndexBits) - 1;
+  for (slot = nlog_index_slot(hashVal, dict->IndexBits); dict->Index[slot] != 0; slot = (slot + 1) & mask)
   {
-    if (ret->Hash == hashVal)
+    if (dict->Entries[dict->Index[slot] - 1].Hash == hashVal)
     {
-      return ret;
+      return &dict->Entries[dict->Index[slot] - 1];
     }
-
-    ret = ret->next;
   }
 
   return NULL;
@@ -558,7 +480,97 @@ Finish:
   return buffer;
 }
 
-nlog_dict_entry*
+VOID
+free_nlog_dict(
+  nlog_dict* dict
+)
+{
+  if (NULL == dict)
+  {
+    return;
+  }
+
+  FREE_POOL_SAFE(dict->Index);
+  FREE_POOL_SAFE(dict->Entries);
+  FREE_POOL_SAFE(dict->FileBuffer);
+  FREE_POOL_SAFE(dict);
+}
+
+/*
+Cuts the next line out of the buffer in place
+
+@param[in,out] cursor - the current position, moved past the line
+@param[in] end - the end of the buffer
+
+@retval the line without its end of line characters, or NULL at the end of the buffer
+*/
+STATIC
+CHAR8*
+nlog_next_line(
+  CHAR8** cursor,
+  CHAR8* end
+)
+{
+  CHAR8* line = *cursor;
+  CHAR8* eol = line;
+
+  if (line >= end)
+  {
+    return NULL;
+  }
+
+  while (eol < end && *eol != '\n' && *eol != '\0')
+  {
+    eol++;
+  }
+  *cursor = (eol < end) ? eol + 1 : end;
+  if (eol > line && *(eol - 1) == '\r')
+  {
+    eol--;
+  }
+  *eol = '\0';
+  return line;
+}
+
+/*
+Cuts the next field out of a line in place, the last field gets the rest of the line
+
+@retval the field, or NULL when the line has no more fields
+*/
+STATIC
+CHAR8*
+nlog_next_field(
+  CHAR8** cursor,
+  CHAR8 splitchar,
+  BOOLEAN last
+)
+{
+  CHAR8* field = *cursor;
+  CHAR8* sep = field;
+
+  if (NULL == field)
+  {
+    return NULL;
+  }
+
+  while (!last && *sep != '\0' && *sep != splitchar)
+  {
+    sep++;
+  }
+
+  if (!last && *sep == splitchar)
+  {
+    *sep = '\0';
+    *cursor = sep + 1;
+  }
+  else
+  {
+    *cursor = NULL;
+  }
+  return field;
+}
+
+nlog_dict*
 load_nlog_dict(
   struct Command *pCmd,
   CHAR16 * pLoadUserPath,
@@ -566,14 +578,12 @@ load_nlog_dict(
   UINT64 * node_count
 )
 {
-  nlog_dict_entry* head = NULL;
-  CHAR8** string_splits = NULL;
-  CHAR8** file_lines = NULL;
-  CHAR8* file_buffer = NULL;
-  UINT64 bytes_read;
-  UINT64 found_elements = 0;
-  UINT64 line_count = 0;
-  UINT32 x = 0;
+  nlog_dict* dict = NULL;
+  CHAR8* cursor = NULL;
+  CHAR8* end = NULL;
+  CHAR8* line = NULL;
+  CHAR8* version_str = NULL;
+  UINT64 bytes_read = 0;
   EFI_DEVICE_PATH_PROTOCOL *pDevicePathProtocol = NULL;
   EFI_STATUS status;
   PRINT_CONTEXT *pPrinterCtx = NULL;
@@ -591,99 +601,98 @@ load_nlog_dict(
     return NULL;
   }
 
+  dict = AllocateZeroPool(sizeof(*dict));
+  if (NULL == dict) {
+    PRINTER_SET_MSG(pPrinterCtx, ReturnCode, FORMAT_STR_NL, CLI_ERR_OUT_OF_MEMORY);
+    goto Finish;
+  }
+
   status = GetDeviceAndFilePath(pLoadUserPath, pDictPath, &pDevicePathProtocol);
   if (EFI_ERROR(status))
   {
     PRINTER_SET_MSG(pPrinterCtx, ReturnCode, L"Failed to locate the file: " FORMAT_STR L" %lu\n", pLoadUserPath, status);
-    goto Finish;
+    goto Error;
   }
 
-  status = FileRead(pDictPath, pDevicePathProtocol, MAX_CONFIG_DUMP_FILE_SIZE, &bytes_read, (VOID **)&file_buffer);
-  if (EFI_ERROR(status) || NULL == file_buffer)
+  status = FileRead(pDictPath, pDevicePathProtocol, MAX_CONFIG_DUMP_FILE_SIZE, &bytes_read, (VOID **)&dict->FileBuffer);
+  if (EFI_ERROR(status) || NULL == dict->FileBuffer)
   {
     PRINTER_SET_MSG(pPrinterCtx, ReturnCode, L"Failed to open or read the file: " FORMAT_STR L" %lu\n", pLoadUserPath, status);
-    goto Finish;
+    goto Error;
   }
 
   while (bytes_read > 0 &&
-    (file_buffer[bytes_read - 1] == '\n' ||
-      file_buffer[bytes_read - 1] == '\r' ||
-      file_buffer[bytes_read - 1] == '\t' ||
-      file_buffer[bytes_read - 1] == ' '))
+    (dict->FileBuffer[bytes_read - 1] == '\n' ||
+      dict->FileBuffer[bytes_read - 1] == '\r' ||
+      dict->FileBuffer[bytes_read - 1] == '\t' ||
+      dict->FileBuffer[bytes_read - 1] == ' '))
   {
-    file_buffer[bytes_read - 1] = 0;
+    dict->FileBuffer[bytes_read - 1] = 0;
     bytes_read--;
   }
 
-  file_lines = string_split(file_buffer, '\n', 0, &line_count);
-  if (NULL == file_lines || line_count <= 1)
+  cursor = dict->FileBuffer;
+  end = dict->FileBuffer + bytes_read;
+  line = nlog_next_line(&cursor, end);
+  if (NULL == line || cursor >= end)
   {
     PRINTER_SET_MSG(pPrinterCtx, ReturnCode, L"Dictionary passed does not contain enough content.\n");
-    goto Finish;
+    goto Error;
   }
 
-  string_splits = string_split(file_lines[0], NLOG_DICT_VERSION_SPLIT_CHAR, 2, &found_elements);
-  if (NULL == string_splits)
+  version_str = line;
+  while (*version_str != '\0' && *version_str != NLOG_DICT_VERSION_SPLIT_CHAR)
   {
-    PRINTER_SET_MSG(pPrinterCtx, ReturnCode, L"Error in dict on line 1 - Found 0 elements, expected %lu\n", 2);
-    goto Finish;
+    version_str++;
   }
-
-  if (found_elements != 2)
+  if (*version_str != NLOG_DICT_VERSION_SPLIT_CHAR)
   {
-    PRINTER_SET_MSG(pPrinterCtx, ReturnCode, L"Error in dict on line 1 - Found %lu elements, expected %lu\n", found_elements, 2);
-    goto Finish;
+    PRINTER_SET_MSG(pPrinterCtx, ReturnCode, L"Error in dict on line 1 - Found %lu elements, expected %lu\n", 1, 2);
+    goto Error;
   }
 
-  *version = a_to_u32(string_splits[1]);
+  *version = a_to_u32(version_str + 1);
   if (*version != 2)
   {
     PRINTER_SET_MSG(pPrinterCtx, ReturnCode, L"Only version 2 dictionaries supported.\n");
-    goto Finish;
+    goto Error;
   }
+  dict->Version = *version;
 
-  head = load_nlog_dict_v2(pCmd, &file_lines[1], (line_count - 1), node_count);
-
-Finish:
-
-  if (NULL != string_splits)
+  if (EFI_ERROR(load_nlog_dict_v2(pCmd, cursor, (UINT64)(end - cursor), dict)))
   {
-    for (x = 0; x < found_elements; x++)
-    {
-      FREE_POOL_SAFE(string_splits[x]);
-    }
-
-    FREE_POOL_SAFE(string_splits);
+    goto Error;
   }
 
-  if (NULL != file_lines)
-  {
-    for (x = 0; x < line_count; x++)
-    {
-      FREE_POOL_SAFE(file_lines[x]);
-    }
+  *node_count = dict->EntryCount;
+  goto Finish;
 
-    FREE_POOL_SAFE(file_lines);
-  }
-
-  FREE_POOL_SAFE(file_buffer);
-  return head;
+Error:
+  free_nlog_dict(dict);
+  dict = NULL;
+Finish:
+  FREE_POOL_SAFE(pDictPath);
+  return dict;
 }
 
-nlog_dict_entry*
+EFI_STATUS
 load_nlog_dict_v2(
   struct Command *pCmd,
-  CHAR8 ** lines,
-  UINT64 line_count,
-  UINT64 * node_count
+  CHAR8 * lines,
+  UINT64 size,
+  nlog_dict * dict
 )
 {
-  UINT32 x = 0;
-  nlog_dict_entry* head = NULL;
-  nlog_dict_entry* tail = NULL;
+  UINT64 x = 0;
+  UINT64 y = 0;
+  UINT64 line_count = 0;
+  UINT64 mask = 0;
+  UINT64 slot = 0;
+  CHAR8* cursor = NULL;
+  CHAR8* end = lines + size;
   CHAR8* line = NULL;
-  UINT64 found_elements = 0;
-  CHAR8** parts = NULL;
+  CHAR8* fields[NLOG_DICT_FIELDCOUNT];
+  nlog_dict_entry* entry = NULL;
   PRINT_CONTEXT *pPrinterCtx = NULL;
   EFI_STATUS ReturnCode = EFI_SUCCESS;
 
@@ -691,74 +700,73 @@ load_nlog_dict_v2(
     pPrinterCtx = pCmd->pPrintCtx;
   }
 
-  *node_count = 0;
-
-  for (x = 0; x < line_count; x++)
+  // Size the entries and the index up front, one line per entry
+  line_count = 1;
+  for (cursor = lines; cursor < end; cursor++)
   {
-    if (!lines[x])
+    if (*cursor == '\n')
     {
-      break;
+      line_count++;
     }
+  }
+
+  dict->IndexBits = NLOG_INDEX_MIN_BITS;
+  while ((1ULL << dict->IndexBits) < (line_count * 2))
+  {
+    dict->IndexBits++;
+  }
+  mask = (1ULL << dict->IndexBits) - 1;
 
-    line = lines[x];
-    parts = string_split(line, NLOG_DICT_SPLIT_CHAR, NLOG_DICT_FIELDCOUNT, &found_elements);
-    if (NULL == parts)
+  dict->Entries = AllocateZeroPool(line_count * sizeof(nlog_dict_entry));
+  dict->Index = AllocateZeroPool((1ULL << dict->IndexBits) * sizeof(UINT32));
+  if (NULL == dict->Entries || NULL == dict->Index)
+  {
+    PRINTER_SET_MSG(pPrinterCtx, ReturnCode, L"Failed to allocate space for decoded records\n");
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  dict->EntryCount = 0;
+  cursor = lines;
+  for (x = 0; NULL != (line = nlog_next_line(&cursor, end)); x++)
+  {
+    for (y = 0; y < NLOG_DICT_FIELDCOUNT; y++)
     {
-      PRINTER_SET_MSG(pPrinterCtx, ReturnCode, L"Error in dict on line %lu - Found NULL elements, expected %lu.\n", x + 1, NLOG_DICT_FIELDCOUNT);
-      goto Finish;
+      fields[y] = nlog_next_field(&line, NLOG_DICT_SPLIT_CHAR, (y == NLOG_DICT_FIELDCOUNT - 1));
+      if (NULL == fields[y])
+      {
+        PRINTER_SET_MSG(pPrinterCtx, ReturnCode, L"Error in dict on line %lu - Found %lu elements, expected %lu.\n", x + 1, y, NLOG_DICT_FIELDCOUNT);
+        return EFI_LOAD_ERROR;
+      }
     }
 
-    if (found_elements != NLOG_DICT_FIELDCOUNT)
+    entry = &dict->Entries[dict->EntryCount];
+    entry->Hash = a_to_u32(fields[0]);
+    entry->Args = a_to_u32(fields[1]);
+    entry->LogLevel = fields[2];
+    entry->FileName = fields[3];
+    entry->LogString = fields[4];
+    entry->next = NULL;
+    entry->prev = NULL;
+    if (dict->EntryCount > 0)
     {
-      PRINTER_SET_MSG(pPrinterCtx, ReturnCode, L"Error in dict on line %lu - Found %lu elements, expected %lu.\n", x + 1, found_elements, NLOG_DICT_FIELDCOUNT);
-      goto Finish;
+      entry->prev = &dict->Entries[dict->EntryCount - 1];
+      dict->Entries[dict->EntryCount - 1].next = entry;
     }
+    dict->EntryCount++;
 
-    *node_count = *node_count + 1;
-
-    if (head == NULL)
+    // The first entry of a duplicated hash wins
+    for (slot = nlog_index_slot(entry->Hash, dict->IndexBits); dict->Index[slot] != 0; slot = (slot + 1) & mask)
     {
-      head = AllocateZeroPool(sizeof(nlog_dict_entry));
-      if (NULL == head)
+      if (dict->Entries[dict->Index[slot] - 1].Hash == entry->Hash)
       {
-        PRINTER_SET_MSG(pPrinterCtx, ReturnCode, L"Failed to allocate space for decoded records\n");
-        goto Finish;
+        break;
       }
-      tail = head;
-      tail->prev = NULL;
-      tail->next = NULL;
     }
-    else
+    if (dict->Index[slot] == 0)
     {
-      tail->next = AllocateZeroPool(sizeof(nlog_dict_entry));
-      if (NULL == tail->next)
-      {
-        PRINTER_SET_MSG(pPrinterCtx, ReturnCode, L"Failed to allocate space for decoded records\n");
-        goto Finish;
-      }
-      ((nlog_dict_entry*)tail->next)->prev = tail;
-      tail = tail->next;
+      dict->Index[slot] = (UINT32)dict->EntryCount;
     }
-
-    tail->Hash = a_to_u32(parts[0]);
-    tail->Args = a_to_u32(parts[1]);
-
-    FREE_POOL_SAFE(parts[0]);
-    FREE_POOL_SAFE(parts[1]);
-
-    tail->LogLevel = parts[2];
-    tail->FileName = parts[3];
-    tail->LogString = parts[4];
-    tail->next = NULL;
-    FREE_POOL_SAFE(parts);
   }
 
-Finish:
-  if (parts != NULL) {
-    FREE_POOL_SAFE(parts[0]);
-    FREE_POOL_SAFE(parts[1]);
-    FREE_POOL_SAFE(parts);
-  }
-  return head;
+  return EFI_SUCCESS;
 }
-
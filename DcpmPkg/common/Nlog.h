@@ -40,26 +40,29 @@ typedef struct {
   VOID* prev;
 } nlog_dict_entry;
 
+/*
+A loaded dictionary. The entry strings point into FileBuffer, entries are
+looked up by hash through an open addressing index.
+*/
 typedef struct {
-  UINT64 id;
-  UINT32 KernelTime;
-  UINT32** ArgValues;
-  nlog_dict_entry* DictEntry;
-  CHAR8* FormattedString;
-  UINT64 FormattedStringLen;
-  VOID* next;
-  VOID* prev;
-} nlog_record;
+  CHAR8* FileBuffer;          ///< The dictionary file contents
+  nlog_dict_entry* Entries;   ///< Entries in file order, also linked through next/prev
+  UINT64 EntryCount;
+  UINT32* Index;              ///< Position + 1 in Entries of each hashed entry, 0 marks a free slot
+  UINT32 IndexBits;           ///< The index has 2^IndexBits slots
+  UINT32 Version;
+} nlog_dict;
 
 /*
 decode_nlog_binary command
 
-@param[in] decoded_file_name - the file to append records to
+Decodes the records one at a time, writing them to the output file in
+chunks as it goes.
+
+@param[in] decoded_file_name - the file to write records to
 @param[in] nlogbytes - the blob returned from the dump command
 @param[in] size - the number of bytes in the blob
-@param[in] dict_version - the version of the loaded dictionary
-@param[in] dict_head - the head to the dictionary linked list
-@param[out] node_count - the number of decoded entries
+@param[in] dict - the loaded dictionary
 */
 VOID
 decode_nlog_binary(
@@ -67,22 +70,21 @@ decode_nlog_binary(
   CHAR16* decoded_file_name,
   UINT8* nlogbytes,
   UINT64 size,
-  UINT32 dict_version,
-  nlog_dict_entry* dict_head
+  nlog_dict* dict
 );
 
 /*
 get_nlog_entry command
 
 @param[in] hashVal - the hash to locate
-@param[in] head - the head to the dictionary linked list
+@param[in] dict - the loaded dictionary
 
-@retval the discovered node, or NULL
+@retval the discovered entry, or NULL
 */
 nlog_dict_entry*
 get_nlog_entry(
   IN UINT32 hashVal,
-  IN nlog_dict_entry* head
+  IN nlog_dict* dict
 );
 
 /*
@@ -90,11 +92,11 @@ load_nlog_dict command
 
 @param[in] pDictPath - the path to the dictionary file
 @param[out] version - the version of the dictionary as detected
-@param[out] node_count - the number of nodes in the linked list
+@param[out] node_count - the number of entries in the dictionary
 
-@retval the head to the dictionary linked list
+@retval the dictionary, to be released with free_nlog_dict, or NULL
 */
-nlog_dict_entry*
+nlog_dict*
 load_nlog_dict(
   struct Command *pCmd,
   IN CHAR16 * pDictPath,
@@ -105,18 +107,30 @@ load_nlog_dict(
 /*
 load_nlog_dict_v2 command
 
-@param[in] lines - the array of strings to convert to structs
-@param[in] line_count - the length of the array of strings to convert to structs
-@param[out] node_count - the number of nodes in the linked list
+Parses the entry lines in place, the buffer must outlive the dictionary.
 
-@retval the head to the dictionary linked list
+@param[in,out] lines - the entry lines of the dictionary file
+@param[in] size - the number of bytes in lines
+@param[in,out] dict - the dictionary to fill in
+
+@retval EFI_SUCCESS, or the error parsing the lines
 */
-nlog_dict_entry*
+EFI_STATUS
 load_nlog_dict_v2(
   struct Command *pCmd,
-  IN CHAR8 ** lines,
-  IN UINT64 line_count,
-  OUT UINT64 * node_count
+  IN OUT CHAR8 * lines,
+  IN UINT64 size,
+  IN OUT nlog_dict * dict
+);
+
+/*
+free_nlog_dict command
+
+@param[in] dict - the dictionary to release, can be NULL
+*/
+VOID
+free_nlog_dict(
+  IN nlog_dict* dict
 );
 
 /*
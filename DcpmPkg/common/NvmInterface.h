@@ -41,6 +41,27 @@ typedef struct _EFI_DCPMM_CONFIG_TRANSPORT_ATTRIBS {
   TRANSPORT_PAYLOAD_SIZE PayloadSize;
 } EFI_DCPMM_CONFIG_TRANSPORT_ATTRIBS;
 
+// All possible combinations of transport and mailbox size
+typedef enum _DIMM_PASSTHRU_METHOD {
+  DimmPassthruDdrtLargePayload = 0,
+  DimmPassthruDdrtSmallPayload = 1,
+  DimmPassthruSmbusSmallPayload = 2
+} DIMM_PASSTHRU_METHOD;
+
+/**
+  Transport the firmware commands of a PMem module are sent over, resolved
+  against the transport attributes and the boot status of the module.
+**/
+typedef struct _DIMM_TRANSPORT_INFO {
+  BOOLEAN MailboxReady;                       //!< FALSE if the module did not answer over any interface
+  BOOLEAN LargePayloadAvailable;              //!< Large payload commands go over the DDRT large mailbox
+  DIMM_PASSTHRU_METHOD SmallPayloadMethod;    //!< Method of the commands without a large payload
+  DIMM_PASSTHRU_METHOD LargePayloadMethod;    //!< Method of the large payload commands
+  UINT32 LargeInputPayloadSize;               //!< Large input mailbox size, 0 if not available
+  UINT32 LargeOutputPayloadSize;              //!< Large output mailbox size, 0 if not available
+  UINT32 DataChunkSize;                       //!< Large mailbox transfer unit, 0 if handled by the OS
+} DIMM_TRANSPORT_INFO;
+
 /**
   Resolves to TRUE if the "-smbus" flag was passed in via CLI or equivalent.
   Restricts all communications to smbus only. FALSE otherwise.
@@ -1416,6 +1437,72 @@ EFI_STATUS
   IN OUT UINT32 *pEntryCount
   );
 
+/**
+  Get the progress and timing of the firmware update of a PMem module,
+  the one under way or else the last one since the driver was loaded.
+  While the image is being staged the module is checked once on each call.
+
+  @param[in] pThis - A pointer to the EFI_DCPMM_CONFIG2_PROTOCOL instance.
+  @param[in] DimmID - Handle of the PMem module
+  @param[out] pFwUpdateStatus - Progress and timing of the update
+
+  @retval EFI_SUCCESS Success
+  @retval EFI_INVALID_PARAMETER pThis or pFwUpdateStatus is NULL
+  @retval EFI_NOT_FOUND No PMem module with such handle
+**/
+typedef
+EFI_STATUS
+(EFIAPI *EFI_DCPMM_CONFIG_GET_FW_UPDATE_STATUS) (
+  IN  EFI_DCPMM_CONFIG2_PROTOCOL *pThis,
+  IN  UINT16 DimmID,
+  OUT FW_UPDATE_STATUS *pFwUpdateStatus
+  );
+
+/**
+  Get the transport resolved for a PMem module, resolving it first if the
+  transport attributes changed since.
+
+  @param[in] pThis - A pointer to the EFI_DCPMM_CONFIG2_PROTOCOL instance.
+  @param[in] DimmID - Handle of the PMem module
+  @param[out] pTransport - The resolved transport
+
+  @retval EFI_SUCCESS Success
+  @retval EFI_INVALID_PARAMETER pThis or pTransport is NULL
+  @retval EFI_NOT_FOUND No PMem module with such handle
+**/
+typedef
+EFI_STATUS
+(EFIAPI *EFI_DCPMM_CONFIG_GET_DIMM_TRANSPORT) (
+  IN  EFI_DCPMM_CONFIG2_PROTOCOL *pThis,
+  IN  UINT16 DimmID,
+  OUT DIMM_TRANSPORT_INFO *pTransport
+  );
+
+#ifdef OS_BUILD
+/**
+  Get the firmware command statistics collected for a PMem module, one entry per
+  opcode/subopcode sent to it. Nothing is collected unless FW_CMD_STATS_ENABLED is set.
+
+  @param[in] pThis - A pointer to the EFI_DCPMM_CONFIG2_PROTOCOL instance.
+  @param[in] DimmID - Handle of the PMem module
+  @param[out] pStats - Array of *pCount entries, may be NULL if *pCount is 0
+  @param[in,out] pCount - Size of pStats on input, number of entries available on output
+
+  @retval EFI_SUCCESS Success
+  @retval EFI_INVALID_PARAMETER pThis or pCount is NULL
+  @retval EFI_NOT_FOUND No PMem module with such handle
+  @retval EFI_BUFFER_TOO_SMALL pStats is too small, *pCount is set to the size needed
+**/
+typedef
+EFI_STATUS
+(EFIAPI *EFI_DCPMM_CONFIG_GET_FW_CMD_STATS) (
+  IN     EFI_DCPMM_CONFIG2_PROTOCOL *pThis,
+  IN     UINT16 DimmID,
+     OUT FW_CMD_STATS *pStats OPTIONAL,
+  IN OUT UINT32 *pCount
+  );
+#endif
+
 /**
   Pass Through command to FW
   Sends a command to FW and waits for response from firmware
@@ -1745,6 +1832,11 @@ struct _EFI_DCPMM_CONFIG2_PROTOCOL {
   EFI_DCPMM_CONFIG_SET_FIS_TRANSPORT_ATTRIBS SetFisTransportAttributes;
   EFI_DCPMM_CONFIG_GET_COMMAND_ACCESS_POLICY GetCommandAccessPolicy;
   EFI_DCPMM_CONFIG_GET_COMMAND_EFFECT_LOG GetCommandEffectLog;
+  EFI_DCPMM_CONFIG_GET_FW_UPDATE_STATUS GetFwUpdateStatus;
+  EFI_DCPMM_CONFIG_GET_DIMM_TRANSPORT GetDimmTransport;
+#ifdef OS_BUILD
+  EFI_DCPMM_CONFIG_GET_FW_CMD_STATS GetFwCmdStats;
+#endif
 };
 
 /**
@@ -8,6 +8,22 @@
 #include <Library/BaseLib.h>
 #include <Library/BaseMemoryLib.h>
 
+/**
+  Frees the memory of a parsed Nfit lookup index.
+
+  @param[in] pIndex pointer to the index.
+**/
+STATIC
+VOID
+FreeNfitTableIndex(
+  IN     NfitTableIndex *pIndex
+  )
+{
+  FREE_POOL_SAFE(pIndex->pKeys);
+  FREE_POOL_SAFE(pIndex->pPositions);
+  pIndex->Bits = 0;
+}
+
 /**
   Frees the memory of parsed Nfit subtables.
 
@@ -207,6 +223,13 @@ FreeNfitSubTables(
   }
   FREE_POOL_SAFE(ParsedNfit->ppSpaRangeTbles);
   ParsedNfit->SpaRangeTblesNum = 0;
+
+  FreeNfitTableIndex(&ParsedNfit->SpaRangeIndex);
+  FreeNfitTableIndex(&ParsedNfit->InterleaveIndex);
+  FreeNfitTableIndex(&ParsedNfit->ControlRegionIndex);
+  FreeNfitTableIndex(&ParsedNfit->FlushHintIndex);
+  FreeNfitTableIndex(&ParsedNfit->RegionPidIndex);
+  FREE_POOL_SAFE(ParsedNfit->pNextRegionForPid);
 }
 
 /**
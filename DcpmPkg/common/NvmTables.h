@@ -279,6 +279,17 @@ typedef struct {
 } PlatformCapabilitiesTbl;
 
 /** NFIT ACPI data */
+/**
+  Lookup index over one kind of parsed NFIT subtable, keyed by a 32 bit value
+  (table index, NVDIMM physical ID or device handle). Open addressing with
+  linear probing, sized to a power of two at least twice the entry count.
+**/
+typedef struct {
+  UINT32 Bits;                                                    ///< log2 of the slot count, 0 if empty
+  UINT32 *pKeys;                                                  ///< Slot keys
+  UINT32 *pPositions;                                             ///< Subtable array position + 1, 0 for a free slot
+} NfitTableIndex;
+
 typedef struct {
   NFitHeader *pFit;                                               ///< NFIT Header
   UINT32 SpaRangeTblesNum;                                        ///< Count of SPA Range tables
@@ -297,6 +308,12 @@ typedef struct {
   FlushHintTbl **ppFlushHintTbles;                                ///< Flush Hint tables
   UINT32 PlatformCapabilitiesTblesNum;                            ///< Count of PCAT tables
   PlatformCapabilitiesTbl **ppPlatformCapabilitiesTbles;          ///< PCAT tables
+  NfitTableIndex SpaRangeIndex;                                   ///< SPA Range tables by SPA range description table index
+  NfitTableIndex InterleaveIndex;                                 ///< Interleave tables by interleave structure index
+  NfitTableIndex ControlRegionIndex;                              ///< Control Region tables by control region descriptor table index
+  NfitTableIndex FlushHintIndex;                                  ///< Flush Hint tables by device handle
+  NfitTableIndex RegionPidIndex;                                  ///< First Region table for each NVDIMM physical ID
+  UINT32 *pNextRegionForPid;                                      ///< Per Region table: position + 1 of the next one with the same physical ID, 0 ends
 } ParsedFitHeader;
 
 typedef struct {
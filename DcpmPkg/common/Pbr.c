@@ -10,22 +10,45 @@
 #include <Convert.h>
 #include "Pbr.h"
 #include "PbrDcpmm.h"
+#include "Checksum.h"
 #ifdef OS_BUILD
 #include "PbrOs.h"
 #else
 STATIC EFI_STATUS PbrSerializeCtx(PbrContext *ctx, BOOLEAN Force);
 STATIC EFI_STATUS PbrDeserializeCtx(PbrContext * ctx);
+STATIC VOID PbrReleaseSession(PbrContext *ctx);
 #endif
 //local helper function prototypes
 STATIC EFI_STATUS PbrCheckBufferIntegrity(PbrContext *ctx);
 STATIC EFI_STATUS PbrComposeSession(PbrContext *pContext, VOID **ppBufferAddress, UINT32 *pBufferSize);
-STATIC EFI_STATUS PbrDecomposeSession(PbrContext *pContext, VOID *pPbrImg, UINT32 PbrImgSize);
+STATIC EFI_STATUS PbrDecomposeLegacySession(PbrContext *pContext, VOID *pPbrImg, UINT32 PbrImgSize);
+STATIC EFI_STATUS PbrSessionLayout(PbrContext *pContext, PbrSessionHeader *pHeader, PbrSessionPartition **ppDirectory);
+STATIC BOOLEAN PbrSessionRangeValid(UINT64 Offset, UINT64 Length, UINT64 SessionSize);
 STATIC EFI_STATUS PbrCreateSessionContext(PbrContext * ctx);
 STATIC UINT32 PbrPartitionCount();
 STATIC EFI_STATUS PbrGetPartition(UINT32 Signature, PbrPartitionContext **ppPartition);
+STATIC UINT32 PbrPartitionEnd(PbrPartitionContext *pPartition);
+STATIC EFI_STATUS PbrIndexPartition(PbrPartitionContext *pPartition);
+STATIC EFI_STATUS PbrAppendItemOffset(PbrPartitionContext *pPartition, UINT32 Offset);
+STATIC EFI_STATUS PbrOwnPartition(PbrPartitionContext *pPartition);
+STATIC VOID PbrFreePartitions(PbrContext *pContext);
 STATIC EFI_STATUS PbrCopyChunks(VOID *pDest, UINT32 pDestSz, VOID *pSource, UINT32 pSourceSz);
 
 PbrContext gPbrContext;
+
+/**
+  Playback items handed out by PbrGetMatchingData() ahead of the current
+  playback offset, kept as offsets within the partition. The list only
+  applies while the partition offset still equals Base, so moving the
+  playback position (tags, reset, GET_NEXT_DATA_INDEX) discards it.
+**/
+STATIC struct {
+  UINT32 Signature;
+  UINT32 Base;
+  UINT32 *pConsumed;
+  UINT32 ConsumedCnt;
+  UINT32 ConsumedMax;
+} mPbrLookahead;
 //used for setting volatile/non-volatile uefi variables
 extern EFI_GUID gIntelDimmPbrVariableGuid;
 extern EFI_GUID gIntelDimmPbrTagIdVariableguid;
@@ -58,6 +81,7 @@ PbrSetData(
 )
 {
   UINT32 CtxIndex = 0;
+  UINT32 GrowSize = 0;
   EFI_STATUS ReturnCode = EFI_SUCCESS;
   PbrContext *pContext = PBR_CTX();
   PbrPartitionLogicalDataItem *pDataItem = NULL;
@@ -66,10 +90,15 @@ PbrSetData(
   for (CtxIndex = 0; CtxIndex < MAX_PARTITIONS; ++CtxIndex) {
     //partition signature check
     if (Signature == pContext->PartitionContexts[CtxIndex].PartitionSig) {
+      //a partition of a loaded session is read only, take a copy before changing it
+      ReturnCode = PbrOwnPartition(&pContext->PartitionContexts[CtxIndex]);
+      if (EFI_ERROR(ReturnCode)) {
+        goto Finish;
+      }
       //caller wants the data object to be a singleton (only one logical data associated with this specific partition)
       if (Singleton) {
         //is the size previously allocated for this partition big enough?
-        if (Size > pContext->PartitionContexts[CtxIndex].PartitionSize) {
+        if (Size + sizeof(PbrPartitionLogicalDataItem) > pContext->PartitionContexts[CtxIndex].PartitionSize) {
           //no it isn't, let's free anything previously allocated
           if (pContext->PartitionContexts[CtxIndex].PartitionData) {
             FreePool(pContext->PartitionContexts[CtxIndex].PartitionData);
@@ -115,10 +144,11 @@ PbrSetData(
         }
       }
       else {
-        //allocate more memory if needed
+        //allocate more memory if needed, at least doubling so long recordings don't copy the partition over and over
         if (pContext->PartitionContexts[CtxIndex].PartitionCurrentOffset + (Size + sizeof(PbrPartitionLogicalDataItem)) > pContext->PartitionContexts[CtxIndex].PartitionSize) {
+          GrowSize = MAX(pContext->PartitionContexts[CtxIndex].PartitionSize, (UINT32)((Size + sizeof(PbrPartitionLogicalDataItem)) * PARTITION_GROW_SZ_MULTIPLIER));
           pContext->PartitionContexts[CtxIndex].PartitionData = ReallocatePool(pContext->PartitionContexts[CtxIndex].PartitionSize,
-            pContext->PartitionContexts[CtxIndex].PartitionSize + ((Size + sizeof(PbrPartitionLogicalDataItem)) * PARTITION_GROW_SZ_MULTIPLIER),
+            pContext->PartitionContexts[CtxIndex].PartitionSize + GrowSize,
             pContext->PartitionContexts[CtxIndex].PartitionData);
 
           if (NULL == pContext->PartitionContexts[CtxIndex].PartitionData) {
@@ -126,7 +156,12 @@ PbrSetData(
             NVDIMM_DBG("Failed to allocate memory for partition buffer\n");
             goto Finish;
           }
-          pContext->PartitionContexts[CtxIndex].PartitionSize += ((Size + sizeof(PbrPartitionLogicalDataItem)) * PARTITION_GROW_SZ_MULTIPLIER);
+          pContext->PartitionContexts[CtxIndex].PartitionSize += GrowSize;
+        }
+        //index the new item, so it can be found by logical index without walking the partition
+        ReturnCode = PbrAppendItemOffset(&pContext->PartitionContexts[CtxIndex], pContext->PartitionContexts[CtxIndex].PartitionCurrentOffset);
+        if (EFI_ERROR(ReturnCode)) {
+          goto Finish;
         }
         pDataItem = (PbrPartitionLogicalDataItem*)((UINTN)pContext->PartitionContexts[CtxIndex].PartitionData + (UINTN)pContext->PartitionContexts[CtxIndex].PartitionCurrentOffset);
         pDataItem->Signature = PBR_LOGICAL_DATA_SIG;
@@ -163,9 +198,13 @@ PbrSetData(
   pContext->PartitionContexts[CtxIndex].PartitionLogicalDataCnt = 1;
   pContext->PartitionContexts[CtxIndex].PartitionCurrentOffset = 0;
   pContext->PartitionContexts[CtxIndex].PartitionEndOffset = 0;
+  pContext->PartitionContexts[CtxIndex].PartitionView = FALSE;
   pContext->PartitionContexts[CtxIndex].PartitionData = pDataItem = AllocateZeroPool(pContext->PartitionContexts[CtxIndex].PartitionSize);
+  //the first item is at offset 0, the zeroed index already says so
+  pContext->PartitionContexts[CtxIndex].PartitionItemOffsets = AllocateZeroPool(PARTITION_GROW_SZ_MULTIPLIER * sizeof(UINT32));
+  pContext->PartitionContexts[CtxIndex].PartitionItemOffsetsMax = PARTITION_GROW_SZ_MULTIPLIER;
 
-  if (NULL == pContext->PartitionContexts[CtxIndex].PartitionData) {
+  if (NULL == pContext->PartitionContexts[CtxIndex].PartitionData || NULL == pContext->PartitionContexts[CtxIndex].PartitionItemOffsets) {
     ReturnCode = EFI_OUT_OF_RESOURCES;
     NVDIMM_DBG("Failed to allocate memory for partition buffer\n");
     goto Finish;
@@ -201,6 +240,87 @@ Finish:
   return ReturnCode;
 }
 
+/**
+   Gets a view of data from the playback session, without copying it
+
+   @param[in] Signature: Specifies which data type to get
+   @param[in] Index: GET_NEXT_DATA_INDEX gets the next data object within
+      the playback session.  Otherwise, any positive value will result in
+      getting the data object at position 'Index' (base 0).  If data associated
+      with Signature is a Singleton, use Index '0'.
+   @param[out] ppData: Points to the data object within the session. Valid
+      until the session is freed or data is added to the partition.
+   @param[out] pSize: Size in bytes of ppData.
+   @param[out] pLogicalIndex: May be NULL, otherwise will contain the
+      logical index of the data object.
+   @retval EFI_SUCCESS on success
+ **/
+EFI_STATUS
+EFIAPI
+PbrGetDataView(
+  IN UINT32 Signature,
+  IN INT32 Index,
+  OUT CONST VOID **ppData,
+  OUT UINT32 *pSize,
+  OUT UINT32 *pLogicalIndex
+)
+{
+  EFI_STATUS ReturnCode = EFI_NOT_FOUND;
+  PbrPartitionContext *pPartition = NULL;
+  PbrPartitionLogicalDataItem *pDataItem = NULL;
+  UINT32 Offset = 0;
+
+  if (NULL == ppData || NULL == pSize) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  //find the partition associated input param Signature
+  if (EFI_ERROR(PbrGetPartition(Signature, &pPartition))) {
+    goto Finish;
+  }
+
+  //caller wants the next data object within the playback session
+  if (GET_NEXT_DATA_INDEX == Index) {
+    Offset = pPartition->PartitionCurrentOffset;
+  }
+  //caller wants a specific indexed data item, the item offset table gives its position
+  else if (Index >= 0 && (UINT32)Index < pPartition->PartitionLogicalDataCnt) {
+    Offset = pPartition->PartitionItemOffsets[Index];
+  }
+  else {
+    goto Finish;
+  }
+
+  //verify the data item is valid, if not return EFI_NOT_FOUND
+  if (Offset + sizeof(PbrPartitionLogicalDataItem) > PbrPartitionEnd(pPartition)) {
+    goto Finish;
+  }
+  pDataItem = (PbrPartitionLogicalDataItem *)((UINTN)pPartition->PartitionData + (UINTN)Offset);
+  if (PBR_LOGICAL_DATA_SIG != pDataItem->Signature) {
+    goto Finish;
+  }
+  //a corrupted session may claim more data than the partition holds
+  if ((UINT64)Offset + sizeof(*pDataItem) + pDataItem->Size > PbrPartitionEnd(pPartition)) {
+    goto Finish;
+  }
+
+  if (GET_NEXT_DATA_INDEX == Index) {
+    //found it, now advance the current pbr offset so the next time this is called the next logical data item is returned
+    pPartition->PartitionCurrentOffset += (sizeof(PbrPartitionLogicalDataItem) + pDataItem->Size);
+  }
+
+  *ppData = pDataItem->Data;
+  *pSize = pDataItem->Size;
+  //if caller has requested the data item index
+  if (pLogicalIndex) {
+    *pLogicalIndex = pDataItem->LogicalIndex;
+  }
+  ReturnCode = EFI_SUCCESS;
+
+Finish:
+  return ReturnCode;
+}
+
 /**
    Gets data from the playback session
 
@@ -226,62 +346,195 @@ PbrGetData(
   OUT UINT32 *pLogicalIndex
 )
 {
-  UINT32 CtxIndex = 0;
-  UINT32 PartitionCtxIndex = 0;
   EFI_STATUS ReturnCode = EFI_NOT_FOUND;
-  PbrContext *pContext = PBR_CTX();
+  CONST VOID *pView = NULL;
+
+  if (NULL == ppData || NULL == pSize) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  ReturnCode = PbrGetDataView(Signature, Index, &pView, pSize, pLogicalIndex);
+  if (EFI_ERROR(ReturnCode)) {
+    goto Finish;
+  }
+
+  //allocate memory and copy the data to the caller
+  *ppData = AllocateZeroPool(*pSize);
+  if (NULL == *ppData) {
+    ReturnCode = EFI_OUT_OF_RESOURCES;
+    NVDIMM_DBG("Failed to allocate memory for partition buffer\n");
+    goto Finish;
+  }
+  PbrCopyChunks(*ppData, *pSize, (VOID *)pView, *pSize);
+
+Finish:
+  return ReturnCode;
+}
+
+/**
+   Gets a view of the next data object from the playback session that
+   satisfies a caller supplied match, without copying it.
+
+   Unlike GET_NEXT_DATA_INDEX the data objects don't have to be consumed
+   in the order they were recorded. The first unconsumed object at or after
+   the playback offset that matches is returned, and the playback offset only
+   moves past objects once everything in front of them has been consumed.
+   This lets callers that recorded from several threads replay their own
+   streams independently.
+
+   @param[in] Signature: Specifies which data type to get
+   @param[in] pMatch: Called for each candidate data object, returns TRUE
+      to select it
+   @param[in] pMatchCtx: Passed through to pMatch
+   @param[out] ppData: Points to the data object within the session. Valid
+      until the session is freed or data is added to the partition.
+   @param[out] pSize: Size in bytes of ppData.
+   @retval EFI_SUCCESS on success
+   @retval EFI_NOT_FOUND if no unconsumed data object matches
+ **/
+EFI_STATUS
+EFIAPI
+PbrGetMatchingDataView(
+  IN UINT32 Signature,
+  IN PBR_DATA_MATCH pMatch,
+  IN VOID *pMatchCtx,
+  OUT CONST VOID **ppData,
+  OUT UINT32 *pSize
+)
+{
+  EFI_STATUS ReturnCode = EFI_NOT_FOUND;
+  PbrPartitionContext *pPartition = NULL;
   PbrPartitionLogicalDataItem *pDataItem = NULL;
+  UINT32 *pConsumed = NULL;
+  UINT32 Offset = 0;
+  UINT32 EndOffset = 0;
+  UINT32 Index = 0;
+  BOOLEAN Consumed = FALSE;
 
-  //find the partition associated input param Signature
-  for (CtxIndex = 0; CtxIndex < MAX_PARTITIONS; ++CtxIndex) {
-    //if signature matches
-    if (Signature == pContext->PartitionContexts[CtxIndex].PartitionSig) {
-      //caller wants the next data object within the playback session
-      if(GET_NEXT_DATA_INDEX == Index){
-        //get the next logical data item
-        pDataItem = (PbrPartitionLogicalDataItem *)((UINTN)pContext->PartitionContexts[CtxIndex].PartitionData + (UINTN)pContext->PartitionContexts[CtxIndex].PartitionCurrentOffset);
-        //verify the data item is valid, if not return EFI_NOT_FOUND
-        if (PBR_LOGICAL_DATA_SIG != pDataItem->Signature) {
-          goto Finish;
-        }
-        //found it, now advance the current pbr offset so the next time this is called the next logical data item is returned
-        pContext->PartitionContexts[CtxIndex].PartitionCurrentOffset += (sizeof(PbrPartitionLogicalDataItem) + pDataItem->Size);
-        ReturnCode = EFI_SUCCESS;
-      }
-      else {
-        //caller wants a specific indexed data item
-        pDataItem = (PbrPartitionLogicalDataItem *)(pContext->PartitionContexts[CtxIndex].PartitionData);
-        //iterate through all items
-        while (PBR_LOGICAL_DATA_SIG == pDataItem->Signature) {
-          if ((UINT32)Index == PartitionCtxIndex) {
-            ReturnCode = EFI_SUCCESS;
-            break;
-          }
-          pDataItem = (PbrPartitionLogicalDataItem *)((UINTN)pDataItem + (UINTN)pDataItem->Size + sizeof(PbrPartitionLogicalDataItem));
-          ++PartitionCtxIndex;
-        }
+  if (NULL == pMatch || NULL == ppData || NULL == pSize) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  CHECK_RESULT(PbrGetPartition(Signature, &pPartition), Finish);
+
+  //discard items consumed ahead of a playback position that has since moved
+  if (Signature != mPbrLookahead.Signature || pPartition->PartitionCurrentOffset != mPbrLookahead.Base) {
+    mPbrLookahead.Signature = Signature;
+    mPbrLookahead.ConsumedCnt = 0;
+  }
+
+  ReturnCode = EFI_NOT_FOUND;
+  EndOffset = PbrPartitionEnd(pPartition);
+  for (Offset = pPartition->PartitionCurrentOffset;
+    Offset + sizeof(PbrPartitionLogicalDataItem) <= EndOffset;
+    Offset += sizeof(PbrPartitionLogicalDataItem) + pDataItem->Size) {
+    pDataItem = (PbrPartitionLogicalDataItem *)((UINTN)pPartition->PartitionData + (UINTN)Offset);
+    if (PBR_LOGICAL_DATA_SIG != pDataItem->Signature ||
+      (UINT64)Offset + sizeof(*pDataItem) + pDataItem->Size > EndOffset) {
+      break;
+    }
+
+    Consumed = FALSE;
+    for (Index = 0; Index < mPbrLookahead.ConsumedCnt; ++Index) {
+      if (Offset == mPbrLookahead.pConsumed[Index]) {
+        Consumed = TRUE;
+        break;
       }
-      //if indexed item was located, allocate memory and copy the data to the caller
-      if (EFI_SUCCESS == ReturnCode) {
-        *ppData = AllocateZeroPool(pDataItem->Size);
-        if (NULL == *ppData) {
-          ReturnCode = EFI_OUT_OF_RESOURCES;
-          NVDIMM_DBG("Failed to allocate memory for partition buffer\n");
-          goto Finish;
-        }
-        *pSize = pDataItem->Size;
-        PbrCopyChunks(*ppData, *pSize, pDataItem->Data, pDataItem->Size);
-        ReturnCode = EFI_SUCCESS;
+    }
+
+    if (!Consumed && pMatch(pDataItem->Data, pDataItem->Size, pMatchCtx)) {
+      ReturnCode = EFI_SUCCESS;
+      break;
+    }
+  }
+
+  if (EFI_ERROR(ReturnCode)) {
+    goto Finish;
+  }
+
+  if (Offset != pPartition->PartitionCurrentOffset) {
+    //consumed ahead of the playback offset, remember it until the offset catches up
+    if (mPbrLookahead.ConsumedCnt == mPbrLookahead.ConsumedMax) {
+      pConsumed = ReallocatePool(mPbrLookahead.ConsumedMax * sizeof(UINT32),
+        (mPbrLookahead.ConsumedMax + PARTITION_GROW_SZ_MULTIPLIER) * sizeof(UINT32), mPbrLookahead.pConsumed);
+      if (NULL == pConsumed) {
+        ReturnCode = EFI_OUT_OF_RESOURCES;
         goto Finish;
       }
+      mPbrLookahead.pConsumed = pConsumed;
+      mPbrLookahead.ConsumedMax += PARTITION_GROW_SZ_MULTIPLIER;
     }
+    mPbrLookahead.pConsumed[mPbrLookahead.ConsumedCnt++] = Offset;
+  } else {
+    //advance past this item and every item already consumed right behind it
+    do {
+      pPartition->PartitionCurrentOffset += (sizeof(PbrPartitionLogicalDataItem) +
+        ((PbrPartitionLogicalDataItem *)((UINTN)pPartition->PartitionData + (UINTN)pPartition->PartitionCurrentOffset))->Size);
+      Consumed = FALSE;
+      for (Index = 0; Index < mPbrLookahead.ConsumedCnt; ++Index) {
+        if (pPartition->PartitionCurrentOffset == mPbrLookahead.pConsumed[Index]) {
+          mPbrLookahead.pConsumed[Index] = mPbrLookahead.pConsumed[--mPbrLookahead.ConsumedCnt];
+          Consumed = TRUE;
+          break;
+        }
+      }
+    } while (Consumed);
   }
+  mPbrLookahead.Base = pPartition->PartitionCurrentOffset;
+
+  *ppData = pDataItem->Data;
+  *pSize = pDataItem->Size;
 
 Finish:
-  //if caller has requested the data item index
-  if (EFI_SUCCESS == ReturnCode && pLogicalIndex) {
-    *pLogicalIndex = pDataItem->LogicalIndex;
+  return ReturnCode;
+}
+
+/**
+   Gets the next data object from the playback session that satisfies
+   a caller supplied match. See PbrGetMatchingDataView for the order
+   data objects are handed out in.
+
+   @param[in] Signature: Specifies which data type to get
+   @param[in] pMatch: Called for each candidate data object, returns TRUE
+      to select it
+   @param[in] pMatchCtx: Passed through to pMatch
+   @param[out] ppData: Newly allocated buffer that contains the data object.
+      Caller is responsible for freeing it.
+   @param[out] pSize: Size in bytes of ppData.
+   @retval EFI_SUCCESS on success
+   @retval EFI_NOT_FOUND if no unconsumed data object matches
+ **/
+EFI_STATUS
+EFIAPI
+PbrGetMatchingData(
+  IN UINT32 Signature,
+  IN PBR_DATA_MATCH pMatch,
+  IN VOID *pMatchCtx,
+  OUT VOID **ppData,
+  OUT UINT32 *pSize
+)
+{
+  EFI_STATUS ReturnCode = EFI_NOT_FOUND;
+  CONST VOID *pView = NULL;
+
+  if (NULL == ppData || NULL == pSize) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  ReturnCode = PbrGetMatchingDataView(Signature, pMatch, pMatchCtx, &pView, pSize);
+  if (EFI_ERROR(ReturnCode)) {
+    goto Finish;
+  }
+
+  *ppData = AllocateZeroPool(*pSize);
+  if (NULL == *ppData) {
+    ReturnCode = EFI_OUT_OF_RESOURCES;
+    NVDIMM_DBG("Failed to allocate memory for partition buffer\n");
+    goto Finish;
   }
+  PbrCopyChunks(*ppData, *pSize, (VOID *)pView, *pSize);
+
+Finish:
   return ReturnCode;
 }
 
@@ -394,8 +647,9 @@ PbrGetMode(
 /**
   Set the PBR session buffer to use
 
-  @param[in] pBufferAddress: address of a buffer to use for playback or record mode. If NULL new buffers
-    will be created.
+  @param[in] pBufferAddress: address of a buffer to use for playback or record mode, a session
+    container or an image of the previous partition table format. The session takes ownership
+    of the buffer. If NULL new buffers will be created.
   @param[in] BufferSize: size in bytes of the buffer
 
   @retval EFI_SUCCESS if the table was found and is properly returned.
@@ -410,6 +664,8 @@ PbrSetSession(
 {
   EFI_STATUS ReturnCode = EFI_SUCCESS;
   PbrContext *pContext = PBR_CTX();
+  VOID *pSession = NULL;
+  UINT32 SessionSize = 0;
 
   NVDIMM_DBG("PbrSetSession: Addr: 0x%x, Size: %d\n", (UINTN)pBufferAddress, BufferSize);
 
@@ -417,6 +673,7 @@ PbrSetSession(
   ReturnCode = PbrFreeSession();
   if (EFI_ERROR(ReturnCode)) {
     NVDIMM_DBG("Failed to free session!");
+    FREE_POOL_SAFE(pBufferAddress);
     goto Finish;
   }
 
@@ -429,10 +686,28 @@ PbrSetSession(
     }
   }
   else {
-    //unravels PBR image and updates the context
-    ReturnCode = PbrDecomposeSession(pContext, pBufferAddress, BufferSize);
+    //images of the previous format are converted, a session container is used in place
+    if (BufferSize >= sizeof(UINT32) && PBR_HEADER_SIG == *(UINT32 *)pBufferAddress) {
+      ReturnCode = PbrConvertLegacySession(pBufferAddress, BufferSize, &pSession, &SessionSize);
+      FreePool(pBufferAddress);
+      if (EFI_ERROR(ReturnCode)) {
+        NVDIMM_DBG("Failed to convert img!");
+        goto Finish;
+      }
+    }
+    else {
+      pSession = pBufferAddress;
+      SessionSize = BufferSize;
+    }
+
+    //the partitions become views into the session
+    pContext->pSession = pSession;
+    pContext->SessionSize = SessionSize;
+    pContext->SessionMapped = FALSE;
+    ReturnCode = PbrLoadSession(pContext, TRUE);
     if (EFI_ERROR(ReturnCode)) {
-      NVDIMM_DBG("Failed to unstich img!");
+      NVDIMM_DBG("Failed to load session!");
+      PbrFreeSession();
       goto Finish;
     }
   }
@@ -501,19 +776,15 @@ EFIAPI
 PbrFreeSession(
 )
 {
-  UINT32 CtxIndex = 0;
   PbrContext *pContext = PBR_CTX();
 
-  for (CtxIndex = 0; CtxIndex < MAX_PARTITIONS; ++CtxIndex) {
-    if (PBR_INVALID_SIG != pContext->PartitionContexts[CtxIndex].PartitionSig) {
-      if (pContext->PartitionContexts[CtxIndex].PartitionData) {
-        FreePool(pContext->PartitionContexts[CtxIndex].PartitionData);
-      }
-      pContext->PartitionContexts[CtxIndex].PartitionSig = PBR_INVALID_SIG;
-    }
-  }
+  //partitions first, they may be views into the session
+  PbrFreePartitions(pContext);
+  PbrReleaseSession(pContext);
 
   FREE_POOL_SAFE(pContext->PbrMainHeader);
+  FREE_POOL_SAFE(mPbrLookahead.pConsumed);
+  ZeroMem(&mPbrLookahead, sizeof(mPbrLookahead));
   return EFI_SUCCESS;
 }
 
@@ -528,20 +799,20 @@ PbrResetSession(
   IN     UINT32 TagId
 )
 {
-  Tag *pTag = NULL;
+  CONST Tag *pTag = NULL;
   UINT32 DataSize = 0;
   PbrContext *pContext = PBR_CTX();
   EFI_STATUS ReturnCode = EFI_SUCCESS;
-  TagPartitionInfo *pTagPartitions = NULL;
+  CONST TagPartitionInfo *pTagPartitions = NULL;
   UINT32 CtxIndex = 0;
   UINT32 TagPartIndex = 0;
 
   //get the actual tag data item
   //this will contain offsets for all data partitions that existed when the tag was set/created
-  ReturnCode = PbrGetData(
+  ReturnCode = PbrGetDataView(
     PBR_TAG_SIG,
     TagId,
-    (VOID**)&pTag,
+    (CONST VOID**)&pTag,
     &DataSize,
     NULL);
 
@@ -552,7 +823,7 @@ PbrResetSession(
 
   //immediately following the tag struct is a series of TagPartitionInfo objects
   //where each object describes one data partition
-  pTagPartitions = (TagPartitionInfo*)((UINTN)pTag + sizeof(Tag));
+  pTagPartitions = (CONST TagPartitionInfo*)((UINTN)pTag + sizeof(Tag));
 
   //need to reset each data partition to the offset specified in the tag
   for (CtxIndex = 0; CtxIndex < MAX_PARTITIONS; ++CtxIndex) {
@@ -570,7 +841,6 @@ PbrResetSession(
     }
   }
 Finish:
-  FREE_POOL_SAFE(pTag);
   return ReturnCode;
 }
 
@@ -722,7 +992,7 @@ PbrGetTag(
   OUT    VOID **ppTagPartitionInfo,
   OUT    UINT32 *pTagPartitionCnt
 ) {
-  Tag *pTag = NULL;
+  CONST Tag *pTag = NULL;
   CHAR8 *pTagStrs = NULL;
   UINT32 pTagStrsSize = 0;
   EFI_STATUS ReturnCode = EFI_SUCCESS;
@@ -732,10 +1002,10 @@ PbrGetTag(
     return EFI_INVALID_PARAMETER;
   }
 
-  ReturnCode = PbrGetData(
+  ReturnCode = PbrGetDataView(
     PBR_TAG_SIG,
     Id,
-    (VOID**)&pTag,
+    (CONST VOID**)&pTag,
     &DataSize,
     NULL);
 
@@ -772,7 +1042,6 @@ PbrGetTag(
   }
 
 Finish:
-  FREE_POOL_SAFE(pTag);
   return ReturnCode;
 }
 
@@ -824,6 +1093,238 @@ PbrUninit(
   return ReturnCode;
 }
 
+/**
+  Write the session of a context as a session container, front to back
+
+  @param[in] pContext: Pbr context
+  @param[in] pWrite: Called for each piece of the container, in order
+  @param[in] pWriteCtx: Passed through to pWrite
+
+  @retval EFI_SUCCESS if the container was written
+  @retval EFI_NOT_READY if the context has no session
+**/
+EFI_STATUS
+PbrWriteSession(
+  IN     PbrContext *pContext,
+  IN     PBR_SESSION_WRITE pWrite,
+  IN     VOID *pWriteCtx
+)
+{
+  STATIC CONST UINT8 Padding[PBR_SESSION_ALIGNMENT] = { 0 };
+  EFI_STATUS ReturnCode = EFI_SUCCESS;
+  PbrSessionHeader Header;
+  PbrSessionPartition *pDirectory = NULL;
+  PbrSessionPartition *pEntry = NULL;
+  PbrPartitionContext *pPartition = NULL;
+  UINT64 Position = 0;
+  UINT32 CtxIndex = 0;
+
+  if (NULL == pContext || NULL == pWrite) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  ReturnCode = PbrSessionLayout(pContext, &Header, &pDirectory);
+  if (EFI_ERROR(ReturnCode)) {
+    goto Finish;
+  }
+
+  CHECK_RESULT(pWrite(pWriteCtx, &Header, sizeof(Header)), Finish);
+  CHECK_RESULT(pWrite(pWriteCtx, Padding, Header.DirectoryOffset - sizeof(Header)), Finish);
+  CHECK_RESULT(pWrite(pWriteCtx, pDirectory, Header.PartitionCnt * sizeof(PbrSessionPartition)), Finish);
+  Position = Header.DirectoryOffset + Header.PartitionCnt * sizeof(PbrSessionPartition);
+
+  //the sections follow in directory order, which is the partition order
+  pEntry = pDirectory;
+  for (CtxIndex = 0; CtxIndex < MAX_PARTITIONS; ++CtxIndex) {
+    pPartition = &pContext->PartitionContexts[CtxIndex];
+    if (PBR_INVALID_SIG == pPartition->PartitionSig) {
+      continue;
+    }
+    CHECK_RESULT(pWrite(pWriteCtx, Padding, pEntry->ItemTableOffset - Position), Finish);
+    CHECK_RESULT(pWrite(pWriteCtx, pPartition->PartitionItemOffsets, pEntry->LogicalDataCnt * sizeof(UINT32)), Finish);
+    Position = pEntry->ItemTableOffset + pEntry->LogicalDataCnt * sizeof(UINT32);
+    CHECK_RESULT(pWrite(pWriteCtx, Padding, pEntry->DataOffset - Position), Finish);
+    CHECK_RESULT(pWrite(pWriteCtx, pPartition->PartitionData, pEntry->DataSize), Finish);
+    Position = pEntry->DataOffset + pEntry->DataSize;
+    ++pEntry;
+  }
+
+Finish:
+  FREE_POOL_SAFE(pDirectory);
+  return ReturnCode;
+}
+
+/**
+  Load the session container pContext->pSession into the context. The partitions
+  become views into the container, nothing is copied.
+
+  @param[in, out] pContext: Pbr context, the partitions must be free
+  @param[in] VerifyData: Also verify the partition data checksums and items. The
+    header, directory and item offset tables are always verified.
+
+  @retval EFI_SUCCESS if the session was loaded
+  @retval EFI_INVALID_PARAMETER if the buffer is not a session container
+  @retval EFI_INCOMPATIBLE_VERSION if the container version is not supported
+  @retval EFI_COMPROMISED_DATA if the container is truncated or a checksum mismatches
+**/
+EFI_STATUS
+PbrLoadSession(
+  IN OUT PbrContext *pContext,
+  IN     BOOLEAN VerifyData
+)
+{
+  PbrSessionHeader *pHeader = NULL;
+  PbrSessionPartition *pEntry = NULL;
+  PbrPartitionContext *pPartition = NULL;
+  PbrPartitionLogicalDataItem *pDataItem = NULL;
+  PbrHeader *pPbrMainHeader = NULL;
+  UINT32 *pItemOffsets = NULL;
+  UINT32 PartitionIndex = 0;
+  UINT32 ItemIndex = 0;
+
+  if (NULL == pContext || NULL == pContext->pSession) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  pHeader = (PbrSessionHeader *)pContext->pSession;
+  if (pContext->SessionSize < sizeof(PbrSessionHeader) || PBR_SESSION_SIG != pHeader->Signature) {
+    NVDIMM_DBG("Invalid buffer contents, PBR session header not found!\n");
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if (PBR_SESSION_VERSION_MAJOR != pHeader->VersionMajor) {
+    NVDIMM_ERR("Unsupported PBR session version %d.%d\n", pHeader->VersionMajor, pHeader->VersionMinor);
+    return EFI_INCOMPATIBLE_VERSION;
+  }
+
+  if (pHeader->HeaderChecksum != Fletcher64(pHeader, OFFSET_OF(PbrSessionHeader, HeaderChecksum))) {
+    NVDIMM_ERR("Pbr integrity check failed: session header checksum mismatch\n");
+    return EFI_COMPROMISED_DATA;
+  }
+
+  if (pHeader->SessionSize > pContext->SessionSize || pHeader->PartitionCnt > MAX_PARTITIONS ||
+    !PbrSessionRangeValid(pHeader->DirectoryOffset, pHeader->PartitionCnt * sizeof(PbrSessionPartition), pHeader->SessionSize) ||
+    pHeader->DirectoryChecksum != Fletcher64((UINT8 *)pHeader + pHeader->DirectoryOffset, pHeader->PartitionCnt * sizeof(PbrSessionPartition))) {
+    NVDIMM_ERR("Pbr integrity check failed: session truncated or partition directory invalid\n");
+    return EFI_COMPROMISED_DATA;
+  }
+
+  //verify everything before touching the context
+  for (PartitionIndex = 0; PartitionIndex < pHeader->PartitionCnt; ++PartitionIndex) {
+    pEntry = (PbrSessionPartition *)((UINT8 *)pHeader + pHeader->DirectoryOffset) + PartitionIndex;
+    if (PBR_INVALID_SIG == pEntry->Signature || pEntry->DataSize > MAX_UINT32 ||
+      0 != pEntry->ItemTableOffset % sizeof(UINT32) ||
+      !PbrSessionRangeValid(pEntry->ItemTableOffset, pEntry->LogicalDataCnt * sizeof(UINT32), pHeader->SessionSize) ||
+      !PbrSessionRangeValid(pEntry->DataOffset, pEntry->DataSize, pHeader->SessionSize)) {
+      NVDIMM_ERR("Pbr integrity check failed: partition 0x%x out of bounds\n", pEntry->Signature);
+      return EFI_COMPROMISED_DATA;
+    }
+
+    pItemOffsets = (UINT32 *)((UINT8 *)pHeader + pEntry->ItemTableOffset);
+    if (pEntry->ItemTableChecksum != Fletcher64(pItemOffsets, pEntry->LogicalDataCnt * sizeof(UINT32))) {
+      NVDIMM_ERR("Pbr integrity check failed: partition 0x%x index checksum mismatch\n", pEntry->Signature);
+      return EFI_COMPROMISED_DATA;
+    }
+
+    if (!VerifyData) {
+      continue;
+    }
+
+    if (pEntry->DataChecksum != Fletcher64((UINT8 *)pHeader + pEntry->DataOffset, pEntry->DataSize)) {
+      NVDIMM_ERR("Pbr integrity check failed: partition 0x%x data checksum mismatch\n", pEntry->Signature);
+      return EFI_COMPROMISED_DATA;
+    }
+
+    for (ItemIndex = 0; ItemIndex < pEntry->LogicalDataCnt; ++ItemIndex) {
+      pDataItem = (PbrPartitionLogicalDataItem *)((UINT8 *)pHeader + pEntry->DataOffset + pItemOffsets[ItemIndex]);
+      if ((UINT64)pItemOffsets[ItemIndex] + sizeof(PbrPartitionLogicalDataItem) > pEntry->DataSize ||
+        PBR_LOGICAL_DATA_SIG != pDataItem->Signature ||
+        (UINT64)pItemOffsets[ItemIndex] + sizeof(PbrPartitionLogicalDataItem) + pDataItem->Size > pEntry->DataSize) {
+        NVDIMM_ERR("Pbr integrity check failed: partition 0x%x item %d invalid\n", pEntry->Signature, ItemIndex);
+        return EFI_COMPROMISED_DATA;
+      }
+    }
+  }
+
+  pPbrMainHeader = (PbrHeader *)AllocateZeroPool(sizeof(PbrHeader));
+  if (NULL == pPbrMainHeader) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+  pPbrMainHeader->Signature = PBR_HEADER_SIG;
+  CopyMem_S(pPbrMainHeader->SwVersion, sizeof(pPbrMainHeader->SwVersion), pHeader->SwVersion, sizeof(pHeader->SwVersion));
+  CopyMem_S(pPbrMainHeader->OsVersion, sizeof(pPbrMainHeader->OsVersion), pHeader->OsVersion, sizeof(pHeader->OsVersion));
+  CopyMem_S(pPbrMainHeader->OsName, sizeof(pPbrMainHeader->OsName), pHeader->OsName, sizeof(pHeader->OsName));
+  CopyMem_S(pPbrMainHeader->Description, sizeof(pPbrMainHeader->Description), pHeader->Description, sizeof(pHeader->Description));
+  FREE_POOL_SAFE(pContext->PbrMainHeader);
+  pContext->PbrMainHeader = pPbrMainHeader;
+
+  ZeroMem(pContext->PartitionContexts, sizeof(pContext->PartitionContexts));
+  for (PartitionIndex = 0; PartitionIndex < pHeader->PartitionCnt; ++PartitionIndex) {
+    pEntry = (PbrSessionPartition *)((UINT8 *)pHeader + pHeader->DirectoryOffset) + PartitionIndex;
+    pPartition = &pContext->PartitionContexts[PartitionIndex];
+    pPartition->PartitionSig = pEntry->Signature;
+    pPartition->PartitionSize = (UINT32)pEntry->DataSize;
+    pPartition->PartitionLogicalDataCnt = pEntry->LogicalDataCnt;
+    pPartition->PartitionCurrentOffset = 0;
+    pPartition->PartitionEndOffset = 0;
+    pPartition->PartitionData = (UINT8 *)pHeader + pEntry->DataOffset;
+    pPartition->PartitionItemOffsets = (UINT32 *)((UINT8 *)pHeader + pEntry->ItemTableOffset);
+    pPartition->PartitionItemOffsetsMax = pEntry->LogicalDataCnt;
+    pPartition->PartitionView = TRUE;
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Convert an image of the previous partition table format (PbrHeader followed
+  by the partitions) to a session container
+
+  @param[in] pImage: Image to convert
+  @param[in] ImageSize: Size in bytes of pImage
+  @param[out] ppSession: Newly allocated session container, caller is responsible for freeing it
+  @param[out] pSessionSize: Size in bytes of ppSession
+
+  @retval EFI_SUCCESS if the image was converted
+  @retval EFI_INVALID_PARAMETER if the image is not in the previous format
+  @retval EFI_COMPROMISED_DATA if the image is truncated
+**/
+EFI_STATUS
+PbrConvertLegacySession(
+  IN     VOID *pImage,
+  IN     UINT32 ImageSize,
+  OUT    VOID **ppSession,
+  OUT    UINT32 *pSessionSize
+)
+{
+  EFI_STATUS ReturnCode = EFI_SUCCESS;
+  PbrContext *pLegacyContext = NULL;
+
+  if (NULL == pImage || NULL == ppSession || NULL == pSessionSize) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  //the image is unstitched into buffers of its own, which are then written as a container
+  pLegacyContext = AllocateZeroPool(sizeof(PbrContext));
+  if (NULL == pLegacyContext) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  ReturnCode = PbrDecomposeLegacySession(pLegacyContext, pImage, ImageSize);
+  if (EFI_ERROR(ReturnCode)) {
+    NVDIMM_DBG("Failed to unstich img!");
+    goto Finish;
+  }
+
+  ReturnCode = PbrComposeSession(pLegacyContext, ppSession, pSessionSize);
+
+Finish:
+  PbrFreePartitions(pLegacyContext);
+  FREE_POOL_SAFE(pLegacyContext->PbrMainHeader);
+  FreePool(pLegacyContext);
+  return ReturnCode;
+}
+
 #ifndef OS_BUILD //Implementation for OS in PbrOs.c
 /**
   Helper that restores the context.  At this point the context is only saved to a volatile store.
@@ -891,13 +1392,25 @@ PbrDeserializeCtx(
 Finish:
   return ReturnCode;
 }
+
+/**
+  Helper that releases the loaded session container.  Sessions are only loaded from memory here.
+**/
+STATIC
+VOID
+PbrReleaseSession(
+  PbrContext *ctx) {
+  FREE_POOL_SAFE(ctx->pSession);
+  ctx->SessionSize = 0;
+  ctx->SessionMapped = FALSE;
+}
 #endif
 /**
-  Helper that decomposes/unstitches a PBR session
+  Helper that unstitches an image of the previous partition table format
 **/
 STATIC
 EFI_STATUS
-PbrDecomposeSession(
+PbrDecomposeLegacySession(
   IN     PbrContext *pContext,
   IN     VOID *pPbrImg,
   IN     UINT32 PbrImgSize
@@ -911,6 +1424,12 @@ PbrDecomposeSession(
 
   ZeroMem(pContext->PartitionContexts, sizeof(pContext->PartitionContexts));
 
+  if (PbrImgSize < sizeof(PbrHeader)) {
+    ReturnCode = EFI_INVALID_PARAMETER;
+    NVDIMM_DBG("Invalid buffer contents, PBR master header not found!\n");
+    goto Finish;
+  }
+
   //update context's file header
   pContext->PbrMainHeader = (PbrHeader*)AllocateZeroPool(sizeof(PbrHeader));
   if (NULL == pContext->PbrMainHeader) {
@@ -929,6 +1448,11 @@ PbrDecomposeSession(
 
   for (PartitionIndex = 0; PartitionIndex < MAX_PARTITIONS; ++PartitionIndex) {
     if (PBR_INVALID_SIG != pPartitionTable->Partitions[PartitionIndex].Signature) {
+      if (!PbrSessionRangeValid(pPartitionTable->Partitions[PartitionIndex].Offset, pPartitionTable->Partitions[PartitionIndex].Size, PbrImgSize)) {
+        ReturnCode = EFI_COMPROMISED_DATA;
+        NVDIMM_ERR("Pbr integrity check failed: partition 0x%x out of bounds\n", pPartitionTable->Partitions[PartitionIndex].Signature);
+        goto Finish;
+      }
       pContext->PartitionContexts[PartitionIndex].PartitionSig = pPartitionTable->Partitions[PartitionIndex].Signature;
       pContext->PartitionContexts[PartitionIndex].PartitionSize = pPartitionTable->Partitions[PartitionIndex].Size;
       pContext->PartitionContexts[PartitionIndex].PartitionLogicalDataCnt = pPartitionTable->Partitions[PartitionIndex].LogicalDataCnt;
@@ -944,6 +1468,11 @@ PbrDecomposeSession(
         pPartitionTable->Partitions[PartitionIndex].Size,
         (VOID*)((UINTN)pPbrImg + pPartitionTable->Partitions[PartitionIndex].Offset),
         pPartitionTable->Partitions[PartitionIndex].Size);
+      //the previous format has no item offset table, build it
+      ReturnCode = PbrIndexPartition(&pContext->PartitionContexts[PartitionIndex]);
+      if (EFI_ERROR(ReturnCode)) {
+        goto Finish;
+      }
     }
   }
 
@@ -952,7 +1481,117 @@ Finish:
 }
 
 /**
-  Helper that stitches together all buffers to make a full PBR image
+  Helper that lays out the session container of a context, filling in its
+  header and partition directory
+**/
+STATIC
+EFI_STATUS
+PbrSessionLayout(
+  IN     PbrContext *pContext,
+  OUT    PbrSessionHeader *pHeader,
+  OUT    PbrSessionPartition **ppDirectory
+)
+{
+  PbrHeader *pPbrMainHeader = (PbrHeader *)pContext->PbrMainHeader;
+  PbrPartitionContext *pPartition = NULL;
+  PbrSessionPartition *pEntry = NULL;
+  UINT64 Position = 0;
+  UINT32 PartitionCnt = 0;
+  UINT32 CtxIndex = 0;
+
+  if (NULL == pPbrMainHeader) {
+    NVDIMM_DBG("No PBR session\n");
+    return EFI_NOT_READY;
+  }
+
+  for (CtxIndex = 0; CtxIndex < MAX_PARTITIONS; ++CtxIndex) {
+    if (PBR_INVALID_SIG != pContext->PartitionContexts[CtxIndex].PartitionSig) {
+      ++PartitionCnt;
+    }
+  }
+
+  *ppDirectory = AllocateZeroPool(MAX(PartitionCnt, 1) * sizeof(PbrSessionPartition));
+  if (NULL == *ppDirectory) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  ZeroMem(pHeader, sizeof(*pHeader));
+  pHeader->Signature = PBR_SESSION_SIG;
+  pHeader->VersionMajor = PBR_SESSION_VERSION_MAJOR;
+  pHeader->VersionMinor = PBR_SESSION_VERSION_MINOR;
+  pHeader->HeaderSize = sizeof(PbrSessionHeader);
+  pHeader->PartitionCnt = PartitionCnt;
+  CopyMem_S(pHeader->SwVersion, sizeof(pHeader->SwVersion), pPbrMainHeader->SwVersion, sizeof(pPbrMainHeader->SwVersion));
+  CopyMem_S(pHeader->OsVersion, sizeof(pHeader->OsVersion), pPbrMainHeader->OsVersion, sizeof(pPbrMainHeader->OsVersion));
+  CopyMem_S(pHeader->OsName, sizeof(pHeader->OsName), pPbrMainHeader->OsName, sizeof(pPbrMainHeader->OsName));
+  CopyMem_S(pHeader->Description, sizeof(pHeader->Description), pPbrMainHeader->Description, sizeof(pPbrMainHeader->Description));
+
+  Position = ALIGN_VALUE(sizeof(PbrSessionHeader), PBR_SESSION_ALIGNMENT);
+  pHeader->DirectoryOffset = Position;
+  Position += PartitionCnt * sizeof(PbrSessionPartition);
+
+  //each partition: item offset table, then the items themselves without the unused tail of the buffer
+  pEntry = *ppDirectory;
+  for (CtxIndex = 0; CtxIndex < MAX_PARTITIONS; ++CtxIndex) {
+    pPartition = &pContext->PartitionContexts[CtxIndex];
+    if (PBR_INVALID_SIG == pPartition->PartitionSig) {
+      continue;
+    }
+    pEntry->Signature = pPartition->PartitionSig;
+    pEntry->LogicalDataCnt = pPartition->PartitionLogicalDataCnt;
+    Position = ALIGN_VALUE(Position, PBR_SESSION_ALIGNMENT);
+    pEntry->ItemTableOffset = Position;
+    Position += pEntry->LogicalDataCnt * sizeof(UINT32);
+    Position = ALIGN_VALUE(Position, PBR_SESSION_ALIGNMENT);
+    pEntry->DataOffset = Position;
+    pEntry->DataSize = PbrPartitionEnd(pPartition);
+    Position += pEntry->DataSize;
+    pEntry->ItemTableChecksum = Fletcher64(pPartition->PartitionItemOffsets, pEntry->LogicalDataCnt * sizeof(UINT32));
+    pEntry->DataChecksum = Fletcher64(pPartition->PartitionData, pEntry->DataSize);
+    ++pEntry;
+  }
+
+  pHeader->SessionSize = Position;
+  pHeader->DirectoryChecksum = Fletcher64(*ppDirectory, PartitionCnt * sizeof(PbrSessionPartition));
+  pHeader->HeaderChecksum = Fletcher64(pHeader, OFFSET_OF(PbrSessionHeader, HeaderChecksum));
+  return EFI_SUCCESS;
+}
+
+/**
+  Memory buffer a session container is composed into
+**/
+typedef struct _PBR_SESSION_BUFFER {
+  UINT8 *pBuffer;
+  UINT64 Size;
+  UINT64 Offset;
+} PBR_SESSION_BUFFER;
+
+/**
+  Helper that appends a piece of a session container to the PBR_SESSION_BUFFER passed as pWriteCtx
+**/
+STATIC
+EFI_STATUS
+PbrWriteSessionBuffer(
+  IN     VOID *pWriteCtx,
+  IN     CONST VOID *pData,
+  IN     UINT64 Size
+)
+{
+  PBR_SESSION_BUFFER *pSessionBuffer = (PBR_SESSION_BUFFER *)pWriteCtx;
+
+  if (Size > pSessionBuffer->Size - pSessionBuffer->Offset) {
+    return EFI_BUFFER_TOO_SMALL;
+  }
+  if (Size) {
+    PbrCopyChunks(pSessionBuffer->pBuffer + pSessionBuffer->Offset, (UINT32)(pSessionBuffer->Size - pSessionBuffer->Offset),
+      (VOID *)pData, (UINT32)Size);
+  }
+  pSessionBuffer->Offset += Size;
+  return EFI_SUCCESS;
+}
+
+/**
+  Helper that stitches together all buffers to make a full PBR image, a session container
 **/
 STATIC
 EFI_STATUS
@@ -962,10 +1601,10 @@ PbrComposeSession(
   OUT    UINT32 *pBufferSize
 )
 {
-  PbrHeader *pPbrMainHeader = NULL;
-  UINT32 BufferSize = 0;
-  UINT8 *pTemp = NULL;
-  UINT32 CtxIndex = 0;
+  EFI_STATUS ReturnCode = EFI_SUCCESS;
+  PbrSessionHeader Header;
+  PbrSessionPartition *pDirectory = NULL;
+  PBR_SESSION_BUFFER SessionBuffer;
 
   if (NULL == pContext) {
     NVDIMM_DBG("No PBR context\n");
@@ -976,41 +1615,34 @@ PbrComposeSession(
     return EFI_INVALID_PARAMETER;
   }
 
-  pPbrMainHeader = (PbrHeader *)pContext->PbrMainHeader;
-  ZeroMem(&pPbrMainHeader->PartitionTable, sizeof(PbrPartitionTable));
-  BufferSize = sizeof(PbrHeader);
-
-  for (CtxIndex = 0; CtxIndex < MAX_PARTITIONS; ++CtxIndex) {
-    if (PBR_INVALID_SIG != pContext->PartitionContexts[CtxIndex].PartitionSig) {
-      pPbrMainHeader->PartitionTable.Partitions[CtxIndex].Signature = pContext->PartitionContexts[CtxIndex].PartitionSig;
-      pPbrMainHeader->PartitionTable.Partitions[CtxIndex].Size = pContext->PartitionContexts[CtxIndex].PartitionSize;
-      pPbrMainHeader->PartitionTable.Partitions[CtxIndex].LogicalDataCnt = pContext->PartitionContexts[CtxIndex].PartitionLogicalDataCnt;
-      pPbrMainHeader->PartitionTable.Partitions[CtxIndex].Offset = BufferSize;
-      BufferSize += pContext->PartitionContexts[CtxIndex].PartitionSize;
-    }
+  //the layout gives the size up front
+  ReturnCode = PbrSessionLayout(pContext, &Header, &pDirectory);
+  FREE_POOL_SAFE(pDirectory);
+  if (EFI_ERROR(ReturnCode)) {
+    return ReturnCode;
   }
 
-  *ppBufferAddress = AllocateZeroPool(BufferSize);
-  NVDIMM_DBG("StitchImg: buffersize = %d bytes\n", BufferSize);
-  if (NULL != *ppBufferAddress) {
-    pPbrMainHeader = (PbrHeader*)*ppBufferAddress;
-    //copy the main pbr header to the buffer
-    PbrCopyChunks(*ppBufferAddress, BufferSize, pContext->PbrMainHeader, sizeof(PbrHeader));
-    //advance past the main header, this will be copied at the end
-    pTemp = (VOID*)((UINTN)(*ppBufferAddress) + (UINTN)sizeof(PbrHeader));
-    NVDIMM_DBG("Copying main header: %d bytes\n", sizeof(PbrHeader));
-
-    for (CtxIndex = 0; CtxIndex < MAX_PARTITIONS; ++CtxIndex) {
-      if (PBR_INVALID_SIG != pContext->PartitionContexts[CtxIndex].PartitionSig) {
-        PbrCopyChunks(pTemp, BufferSize, pContext->PartitionContexts[CtxIndex].PartitionData, pContext->PartitionContexts[CtxIndex].PartitionSize);
-        pTemp += pContext->PartitionContexts[CtxIndex].PartitionSize;
-      }
-    }
-    *pBufferSize = BufferSize;
+  if (Header.SessionSize > MAX_UINT32) {
+    NVDIMM_ERR("PBR session of %lld bytes is too large for a single buffer\n", Header.SessionSize);
+    return EFI_BAD_BUFFER_SIZE;
   }
-  else {
+
+  ZeroMem(&SessionBuffer, sizeof(SessionBuffer));
+  SessionBuffer.Size = Header.SessionSize;
+  SessionBuffer.pBuffer = AllocateZeroPool((UINTN)SessionBuffer.Size);
+  NVDIMM_DBG("StitchImg: buffersize = %d bytes\n", (UINT32)SessionBuffer.Size);
+  if (NULL == SessionBuffer.pBuffer) {
     return EFI_OUT_OF_RESOURCES;
   }
+
+  ReturnCode = PbrWriteSession(pContext, PbrWriteSessionBuffer, &SessionBuffer);
+  if (EFI_ERROR(ReturnCode)) {
+    FreePool(SessionBuffer.pBuffer);
+    return ReturnCode;
+  }
+
+  *ppBufferAddress = SessionBuffer.pBuffer;
+  *pBufferSize = (UINT32)SessionBuffer.Size;
   return EFI_SUCCESS;
 }
 
@@ -1113,6 +1745,172 @@ PbrGetPartition(
   return ReturnCode;
 }
 
+/**
+  Helper that checks a range lies within a session container of SessionSize bytes
+**/
+STATIC
+BOOLEAN
+PbrSessionRangeValid(
+  IN UINT64 Offset,
+  IN UINT64 Length,
+  IN UINT64 SessionSize
+)
+{
+  return Offset <= SessionSize && Length <= SessionSize - Offset;
+}
+
+/**
+  Helper that provides the end of the last logical data item of a partition,
+  the rest of the partition buffer is unused
+**/
+STATIC
+UINT32
+PbrPartitionEnd(
+  IN PbrPartitionContext *pPartition
+)
+{
+  PbrPartitionLogicalDataItem *pDataItem = NULL;
+  UINT32 LastOffset = 0;
+
+  if (0 == pPartition->PartitionLogicalDataCnt || NULL == pPartition->PartitionItemOffsets) {
+    return 0;
+  }
+  LastOffset = pPartition->PartitionItemOffsets[pPartition->PartitionLogicalDataCnt - 1];
+  if ((UINT64)LastOffset + sizeof(PbrPartitionLogicalDataItem) > pPartition->PartitionSize) {
+    return pPartition->PartitionSize;
+  }
+  pDataItem = (PbrPartitionLogicalDataItem *)((UINTN)pPartition->PartitionData + (UINTN)LastOffset);
+  return (UINT32)MIN((UINT64)LastOffset + sizeof(PbrPartitionLogicalDataItem) + pDataItem->Size, pPartition->PartitionSize);
+}
+
+/**
+  Helper that adds an entry to the item offset table of a partition, for the
+  logical data item about to become PartitionLogicalDataCnt
+**/
+STATIC
+EFI_STATUS
+PbrAppendItemOffset(
+  IN OUT PbrPartitionContext *pPartition,
+  IN     UINT32 Offset
+)
+{
+  UINT32 *pItemOffsets = NULL;
+  UINT32 ItemOffsetsMax = 0;
+
+  if (pPartition->PartitionLogicalDataCnt >= pPartition->PartitionItemOffsetsMax) {
+    ItemOffsetsMax = MAX(pPartition->PartitionItemOffsetsMax * 2, PARTITION_GROW_SZ_MULTIPLIER);
+    pItemOffsets = ReallocatePool(pPartition->PartitionItemOffsetsMax * sizeof(UINT32),
+      ItemOffsetsMax * sizeof(UINT32), pPartition->PartitionItemOffsets);
+    if (NULL == pItemOffsets) {
+      NVDIMM_DBG("Failed to allocate memory for partition index\n");
+      return EFI_OUT_OF_RESOURCES;
+    }
+    pPartition->PartitionItemOffsets = pItemOffsets;
+    pPartition->PartitionItemOffsetsMax = ItemOffsetsMax;
+  }
+  pPartition->PartitionItemOffsets[pPartition->PartitionLogicalDataCnt] = Offset;
+  return EFI_SUCCESS;
+}
+
+/**
+  Helper that builds the item offset table of a partition by walking its items
+**/
+STATIC
+EFI_STATUS
+PbrIndexPartition(
+  IN OUT PbrPartitionContext *pPartition
+)
+{
+  EFI_STATUS ReturnCode = EFI_SUCCESS;
+  PbrPartitionLogicalDataItem *pDataItem = NULL;
+  UINT32 LogicalDataCnt = pPartition->PartitionLogicalDataCnt;
+  UINT32 Offset = 0;
+
+  pPartition->PartitionLogicalDataCnt = 0;
+
+  //the recorded count bounds the walk, a singleton that shrank leaves stale bytes behind its item
+  while (pPartition->PartitionLogicalDataCnt < LogicalDataCnt &&
+    (UINT64)Offset + sizeof(PbrPartitionLogicalDataItem) <= pPartition->PartitionSize) {
+    pDataItem = (PbrPartitionLogicalDataItem *)((UINTN)pPartition->PartitionData + (UINTN)Offset);
+    if (PBR_LOGICAL_DATA_SIG != pDataItem->Signature ||
+      (UINT64)Offset + sizeof(PbrPartitionLogicalDataItem) + pDataItem->Size > pPartition->PartitionSize) {
+      break;
+    }
+    ReturnCode = PbrAppendItemOffset(pPartition, Offset);
+    if (EFI_ERROR(ReturnCode)) {
+      return ReturnCode;
+    }
+    pPartition->PartitionLogicalDataCnt++;
+    Offset += sizeof(PbrPartitionLogicalDataItem) + pDataItem->Size;
+  }
+
+  if (pPartition->PartitionLogicalDataCnt != LogicalDataCnt) {
+    NVDIMM_WARN("Partition 0x%x holds %d of %d logical data items\n",
+      pPartition->PartitionSig, pPartition->PartitionLogicalDataCnt, LogicalDataCnt);
+  }
+  return EFI_SUCCESS;
+}
+
+/**
+  Helper that gives a partition buffers of its own when it is a view into the loaded session
+**/
+STATIC
+EFI_STATUS
+PbrOwnPartition(
+  IN OUT PbrPartitionContext *pPartition
+)
+{
+  VOID *pData = NULL;
+  UINT32 *pItemOffsets = NULL;
+  UINT32 ItemOffsetsMax = 0;
+
+  if (!pPartition->PartitionView) {
+    return EFI_SUCCESS;
+  }
+
+  ItemOffsetsMax = MAX(pPartition->PartitionLogicalDataCnt, PARTITION_GROW_SZ_MULTIPLIER);
+  pData = AllocateZeroPool(MAX(pPartition->PartitionSize, (UINT32)sizeof(PbrPartitionLogicalDataItem)));
+  pItemOffsets = AllocateZeroPool(ItemOffsetsMax * sizeof(UINT32));
+  if (NULL == pData || NULL == pItemOffsets) {
+    FREE_POOL_SAFE(pData);
+    FREE_POOL_SAFE(pItemOffsets);
+    NVDIMM_DBG("Failed to allocate memory for partition buffer\n");
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  PbrCopyChunks(pData, pPartition->PartitionSize, pPartition->PartitionData, pPartition->PartitionSize);
+  PbrCopyChunks(pItemOffsets, ItemOffsetsMax * sizeof(UINT32), pPartition->PartitionItemOffsets,
+    pPartition->PartitionLogicalDataCnt * sizeof(UINT32));
+  pPartition->PartitionData = pData;
+  pPartition->PartitionItemOffsets = pItemOffsets;
+  pPartition->PartitionItemOffsetsMax = ItemOffsetsMax;
+  pPartition->PartitionView = FALSE;
+  return EFI_SUCCESS;
+}
+
+/**
+  Helper that frees the buffers of every partition of a context
+**/
+STATIC
+VOID
+PbrFreePartitions(
+  IN OUT PbrContext *pContext
+)
+{
+  UINT32 CtxIndex = 0;
+
+  for (CtxIndex = 0; CtxIndex < MAX_PARTITIONS; ++CtxIndex) {
+    if (PBR_INVALID_SIG != pContext->PartitionContexts[CtxIndex].PartitionSig) {
+      //views belong to the loaded session
+      if (!pContext->PartitionContexts[CtxIndex].PartitionView) {
+        FREE_POOL_SAFE(pContext->PartitionContexts[CtxIndex].PartitionData);
+        FREE_POOL_SAFE(pContext->PartitionContexts[CtxIndex].PartitionItemOffsets);
+      }
+      ZeroMem(&pContext->PartitionContexts[CtxIndex], sizeof(PbrPartitionContext));
+    }
+  }
+}
+
 #define COPY_CHUNK_SZ_BYTES   1024
 
 /**
@@ -33,6 +33,90 @@ PbrGetData(
   OUT UINT32 *pLogicalIndex
 );
 
+/**
+    Gets a view of data from the playback session, without copying it
+
+    Same as PbrGetData, but *ppData points into the session itself. The view is
+    read only and stays valid until the session is freed or data is added to
+    the partition.
+
+    @param[in] Signature: Specifies which data type to get
+    @param[in] Index: GET_NEXT_DATA_INDEX or the logical index of the data object
+    @param[out] ppData: Points to the data object within the session
+    @param[out] pSize: Size in bytes of ppData.
+    @param[out] pLogicalIndex: May be NULL, otherwise will contain the
+       logical index of the data object.
+    @retval EFI_SUCCESS on success
+  **/
+EFI_STATUS
+EFIAPI
+PbrGetDataView(
+  IN UINT32 Signature,
+  IN INT32 Index,
+  OUT CONST VOID **ppData,
+  OUT UINT32 *pSize,
+  OUT UINT32 *pLogicalIndex
+);
+
+/**
+   Callback used by PbrGetMatchingData to select a data object
+
+   @param[in] pData: Candidate data object
+   @param[in] Size: Size in bytes of pData
+   @param[in] pMatchCtx: Context supplied by the caller of PbrGetMatchingData
+   @retval TRUE if pData is the object the caller is looking for
+**/
+typedef BOOLEAN (*PBR_DATA_MATCH)(VOID *pData, UINT32 Size, VOID *pMatchCtx);
+
+/**
+   Gets the next data object from the playback session that satisfies
+   a caller supplied match. Data objects may be consumed out of the
+   order they were recorded in.
+
+   @param[in] Signature: Specifies which data type to get
+   @param[in] pMatch: Called for each candidate data object, returns TRUE
+      to select it
+   @param[in] pMatchCtx: Passed through to pMatch
+   @param[out] ppData: Newly allocated buffer that contains the data object.
+      Caller is responsible for freeing it.
+   @param[out] pSize: Size in bytes of ppData.
+   @retval EFI_SUCCESS on success
+   @retval EFI_NOT_FOUND if no unconsumed data object matches
+**/
+EFI_STATUS
+EFIAPI
+PbrGetMatchingData(
+  IN UINT32 Signature,
+  IN PBR_DATA_MATCH pMatch,
+  IN VOID *pMatchCtx,
+  OUT VOID **ppData,
+  OUT UINT32 *pSize
+);
+
+/**
+   Gets a view of the next data object from the playback session that
+   satisfies a caller supplied match, without copying it. The view follows
+   the rules of PbrGetDataView.
+
+   @param[in] Signature: Specifies which data type to get
+   @param[in] pMatch: Called for each candidate data object, returns TRUE
+      to select it
+   @param[in] pMatchCtx: Passed through to pMatch
+   @param[out] ppData: Points to the data object within the session
+   @param[out] pSize: Size in bytes of ppData.
+   @retval EFI_SUCCESS on success
+   @retval EFI_NOT_FOUND if no unconsumed data object matches
+**/
+EFI_STATUS
+EFIAPI
+PbrGetMatchingDataView(
+  IN UINT32 Signature,
+  IN PBR_DATA_MATCH pMatch,
+  IN VOID *pMatchCtx,
+  OUT CONST VOID **ppData,
+  OUT UINT32 *pSize
+);
+
 /**
    Adds data to the recording session
 
@@ -112,7 +196,9 @@ PbrGetMode(
 /**
   Set the PBR session buffer to use
 
-  @param[in] pBufferAddress: address of a buffer to use for playback or record mode
+  @param[in] pBufferAddress: address of a buffer to use for playback or record mode, a
+    session container or an image of the previous partition table format. The session
+    takes ownership of the buffer. If NULL new buffers will be created.
   @param[in] BufferSize: size in bytes of the buffer
 
   @retval EFI_SUCCESS if the table was found and is properly returned.
@@ -223,6 +309,73 @@ PbrGetTag(
 );
 
 
+/**
+  Callback used by PbrWriteSession to output the session container
+
+  @param[in] pWriteCtx: Context supplied by the caller of PbrWriteSession
+  @param[in] pData: Next piece of the container
+  @param[in] Size: Size in bytes of pData
+  @retval EFI_SUCCESS if the piece was written
+**/
+typedef EFI_STATUS (*PBR_SESSION_WRITE)(VOID *pWriteCtx, CONST VOID *pData, UINT64 Size);
+
+/**
+  Write the session of a context as a session container, front to back
+
+  @param[in] pContext: Pbr context
+  @param[in] pWrite: Called for each piece of the container, in order
+  @param[in] pWriteCtx: Passed through to pWrite
+
+  @retval EFI_SUCCESS if the container was written
+  @retval EFI_NOT_READY if the context has no session
+**/
+EFI_STATUS
+PbrWriteSession(
+  IN     PbrContext *pContext,
+  IN     PBR_SESSION_WRITE pWrite,
+  IN     VOID *pWriteCtx
+);
+
+/**
+  Load the session container pContext->pSession into the context. The partitions
+  become views into the container, nothing is copied.
+
+  @param[in, out] pContext: Pbr context, the partitions must be free
+  @param[in] VerifyData: Also verify the partition data checksums and items. The
+    header, directory and item offset tables are always verified.
+
+  @retval EFI_SUCCESS if the session was loaded
+  @retval EFI_INVALID_PARAMETER if the buffer is not a session container
+  @retval EFI_INCOMPATIBLE_VERSION if the container version is not supported
+  @retval EFI_COMPROMISED_DATA if the container is truncated or a checksum mismatches
+**/
+EFI_STATUS
+PbrLoadSession(
+  IN OUT PbrContext *pContext,
+  IN     BOOLEAN VerifyData
+);
+
+/**
+  Convert an image of the previous partition table format (PbrHeader followed
+  by the partitions) to a session container
+
+  @param[in] pImage: Image to convert
+  @param[in] ImageSize: Size in bytes of pImage
+  @param[out] ppSession: Newly allocated session container, caller is responsible for freeing it
+  @param[out] pSessionSize: Size in bytes of ppSession
+
+  @retval EFI_SUCCESS if the image was converted
+  @retval EFI_INVALID_PARAMETER if the image is not in the previous format
+  @retval EFI_COMPROMISED_DATA if the image is truncated
+**/
+EFI_STATUS
+PbrConvertLegacySession(
+  IN     VOID *pImage,
+  IN     UINT32 ImageSize,
+  OUT    VOID **ppSession,
+  OUT    UINT32 *pSessionSize
+);
+
 /**
   Initialize data structures associated with PBR
 
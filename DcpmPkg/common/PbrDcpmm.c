@@ -11,11 +11,31 @@
 #include "Pbr.h"
 #include "PbrDcpmm.h"
 
-
+/**
+  Selects the next recorded pass through request sent to the DIMM
+  identified by pMatchCtx (pointer to the DimmId the command is sent to)
+**/
+STATIC
+BOOLEAN
+PbrMatchPassThruDimm(
+  IN VOID *pData,
+  IN UINT32 Size,
+  IN VOID *pMatchCtx
+)
+{
+  if (Size < sizeof(PbrPassThruReq)) {
+    return FALSE;
+  }
+  return ((PbrPassThruReq *)pData)->DimmId == *(UINT32 *)pMatchCtx;
+}
 
 /**
   Return the current FW_CMD from the playback buffer
 
+  Records are matched by DimmId, so commands sent to different DIMMs
+  don't have to be played back in the order they were recorded. The record
+  is read in place from the session, only the payloads are copied out.
+
   @param[in] pContext: Pbr context
   @param[in] pCmd: current FW_CMD from the playback buffer
 
@@ -29,29 +49,30 @@ PbrGetPassThruRecord(
 )
 {
   EFI_STATUS ReturnCode = EFI_SUCCESS;
-  PbrPassThruReq *ptReq;
-  PbrPassThruResp *ptResp;
-  VOID *pData = NULL;
+  CONST PbrPassThruReq *ptReq;
+  CONST PbrPassThruResp *ptResp;
+  CONST VOID *pData = NULL;
   UINT32 DataSize = 0;
   UINT32 CurDataPos = 0;
+  UINT32 LargeOutputBufferSize = 0;
 
   if (PBR_PLAYBACK_MODE != pContext->PbrMode) {
     return EFI_SUCCESS;
   }
 
-  ReturnCode = PbrGetData(
+  ReturnCode = PbrGetMatchingDataView(
                 PBR_PASS_THRU_SIG,
-                GET_NEXT_DATA_INDEX,
+                PbrMatchPassThruDimm,
+                &pCmd->DimmID,
                 &pData,
-                &DataSize,
-                NULL);
+                &DataSize);
 
   if (EFI_SUCCESS != ReturnCode) {
     Print(L"Failed to get data!!!!\n");
     return ReturnCode;
   }
 
-  ptReq = (PbrPassThruReq *)pData;
+  ptReq = (CONST PbrPassThruReq *)pData;
   if (pCmd->Opcode != ptReq->Opcode) {
     NVDIMM_ERR("Get Passthru Opcode mismatch, expected 0x%x, received 0x%x\n", pCmd->Opcode, ptReq->Opcode);
     ReturnCode = EFI_LOAD_ERROR;
@@ -90,7 +111,15 @@ PbrGetPassThruRecord(
   }
 
   //should be pointing to the response header
-  ptResp = (PbrPassThruResp *)((UINTN)pData + (UINTN)CurDataPos);
+  ptResp = (CONST PbrPassThruResp *)((UINTN)pData + (UINTN)CurDataPos);
+
+  //the large output buffer is owned by the caller and sized to its request
+  LargeOutputBufferSize = (NULL == pCmd->LargeOutputPayload) ? 0 : pCmd->LargeOutputPayloadSize;
+  if (ptResp->OutputLargePayloadSize > LargeOutputBufferSize) {
+    NVDIMM_ERR("Recorded large output payload does not fit the request\n");
+    ReturnCode = EFI_LOAD_ERROR;
+    goto Finish;
+  }
 
   pCmd->Status = ptResp->Status;
   pCmd->OutputPayloadSize = ptResp->OutputPayloadSize;
@@ -125,13 +154,12 @@ PbrGetPassThruRecord(
   //there is a large output payload
   if (ptResp->OutputLargePayloadSize) {
     CopyMem_S(pCmd->LargeOutputPayload,
-      OUT_MB_SIZE,
+      LargeOutputBufferSize,
       (UINT8*)pData + CurDataPos,
       ptResp->OutputLargePayloadSize);
   }
 
 Finish:
-  FREE_POOL_SAFE(pData);
   return ReturnCode;
 }
 
@@ -8,6 +8,7 @@
 #include <Debug.h>
 #include <Types.h>
 #include <Convert.h>
+#include "Pbr.h"
 #include "PbrOs.h"
 #include "PbrDcpmm.h"
 #include <os.h>
@@ -24,19 +25,53 @@ extern int registry_read(const char *key, unsigned int *dword_val, unsigned int
 #else
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
 #include <sys/ipc.h>
 #include <sys/shm.h>
 #define _read read
 #define _getch getchar
 #endif
 
-#define PBR_CTX_FILE_NAME         "pbr_ctx.tmp"
-#define PBR_MAIN_FILE_NAME        "pbr_main.tmp"
+#define PBR_CTX_FILE_NAME         "pbr_session_ctx.tmp"
+#define PBR_SESSION_FILE_NAME     "pbr_session.tmp"
+#define PBR_SESSION_NEW_FILE_NAME "pbr_session.new"
 #define FILE_READ_OPTS            "rb"
 #define FILE_WRITE_OPTS           "wb"
+#define PBR_TMP_PATH_MAX          256
+
+//Files of the previous format: the context, the main header and one file per partition.
+//The context file name is not reused, so the previous release does not find a session
+//in the container format and the other way around.
+#define PBR_LEGACY_CTX_FILE_NAME        "pbr_ctx.tmp"
+#define PBR_LEGACY_MAIN_FILE_NAME       "pbr_main.tmp"
+#define PBR_LEGACY_PARTITION_FILE_NAME  "%x.pbr"
+
+#pragma pack(push)
+#pragma pack(1)
+/**PbrPartitionContext of the previous format, as saved in its context file**/
+typedef struct _PbrLegacyPartitionContext {
+  UINT32 PartitionSig;
+  UINT32 PartitionSize;
+  UINT32 PartitionLogicalDataCnt;
+  UINT32 PartitionCurrentOffset;
+  UINT32 PartitionEndOffset;
+  VOID  *PartitionData;
+}PbrLegacyPartitionContext;
+
+/**PbrContext of the previous format, as saved in its context file**/
+typedef struct _PbrLegacyContext {
+  UINT32 PbrMode;
+  VOID  *PbrMainHeader;
+  PbrLegacyPartitionContext PartitionContexts[MAX_PARTITIONS];
+}PbrLegacyContext;
+#pragma pack(pop)
+
+static char mPbrTmpDir[PBR_TMP_PATH_MAX] = PBR_TMP_DIR;
 
 VOID SerializePbrMode(UINT32 mode);
 VOID DeserializePbrMode(UINT32 *pMode, UINT32 defaultMode);
@@ -61,58 +96,206 @@ VOID DeserializePbrMode(UINT32 *pMode, UINT32 defaultMode);
     pFile = NULL; \
   }
 
-/**Memory buffer deserialization**/
-#define DeserializeBuffer(file, buffer, size) \
-  if (0 != os_fopen(&pFile, file, FILE_READ_OPTS)) \
-  { \
-    NVDIMM_ERR("Failed to open the PBR file: %s\n", file); \
-    ReturnCode = EFI_END_OF_FILE; \
-    goto Finish; \
-  } \
-  fseek(pFile, 0L, SEEK_END); \
-  fseek(pFile, 0L, SEEK_SET); \
-  buffer = malloc(size); \
-  if(NULL == buffer) { \
-    NVDIMM_ERR("Failed to allocate memory for deserializing buffer\n"); \
-    ReturnCode = EFI_OUT_OF_RESOURCES; \
-    goto Finish; \
-  } \
-  if (1 != fread(buffer, size, 1, pFile)) \
-  { \
-    NVDIMM_ERR("Failed to read the PBR file: %s\n", file); \
-    ReturnCode = EFI_END_OF_FILE; \
-    goto Finish; \
-  } \
-  if (pFile) { \
-      fclose(pFile); \
-      pFile = NULL; \
+/**
+  Set the directory the session files are saved in
+
+  @param[in] pDir: directory name ending with a path separator, NULL restores PBR_TMP_DIR
+
+  @retval EFI_SUCCESS if the directory is used from now on
+  @retval EFI_INVALID_PARAMETER if the name is too long or does not end with a separator
+**/
+EFI_STATUS PbrSetTmpDir(
+  CONST CHAR8 *pDir
+)
+{
+  size_t Length = 0;
+
+  if (NULL == pDir) {
+    pDir = PBR_TMP_DIR;
   }
+  Length = strlen(pDir);
+  if (0 == Length || Length >= sizeof(mPbrTmpDir) || ('/' != pDir[Length - 1] && '\\' != pDir[Length - 1])) {
+    return EFI_INVALID_PARAMETER;
+  }
+  AsciiSPrint(mPbrTmpDir, sizeof(mPbrTmpDir), "%s", pDir);
+  return EFI_SUCCESS;
+}
 
-#define DeserializeBufferEx(file, buffer, size) \
-  if (0 != os_fopen(&pFile, file, FILE_READ_OPTS)) \
-  { \
-    NVDIMM_ERR("Failed to open the PBR file: %s\n", file); \
-  } \
-  else { \
-  fseek(pFile, 0L, SEEK_END); \
-  fseek(pFile, 0L, SEEK_SET); \
-  buffer = malloc(size); \
-  if(NULL == buffer) { \
-    NVDIMM_ERR("Failed to allocate memory for deserializing buffer\n"); \
-  } \
-  if (1 != fread(buffer, size, 1, pFile)) \
-  { \
-    NVDIMM_ERR("Failed to read the PBR file: %s\n", file); \
-  } \
-  if (pFile) { \
-      fclose(pFile); \
-      pFile = NULL; \
-  } \
+/**
+  Get the directory the session files are saved in
+**/
+CONST CHAR8 *PbrGetTmpDir(
+)
+{
+  return mPbrTmpDir;
+}
+
+/**
+  Helper that builds the path of a file in the PBR directory
+**/
+STATIC
+VOID
+PbrTmpPath(
+  char *pPath,
+  UINTN PathSize,
+  const char *pFileName
+)
+{
+  AsciiSPrint(pPath, PathSize, "%s%s", mPbrTmpDir, pFileName);
+}
+
+/**
+  Helper that reads a PBR file of a known size into a buffer
+
+  @retval EFI_NOT_FOUND if there is no such file
+  @retval EFI_INCOMPATIBLE_VERSION if the file has another size
+  @retval EFI_END_OF_FILE if it could not be read
+**/
+STATIC
+EFI_STATUS
+PbrReadFile(
+  const char *file,
+  VOID *pBuffer,
+  UINT64 Size
+)
+{
+  EFI_STATUS ReturnCode = EFI_SUCCESS;
+  FILE* pFile = NULL;
+  INT64 FileSize = 0;
+
+  if (0 != os_fopen(&pFile, file, FILE_READ_OPTS) || NULL == pFile) {
+    return EFI_NOT_FOUND;
+  }
+#if _MSC_VER
+  _fseeki64(pFile, 0L, SEEK_END);
+  FileSize = _ftelli64(pFile);
+  _fseeki64(pFile, 0L, SEEK_SET);
+#else
+  fseeko(pFile, 0L, SEEK_END);
+  FileSize = ftello(pFile);
+  fseeko(pFile, 0L, SEEK_SET);
+#endif
+  if (FileSize < 0 || (UINT64)FileSize != Size) {
+    NVDIMM_ERR("Unexpected size of the PBR file: %s\n", file);
+    ReturnCode = EFI_INCOMPATIBLE_VERSION;
+  }
+  else if (0 != Size && 1 != fread(pBuffer, (size_t)Size, 1, pFile)) {
+    NVDIMM_ERR("Failed to read the PBR file: %s\n", file);
+    ReturnCode = EFI_END_OF_FILE;
+  }
+  fclose(pFile);
+  return ReturnCode;
+}
+
+/**
+  Helper that appends a piece of the session container to the FILE passed as pWriteCtx
+**/
+STATIC
+EFI_STATUS
+PbrWriteSessionFile(
+  VOID *pWriteCtx,
+  CONST VOID *pData,
+  UINT64 Size
+)
+{
+  if (0 != Size && 1 != fwrite(pData, (size_t)Size, 1, (FILE *)pWriteCtx)) {
+    return EFI_END_OF_FILE;
+  }
+  return EFI_SUCCESS;
+}
+
+/**
+  Helper that maps the session container file read only into ctx->pSession.
+  Playback hands out views into the mapping, so only the pages used are read.
+**/
+STATIC
+EFI_STATUS
+PbrMapSession(
+  PbrContext *ctx,
+  const char *file
+)
+{
+#if _MSC_VER
+  FILE* pFile = NULL;
+  INT64 Size = 0;
+
+  //no mapping here, the container is read into a buffer
+  if (0 != os_fopen(&pFile, file, FILE_READ_OPTS) || NULL == pFile) {
+    return EFI_NOT_FOUND;
+  }
+  _fseeki64(pFile, 0L, SEEK_END);
+  Size = _ftelli64(pFile);
+  _fseeki64(pFile, 0L, SEEK_SET);
+  if (Size <= 0 || NULL == (ctx->pSession = AllocatePool((UINTN)Size))) {
+    fclose(pFile);
+    return EFI_OUT_OF_RESOURCES;
+  }
+  if (1 != fread(ctx->pSession, (size_t)Size, 1, pFile)) {
+    fclose(pFile);
+    PbrReleaseSession(ctx);
+    return EFI_END_OF_FILE;
+  }
+  fclose(pFile);
+  ctx->SessionSize = (UINT64)Size;
+  ctx->SessionMapped = FALSE;
+#else
+  int Fd = -1;
+  struct stat FileStat;
+  VOID *pView = NULL;
+
+  Fd = open(file, O_RDONLY);
+  if (Fd < 0) {
+    return EFI_NOT_FOUND;
+  }
+  if (0 != fstat(Fd, &FileStat) || 0 == FileStat.st_size) {
+    close(Fd);
+    return EFI_END_OF_FILE;
+  }
+  pView = mmap(NULL, (size_t)FileStat.st_size, PROT_READ, MAP_PRIVATE, Fd, 0);
+  //the mapping keeps the file alive, even once a new session replaces it
+  close(Fd);
+  if (MAP_FAILED == pView) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+  ctx->pSession = pView;
+  ctx->SessionSize = (UINT64)FileStat.st_size;
+  ctx->SessionMapped = TRUE;
+#endif
+  return EFI_SUCCESS;
+}
+
+/**
+  Helper that releases the loaded session container, unmapping it if it was mapped
+**/
+VOID PbrReleaseSession(
+  PbrContext *ctx
+)
+{
+  if (NULL == ctx->pSession) {
+    return;
+  }
+#if !_MSC_VER
+  if (ctx->SessionMapped) {
+    munmap(ctx->pSession, (size_t)ctx->SessionSize);
+  }
+  else
+#endif
+  {
+    FreePool(ctx->pSession);
   }
+  ctx->pSession = NULL;
+  ctx->SessionSize = 0;
+  ctx->SessionMapped = FALSE;
+}
 
 /**
   Helper that restores the context.  Note, effort has been taken to NOT preserve the
   session pbr mode across boots.
+
+  The session is written as a session container to a new file that then replaces
+  the previous one, so processes that still have the previous one mapped are not
+  affected. Playback only moves the partition offsets, so unless Force is set only
+  the context is written then.
 **/
 EFI_STATUS PbrSerializeCtx(
   PbrContext *ctx,
@@ -122,9 +305,8 @@ EFI_STATUS PbrSerializeCtx(
   EFI_STATUS ReturnCode = EFI_SUCCESS;
   FILE* pFile = NULL;
   size_t BytesWritten = 0;
-  char pbr_dir[100];
-  char pbr_filename[100];
-  UINT32 CtxIndex = 0;
+  char pbr_file[PBR_TMP_PATH_MAX];
+  char pbr_new_file[PBR_TMP_PATH_MAX];
 
   if (NULL == ctx) {
     NVDIMM_DBG("ctx is null\n");
@@ -133,8 +315,7 @@ EFI_STATUS PbrSerializeCtx(
   }
 
   //create temp directory (buffers serialized into files that reside here)
-  AsciiSPrint(pbr_dir, sizeof(pbr_dir), PBR_TMP_DIR);
-  os_mkdir(pbr_dir);
+  os_mkdir(mPbrTmpDir);
 
   SerializePbrMode(ctx->PbrMode);
 
@@ -142,18 +323,36 @@ EFI_STATUS PbrSerializeCtx(
     return ReturnCode;
   }
 
-  for (CtxIndex = 0; CtxIndex < MAX_PARTITIONS; ++CtxIndex) {
-    if (PBR_INVALID_SIG != ctx->PartitionContexts[CtxIndex].PartitionSig) {
-      AsciiSPrint(pbr_filename, sizeof(pbr_filename), "%x.pbr", ctx->PartitionContexts[CtxIndex].PartitionSig);
-      AsciiSPrint(pbr_dir, sizeof(pbr_dir), "%s%s", PBR_TMP_DIR, pbr_filename);
-      SerializeBuffer(pbr_dir, ctx->PartitionContexts[CtxIndex].PartitionData, ctx->PartitionContexts[CtxIndex].PartitionSize);
+  if (Force || PBR_RECORD_MODE == ctx->PbrMode) {
+    PbrTmpPath(pbr_file, sizeof(pbr_file), PBR_SESSION_FILE_NAME);
+    PbrTmpPath(pbr_new_file, sizeof(pbr_new_file), PBR_SESSION_NEW_FILE_NAME);
+    if (0 != os_fopen(&pFile, pbr_new_file, FILE_WRITE_OPTS)) {
+      NVDIMM_ERR("Failed to open the PBR file: %s\n", pbr_new_file);
+      ReturnCode = EFI_NOT_FOUND;
+      goto Finish;
+    }
+    ReturnCode = PbrWriteSession(ctx, PbrWriteSessionFile, pFile);
+    if (0 != fclose(pFile) && !EFI_ERROR(ReturnCode)) {
+      ReturnCode = EFI_END_OF_FILE;
+    }
+    pFile = NULL;
+    if (EFI_ERROR(ReturnCode)) {
+      NVDIMM_ERR("Failed to serialize the PBR file: %s\n", pbr_new_file);
+      goto Finish;
+    }
+#if _MSC_VER
+    remove(pbr_file);
+#endif
+    if (0 != rename(pbr_new_file, pbr_file)) {
+      NVDIMM_ERR("Failed to replace the PBR file: %s\n", pbr_file);
+      ReturnCode = EFI_END_OF_FILE;
+      goto Finish;
     }
   }
 
   /**Serialize the PBR context struct**/
-  SerializeBuffer(PBR_TMP_DIR PBR_CTX_FILE_NAME, ctx, sizeof(PbrContext));
-  /**Serialize the PBR main header**/
-  SerializeBuffer(PBR_TMP_DIR PBR_MAIN_FILE_NAME, ctx->PbrMainHeader, sizeof(PbrHeader));
+  PbrTmpPath(pbr_file, sizeof(pbr_file), PBR_CTX_FILE_NAME);
+  SerializeBuffer(pbr_file, ctx, sizeof(PbrContext));
 
 Finish:
   if (pFile) {
@@ -162,9 +361,133 @@ Finish:
   return ReturnCode;
 }
 
+/**
+  Helper that converts the files of a session saved in the previous format: the
+  partitions are stitched into an image of the previous partition table format,
+  which is then converted to a session container and loaded.
+
+  Items are laid out the same way in both formats, so the playback/record offsets
+  of the saved context still apply.
+
+  @retval EFI_NOT_FOUND if there is no session in the previous format
+**/
+STATIC
+EFI_STATUS
+PbrConvertLegacyFiles(
+  PbrContext *ctx
+)
+{
+  EFI_STATUS ReturnCode = EFI_SUCCESS;
+  char pbr_file[PBR_TMP_PATH_MAX];
+  char pbr_filename[PBR_TMP_PATH_MAX];
+  PbrLegacyContext *pLegacyCtx = NULL;
+  PbrLegacyPartitionContext *pLegacyPartition = NULL;
+  PbrPartitionTableEntry *pEntry = NULL;
+  UINT8 *pImage = NULL;
+  UINT64 ImageSize = sizeof(PbrHeader);
+  VOID *pSession = NULL;
+  UINT32 SessionSize = 0;
+  UINT32 Index = 0;
+  UINT32 CtxIndex = 0;
+
+  pLegacyCtx = AllocateZeroPool(sizeof(PbrLegacyContext));
+  if (NULL == pLegacyCtx) {
+    ReturnCode = EFI_OUT_OF_RESOURCES;
+    goto Finish;
+  }
+
+  PbrTmpPath(pbr_file, sizeof(pbr_file), PBR_LEGACY_CTX_FILE_NAME);
+  ReturnCode = PbrReadFile(pbr_file, pLegacyCtx, sizeof(PbrLegacyContext));
+  if (EFI_ERROR(ReturnCode)) {
+    goto Finish;
+  }
+
+  for (Index = 0; Index < MAX_PARTITIONS; ++Index) {
+    if (PBR_INVALID_SIG != pLegacyCtx->PartitionContexts[Index].PartitionSig) {
+      ImageSize += pLegacyCtx->PartitionContexts[Index].PartitionSize;
+    }
+  }
+  if (ImageSize > MAX_UINT32) {
+    ReturnCode = EFI_COMPROMISED_DATA;
+    goto Finish;
+  }
+  pImage = AllocateZeroPool((UINTN)ImageSize);
+  if (NULL == pImage) {
+    ReturnCode = EFI_OUT_OF_RESOURCES;
+    goto Finish;
+  }
+
+  PbrTmpPath(pbr_file, sizeof(pbr_file), PBR_LEGACY_MAIN_FILE_NAME);
+  ReturnCode = PbrReadFile(pbr_file, pImage, sizeof(PbrHeader));
+  if (EFI_ERROR(ReturnCode)) {
+    goto Finish;
+  }
+
+  //the saved partition table is not kept up to date while recording, the context is
+  ImageSize = sizeof(PbrHeader);
+  ZeroMem(&((PbrHeader *)pImage)->PartitionTable, sizeof(PbrPartitionTable));
+  for (Index = 0; Index < MAX_PARTITIONS; ++Index) {
+    pLegacyPartition = &pLegacyCtx->PartitionContexts[Index];
+    if (PBR_INVALID_SIG == pLegacyPartition->PartitionSig) {
+      continue;
+    }
+    AsciiSPrint(pbr_filename, sizeof(pbr_filename), PBR_LEGACY_PARTITION_FILE_NAME, pLegacyPartition->PartitionSig);
+    PbrTmpPath(pbr_file, sizeof(pbr_file), pbr_filename);
+    ReturnCode = PbrReadFile(pbr_file, pImage + ImageSize, pLegacyPartition->PartitionSize);
+    if (EFI_ERROR(ReturnCode)) {
+      goto Finish;
+    }
+    pEntry = &((PbrHeader *)pImage)->PartitionTable.Partitions[Index];
+    pEntry->Signature = pLegacyPartition->PartitionSig;
+    pEntry->Size = pLegacyPartition->PartitionSize;
+    pEntry->Offset = (UINT32)ImageSize;
+    pEntry->LogicalDataCnt = pLegacyPartition->PartitionLogicalDataCnt;
+    ImageSize += pLegacyPartition->PartitionSize;
+  }
+
+  ReturnCode = PbrConvertLegacySession(pImage, (UINT32)ImageSize, &pSession, &SessionSize);
+  if (EFI_ERROR(ReturnCode)) {
+    goto Finish;
+  }
+  ctx->pSession = pSession;
+  ctx->SessionSize = SessionSize;
+  ctx->SessionMapped = FALSE;
+  ReturnCode = PbrLoadSession(ctx, TRUE);
+  if (EFI_ERROR(ReturnCode)) {
+    PbrReleaseSession(ctx);
+    goto Finish;
+  }
+
+  //restore where each partition was at
+  for (CtxIndex = 0; CtxIndex < MAX_PARTITIONS; ++CtxIndex) {
+    if (PBR_INVALID_SIG == ctx->PartitionContexts[CtxIndex].PartitionSig) {
+      continue;
+    }
+    for (Index = 0; Index < MAX_PARTITIONS; ++Index) {
+      pLegacyPartition = &pLegacyCtx->PartitionContexts[Index];
+      if (ctx->PartitionContexts[CtxIndex].PartitionSig == pLegacyPartition->PartitionSig) {
+        ctx->PartitionContexts[CtxIndex].PartitionCurrentOffset =
+          MIN(pLegacyPartition->PartitionCurrentOffset, ctx->PartitionContexts[CtxIndex].PartitionSize);
+        break;
+      }
+    }
+  }
+
+Finish:
+  FREE_POOL_SAFE(pImage);
+  FREE_POOL_SAFE(pLegacyCtx);
+  return ReturnCode;
+}
+
 /**
   Helper that saves the context.  Note, effort has been taken to NOT preserve the
   session pbr mode across boots.
+
+  The session container is mapped and the partitions point into it, the
+  playback/record offsets come from the saved context. A session saved in the
+  previous format is converted and saved again as a container. Saved files that
+  can not be used are reported and left alone, the context starts in normal
+  mode as if there was no session.
 **/
 EFI_STATUS PbrDeserializeCtx(
   PbrContext *ctx
@@ -172,11 +495,11 @@ EFI_STATUS PbrDeserializeCtx(
 {
 
   EFI_STATUS ReturnCode = EFI_SUCCESS;
-  FILE* pFile = NULL;
   UINT32 PbrMode = PBR_NORMAL_MODE;
-  char pbr_dir[100];
-  char pbr_filename[100];
+  char pbr_file[PBR_TMP_PATH_MAX];
+  PbrContext *pSavedCtx = NULL;
   UINT32 CtxIndex = 0;
+  UINT32 SavedIndex = 0;
 
   if (NULL == ctx) {
     NVDIMM_DBG("ctx is null\n");
@@ -185,54 +508,84 @@ EFI_STATUS PbrDeserializeCtx(
   }
 
   //create temp directory (buffers serialized into files that reside here)
-  AsciiSPrint(pbr_dir, sizeof(pbr_dir), PBR_TMP_DIR);
-  os_mkdir(pbr_dir);
+  os_mkdir(mPbrTmpDir);
 
   DeserializePbrMode(&PbrMode, PBR_NORMAL_MODE);
 
   NVDIMM_DBG("PBR MODE from shared memory: %d\n", PbrMode);
 
-  AsciiSPrint(pbr_filename, sizeof(pbr_filename), "%x.pbr", PBR_PASS_THRU_SIG);
-  AsciiSPrint(pbr_dir, sizeof(pbr_dir), "%s%s", PBR_TMP_DIR, pbr_filename);
+  pSavedCtx = AllocateZeroPool(sizeof(PbrContext));
+  if (NULL == pSavedCtx) {
+    ReturnCode = EFI_OUT_OF_RESOURCES;
+    goto Finish;
+  }
 
   /**Deserialize the PBR context struct**/
-  if (0 != os_fopen(&pFile, PBR_TMP_DIR PBR_CTX_FILE_NAME, FILE_READ_OPTS) || pFile == NULL)
-  {
-    NVDIMM_DBG("pbr_ctx.tmp not found, setting to default value\n");
-    ctx->PbrMode = PBR_NORMAL_MODE;
+  PbrTmpPath(pbr_file, sizeof(pbr_file), PBR_CTX_FILE_NAME);
+  ReturnCode = PbrReadFile(pbr_file, pSavedCtx, sizeof(PbrContext));
+  if (EFI_NOT_FOUND == ReturnCode) {
+    ReturnCode = PbrConvertLegacyFiles(ctx);
+    if (EFI_NOT_FOUND == ReturnCode) {
+      NVDIMM_DBG("%s not found, setting to default value\n", PBR_CTX_FILE_NAME);
+      ctx->PbrMode = PBR_NORMAL_MODE;
+      ReturnCode = EFI_SUCCESS;
+      goto Finish;
+    }
+    if (EFI_ERROR(ReturnCode)) {
+      goto Unusable;
+    }
+    NVDIMM_WARN("Converted the PBR session saved in the previous format\n");
+    ctx->PbrMode = PbrMode;
+    //the converted session is in memory, saving it only spares converting it again
+    if (EFI_ERROR(PbrSerializeCtx(ctx, TRUE))) {
+      NVDIMM_ERR("Failed to save the converted PBR session in %s\n", mPbrTmpDir);
+    }
     ReturnCode = EFI_SUCCESS;
     goto Finish;
   }
-
-  if (1 != fread(ctx, sizeof(PbrContext), 1, pFile))
-  {
-    NVDIMM_ERR("Failed to read the PBR context\n");
-    ReturnCode = EFI_END_OF_FILE;
-    goto Finish;
+  if (EFI_ERROR(ReturnCode)) {
+    goto Unusable;
   }
 
-  fclose(pFile);
-  pFile = NULL;
-
-  /**Deserialize the PBR main header**/
+  /**Map the PBR session, the partitions become views into it**/
+  PbrTmpPath(pbr_file, sizeof(pbr_file), PBR_SESSION_FILE_NAME);
+  ReturnCode = PbrMapSession(ctx, pbr_file);
+  if (EFI_ERROR(ReturnCode)) {
+    NVDIMM_ERR("Failed to open the PBR file: %s\n", pbr_file);
+    goto Unusable;
+  }
 
-  DeserializeBuffer(PBR_TMP_DIR PBR_MAIN_FILE_NAME, ctx->PbrMainHeader, sizeof(PbrHeader));
+  //written by PbrSerializeCtx, only the indexes are verified
+  ReturnCode = PbrLoadSession(ctx, FALSE);
+  if (EFI_ERROR(ReturnCode)) {
+    NVDIMM_ERR("Failed to load the PBR file: %s\n", pbr_file);
+    PbrReleaseSession(ctx);
+    goto Unusable;
+  }
 
+  //restore where each partition was at
   for (CtxIndex = 0; CtxIndex < MAX_PARTITIONS; ++CtxIndex) {
-    if (PBR_INVALID_SIG != ctx->PartitionContexts[CtxIndex].PartitionSig) {
-      AsciiSPrint(pbr_filename, sizeof(pbr_filename), "%x.pbr", ctx->PartitionContexts[CtxIndex].PartitionSig);
-      AsciiSPrint(pbr_dir, sizeof(pbr_dir), "%s%s", PBR_TMP_DIR, pbr_filename);
-      DeserializeBufferEx(pbr_dir, ctx->PartitionContexts[CtxIndex].PartitionData, ctx->PartitionContexts[CtxIndex].PartitionSize);
+    if (PBR_INVALID_SIG == ctx->PartitionContexts[CtxIndex].PartitionSig) {
+      continue;
+    }
+    for (SavedIndex = 0; SavedIndex < MAX_PARTITIONS; ++SavedIndex) {
+      if (ctx->PartitionContexts[CtxIndex].PartitionSig == pSavedCtx->PartitionContexts[SavedIndex].PartitionSig) {
+        ctx->PartitionContexts[CtxIndex].PartitionCurrentOffset = pSavedCtx->PartitionContexts[SavedIndex].PartitionCurrentOffset;
+        break;
+      }
     }
   }
 
   ctx->PbrMode = PbrMode;
+  goto Finish;
 
-Finish:
-  if (pFile) {
-    fclose(pFile);
-  }
+Unusable:
+  NVDIMM_ERR("The PBR session in %s can not be used (" FORMAT_EFI_STATUS "), continuing without it\n", mPbrTmpDir, ReturnCode);
+  ctx->PbrMode = PBR_NORMAL_MODE;
+  ReturnCode = EFI_SUCCESS;
 
+Finish:
+  FREE_POOL_SAFE(pSavedCtx);
   return ReturnCode;
 }
 
@@ -250,7 +603,7 @@ VOID SerializePbrMode(
   UINT32 ShmId;
   key_t Key;
   UINT32 *pPbrMode = NULL;
-  Key = ftok(PBR_TMP_DIR, 'h');
+  Key = ftok(mPbrTmpDir, 'h');
   ShmId = shmget(Key, sizeof(*pPbrMode), IPC_CREAT | 0666);
   if (-1 == ShmId) {
     NVDIMM_DBG("Failed to shmget\n");
@@ -290,7 +643,7 @@ VOID DeserializePbrMode(
   UINT32 ShmId;
   key_t Key;
   UINT32 *pPbrMode = NULL;
-  Key = ftok(PBR_TMP_DIR, 'h');
+  Key = ftok(mPbrTmpDir, 'h');
   ShmId = shmget(Key, sizeof(*pPbrMode), IPC_CREAT | 0666);
   if (-1 == ShmId) {
     NVDIMM_DBG("Failed to shmget\n");
@@ -11,5 +11,8 @@
 
 EFI_STATUS PbrSerializeCtx(PbrContext *ctx, BOOLEAN Force);
 EFI_STATUS PbrDeserializeCtx(PbrContext * ctx);
+VOID PbrReleaseSession(PbrContext *ctx);
+EFI_STATUS PbrSetTmpDir(CONST CHAR8 *pDir);
+CONST CHAR8 *PbrGetTmpDir();
 
 #endif //_PBR_OS_H_
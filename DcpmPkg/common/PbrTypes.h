@@ -27,6 +27,12 @@
 #define PBR_HEADER_SIG                        SIGNATURE_32('P', 'B', 'R', 'H')
 #define PBR_TAG_HEADER_SIG                    SIGNATURE_32('P', 'B', 'T', 'H')
 #define PBR_TAG_SIG                           SIGNATURE_32('P', 'B', 'T', 'I')
+#define PBR_SESSION_SIG                       SIGNATURE_32('P', 'B', 'R', 'S')
+
+//Session container defines
+#define PBR_SESSION_VERSION_MAJOR             1   //!< Readers reject containers with another major version
+#define PBR_SESSION_VERSION_MINOR             0   //!< Compatible additions
+#define PBR_SESSION_ALIGNMENT                 8   //!< Alignment of the sections within a container
 
 
 /**set playback/record/normal mode**/
@@ -51,6 +57,9 @@ typedef struct _PbrPartitionContext {
   UINT32 PartitionCurrentOffset;                              //!< Offset used to keep track of current position when in record or playback mode
   UINT32 PartitionEndOffset;                                  //!< Placeholder
   VOID  *PartitionData;                                       //!< Pointer to actual data item
+  UINT32 *PartitionItemOffsets;                               //!< Offset of each logical data item within PartitionData, by logical index
+  UINT32 PartitionItemOffsetsMax;                             //!< Number of entries allocated for PartitionItemOffsets
+  BOOLEAN PartitionView;                                      //!< PartitionData and PartitionItemOffsets point into the loaded session, they are not allocations
 }PbrPartitionContext;
 
 /**the main pbr context that contains pointers to various data structures**/
@@ -58,6 +67,9 @@ typedef struct _PbrContext {
   UINT32 PbrMode;                                             //!< PBR_NORMAL_MODE, PBR_RECORD_MODE, PBR_PLAYBACK_MODE
   VOID  *PbrMainHeader;                                       //!< Main PBR buffer header, includes partition table
   PbrPartitionContext PartitionContexts[MAX_PARTITIONS];
+  VOID  *pSession;                                            //!< Loaded session container the partition views point into, may be NULL
+  UINT64 SessionSize;                                         //!< Size in bytes of pSession
+  BOOLEAN SessionMapped;                                      //!< pSession is a file mapping rather than a pool allocation
 }PbrContext;
 
 /**entries in the partition table**/
@@ -90,6 +102,42 @@ typedef struct _PbrHeader {
   CHAR8               Description[PBR_FILE_DESCRIPTION_MAX];  //!< Highlevel description of pbr file
 }PbrHeader;
 
+/**
+  Header of an indexed session container, the format used to save and load sessions.
+
+  The header is followed by the partition directory at DirectoryOffset. Each
+  partition has an item offset table (one UINT32 per logical data item, relative
+  to the start of the partition data) and its data, the logical data items back
+  to back. Sections start on PBR_SESSION_ALIGNMENT boundaries and all checksums
+  are Fletcher64, so a container can be used in place, mapped or in memory.
+**/
+typedef struct _PbrSessionHeader {
+  UINT32              Signature;                              //!< PBR_SESSION_SIG
+  UINT16              VersionMajor;                           //!< PBR_SESSION_VERSION_MAJOR
+  UINT16              VersionMinor;                           //!< PBR_SESSION_VERSION_MINOR
+  UINT32              HeaderSize;                             //!< sizeof(PbrSessionHeader) of the writer
+  UINT32              PartitionCnt;                           //!< Number of entries in the partition directory
+  UINT64              SessionSize;                            //!< Size in bytes of the whole container
+  UINT64              DirectoryOffset;                        //!< Offset of the partition directory
+  UINT64              DirectoryChecksum;                      //!< Checksum of the partition directory
+  CHAR8               SwVersion[PBR_SW_VERSION_MAX];          //!< SW/Driver version used to record data
+  CHAR8               OsVersion[PBR_OS_VERSION_MAX];          //!< Execution OS, i.e. UEFI/Linux/Windows
+  CHAR8               OsName[PBR_OS_NAME_MAX];                //!< Execution OS name
+  CHAR8               Description[PBR_FILE_DESCRIPTION_MAX];  //!< Highlevel description of pbr file
+  UINT64              HeaderChecksum;                         //!< Checksum of the header up to this field
+}PbrSessionHeader;
+
+/**entries in the partition directory of a session container**/
+typedef struct _PbrSessionPartition {
+  UINT32 Signature;                                           //!< Defines the type of partition
+  UINT32 LogicalDataCnt;                                      //!< Number of logical data items, entries in the item offset table
+  UINT64 ItemTableOffset;                                     //!< Offset of the item offset table within the container
+  UINT64 DataOffset;                                          //!< Offset of the partition data within the container
+  UINT64 DataSize;                                            //!< Size in bytes of the partition data
+  UINT64 ItemTableChecksum;                                   //!< Checksum of the item offset table
+  UINT64 DataChecksum;                                        //!< Checksum of the partition data
+}PbrSessionPartition;
+
 /**tag data struct that is used within the tag partition**/
 typedef struct _Tag {
   UINT32 Signature;                                           //!< PBR_TAG_SIG
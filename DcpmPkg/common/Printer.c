@@ -7,6 +7,7 @@
 #include <Debug.h>
 #include <NvmDimmCli.h>
 #include <Library/BaseMemoryLib.h>
+#include <Library/PrintLib.h>
 #include <Common.h>
 
 #define EXPAND_STR_MAX                    1024
@@ -28,16 +29,25 @@
 
 #define TEXT_TABLE_DEFAULT_DELIM          L'|'
 #define TEXT_NEW_LINE                     L"\n"
-#define TEXT_TABLE_HEADER_SEP             L"="
+#define TEXT_TABLE_HEADER_SEP             L'='
+#define TEXT_TABLE_EMPTY_CELL             L"X"
+#define TEXT_TABLE_MIN_ROWS               64
+#define TEXT_TABLE_STREAM_BUFFER_LEN      4096
 
 #define TEXT_LIST_WHITESPACE_IDENT        L"   "
 #define TEXT_LIST_IGNORE_LIST_DELIM       L';'
 #define TEXT_LIST_HEADER                  L"---"
 #define TEXT_LIST_KEY_VAL_DELIM           L"="
 
+#define JSON_OUT_BUFFER_LEN               512
+#define JSON_RETURN_CODE_KEY              L"ReturnCode"
+#define JSON_OUTPUT_KEY                   L"Output"
+#define JSON_MESSAGE_KEY                  L"Message"
+
 #define CHAR_NULL_TERM                    L'\0'
 #define CHAR_PATH_DELIM                   L'/'
 #define CHAR_WHITE_SPACE                  L' '
+#define CHAR_NEW_LINE                     L'\n'
 #define CELL_EXTRA_CHARS                  2 //1 for leading whitespace and 1 for terminating pipe
 
 BOOLEAN gDisplayNulls = FALSE;
@@ -47,15 +57,51 @@ CHAR16* gNullValueToDisplay = L"NULL";
 typedef enum {
   PRINT_TEXT,
   PRINT_BASIC_XML,
-  PRINT_XML
+  PRINT_XML,
+  PRINT_JSON
 }PRINT_MODE;
 
-typedef struct _PRV_TABLE_INFO {
-  PRINTER_TABLE_ATTRIB *AllTableAttribs;
-  PRINTER_TABLE_ATTRIB *ModifiedTableAttribs;
-  CHAR16 *CurrentPath;
-  CHAR16 *PrinterNode;
-}PRV_TABLE_INFO;
+/*
+* JSON is written through a small buffer which is flushed to stdout when full
+* and at the end of every record, instead of one Print per token.
+*/
+typedef struct _JSON_OUT {
+  CHAR16 Buffer[JSON_OUT_BUFFER_LEN + 1];
+  UINTN Length;
+}JSON_OUT;
+
+/*
+* Cell of a text table
+*/
+typedef struct _TEXT_TABLE_CELL {
+  CONST CHAR16 *Value;    //owned by the data set being printed
+  UINT32 Length;
+}TEXT_TABLE_CELL;
+
+/*
+* Text table being rendered. The cells of the rows are kept per column while the
+* data set is walked, the whole table is formatted once the column widths are known.
+*/
+typedef struct _TEXT_TABLE {
+  PRINTER_TABLE_ATTRIB *Attribs;
+  UINT32 NumColumns;
+  UINT32 PrinterColumn;                         //column matching the "printer node"
+  CONST CHAR16 *Keys[MAX_TABLE_COLUMNS];
+  UINT32 Widths[MAX_TABLE_COLUMNS];
+  TEXT_TABLE_CELL Current[MAX_TABLE_COLUMNS];   //cells of the nodes on the current path
+  UINT32 PathColumns[MAX_TABLE_COLUMNS];        //columns matched on the current path, in row order
+  UINT32 NumPathColumns;
+  UINT32 RowColumns[MAX_TABLE_COLUMNS];         //all rows have the path of the printer node
+  UINT32 NumRowColumns;
+  BOOLEAN WrapLastColumn;
+  TEXT_TABLE_CELL *Rows[MAX_TABLE_COLUMNS];
+  UINTN NumRows;
+  UINTN RowCapacity;
+  BOOLEAN Streaming;
+  CHAR16 *Out;
+  UINTN OutLength;
+  UINTN OutCapacity;
+}TEXT_TABLE;
 
 /**
 Helper for iterating through buffered object list
@@ -352,36 +398,6 @@ static VOID PrintTextList(IN DATA_SET_CONTEXT *DataSetCtx, IN PRINTER_LIST_ATTRI
   RecurseDataSet(DataSetCtx, TextListCb, NULL, (VOID*)PrinterListAttribs, TRUE);
 }
 
-/**
-The node that represents the last cell in a row is responsible for printing the entire row.
-This is a helper to determine if a particular node is the "printer node".
-
-@param[in] DataSetCtx: Represents a data set that contains key/val pairs
-@param[in] CurPath: Represents a hierarchical path of data sets in the form of /sensorlist/dimm/sensor
-@param[in] PrvTableInfo: Contains information related to a table
-
-@retval BOOLEAN TRUE if CurPath points to the designated "printer node" else FALSE
-**/
-static BOOLEAN TextTableIsPrinterNode(IN DATA_SET_CONTEXT *DataSetCtx, IN CHAR16 *CurPath, IN PRV_TABLE_INFO *PrvTableInfo) {
-  CHAR16 *TmpStr = CatSPrint(CurPath,L".");
-  BOOLEAN IsPrinter = FALSE;
-
-  if (NULL == TmpStr) {
-    NVDIMM_CRIT("CatSPrint returned NULL\n");
-    goto Finish;
-  }
-
-  if(NULL == PrvTableInfo) {
-    goto Finish;
-  }
-
-  IsPrinter = (0 == StrnCmp(TmpStr, PrvTableInfo->PrinterNode, StrLen(TmpStr)));
-
-Finish:
-  FREE_POOL_SAFE(TmpStr);
-  return IsPrinter;
-}
-
 /**
 This routine takes a Path and returns a pointer to the keyname.
 
@@ -426,307 +442,398 @@ static UINTN NumTableColumns(IN PRINTER_TABLE_ATTRIB *Attribs) {
 }
 
 /**
-Callback routine for printing out text tables.
-
-@param[in] DataSetCtx: current data set node
-@param[in] CurPath: path to current data set node in the form of: /sensorlist/dimm/sensor
-@param[in] UserData: pointer to PRV_TABLE_INFO (defines user defined table/column attributes)
-@param[in] ParentUserData: a string that represents the current table row (note, last node in branch
-           is responsible for printing the row)
+The node that represents the last cell in a row is responsible for printing the entire row.
+This is a helper to create a path in the form of /sensorlist/dimm/sensor
+that points to a particular "printer node".
 
-@retval CHAR16* that represents the table row.
-@retval NULL on error
 **/
-static VOID * TextTableCb(IN DATA_SET_CONTEXT *DataSetCtx, IN CHAR16 *CurPath, IN VOID *UserData, IN VOID *ParentUserData) {
-  PRV_TABLE_INFO *PrvTableInfo = (PRV_TABLE_INFO *)UserData;
-  PRINTER_TABLE_ATTRIB *Attribs;
-  CHAR16 *TempCurPath = CatSPrint(CurPath, L".");
-  UINT32 ColumnIndex = 0;
-  UINT32 CellValueIndex = 0;
-  CHAR16 *KeyVal;
-  CHAR16 *CurRowText = CatSPrint(ParentUserData, L"");
-  CHAR16 *EndOfRowText;
-  UINTN RowSizeInBytes;
-  UINTN NumColumns = 0;
-  UINTN KeyValSize = 0;
-  UINTN MaxCellChars = 0;
-  CHAR16 *TempRowText = NULL;
-  BOOLEAN LastNodeInBranch = FALSE;
-  CHAR16 *EmptyCell = L"X";
+static CHAR16 * TextTableGetPrinterNodePath(PRINTER_TABLE_ATTRIB * TableAttribs) {
+  UINT32 Index = 0;
+  CHAR16 *PrinterNodePath = NULL;
+  UINT32 DeepestLevel = 0;
+  UINT32 TempLevelCount = 0;
+  CHAR16 *TempPath;
 
-  if(NULL == UserData || NULL == CurRowText || NULL == TempCurPath) {
-    goto Finish;
+  for (Index = 0; Index < MAX_TABLE_COLUMNS; ++Index) {
+    if(!TableAttribs->ColumnAttribs[Index].ColumnDataSetPath) {
+      break;
+    }
+    TempPath = (CHAR16*)TableAttribs->ColumnAttribs[Index].ColumnDataSetPath;
+    TempLevelCount = 0;
+    while (*TempPath != CHAR_NULL_TERM) {
+      if (*TempPath == CHAR_PATH_DELIM) {
+        ++TempLevelCount;
+      }
+      ++TempPath;
+    }
+    if (TempLevelCount > DeepestLevel) {
+      PrinterNodePath = (CHAR16*)TableAttribs->ColumnAttribs[Index].ColumnDataSetPath;
+    }
   }
 
-  LastNodeInBranch = TextTableIsPrinterNode(DataSetCtx, CurPath, PrvTableInfo);
+  return PrinterNodePath;
+}
 
-  Attribs = (PRINTER_TABLE_ATTRIB *)PrvTableInfo->AllTableAttribs;
-  NumColumns = NumTableColumns(Attribs);
+/**
+Write out the buffered text of a table. Values may contain format specifiers,
+so the buffer is only ever passed as an argument.
 
-  //Loop through all column attributes defined by the CLI cmd handler
-  for (ColumnIndex = 0; ColumnIndex < NumColumns; ++ColumnIndex) {
-    //column attributes defines which key/value pairs to display in each column.
-    //This is done by specifying a path to a key in the form of: /sensorlist/dimm/sensor.keyname.
-    //TempCurPath represents the current node in path form with a '.' at the end, i.e. /sensorlist/dimm/sensor.
-    if (0 == StrnCmp(TempCurPath, Attribs->ColumnAttribs[ColumnIndex].ColumnDataSetPath, StrLen(TempCurPath))) {
-      //Found a path in column attributes that points to our current node, try to retrieve the
-      //associated value.
-      GetKeyValueWideStr(DataSetCtx, TextTableFindKeyInPath(Attribs->ColumnAttribs[ColumnIndex].ColumnDataSetPath), &KeyVal, NULL);
-      if(NULL == KeyVal) {
-        KeyVal = EmptyCell;
-      }
-      //if we are at the last column, let the value wrap
-      if (LastNodeInBranch && ColumnIndex == (NumColumns-1)) {
-        MaxCellChars = StrLen(KeyVal);
-        RowSizeInBytes = StrSize(CurRowText) + ((MaxCellChars + CELL_EXTRA_CHARS) * sizeof(CHAR16));
-      }
-      //CurRowText contains cells in a row already processed, now add more memory for the next cell in the row
-      //if we are not at the last row, restrict the size of the cell as specified in table attributes
-      else {
-        MaxCellChars = Attribs->ColumnAttribs[ColumnIndex].ColumnMaxStrLen;
-        RowSizeInBytes = StrSize(CurRowText) + ((MaxCellChars + CELL_EXTRA_CHARS) * sizeof(CHAR16));
-      }
+@param[in] Table: table being rendered
+**/
+static VOID TextTableFlush(IN TEXT_TABLE *Table) {
+  if (0 == Table->OutLength) {
+    return;
+  }
+  Table->Out[Table->OutLength] = CHAR_NULL_TERM;
+#ifdef OS_BUILD
+  Print(FORMAT_STR, Table->Out);
+#else
+  LongPrint(Table->Out);
+#endif
+  Table->OutLength = 0;
+}
 
-      if (NULL == (CurRowText = ReallocatePool(StrSize(CurRowText), RowSizeInBytes, CurRowText))) {
-        goto Finish;
-      }
-      //Make EndOfRowText point to end of the already processed row
-      EndOfRowText = &CurRowText[StrLen(CurRowText)];
-      //Always start cell with a space
-      *EndOfRowText++ = CHAR_WHITE_SPACE;
-      //Number of chars in the new column value
-      KeyValSize = StrLen(KeyVal);
-      //Add data to the row string (new column value)
-      for (CellValueIndex = 0; CellValueIndex < MaxCellChars; ++CellValueIndex) {
-        //fill the column cell with the key value
-        if (CellValueIndex < KeyValSize) {
-          EndOfRowText[CellValueIndex] = KeyVal[CellValueIndex];
-        }
-        //pad the rest of the cell with whitespaces (up to the specified column max width)
-        else {
-          EndOfRowText[CellValueIndex] = CHAR_WHITE_SPACE;
-        }
-      }
+/**
+Reserve room for more characters in the output buffer of a text table. In
+streaming mode the buffer is written out once it is full instead of growing.
 
-      if((ColumnIndex + 1) != NumColumns){
-        EndOfRowText[CellValueIndex] = TEXT_TABLE_DEFAULT_DELIM;
-        ++CellValueIndex;
-      }
-      EndOfRowText[CellValueIndex] = CHAR_NULL_TERM;
-    }
-  }
+@param[in] Table: table being rendered
+@param[in] Chars: number of characters about to be added
 
-  //determine if the current node is the "printer node" (last node in branch)
-  if (LastNodeInBranch) {
-    TempRowText = CurRowText;
-    while (*TempRowText != CHAR_NULL_TERM) {
-      //print individual characters as string may contain format specifiers.
-      Print(FORMAT_CHAR, *TempRowText++);
-    }
-    Print(TEXT_NEW_LINE);
+@retval BOOLEAN TRUE if the characters fit, FALSE if out of memory
+**/
+static BOOLEAN TextTableReserve(IN TEXT_TABLE *Table, IN UINTN Chars) {
+  UINTN NewCapacity = 0;
+  CHAR16 *NewOut = NULL;
+
+  if (Table->Streaming && Table->OutLength + Chars > TEXT_TABLE_STREAM_BUFFER_LEN) {
+    TextTableFlush(Table);
+  }
+  //+1 for the null terminator added when flushing
+  if (Table->OutLength + Chars + 1 <= Table->OutCapacity) {
+    return TRUE;
   }
 
-Finish:
-  FREE_POOL_SAFE(TempCurPath);
-  //return a string that represents the current row.
-  return CurRowText;
+  NewCapacity = MAX(Table->OutCapacity * 2, Table->OutLength + Chars + 1);
+  NewCapacity = MAX(NewCapacity, TEXT_TABLE_STREAM_BUFFER_LEN + 1);
+  if (NULL == (NewOut = ReallocatePool(Table->OutCapacity * sizeof(CHAR16), NewCapacity * sizeof(CHAR16), Table->Out))) {
+    NVDIMM_CRIT("ReallocatePool returned NULL\n");
+    return FALSE;
+  }
+  Table->Out = NewOut;
+  Table->OutCapacity = NewCapacity;
+  return TRUE;
 }
 
 /**
-Callback routine for determining max column widths of a text table
+Append a cell to the output buffer of a text table: a leading whitespace, the value
+cut or padded to MaxCellChars and a delimiter unless it is the last column.
 
-@param[in] DataSetCtx: current data set node
-@param[in] CurPath: path to current data set node in the form of: /sensorlist/dimm/sensor
-@param[in] UserData: pointer to PRV_TABLE_INFO (defines user defined table/column attributes)
-@param[in] ParentUserData: a string that represents the current table row (note, last node in branch
-           is responsible for printing the row)
-
-@retval CHAR16* that represents the table row.
-@retval NULL on error
+@param[in] Table: table being rendered
+@param[in] Column: index of the column the cell belongs to
+@param[in] Cell: value of the cell
+@param[in] MaxCellChars: width of the cell, without the extra chars
 **/
-static VOID * CalculateTextTableDimensionCb(IN DATA_SET_CONTEXT *DataSetCtx, IN CHAR16 *CurPath, IN VOID *UserData, IN VOID *ParentUserData) {
-  PRV_TABLE_INFO *PrvTableInfo = (PRV_TABLE_INFO *)UserData;
-  PRINTER_TABLE_ATTRIB *Attribs;
-  PRINTER_TABLE_ATTRIB *ModifiedAttribs;
-  CHAR16 *TempCurPath = CatSPrint(CurPath, L".");
-  UINT32 ColumnIndex = 0;
-  UINTN NumColumns = 0;
-  UINTN MaxCellChars = 0;
-  CHAR16 *EmptyCell = L"X";
-  CHAR16 *KeyVal;
+static VOID TextTablePutCell(IN TEXT_TABLE *Table, IN UINT32 Column, IN CONST TEXT_TABLE_CELL *Cell, IN UINTN MaxCellChars) {
+  CHAR16 *EndOfRowText = NULL;
+  UINTN CellValueIndex = 0;
 
-  if (NULL == UserData || NULL == TempCurPath) {
-    goto Finish;
+  if (!TextTableReserve(Table, MaxCellChars + CELL_EXTRA_CHARS)) {
+    return;
   }
 
+  EndOfRowText = &Table->Out[Table->OutLength];
+  //Always start cell with a space
+  *EndOfRowText++ = CHAR_WHITE_SPACE;
+  for (CellValueIndex = 0; CellValueIndex < MaxCellChars; ++CellValueIndex) {
+    //fill the column cell with the key value, pad the rest with whitespaces
+    EndOfRowText[CellValueIndex] = (CellValueIndex < Cell->Length) ? Cell->Value[CellValueIndex] : CHAR_WHITE_SPACE;
+  }
+  if ((Column + 1) != Table->NumColumns) {
+    EndOfRowText[CellValueIndex] = TEXT_TABLE_DEFAULT_DELIM;
+    ++CellValueIndex;
+  }
+  Table->OutLength += CellValueIndex + 1;
+}
 
-  Attribs = (PRINTER_TABLE_ATTRIB *)PrvTableInfo->AllTableAttribs;
-  ModifiedAttribs = (PRINTER_TABLE_ATTRIB *)PrvTableInfo->ModifiedTableAttribs;
-  NumColumns = NumTableColumns(Attribs);
+/**
+Append a character repeated Count times to the output buffer of a text table.
+**/
+static VOID TextTablePutChars(IN TEXT_TABLE *Table, IN CHAR16 Char, IN UINTN Count) {
+  if (!TextTableReserve(Table, Count)) {
+    return;
+  }
+  while (Count-- > 0) {
+    Table->Out[Table->OutLength++] = Char;
+  }
+}
 
-  //Loop through all column attributes defined by the CLI cmd handler
-  for (ColumnIndex = 0; ColumnIndex < NumColumns; ++ColumnIndex) {
-    //column attributes defines which key/value pairs to display in each column.
-    //This is done by specifying a path to a key in the form of: /sensorlist/dimm/sensor.keyname.
-    //TempCurPath represents the current node in path form with a '.' at the end, i.e. /sensorlist/dimm/sensor.
-    if (0 == StrnCmp(TempCurPath, Attribs->ColumnAttribs[ColumnIndex].ColumnDataSetPath, StrLen(TempCurPath))) {
-      //Found a path in column attributes that points to our current node, try to retrieve the
-      //associated value.
-      GetKeyValueWideStr(DataSetCtx, TextTableFindKeyInPath(Attribs->ColumnAttribs[ColumnIndex].ColumnDataSetPath), &KeyVal, NULL);
-      if (NULL == KeyVal) {
-        KeyVal = EmptyCell;
-      }
-      MaxCellChars = StrLen(KeyVal) + 1;
+/**
+Append the table header and the header/body separator to the output buffer.
 
-      if (MaxCellChars < Attribs->ColumnAttribs[ColumnIndex].ColumnMaxStrLen && MaxCellChars > ModifiedAttribs->ColumnAttribs[ColumnIndex].ColumnMaxStrLen) {
-        ModifiedAttribs->ColumnAttribs[ColumnIndex].ColumnMaxStrLen = (UINT32)MaxCellChars;
-      }
-      //reset to original max width specified by the attributes table
-      else if (MaxCellChars >= Attribs->ColumnAttribs[ColumnIndex].ColumnMaxStrLen) {
-        ModifiedAttribs->ColumnAttribs[ColumnIndex].ColumnMaxStrLen = Attribs->ColumnAttribs[ColumnIndex].ColumnMaxStrLen;
-      }
-    }
+@param[in] Table: table being rendered, with its final column widths
+**/
+static VOID TextTablePutHeader(IN TEXT_TABLE *Table) {
+  TEXT_TABLE_CELL Header;
+  UINT32 Column = 0;
+  UINTN HeaderChars = 0;
+
+  for (Column = 0; Column < Table->NumColumns; ++Column) {
+    Header.Value = Table->Attribs->ColumnAttribs[Column].ColumnHeader;
+    Header.Length = (UINT32)StrLen(Header.Value);
+    TextTablePutCell(Table, Column, &Header, Table->Widths[Column]);
+    HeaderChars += Table->Widths[Column] + (((Column + 1) != Table->NumColumns) ? CELL_EXTRA_CHARS : 1);
   }
+  TextTablePutChars(Table, CHAR_NEW_LINE, 1);
 
-Finish:
-  FREE_POOL_SAFE(TempCurPath);
-  return NULL;
+  //Print the header/body seperator
+  TextTablePutChars(Table, TEXT_TABLE_HEADER_SEP, HeaderChars);
+  TextTablePutChars(Table, CHAR_NEW_LINE, 1);
 }
 
-
 /**
-The node that represents the last cell in a row is responsible for printing the entire row.
-This is a helper to create a path in the form of /sensorlist/dimm/sensor
-that points to a particular "printer node".
+Append a row to the output buffer of a text table.
 
+@param[in] Table: table being rendered
+@param[in] Cells: cells of the row, indexed by column
 **/
-static CHAR16 * TextTableGetPrinterNodePath(PRINTER_TABLE_ATTRIB * TableAttribs) {
+static VOID TextTablePutRow(IN TEXT_TABLE *Table, IN CONST TEXT_TABLE_CELL *Cells) {
   UINT32 Index = 0;
-  CHAR16 *PrinterNodePath = NULL;
-  UINT32 DeepestLevel = 0;
-  UINT32 TempLevelCount = 0;
-  CHAR16 *TempPath;
+  UINT32 Column = 0;
+  UINTN MaxCellChars = 0;
 
-  for (Index = 0; Index < MAX_TABLE_COLUMNS; ++Index) {
-    if(!TableAttribs->ColumnAttribs[Index].ColumnDataSetPath) {
-      break;
+  for (Index = 0; Index < Table->NumRowColumns; ++Index) {
+    Column = Table->RowColumns[Index];
+    //if the last column is held by the printer node, let the value wrap
+    if (Table->WrapLastColumn && Column == (Table->NumColumns - 1)) {
+      MaxCellChars = Cells[Column].Length;
     }
-    TempPath = (CHAR16*)TableAttribs->ColumnAttribs[Index].ColumnDataSetPath;
-    TempLevelCount = 0;
-    while (*TempPath != CHAR_NULL_TERM) {
-      if (*TempPath == CHAR_PATH_DELIM) {
-        ++TempLevelCount;
-      }
-      ++TempPath;
-    }
-    if (TempLevelCount > DeepestLevel) {
-      PrinterNodePath = (CHAR16*)TableAttribs->ColumnAttribs[Index].ColumnDataSetPath;
+    else {
+      MaxCellChars = Table->Widths[Column];
     }
+    TextTablePutCell(Table, Column, &Cells[Column], MaxCellChars);
   }
+  TextTablePutChars(Table, CHAR_NEW_LINE, 1);
+}
 
-  return PrinterNodePath;
+/**
+Retrieve the value of a column from the data set it matches and account for it
+in the width of the column.
+
+@param[in] Table: table being rendered
+@param[in] DataSetCtx: data set that holds the key of the column
+@param[in] Column: index of the column
+**/
+static VOID TextTableSetCell(IN TEXT_TABLE *Table, IN DATA_SET_CONTEXT *DataSetCtx, IN UINT32 Column) {
+  TEXT_TABLE_CELL *Cell = &Table->Current[Column];
+  CHAR16 *KeyVal = NULL;
+  UINT32 MaxCellChars = 0;
+
+  GetKeyValueWideStr(DataSetCtx, Table->Keys[Column], &KeyVal, NULL);
+  Cell->Value = (NULL != KeyVal) ? KeyVal : TEXT_TABLE_EMPTY_CELL;
+  Cell->Length = (UINT32)StrLen(Cell->Value);
+
+  //columns grow to fit their widest value, up to the max width specified by the attributes table
+  if (!Table->Streaming) {
+    MaxCellChars = MIN(Cell->Length + 1, Table->Attribs->ColumnAttribs[Column].ColumnMaxStrLen);
+    if (MaxCellChars > Table->Widths[Column]) {
+      Table->Widths[Column] = MaxCellChars;
+    }
+  }
 }
 
-/*
-* Main entry point for displaying a hierarchical data set as a table
-*/
-VOID PrintDataSetAsTextTable(DATA_SET_CONTEXT *DataSetCtx, PRINTER_TABLE_ATTRIB * Attribs) {
+/**
+Keep the cells of the current row, or write the row out right away in streaming mode.
+The cells are kept per column, the values stay owned by the data set.
 
+@param[in] Table: table being rendered
+
+@retval BOOLEAN FALSE if out of memory
+**/
+static BOOLEAN TextTableAddRow(IN TEXT_TABLE *Table) {
   UINT32 Index = 0;
-  UINT32 Index2 = 0;
-  PRV_TABLE_INFO PrvTableInfo;
-  CHAR16 *TableHeaderStart = NULL;
-  CHAR16 *TableHeaderEnd = NULL;
-  UINTN RowSizeInBytes = 0;
-  UINTN RowSizeInChars = 0;
-  UINTN NumColumns = NumTableColumns(Attribs);
+  UINT32 Column = 0;
+  UINTN NewCapacity = 0;
+  TEXT_TABLE_CELL *NewCells = NULL;
+
+  if (Table->Streaming) {
+    TextTablePutRow(Table, Table->Current);
+    return TRUE;
+  }
+
+  if (Table->NumRows == Table->RowCapacity) {
+    NewCapacity = (0 == Table->RowCapacity) ? TEXT_TABLE_MIN_ROWS : Table->RowCapacity * 2;
+    for (Index = 0; Index < Table->NumRowColumns; ++Index) {
+      Column = Table->RowColumns[Index];
+      if (NULL == (NewCells = ReallocatePool(Table->RowCapacity * sizeof(TEXT_TABLE_CELL),
+        NewCapacity * sizeof(TEXT_TABLE_CELL), Table->Rows[Column]))) {
+        NVDIMM_CRIT("ReallocatePool returned NULL\n");
+        return FALSE;
+      }
+      Table->Rows[Column] = NewCells;
+    }
+    Table->RowCapacity = NewCapacity;
+  }
 
-  if (NULL == Attribs) {
-    NVDIMM_CRIT("CMDs must specify a PRINTER_TABLE_ATTRIB when displaying text tables\n");
-    return;
+  for (Index = 0; Index < Table->NumRowColumns; ++Index) {
+    Column = Table->RowColumns[Index];
+    Table->Rows[Column][Table->NumRows] = Table->Current[Column];
   }
+  ++Table->NumRows;
+  return TRUE;
+}
 
-  TableHeaderStart = CatSPrint(NULL, L"");
-  if (NULL == TableHeaderStart) {
-    return;
+/**
+Walk a data set tree, only dirty data sets are visited.
+Column paths in the form of /sensorlist/dimm/sensor.keyname are matched one data set
+name at a time: ParentOffsets tells how much of each path matched the ancestors and
+ParentMask which of the columns may still match this data set or its children.
+
+@param[in] Table: table being rendered
+@param[in] DataSetCtx: current data set node
+@param[in] ParentMask: columns whose path matched all the ancestors
+@param[in] ParentOffsets: end of the part of each column path matched by the ancestors
+
+@retval BOOLEAN FALSE if out of memory
+**/
+static BOOLEAN TextTableWalk(IN TEXT_TABLE *Table, IN DATA_SET_CONTEXT *DataSetCtx, IN UINT32 ParentMask, IN CONST UINTN *ParentOffsets) {
+  UINTN Offsets[MAX_TABLE_COLUMNS];
+  CONST CHAR16 *Name = GetDataSetName(DataSetCtx);
+  UINTN NameLength = StrLen(Name);
+  CONST CHAR16 *Path = NULL;
+  UINT32 NumPathColumns = Table->NumPathColumns;
+  UINT32 Mask = 0;
+  UINT32 MatchedMask = 0;
+  UINT32 Column = 0;
+  DATA_SET_CONTEXT *Child = NULL;
+  BOOLEAN ReturnValue = TRUE;
+
+  if (!IsDirty(DataSetCtx)) {
+    return TRUE;
   }
 
-  //Loop generates a string that represents the table's header
-  for (Index = 0; Index < NumColumns; ++Index) {
-    //TableRowStart contains cells in a row already processed, now add more memory for the next cell in the row
-    RowSizeInBytes = StrSize(TableHeaderStart) + ((Attribs->ColumnAttribs[Index].ColumnMaxStrLen + CELL_EXTRA_CHARS) * sizeof(CHAR16)); //+CELL_EXTRA_CHARS on ColumnWidth to accommodate whitespace and pipe
-    if (NULL == (TableHeaderStart = ReallocatePool(StrSize(TableHeaderStart), RowSizeInBytes, TableHeaderStart))) {
-      return;
+  //Loop through all column attributes defined by the CLI cmd handler
+  for (Column = 0; Column < Table->NumColumns; ++Column) {
+    if (0 == (ParentMask & (1 << Column))) {
+      continue;
     }
-    //TableHeaderEnd points to end of the already processed row cells
-    TableHeaderEnd = &TableHeaderStart[StrLen(TableHeaderStart)];
-    //Always start cell with a space
-    *TableHeaderEnd++ = CHAR_WHITE_SPACE;
-
-    for (Index2 = 0; Index2 < Attribs->ColumnAttribs[Index].ColumnMaxStrLen; ++Index2) {
-      if (Index2 < StrLen(Attribs->ColumnAttribs[Index].ColumnHeader)) {
-        TableHeaderEnd[Index2] = Attribs->ColumnAttribs[Index].ColumnHeader[Index2];
-      }
-      else {
-        TableHeaderEnd[Index2] = CHAR_WHITE_SPACE;
-      }
+    Path = &Table->Attribs->ColumnAttribs[Column].ColumnDataSetPath[ParentOffsets[Column]];
+    if (CHAR_PATH_DELIM != Path[0] || 0 != StrnCmp(&Path[1], Name, NameLength)) {
+      continue;
+    }
+    Offsets[Column] = ParentOffsets[Column] + 1 + NameLength;
+    if (CHAR_PATH_DELIM == Path[1 + NameLength]) {
+      Mask |= 1 << Column;
     }
-    if ((Index + 1) != NumColumns) {
-      TableHeaderEnd[Index2] = TEXT_TABLE_DEFAULT_DELIM;
-      ++Index2;
+    else if (L'.' == Path[1 + NameLength]) {
+      //the column path points to the current node, retrieve the associated value
+      TextTableSetCell(Table, DataSetCtx, Column);
+      Table->PathColumns[Table->NumPathColumns++] = Column;
+      MatchedMask |= 1 << Column;
     }
-    TableHeaderEnd[Index2] = CHAR_NULL_TERM;
   }
 
-  //Print the header
-  while (TableHeaderStart[RowSizeInChars] != CHAR_NULL_TERM) {
-    Print(FORMAT_CHAR, TableHeaderStart[RowSizeInChars]);
-    ++RowSizeInChars;
+  //The node that represents the last cell in a row is responsible for the entire row.
+  //Its row holds the cells of all the nodes on its path, in the order they were matched.
+  if (Table->PrinterColumn < Table->NumColumns && (MatchedMask & (1 << Table->PrinterColumn))) {
+    if (0 == Table->NumRows && 0 == Table->NumRowColumns) {
+      CopyMem_S(Table->RowColumns, sizeof(Table->RowColumns), Table->PathColumns, Table->NumPathColumns * sizeof(UINT32));
+      Table->NumRowColumns = Table->NumPathColumns;
+      Table->WrapLastColumn = (0 != (MatchedMask & (1 << (Table->NumColumns - 1))));
+    }
+    if (!TextTableAddRow(Table)) {
+      ReturnValue = FALSE;
+      goto Finish;
+    }
   }
 
-  FreePool(TableHeaderStart);
-  Print(TEXT_NEW_LINE);
+  //no column goes deeper than this node
+  if (0 == Mask) {
+    goto Finish;
+  }
 
-  //Print the header/body seperator
-  for (Index = 0; Index < RowSizeInChars; ++Index) {
-    Print(TEXT_TABLE_HEADER_SEP);
+  while (NULL != (Child = GetNextChildDataSet(DataSetCtx, Child))) {
+    if (!TextTableWalk(Table, Child, Mask, Offsets)) {
+      ReturnValue = FALSE;
+      goto Finish;
+    }
   }
-  Print(TEXT_NEW_LINE);
 
-  PrvTableInfo.AllTableAttribs = Attribs;
-  PrvTableInfo.PrinterNode = TextTableGetPrinterNodePath(Attribs);
-  //Print the body of the table
-  RecurseDataSet(DataSetCtx, TextTableCb, NULL, (VOID*)&PrvTableInfo, TRUE);
+Finish:
+  Table->NumPathColumns = NumPathColumns;
+  return ReturnValue;
 }
 
-/*
-* Determine column widths of a text table
-*/
-VOID CalculateTextTableDimensions(DATA_SET_CONTEXT *DataSetCtx, PRINTER_TABLE_ATTRIB * Attribs, PRINTER_TABLE_ATTRIB * ModifiedAttribs) {
+/**
+Main entry point for displaying a hierarchical data set as a table.
+The data set is walked once, collecting the rows and tracking the column widths,
+then the table is written out with a single print. In streaming mode the columns
+are as wide as their max width and rows are written as they are found.
 
+@param[in] DataSetCtx: Represents a data set that contains key/val pairs
+@param[in] Attribs: User specified attributes that defines how a table should be printed
+@param[in] Streaming: TRUE for fixed width columns and rows written out as they are found
+**/
+static VOID PrintDataSetAsTextTable(IN DATA_SET_CONTEXT *DataSetCtx, IN PRINTER_TABLE_ATTRIB *Attribs, IN BOOLEAN Streaming) {
+  TEXT_TABLE Table;
+  TEXT_TABLE_CELL Cells[MAX_TABLE_COLUMNS];
+  UINTN Offsets[MAX_TABLE_COLUMNS];
+  CONST CHAR16 *PrinterNodePath = NULL;
+  UINT32 Mask = 0;
+  UINT32 Column = 0;
   UINT32 Index = 0;
-  PRV_TABLE_INFO PrvTableInfo;
-  UINTN NumColumns = NumTableColumns(Attribs);
-  UINTN ColumnHeaderStrLen = 0;
+  UINTN Row = 0;
 
-  if (NULL == Attribs || NULL == ModifiedAttribs) {
+  if (NULL == Attribs) {
     NVDIMM_CRIT("CMDs must specify a PRINTER_TABLE_ATTRIB when displaying text tables\n");
     return;
   }
 
-  //calculate max column header widths
-  for (Index = 0; Index < NumColumns; ++Index) {
-    ColumnHeaderStrLen = StrLen(Attribs->ColumnAttribs[Index].ColumnHeader) + 1;
-    if (ColumnHeaderStrLen < Attribs->ColumnAttribs[Index].ColumnMaxStrLen) {
-      ModifiedAttribs->ColumnAttribs[Index].ColumnMaxStrLen = (UINT32)ColumnHeaderStrLen;
+  ZeroMem(&Table, sizeof(Table));
+  ZeroMem(Offsets, sizeof(Offsets));
+  Table.Attribs = Attribs;
+  Table.NumColumns = (UINT32)NumTableColumns(Attribs);
+  Table.Streaming = Streaming;
+  Table.PrinterColumn = MAX_TABLE_COLUMNS;
+  PrinterNodePath = TextTableGetPrinterNodePath(Attribs);
+
+  for (Column = 0; Column < Table.NumColumns; ++Column) {
+    if (NULL == Attribs->ColumnAttribs[Column].ColumnDataSetPath) {
+      continue;
+    }
+    Mask |= 1 << Column;
+    Table.Keys[Column] = TextTableFindKeyInPath(Attribs->ColumnAttribs[Column].ColumnDataSetPath);
+    if (Attribs->ColumnAttribs[Column].ColumnDataSetPath == PrinterNodePath) {
+      Table.PrinterColumn = Column;
+    }
+    //columns are at least as wide as their header, up to their max width
+    Table.Widths[Column] = Attribs->ColumnAttribs[Column].ColumnMaxStrLen;
+    if (!Streaming) {
+      Table.Widths[Column] = MIN((UINT32)StrLen(Attribs->ColumnAttribs[Column].ColumnHeader) + 1, Table.Widths[Column]);
+    }
+  }
+
+  if (Streaming) {
+    TextTablePutHeader(&Table);
+  }
+
+  if (TextTableWalk(&Table, DataSetCtx, Mask, Offsets) && !Streaming) {
+    TextTablePutHeader(&Table);
+    for (Row = 0; Row < Table.NumRows; ++Row) {
+      for (Index = 0; Index < Table.NumRowColumns; ++Index) {
+        Column = Table.RowColumns[Index];
+        Cells[Column] = Table.Rows[Column][Row];
+      }
+      TextTablePutRow(&Table, Cells);
     }
   }
 
-  PrvTableInfo.AllTableAttribs = Attribs;
-  PrvTableInfo.ModifiedTableAttribs = ModifiedAttribs;
-  PrvTableInfo.PrinterNode = TextTableGetPrinterNodePath(Attribs);
-  //calculate max column widths based on table content
-  RecurseDataSet(DataSetCtx, CalculateTextTableDimensionCb, NULL, (VOID*)&PrvTableInfo, TRUE);
+  TextTableFlush(&Table);
+
+  for (Column = 0; Column < MAX_TABLE_COLUMNS; ++Column) {
+    FREE_POOL_SAFE(Table.Rows[Column]);
+  }
+  FREE_POOL_SAFE(Table.Out);
 }
 
 /*
@@ -885,13 +992,6 @@ static VOID PrintEsxKeyValXml(DATA_SET_CONTEXT *DataSetCtx) {
 static VOID PrintAsText(DATA_SET_CONTEXT *DataSetCtx, PRINT_CONTEXT *PrintCtx) {
   PRINTER_DATA_SET_ATTRIBS *Attribs = (PRINTER_DATA_SET_ATTRIBS *)GetDataSetUserData(DataSetCtx);
   PRINTER_LIST_ATTRIB *ListAttribs = NULL;
-  PRINTER_TABLE_ATTRIB *TableAttribs = NULL;
-  PRINTER_TABLE_ATTRIB *ModifiedTableAttribs = (PRINTER_TABLE_ATTRIB *)AllocateZeroPool(sizeof(PRINTER_TABLE_ATTRIB));
-
-  if (NULL == ModifiedTableAttribs) {
-    NVDIMM_CRIT("AllocateZeroPool returned NULL\n");
-    return;
-  }
 
   if (PrintCtx->FormatTypeFlags.Flags.List) {
     if (Attribs) {
@@ -900,22 +1000,13 @@ static VOID PrintAsText(DATA_SET_CONTEXT *DataSetCtx, PRINT_CONTEXT *PrintCtx) {
     PrintTextList(DataSetCtx, ListAttribs);
   }
   else if (PrintCtx->FormatTypeFlags.Flags.Table) {
-    if (Attribs) {
-      TableAttribs = Attribs->pTableAttribs;
-      if(TableAttribs) {
-        CopyMem_S(ModifiedTableAttribs, sizeof(PRINTER_TABLE_ATTRIB), TableAttribs, sizeof(PRINTER_TABLE_ATTRIB));
-      }
-    }
-    else
+    if (NULL == Attribs)
     {
       NVDIMM_CRIT("CMDs must specify a PRINTER_TABLE_ATTRIB when displaying text tables\n");
-      goto Finish;
+      return;
     }
-    CalculateTextTableDimensions(DataSetCtx, TableAttribs, ModifiedTableAttribs);
-    PrintDataSetAsTextTable(DataSetCtx, ModifiedTableAttribs);
+    PrintDataSetAsTextTable(DataSetCtx, Attribs->pTableAttribs, (BOOLEAN)PrintCtx->FormatTypeFlags.Flags.TableStream);
   }
-Finish:
-  FREE_POOL_SAFE(ModifiedTableAttribs);
 }
 
 /*
@@ -942,6 +1033,306 @@ static VOID PrintAsXml(DATA_SET_CONTEXT *DataSetCtx, PRINT_CONTEXT *PrintCtx) {
   }
 }
 
+/*
+* Write out the buffered JSON text
+*/
+static VOID JsonFlush(JSON_OUT *Out) {
+  if (0 == Out->Length) {
+    return;
+  }
+  Out->Buffer[Out->Length] = CHAR_NULL_TERM;
+  Print(FORMAT_STR, Out->Buffer);
+  Out->Length = 0;
+}
+
+static VOID JsonPutChar(JSON_OUT *Out, CHAR16 Char) {
+  if (JSON_OUT_BUFFER_LEN == Out->Length) {
+    JsonFlush(Out);
+  }
+  Out->Buffer[Out->Length++] = Char;
+}
+
+static VOID JsonPutStr(JSON_OUT *Out, CONST CHAR16 *Str) {
+  while (NULL != Str && CHAR_NULL_TERM != *Str) {
+    JsonPutChar(Out, *Str++);
+  }
+}
+
+static VOID JsonPutHex4(JSON_OUT *Out, CHAR16 Char) {
+  CONST CHAR16 *Digits = L"0123456789abcdef";
+  JsonPutStr(Out, L"\\u");
+  JsonPutChar(Out, Digits[(Char >> 12) & 0xF]);
+  JsonPutChar(Out, Digits[(Char >> 8) & 0xF]);
+  JsonPutChar(Out, Digits[(Char >> 4) & 0xF]);
+  JsonPutChar(Out, Digits[Char & 0xF]);
+}
+
+/*
+* Write a JSON string. Leading and trailing whitespace is dropped like in the XML
+* output, anything outside of printable ASCII is escaped so the stream stays valid
+* whatever the encoding of stdout is.
+*/
+static VOID JsonPutQuotedStr(JSON_OUT *Out, CONST CHAR16 *Str) {
+  CONST CHAR16 *End = NULL;
+
+  JsonPutChar(Out, L'"');
+  if (NULL != Str) {
+    while (CHAR_WHITE_SPACE == *Str || L'\t' == *Str || L'\n' == *Str || L'\r' == *Str) {
+      Str++;
+    }
+    End = Str + StrLen(Str);
+    while (End > Str && (CHAR_WHITE_SPACE == End[-1] || L'\t' == End[-1] || L'\n' == End[-1] || L'\r' == End[-1])) {
+      End--;
+    }
+    for (; Str < End; Str++) {
+      if (L'"' == *Str || L'\\' == *Str) {
+        JsonPutChar(Out, L'\\');
+        JsonPutChar(Out, *Str);
+      }
+      else if (L'\n' == *Str) {
+        JsonPutStr(Out, L"\\n");
+      }
+      else if (L'\t' == *Str) {
+        JsonPutStr(Out, L"\\t");
+      }
+      else if (*Str < L' ' || *Str > L'~') {
+        JsonPutHex4(Out, *Str);
+      }
+      else {
+        JsonPutChar(Out, *Str);
+      }
+    }
+  }
+  JsonPutChar(Out, L'"');
+}
+
+/*
+* Keys are written the way the XML tags are, without whitespace
+*/
+static VOID JsonPutKey(JSON_OUT *Out, CONST CHAR16 *Key) {
+  CHAR16 *TrimmedKey = CatSPrint(NULL, FORMAT_STR, Key);
+
+  if (NULL != TrimmedKey) {
+    RemoveAllWhiteSpace(TrimmedKey);
+  }
+  JsonPutQuotedStr(Out, (NULL != TrimmedKey) ? TrimmedKey : Key);
+  JsonPutChar(Out, L':');
+  FREE_POOL_SAFE(TrimmedKey);
+}
+
+/*
+* Booleans and decimal numbers keep their type, hex numbers and strings are quoted
+*/
+static VOID JsonPutValue(JSON_OUT *Out, DATA_SET_CONTEXT *DataSetCtx, KEY_VAL_INFO *KvInfo) {
+  CHAR16 *Val = NULL;
+  BOOLEAN BoolVal = FALSE;
+
+  GetKeyValueWideStr(DataSetCtx, KvInfo->Key, &Val, NULL);
+  if (NULL == Val) {
+    JsonPutStr(Out, L"null");
+    return;
+  }
+
+  switch (KvInfo->Type) {
+  case KEY_BOOL:
+    GetKeyValueBool(DataSetCtx, KvInfo->Key, &BoolVal, NULL);
+    JsonPutStr(Out, BoolVal ? L"true" : L"false");
+    break;
+  case KEY_W_STR:
+    JsonPutQuotedStr(Out, Val);
+    break;
+  default:
+    if (DECIMAL == KvInfo->Base) {
+      JsonPutStr(Out, Val);
+    }
+    else {
+      JsonPutQuotedStr(Out, Val);
+    }
+    break;
+  }
+}
+
+/*
+* Write the keys of a data set as members of the current JSON object
+*/
+static BOOLEAN JsonPutKeys(JSON_OUT *Out, DATA_SET_CONTEXT *DataSetCtx, BOOLEAN First) {
+  KEY_VAL_INFO *KvInfo = NULL;
+
+  while (NULL != (KvInfo = GetNextKey(DataSetCtx, KvInfo))) {
+    if (!First) {
+      JsonPutChar(Out, L',');
+    }
+    First = FALSE;
+    JsonPutKey(Out, KvInfo->Key);
+    JsonPutValue(Out, DataSetCtx, KvInfo);
+  }
+  return First;
+}
+
+/*
+* Write a data set as a JSON object: its keys, then its children grouped
+* by name into arrays in the order the names first appear.
+* Only the parts of the tree holding values are written, like in the XML output.
+* The children sharing a name are found through the child index of the data set.
+*/
+static VOID JsonPutDataSet(JSON_OUT *Out, DATA_SET_CONTEXT *DataSetCtx) {
+  DATA_SET_CONTEXT *Child = NULL;
+  DATA_SET_CONTEXT *Sibling = NULL;
+  CHAR16 *Name = NULL;
+  UINT32 Instance = 0;
+  BOOLEAN First = TRUE;
+  BOOLEAN FirstInArray = TRUE;
+
+  JsonPutChar(Out, L'{');
+  First = JsonPutKeys(Out, DataSetCtx, First);
+  while (NULL != (Child = GetNextChildDataSet(DataSetCtx, Child))) {
+    Name = GetDataSetName(Child);
+    //the array of a name is written where its first child is
+    if (Child != GetChildDataSet(DataSetCtx, Name, 0)) {
+      continue;
+    }
+    FirstInArray = TRUE;
+    for (Instance = 0; NULL != (Sibling = GetChildDataSet(DataSetCtx, Name, Instance)); Instance++) {
+      if (!IsDirty(Sibling)) {
+        continue;
+      }
+      if (FirstInArray) {
+        if (!First) {
+          JsonPutChar(Out, L',');
+        }
+        First = FALSE;
+        JsonPutKey(Out, Name);
+        JsonPutChar(Out, L'[');
+      }
+      else {
+        JsonPutChar(Out, L',');
+      }
+      FirstInArray = FALSE;
+      JsonPutDataSet(Out, Sibling);
+    }
+    if (!FirstInArray) {
+      JsonPutChar(Out, L']');
+    }
+  }
+  JsonPutChar(Out, L'}');
+}
+
+/*
+* Write a one member object: {"Name":<data set>}
+*/
+static VOID JsonPutNamedDataSet(JSON_OUT *Out, DATA_SET_CONTEXT *DataSetCtx) {
+  JsonPutChar(Out, L'{');
+  JsonPutKey(Out, GetDataSetName(DataSetCtx));
+  JsonPutDataSet(Out, DataSetCtx);
+  JsonPutChar(Out, L'}');
+}
+
+/*
+* Write a message as {"Message":"..."}, as a line of its own for NDJSON
+*/
+static VOID PrintMsgAsJson(JSON_OUT *Out, PRINT_CONTEXT *PrintCtx, CHAR16 *Msg, BOOLEAN *pFirst) {
+  if (NULL == Msg) {
+    return;
+  }
+  if (!PrintCtx->FormatTypeFlags.Flags.Ndjson && !*pFirst) {
+    JsonPutChar(Out, L',');
+  }
+  *pFirst = FALSE;
+  JsonPutChar(Out, L'{');
+  JsonPutKey(Out, JSON_MESSAGE_KEY);
+  JsonPutQuotedStr(Out, Msg);
+  JsonPutChar(Out, L'}');
+  if (PrintCtx->FormatTypeFlags.Flags.Ndjson) {
+    JsonPutChar(Out, L'\n');
+    JsonFlush(Out);
+  }
+}
+
+/*
+* Main entry point for displaying a hierarchical data set as JSON.
+* As a JSON document the whole tree is one element of the output array,
+* as NDJSON every top level child is a line of its own so a consumer can
+* process the records (e.g. each DIMM) as they come.
+*/
+static VOID PrintAsJson(JSON_OUT *Out, DATA_SET_CONTEXT *DataSetCtx, PRINT_CONTEXT *PrintCtx, BOOLEAN *pFirst) {
+  DATA_SET_CONTEXT *Child = NULL;
+
+  if (NULL == DataSetCtx || !IsDirty(DataSetCtx)) {
+    return;
+  }
+
+  if (!PrintCtx->FormatTypeFlags.Flags.Ndjson) {
+    if (!*pFirst) {
+      JsonPutChar(Out, L',');
+    }
+    *pFirst = FALSE;
+    JsonPutNamedDataSet(Out, DataSetCtx);
+    return;
+  }
+
+  *pFirst = FALSE;
+  if (0 != GetKeyCount(DataSetCtx)) {
+    JsonPutChar(Out, L'{');
+    JsonPutKey(Out, GetDataSetName(DataSetCtx));
+    JsonPutChar(Out, L'{');
+    JsonPutKeys(Out, DataSetCtx, TRUE);
+    JsonPutStr(Out, L"}}\n");
+    JsonFlush(Out);
+  }
+  while (NULL != (Child = GetNextChildDataSet(DataSetCtx, Child))) {
+    if (!IsDirty(Child)) {
+      continue;
+    }
+    JsonPutNamedDataSet(Out, Child);
+    JsonPutChar(Out, L'\n');
+    JsonFlush(Out);
+  }
+}
+
+/*
+* Write the "ReturnCode" member, the same code the XML error tag carries
+*/
+static VOID JsonPutReturnCode(JSON_OUT *Out, EFI_STATUS CmdExitCode) {
+  CHAR16 Number[24];
+
+#ifdef OS_BUILD
+  CmdExitCode = UefiToOsReturnCode(CmdExitCode);
+#endif
+  UnicodeSPrint(Number, sizeof(Number), L"%d", (INT32)CmdExitCode);
+  JsonPutKey(Out, JSON_RETURN_CODE_KEY);
+  JsonPutStr(Out, Number);
+}
+
+/*
+* Display beginning of a JSON document, the NDJSON stream has no header
+*/
+static VOID PrintJsonStart(JSON_OUT *Out, PRINT_CONTEXT *PrintCtx, EFI_STATUS CmdExitCode) {
+  if (PrintCtx->FormatTypeFlags.Flags.Ndjson) {
+    return;
+  }
+  JsonPutChar(Out, L'{');
+  JsonPutReturnCode(Out, CmdExitCode);
+  JsonPutChar(Out, L',');
+  JsonPutKey(Out, JSON_OUTPUT_KEY);
+  JsonPutChar(Out, L'[');
+}
+
+/*
+* Display ending of a JSON document, the NDJSON stream ends with the return code
+*/
+static VOID PrintJsonEnd(JSON_OUT *Out, PRINT_CONTEXT *PrintCtx, EFI_STATUS CmdExitCode) {
+  if (PrintCtx->FormatTypeFlags.Flags.Ndjson) {
+    JsonPutChar(Out, L'{');
+    JsonPutReturnCode(Out, CmdExitCode);
+    JsonPutChar(Out, L'}');
+  }
+  else {
+    JsonPutStr(Out, L"]}");
+  }
+  JsonPutChar(Out, L'\n');
+  JsonFlush(Out);
+}
+
 /*
 * Print to stdout with each line starting with ERROR
 */
@@ -1084,7 +1475,6 @@ EFI_STATUS PrinterCreateCtx(
     goto Finish;
   }
   InitializeListHead(&((*ppPrintCtx)->BufferedObjectList));
-  InitializeListHead(&((*ppPrintCtx)->DataSetLookup));
   InitializeListHead(&((*ppPrintCtx)->DataSetRootLookup));
 
   (*ppPrintCtx)->DoNotPrintGeneralStatusSuccessCode = FALSE;
@@ -1092,6 +1482,19 @@ Finish:
   return ReturnCode;
 }
 
+/*
+* Forget the data set looked up last
+*/
+static VOID FreeLastDataSetLookup(
+  IN    PRINT_CONTEXT *pPrintCtx
+)
+{
+  if (NULL != pPrintCtx->pLastDataSetLookup) {
+    FREE_POOL_SAFE(pPrintCtx->pLastDataSetLookup->DsPath);
+    FREE_POOL_SAFE(pPrintCtx->pLastDataSetLookup);
+  }
+}
+
 /*
 * Helper to free all items in the "lookup list"
 */
@@ -1107,12 +1510,7 @@ static VOID CleanDataSetLookupItems(
     return;
   }
 
-  BUFFERED_OBJECT_LIST_FOR_EACH_SAFE(Entry, NextEntry, &pPrintCtx->DataSetLookup) {
-    DataSetLookupItem = BASE_CR(Entry, DATA_SET_LOOKUP_ITEM, Link);
-    RemoveEntryList(&DataSetLookupItem->Link);
-    FREE_POOL_SAFE(DataSetLookupItem->DsPath);
-    FREE_POOL_SAFE(DataSetLookupItem);
-  }
+  FreeLastDataSetLookup(pPrintCtx);
 
   BUFFERED_OBJECT_LIST_FOR_EACH_SAFE(Entry, NextEntry, &pPrintCtx->DataSetRootLookup) {
     DataSetLookupItem = BASE_CR(Entry, DATA_SET_LOOKUP_ITEM, Link);
@@ -1247,7 +1645,7 @@ EFI_STATUS EFIAPI PrinterSetMsg(
   VA_END(Marker);
 
   //here for backwards compatibility
-  if (NULL == pPrintCtx || (!pPrintCtx->FormatTypeFlags.Flags.Buffered && XML != pPrintCtx->FormatType)) {
+  if (NULL == pPrintCtx || (!pPrintCtx->FormatTypeFlags.Flags.Buffered && !PRINTER_STRUCTURED_FORMAT_ENABLED(pPrintCtx))) {
     PrintTextWithNewLine(FullMsg);
     FREE_POOL_SAFE(FullMsg);
     return EFI_SUCCESS;
@@ -1265,7 +1663,7 @@ EFI_STATUS EFIAPI PrinterSetMsg(
     pPrintCtx->BufferedMsgCnt++;
   }
   else {
-    //here to handle the case where printer is unbuffered and XML == pPrintCtx->FormatType
+    //here to handle the case where printer is unbuffered and the format is XML or JSON
     FREE_POOL_SAFE(FullMsg);
   }
   ReturnCode = EFI_SUCCESS;
@@ -1360,6 +1758,9 @@ static PRINT_MODE PrintMode(
   else if (XML == pPrintCtx->FormatType) {
     return PRINT_BASIC_XML;
   }
+  else if (JSON == pPrintCtx->FormatType) {
+    return PRINT_JSON;
+  }
   else return PRINT_TEXT;
 }
 
@@ -1378,6 +1779,8 @@ EFI_STATUS PrinterProcessSetBuffer(
   PRINT_MODE PrinterMode = PRINT_TEXT;
   BOOLEAN startXmlSuccessPrinted = FALSE;
   BOOLEAN startXmlErrorPrinted = FALSE;
+  JSON_OUT *JsonOut = NULL;
+  BOOLEAN FirstJsonObject = TRUE;
 
   if (NULL == pPrintCtx) {
     NVDIMM_ERR("Invalid input parameter\n");
@@ -1404,6 +1807,17 @@ EFI_STATUS PrinterProcessSetBuffer(
       startXmlErrorPrinted = TRUE;
     }
   }
+  else if (PRINT_JSON == PrinterMode) {
+    JsonOut = AllocateZeroPool(sizeof(*JsonOut));
+    if (NULL == JsonOut) {
+      NVDIMM_CRIT("AllocateZeroPool returned NULL\n");
+      ReturnCode = EFI_OUT_OF_RESOURCES;
+      PrinterMode = PRINT_TEXT;
+    }
+    else {
+      PrintJsonStart(JsonOut, pPrintCtx, pPrintCtx->BufferedObjectLastError);
+    }
+  }
 
   //iterate through all items in the "set buffer".
   //all items found should be transformed to text and printed directly to stdout
@@ -1420,6 +1834,9 @@ EFI_STATUS PrinterProcessSetBuffer(
       {
         PrintTextAsEsxError(pTempBs->pStr);
       }
+      else if (PRINT_JSON == PrinterMode) {
+        PrintMsgAsJson(JsonOut, pPrintCtx, pTempBs->pStr, &FirstJsonObject);
+      }
       else
       {
         if (PRINT_XML != PrinterMode) {
@@ -1434,6 +1851,9 @@ EFI_STATUS PrinterProcessSetBuffer(
       if (PRINT_XML == PrinterMode) {
         PrintAsXml(pTempDs->pDataSet, pPrintCtx);
       }
+      else if (PRINT_JSON == PrinterMode) {
+        PrintAsJson(JsonOut, pTempDs->pDataSet, pPrintCtx, &FirstJsonObject);
+      }
       else {
         PrintAsText(pTempDs->pDataSet, pPrintCtx);
       }
@@ -1443,7 +1863,10 @@ EFI_STATUS PrinterProcessSetBuffer(
       BUFFERED_COMMAND_STATUS *pTempCs = (BUFFERED_COMMAND_STATUS *)BufferedObject->Obj;
       CreateCmdStatusMsg(&FullMsg, pTempCs->pStatusMessage, pTempCs->pStatusPreposition,
           pPrintCtx->DoNotPrintGeneralStatusSuccessCode, pTempCs->pCommandStatus);
-      if (PRINT_XML != PrinterMode) {
+      if (PRINT_JSON == PrinterMode) {
+        PrintMsgAsJson(JsonOut, pPrintCtx, FullMsg, &FirstJsonObject);
+      }
+      else if (PRINT_XML != PrinterMode) {
         PrintTextWithNewLine(FullMsg);
       }
       FreeCommandStatus(&pTempCs->pCommandStatus);
@@ -1462,6 +1885,10 @@ EFI_STATUS PrinterProcessSetBuffer(
   else if (TRUE == startXmlSuccessPrinted) {
     PrintXmlEndSuccessTag(pPrintCtx, pPrintCtx->BufferedObjectLastError);
   }
+  else if (PRINT_JSON == PrinterMode) {
+    PrintJsonEnd(JsonOut, pPrintCtx, pPrintCtx->BufferedObjectLastError);
+  }
+  FREE_POOL_SAFE(JsonOut);
 
   CleanDataSetLookupItems(pPrintCtx);
   pPrintCtx->BufferedObjectLastError = EFI_SUCCESS;
@@ -1529,12 +1956,11 @@ EFI_STATUS LookupDataSet(
   DATA_SET_LOOKUP_ITEM *DataSetLookupItem = NULL;
   DATA_SET_CONTEXT *Root = NULL;
 
-  BUFFERED_OBJECT_LIST_FOR_EACH_SAFE(Entry, NextEntry, &pPrintCtx->DataSetLookup) {
-    DataSetLookupItem = BASE_CR(Entry, DATA_SET_LOOKUP_ITEM, Link);
-    if (0 == StrCmp(pKeyPath, DataSetLookupItem->DsPath)) {
-      *ppDataSet = DataSetLookupItem->pDataSet;
-      return EFI_SUCCESS;
-    }
+  //GetDataSet finds data sets through hashed indexes, only the last one is remembered
+  DataSetLookupItem = pPrintCtx->pLastDataSetLookup;
+  if (NULL != DataSetLookupItem && 0 == StrCmp(pKeyPath, DataSetLookupItem->DsPath)) {
+    *ppDataSet = DataSetLookupItem->pDataSet;
+    return EFI_SUCCESS;
   }
 
   //split path, result toks are data set names
@@ -1571,7 +1997,8 @@ EFI_STATUS LookupDataSet(
   *ppDataSet = GetDataSet(Root, pKeyPath);
   DataSetLookupItem = NULL;
   if (EFI_SUCCESS == (ReturnCode = CreateDataSetLookupItem(&DataSetLookupItem, pKeyPath, *ppDataSet))) {
-    InsertTailList(&pPrintCtx->DataSetLookup, &DataSetLookupItem->Link);
+    FreeLastDataSetLookup(pPrintCtx);
+    pPrintCtx->pLastDataSetLookup = DataSetLookupItem;
   }
 
   ReturnCode = EFI_SUCCESS;
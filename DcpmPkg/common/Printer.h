@@ -59,7 +59,8 @@ extern CHAR16* gNullValueToDisplay;
 
 typedef enum {
   TEXT,
-  XML
+  XML,
+  JSON
 }PRINT_FORMAT_TYPE;
 
 typedef enum {
@@ -80,6 +81,8 @@ typedef struct _FLAGS {
   UINTN EsxKeyVal : 1;
   UINTN EsxCustom : 1;
   UINTN Verbose   : 1;
+  UINTN Ndjson    : 1;
+  UINTN TableStream : 1;
 }FLAGS;
 
 typedef union _PRINT_FORMAT_TYPE_FLAGS {
@@ -125,7 +128,7 @@ typedef struct _PRINT_CONTEXT {
   UINTN BufferedMsgCnt;
   UINTN BufferedCmdStatusCnt;
   UINTN BufferedDataSetCnt;
-  LIST_ENTRY DataSetLookup;
+  DATA_SET_LOOKUP_ITEM *pLastDataSetLookup; //consecutive keys mostly go to the same path
   LIST_ENTRY DataSetRootLookup;
   BOOLEAN DoNotPrintGeneralStatusSuccessCode;
 }PRINT_CONTEXT;
@@ -161,6 +164,10 @@ typedef struct _PRINTER_DATA_SET_ATTRIBS
 #define PRINTER_ESX_FORMAT_ENABLED(Ctx) \
   (NULL != Ctx && (Ctx->FormatTypeFlags.Flags.EsxKeyVal || Ctx->FormatTypeFlags.Flags.EsxCustom)) \
 
+/**Is running in a machine readable format (XML or JSON), nothing is prompted**/
+#define PRINTER_STRUCTURED_FORMAT_ENABLED(Ctx) \
+  (NULL != Ctx && (XML == Ctx->FormatType || JSON == Ctx->FormatType)) \
+
 /**Display dataset as a table (default list)**/
 #define PRINTER_ENABLE_TEXT_TABLE_FORMAT(Ctx) \
 if(NULL != Ctx) { \
@@ -189,6 +196,18 @@ if(NULL != Ctx) { \
   Ctx->FormatTypeFlags.Flags.EsxCustom = 1; \
 } \
 
+/**Display dataset as newline-delimited JSON, one record per line (-o ndjson)**/
+#define PRINTER_ENABLE_NDJSON_FORMAT(Ctx) \
+if(NULL != Ctx) { \
+  Ctx->FormatTypeFlags.Flags.Ndjson = 1; \
+} \
+
+/**Display text tables with fixed width columns, rows are written as they are found (-o stream)**/
+#define PRINTER_ENABLE_TEXT_TABLE_STREAMING(Ctx) \
+if(NULL != Ctx) { \
+  Ctx->FormatTypeFlags.Flags.TableStream = 1; \
+} \
+
 /**Set printer format attributes directly to a dataset obj**/
 #define PRINTER_CONFIGURE_DATA_SET_ATTRIBS(DataSet, Attributes) \
 if(NULL != DataSet && NULL != Attributes) { \
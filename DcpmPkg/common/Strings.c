@@ -367,7 +367,8 @@ nlog_format(
       }
     }
 
-    current_value = *values[current_value_index];
+    //a malformed format can have more specifiers than values
+    current_value = (current_value_index < values_length) ? *values[current_value_index] : 0;
     current_value_index++;
     if (*format_head == 'X')
     {
@@ -469,7 +470,6 @@ CHAR8* u32_to_a(
   while (val > 0)
   {
     current_val = (val % base);
-    len++;
     if (current_val <= 9)
     {
       *int_str_ptr = (CHAR8)(current_val + (UINT32)'0');
@@ -491,7 +491,8 @@ CHAR8* u32_to_a(
   }
 
   int_str_ptr++;
-  len--;
+  // only the digits written, the buffer ends right after them
+  len = len - (UINT64)(int_str_ptr - int_str);
   retval = get_empty_string(len);
   MyMemCopy(retval, len, int_str_ptr);
   FREE_POOL_SAFE(int_str);
@@ -14,6 +14,7 @@
 #include <Guid/MdeModuleHii.h>
 #include <Guid/FileInfo.h>
 #include "Utility.h"
+#include "Checksum.h"
 #include <Guid/FileInfo.h>
 #include <Protocol/DriverHealth.h>
 #include <Library/DevicePathLib.h>
@@ -269,10 +270,9 @@ ChecksumOperations(
   IN     BOOLEAN Insert
   )
 {
-  UINT32 *p32 = pAddress;
-  UINT32 *p32End = (UINT32 *)((UINT8 *)pAddress + Length);
-  UINT32 Lo32 = 0;
-  UINT32 Hi32 = 0;
+  FLETCHER64_CONTEXT Context;
+  UINT64 ChecksumOffset = 0;
+  UINT64 Zero = 0;
   UINT64 Checksum = 0;
   BOOLEAN ChecksumMatch = FALSE;
 
@@ -291,22 +291,19 @@ ChecksumOperations(
     return FALSE;
   }
 
-  while (p32 < p32End) {
-    if (p32 == (UINT32 *) pChecksum) {
-     /* Lo32 += 0; treat first 32-bits as zero */
-      p32++;
-      Hi32 += Lo32;
-      /* Lo32 += 0; treat second 32-bits as zero */
-      p32++;
-      Hi32 += Lo32;
-    } else {
-      Lo32 += *p32;
-      ++p32;
-      Hi32 += Lo32;
+  Fletcher64Init(&Context);
+  if ((UINT8 *) pChecksum >= (UINT8 *) pAddress && (UINT8 *) pChecksum < (UINT8 *) pAddress + Length) {
+    // The checksum field counts as two zero words, even when it sticks out of the area
+    ChecksumOffset = (UINT8 *) pChecksum - (UINT8 *) pAddress;
+    Fletcher64Update(&Context, pAddress, ChecksumOffset);
+    Fletcher64Update(&Context, &Zero, sizeof(Zero));
+    if (ChecksumOffset + sizeof(Zero) < Length) {
+      Fletcher64Update(&Context, (UINT8 *) pChecksum + sizeof(Zero), Length - ChecksumOffset - sizeof(Zero));
     }
+  } else {
+    Fletcher64Update(&Context, pAddress, Length);
   }
-
-  Checksum = (UINT64) Hi32 << 32 | Lo32;
+  Checksum = Fletcher64Final(&Context);
 
   if (Insert) {
     *pChecksum = Checksum;
@@ -3854,6 +3851,10 @@ PollLongOpStatus(
   IN     UINT64 Timeout
   )
 {
+#ifdef OS_BUILD
+  // Shares the libipmctl job engine, which polls from the waiting thread
+  return WaitForLongOp(DimmId, OpcodeToPoll, SubOpcodeToPoll, Timeout);
+#else
   UINT8 EventCount = 0;
   EFI_STATUS ReturnCode = EFI_DEVICE_ERROR;
   UINT64 WaitIndex = 0;
@@ -3920,6 +3921,7 @@ Finish:
   }
 
   return ReturnCode;
+#endif
 }
 
 EFI_STATUS
@@ -4476,6 +4478,7 @@ Finish:
 }
 #else
 #include <PbrDcpmm.h>
+#include <PbrOs.h>
 #ifdef _MSC_VER
 extern int registry_volatile_write(const char *key, unsigned int dword_val);
 extern int registry_read(const char *key, unsigned int *dword_val, unsigned int default_val);
@@ -4499,7 +4502,7 @@ EFI_STATUS PbrDcpmmSerializeTagId(
   UINT32 ShmId;
   key_t Key;
   UINT32 *pPbrId = NULL;
-  Key = ftok(PBR_TMP_DIR, 'i');
+  Key = ftok(PbrGetTmpDir(), 'i');
   ShmId = shmget(Key, sizeof(*pPbrId), IPC_CREAT | 0666);
   if (-1 == ShmId) {
     NVDIMM_DBG("Failed to shmget\n");
@@ -4543,7 +4546,7 @@ EFI_STATUS PbrDcpmmDeserializeTagId(
   UINT32 ShmId;
   key_t Key;
   UINT32 *pPbrId = NULL;
-  Key = ftok(PBR_TMP_DIR, 'i');
+  Key = ftok(PbrGetTmpDir(), 'i');
   ShmId = shmget(Key, sizeof(*pPbrId), IPC_CREAT | 0666);
   if (-1 == ShmId) {
     NVDIMM_DBG("Failed to shmget\n");
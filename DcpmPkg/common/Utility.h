@@ -1774,6 +1774,25 @@ PollLongOpStatus(
   IN     UINT64 Timeout
   );
 
+#ifdef OS_BUILD
+/**
+  Wait for a long operation through the libipmctl job engine, which
+  PollLongOpStatus defers to in the OS build.
+
+  @param [in] DimmId Dimm ID of the dimm to poll status
+  @param [in] OpcodeToPoll Specify an opcode to poll, 0 to poll regardless of opcode
+  @param [in] SubOpcodeToPoll Specify an opcode to poll
+  @param [in] Timeout for the background operation, 0 for none
+**/
+EFI_STATUS
+WaitForLongOp(
+  IN     UINT16 DimmId,
+  IN     UINT8 OpcodeToPoll OPTIONAL,
+  IN     UINT8 SubOpcodeToPoll OPTIONAL,
+  IN     UINT64 Timeout
+  );
+#endif
+
 EFI_STATUS
 GetNSLabelMajorMinorVersion(
   IN     UINT32 NamespaceLabelVersion,
@@ -4,14 +4,71 @@
  */
 
 #include <Library/BaseMemoryLib.h>
+#include <Library/BaseLib.h>
 #include <Debug.h>
 #include <NvmTypes.h>
 #include "Btt.h"
 #include "BttLayout.h"
 #include "Namespace.h"
 #include <Convert.h>
+#ifdef OS_BUILD
+#include <os.h>
+#endif
+
+#define BTT_LANE_WAIT_MS  100   //!< Longest wait for a lane before checking for a free one again
+
 GUID gBttAbstractionGuid = EFI_BTT_ABSTRACTION_GUID;
 
+/**
+    Reads bytes from the media under the btt
+
+    @retval EFI_SUCCESS if the routine succeeds
+
+    @param [in] pBtt namespace handle
+    @param [in] Offset Offset into the media
+    @param [out] pBuffer Read result Buffer pointer
+    @param [in] Length Number of bytes to be read
+**/
+STATIC
+EFI_STATUS
+BttReadBytes(
+  IN     BTT *pBtt,
+  IN     UINT64 Offset,
+     OUT VOID *pBuffer,
+  IN     UINT64 Length
+  )
+{
+  if (pBtt->pIo != NULL) {
+    return pBtt->pIo->pRead(pBtt->pNamespace, Offset, pBuffer, Length);
+  }
+  return ReadNamespaceBytes(pBtt->pNamespace, Offset, pBuffer, Length);
+}
+
+/**
+    Writes bytes to the media under the btt
+
+    @retval EFI_SUCCESS if the routine succeeds
+
+    @param [in] pBtt namespace handle
+    @param [in] Offset Offset into the media
+    @param [in] pBuffer Buffer pointer to the bytes to be written
+    @param [in] Length Number of bytes to be written
+**/
+STATIC
+EFI_STATUS
+BttWriteBytes(
+  IN     BTT *pBtt,
+  IN     UINT64 Offset,
+  IN     VOID *pBuffer,
+  IN     UINT64 Length
+  )
+{
+  if (pBtt->pIo != NULL) {
+    return pBtt->pIo->pWrite(pBtt->pNamespace, Offset, pBuffer, Length);
+  }
+  return WriteNamespaceBytes(pBtt->pNamespace, Offset, pBuffer, Length);
+}
+
 /**
     Loads up a single flog pair
 
@@ -64,6 +121,7 @@ BttReadFlogs(
 
     @param [in] pBtt namespace handle
     @param [in,out] pArena Pointer to the Arena from which the Flog Pair is to be read
+    @param [in] Lane Lane of the write, index of the Flog Pair to be updated
     @param [in] Lba Logical block address to be written
     @param [in] OldMap Previous map entry to be written
     @param [in] NewMap New map entry to be written
@@ -73,6 +131,7 @@ EFI_STATUS
 BttFlogUpdate(
   IN     BTT *pBtt,
   IN     ARENAS *pArena,
+  IN     UINT32 Lane,
   IN     UINT32 Lba,
   IN     UINT32 OldMap,
   IN     UINT32 NewMap
@@ -228,6 +287,151 @@ IsLbaValid(
   IN   UINT64 Lba
   );
 
+/**
+    Allocates the lanes of a btt and, in the OS build, the locks shared by
+    the lanes
+
+    @retval EFI_SUCCESS if the routine succeeds
+    @retval EFI_OUT_OF_RESOURCES if an allocation failed
+
+    @param [in,out] pBtt namespace handle
+**/
+STATIC
+EFI_STATUS
+BttInitLanes(
+  IN OUT BTT *pBtt
+  )
+{
+  EFI_STATUS ReturnCode = EFI_OUT_OF_RESOURCES;
+  UINT32 Lane = 0;
+
+  pBtt->NLanes = pBtt->NFree;
+  pBtt->pFreeLanes = AllocateZeroPool(pBtt->NLanes * sizeof(UINT32));
+  if (pBtt->pFreeLanes == NULL) {
+    goto Finish;
+  }
+  /* lowest lanes on top of the stack, so few I/Os keep reusing the same lanes */
+  for (Lane = 0; Lane < pBtt->NLanes; Lane++) {
+    pBtt->pFreeLanes[Lane] = pBtt->NLanes - 1 - Lane;
+  }
+  pBtt->FreeLanesNum = pBtt->NLanes;
+
+#ifdef OS_BUILD
+  pBtt->pLaneLock = os_mutex_init(NULL);
+  pBtt->pLaneNotifier = os_notifier_create();
+  pBtt->ppMapLocks = AllocateZeroPool(pBtt->NLanes * sizeof(VOID *));
+  if (pBtt->pLaneLock == NULL || pBtt->pLaneNotifier == NULL || pBtt->ppMapLocks == NULL) {
+    goto Finish;
+  }
+  for (Lane = 0; Lane < pBtt->NLanes; Lane++) {
+    pBtt->ppMapLocks[Lane] = os_mutex_init(NULL);
+    if (pBtt->ppMapLocks[Lane] == NULL) {
+      goto Finish;
+    }
+  }
+#endif // OS_BUILD
+
+  ReturnCode = EFI_SUCCESS;
+Finish:
+  return ReturnCode;
+}
+
+/**
+    Frees what BttInitLanes() allocated
+
+    @param [in,out] pBtt namespace handle
+**/
+STATIC
+VOID
+BttFreeLanes(
+  IN OUT BTT *pBtt
+  )
+{
+#ifdef OS_BUILD
+  UINT32 Lane = 0;
+
+  if (pBtt->ppMapLocks != NULL) {
+    for (Lane = 0; Lane < pBtt->NLanes; Lane++) {
+      if (pBtt->ppMapLocks[Lane] != NULL) {
+        os_mutex_delete(pBtt->ppMapLocks[Lane], NULL);
+      }
+    }
+    FreePool(pBtt->ppMapLocks);
+    pBtt->ppMapLocks = NULL;
+  }
+  if (pBtt->pLaneNotifier != NULL) {
+    os_notifier_delete(pBtt->pLaneNotifier);
+    pBtt->pLaneNotifier = NULL;
+  }
+  if (pBtt->pLaneLock != NULL) {
+    os_mutex_delete(pBtt->pLaneLock, NULL);
+    pBtt->pLaneLock = NULL;
+  }
+#endif // OS_BUILD
+  FREE_POOL_SAFE(pBtt->pFreeLanes);
+}
+
+/**
+    Takes a free lane for an I/O, waiting for one if all are in use
+
+    @param [in,out] pBtt namespace handle
+
+    @retval Lane the I/O owns until BttReleaseLane()
+**/
+STATIC
+UINT32
+BttAcquireLane(
+  IN OUT BTT *pBtt
+  )
+{
+  UINT32 Lane = 0;
+#ifdef OS_BUILD
+  UINT64 SeenSeq = 0;
+
+  os_mutex_lock(pBtt->pLaneLock);
+  while (pBtt->FreeLanesNum == 0) {
+    SeenSeq = os_notifier_seq(pBtt->pLaneNotifier);
+    os_mutex_unlock(pBtt->pLaneLock);
+    os_notifier_wait(pBtt->pLaneNotifier, SeenSeq, BTT_LANE_WAIT_MS);
+    os_mutex_lock(pBtt->pLaneLock);
+  }
+  Lane = pBtt->pFreeLanes[--pBtt->FreeLanesNum];
+  os_mutex_unlock(pBtt->pLaneLock);
+#else
+  /* block I/O is not reentered in UEFI, the first lane is always free */
+  Lane = pBtt->pFreeLanes[--pBtt->FreeLanesNum];
+#endif // OS_BUILD
+  return Lane;
+}
+
+/**
+    Returns a lane taken with BttAcquireLane()
+
+    @param [in,out] pBtt namespace handle
+    @param [in] Lane Lane to be released
+**/
+STATIC
+VOID
+BttReleaseLane(
+  IN OUT BTT *pBtt,
+  IN     UINT32 Lane
+  )
+{
+#ifdef OS_BUILD
+  BOOLEAN Waiters = FALSE;
+
+  os_mutex_lock(pBtt->pLaneLock);
+  Waiters = (pBtt->FreeLanesNum == 0);
+  pBtt->pFreeLanes[pBtt->FreeLanesNum++] = Lane;
+  os_mutex_unlock(pBtt->pLaneLock);
+  if (Waiters) {
+    os_notifier_signal(pBtt->pLaneNotifier);
+  }
+#else
+  pBtt->pFreeLanes[pBtt->FreeLanesNum++] = Lane;
+#endif // OS_BUILD
+}
+
 BTT *
 BttInit(
   IN     UINT64 RawSize,
@@ -237,6 +441,32 @@ BttInit(
   )
 {
   BTT *pBtt = NULL;
+  UINT64 PrimaryInfoOffset = BTT_PRIMARY_INFO_BLOCK_OFFSET;
+
+  if ((((NAMESPACE *) pNamespace)->Major == NSINDEX_MAJOR) &&
+      (((NAMESPACE *) pNamespace)->Minor == NSINDEX_MINOR_1)) {
+    PrimaryInfoOffset = BTT_PRIMARY_INFO_BLOCK_OFFSET_1_1;
+  }
+
+  pBtt = BttOpen(RawSize, LbaSize, pParentUuid, PrimaryInfoOffset, pNamespace, NULL);
+  if (pBtt != NULL) {
+    // Set blockcount to usable size, excluding metadata
+    ((NAMESPACE *) pNamespace)->UsableSize = pBtt->NLbas * pBtt->LbaSize;
+  }
+  return pBtt;
+}
+
+BTT *
+BttOpen(
+  IN     UINT64 RawSize,
+  IN     UINT32 LbaSize,
+  IN     GUID *pParentUuid,
+  IN     UINT64 PrimaryInfoOffset,
+  IN     VOID *pNamespace,
+  IN     CONST BTT_IO_BACKEND *pIo OPTIONAL
+  )
+{
+  BTT *pBtt = NULL;
 
   NVDIMM_DBG("RawSize=%x LbaSize=%d", RawSize, LbaSize);
 
@@ -257,13 +487,8 @@ BttInit(
   pBtt->RawSize = RawSize;
   pBtt->LbaSize = LbaSize;
   pBtt->pNamespace = pNamespace;
-
-  if ((((NAMESPACE *) pNamespace)->Major == NSINDEX_MAJOR) &&
-      (((NAMESPACE *) pNamespace)->Minor == NSINDEX_MINOR_1)) {
-    pBtt->PrimaryInfoOffset = BTT_PRIMARY_INFO_BLOCK_OFFSET_1_1;
-  } else {
-    pBtt->PrimaryInfoOffset = BTT_PRIMARY_INFO_BLOCK_OFFSET;
-  }
+  pBtt->pIo = pIo;
+  pBtt->PrimaryInfoOffset = PrimaryInfoOffset;
 
   /**
     Load up layout, if it exists.
@@ -280,8 +505,12 @@ BttInit(
     BttRelease(pBtt);  /* free up any allocations */
     return NULL;
   }
-  // Set blockcount to usable size, excluding metadata
-  ((NAMESPACE *) pNamespace)->UsableSize = pBtt->NLbas * pBtt->LbaSize;
+
+  /* one lane per Flog entry, NFree is final once the layout is read */
+  if(EFI_ERROR(BttInitLanes(pBtt))) {
+    BttRelease(pBtt);
+    return NULL;
+  }
 
   NVDIMM_DBG("Success, pBtt=%p", pBtt);
   return pBtt;
@@ -409,12 +638,7 @@ BttReadFlogPair(
     return EFI_INVALID_PARAMETER;
   }
 
-  ReturnCode = ReadNamespaceBytes(
-    pBtt->pNamespace,
-    FlogOffset,
-    pFlogPair,
-    sizeof(BTT_FLOG_PAIR)
-  );
+  ReturnCode = BttReadBytes(pBtt, FlogOffset, pFlogPair, sizeof(BTT_FLOG_PAIR));
 
   if(EFI_ERROR(ReturnCode)) {
     return ReturnCode;
@@ -497,12 +721,7 @@ BttReadFlogPair(
   MapEntryOffset = pArena->MapOffset + sizeof(BTT_MAP_ENTRIES) * BttGetMapFromLba(pFlogPair->Flog[CurrentFlogIndex].Lba);
 
   /* read current map Entry */
-  CHECK_RESULT(ReadNamespaceBytes(
-    pBtt->pNamespace,
-    MapEntryOffset,
-    &Entry,
-    sizeof(BTT_MAP_ENTRIES)
-  ), Finish);
+  CHECK_RESULT(BttReadBytes(pBtt, MapEntryOffset, &Entry, sizeof(BTT_MAP_ENTRIES)), Finish);
 
   CurrentMapPos = BttGetPositionInMapFromLba(pFlogPair->Flog[CurrentFlogIndex].Lba);
   CurrentMap = Entry.MapEntryLba [CurrentMapPos];
@@ -522,12 +741,7 @@ BttReadFlogPair(
       updating the map Entry.
     */
     Entry.MapEntryLba [CurrentMapPos] = pFlogPair->Flog[CurrentFlogIndex].NewMap;
-    EFI_STATUS WriteResult = WriteNamespaceBytes(
-      pBtt->pNamespace,
-      MapEntryOffset,
-      &Entry,
-      sizeof(BTT_MAP_ENTRIES)
-    );
+    EFI_STATUS WriteResult = BttWriteBytes(pBtt, MapEntryOffset, &Entry, sizeof(BTT_MAP_ENTRIES));
 
     if(EFI_ERROR(WriteResult)) {
       return WriteResult;
@@ -557,6 +771,7 @@ EFI_STATUS
 BttFlogUpdate(
   IN     BTT *pBtt,
   IN     ARENAS *pArena,
+  IN     UINT32 Lane,
   IN     UINT32 Lba,
   IN     UINT32 OldMap,
   IN     UINT32 NewMap
@@ -571,20 +786,20 @@ BttFlogUpdate(
   NVDIMM_DBG("pBttp=%p pArena=%p ", pBtt, pArena);
   NVDIMM_DBG("LBA=%x OldMap=%d NewMap=%d", Lba, OldMap, NewMap);
 
-  if(!pBtt || !pArena) {
+  if(!pBtt || !pArena || Lane >= pBtt->NLanes) {
     return EFI_INVALID_PARAMETER;
   }
 
-  pFlogPair = &(pArena->pFlogs[FLOG_PAIR_0].FlogPair);
-  pNextFlog = &(pFlogPair->Flog[pArena->pFlogs[FLOG_PAIR_0].Next]);
-  if (FLOG_0 == pArena->pFlogs[FLOG_PAIR_0].Next) {
+  pFlogPair = &(pArena->pFlogs[Lane].FlogPair);
+  pNextFlog = &(pFlogPair->Flog[pArena->pFlogs[Lane].Next]);
+  if (FLOG_0 == pArena->pFlogs[Lane].Next) {
     pCurrentFlog = &(pFlogPair->Flog[FLOG_1]);
   }
-  else if (FLOG_1 == pArena->pFlogs[FLOG_PAIR_0].Next) {
+  else if (FLOG_1 == pArena->pFlogs[Lane].Next) {
     pCurrentFlog = &(pFlogPair->Flog[FLOG_0]);
   }
   else {
-    NVDIMM_ERR("ERROR: Invalid FLOG[0].Next index value:%d\n", pArena->pFlogs[0].Next);
+    NVDIMM_ERR("ERROR: Invalid FLOG[%d].Next index value:%d\n", Lane, pArena->pFlogs[Lane].Next);
     return EFI_BAD_BUFFER_SIZE;
   }
 
@@ -598,22 +813,20 @@ BttFlogUpdate(
 
   // Write out the pNextFlog entry to the dimm
 
-  NextFlogOffset = pArena->pFlogs[0].Entry + pArena->pFlogs[0].Next*sizeof(BTT_FLOG);
+  NextFlogOffset = pArena->pFlogs[Lane].Entry + pArena->pFlogs[Lane].Next*sizeof(BTT_FLOG);
 
   // write out first two fields first
-  CHECK_RESULT(WriteNamespaceBytes(pBtt->pNamespace,
-      NextFlogOffset, pNextFlog, sizeof(UINT32) * 2), Finish);
+  CHECK_RESULT(BttWriteBytes(pBtt, NextFlogOffset, pNextFlog, sizeof(UINT32) * 2), Finish);
 
   NextFlogOffset += sizeof(UINT32) * 2;
 
   // write out new_map and seq field to make it active
-  CHECK_RESULT(WriteNamespaceBytes(pBtt->pNamespace,
-    NextFlogOffset, &(pNextFlog->NewMap), sizeof(UINT32) * 2), Finish);
+  CHECK_RESULT(BttWriteBytes(pBtt, NextFlogOffset, &(pNextFlog->NewMap), sizeof(UINT32) * 2), Finish);
 
   // Flog Entry written successfully, update run-time state
-  pArena->pFlogs[0].Next = 1 - pArena->pFlogs[0].Next;
+  pArena->pFlogs[Lane].Next = 1 - pArena->pFlogs[Lane].Next;
 
-  NVDIMM_VERB("update Flog[0]: Lba=%d old=%d%s%s new %d%s%s", Lba,
+  NVDIMM_VERB("update Flog[%d]: Lba=%d old=%d%s%s new %d%s%s", Lane, Lba,
     OldMap & BTT_MAP_ENTRY_LBA_MASK,(OldMap & BTT_MAP_ENTRY_ERROR) ? " ERROR" : "",
      (OldMap & BTT_MAP_ENTRY_ZERO) ? " ZERO" : "", NewMap & BTT_MAP_ENTRY_LBA_MASK,
      (NewMap & BTT_MAP_ENTRY_ERROR) ? " ERROR" : "",(NewMap & BTT_MAP_ENTRY_ZERO) ? " ZERO" : "");
@@ -723,7 +936,7 @@ BttReadArena(
 
   NVDIMM_DBG("ArenaOffset=%lx", ArenaOffset);
 
-  CHECK_RESULT(ReadNamespaceBytes(pBtt->pNamespace, ArenaOffset, pBttInfo, sizeof(BTT_INFO)), Finish);
+  CHECK_RESULT(BttReadBytes(pBtt, ArenaOffset, pBttInfo, sizeof(BTT_INFO)), Finish);
 
   pArena->Flags = pBttInfo->Flags;
   pArena->ExternalNLbas = pBttInfo->ExternalNLbas;
@@ -977,9 +1190,7 @@ BttWriteLayout(
     MapEntryOffset = ArenaOffset + MapOffset;
     // Write map layout in 4k blocks
     for(MapBlock = 0; MapBlock <= MapSize / BTT_ALIGNMENT; MapBlock++) {
-      ReturnCode = WriteNamespaceBytes
-         (pBtt->pNamespace,
-        MapEntryOffset + (MapBlock * BTT_ALIGNMENT), pMap, BTT_ALIGNMENT);
+      ReturnCode = BttWriteBytes(pBtt, MapEntryOffset + (MapBlock * BTT_ALIGNMENT), pMap, BTT_ALIGNMENT);
       if (EFI_ERROR(ReturnCode)) {
         goto Finish;
       }
@@ -1000,9 +1211,7 @@ BttWriteLayout(
       */
       NVDIMM_VERB("Flog[%d] Entry off=%x initial %d + zero = %d",
         Index, FlogEntryOffset, NextFreeLba, NextFreeLba);
-      ReturnCode = WriteNamespaceBytes
-         (pBtt->pNamespace,
-        FlogEntryOffset, &FlogPair, sizeof(BTT_FLOG_PAIR));
+      ReturnCode = BttWriteBytes(pBtt, FlogEntryOffset, &FlogPair, sizeof(BTT_FLOG_PAIR));
       if (EFI_ERROR(ReturnCode)) {
         goto Finish;
       }
@@ -1048,12 +1257,12 @@ BttWriteLayout(
 
     ChecksumOperations((VOID *)pBttInfo, sizeof(BTT_INFO), &pBttInfo->Checksum, TRUE);
 
-    ReturnCode = WriteNamespaceBytes(pBtt->pNamespace, ArenaOffset, pBttInfo, sizeof(BTT_INFO));
+    ReturnCode = BttWriteBytes(pBtt, ArenaOffset, pBttInfo, sizeof(BTT_INFO));
     if (EFI_ERROR(ReturnCode)) {
       goto Finish;
     }
 
-    ReturnCode = WriteNamespaceBytes(pBtt->pNamespace, ArenaOffset + InfoOffset, pBttInfo, sizeof(BTT_INFO));
+    ReturnCode = BttWriteBytes(pBtt, ArenaOffset + InfoOffset, pBttInfo, sizeof(BTT_INFO));
     if (EFI_ERROR(ReturnCode)) {
       goto Finish;
     }
@@ -1119,8 +1328,7 @@ BttReadLayout(
 
     NVDIMM_DBG("ArenaOffset: %llx", ArenaOffset);
 
-    ReturnCode = ReadNamespaceBytes
-       (pBtt->pNamespace, ArenaOffset, pBttInfo, sizeof(BTT_INFO));
+    ReturnCode = BttReadBytes(pBtt, ArenaOffset, pBttInfo, sizeof(BTT_INFO));
     if(EFI_ERROR(ReturnCode)) {
       goto Finish;
     }
@@ -1295,6 +1503,7 @@ BttRead(
   UINT32 LatestMap = 0;
   UINT64 DataBlockOffset = 0;
   UINT32 LbaOut = 0;
+  UINT32 Lane = 0;
   EFI_STATUS RetVal = EFI_SUCCESS;
 
   SetMem(&Entry, sizeof(Entry), 0x0);
@@ -1329,13 +1538,23 @@ BttRead(
     block read.
   */
 
-  Result = ReadNamespaceBytes
-     (pBtt->pNamespace, MapEntryOffset, &Entry, sizeof(BTT_MAP_ENTRIES));
+  Result = BttReadBytes(pBtt, MapEntryOffset, &Entry, sizeof(BTT_MAP_ENTRIES));
   if(EFI_ERROR(Result)) {
     return Result;
   }
   PosInPreMapLba = BttGetPositionInMapFromLba(PreMapLba);
   CurrentMap = Entry.MapEntryLba[PosInPreMapLba];
+  /*
+    A map entry in the initial state maps the pre-map LBA, track it like
+    the writes see it so the Rtt protects that block too
+  */
+  if (MapEntryIsInitial(CurrentMap)) {
+    CurrentMap = PreMapLba | BTT_MAP_ENTRY_NORMAL;
+  }
+
+  /* the read tracking slot of the lane is this read's only */
+  Lane = BttAcquireLane(pBtt);
+
   /*
     Retries come back to the top of this loop(for a rare case where
     the map is changed by another thread doing writes to the same LBA).
@@ -1343,11 +1562,13 @@ BttRead(
   while(MapCheck == 0) {
     if(MapEntryIsError(CurrentMap)) {
       NVDIMM_DBG("EIO due to map Entry Error flag");
-      return EFI_ABORTED;
+      RetVal = EFI_ABORTED;
+      goto Finish;
     }
 
     if(MapEntryIsZero(CurrentMap)) {
-      return BttZeroBlock(pBtt, pBuffer);
+      RetVal = BttZeroBlock(pBtt, pBuffer);
+      goto Finish;
     }
 
     /*
@@ -1358,7 +1579,9 @@ BttRead(
        No need to mask off ERROR and ZERO bits since the above
        checks make sure they are clear at this point.
     */
-    pArena->pRtt[0] = CurrentMap;
+    pArena->pRtt[Lane] = CurrentMap;
+    /* the Rtt entry must be visible before the map is checked again */
+    MemoryFence();
 
     /*
        In case this thread was preempted between reading Entry and
@@ -1368,14 +1591,15 @@ BttRead(
        undisturbed) and potentially allocated and being used for
        another write(data disturbed, so not okay to continue).
     */
-    Result = ReadNamespaceBytes
-       (pBtt->pNamespace,
-      MapEntryOffset, &LatestEntry, sizeof(BTT_MAP_ENTRIES));
+    Result = BttReadBytes(pBtt, MapEntryOffset, &LatestEntry, sizeof(BTT_MAP_ENTRIES));
     if(EFI_ERROR(Result)) {
-      pArena->pRtt[0] = BTT_MAP_ENTRY_ERROR;
-      return Result;
+      RetVal = Result;
+      goto Finish;
     }
     LatestMap = LatestEntry.MapEntryLba [PosInPreMapLba];
+    if (MapEntryIsInitial(LatestMap)) {
+      LatestMap = PreMapLba | BTT_MAP_ENTRY_NORMAL;
+    }
     if(CurrentMap == LatestMap) {
       MapCheck++;          /* map stayed the same */
     }
@@ -1390,26 +1614,18 @@ BttRead(
 
      Convert the offset in bytes to block offset
   */
-
-  // If map entry is in the initial state (post map lba should be zero as well),
-  // use the pre map lba
-  if (MapEntryIsInitial(CurrentMap)) {
-    // Ignore whatever is in current map variable and set to pre map lba
-    LbaOut = PreMapLba;
-  } else {
-    LbaOut = CurrentMap & BTT_MAP_ENTRY_LBA_MASK;
-  }
+  LbaOut = CurrentMap & BTT_MAP_ENTRY_LBA_MASK;
 
   DataBlockOffset = pArena->DataOffset + (UINT64)(LbaOut) * pArena->InternalLbaSize;
   NVDIMM_DBG("LBA=%x->LBAbtt=%x, Offset[B]=%lx",
       Lba, (UINT64) LbaOut, DataBlockOffset);
 
-  RetVal = ReadNamespaceBytes
-     (pBtt->pNamespace, DataBlockOffset, pBuffer, pBtt->LbaSize);
+  RetVal = BttReadBytes(pBtt, DataBlockOffset, pBuffer, pBtt->LbaSize);
 
+Finish:
   /* done with read, so clear out Rtt Entry */
-  pArena->pRtt[0] = BTT_MAP_ENTRY_ERROR;
-
+  pArena->pRtt[Lane] = BTT_MAP_ENTRY_ERROR;
+  BttReleaseLane(pBtt, Lane);
   return RetVal;
 }
 
@@ -1436,7 +1652,7 @@ BttCheck(
 
   // for each arena
   pArena = pBtt->Arenas;
-  for(Index = 0; Index < pBtt->NArenas; Index++) {
+  for(Index = 0; Index < pBtt->NArenas; Index++, pArena++) {
     // Perform the consistency checks for the arena.
     retVal = BttCheckArena(pBtt, pArena);
     if(EFI_ERROR(retVal)) {
@@ -1500,12 +1716,11 @@ BttCheckArena(
   MapSize = ROUNDUP(pArena->ExternalNLbas * BTT_MAP_ENTRY_SIZE, BTT_ALIGNMENT);
   // Read entire map layout in 4k blocks
   for(MapBlock = 0; MapBlock <= MapSize / BTT_ALIGNMENT; MapBlock++) {
-    ReturnCode = ReadNamespaceBytes
-       (pBtt->pNamespace, pArena->MapOffset +(MapBlock * BTT_ALIGNMENT), pMap, BTT_ALIGNMENT);
+    ReturnCode = BttReadBytes(pBtt, pArena->MapOffset +(MapBlock * BTT_ALIGNMENT), pMap, BTT_ALIGNMENT);
     if(EFI_ERROR(ReturnCode)) {
       goto Finish;
     }
-    if(MapsCount > MapBlock * BTT_ALIGNMENT / sizeof(BTT_MAP_ENTRIES)) { //protect overturn
+    if(MapsCount >= MapBlock * BTT_ALIGNMENT / sizeof(BTT_MAP_ENTRIES)) { //protect overturn
       RemainingMaps = MapsCount - MapBlock * BTT_ALIGNMENT / sizeof(BTT_MAP_ENTRIES);
     }
     else {
@@ -1535,8 +1750,8 @@ BttCheckArena(
           MapEntry &= BTT_MAP_ENTRY_LBA_MASK;
         }
 
-        /* check if entry is valid */
-        if(MapEntry >= pArena->ExternalNLbas) {
+        /* check if entry is valid, written entries map any internal block */
+        if(MapEntry >= pArena->InternalNLbas) {
           NVDIMM_DBG("map[%d] Entry out of bounds: %d", Index, MapEntry);
           goto Finish;
         }
@@ -1591,6 +1806,31 @@ Finish:
   return ReturnCode;
 }
 
+/**
+    Returns the lock of the map cache line holding the entry of a pre-map LBA
+
+    BttMapLock[] contains NLanes locks which are used to protect the map
+    from concurrent access to the same cache line. The index into
+    BttMapLock[] is calculated by looking at the byte offset into the map
+     (PreMapLba * BTT_MAP_ENTRY_SIZE), figuring out how many cache lines
+    that is into the map that is(dividing by BTT_MAP_LOCK_ALIGN), and
+    then selecting one of NLanes locks(the modulo at the end).
+
+    @param [in] pBtt namespace handle
+    @param [in] MapNumber Map cache line of the pre-map LBA
+
+    @retval Lock number
+**/
+STATIC
+UINT32
+BttMapLockNumber(
+  IN     BTT *pBtt,
+  IN     UINT32 MapNumber
+  )
+{
+  return MapNumber % pBtt->NLanes;
+}
+
 STATIC
 EFI_STATUS
 BttMapLock(
@@ -1612,21 +1852,18 @@ BttMapLock(
   MapNumber = BttGetMapFromLba(PreMapLba);
   MapPosition = BttGetPositionInMapFromLba(PreMapLba);
   MapEntryOffset = pArena->MapOffset + sizeof(BTT_MAP_ENTRIES) * MapNumber;
+  BttMapLockNum = BttMapLockNumber(pBtt, MapNumber);
 
-  /*
-    BttMapLock[] contains NFree locks which are used to protect the map
-    from concurrent access to the same cache line. The index into
-    BttMapLock[] is calculated by looking at the byte offset into the map
-     (PreMapLba * BTT_MAP_ENTRY_SIZE), figuring out how many cache lines
-    that is into the map that is(dividing by BTT_MAP_LOCK_ALIGN), and
-    then selecting one of nfree locks(the modulo at the end).
-  */
-  BttMapLockNum = MapNumber % pBtt->NFree;
+#ifdef OS_BUILD
+  os_mutex_lock(pBtt->ppMapLocks[BttMapLockNum]);
+#endif
 
   /* read the old map Entry */
-  EFI_STATUS ReadResult = ReadNamespaceBytes
-     (pBtt->pNamespace, MapEntryOffset, Entry, sizeof(BTT_MAP_ENTRIES));
+  EFI_STATUS ReadResult = BttReadBytes(pBtt, MapEntryOffset, Entry, sizeof(BTT_MAP_ENTRIES));
   if(EFI_ERROR(ReadResult)) {
+#ifdef OS_BUILD
+    os_mutex_unlock(pBtt->ppMapLocks[BttMapLockNum]);
+#endif
     return ReadResult;
   }
 
@@ -1641,18 +1878,30 @@ BttMapLock(
   return EFI_SUCCESS;
 }
 
+/**
+    Writes the map entry read by BttMapLock(), when Entry is given, and
+    releases the lock of its cache line
+
+    @retval EFI_SUCCESS if the routine succeeds
+
+    @param [in] pBtt namespace handle
+    @param [in,out] pArena Pointer to the Arena of the map
+    @param [in] Entry Updated map cache line, NULL to release the lock only
+    @param [in] PreMapLba Pre-map LBA given to BttMapLock()
+**/
 STATIC
 EFI_STATUS
 BttMapUnlock(
   IN     BTT *pBtt,
   IN OUT ARENAS *pArena,
-  IN     BTT_MAP_ENTRIES *Entry,
+  IN     BTT_MAP_ENTRIES *Entry OPTIONAL,
   IN     UINT32 PreMapLba
   )
 {
   UINT32 MapNumber = 0;
   UINT64 MapEntryOffset = 0;
   UINT32 BttMapLockNum = 0;
+  EFI_STATUS RetVal = EFI_SUCCESS;
 
   NVDIMM_VERB("Bttp %p pArena %p Entry %p PreMapLba %u", pBtt, pArena, Entry, PreMapLba);
 
@@ -1662,16 +1911,18 @@ BttMapUnlock(
 
   MapNumber = BttGetMapFromLba(PreMapLba);
   MapEntryOffset = pArena->MapOffset + sizeof(BTT_MAP_ENTRIES) * MapNumber;
-  BttMapLockNum = MapNumber % pBtt->NFree;
+  BttMapLockNum = BttMapLockNumber(pBtt, MapNumber);
 
-  /* write the new map Entry */
-  EFI_STATUS RetVal = WriteNamespaceBytes
-     (pBtt->pNamespace,
-    MapEntryOffset, Entry, sizeof(BTT_MAP_ENTRIES));
+  if (Entry != NULL) {
+    /* write the new map Entry */
+    RetVal = BttWriteBytes(pBtt, MapEntryOffset, Entry, sizeof(BTT_MAP_ENTRIES));
+    NVDIMM_DBG("unlocked maps[%u], LBAs: %u - %u", BttMapLockNum, Entry->MapEntryLba [0] & BTT_MAP_ENTRY_LBA_MASK,
+      Entry->MapEntryLba [CACHE_LINE_SIZE / sizeof(UINT32) - 1] & BTT_MAP_ENTRY_LBA_MASK);
+  }
 
- //pArena->BttMapLock [BttMapLockNum].IndSpinlockRelease(pMapLockHandle);
- NVDIMM_DBG("unlocked maps[%u], LBAs: %u - %u", BttMapLockNum, Entry->MapEntryLba [0] & BTT_MAP_ENTRY_LBA_MASK,
-    Entry->MapEntryLba [CACHE_LINE_SIZE / sizeof(UINT32) - 1] & BTT_MAP_ENTRY_LBA_MASK);
+#ifdef OS_BUILD
+  os_mutex_unlock(pBtt->ppMapLocks[BttMapLockNum]);
+#endif
   return RetVal;
 }
 
@@ -1700,6 +1951,7 @@ BttWrite(
   BTT_MAP_ENTRIES MapEntry;
   UINT8 PosInEntry = 0;
   UINT32 OldMap = 0;
+  UINT32 Lane = 0;
 
   NVDIMM_VERB("pBtt=%p LBA=%x writing!", pBtt, Lba);
   SetMem(&MapEntry, sizeof(MapEntry), 0x0);
@@ -1715,7 +1967,16 @@ BttWrite(
 
   /* first write through here will initialize the metadata layout */
   if(!pBtt->Laidout) {
-    RetVal = BttWriteLayout(pBtt, TRUE);
+#ifdef OS_BUILD
+    /* only one of the first concurrent writes lays it out */
+    os_mutex_lock(pBtt->pLaneLock);
+#endif
+    if(!pBtt->Laidout) {
+      RetVal = BttWriteLayout(pBtt, TRUE);
+    }
+#ifdef OS_BUILD
+    os_mutex_unlock(pBtt->pLaneLock);
+#endif
 
     if(EFI_ERROR(RetVal)) {
       return RetVal;
@@ -1735,60 +1996,64 @@ BttWrite(
   }
 
   /*
-     This routine was passed a unique "Lane" which is an index
-     into the Flog.  That means the free block held by Flog[Lane]
-     is assigned to this thread and to no other threads(no additional
-     locking required).  So start by performing the write to the
-     free block.  It is only safe to write to a free block if it
-     doesn't appear in the read tracking table, so scan that first
-     and if found, wait for the thread reading from it to finish.
+     The lane is an index into the Flog.  That means the free block
+     held by Flog[Lane] is assigned to this thread and to no other
+     threads(no additional locking required).  So start by performing
+     the write to the free block.  It is only safe to write to a free
+     block if it doesn't appear in the read tracking table, so scan that
+     first and if found, wait for the thread reading from it to finish.
   */
-  CurrentFlogIndex = 1 - pArena->pFlogs[0].Next;
-  FreeMap = (pArena->pFlogs[0].FlogPair.Flog[CurrentFlogIndex].OldMap & BTT_MAP_ENTRY_LBA_MASK) | BTT_MAP_ENTRY_NORMAL;
+  Lane = BttAcquireLane(pBtt);
+  CurrentFlogIndex = 1 - pArena->pFlogs[Lane].Next;
+  FreeMap = (pArena->pFlogs[Lane].FlogPair.Flog[CurrentFlogIndex].OldMap & BTT_MAP_ENTRY_LBA_MASK) | BTT_MAP_ENTRY_NORMAL;
+
+  NVDIMM_VERB("Lane=%d FreeMap=%x(before mask %x)", Lane, FreeMap, pArena->pFlogs[Lane].FlogPair.Flog[CurrentFlogIndex].OldMap);
 
-  NVDIMM_VERB("FreeMap=%x(before mask %x)", FreeMap, pArena->pFlogs[0].FlogPair.Flog[CurrentFlogIndex].OldMap);
+  /* the map update freeing the block must be visible to the readers before the Rtt is scanned */
+  MemoryFence();
 
   /* wait for other threads to finish any reads on free block */
   for(Index = 0; Index < pBtt->NLanes; Index++) {
     while(pArena->pRtt[Index] == FreeMap) {
       ;
     }
-  } // to be deleted in UEFI
+  }
 
   // it is now safe to perform write to the free block
   DataBlockOffset = pArena->DataOffset + (UINT64)(FreeMap & BTT_MAP_ENTRY_LBA_MASK) * pArena->InternalLbaSize;
   NVDIMM_DBG("LBA=%x->LBAbtt=%x Offset[B]=%lx",
       Lba, (UINT64) FreeMap & BTT_MAP_ENTRY_LBA_MASK, DataBlockOffset);
-  RetVal = WriteNamespaceBytes
-     (pBtt->pNamespace,
-    DataBlockOffset, pBuffer, pBtt->LbaSize);
+  RetVal = BttWriteBytes(pBtt, DataBlockOffset, pBuffer, pBtt->LbaSize);
   if(EFI_ERROR(RetVal)) {
-    return RetVal;
+    goto Finish;
   }
 
   // Make the new block active atomically by updating the on-media Flog and then updating the map.
   RetVal = BttMapLock(pBtt, pArena, &MapEntry, PreMapLba);
   if(EFI_ERROR(RetVal)) {
-    return RetVal;
+    goto Finish;
   }
 
   /* update the Flog */
   PosInEntry = BttGetPositionInMapFromLba(PreMapLba);
   OldMap = MapEntry.MapEntryLba[PosInEntry];
-  RetVal = BttFlogUpdate(pBtt, pArena, PreMapLba, OldMap, FreeMap);
+  RetVal = BttFlogUpdate(pBtt, pArena, Lane, PreMapLba, OldMap, FreeMap);
   if(EFI_ERROR(RetVal)) {
     NVDIMM_DBG("Could not update the BTT Flog!\nBttp %p pArena %p PreMapLba %u", pBtt, pArena, PreMapLba);
-    return RetVal;
+    BttMapUnlock(pBtt, pArena, NULL, PreMapLba);
+    goto Finish;
   }
 
   MapEntry.MapEntryLba [PosInEntry] = FreeMap;
   RetVal = BttMapUnlock(pBtt, pArena, &MapEntry, PreMapLba);
   if(EFI_ERROR(RetVal)) {
     BttSetArenaError(pBtt, pArena);
-    return RetVal;
+    goto Finish;
   }
 
-  return EFI_SUCCESS;
+Finish:
+  BttReleaseLane(pBtt, Lane);
+  return RetVal;
 }
 
 EFI_STATUS
@@ -1823,8 +2088,7 @@ BttArenaSetFlag(
   ArenaOff = pArena->StartOffset;
 
   /* protect from simultaneous writes to the layout */
-  ReturnCode = ReadNamespaceBytes
-     (pBtt->pNamespace, ArenaOff, pBttInfo, sizeof(BTT_INFO));
+  ReturnCode = BttReadBytes(pBtt, ArenaOff, pBttInfo, sizeof(BTT_INFO));
   if (EFI_ERROR(ReturnCode)) {
     goto Finish;
   }
@@ -1835,14 +2099,12 @@ BttArenaSetFlag(
   /* update checksum */
   ChecksumOperations((VOID *)pBttInfo, sizeof(BTT_INFO), &pBttInfo->Checksum, TRUE);
 
-  ReturnCode = WriteNamespaceBytes
-     (pBtt->pNamespace, ArenaOff, pBttInfo, sizeof(BTT_INFO));
+  ReturnCode = BttWriteBytes(pBtt, ArenaOff, pBttInfo, sizeof(BTT_INFO));
   if(EFI_ERROR(ReturnCode)) {
     goto Finish;
   }
 
-  ReturnCode = WriteNamespaceBytes
-     (pBtt->pNamespace, ArenaOff + pBttInfo->InfoOffset, pBttInfo, sizeof(BTT_INFO));
+  ReturnCode = BttWriteBytes(pBtt, ArenaOff + pBttInfo->InfoOffset, pBttInfo, sizeof(BTT_INFO));
   if(EFI_ERROR(ReturnCode)) {
     goto Finish;
   }
@@ -1885,6 +2147,7 @@ BttRelease(
       }
       FreePool(pBtt->Arenas);
     }
+    BttFreeLanes(pBtt);
     FreePool(pBtt);
   }
 }
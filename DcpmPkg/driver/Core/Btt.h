@@ -14,8 +14,6 @@ extern GUID gBttAbstractionGuid;
 #define FLOG_0 0  //!< 0th Flog entry
 #define FLOG_1 1  //!< 1st Flog entry
 
-#define FLOG_PAIR_0 0  //!< 0th Flog pair
-
 #define EFI_BTT_ABSTRACTION_GUID \
   { 0x18633BFC, 0x1735, 0x4217, {0x8A, 0xC9, 0x17, 0x23, 0x92, 0x82, 0xD3, 0xF8} }
 
@@ -45,6 +43,34 @@ extern GUID gBttAbstractionGuid;
 **/
 #define BTT_GET_POSITION_IN_MAP_FROM_LBA(Lba) (Lba % (BTT_MAP_LOCK_ALIGN / BTT_MAP_ENTRY_SIZE))
 
+/**
+    Namespace I/O the BTT is layered on
+
+    @param [in] pNamespace Media handle given to BttOpen()
+    @param [in] Offset Byte offset into the media
+    @param [in,out] pBuffer Data read or to be written
+    @param [in] Length Number of bytes
+
+    @retval EFI_SUCCESS if the routine succeeds
+**/
+typedef
+EFI_STATUS
+(*BTT_NAMESPACE_IO)(
+  IN     VOID *pNamespace,
+  IN     UINT64 Offset,
+  IN OUT VOID *pBuffer,
+  IN     UINT64 Length
+  );
+
+/**
+    Read and write routines of the media under a BTT, ReadNamespaceBytes()
+    and WriteNamespaceBytes() for the namespaces of the driver
+**/
+typedef struct _BTT_IO_BACKEND {
+    BTT_NAMESPACE_IO pRead;     //!< Reads bytes from the media
+    BTT_NAMESPACE_IO pWrite;    //!< Writes bytes to the media
+} BTT_IO_BACKEND; //!< @see _BTT_IO_BACKEND
+
 /**
     Structure for keeping Flog Entries in runtime
 **/
@@ -114,10 +140,29 @@ typedef struct _BTT {
     BOOLEAN Laidout;
 
     /**
-      Number of concurrent threads allowed per btt
+      Number of concurrent threads allowed per btt. Every BttRead() and
+      BttWrite() runs on a lane of its own, which owns the Flog entry and
+      the read tracking slot of the same index in every arena, so I/Os on
+      different lanes only meet on the map locks.
     **/
     UINT32 NLanes;
 
+    /**
+      Lanes not used by any I/O, a stack of NLanes lane numbers. Only
+      concurrent in the OS build, where pLaneLock protects it and
+      pLaneNotifier wakes up the I/Os waiting for a lane.
+    **/
+    UINT32 *pFreeLanes;
+    UINT32 FreeLanesNum;
+    VOID *pLaneLock;
+    VOID *pLaneNotifier;
+
+    /**
+      NLanes locks serializing the updates of the map. A map cache line is
+      protected by the lock of index (map cache line number % NLanes).
+    **/
+    VOID **ppMapLocks;
+
     /**
       UUID of the BTT
     **/
@@ -145,6 +190,7 @@ typedef struct _BTT {
     ARENAS *Arenas;
     // This pointer is VOID instead of NAMESPACE to avoid includes looping
     VOID *pNamespace; // The pointer to the containing namespace for the IO operations
+    CONST BTT_IO_BACKEND *pIo;  // Namespace I/O, NULL for ReadNamespaceBytes()/WriteNamespaceBytes()
 } BTT;       //!< @see _BTT
 
 /**
@@ -204,6 +250,46 @@ BttInit(
   IN     VOID *pNamespace
   );
 
+/**
+    Prepare a btt on any media, returning an opaque handle
+
+    BttInit() for media other than the namespaces of the driver. The layout
+    is read, and if needed recovered, through pIo.
+
+    @retval PBtt namespace handle, NULL on error
+
+    @param [in] RawSize Size of the media
+    @param [in] LbaSize Size of a block in a created namespace
+    @param [in] pParentUuid UUID label of the namespace
+    @param [in] PrimaryInfoOffset Offset of the first arena info block
+    @param [in] pNamespace Media handle passed to the routines of pIo
+    @param [in] pIo Media I/O, NULL for ReadNamespaceBytes()/WriteNamespaceBytes()
+**/
+BTT *
+BttOpen(
+  IN     UINT64 RawSize,
+  IN     UINT32 LbaSize,
+  IN     GUID *pParentUuid,
+  IN     UINT64 PrimaryInfoOffset,
+  IN     VOID *pNamespace,
+  IN     CONST BTT_IO_BACKEND *pIo OPTIONAL
+  );
+
+/**
+    Performs the consistency checks of all arenas: every internal block is
+    either mapped by exactly one external LBA or held free by exactly one
+    Flog entry
+
+    @retval EFI_SUCCESS if the btt is consistent
+    @retval EFI_ABORTED if a block is referenced twice or not at all
+
+    @param [in] pBtt namespace handle
+**/
+EFI_STATUS
+BttCheck(
+  IN     BTT *pBtt
+  );
+
 /**
     Writes out the initial btt metadata layout
 
@@ -19,6 +19,7 @@
 #include <Convert.h>
 #include <NvmDimmDriver.h>
 #ifdef OS_BUILD
+#include <os.h>
 #include <os_types.h>
 #include <Common.h>
 #endif
@@ -34,6 +35,18 @@ int gPCDCacheEnabled = 1;
 #else
 int gPCDCacheEnabled = 0;
 #endif
+#ifdef OS_BUILD
+/**
+  Held around gPCDCacheEnabled and the PCD partitions cached by the DIMMs
+  while RunDimmJobs() runs jobs on more than one thread, NULL otherwise
+**/
+STATIC OS_MUTEX *gpPcdCacheLock = NULL;
+#define PCD_CACHE_LOCK()   os_mutex_lock(gpPcdCacheLock)
+#define PCD_CACHE_UNLOCK() os_mutex_unlock(gpPcdCacheLock)
+#else
+#define PCD_CACHE_LOCK()
+#define PCD_CACHE_UNLOCK()
+#endif
 extern NVMDIMMDRIVER_DATA *gNvmDimmData;
 CONST UINT64 gSupportedBlockSizes[SUPPORTED_BLOCK_SIZES_COUNT] = {
   512,  //  512 (default)
@@ -49,13 +62,6 @@ CONST UINT64 gSupportedBlockSizes[SUPPORTED_BLOCK_SIZES_COUNT] = {
 extern EFI_GUID gDcpmmProtocolGuid;
 #endif
 
-// All possible combinations of transport and mailbox size
-typedef enum _DIMM_PASSTHRU_METHOD {
-  DimmPassthruDdrtLargePayload = 0,
-  DimmPassthruDdrtSmallPayload = 1,
-  DimmPassthruSmbusSmallPayload = 2
-} DIMM_PASSTHRU_METHOD;
-
 #ifdef OS_BUILD
 /*
 * Function get the ini configuration only on the first call
@@ -108,6 +114,33 @@ BOOLEAN ConfigIsDdrtProtocolDisabled()
 
   return (BOOLEAN)ddrt_protocol_disabled;
 }
+
+/*
+* Function get the ini configuration only on the first call
+*
+* It returns the maximum number of DIMMs sent firmware commands in parallel, 1 meaning serial
+*/
+UINT32 ConfigGetDimmThreads()
+{
+  static BOOLEAN config_dimm_threads_initialized = FALSE;
+  static UINT8 dimm_threads = DIMM_PARALLEL_THREADS_DEFAULT;
+  EFI_STATUS efi_status;
+  EFI_GUID guid = { 0 };
+  UINTN size;
+  UINT8 value = 0;
+
+  if (config_dimm_threads_initialized)
+    return dimm_threads;
+
+  size = sizeof(value);
+  efi_status = GET_VARIABLE(INI_PREFERENCES_DIMM_PARALLEL_THREADS, guid, &size, &value);
+  if (EFI_SUCCESS == efi_status)
+    dimm_threads = (value == 0) ? 1 : value;
+
+  config_dimm_threads_initialized = TRUE;
+
+  return dimm_threads;
+}
 #endif // OS_BUILD
 
 /**
@@ -1162,6 +1195,7 @@ InitializeDimmFieldsFromAcpiTables(
     pDimm->ManufacturingLocation = pControlRegionTbl->ManufacturingLocation;
     pDimm->ManufacturingDate = pControlRegionTbl->ManufacturingDate;
     pDimm->SerialNumber = pControlRegionTbl->SerialNumber;
+    pDimm->UidCached = FALSE;
     // Not using the rest of the control region fields
   }
 }
@@ -1193,12 +1227,213 @@ PopulateSmbusFields(
   ReturnCode = EFI_SUCCESS;
   return ReturnCode;
 }
+#ifdef OS_BUILD
+/**
+  Work shared by the threads of RunDimmJobs()
+**/
+typedef struct _DIMM_JOB_POOL {
+  OS_MUTEX *pLock;
+  UINT32 JobsNum;
+  UINT32 NextJob;
+  DIMM_JOB_CALLBACK pCallback;
+  VOID *pCtx;
+} DIMM_JOB_POOL;
+
+/**
+  RunDimmJobs() thread. Takes jobs from the pool until there are none left.
+
+  @param[in] pArg: The DIMM_JOB_POOL to work on
+
+  @retval NULL
+**/
+STATIC
+VOID *
+DimmJobWorker(
+  IN     VOID *pArg
+  )
+{
+  DIMM_JOB_POOL *pPool = (DIMM_JOB_POOL *)pArg;
+  UINT32 JobIndex = 0;
+  BOOLEAN JobTaken = FALSE;
+
+  for (;;) {
+    JobTaken = FALSE;
+    os_mutex_lock(pPool->pLock);
+    if (pPool->NextJob < pPool->JobsNum) {
+      JobIndex = pPool->NextJob++;
+      JobTaken = TRUE;
+    }
+    os_mutex_unlock(pPool->pLock);
+
+    if (!JobTaken) {
+      break;
+    }
+    pPool->pCallback(JobIndex, pPool->pCtx);
+  }
+  return NULL;
+}
+
+/**
+  Run the jobs on up to ConfigGetDimmThreads() threads, the calling thread
+  being one of them.
+
+  @param[in] JobsNum: Number of jobs
+  @param[in] pCallback: Job body
+  @param[in] pCtx: Passed through to pCallback
+
+  @retval EFI_SUCCESS  All jobs ran
+  @retval EFI_UNSUPPORTED  Parallel execution not configured, nothing ran
+  @retval EFI_OUT_OF_RESOURCES  Thread resources unavailable, nothing ran
+**/
+STATIC
+EFI_STATUS
+RunDimmJobsParallel(
+  IN     UINT32 JobsNum,
+  IN     DIMM_JOB_CALLBACK pCallback,
+  IN     VOID *pCtx
+  )
+{
+  EFI_STATUS ReturnCode = EFI_UNSUPPORTED;
+  DIMM_JOB_POOL Pool;
+  UINT64 *pThreadIds = NULL;
+  UINT32 ThreadsNum = 0;
+  UINT32 Index = 0;
+
+  ZeroMem(&Pool, sizeof(Pool));
+
+  ThreadsNum = MIN(ConfigGetDimmThreads(), JobsNum);
+  if (ThreadsNum <= 1) {
+    goto Finish;
+  }
+
+  CHECK_RESULT_MALLOC(pThreadIds, AllocateZeroPool(sizeof(*pThreadIds) * (ThreadsNum - 1)), Finish);
+  Pool.pLock = os_mutex_init(NULL);
+  if (Pool.pLock == NULL) {
+    ReturnCode = EFI_OUT_OF_RESOURCES;
+    goto Finish;
+  }
+  gpPcdCacheLock = os_mutex_init(NULL);
+  if (gpPcdCacheLock == NULL) {
+    ReturnCode = EFI_OUT_OF_RESOURCES;
+    goto Finish;
+  }
+  // Playback/record sessions are shared by all threads
+  CHECK_RESULT(SetPassThruPbrLocking(TRUE), Finish);
+  // Settle the logger configuration rather than have every thread read it
+  DebugLoggerInit();
+
+  Pool.JobsNum = JobsNum;
+  Pool.pCallback = pCallback;
+  Pool.pCtx = pCtx;
+
+  NVDIMM_DBG("Running %d DCPMM jobs on %d threads", JobsNum, ThreadsNum);
+  for (Index = 0; Index < ThreadsNum - 1; Index++) {
+    os_create_thread((unsigned long long *)&pThreadIds[Index], DimmJobWorker, &Pool);
+  }
+  // Threads that failed to start simply leave more jobs to the others
+  DimmJobWorker(&Pool);
+  for (Index = 0; Index < ThreadsNum - 1; Index++) {
+    os_join_thread(pThreadIds[Index]);
+  }
+
+  SetPassThruPbrLocking(FALSE);
+  ReturnCode = EFI_SUCCESS;
+
+Finish:
+  if (gpPcdCacheLock != NULL) {
+    os_mutex_delete(gpPcdCacheLock, NULL);
+    gpPcdCacheLock = NULL;
+  }
+  if (Pool.pLock != NULL) {
+    os_mutex_delete(Pool.pLock, NULL);
+  }
+  FREE_POOL_SAFE(pThreadIds);
+  return ReturnCode;
+}
+#endif // OS_BUILD
+
+/**
+  Run one job per DIMM, in parallel when the OS build allows it
+  (see DIMM_PARALLEL_THREADS), serially otherwise.
+
+  Jobs must each work on a different DIMM so firmware commands to a single
+  DIMM stay serialized, and must not change state shared with other jobs
+  besides the PCD cache, the debug logger and the playback/record session,
+  which are locked while the jobs run in parallel. Jobs may run in any
+  order; collect the results in per-job slots.
+
+  @param[in] JobsNum: Number of jobs
+  @param[in] pCallback: Job body, called once for each index below JobsNum
+  @param[in] pCtx: Passed through to pCallback
+**/
+VOID
+RunDimmJobs(
+  IN     UINT32 JobsNum,
+  IN     DIMM_JOB_CALLBACK pCallback,
+  IN     VOID *pCtx
+  )
+{
+  UINT32 JobIndex = 0;
+
+  if (pCallback == NULL) {
+    return;
+  }
+
+#ifdef OS_BUILD
+  if (!EFI_ERROR(RunDimmJobsParallel(JobsNum, pCallback, pCtx))) {
+    return;
+  }
+#endif // OS_BUILD
+
+  for (JobIndex = 0; JobIndex < JobsNum; JobIndex++) {
+    pCallback(JobIndex, pCtx);
+  }
+}
+
+/**
+  Per-DIMM work item of the DIMM inventory initialization
+**/
+typedef struct _DIMM_INIT_JOB {
+  DIMM *pDimm;
+  UINT16 Pid;
+  EFI_STATUS ReturnCode;
+} DIMM_INIT_JOB;
+
+/**
+  Work shared by the DIMM inventory initialization jobs
+**/
+typedef struct _DIMM_INIT_CTX {
+  DIMM_INIT_JOB *pJobs;
+  ParsedFitHeader *pFitHead;
+  ParsedPmttHeader *pPmttHead;
+} DIMM_INIT_CTX;
+
+/**
+  RunDimmJobs() callback initializing one DIMM of the inventory
+
+  @param[in] JobIndex: Index of the DIMM_INIT_JOB to run
+  @param[in] pCtx: The DIMM_INIT_CTX
+**/
+STATIC
+VOID
+InitializeDimmJob(
+  IN     UINT32 JobIndex,
+  IN     VOID *pCtx
+  )
+{
+  DIMM_INIT_CTX *pInitCtx = (DIMM_INIT_CTX *)pCtx;
+  DIMM_INIT_JOB *pJob = &pInitCtx->pJobs[JobIndex];
+
+  pJob->ReturnCode = InitializeDimm(pJob->pDimm, pInitCtx->pFitHead, pInitCtx->pPmttHead, pJob->Pid);
+}
+
 /**
   Creates the DIMM inventory
   Using the Firmware Interface Table, create an in memory representation
   of each dimm. For each unique dimm call the initialization function
-  unique to the type of DIMM. As each dimm is fully initialized add it to
-  the in memory list of DIMMs
+  unique to the type of DIMM. The mailbox traffic of different dimms may
+  overlap (see RunDimmJobs), the dimms are added to the in memory
+  list of DIMMs in Firmware Interface Table order once all are initialized.
 
   @param[in,out] pDev: The pmem super structure
 
@@ -1214,8 +1449,12 @@ InitializeDimmInventory(
   ParsedFitHeader *pFitHead = NULL;
   ParsedPmttHeader *pPmttHead = NULL;
   NvDimmRegionMappingStructure **ppNvDimmRegionMappingStructures = NULL;
-  DIMM *pNewDimm = NULL;
+  DIMM_INIT_JOB *pJobs = NULL;
+  DIMM_INIT_CTX InitCtx;
+  UINT32 JobsNum = 0;
+  UINT32 JobIndex = 0;
   UINT32 Index = 0;
+  UINT16 Pid = 0;
 
   NVDIMM_ENTRY();
   if (pDev == NULL || pDev->pFitHead == NULL || pDev->pFitHead->ppNvDimmRegionMappingStructures == NULL) {
@@ -1229,6 +1468,8 @@ InitializeDimmInventory(
   pPmttHead = pDev->pPmttHead;
   ppNvDimmRegionMappingStructures = pFitHead->ppNvDimmRegionMappingStructures;
 
+  CHECK_RESULT_MALLOC(pJobs, AllocateZeroPool(sizeof(*pJobs) * pFitHead->NvDimmRegionMappingStructuresNum), Finish);
+
   // Iterate over Region Mapping Structures (can be several per NVDIMM)
   // because they provide the NVDIMM physical ID, which is assigned by BIOS
   // and unique per boot. Could also use NFIT device handle.
@@ -1236,37 +1477,51 @@ InitializeDimmInventory(
   // doesn't have any unique information other than the UID, but that isn't
   // as useful and takes longer to calculate and compare.
   for (Index = 0; Index < pFitHead->NvDimmRegionMappingStructuresNum; Index++) {
-    if (GetDimmByPid(ppNvDimmRegionMappingStructures[Index]->NvDimmPhysicalId, &pDev->Dimms)) {
+    Pid = ppNvDimmRegionMappingStructures[Index]->NvDimmPhysicalId;
+    if (GetDimmByPid(Pid, &pDev->Dimms)) {
       // The associated NVDIMM physical ID is already in the dimms list, skip it
       continue;
     }
+    for (JobIndex = 0; JobIndex < JobsNum; JobIndex++) {
+      if (pJobs[JobIndex].Pid == Pid) {
+        break;
+      }
+    }
+    if (JobIndex < JobsNum) {
+      // Already queued up from another region mapping structure
+      continue;
+    }
 
     // Create a new dimm struct for every NVDIMM, functional or not
-    CHECK_RESULT_MALLOC(pNewDimm,(DIMM *) AllocateZeroPool(sizeof(*pNewDimm)), Finish);
+    CHECK_RESULT_MALLOC(pJobs[JobsNum].pDimm, (DIMM *) AllocateZeroPool(sizeof(DIMM)), Finish);
+    pJobs[JobsNum].Pid = Pid;
+    pJobs[JobsNum].ReturnCode = EFI_NOT_STARTED;
 
     // Assume dimm is functional
-    pNewDimm->NonFunctional = FALSE;
+    pJobs[JobsNum].pDimm->NonFunctional = FALSE;
 
     // Fill in smbus address details
-    CHECK_RESULT_CONTINUE(PopulateSmbusFields(pNewDimm));
-
-    // Insert into dimms list. We're only inserting a pointer so we can
-    // continue editing the dimm struct
-    InsertTailList(&pDev->Dimms, &pNewDimm->DimmNode);
-
-    CHECK_RESULT(InitializeDimm(pNewDimm, pFitHead, pPmttHead,
-        ppNvDimmRegionMappingStructures[Index]->NvDimmPhysicalId), ErrorInitializeDimm);
-
-    continue;
-
-ErrorInitializeDimm:
-    // If a dimm fails to initialize for any reason, it is also non-functional
-    // for right now
-    pNewDimm->NonFunctional = TRUE;
+    CHECK_RESULT_CONTINUE(PopulateSmbusFields(pJobs[JobsNum].pDimm));
+    JobsNum++;
   }
 
+  InitCtx.pJobs = pJobs;
+  InitCtx.pFitHead = pFitHead;
+  InitCtx.pPmttHead = pPmttHead;
+  RunDimmJobs(JobsNum, InitializeDimmJob, &InitCtx);
+
   ReturnCode = EFI_SUCCESS;
 Finish:
+  // Merge into the dimms list in table order, whatever order they finished in
+  for (JobIndex = 0; JobIndex < JobsNum; JobIndex++) {
+    if (EFI_ERROR(pJobs[JobIndex].ReturnCode)) {
+      // If a dimm fails to initialize for any reason, it is also non-functional
+      // for right now
+      pJobs[JobIndex].pDimm->NonFunctional = TRUE;
+    }
+    InsertTailList(&pDev->Dimms, &pJobs[JobIndex].pDimm->DimmNode);
+  }
+  FREE_POOL_SAFE(pJobs);
   NVDIMM_EXIT_I64(ReturnCode);
   return ReturnCode;
 }
@@ -2083,6 +2338,7 @@ FwCmdGetPcdLargePayload(
 
   /** Get PCD by large payload in single call **/
   pFwCmd->LargeOutputPayloadSize = PCD_PARTITION_SIZE;
+  CHECK_RESULT(AcquireLargePayloadBuffer(pDimm, pFwCmd->LargeOutputPayloadSize, &pFwCmd->LargeOutputPayload), Finish);
   InputPayload.Offset = 0;
   InputPayload.CmdOptions.PayloadType = PCD_CMD_OPT_LARGE_PAYLOAD;
 
@@ -2100,6 +2356,9 @@ FwCmdGetPcdLargePayload(
   CopyMem_S(*ppRawData, PCD_PARTITION_SIZE, pFwCmd->LargeOutputPayload, PCD_PARTITION_SIZE);
 
 Finish:
+  if (pFwCmd != NULL) {
+    ReleaseLargePayloadBuffer(pDimm, &pFwCmd->LargeOutputPayload);
+  }
   FREE_POOL_SAFE(pFwCmd);
   NVDIMM_EXIT_I64(ReturnCode);
   return ReturnCode;
@@ -2134,6 +2393,7 @@ FwCmdGetPlatformConfigData(
   BOOLEAN LargePayloadAvailable = FALSE;
 
   NVDIMM_ENTRY();
+  PCD_CACHE_LOCK();
 
   // Don't support using this function to retrieve PCD OEM Config data.
   // Use FwCmdGetPcdSmallPayload
@@ -2237,6 +2497,7 @@ FwCmdGetPlatformConfigData(
   } else {
     /** Get PCD by large payload in single call **/
     pFwCmd->LargeOutputPayloadSize = PcdSize;
+    CHECK_RESULT(AcquireLargePayloadBuffer(pDimm, pFwCmd->LargeOutputPayloadSize, &pFwCmd->LargeOutputPayload), Finish);
     InputPayload.Offset = 0;
     InputPayload.CmdOptions.PayloadType = PCD_CMD_OPT_LARGE_PAYLOAD;
     if (pFwCmd->InputPayloadSize > IN_PAYLOAD_SIZE) {
@@ -2289,8 +2550,12 @@ FwCmdGetPlatformConfigData(
     CopyMem_S(*ppRawData, PcdSize, pFwCmd->LargeOutputPayload, PcdSize);
   }
 Finish:
+  if (pFwCmd != NULL) {
+    ReleaseLargePayloadBuffer(pDimm, &pFwCmd->LargeOutputPayload);
+  }
   FREE_POOL_SAFE(pFwCmd);
   FREE_POOL_SAFE(pBuffer);
+  PCD_CACHE_UNLOCK();
   NVDIMM_EXIT_I64(ReturnCode);
   return ReturnCode;
 }
@@ -2503,6 +2768,7 @@ FwCmdGetPcdSmallPayload(
   PT_INPUT_PAYLOAD_GET_PLATFORM_CONFIG_DATA *pInputPayload = NULL;
 
   NVDIMM_ENTRY();
+  PCD_CACHE_LOCK();
 
   if (pDimm == NULL || pData == NULL) {
     goto Finish;
@@ -2560,6 +2826,7 @@ FwCmdGetPcdSmallPayload(
 
 Finish:
   FREE_POOL_SAFE(pFwCmd);
+  PCD_CACHE_UNLOCK();
   NVDIMM_EXIT_I64(ReturnCode);
   return ReturnCode;
 }
@@ -2593,6 +2860,7 @@ GetPcdOemConfigDataUsingSmallPayload(
   UINT32 Offset = 0;
   UINT8 TmpBuf[PCD_GET_SMALL_PAYLOAD_DATA_SIZE];
   NVDIMM_ENTRY();
+  PCD_CACHE_LOCK();
 
   if (pDimm == NULL || ppRawData == NULL || pRawDataSize == NULL) {
     ReturnCode = EFI_INVALID_PARAMETER;
@@ -2692,6 +2960,7 @@ Finish:
       *ppRawData = NULL;
   }
 
+  PCD_CACHE_UNLOCK();
   NVDIMM_EXIT_I64(ReturnCode);
 
   return ReturnCode;
@@ -2827,6 +3096,7 @@ FwCmdSetPlatformConfigData (
   BOOLEAN LargePayloadAvailable = FALSE;
 
   NVDIMM_ENTRY();
+  PCD_CACHE_LOCK();
 
   SetMem(&InPayloadSetData, sizeof(InPayloadSetData), 0x0);
 
@@ -2930,13 +3200,14 @@ FwCmdSetPlatformConfigData (
       }
     }
   } else {
+    CHECK_RESULT(AcquireLargePayloadBuffer(pDimm, PCD_PARTITION_SIZE, &pFwCmd->LargeInputPayload), Finish);
     // If it is OEM_PARTITION_ID we need to read entire
     // partition, copy over OEM Data and write
     // back entire partition
     if (PartitionId == PCD_OEM_PARTITION_ID) {
       CHECK_RESULT(FwCmdGetPcdLargePayload(pDimm, PCD_OEM_PARTITION_ID, &pOEMPartitionData), Finish);
       CopyMem_S(pFwCmd->LargeInputPayload + PCD_OEM_PARTITION_INTEL_CFG_REGION_SIZE,
-                 sizeof(pFwCmd->LargeInputPayload)- PCD_OEM_PARTITION_INTEL_CFG_REGION_SIZE,
+                 IN_MB_SIZE - PCD_OEM_PARTITION_INTEL_CFG_REGION_SIZE,
                  pOEMPartitionData + PCD_OEM_PARTITION_INTEL_CFG_REGION_SIZE,
                  PCD_OEM_PARTITION_INTEL_CFG_REGION_SIZE);
       pFwCmd->LargeInputPayloadSize = PCD_PARTITION_SIZE;
@@ -2950,7 +3221,7 @@ FwCmdSetPlatformConfigData (
     CopyMem_S(pFwCmd->InputPayload, sizeof(pFwCmd->InputPayload), &InPayloadSetData, pFwCmd->InputPayloadSize);
 
     /** Save 128KB partition to Large Payload **/
-    CopyMem_S(pFwCmd->LargeInputPayload, sizeof(pFwCmd->LargeInputPayload), pPartition, PcdSize);
+    CopyMem_S(pFwCmd->LargeInputPayload, IN_MB_SIZE, pPartition, PcdSize);
 #ifdef OS_BUILD
     ReturnCode = PassThru(pDimm, pFwCmd, PT_LONG_TIMEOUT_INTERVAL);
 #else
@@ -2967,9 +3238,13 @@ FwCmdSetPlatformConfigData (
   }
 
 Finish:
+  if (pFwCmd != NULL) {
+    ReleaseLargePayloadBuffer(pDimm, &pFwCmd->LargeInputPayload);
+  }
   FREE_POOL_SAFE(pPartition);
   FREE_POOL_SAFE(pFwCmd);
   FREE_POOL_SAFE(pOEMPartitionData);
+  PCD_CACHE_UNLOCK();
   NVDIMM_EXIT_I64(ReturnCode);
   return ReturnCode;
 }
@@ -3092,7 +3367,9 @@ Finish:
 
 /**
   Runs and handles errors errors for firmware update over both large and
-  small payloads.
+  small payloads. Progress and ARS retries are tracked in pDimm->FwUpdateStatus.
+  Several DIMMs may be updated at once as long as each of them is given a
+  pCommandStatus of its own.
 
   @param[in] pDimm Pointer to DIMM
   @param[in] pImageBuffer Pointer to fw image buffer
@@ -3149,6 +3426,7 @@ FwCmdUpdateFw(
     ChunkSize = ImageBufferSize;
     pInputPayload->PayloadTypeSelector = FW_UPDATE_LARGE_PAYLOAD_SELECTOR;
     pFwCmd->LargeInputPayloadSize = (UINT32)ImageBufferSize;
+    CHECK_RESULT(AcquireLargePayloadBuffer(pDimm, pFwCmd->LargeInputPayloadSize, &pFwCmd->LargeInputPayload), Finish);
     InputPayloadBuffer = pFwCmd->LargeInputPayload;
   }
 
@@ -3162,6 +3440,7 @@ FwCmdUpdateFw(
   // during chunking.
   while (BytesWrittenTotal < ImageBufferSize) {
     Percent = (UINT8)((BytesWrittenTotal*100)/ImageBufferSize);
+    pDimm->FwUpdateStatus.Progress = Percent;
     if (NULL != pCommandStatus) {
       SetObjProgress(pCommandStatus, pDimm->DeviceHandle.AsUint32, Percent);
     }
@@ -3201,6 +3480,7 @@ FwCmdUpdateFw(
       RetryDueToARS |= pFwCmd->DsmStatus == DSM_RETRY_SUGGESTED;
 #endif
       if (RetryDueToARS) {
+        pDimm->FwUpdateStatus.ArsRetries++;
         if (++CurrentRetryCount >= MAX_FW_UPDATE_RETRY_ON_DEV_BUSY) {
           *pNvmStatus = NVM_ERR_BUSY_DEVICE;
           ReturnCode = EFI_ABORTED;
@@ -3237,6 +3517,7 @@ FwCmdUpdateFw(
     BytesWrittenTotal += BytesToCopy;
   }
 
+  pDimm->FwUpdateStatus.Progress = 100;
   pDimm->RebootNeeded = TRUE;
 
   *pNvmStatus = NVM_SUCCESS_FW_RESET_REQUIRED;
@@ -3246,6 +3527,9 @@ Finish:
   if (NULL != pCommandStatus && NULL != pDimm) {
     ClearNvmStatus(GetObjectStatus(pCommandStatus, pDimm->DeviceHandle.AsUint32), NVM_OPERATION_IN_PROGRESS);
   }
+  if (pFwCmd != NULL) {
+    ReleaseLargePayloadBuffer(pDimm, &pFwCmd->LargeInputPayload);
+  }
   FREE_POOL_SAFE(pFwCmd);
   NVDIMM_EXIT_I64(ReturnCode);
   return ReturnCode;
@@ -3417,10 +3701,11 @@ FwCmdGetFwDebugLog (
     pFwCmd->LargeOutputPayloadSize = 0;
   } else {
     ChunkSize = MIB_TO_BYTES(1);
-    OutputPayload = pFwCmd->LargeOutputPayload;
     pInputPayload->PayloadType = DEBUG_LOG_PAYLOAD_TYPE_LARGE;
     pFwCmd->OutputPayloadSize = 0;
     pFwCmd->LargeOutputPayloadSize = OUT_MB_SIZE;
+    CHECK_RESULT(AcquireLargePayloadBuffer(pDimm, pFwCmd->LargeOutputPayloadSize, &pFwCmd->LargeOutputPayload), Finish);
+    OutputPayload = pFwCmd->LargeOutputPayload;
   }
 
   /** Fetch whole buffer, iterate by chunk size **/
@@ -3446,6 +3731,9 @@ FwCmdGetFwDebugLog (
 
 
 Finish:
+  if (pFwCmd != NULL) {
+    ReleaseLargePayloadBuffer(pDimm, &pFwCmd->LargeOutputPayload);
+  }
   FREE_POOL_SAFE(pFwCmd);
   NVDIMM_EXIT_I64(ReturnCode);
   return ReturnCode;
@@ -3498,7 +3786,11 @@ FwCmdGetErrorLog (
   pFwCmd->SubOpcode = SubopErrorLog;
   pFwCmd->InputPayloadSize = sizeof(*pInputPayload);
   pFwCmd->OutputPayloadSize = OutputPayloadSize;
-  pFwCmd->LargeOutputPayloadSize = LargeOutputPayloadSize;
+  // Large output lands directly in the caller's buffer
+  if (pLargeOutputPayload != NULL) {
+    pFwCmd->LargeOutputPayloadSize = LargeOutputPayloadSize;
+    pFwCmd->LargeOutputPayload = pLargeOutputPayload;
+  }
   CopyMem_S(&pFwCmd->InputPayload, sizeof(pFwCmd->InputPayload), pInputPayload, pFwCmd->InputPayloadSize);
 
   ReturnCode = PassThru(pDimm, pFwCmd, PT_LONG_TIMEOUT_INTERVAL);
@@ -3512,10 +3804,6 @@ FwCmdGetErrorLog (
     CopyMem_S(pOutputPayload, OutputPayloadSize, &pFwCmd->OutPayload, OutputPayloadSize);
   }
 
-  if (pLargeOutputPayload != NULL && LargeOutputPayloadSize > 0) {
-    CopyMem_S(pLargeOutputPayload, LargeOutputPayloadSize, &pFwCmd->LargeOutputPayload, LargeOutputPayloadSize);
-  }
-
 Finish:
   FREE_POOL_SAFE(pFwCmd);
   NVDIMM_EXIT_I64(ReturnCode);
@@ -3569,7 +3857,11 @@ FwCmdGetCommandEffectLog(
   pFwCmd->SubOpcode = SubopCommandEffectLog;
   pFwCmd->InputPayloadSize = sizeof(*pInputPayload);
   pFwCmd->OutputPayloadSize = OutputPayloadSize;
-  pFwCmd->LargeOutputPayloadSize = LargeOutputPayloadSize;
+  // Large output lands directly in the caller's buffer
+  if (pLargeOutputPayload != NULL) {
+    pFwCmd->LargeOutputPayloadSize = LargeOutputPayloadSize;
+    pFwCmd->LargeOutputPayload = pLargeOutputPayload;
+  }
   CopyMem_S(&pFwCmd->InputPayload, sizeof(pFwCmd->InputPayload), pInputPayload, pFwCmd->InputPayloadSize);
 
   ReturnCode = PassThru(pDimm, pFwCmd, PT_TIMEOUT_INTERVAL);
@@ -3583,10 +3875,6 @@ FwCmdGetCommandEffectLog(
     CopyMem_S(pOutputPayload, OutputPayloadSize, &pFwCmd->OutPayload, OutputPayloadSize);
   }
 
-  if (pLargeOutputPayload != NULL && LargeOutputPayloadSize > 0) {
-    CopyMem_S(pLargeOutputPayload, LargeOutputPayloadSize, &pFwCmd->LargeOutputPayload, LargeOutputPayloadSize);
-  }
-
   ReturnCode = EFI_SUCCESS;
   goto Finish;
 
@@ -5137,9 +5425,6 @@ InitializeDimm (
   UINT32 ControlRegTblsNum = MAX_IFC_NUM;
   UINT32 PcdSize = 0;
   ZeroMem(pControlRegTbls, sizeof(pControlRegTbls));
-  EFI_DCPMM_CONFIG2_PROTOCOL *pNvmDimmConfigProtocol = NULL;
-  EFI_DCPMM_CONFIG_TRANSPORT_ATTRIBS AttribsOrig;
-  EFI_DCPMM_CONFIG_TRANSPORT_ATTRIBS AttribsTemp;
   UINT16 TempBootStatusBitmask = DIMM_BOOT_STATUS_NORMAL;
   NVDIMM_ENTRY();
 
@@ -5222,25 +5507,20 @@ InitializeDimm (
     // *Determine what interfaces are accessible*
     //
     // The main reliable way to determine if DDRT/smbus are accessible or not is
-    // to try a command over that interface. The only way currently to force the
-    // interface is to use the global "-ddrt"/"-smbus" flags. Since the user
-    // setting these flags on the CLI conflict with this operation, save off
-    // the previous state of these flags so we can force which interface to use
-    // and then restore the original interface flags afterwards.
+    // to try a command over that interface. Force the interface for this DIMM
+    // only, the equivalent of the "-ddrt"/"-smbus" flags, so the global flags
+    // set by the user stay untouched and other DIMMs can be initialized at the
+    // same time. The override is dropped once interface selection is done.
     // This does mean that the flags are not honored for 1-2 commands, but
     // it is a lot simpler than other methods.
     // Note: DDRT large payload accessibility (DIMM_BOOT_STATUS_MEDIA_*)
     // is determined the normal way by reading the BSR directly in
     // PopulateDimmBsrAndBootStatusBitmask() (2nd half of this code).
 
-    // Save off previous state to AttribsOrig
-    CHECK_RESULT(OpenNvmDimmProtocol(gNvmDimmConfigProtocolGuid, (VOID **)&pNvmDimmConfigProtocol, NULL), Finish);
-    CHECK_RESULT(pNvmDimmConfigProtocol->GetFisTransportAttributes(pNvmDimmConfigProtocol, &AttribsOrig), Finish);
-
-    // Set "-ddrt" and "-spmb" flags
-    AttribsTemp.Protocol = FisTransportDdrt;
-    AttribsTemp.PayloadSize = FisTransportSizeSmallMb;
-    CHECK_RESULT(pNvmDimmConfigProtocol->SetFisTransportAttributes(pNvmDimmConfigProtocol, AttribsTemp), RestoreAttribs);
+    // Force "-ddrt" and "-spmb"
+    pNewDimm->TransportOverride.Protocol = FisTransportDdrt;
+    pNewDimm->TransportOverride.PayloadSize = FisTransportSizeSmallMb;
+    pNewDimm->TransportOverrideValid = TRUE;
     // Send identify dimm over ddrt small payload
     ReturnCode = FwCmdIdDimm(pNewDimm, pThrowawayPayload);
 
@@ -5252,10 +5532,9 @@ InitializeDimm (
       // We try checking the smbus interface only if DDRT fails.
       // Big performance penalty in OS currently if we use smbus.
 
-      // Set "-smbus" and "-spmb" flags
-      AttribsTemp.Protocol = FisTransportSmbus;
-      AttribsTemp.PayloadSize = FisTransportSizeSmallMb;
-      CHECK_RESULT(pNvmDimmConfigProtocol->SetFisTransportAttributes(pNvmDimmConfigProtocol, AttribsTemp), RestoreAttribs);
+      // Force "-smbus" and "-spmb"
+      pNewDimm->TransportOverride.Protocol = FisTransportSmbus;
+      pNewDimm->TransportOverride.PayloadSize = FisTransportSizeSmallMb;
       // Try identify dimm over smbus small payload
       ReturnCode = FwCmdIdDimm(pNewDimm, pThrowawayPayload);
       if (EFI_ERROR(ReturnCode)) {
@@ -5271,9 +5550,8 @@ RestoreAttribs:
     // Save off return code from above section
     ReturnCodeInterfaceSelection = ReturnCode;
 
-    // Restore the previous state of the CLI interface flags
-    // Go to Finish if error
-    CHECK_RESULT(pNvmDimmConfigProtocol->SetFisTransportAttributes(pNvmDimmConfigProtocol, AttribsOrig), Finish);
+    // Go back to the CLI interface flags
+    pNewDimm->TransportOverrideValid = FALSE;
 
     // Populate some more boot status bitmask bits.
     // Ignore return code, as this is an optional step
@@ -5297,6 +5575,10 @@ RestoreAttribs:
       pNewDimm->NonFunctional = TRUE;
     }
 
+    // The boot status is final now, resolve the transport used from here on
+    InvalidateDimmTransport(pNewDimm);
+    CHECK_RESULT_CONTINUE(ResolveDimmTransport(pNewDimm));
+
     // If there was an unhandled error in running interface selection, abort initialization
     ReturnCode = ReturnCodeInterfaceSelection;
     CHECK_RETURN_CODE(ReturnCode, Finish);
@@ -5480,15 +5762,105 @@ FreeDimm(
      OUT DIMM *pDimm
   )
 {
+  UINT32 Index = 0;
+
   NVDIMM_ENTRY();
   if (pDimm == NULL) {
     return;
   }
   FreeBlockWindow(pDimm->pBw);
+  for (Index = 0; Index < LARGE_PAYLOAD_POOL_SIZE; Index++) {
+    FREE_POOL_SAFE(pDimm->pLargePayloadPool[Index]);
+  }
   FREE_POOL_SAFE(pDimm);
   NVDIMM_EXIT();
 }
 
+/**
+  Lend a large mailbox buffer (IN_MB_SIZE bytes) from the DIMM's pool.
+  The first Size bytes are zeroed. If every pool buffer is already lent
+  out, a standalone buffer is allocated instead.
+
+  Commands to one DIMM are expected to be serialized by the caller.
+
+  @param[in] pDimm DIMM the command will be sent to
+  @param[in] Size Number of bytes the command will use
+  @param[out] ppBuffer Lent buffer, return it with ReleaseLargePayloadBuffer()
+
+  @retval EFI_SUCCESS Success
+  @retval EFI_INVALID_PARAMETER NULL parameter or Size larger than IN_MB_SIZE
+  @retval EFI_OUT_OF_RESOURCES memory allocation failure
+**/
+EFI_STATUS
+AcquireLargePayloadBuffer(
+  IN     DIMM *pDimm,
+  IN     UINT32 Size,
+     OUT UINT8 **ppBuffer
+  )
+{
+  EFI_STATUS ReturnCode = EFI_SUCCESS;
+  UINT32 Index = 0;
+
+  if (pDimm == NULL || ppBuffer == NULL || Size > IN_MB_SIZE) {
+    ReturnCode = EFI_INVALID_PARAMETER;
+    goto Finish;
+  }
+
+  *ppBuffer = NULL;
+  for (Index = 0; Index < LARGE_PAYLOAD_POOL_SIZE; Index++) {
+    if (!pDimm->LargePayloadInUse[Index]) {
+      if (pDimm->pLargePayloadPool[Index] == NULL) {
+        pDimm->pLargePayloadPool[Index] = AllocatePool(IN_MB_SIZE);
+        if (pDimm->pLargePayloadPool[Index] == NULL) {
+          break;
+        }
+      }
+      pDimm->LargePayloadInUse[Index] = TRUE;
+      *ppBuffer = pDimm->pLargePayloadPool[Index];
+      ZeroMem(*ppBuffer, Size);
+      goto Finish;
+    }
+  }
+
+  // Pool exhausted, fall back to a one-off buffer
+  *ppBuffer = AllocateZeroPool(IN_MB_SIZE);
+  if (*ppBuffer == NULL) {
+    ReturnCode = EFI_OUT_OF_RESOURCES;
+  }
+
+Finish:
+  return ReturnCode;
+}
+
+/**
+  Return a buffer obtained with AcquireLargePayloadBuffer() and clear the pointer
+
+  @param[in] pDimm DIMM the buffer was acquired for
+  @param[in,out] ppBuffer Buffer to return, may point to NULL
+**/
+VOID
+ReleaseLargePayloadBuffer(
+  IN     DIMM *pDimm,
+  IN OUT UINT8 **ppBuffer
+  )
+{
+  UINT32 Index = 0;
+
+  if (pDimm == NULL || ppBuffer == NULL || *ppBuffer == NULL) {
+    return;
+  }
+
+  for (Index = 0; Index < LARGE_PAYLOAD_POOL_SIZE; Index++) {
+    if (pDimm->pLargePayloadPool[Index] == *ppBuffer) {
+      pDimm->LargePayloadInUse[Index] = FALSE;
+      *ppBuffer = NULL;
+      return;
+    }
+  }
+
+  FREE_POOL_SAFE(*ppBuffer);
+}
+
 /**
   Remove a DIMM
   Perform all functions needed for when a DIMM is to be removed from the
@@ -6388,21 +6760,28 @@ GetDimmUid(
     goto Finish;
   }
 
-  if (pDimm->VendorId != 0 && pDimm->ManufacturingInfoValid != FALSE && pDimm->SerialNumber != 0) {
-    TmpDimmUid = CatSPrint(NULL, L"%04x", EndianSwapUint16(pDimm->VendorId));
-    if (pDimm->ManufacturingInfoValid == TRUE) {
-      TmpDimmUid = CatSPrintClean(TmpDimmUid, L"-%02x-%04x", pDimm->ManufacturingLocation, EndianSwapUint16(pDimm->ManufacturingDate));
+  // Formatted once, the identity fields only change when the DIMM is (re)initialized
+  if (!pDimm->UidCached) {
+    if (pDimm->VendorId != 0 && pDimm->ManufacturingInfoValid != FALSE && pDimm->SerialNumber != 0) {
+      TmpDimmUid = CatSPrint(NULL, L"%04x", EndianSwapUint16(pDimm->VendorId));
+      if (pDimm->ManufacturingInfoValid == TRUE) {
+        TmpDimmUid = CatSPrintClean(TmpDimmUid, L"-%02x-%04x", pDimm->ManufacturingLocation, EndianSwapUint16(pDimm->ManufacturingDate));
+      }
+      TmpDimmUid = CatSPrintClean(TmpDimmUid ,L"-%08x", EndianSwapUint32(pDimm->SerialNumber));
+    } else {
+      TmpDimmUid = CatSPrint(NULL, L"");
     }
-    TmpDimmUid = CatSPrintClean(TmpDimmUid ,L"-%08x", EndianSwapUint32(pDimm->SerialNumber));
-  } else {
-    TmpDimmUid = CatSPrint(NULL, L"");
-  }
 
-  if (TmpDimmUid != NULL) {
-    StrnCpyS(pDimmUid, DimmUidLen, TmpDimmUid, DimmUidLen - 1);
+    if (TmpDimmUid == NULL) {
+      goto Finish;
+    }
+    StrnCpyS(pDimm->Uid, MAX_DIMM_UID_LENGTH, TmpDimmUid, MAX_DIMM_UID_LENGTH - 1);
     FREE_POOL_SAFE(TmpDimmUid);
+    pDimm->UidCached = TRUE;
   }
 
+  StrnCpyS(pDimmUid, DimmUidLen, pDimm->Uid, DimmUidLen - 1);
+
 Finish:
   NVDIMM_EXIT_CHECK_I64(ReturnCode);
   return ReturnCode;
@@ -7187,6 +7566,7 @@ EFI_STATUS ClearPcdCacheOnDimmList(VOID)
   LIST_ENTRY *pDimmNode = NULL;
 
   if (NULL != gNvmDimmData) {
+    PCD_CACHE_LOCK();
     LIST_FOR_EACH(pDimmNode, &gNvmDimmData->PMEMDev.Dimms) {
       if (NULL != pDimmNode) {
         pDimm = DIMM_FROM_NODE(pDimmNode);
@@ -7196,39 +7576,40 @@ EFI_STATUS ClearPcdCacheOnDimmList(VOID)
         }
       }
     }
+    PCD_CACHE_UNLOCK();
   }
 #endif // PCD_CACHE_ENABLED
   return EFI_SUCCESS;
 }
 
 /**
-  Return what passthru method will be used to send the command.
+  Select the passthru method for the given transport attributes and the boot
+  status of the DIMM.
 
   @param[in] pDimm The DCPMM to transact with
+  @param[in] pAttribs The transport attributes to honor
   @param[in] IsLargePayloadCommand Need to know if large payload interface is
                                    even desired. If not, then it makes no sense
                                    to write to the large payload mailbox unless
                                    the user specifies it.
-  @param[out] Method Pointer to passthru method variable to modify
+  @param[out] pMethod Pointer to passthru method variable to modify
   @retval EFI_SUCCESS Success
+  @retval EFI_INVALID_PARAMETER Invalid transport attributes
   @retval EFI_DEVICE_ERROR if we failed to do basic communication with the DCPMM
 **/
+STATIC
 EFI_STATUS
-DeterminePassThruMethod(
-  IN DIMM *pDimm,
-  IN BOOLEAN IsLargePayloadCommand,
-  OUT DIMM_PASSTHRU_METHOD *Method
+SelectPassThruMethod(
+  IN     DIMM *pDimm,
+  IN     EFI_DCPMM_CONFIG_TRANSPORT_ATTRIBS *pAttribs,
+  IN     BOOLEAN IsLargePayloadCommand,
+     OUT DIMM_PASSTHRU_METHOD *pMethod
 )
 {
-  EFI_STATUS ReturnCode = EFI_INVALID_PARAMETER;
-  EFI_DCPMM_CONFIG2_PROTOCOL *pNvmDimmConfigProtocol = NULL;
-  EFI_DCPMM_CONFIG_TRANSPORT_ATTRIBS Attribs;
+  EFI_STATUS ReturnCode = EFI_SUCCESS;
+  EFI_DCPMM_CONFIG_TRANSPORT_ATTRIBS Attribs = *pAttribs;
   // Initialize incoming variable to a good default, just in case
-  *Method = DimmPassthruSmbusSmallPayload;
-
-  CHECK_RESULT(OpenNvmDimmProtocol(gNvmDimmConfigProtocolGuid, (VOID **)&pNvmDimmConfigProtocol, NULL), Finish);
-
-  CHECK_RESULT(pNvmDimmConfigProtocol->GetFisTransportAttributes(pNvmDimmConfigProtocol, &Attribs), Finish);
+  *pMethod = DimmPassthruSmbusSmallPayload;
 
   // Check if the user manually specified a certain interface. If specified,
   // go to passthru directly and don't do any auto-detection.
@@ -7239,16 +7620,16 @@ DeterminePassThruMethod(
     // User only specified "-ddrt"
     if (IS_DDRT_FLAG_ENABLED(Attribs) && Attribs.PayloadSize == FisTransportSizeAuto) {
       if (IsLargePayloadCommand) {
-        *Method = DimmPassthruDdrtLargePayload;
+        *pMethod = DimmPassthruDdrtLargePayload;
       } else {
-        *Method = DimmPassthruDdrtSmallPayload;
+        *pMethod = DimmPassthruDdrtSmallPayload;
       }
     } else if (IS_DDRT_FLAG_ENABLED(Attribs) && IS_LARGE_PAYLOAD_FLAG_ENABLED(Attribs)) {
-      *Method = DimmPassthruDdrtLargePayload;
+      *pMethod = DimmPassthruDdrtLargePayload;
     } else if (IS_DDRT_FLAG_ENABLED(Attribs) && IS_SMALL_PAYLOAD_FLAG_ENABLED(Attribs)) {
-      *Method = DimmPassthruDdrtSmallPayload;
+      *pMethod = DimmPassthruDdrtSmallPayload;
     } else if (IS_SMBUS_FLAG_ENABLED(Attribs)) {
-      *Method = DimmPassthruSmbusSmallPayload;
+      *pMethod = DimmPassthruSmbusSmallPayload;
     } else {
       NVDIMM_ERR("Invalid Attribs state of %d, %d detected. Exiting", Attribs.Protocol, Attribs.PayloadSize);
       ReturnCode = EFI_INVALID_PARAMETER;
@@ -7273,15 +7654,153 @@ DeterminePassThruMethod(
       (pDimm->BootStatusBitmask & DIMM_BOOT_STATUS_DDRT_NOT_READY))) {
 
     // Then allow them to do so
-    *Method = DimmPassthruDdrtLargePayload;
+    *pMethod = DimmPassthruDdrtLargePayload;
 
   // Otherwise prefer small payload DDRT
   } else if (!((pDimm->BootStatusBitmask & DIMM_BOOT_STATUS_DDRT_NOT_READY))) {
-    *Method = DimmPassthruDdrtSmallPayload;
+    *pMethod = DimmPassthruDdrtSmallPayload;
   } else {
     // Otherwise last resort is small payload smbus
-    *Method = DimmPassthruSmbusSmallPayload;
+    *pMethod = DimmPassthruSmbusSmallPayload;
+  }
+
+Finish:
+  return ReturnCode;
+}
+
+/**
+  Resolve the transport of a DIMM against the current transport attributes
+  and its boot status, and cache it in the DIMM. PassThru() uses the cached
+  transport until InvalidateDimmTransport() is called.
+
+  @param[in] pDimm The DCPMM to resolve the transport of
+
+  @retval EFI_SUCCESS Success, a DCPMM with a dead mailbox is cached as such
+  @retval EFI_INVALID_PARAMETER pDimm is NULL or invalid transport attributes
+**/
+EFI_STATUS
+ResolveDimmTransport(
+  IN DIMM *pDimm
+)
+{
+  EFI_STATUS ReturnCode = EFI_INVALID_PARAMETER;
+  EFI_DCPMM_CONFIG2_PROTOCOL *pNvmDimmConfigProtocol = NULL;
+  EFI_DCPMM_CONFIG_TRANSPORT_ATTRIBS Attribs;
+  DIMM_TRANSPORT_INFO Transport;
+#ifndef OS_BUILD
+  DCPMM_FIS_OUTPUT *pLargePayloadInfo = NULL;
+  UINT8 FisStatus = 0;
+#endif
+
+  if (pDimm == NULL) {
+    goto Finish;
+  }
+
+  ZeroMem(&Transport, sizeof(Transport));
+  CHECK_RESULT(OpenNvmDimmProtocol(gNvmDimmConfigProtocolGuid, (VOID **)&pNvmDimmConfigProtocol, NULL), Finish);
+  CHECK_RESULT(pNvmDimmConfigProtocol->GetFisTransportAttributes(pNvmDimmConfigProtocol, &Attribs), Finish);
+
+  ReturnCode = SelectPassThruMethod(pDimm, &Attribs, FALSE, &Transport.SmallPayloadMethod);
+  if (EFI_DEVICE_ERROR == ReturnCode) {
+    // Mailbox not ready, remember it so commands fail without asking again
+    Transport.SmallPayloadMethod = DimmPassthruSmbusSmallPayload;
+    Transport.LargePayloadMethod = DimmPassthruSmbusSmallPayload;
+    ReturnCode = EFI_SUCCESS;
+    goto Cache;
+  }
+  CHECK_RETURN_CODE(ReturnCode, Finish);
+  CHECK_RESULT(SelectPassThruMethod(pDimm, &Attribs, TRUE, &Transport.LargePayloadMethod), Finish);
+
+  Transport.MailboxReady = TRUE;
+  Transport.LargePayloadAvailable = DimmPassthruDdrtLargePayload == Transport.LargePayloadMethod;
+  if (Transport.LargePayloadAvailable) {
+#ifdef OS_BUILD
+    // The OS passthrough layer queries the mailbox geometry and chunks the transfer
+    Transport.LargeInputPayloadSize = IN_MB_SIZE;
+    Transport.LargeOutputPayloadSize = OUT_MB_SIZE;
+#else
+    // Optional, DcpmmCmd() asks the DIMM on each command without it
+    pLargePayloadInfo = AllocateZeroPool(sizeof(*pLargePayloadInfo));
+    if (pLargePayloadInfo != NULL &&
+        !EFI_ERROR(DcpmmLargePayloadInfo(pDimm, DCPMM_TIMEOUT_INTERVAL, FisOverDdrt, pLargePayloadInfo, &FisStatus)) &&
+        FW_SUCCESS == FisStatus) {
+      Transport.LargeInputPayloadSize = pLargePayloadInfo->Data.LpInfo.InpPayloadSize;
+      Transport.LargeOutputPayloadSize = pLargePayloadInfo->Data.LpInfo.OutPayloadSize;
+      Transport.DataChunkSize = pLargePayloadInfo->Data.LpInfo.DataChunkSize;
+    }
+#endif
+  }
+
+Cache:
+  pDimm->Transport = Transport;
+  pDimm->TransportValid = TRUE;
+
+Finish:
+#ifndef OS_BUILD
+  FREE_POOL_SAFE(pLargePayloadInfo);
+#endif
+  return ReturnCode;
+}
+
+/**
+  Drop the cached transport of a DIMM, it is resolved again on the next
+  command. Needed whenever the transport attributes or the boot status
+  of the DIMM change.
+
+  @param[in] pDimm The DCPMM to invalidate the transport of
+**/
+VOID
+InvalidateDimmTransport(
+  IN DIMM *pDimm
+)
+{
+  if (pDimm != NULL) {
+    pDimm->TransportValid = FALSE;
   }
+}
+
+/**
+  Return what passthru method will be used to send the command.
+
+  @param[in] pDimm The DCPMM to transact with
+  @param[in] IsLargePayloadCommand Need to know if large payload interface is
+                                   even desired. If not, then it makes no sense
+                                   to write to the large payload mailbox unless
+                                   the user specifies it.
+  @param[out] Method Pointer to passthru method variable to modify
+  @retval EFI_SUCCESS Success
+  @retval EFI_DEVICE_ERROR if we failed to do basic communication with the DCPMM
+**/
+EFI_STATUS
+DeterminePassThruMethod(
+  IN DIMM *pDimm,
+  IN BOOLEAN IsLargePayloadCommand,
+  OUT DIMM_PASSTHRU_METHOD *Method
+)
+{
+  EFI_STATUS ReturnCode = EFI_INVALID_PARAMETER;
+  // Initialize incoming variable to a good default, just in case
+  *Method = DimmPassthruSmbusSmallPayload;
+
+  if (pDimm->TransportOverrideValid) {
+    // Interface forced for this DIMM only (interface selection in InitializeDimm),
+    // not cached as the boot status is still being worked out
+    ReturnCode = SelectPassThruMethod(pDimm, &pDimm->TransportOverride, IsLargePayloadCommand, Method);
+    goto Finish;
+  }
+
+  if (!pDimm->TransportValid) {
+    CHECK_RESULT(ResolveDimmTransport(pDimm), Finish);
+  }
+
+  if (!pDimm->Transport.MailboxReady) {
+    ReturnCode = EFI_DEVICE_ERROR;
+    NVDIMM_ERR("DCPMM mailbox is not ready. Cancelling PassThru()");
+    goto Finish;
+  }
+
+  *Method = IsLargePayloadCommand ? pDimm->Transport.LargePayloadMethod : pDimm->Transport.SmallPayloadMethod;
+  ReturnCode = EFI_SUCCESS;
 
 Finish:
   return ReturnCode;
@@ -7549,6 +8068,9 @@ DcpmmCmd(
   DCPMM_FIS_INPUT *pInputPayload = NULL;
   DCPMM_FIS_OUTPUT *pOutputPayload = NULL;
   DCPMM_FIS_OUTPUT *pLargePayloadInfo = NULL;
+  UINT32 InpPayloadSize = 0;
+  UINT32 OutPayloadSize = 0;
+  UINT32 DataChunkSize = 0;
   UINT16 Command = 0;
 
   NVDIMM_ENTRY();
@@ -7571,8 +8093,13 @@ DcpmmCmd(
     }
   }
 
-  /** Get large payload info **/
-  if (pCmd->LargeInputPayloadSize > 0 || pCmd->LargeOutputPayloadSize > 0) {
+  /** Get large payload info, resolved with the DIMM transport for DDRT **/
+  if ((pCmd->LargeInputPayloadSize > 0 || pCmd->LargeOutputPayloadSize > 0) &&
+      FisOverDdrt == DcpmmInterface && pDimm->TransportValid && pDimm->Transport.DataChunkSize > 0) {
+    InpPayloadSize = pDimm->Transport.LargeInputPayloadSize;
+    OutPayloadSize = pDimm->Transport.LargeOutputPayloadSize;
+    DataChunkSize = pDimm->Transport.DataChunkSize;
+  } else if (pCmd->LargeInputPayloadSize > 0 || pCmd->LargeOutputPayloadSize > 0) {
     pLargePayloadInfo = (DCPMM_FIS_OUTPUT *)AllocateZeroPool(sizeof(*pLargePayloadInfo));
     if (pLargePayloadInfo == NULL) {
       ReturnCode = EFI_OUT_OF_RESOURCES;
@@ -7585,6 +8112,9 @@ DcpmmCmd(
       FW_CMD_ERROR_TO_EFI_STATUS(pCmd, ReturnCode);
       goto Finish;
     }
+    InpPayloadSize = pLargePayloadInfo->Data.LpInfo.InpPayloadSize;
+    OutPayloadSize = pLargePayloadInfo->Data.LpInfo.OutPayloadSize;
+    DataChunkSize = pLargePayloadInfo->Data.LpInfo.DataChunkSize;
   }
 
   /** Prepare input payload structure **/
@@ -7600,13 +8130,13 @@ DcpmmCmd(
 
   /** Write data to large input payload **/
   if (pCmd->LargeInputPayloadSize > 0) {
-    if (pCmd->LargeInputPayloadSize > pLargePayloadInfo->Data.LpInfo.InpPayloadSize) {
+    if (pCmd->LargeInputPayloadSize > InpPayloadSize) {
       NVDIMM_ERR("Available large input payload size is not enough");
       ReturnCode = EFI_INVALID_PARAMETER;
       goto Finish;
     } else {
       ReturnCode = DcpmmLargePayloadWrite(pDimm, pCmd->LargeInputPayload, pCmd->LargeInputPayloadSize,
-        pLargePayloadInfo->Data.LpInfo.DataChunkSize, Timeout, DcpmmInterface, &pCmd->Status);
+        DataChunkSize, Timeout, DcpmmInterface, &pCmd->Status);
       if (EFI_ERROR(ReturnCode)) {
         NVDIMM_ERR("Error detected when sending DcpmmLargePayloadWrite");
         FW_CMD_ERROR_TO_EFI_STATUS(pCmd, ReturnCode);
@@ -7635,12 +8165,12 @@ DcpmmCmd(
 
   /** Read data from large output payload **/
   if (pCmd->LargeOutputPayloadSize > 0) {
-    if (pCmd->LargeOutputPayloadSize > pLargePayloadInfo->Data.LpInfo.OutPayloadSize) {
+    if (pCmd->LargeOutputPayloadSize > OutPayloadSize) {
       NVDIMM_ERR("Data in large output payload cannot be fully filled");
       ReturnCode = EFI_INVALID_PARAMETER;
       goto Finish;
     } else {
-      ReturnCode = DcpmmLargePayloadRead(pDimm, pCmd->LargeOutputPayloadSize, pLargePayloadInfo->Data.LpInfo.DataChunkSize,
+      ReturnCode = DcpmmLargePayloadRead(pDimm, pCmd->LargeOutputPayloadSize, DataChunkSize,
         Timeout, DcpmmInterface, pCmd->LargeOutputPayload, &pCmd->Status);
       if (EFI_ERROR(ReturnCode)) {
         NVDIMM_ERR("Error detected when sending DcpmmLargePayloadRead");
@@ -176,6 +176,9 @@ typedef struct _BLOCK_WINDOW {
   UINT32 NumSegmentsOfApt;     //!< Number of segments of the interleaved aperture
 } BLOCK_WINDOW;
 
+//!< One large input and one large output mailbox can be in flight per DIMM
+#define LARGE_PAYLOAD_POOL_SIZE 2
+
 typedef struct _DIMM {
   LIST_ENTRY DimmNode;
   UINT64 Signature;
@@ -202,6 +205,8 @@ typedef struct _DIMM {
   UINT16 ManufacturingDate;
 
   UINT32 SerialNumber;
+  CHAR16 Uid[MAX_DIMM_UID_LENGTH];         //!< UID formatted from the fields above, see GetDimmUid()
+  BOOLEAN UidCached;                       //!< Uid is current, cleared when the fields above change
   CHAR8 PartNumber[PART_NUMBER_LEN];
   UINT16 Rid;                              //!< Revision ID
   UINT16 SubsystemRid;                     //!< Revision ID of the subsystem memory controller from NFIT
@@ -310,6 +315,36 @@ typedef struct _DIMM {
 #endif
   UINT8 FwActiveApiVersionMajor;               //!< Specifies the FW Active Api major version
   UINT8 FwActiveApiVersionMinor;               //!< Specifies the FW Active Api minor version
+
+  /**
+    Large mailbox sized buffers reused by firmware commands to this DIMM.
+    Allocated on first use, lent out by AcquireLargePayloadBuffer().
+  **/
+  UINT8 *pLargePayloadPool[LARGE_PAYLOAD_POOL_SIZE];
+  BOOLEAN LargePayloadInUse[LARGE_PAYLOAD_POOL_SIZE];
+
+  /**
+    Interface forced for this DIMM only, used by InitializeDimm() to probe
+    DDRT/smbus without touching the global transport attributes so several
+    DIMMs can be initialized at once. Honored while TransportOverrideValid is set.
+  **/
+  BOOLEAN TransportOverrideValid;
+  EFI_DCPMM_CONFIG_TRANSPORT_ATTRIBS TransportOverride;
+
+  /**
+    Transport resolved by ResolveDimmTransport() once the boot status is known,
+    used by PassThru() while TransportValid is set.
+  **/
+  BOOLEAN TransportValid;
+  DIMM_TRANSPORT_INFO Transport;
+
+  /**
+    The firmware update under way, or else the last one since the driver
+    was loaded. Written by UpdateFw() and FwCmdUpdateFw(), and by
+    GetFwUpdateStatus() while the image is being staged.
+  **/
+  FW_UPDATE_STATUS FwUpdateStatus;
+  UINT64 FwUpdateTransferEndMs;  //!< End of the image transfer, StageTimeMs counts from it
 } DIMM;
 
 #define DIMM_SIGNATURE     SIGNATURE_64('\0', '\0', '\0', '\0', 'D', 'I', 'M', 'M')
@@ -366,8 +401,46 @@ BOOLEAN ConfigIsLargePayloadDisabled();
 * It returns TRUE in case of DDRT protocol access is disabled and FALSE otherwise
 */
 BOOLEAN ConfigIsDdrtProtocolDisabled();
+
+#define INI_PREFERENCES_DIMM_PARALLEL_THREADS L"DIMM_PARALLEL_THREADS"
+#define DIMM_PARALLEL_THREADS_DEFAULT 8
+/*
+* Function get the ini configuration only on the first call
+*
+* It returns the maximum number of DIMMs sent firmware commands in parallel, 1 meaning serial
+*/
+UINT32 ConfigGetDimmThreads();
 #endif // OS_BUILD
 
+/**
+  Job body run by RunDimmJobs()
+
+  @param[in] JobIndex: Index of the job to run
+  @param[in] pCtx: Context passed to RunDimmJobs()
+**/
+typedef VOID (*DIMM_JOB_CALLBACK)(UINT32 JobIndex, VOID *pCtx);
+
+/**
+  Run one job per DIMM, in parallel when the OS build allows it
+  (see DIMM_PARALLEL_THREADS), serially otherwise.
+
+  Jobs must each work on a different DIMM so firmware commands to a single
+  DIMM stay serialized, and must not change state shared with other jobs
+  besides the PCD cache, the debug logger and the playback/record session,
+  which are locked while the jobs run in parallel. Jobs may run in any
+  order; collect the results in per-job slots.
+
+  @param[in] JobsNum: Number of jobs
+  @param[in] pCallback: Job body, called once for each index below JobsNum
+  @param[in] pCtx: Passed through to pCallback
+**/
+VOID
+RunDimmJobs(
+  IN     UINT32 JobsNum,
+  IN     DIMM_JOB_CALLBACK pCallback,
+  IN     VOID *pCtx
+  );
+
 EFI_STATUS
 DimmInit(
   IN     struct _PMEM_DEV *pDev
@@ -684,6 +757,38 @@ FreeDimm(
      OUT DIMM *pDimm
   );
 
+/**
+  Lend a large mailbox buffer (IN_MB_SIZE bytes) from the DIMM's pool.
+  The first Size bytes are zeroed. If every pool buffer is already lent
+  out, a standalone buffer is allocated instead.
+
+  @param[in] pDimm DIMM the command will be sent to
+  @param[in] Size Number of bytes the command will use
+  @param[out] ppBuffer Lent buffer, return it with ReleaseLargePayloadBuffer()
+
+  @retval EFI_SUCCESS Success
+  @retval EFI_INVALID_PARAMETER NULL parameter or Size larger than IN_MB_SIZE
+  @retval EFI_OUT_OF_RESOURCES memory allocation failure
+**/
+EFI_STATUS
+AcquireLargePayloadBuffer(
+  IN     DIMM *pDimm,
+  IN     UINT32 Size,
+     OUT UINT8 **ppBuffer
+  );
+
+/**
+  Return a buffer obtained with AcquireLargePayloadBuffer() and clear the pointer
+
+  @param[in] pDimm DIMM the buffer was acquired for
+  @param[in,out] ppBuffer Buffer to return, may point to NULL
+**/
+VOID
+ReleaseLargePayloadBuffer(
+  IN     DIMM *pDimm,
+  IN OUT UINT8 **ppBuffer
+  );
+
 /**
   Parse Firmware Version
   Parse the FW version returned by the FW into a CPU format
@@ -2007,6 +2112,33 @@ EFI_STATUS GetPcdOemDataSize(
   UINT32 *pOemDataSize
 );
 
+/**
+  Resolve the transport of a DIMM against the current transport attributes
+  and its boot status, and cache it in the DIMM. PassThru() uses the cached
+  transport until InvalidateDimmTransport() is called.
+
+  @param[in] pDimm The DCPMM to resolve the transport of
+
+  @retval EFI_SUCCESS Success, a DCPMM with a dead mailbox is cached as such
+  @retval EFI_INVALID_PARAMETER pDimm is NULL or invalid transport attributes
+**/
+EFI_STATUS
+ResolveDimmTransport(
+  IN DIMM *pDimm
+);
+
+/**
+  Drop the cached transport of a DIMM, it is resolved again on the next
+  command. Needed whenever the transport attributes or the boot status
+  of the DIMM change.
+
+  @param[in] pDimm The DCPMM to invalidate the transport of
+**/
+VOID
+InvalidateDimmTransport(
+  IN DIMM *pDimm
+);
+
 /**
   Check if sending a large payload command over the DDRT large payload
   mailbox is possible. Used by callers often to determine chunking behavior.
@@ -183,6 +183,83 @@ DefaultPassThru (
   IN     UINT64 Timeout
   );
 
+#ifdef OS_BUILD
+/**
+  Serialize the playback/record session accesses made by DefaultPassThru().
+  Needs to be enabled while firmware commands are sent from more than one thread.
+
+  @param[in] Enable TRUE to create the lock, FALSE to destroy it
+
+  @retval EFI_SUCCESS
+  @retval EFI_OUT_OF_RESOURCES The lock could not be created
+**/
+EFI_STATUS
+EFIAPI
+SetPassThruPbrLocking (
+  IN     BOOLEAN Enable
+  );
+
+/**
+  Start collecting the firmware command statistics if the FW_CMD_STATS_ENABLED
+  preference is set. A collection enabled by FwCmdStatsEnable() is left as is.
+**/
+VOID
+EFIAPI
+FwCmdStatsInit (
+  );
+
+/**
+  Start or stop collecting the firmware command statistics of DefaultPassThru().
+  Statistics already collected are kept.
+
+  @param[in] Enable TRUE to collect, FALSE to stop
+
+  @retval EFI_SUCCESS
+  @retval EFI_OUT_OF_RESOURCES The lock could not be created
+**/
+EFI_STATUS
+EFIAPI
+FwCmdStatsEnable (
+  IN     BOOLEAN Enable
+  );
+
+/**
+  @retval TRUE if the firmware command statistics are being collected
+**/
+BOOLEAN
+EFIAPI
+FwCmdStatsEnabled (
+  );
+
+/**
+  Drop all the firmware command statistics collected so far
+**/
+VOID
+EFIAPI
+FwCmdStatsReset (
+  );
+
+/**
+  Get the firmware command statistics of a PMem module, one entry per opcode/subopcode
+  sent to it, sorted by opcode and subopcode.
+
+  @param[in] DimmHandle NFIT device handle of the PMem module
+  @param[out] pStats Array of *pCount entries, may be NULL if *pCount is 0
+  @param[in,out] pCount Size of pStats on input, number of entries available on output
+
+  @retval EFI_SUCCESS
+  @retval EFI_INVALID_PARAMETER pCount is NULL, or pStats is NULL and *pCount is not 0
+  @retval EFI_BUFFER_TOO_SMALL pStats is too small, *pCount is set to the size needed
+**/
+EFI_STATUS
+EFIAPI
+FwCmdStatsGet (
+  IN     UINT32 DimmHandle,
+     OUT FW_CMD_STATS *pStats OPTIONAL,
+  IN OUT UINT32 *pCount
+  );
+#endif // OS_BUILD
+
 /**
   Pass through command to FW, but retry FW_ABORTED_RETRIES_COUNT_MAX times if we receive a FW_ABORTED
   response code back.
@@ -1081,6 +1081,78 @@ Finish:
   return ReturnCode;
 }
 
+/**
+  Verify that all manageable NVM-DIMMs have a unique identifier, in a single
+  hashed pass over the cached UIDs. UIDs are compared case insensitively.
+
+  @retval EFI_SUCCESS if no two manageable DIMMs share a UID.
+  @retval EFI_DEVICE_ERROR if two manageable DIMMs share a UID.
+  @retval EFI_OUT_OF_RESOURCES if memory allocation failed.
+**/
+STATIC
+EFI_STATUS
+CheckDimmUidsUnique(
+  VOID
+  )
+{
+  EFI_STATUS ReturnCode = EFI_SUCCESS;
+  LIST_ENTRY *pDimmNode = NULL;
+  DIMM *pDimm = NULL;
+  DIMM **ppSlots = NULL;
+  CHAR16 DimmUid[MAX_DIMM_UID_LENGTH];
+  CHAR16 *pChar = NULL;
+  UINT32 DimmsNum = 0;
+  UINT32 Bits = 1;
+  UINT32 Mask = 0;
+  UINT32 Hash = 0;
+  UINT32 Slot = 0;
+
+  LIST_FOR_EACH(pDimmNode, &gNvmDimmData->PMEMDev.Dimms) {
+    DimmsNum++;
+  }
+  while ((1U << Bits) < DimmsNum * 2) {
+    Bits++;
+  }
+  Mask = (1U << Bits) - 1;
+  CHECK_RESULT_MALLOC(ppSlots, AllocateZeroPool(sizeof(*ppSlots) << Bits), Finish);
+
+  LIST_FOR_EACH(pDimmNode, &gNvmDimmData->PMEMDev.Dimms) {
+    pDimm = DIMM_FROM_NODE(pDimmNode);
+    if (!IsDimmManageable(pDimm)) {
+      continue;
+    }
+
+    ZeroMem(DimmUid, sizeof(DimmUid));
+    GetDimmUid(pDimm, DimmUid, MAX_DIMM_UID_LENGTH);
+
+    // FNV-1a over the upper cased UID
+    Hash = 2166136261U;
+    for (pChar = DimmUid; *pChar != L'\0'; pChar++) {
+      Hash = (Hash ^ ((*pChar >= L'a' && *pChar <= L'z') ? *pChar - L'a' + L'A' : *pChar)) * 16777619U;
+    }
+
+    for (Slot = Hash & Mask; ppSlots[Slot] != NULL; Slot = (Slot + 1) & Mask) {
+      if (StrICmp(ppSlots[Slot]->Uid, DimmUid) == 0) {
+        NVDIMM_ERR("NVM-DIMMs with the same NVDIMM UID have been detected.");
+
+#if defined(DYNAMIC_WA_ENABLE)
+        if (gNvmDimmData->IgnoreTheSameUIDNumbers) {
+          NVDIMM_DBG("Ignoring same NVDIMM UIDs among dimms");
+          goto Finish;
+        }
+#endif
+        ReturnCode = EFI_DEVICE_ERROR;
+        goto Finish;
+      }
+    }
+    ppSlots[Slot] = pDimm;
+  }
+
+Finish:
+  FREE_POOL_SAFE(ppSlots);
+  return ReturnCode;
+}
+
 /**
   This function makes calls to the dimms required to initialize the driver.
 
@@ -1094,11 +1166,7 @@ InitializeDimms()
    EFI_STATUS ReturnCodeNonBlocking = EFI_SUCCESS;
    UINT32 Index = 0;
    DIMM *pDimm = NULL;
-   DIMM *pDimm2 = NULL;
    LIST_ENTRY *pDimmNode = NULL;
-   LIST_ENTRY *pDimmNode2 = NULL;
-   CHAR16 Dimm1Uid[MAX_DIMM_UID_LENGTH];
-   CHAR16 Dimm2Uid[MAX_DIMM_UID_LENGTH];
 
    NVDIMM_ENTRY();
 
@@ -1130,35 +1198,9 @@ InitializeDimms()
     Verify that all manageable NVM-DIMMs have unique identifier. Otherwise, print a critical error and
     break further initialization.
    **/
-   LIST_FOR_EACH(pDimmNode, &gNvmDimmData->PMEMDev.Dimms) {
-    pDimm = DIMM_FROM_NODE(pDimmNode);
-    if (!IsDimmManageable(pDimm)) {
-      continue;
-    }
-
-    LIST_FOR_EACH(pDimmNode2, &gNvmDimmData->PMEMDev.Dimms) {
-      pDimm2 = DIMM_FROM_NODE(pDimmNode2);
-      if (IsDimmManageable(pDimm2)) {
-        ZeroMem(Dimm1Uid, sizeof(Dimm1Uid));
-        ZeroMem(Dimm2Uid, sizeof(Dimm2Uid));
-        GetDimmUid(pDimm, Dimm1Uid, MAX_DIMM_UID_LENGTH);
-        GetDimmUid(pDimm2, Dimm2Uid, MAX_DIMM_UID_LENGTH);
-        if (pDimm != pDimm2 && (StrICmp(Dimm1Uid,Dimm2Uid) == 0)) {
-          NVDIMM_ERR("NVM-DIMMs with the same NVDIMM UID have been detected.");
-
-#if defined(DYNAMIC_WA_ENABLE)
-          if (gNvmDimmData->IgnoreTheSameUIDNumbers) {
-            NVDIMM_DBG("Ignoring same NVDIMM UIDs among dimms");
-          } else {
-#endif
-            ReturnCode = EFI_DEVICE_ERROR;
-            goto Finish;
-#if defined(DYNAMIC_WA_ENABLE)
-          }
-#endif
-        }
-      }
-    }
+   ReturnCode = CheckDimmUidsUnique();
+   if (EFI_ERROR(ReturnCode)) {
+    goto Finish;
    }
 
 #ifndef OS_BUILD
@@ -1342,11 +1384,7 @@ NvmDimmDriverDriverBindingStart(
    EFI_STATUS ReturnCode = EFI_SUCCESS;
    UINT32 Index = 0;
    DIMM *pDimm = NULL;
-   DIMM *pDimm2 = NULL;
    LIST_ENTRY *pDimmNode = NULL;
-   LIST_ENTRY *pDimmNode2 = NULL;
-   CHAR16 Dimm1Uid[MAX_DIMM_UID_LENGTH];
-   CHAR16 Dimm2Uid[MAX_DIMM_UID_LENGTH];
 
 
    NVDIMM_ENTRY();
@@ -1356,12 +1394,22 @@ NvmDimmDriverDriverBindingStart(
    **/
    InitErrorAndWarningNvmStatusCodes();
 
+   /**
+   Collect the firmware command statistics from the first command on if requested
+   **/
+   FwCmdStatsInit();
+
    /**
    Remember the Controller handle that we were started with.
    **/
    gNvmDimmData->ControllerHandle = ControllerHandle;
    gNvmDimmData->NvmDimmConfig = gNvmDimmDriverNvmDimmConfig;
 
+   /**
+   SMBIOS index is rebuilt on first use along with the reloaded ACPI tables
+   **/
+   FreeSmbiosIndex(&gNvmDimmData->PMEMDev.pSmbiosIndex);
+
    /**
    load the ACPI Tables (NFIT, PCAT, PMTT)
    **/
@@ -1392,35 +1440,9 @@ NvmDimmDriverDriverBindingStart(
    Verify that all manageable NVM-DIMMs have unique identifier. Otherwise, print a critical error and
    break further initialization.
    **/
-   LIST_FOR_EACH(pDimmNode, &gNvmDimmData->PMEMDev.Dimms) {
-      pDimm = DIMM_FROM_NODE(pDimmNode);
-      if (!IsDimmManageable(pDimm)) {
-         continue;
-      }
-
-      LIST_FOR_EACH(pDimmNode2, &gNvmDimmData->PMEMDev.Dimms) {
-         pDimm2 = DIMM_FROM_NODE(pDimmNode2);
-         if (IsDimmManageable(pDimm2)) {
-            ZeroMem(Dimm1Uid, sizeof(Dimm1Uid));
-            ZeroMem(Dimm2Uid, sizeof(Dimm2Uid));
-            GetDimmUid(pDimm, Dimm1Uid, MAX_DIMM_UID_LENGTH);
-            GetDimmUid(pDimm2, Dimm2Uid, MAX_DIMM_UID_LENGTH);
-            if (pDimm != pDimm2 && (StrICmp(Dimm1Uid, Dimm2Uid) == 0)) {
-               NVDIMM_ERR("NVM-DIMMs with the same NVDIMM UID have been detected.");
-
-#if defined(DYNAMIC_WA_ENABLE)
-               if (gNvmDimmData->IgnoreTheSameUIDNumbers) {
-                  NVDIMM_DBG("Ignoring same NVDIMM UIDs among dimms");
-               } else {
-#endif
-                  ReturnCode = EFI_DEVICE_ERROR;
-                  goto Finish;
-#if defined(DYNAMIC_WA_ENABLE)
-               }
-#endif
-            }
-         }
-      }
+   ReturnCode = CheckDimmUidsUnique();
+   if (EFI_ERROR(ReturnCode)) {
+      goto Finish;
    }
 
    Index = 0;
@@ -1568,6 +1590,11 @@ NvmDimmDriverDriverBindingStart(
       goto Finish;
    }
 
+   /**
+   SMBIOS index is rebuilt on first use along with the reloaded ACPI tables
+   **/
+   FreeSmbiosIndex(&gNvmDimmData->PMEMDev.pSmbiosIndex);
+
    /**
    load the ACPI Tables (NFIT, PCAT and PMTT)
    **/
@@ -1849,6 +1876,9 @@ NvmDimmDriverDriverBindingStop(
   /** Free PMTT tables memory **/
   FreeParsedPmtt(&gNvmDimmData->PMEMDev.pPmttHead);
 
+  /** Free SMBIOS index memory **/
+  FreeSmbiosIndex(&gNvmDimmData->PMEMDev.pSmbiosIndex);
+
   if (gNvmDimmData->HiiHandle != NULL) {
     HiiRemovePackages(gNvmDimmData->HiiHandle);
     gNvmDimmData->HiiHandle = NULL;
@@ -1875,6 +1905,9 @@ Finish:
   /** Free PMTT tables memory **/
   FreeParsedPmtt(&gNvmDimmData->PMEMDev.pPmttHead);
 
+  /** Free SMBIOS index memory **/
+  FreeSmbiosIndex(&gNvmDimmData->PMEMDev.pSmbiosIndex);
+
 #endif //not OS_BUILD
 #if _BullseyeCoverage
 #ifndef OS_BUILD
@@ -114,6 +114,8 @@ typedef struct _PMEM_DEV {
   ParsedPcatHeader *pPcatHead;
   // Note: Only the PMTT 0.2 table is parsed and placed here!
   ParsedPmttHeader *pPmttHead;
+  // Built from the SMBIOS table on first use, see GetSmbiosIndex()
+  SMBIOS_INDEX *pSmbiosIndex;
 } PMEM_DEV;
 
 /**
@@ -41,6 +41,7 @@
 #endif
 
 #ifdef OS_BUILD
+#include <os.h>
 #include <os_efi_api.h>
 #endif // OS_BUILD
 
@@ -158,7 +159,12 @@ EFI_DCPMM_CONFIG2_PROTOCOL gNvmDimmDriverNvmDimmConfig =
   GetFisTransportAttributes,
   SetFisTransportAttributes,
   GetCommandAccessPolicy,
-  GetCommandEffectLog
+  GetCommandEffectLog,
+  GetFwUpdateStatus,
+  GetDimmTransport,
+#ifdef OS_BUILD
+  GetFwCmdStats,
+#endif
 };
 
 
@@ -540,17 +546,25 @@ FillSmbiosInfo(
 {
   EFI_STATUS ReturnCode = EFI_SUCCESS;
   EFI_STATUS TempReturnCode = EFI_SUCCESS;
+  SMBIOS_INDEX *pSmbiosIndex = NULL;
+  SMBIOS_MEMDEV_ENTRY *pMemDev = NULL;
   SMBIOS_STRUCTURE_POINTER DmiPhysicalDev;
-  SMBIOS_STRUCTURE_POINTER DmiDeviceMappedAddr;
   SMBIOS_VERSION SmbiosVersion;
   UINT64 CapacityFromSmbios = 0;
 
-  ReturnCode = GetDmiMemdevInfo(pDimmInfo->DimmID, &DmiPhysicalDev, &DmiDeviceMappedAddr, &SmbiosVersion);
+  ReturnCode = GetSmbiosIndex(&pSmbiosIndex);
   if (EFI_ERROR(ReturnCode)) {
     NVDIMM_ERR("Failure to retrieve SMBIOS tables");
     return ReturnCode;
   }
 
+  SmbiosVersion = pSmbiosIndex->Version;
+  DmiPhysicalDev.Raw = NULL;
+  pMemDev = FindSmbiosMemDev(pSmbiosIndex, pDimmInfo->DimmID);
+  if (pMemDev != NULL) {
+    DmiPhysicalDev = pMemDev->Type17;
+  }
+
   /* SMBIOS type 17 table info */
   if (DmiPhysicalDev.Type17 != NULL) {
     if (DmiPhysicalDev.Type17->MemoryType == SMBIOS_MEMORY_TYPE_DDR4) {
@@ -584,21 +598,21 @@ FillSmbiosInfo(
 
     pDimmInfo->CapacityFromSmbios = CapacityFromSmbios;
 
-    TempReturnCode = GetSmbiosString((SMBIOS_STRUCTURE_POINTER *) &(DmiPhysicalDev.Type17),
+    TempReturnCode = GetSmbiosMemDevString(pMemDev,
       DmiPhysicalDev.Type17->DeviceLocator,
       pDimmInfo->DeviceLocator, sizeof(pDimmInfo->DeviceLocator));
     if (EFI_ERROR(TempReturnCode)) {
       StrnCpyS(pDimmInfo->DeviceLocator, DEVICE_LOCATOR_LEN, SMBIOS_STR_UNKNOWN, StrLen(SMBIOS_STR_UNKNOWN));
       NVDIMM_WARN("Failed to retrieve the device locator from SMBIOS table (" FORMAT_EFI_STATUS ")", ReturnCode);
     }
-    TempReturnCode = GetSmbiosString((SMBIOS_STRUCTURE_POINTER *) &(DmiPhysicalDev.Type17),
+    TempReturnCode = GetSmbiosMemDevString(pMemDev,
       DmiPhysicalDev.Type17->BankLocator,
       pDimmInfo->BankLabel, sizeof(pDimmInfo->BankLabel));
     if (EFI_ERROR(TempReturnCode)) {
       StrnCpyS(pDimmInfo->BankLabel, BANKLABEL_LEN, SMBIOS_STR_UNKNOWN, StrLen(SMBIOS_STR_UNKNOWN));
       NVDIMM_WARN("Failed to retrieve the bank locator from SMBIOS table (" FORMAT_EFI_STATUS ")", ReturnCode);
     }
-    TempReturnCode = GetSmbiosString((SMBIOS_STRUCTURE_POINTER *) &(DmiPhysicalDev.Type17),
+    TempReturnCode = GetSmbiosMemDevString(pMemDev,
       DmiPhysicalDev.Type17->Manufacturer,
       pDimmInfo->ManufacturerStr, sizeof(pDimmInfo->ManufacturerStr));
     if (EFI_ERROR(TempReturnCode)) {
@@ -613,41 +627,26 @@ FillSmbiosInfo(
 }
 
 /**
-  Init DIMM_INFO structure for given Initialized DIMM
+  Init the DIMM_INFO fields that come from the pDimm struct, ACPI and SMBIOS
+  tables, i.e. everything but the DIMM_INFO_CATEGORIES firmware calls.
+  Touches driver wide state, so it is not run concurrently.
 
   @param[in] pDimm DIMM that will be used to create DIMM_INFO
-  @param[in] dimmInfoCategories DIMM_INFO_CATEGORIES specifies which (if any)
-  additional FW api calls is desired. If DIMM_INFO_CATEGORY_NONE, then only
-  the properties from the pDimm struct will be populated.
   @param[in,out] pDimmInfo DIMM_INFO instance to fill in
 
   @retval EFI_SUCCESS Creation performed without errors
   @retval EFI_INVALID_PARAMETER If pDimm or pDimmMinInfo is NULL
-  @retval EFI_DEVICE_ERROR If communication with DIMM fails
 **/
+STATIC
 EFI_STATUS
-GetDimmInfo (
+GetDimmInfoBase (
   IN     DIMM *pDimm,
-  IN     DIMM_INFO_CATEGORIES dimmInfoCategories,
   IN OUT DIMM_INFO *pDimmInfo
   )
 {
   EFI_STATUS ReturnCode = EFI_SUCCESS;
-  PT_GET_SECURITY_PAYLOAD *pSecurityPayload = NULL;
-  PT_OUTPUT_PAYLOAD_GET_SECURITY_OPT_IN *pSecurityOptInPayload = NULL;
-  PT_PAYLOAD_GET_PACKAGE_SPARING_POLICY *pGetPackageSparingPayload = NULL;
   LIST_ENTRY *pNodeNamespace = NULL;
   NAMESPACE *pCurNamespace = NULL;
-  SMART_AND_HEALTH_INFO HealthInfo;
-  PT_OPTIONAL_DATA_POLICY_PAYLOAD OptionalDataPolicyPayload;
-  PT_VIRAL_POLICY_PAYLOAD ViralPolicyPayload;
-  PT_POWER_MANAGEMENT_POLICY_OUT *pPowerManagementPolicyPayload = NULL;
-  PT_DEVICE_CHARACTERISTICS_OUT *pDevCharacteristics = NULL;
-  PT_OUTPUT_PAYLOAD_MEMORY_INFO_PAGE3 *pPayloadMemInfoPage3 = NULL;
-  PT_OUTPUT_PAYLOAD_MEMORY_INFO_PAGE4 *pPayloadMemInfoPage4 = NULL;
-  PT_PAYLOAD_FW_IMAGE_INFO *pPayloadFwImage = NULL;
-  PT_OUTPUT_PAYLOAD_GET_EADR PayloadExtendedAdr;
-  PT_OUTPUT_PAYLOAD_GET_LATCH_SYSTEM_SHUTDOWN_STATE PayloadLatchSystemShutdownState;
   SMBIOS_STRUCTURE_POINTER DmiPhysicalDev;
   SMBIOS_STRUCTURE_POINTER DmiDeviceMappedAddr;
   SMBIOS_VERSION SmbiosVersion;
@@ -655,9 +654,6 @@ GetDimmInfo (
 
   NVDIMM_ENTRY();
 
-  ZeroMem(&HealthInfo, sizeof(HealthInfo));
-  ZeroMem(&OptionalDataPolicyPayload, sizeof(OptionalDataPolicyPayload));
-  ZeroMem(&ViralPolicyPayload, sizeof(ViralPolicyPayload));
   ZeroMem(&DmiPhysicalDev, sizeof(DmiPhysicalDev));
   ZeroMem(&DmiDeviceMappedAddr, sizeof(DmiDeviceMappedAddr));
   ZeroMem(&SmbiosVersion, sizeof(SmbiosVersion));
@@ -823,6 +819,184 @@ GetDimmInfo (
 
   AsciiStrToUnicodeStrS(pDimm->PartNumber, pDimmInfo->PartNumber, PART_NUMBER_LEN + 1);
 
+  // Data already in pDimm
+  pDimmInfo->Configured = pDimm->Configured;
+  ReturnCode = GetDcpmmCapacities(pDimm->DimmID, &pDimmInfo->Capacity, &pDimmInfo->VolatileCapacity,
+    &pDimmInfo->AppDirectCapacity, &pDimmInfo->UnconfiguredCapacity, &pDimmInfo->ReservedCapacity,
+    &pDimmInfo->InaccessibleCapacity);
+  if (EFI_ERROR(ReturnCode)) {
+    pDimmInfo->ErrorMask |= DIMM_INFO_ERROR_CAPACITY;
+  }
+
+  ReturnCode = EFI_SUCCESS;
+
+Finish:
+  NVDIMM_EXIT_I64(ReturnCode);
+  return ReturnCode;
+}
+
+/**
+  Get the SMART and health data of a DIMM, see GetSmartAndHealth(). Only
+  talks to pDimm, so it may run concurrently for different DIMMs.
+
+  @param[in]  pDimm The DIMM to query
+  @param[out] pHealthInfo - pointer to structure containing all Health and Smarth variables
+
+  @retval EFI_OUT_OF_RESOURCES memory allocation failure
+  @retval EFI_DEVICE_ERROR device error detected
+  @retval EFI_NOT_READY the specified DIMM is unmanageable
+  @retval EFI_SUCCESS Success
+**/
+STATIC
+EFI_STATUS
+GetDimmSmartAndHealth (
+  IN     DIMM *pDimm,
+     OUT SMART_AND_HEALTH_INFO *pHealthInfo
+  )
+{
+  EFI_STATUS ReturnCode = EFI_SUCCESS;
+  PT_PAYLOAD_SMART_AND_HEALTH *pPayloadSmartAndHealth = NULL;
+  PT_DEVICE_CHARACTERISTICS_OUT *pDevCharacteristics = NULL;
+
+  NVDIMM_ENTRY();
+
+  if (!IsDimmManageable(pDimm)) {
+    ReturnCode = EFI_NOT_READY;
+    goto Finish;
+  }
+
+  ReturnCode = FwCmdGetSmartAndHealth(pDimm, &pPayloadSmartAndHealth);
+  if (EFI_ERROR(ReturnCode)) {
+    goto Finish;
+  }
+
+  ReturnCode = FwCmdDeviceCharacteristics(pDimm, &pDevCharacteristics);
+  if (EFI_ERROR(ReturnCode) || pDevCharacteristics == NULL) {
+    goto Finish;
+  }
+
+  /** Get common data **/
+  pHealthInfo->PercentageRemainingValid = (BOOLEAN) pPayloadSmartAndHealth->ValidationFlags.Separated.PercentageRemaining;
+  pHealthInfo->MediaTemperatureValid = (BOOLEAN) pPayloadSmartAndHealth->ValidationFlags.Separated.MediaTemperature;
+  pHealthInfo->ControllerTemperatureValid = (BOOLEAN) pPayloadSmartAndHealth->ValidationFlags.Separated.ControllerTemperature;
+  pHealthInfo->MediaTemperature = TransformFwTempToRealValue(pPayloadSmartAndHealth->MediaTemperature);
+  pHealthInfo->HealthStatus = pPayloadSmartAndHealth->HealthStatus;
+  pHealthInfo->HealthStatusReason = (pPayloadSmartAndHealth->ValidationFlags.Separated.HealthStatusReason) ?
+         pPayloadSmartAndHealth->HealthStatusReason : (UINT16)HEALTH_STATUS_REASON_NONE;
+  pHealthInfo->PercentageRemaining = pPayloadSmartAndHealth->PercentageRemaining;
+  pHealthInfo->LatchedLastShutdownStatus = pPayloadSmartAndHealth->LatchedLastShutdownStatus;
+  /** Get Vendor specific data **/
+  pHealthInfo->ControllerTemperature = TransformFwTempToRealValue(pPayloadSmartAndHealth->ControllerTemperature);
+  pHealthInfo->UpTime = (UINT32)pPayloadSmartAndHealth->VendorSpecificData.UpTime;
+  pHealthInfo->PowerCycles = pPayloadSmartAndHealth->VendorSpecificData.PowerCycles;
+  pHealthInfo->PowerOnTime = (UINT32)pPayloadSmartAndHealth->VendorSpecificData.PowerOnTime;
+  pHealthInfo->LatchedDirtyShutdownCount = pPayloadSmartAndHealth->LatchedDirtyShutdownCount;
+  pHealthInfo->UnlatchedDirtyShutdownCount = pPayloadSmartAndHealth->VendorSpecificData.UnlatchedDirtyShutdownCount;
+  pHealthInfo->MaxMediaTemperature = TransformFwTempToRealValue(pPayloadSmartAndHealth->VendorSpecificData.MaxMediaTemperature);
+  pHealthInfo->MaxControllerTemperature = TransformFwTempToRealValue(pPayloadSmartAndHealth->VendorSpecificData.MaxControllerTemperature);
+
+  /** Get Device Characteristics data **/
+  pHealthInfo->ContrTempShutdownThresh =
+      TransformFwTempToRealValue(pDevCharacteristics->Payload.Fis_2_00.ControllerShutdownThreshold);
+  pHealthInfo->ControllerThrottlingStartThresh =
+      TransformFwTempToRealValue(pDevCharacteristics->Payload.Fis_2_00.ControllerThrottlingStartThreshold);
+  pHealthInfo->ControllerThrottlingStopThresh =
+      TransformFwTempToRealValue(pDevCharacteristics->Payload.Fis_2_00.ControllerThrottlingStopThreshold);
+  pHealthInfo->MediaTempShutdownThresh =
+      TransformFwTempToRealValue(pDevCharacteristics->Payload.Fis_2_00.MediaShutdownThreshold);
+  pHealthInfo->MediaThrottlingStartThresh =
+      TransformFwTempToRealValue(pDevCharacteristics->Payload.Fis_2_00.MediaThrottlingStartThreshold);
+  pHealthInfo->MediaThrottlingStopThresh =
+      TransformFwTempToRealValue(pDevCharacteristics->Payload.Fis_2_00.MediaThrottlingStopThreshold);
+
+  /** Check triggered alarms **/
+  pHealthInfo->MediaTemperatureTrip = (pPayloadSmartAndHealth->AlarmTrips.Separated.MediaTemperature != 0);
+  pHealthInfo->ControllerTemperatureTrip = (pPayloadSmartAndHealth->AlarmTrips.Separated.ControllerTemperature != 0);
+  pHealthInfo->PercentageRemainingTrip = (pPayloadSmartAndHealth->AlarmTrips.Separated.PercentageRemaining != 0);
+
+  /** Copy extended detail bits **/
+  CopyMem_S(&pHealthInfo->LatchedLastShutdownStatusDetails, sizeof(LAST_SHUTDOWN_STATUS_DETAILS_EXTENDED), pPayloadSmartAndHealth->VendorSpecificData.LatchedLastShutdownExtendedDetails.Raw, sizeof(LAST_SHUTDOWN_STATUS_DETAILS_EXTENDED));
+  /** Shift extended over, add the original 8 bits **/
+  pHealthInfo->LatchedLastShutdownStatusDetails = (pHealthInfo->LatchedLastShutdownStatusDetails << sizeof(LAST_SHUTDOWN_STATUS_DETAILS) * 8)
+    + pPayloadSmartAndHealth->VendorSpecificData.LatchedLastShutdownDetails.AllFlags;
+
+  /** Copy extended detail bits **/
+  CopyMem_S(&pHealthInfo->UnlatchedLastShutdownStatusDetails, sizeof(LAST_SHUTDOWN_STATUS_DETAILS_EXTENDED), pPayloadSmartAndHealth->VendorSpecificData.UnlatchedLastShutdownExtendedDetails.Raw, sizeof(LAST_SHUTDOWN_STATUS_DETAILS_EXTENDED));
+  /** Shift extended over, add the original 8 bits **/
+  pHealthInfo->UnlatchedLastShutdownStatusDetails = (pHealthInfo->UnlatchedLastShutdownStatusDetails << sizeof(LAST_SHUTDOWN_STATUS_DETAILS) * 8)
+    + pPayloadSmartAndHealth->VendorSpecificData.UnlatchedLastShutdownDetails.AllFlags;
+
+  pHealthInfo->LastShutdownTime = pPayloadSmartAndHealth->VendorSpecificData.LastShutdownTime;
+
+  pHealthInfo->AitDramEnabled = pPayloadSmartAndHealth->AITDRAMStatus;
+
+  if ((pPayloadSmartAndHealth->ValidationFlags.Separated.AITDRAMStatus == 0) &&
+    (pPayloadSmartAndHealth->HealthStatus < HealthStatusCritical)) {
+    pHealthInfo->AitDramEnabled = AIT_DRAM_ENABLED;
+  }
+
+  pHealthInfo->ThermalThrottlePerformanceLossPrct = pPayloadSmartAndHealth->VendorSpecificData.ThermalThrottlePerformanceLossPercent;
+
+  ReturnCode = FwCmdGetErrorCount(pDimm, &pHealthInfo->MediaErrorCount, &pHealthInfo->ThermalErrorCount);
+  if (EFI_ERROR(ReturnCode)) {
+    goto Finish;
+  }
+
+Finish:
+  FREE_POOL_SAFE(pDevCharacteristics);
+  FREE_POOL_SAFE(pPayloadSmartAndHealth);
+  NVDIMM_EXIT_I64(ReturnCode);
+  return ReturnCode;
+}
+
+/**
+  Init the DIMM_INFO fields that need the firmware calls selected by
+  dimmInfoCategories. Only talks to pDimm, so it may run concurrently
+  for different DIMMs.
+
+  @param[in] pDimm DIMM that will be used to create DIMM_INFO
+  @param[in] dimmInfoCategories DIMM_INFO_CATEGORIES specifies which (if any)
+  additional FW api calls is desired.
+  @param[in,out] pDimmInfo DIMM_INFO instance to fill in
+
+  @retval EFI_SUCCESS Creation performed without errors
+  @retval EFI_INVALID_PARAMETER If pDimm or pDimmMinInfo is NULL
+  @retval EFI_OUT_OF_RESOURCES Memory allocation failure
+**/
+STATIC
+EFI_STATUS
+GetDimmInfoCategories (
+  IN     DIMM *pDimm,
+  IN     DIMM_INFO_CATEGORIES dimmInfoCategories,
+  IN OUT DIMM_INFO *pDimmInfo
+  )
+{
+  EFI_STATUS ReturnCode = EFI_SUCCESS;
+  PT_GET_SECURITY_PAYLOAD *pSecurityPayload = NULL;
+  PT_OUTPUT_PAYLOAD_GET_SECURITY_OPT_IN *pSecurityOptInPayload = NULL;
+  PT_PAYLOAD_GET_PACKAGE_SPARING_POLICY *pGetPackageSparingPayload = NULL;
+  SMART_AND_HEALTH_INFO HealthInfo;
+  PT_OPTIONAL_DATA_POLICY_PAYLOAD OptionalDataPolicyPayload;
+  PT_VIRAL_POLICY_PAYLOAD ViralPolicyPayload;
+  PT_POWER_MANAGEMENT_POLICY_OUT *pPowerManagementPolicyPayload = NULL;
+  PT_DEVICE_CHARACTERISTICS_OUT *pDevCharacteristics = NULL;
+  PT_OUTPUT_PAYLOAD_MEMORY_INFO_PAGE3 *pPayloadMemInfoPage3 = NULL;
+  PT_OUTPUT_PAYLOAD_MEMORY_INFO_PAGE4 *pPayloadMemInfoPage4 = NULL;
+  PT_PAYLOAD_FW_IMAGE_INFO *pPayloadFwImage = NULL;
+  PT_OUTPUT_PAYLOAD_GET_EADR PayloadExtendedAdr;
+  PT_OUTPUT_PAYLOAD_GET_LATCH_SYSTEM_SHUTDOWN_STATE PayloadLatchSystemShutdownState;
+
+  NVDIMM_ENTRY();
+
+  ZeroMem(&HealthInfo, sizeof(HealthInfo));
+  ZeroMem(&OptionalDataPolicyPayload, sizeof(OptionalDataPolicyPayload));
+  ZeroMem(&ViralPolicyPayload, sizeof(ViralPolicyPayload));
+
+  if (pDimm == NULL || pDimmInfo == NULL) {
+    ReturnCode = EFI_INVALID_PARAMETER;
+    goto Finish;
+  }
+
   if (dimmInfoCategories & DIMM_INFO_CATEGORY_SECURITY)
   {
     /* Security opt-in */
@@ -930,7 +1104,7 @@ GetDimmInfo (
   if (dimmInfoCategories & DIMM_INFO_CATEGORY_SMART_AND_HEALTH)
   {
     /* Get current health state */
-    ReturnCode = GetSmartAndHealth(&gNvmDimmDriverNvmDimmConfig,pDimm->DimmID, &HealthInfo);
+    ReturnCode = GetDimmSmartAndHealth(pDimm, &HealthInfo);
     if (EFI_ERROR(ReturnCode)) {
       pDimmInfo->ErrorMask |= DIMM_INFO_ERROR_SMART_AND_HEALTH;
     }
@@ -1116,15 +1290,6 @@ GetDimmInfo (
     }
   }
 
-  // Data already in pDimm
-  pDimmInfo->Configured = pDimm->Configured;
-  ReturnCode = GetDcpmmCapacities(pDimm->DimmID, &pDimmInfo->Capacity, &pDimmInfo->VolatileCapacity,
-    &pDimmInfo->AppDirectCapacity, &pDimmInfo->UnconfiguredCapacity, &pDimmInfo->ReservedCapacity,
-    &pDimmInfo->InaccessibleCapacity);
-  if (EFI_ERROR(ReturnCode)) {
-    pDimmInfo->ErrorMask |= DIMM_INFO_ERROR_CAPACITY;
-  }
-
   if (dimmInfoCategories & DIMM_INFO_CATEGORY_FW_IMAGE_INFO)
   {
     ReturnCode = FwCmdGetFirmwareImageInfo(pDimm, &pPayloadFwImage);
@@ -1214,6 +1379,38 @@ Finish:
   return ReturnCode;
 }
 
+/**
+  Init DIMM_INFO structure for given Initialized DIMM
+
+  @param[in] pDimm DIMM that will be used to create DIMM_INFO
+  @param[in] dimmInfoCategories DIMM_INFO_CATEGORIES specifies which (if any)
+  additional FW api calls is desired. If DIMM_INFO_CATEGORY_NONE, then only
+  the properties from the pDimm struct will be populated.
+  @param[in,out] pDimmInfo DIMM_INFO instance to fill in
+
+  @retval EFI_SUCCESS Creation performed without errors
+  @retval EFI_INVALID_PARAMETER If pDimm or pDimmMinInfo is NULL
+  @retval EFI_DEVICE_ERROR If communication with DIMM fails
+**/
+EFI_STATUS
+GetDimmInfo (
+  IN     DIMM *pDimm,
+  IN     DIMM_INFO_CATEGORIES dimmInfoCategories,
+  IN OUT DIMM_INFO *pDimmInfo
+  )
+{
+  EFI_STATUS ReturnCode = EFI_SUCCESS;
+
+  NVDIMM_ENTRY();
+
+  CHECK_RESULT(GetDimmInfoBase(pDimm, pDimmInfo), Finish);
+  CHECK_RESULT(GetDimmInfoCategories(pDimm, dimmInfoCategories, pDimmInfo), Finish);
+
+Finish:
+  NVDIMM_EXIT_I64(ReturnCode);
+  return ReturnCode;
+}
+
 /**
   Check if there is at least one DIMM on specified socket
 
@@ -1705,6 +1902,37 @@ Finish:
   return ReturnCode;
 }
 
+/**
+  Work shared by the GetDimms() category jobs. A NULL DIMM means the
+  DIMM_INFO at that index couldn't be initialized and is skipped.
+**/
+typedef struct _DIMM_INFO_BATCH_CTX {
+  DIMM **ppDimms;
+  DIMM_INFO *pDimmInfos;
+  DIMM_INFO_CATEGORIES Categories;
+} DIMM_INFO_BATCH_CTX;
+
+/**
+  RunDimmJobs() callback running the category firmware calls of one DIMM
+
+  @param[in] JobIndex: Index of the DIMM in the batch
+  @param[in] pCtx: The DIMM_INFO_BATCH_CTX
+**/
+STATIC
+VOID
+GetDimmInfoCategoriesJob(
+  IN     UINT32 JobIndex,
+  IN     VOID *pCtx
+  )
+{
+  DIMM_INFO_BATCH_CTX *pBatchCtx = (DIMM_INFO_BATCH_CTX *)pCtx;
+
+  if (pBatchCtx->ppDimms[JobIndex] == NULL) {
+    return;
+  }
+  GetDimmInfoCategories(pBatchCtx->ppDimms[JobIndex], pBatchCtx->Categories, &pBatchCtx->pDimmInfos[JobIndex]);
+}
+
 /**
   Retrieve the list of functional DCPMMs found in NFIT
 
@@ -1732,9 +1960,12 @@ GetDimms(
   UINT32 Index = 0;
   LIST_ENTRY *pNode = NULL;
   DIMM *pCurDimm = NULL;
+  DIMM_INFO_BATCH_CTX BatchCtx;
 
   NVDIMM_ENTRY();
 
+  ZeroMem(&BatchCtx, sizeof(BatchCtx));
+
   /* check input parameters */
   if (pThis == NULL || pDimms == NULL) {
     NVDIMM_DBG("pDimms is NULL");
@@ -1753,6 +1984,11 @@ GetDimms(
 
   SetMem(pDimms, sizeof(*pDimms) * DimmCount, 0); // this clears error mask as well
 
+  CHECK_RESULT_MALLOC(BatchCtx.ppDimms, AllocateZeroPool(sizeof(*BatchCtx.ppDimms) * MAX(DimmCount, 1)), Finish);
+  BatchCtx.pDimmInfos = pDimms;
+  BatchCtx.Categories = dimmInfoCategories;
+
+  // The table, SMBIOS and PCD backed fields first, one DIMM at a time
   Index = 0;
   LIST_FOR_EACH(pNode, &gNvmDimmData->PMEMDev.Dimms) {
     pCurDimm = DIMM_FROM_NODE(pNode);
@@ -1766,11 +2002,19 @@ GetDimms(
       goto Finish;
     }
 
-    GetDimmInfo(pCurDimm, dimmInfoCategories, &pDimms[Index]);
+    if (!EFI_ERROR(GetDimmInfoBase(pCurDimm, &pDimms[Index]))) {
+      BatchCtx.ppDimms[Index] = pCurDimm;
+    }
     Index++;
   }
 
+  // Then the firmware calls of the requested categories, all DIMMs at once
+  if (dimmInfoCategories != DIMM_INFO_CATEGORY_NONE) {
+    RunDimmJobs(Index, GetDimmInfoCategoriesJob, &BatchCtx);
+  }
+
 Finish:
+  FREE_POOL_SAFE(BatchCtx.ppDimms);
   NVDIMM_EXIT_I64(ReturnCode);
   return ReturnCode;
 }
@@ -2715,8 +2959,6 @@ GetSmartAndHealth (
   EFI_STATUS ReturnCode = EFI_SUCCESS;
 
   DIMM *pDimm = NULL;
-  PT_PAYLOAD_SMART_AND_HEALTH *pPayloadSmartAndHealth = NULL;
-  PT_DEVICE_CHARACTERISTICS_OUT *pDevCharacteristics = NULL;
 
   NVDIMM_ENTRY();
 
@@ -2726,91 +2968,9 @@ GetSmartAndHealth (
     goto Finish;
   }
 
-  if (!IsDimmManageable(pDimm)) {
-    ReturnCode = EFI_NOT_READY;
-    goto Finish;
-  }
-
-  ReturnCode = FwCmdGetSmartAndHealth(pDimm, &pPayloadSmartAndHealth);
-  if (EFI_ERROR(ReturnCode)) {
-    goto Finish;
-  }
-
-  ReturnCode = FwCmdDeviceCharacteristics(pDimm, &pDevCharacteristics);
-  if (EFI_ERROR(ReturnCode) || pDevCharacteristics == NULL) {
-    goto Finish;
-  }
-
-  /** Get common data **/
-  pHealthInfo->PercentageRemainingValid = (BOOLEAN) pPayloadSmartAndHealth->ValidationFlags.Separated.PercentageRemaining;
-  pHealthInfo->MediaTemperatureValid = (BOOLEAN) pPayloadSmartAndHealth->ValidationFlags.Separated.MediaTemperature;
-  pHealthInfo->ControllerTemperatureValid = (BOOLEAN) pPayloadSmartAndHealth->ValidationFlags.Separated.ControllerTemperature;
-  pHealthInfo->MediaTemperature = TransformFwTempToRealValue(pPayloadSmartAndHealth->MediaTemperature);
-  pHealthInfo->HealthStatus = pPayloadSmartAndHealth->HealthStatus;
-  pHealthInfo->HealthStatusReason = (pPayloadSmartAndHealth->ValidationFlags.Separated.HealthStatusReason) ?
-         pPayloadSmartAndHealth->HealthStatusReason : (UINT16)HEALTH_STATUS_REASON_NONE;
-  pHealthInfo->PercentageRemaining = pPayloadSmartAndHealth->PercentageRemaining;
-  pHealthInfo->LatchedLastShutdownStatus = pPayloadSmartAndHealth->LatchedLastShutdownStatus;
-  /** Get Vendor specific data **/
-  pHealthInfo->ControllerTemperature = TransformFwTempToRealValue(pPayloadSmartAndHealth->ControllerTemperature);
-  pHealthInfo->UpTime = (UINT32)pPayloadSmartAndHealth->VendorSpecificData.UpTime;
-  pHealthInfo->PowerCycles = pPayloadSmartAndHealth->VendorSpecificData.PowerCycles;
-  pHealthInfo->PowerOnTime = (UINT32)pPayloadSmartAndHealth->VendorSpecificData.PowerOnTime;
-  pHealthInfo->LatchedDirtyShutdownCount = pPayloadSmartAndHealth->LatchedDirtyShutdownCount;
-  pHealthInfo->UnlatchedDirtyShutdownCount = pPayloadSmartAndHealth->VendorSpecificData.UnlatchedDirtyShutdownCount;
-  pHealthInfo->MaxMediaTemperature = TransformFwTempToRealValue(pPayloadSmartAndHealth->VendorSpecificData.MaxMediaTemperature);
-  pHealthInfo->MaxControllerTemperature = TransformFwTempToRealValue(pPayloadSmartAndHealth->VendorSpecificData.MaxControllerTemperature);
-
-  /** Get Device Characteristics data **/
-  pHealthInfo->ContrTempShutdownThresh =
-      TransformFwTempToRealValue(pDevCharacteristics->Payload.Fis_2_00.ControllerShutdownThreshold);
-  pHealthInfo->ControllerThrottlingStartThresh =
-      TransformFwTempToRealValue(pDevCharacteristics->Payload.Fis_2_00.ControllerThrottlingStartThreshold);
-  pHealthInfo->ControllerThrottlingStopThresh =
-      TransformFwTempToRealValue(pDevCharacteristics->Payload.Fis_2_00.ControllerThrottlingStopThreshold);
-  pHealthInfo->MediaTempShutdownThresh =
-      TransformFwTempToRealValue(pDevCharacteristics->Payload.Fis_2_00.MediaShutdownThreshold);
-  pHealthInfo->MediaThrottlingStartThresh =
-      TransformFwTempToRealValue(pDevCharacteristics->Payload.Fis_2_00.MediaThrottlingStartThreshold);
-  pHealthInfo->MediaThrottlingStopThresh =
-      TransformFwTempToRealValue(pDevCharacteristics->Payload.Fis_2_00.MediaThrottlingStopThreshold);
-
-  /** Check triggered alarms **/
-  pHealthInfo->MediaTemperatureTrip = (pPayloadSmartAndHealth->AlarmTrips.Separated.MediaTemperature != 0);
-  pHealthInfo->ControllerTemperatureTrip = (pPayloadSmartAndHealth->AlarmTrips.Separated.ControllerTemperature != 0);
-  pHealthInfo->PercentageRemainingTrip = (pPayloadSmartAndHealth->AlarmTrips.Separated.PercentageRemaining != 0);
-
-  /** Copy extended detail bits **/
-  CopyMem_S(&pHealthInfo->LatchedLastShutdownStatusDetails, sizeof(LAST_SHUTDOWN_STATUS_DETAILS_EXTENDED), pPayloadSmartAndHealth->VendorSpecificData.LatchedLastShutdownExtendedDetails.Raw, sizeof(LAST_SHUTDOWN_STATUS_DETAILS_EXTENDED));
-  /** Shift extended over, add the original 8 bits **/
-  pHealthInfo->LatchedLastShutdownStatusDetails = (pHealthInfo->LatchedLastShutdownStatusDetails << sizeof(LAST_SHUTDOWN_STATUS_DETAILS) * 8)
-    + pPayloadSmartAndHealth->VendorSpecificData.LatchedLastShutdownDetails.AllFlags;
-
-  /** Copy extended detail bits **/
-  CopyMem_S(&pHealthInfo->UnlatchedLastShutdownStatusDetails, sizeof(LAST_SHUTDOWN_STATUS_DETAILS_EXTENDED), pPayloadSmartAndHealth->VendorSpecificData.UnlatchedLastShutdownExtendedDetails.Raw, sizeof(LAST_SHUTDOWN_STATUS_DETAILS_EXTENDED));
-  /** Shift extended over, add the original 8 bits **/
-  pHealthInfo->UnlatchedLastShutdownStatusDetails = (pHealthInfo->UnlatchedLastShutdownStatusDetails << sizeof(LAST_SHUTDOWN_STATUS_DETAILS) * 8)
-    + pPayloadSmartAndHealth->VendorSpecificData.UnlatchedLastShutdownDetails.AllFlags;
-
-  pHealthInfo->LastShutdownTime = pPayloadSmartAndHealth->VendorSpecificData.LastShutdownTime;
-
-  pHealthInfo->AitDramEnabled = pPayloadSmartAndHealth->AITDRAMStatus;
-
-  if ((pPayloadSmartAndHealth->ValidationFlags.Separated.AITDRAMStatus == 0) &&
-    (pPayloadSmartAndHealth->HealthStatus < HealthStatusCritical)) {
-    pHealthInfo->AitDramEnabled = AIT_DRAM_ENABLED;
-  }
-
-  pHealthInfo->ThermalThrottlePerformanceLossPrct = pPayloadSmartAndHealth->VendorSpecificData.ThermalThrottlePerformanceLossPercent;
-
-  ReturnCode = FwCmdGetErrorCount(pDimm, &pHealthInfo->MediaErrorCount, &pHealthInfo->ThermalErrorCount);
-  if (EFI_ERROR(ReturnCode)) {
-    goto Finish;
-  }
+  ReturnCode = GetDimmSmartAndHealth(pDimm, pHealthInfo);
 
 Finish:
-  FREE_POOL_SAFE(pDevCharacteristics);
-  FREE_POOL_SAFE(pPayloadSmartAndHealth);
   NVDIMM_EXIT_I64(ReturnCode);
 
   return ReturnCode;
@@ -5256,54 +5416,292 @@ RecoverDimmFw(
     }
   }
 
-  // Copy original fconfig or generated fconfig to the new image
-  pFconfigRegionNewSpiImageBuffer = ((UINT8 *)pNewSpiImageBuffer +
-      pSpiDirectoryNewSpiImageBuffer->FconfigDataOffset);
-  CopyMem((VOID *)pFconfigRegionNewSpiImageBuffer, (VOID *)pFconfigRegionTemp,
-          sizeof(FconfigContainerHeader) + ((FconfigContainerHeader *)pFconfigRegionTemp)->DwordLen * sizeof(UINT32));
+  // Copy original fconfig or generated fconfig to the new image
+  pFconfigRegionNewSpiImageBuffer = ((UINT8 *)pNewSpiImageBuffer +
+      pSpiDirectoryNewSpiImageBuffer->FconfigDataOffset);
+  CopyMem((VOID *)pFconfigRegionNewSpiImageBuffer, (VOID *)pFconfigRegionTemp,
+          sizeof(FconfigContainerHeader) + ((FconfigContainerHeader *)pFconfigRegionTemp)->DwordLen * sizeof(UINT32));
+
+  // Copy migration data from the existing dimm spi image, if applicable
+  CHECK_RESULT(ReadAndCopyMigrationData(pCurrentDimm, &SpiDirectoryTarget,
+               pSpiDirectoryNewSpiImageBuffer), Finish);
+
+  ////////////////////////////////////////////////////
+  // Write out the new image to a file in order to recover the
+  // dimm back to a good state after testing.
+  // TODO: Needed for validation only! We do not need this after product PRQ and will
+  // probably confuse people
+  DebugWriteSpiImageToFile(pWorkingDirectory, pCurrentDimm->DeviceHandle.AsUint32, pNewSpiImageBuffer, ImageBufferSize);
+  ///////////////////////////////////////////////////
+
+  CHECK_RESULT_SET_NVM_STATUS(SpiEraseChip(pCurrentDimm), pNvmStatus, NVM_ERR_SPI_ACCESS_NOT_ENABLED, Finish);
+
+  // Only using pCommandStatus for providing progress. Setting more detailed
+  // error codes out here
+  ReturnCode = SpiWrite(pCurrentDimm, pNewSpiImageBuffer, (UINT32)ImageBufferSize,
+      SPI_START_ADDRESS, FALSE, pCommandStatus);
+  if (EFI_SUCCESS == ReturnCode) {
+    *pNvmStatus = NVM_SUCCESS_FW_RESET_REQUIRED;
+  } else if (ReturnCode == EFI_INVALID_PARAMETER) {
+    *pNvmStatus = NVM_ERR_INVALID_PARAMETER;
+  } else {
+    // pNvmStatus isn't currently an argument to SpiWrite, so just use a
+    // default error here
+    *pNvmStatus = NVM_ERR_OPERATION_FAILED;
+  }
+
+Finish:
+  FREE_POOL_SAFE(pFconfigRegionTemp);
+  // If ReturnCode isn't already set with an error, use the NvmStatus error
+  if (EFI_SUCCESS == ReturnCode) {
+    MatchCliReturnCode(*pNvmStatus);
+  }
+  NVDIMM_EXIT_I64(ReturnCode);
+  #endif
+  return ReturnCode;
+}
+
+/**
+  Per-DIMM work item of a firmware update
+**/
+typedef struct _FW_UPDATE_JOB {
+  DIMM *pDimm;
+  EFI_STATUS ReturnCode;
+  NVM_STATUS NvmStatus;
+  COMMAND_STATUS *pCommandStatus;   ///< Progress of this DIMM, merged once all jobs are done
+} FW_UPDATE_JOB;
+
+/**
+  Work shared by the firmware update jobs, the image is read and verified
+  once and sent to every DIMM from the same buffer
+**/
+typedef struct _FW_UPDATE_CTX {
+  FW_UPDATE_JOB *pJobs;
+  CONST VOID *pImageBuffer;
+  UINTN ImageBufferSize;
+  CHAR16 *pWorkingDirectory;
+  BOOLEAN RecoverSpi;
+} FW_UPDATE_CTX;
+
+/**
+  Time stamp used to measure the firmware update steps
+
+  @retval Milliseconds since an arbitrary point, 0 when no timer is available
+**/
+STATIC
+UINT64
+GetFwUpdateTimeMs(
+  )
+{
+#ifdef OS_BUILD
+  return os_get_monotonic_ms();
+#else
+  return 0;
+#endif
+}
+
+/**
+  Record the final step of the firmware update of a DIMM
+
+  @param[in] pDimm DIMM being updated
+  @param[in] State FwUpdateStateStaged or FwUpdateStateFailed
+  @param[in] NvmStatus Outcome of the update
+**/
+STATIC
+VOID
+SetFwUpdateResult(
+  IN     DIMM *pDimm,
+  IN     FW_UPDATE_STATE State,
+  IN     NVM_STATUS NvmStatus
+  )
+{
+  pDimm->FwUpdateStatus.NvmStatus = NvmStatus;
+  pDimm->FwUpdateStatus.State = (UINT8)State;
+}
+
+/**
+  Check whether the DIMM reports a staged firmware image
+
+  @param[in] pDimm DIMM to check
+
+  @retval TRUE if a staged image version is reported
+**/
+STATIC
+BOOLEAN
+IsFwImageStaged(
+  IN     DIMM *pDimm
+  )
+{
+  PT_PAYLOAD_FW_IMAGE_INFO *pPayloadFwImage = NULL;
+  FIRMWARE_VERSION StagedFwVersion;
+  BOOLEAN Staged = FALSE;
+
+  if (!EFI_ERROR(FwCmdGetFirmwareImageInfo(pDimm, &pPayloadFwImage)) && pPayloadFwImage != NULL) {
+    StagedFwVersion = ParseFwVersion(pPayloadFwImage->StagedFwRevision);
+    Staged = !FW_VERSION_UNDEFINED(StagedFwVersion);
+  }
+  FREE_POOL_SAFE(pPayloadFwImage);
+  return Staged;
+}
+
+/**
+  Add the object statuses a firmware update job collected on its own to
+  the command status of the update
+
+  @param[in,out] pCommandStatus Command status of the update
+  @param[in] pJobStatus Command status of the job
+**/
+STATIC
+VOID
+MergeFwUpdateJobStatus(
+  IN OUT COMMAND_STATUS *pCommandStatus,
+  IN     COMMAND_STATUS *pJobStatus
+  )
+{
+  LIST_ENTRY *pNode = NULL;
+  OBJECT_STATUS *pJobObjectStatus = NULL;
+  OBJECT_STATUS *pObjectStatus = NULL;
+  UINT32 Index = 0;
+
+  if (pCommandStatus == NULL || pJobStatus == NULL) {
+    return;
+  }
+
+  LIST_FOR_EACH(pNode, &pJobStatus->ObjectStatusList) {
+    pJobObjectStatus = OBJECT_STATUS_FROM_NODE(pNode);
+    pObjectStatus = GetObjectStatus(pCommandStatus, pJobObjectStatus->ObjectId);
+    if (pObjectStatus == NULL) {
+      // The update sets the object status of every DIMM it sends the image to
+      continue;
+    }
+    for (Index = 0; Index < sizeof(pObjectStatus->StatusBitField.BitField) / sizeof(pObjectStatus->StatusBitField.BitField[0]); Index++) {
+      pObjectStatus->StatusBitField.BitField[Index] |= pJobObjectStatus->StatusBitField.BitField[Index];
+    }
+    pObjectStatus->Progress = pJobObjectStatus->Progress;
+  }
+}
+
+/**
+  RunDimmJobs() callback sending the image to one DIMM. A DIMM kept busy by
+  ARS gets ARS cancelled and the packet resent on its own, without holding
+  up the transfer to the other DIMMs.
+
+  DIMMs that already had an image staged were left out by UpdateFw(), so
+  the staged image seen afterwards is always the one sent here.
+
+  @param[in] JobIndex: Index of the FW_UPDATE_JOB to run
+  @param[in] pCtx: The FW_UPDATE_CTX
+**/
+STATIC
+VOID
+FwUpdateTransferJob(
+  IN     UINT32 JobIndex,
+  IN     VOID *pCtx
+  )
+{
+  FW_UPDATE_CTX *pUpdateCtx = (FW_UPDATE_CTX *)pCtx;
+  FW_UPDATE_JOB *pJob = &pUpdateCtx->pJobs[JobIndex];
+  DIMM *pDimm = pJob->pDimm;
+  EFI_STATUS LongOpStatusReturnCode = EFI_SUCCESS;
+  NVM_STATUS LongOpNvmStatus = NVM_ERR_OPERATION_NOT_STARTED;
+  UINT64 StartMs = 0;
+
+  pDimm->FwUpdateStatus.State = FwUpdateStateTransfer;
+  StartMs = GetFwUpdateTimeMs();
+
+  if (pUpdateCtx->RecoverSpi) {
+    pJob->ReturnCode = RecoverDimmFw(pDimm->DeviceHandle.AsUint32, pUpdateCtx->pImageBuffer, pUpdateCtx->ImageBufferSize,
+      pUpdateCtx->pWorkingDirectory, &pJob->NvmStatus, pJob->pCommandStatus);
+    if (EFI_ERROR(pJob->ReturnCode)) {
+      NVDIMM_ERR("RecoverDimmFw returned: " FORMAT_EFI_STATUS ".\n", pJob->ReturnCode);
+    }
+  } else {
+    pJob->ReturnCode = FwCmdUpdateFw(pDimm, pUpdateCtx->pImageBuffer, pUpdateCtx->ImageBufferSize, &pJob->NvmStatus,
+      pJob->pCommandStatus);
+  }
+
+  pDimm->FwUpdateTransferEndMs = GetFwUpdateTimeMs();
+  pDimm->FwUpdateStatus.TransferTimeMs = pDimm->FwUpdateTransferEndMs - StartMs;
+
+  if (!EFI_ERROR(pJob->ReturnCode)) {
+    // The recovery image is written straight to the SPI flash, nothing to stage.
+    // Otherwise the firmware now authenticates and stages the image on its own,
+    // GetFwUpdateStatus() reports when it is done.
+    SetFwUpdateResult(pDimm, pUpdateCtx->RecoverSpi ? FwUpdateStateStaged : FwUpdateStateVerify, pJob->NvmStatus);
+    return;
+  }
+
+  //Perform a check to see if it was a long operation that blocked the update and get more details about it
+  LongOpStatusReturnCode = CheckForLongOpStatusInProgress(pDimm, &LongOpNvmStatus);
+  if (LongOpStatusReturnCode == EFI_SUCCESS && LongOpNvmStatus != NVM_SUCCESS) {
+    pJob->NvmStatus = LongOpNvmStatus;
+  } else if (pJob->NvmStatus == NVM_SUCCESS) {
+    pJob->NvmStatus = NVM_ERR_OPERATION_FAILED;
+  }
+  SetFwUpdateResult(pDimm, FwUpdateStateFailed, pJob->NvmStatus);
+}
 
-  // Copy migration data from the existing dimm spi image, if applicable
-  CHECK_RESULT(ReadAndCopyMigrationData(pCurrentDimm, &SpiDirectoryTarget,
-               pSpiDirectoryNewSpiImageBuffer), Finish);
+/**
+  Move a DIMM whose firmware is authenticating and staging the image it was
+  sent to FwUpdateStateStaged once the staged image is reported, or to
+  FwUpdateStateFailed once the long operation reports an error. Only checks
+  the DIMM once, waiting for it is up to the caller.
 
-  ////////////////////////////////////////////////////
-  // Write out the new image to a file in order to recover the
-  // dimm back to a good state after testing.
-  // TODO: Needed for validation only! We do not need this after product PRQ and will
-  // probably confuse people
-  DebugWriteSpiImageToFile(pWorkingDirectory, pCurrentDimm->DeviceHandle.AsUint32, pNewSpiImageBuffer, ImageBufferSize);
-  ///////////////////////////////////////////////////
+  @param[in] pDimm DIMM in FwUpdateStateVerify
+**/
+STATIC
+VOID
+RefreshFwUpdateStage(
+  IN     DIMM *pDimm
+  )
+{
+  PT_OUTPUT_PAYLOAD_FW_LONG_OP_STATUS LongOpStatus;
+  EFI_STATUS LongOpEfiStatus = EFI_SUCCESS;
+  NVM_STATUS NvmStatus = NVM_SUCCESS;
+  UINT8 FwStatus = FW_SUCCESS;
 
-  CHECK_RESULT_SET_NVM_STATUS(SpiEraseChip(pCurrentDimm), pNvmStatus, NVM_ERR_SPI_ACCESS_NOT_ENABLED, Finish);
+  if (IsFwImageStaged(pDimm)) {
+    pDimm->FwUpdateStatus.StageTimeMs = GetFwUpdateTimeMs() - pDimm->FwUpdateTransferEndMs;
+    SetFwUpdateResult(pDimm, FwUpdateStateStaged, pDimm->FwUpdateStatus.NvmStatus);
+    return;
+  }
 
-  // Only using pCommandStatus for providing progress. Setting more detailed
-  // error codes out here
-  ReturnCode = SpiWrite(pCurrentDimm, pNewSpiImageBuffer, (UINT32)ImageBufferSize,
-      SPI_START_ADDRESS, FALSE, pCommandStatus);
-  if (EFI_SUCCESS == ReturnCode) {
-    *pNvmStatus = NVM_SUCCESS_FW_RESET_REQUIRED;
-  } else if (ReturnCode == EFI_INVALID_PARAMETER) {
-    *pNvmStatus = NVM_ERR_INVALID_PARAMETER;
-  } else {
-    // pNvmStatus isn't currently an argument to SpiWrite, so just use a
-    // default error here
-    *pNvmStatus = NVM_ERR_OPERATION_FAILED;
+  ZeroMem(&LongOpStatus, sizeof(LongOpStatus));
+  if (EFI_ERROR(FwCmdGetLongOperationStatus(pDimm, &FwStatus, &LongOpStatus)) ||
+      LongOpStatus.CmdOpcode != PtUpdateFw || LongOpStatus.CmdSubcode != SubopUpdateFw) {
+    return;
   }
 
-Finish:
-  FREE_POOL_SAFE(pFconfigRegionTemp);
-  // If ReturnCode isn't already set with an error, use the NvmStatus error
-  if (EFI_SUCCESS == ReturnCode) {
-    MatchCliReturnCode(*pNvmStatus);
+  LongOpEfiStatus = MatchFwReturnCode(LongOpStatus.Status);
+  if (LongOpEfiStatus == EFI_NO_RESPONSE || LongOpEfiStatus == EFI_SUCCESS) {
+    return;
   }
-  NVDIMM_EXIT_I64(ReturnCode);
-  #endif
-  return ReturnCode;
+
+  NVDIMM_DBG("Error with FW stage on dimm %d: Long operation failed - LongOpEfiStatus=[%d]",
+    pDimm->DimmID, LongOpEfiStatus);
+  if (LongOpEfiStatus == EFI_DEVICE_ERROR) {
+    NvmStatus = NVM_ERR_DEVICE_ERROR;
+  } else if (LongOpEfiStatus == EFI_UNSUPPORTED) {
+    NvmStatus = NVM_ERR_UNSUPPORTED_COMMAND;
+  } else if (LongOpEfiStatus == EFI_SECURITY_VIOLATION) {
+    NvmStatus = NVM_ERR_FW_UPDATE_AUTH_FAILURE;
+  } else if (LongOpEfiStatus == EFI_ABORTED) {
+    NvmStatus = NVM_ERR_LONG_OP_ABORTED_OR_REVISION_FAILURE;
+  } else {
+    NvmStatus = NVM_ERR_LONG_OP_UNKNOWN;
+  }
+  SetFwUpdateResult(pDimm, FwUpdateStateFailed, NvmStatus);
 }
 
 /**
 Update firmware or training data in one or all NVDIMMs of the system
 
+The image is read and verified once. It is then sent to all the target
+DIMMs at the same time (see RunDimmJobs). The call returns once the image
+is sent, the firmware of each DIMM then stages it on its own. Per-DIMM
+progress, timing and the staging outcome are available through
+GetFwUpdateStatus().
+
 @param[in] pThis is a pointer to the EFI_DCPMM_CONFIG2_PROTOCOL instance.
 @param[in] pDimmIds is a pointer to an array of DIMM IDs - if NULL, execute operation on all dimms
 @param[in] DimmIdsCount Number of items in array of DIMM IDs
@@ -5360,11 +5758,13 @@ UpdateFw(
   REQUIRE_DCPMMS RequireDcpmmsBitfield = REQUIRE_DCPMMS_MANAGEABLE;
   // FlashSPI is unsupported. Will remove more completely in a future change
   BOOLEAN FlashSPI = FALSE;
-
-  EFI_STATUS LongOpStatusReturnCode = 0;
-  NVM_STATUS LongOpNvmStatus = NVM_ERR_OPERATION_NOT_STARTED;
+  FW_UPDATE_JOB *pJobs = NULL;
+  FW_UPDATE_CTX UpdateCtx;
+  UINT32 JobsNum = 0;
+  UINT32 JobIndex = 0;
 
   ZeroMem(pDimms, sizeof(pDimms));
+  ZeroMem(&UpdateCtx, sizeof(UpdateCtx));
 
   NVDIMM_ENTRY();
   if (pCommandStatus == NULL) {
@@ -5415,6 +5815,14 @@ UpdateFw(
     goto Finish;
   }
 
+  if (!Examine) {
+    // Forget the previous update, a target left in FwUpdateStateNone
+    // failed along with the whole command (see pCommandStatus)
+    for (Index = 0; Index < DimmsNum; Index++) {
+      ZeroMem(&pDimms[Index]->FwUpdateStatus, sizeof(pDimms[Index]->FwUpdateStatus));
+    }
+  }
+
   ReturnCode = OpenFileBinary(pFileName, &FileHandle, pWorkingDirectory, FALSE);
   if (EFI_ERROR(ReturnCode)) {
     NVDIMM_DBG("OpenFile returned: " FORMAT_EFI_STATUS ".\n", ReturnCode);
@@ -5444,6 +5852,9 @@ UpdateFw(
     for (Index = 0; Index < DimmsNum; Index++) {
       VerificationFailures++;
       SetObjStatusForDimmWithErase(pCommandStatus, pDimms[Index], NVM_ERR_IMAGE_FILE_NOT_VALID, TRUE);
+      if (!Examine) {
+        SetFwUpdateResult(pDimms[Index], FwUpdateStateFailed, NVM_ERR_IMAGE_FILE_NOT_VALID);
+      }
     }
     NVDIMM_DBG("LoadFileAndCheckHeader Failed");
     goto Finish;
@@ -5519,11 +5930,22 @@ UpdateFw(
       }
 #endif
     }
+    else if (!Examine && IsFwImageStaged(pDimms[Index])) {
+      // Staging another image over it is refused, so is a downgrade prompt
+      NVDIMM_DBG("Skipping dimm %d, an image is already staged", pDimms[Index]->DimmID);
+      VerificationFailures++;
+      pCommandStatus->GeneralStatus = NVM_ERR_FIRMWARE_ALREADY_LOADED;
+      SetFwUpdateResult(pDimms[Index], FwUpdateStateFailed, NVM_ERR_FIRMWARE_ALREADY_LOADED);
+      SetObjStatusForDimmWithErase(pCommandStatus, pDimms[Index], NVM_ERR_FIRMWARE_ALREADY_LOADED, TRUE);
+    }
     else {
       ReturnCode = ValidateImageVersion(pFileHeader, Force, pDimms[Index], &NvmStatus);
       if (EFI_ERROR(ReturnCode)) {
         VerificationFailures++;
         pCommandStatus->GeneralStatus = NvmStatus;
+        if (!Examine) {
+          SetFwUpdateResult(pDimms[Index], FwUpdateStateFailed, NvmStatus);
+        }
         if (ReturnCode == EFI_ABORTED) {
           if (NvmStatus == NVM_ERR_FIRMWARE_TOO_LOW_FORCE_REQUIRED) {
             SetObjStatusForDimmWithErase(pCommandStatus, pDimms[Index], NVM_ERR_IMAGE_EXAMINE_LOWER_VERSION, TRUE);
@@ -5539,6 +5961,10 @@ UpdateFw(
         SetObjStatusForDimmWithErase(pCommandStatus, pDimms[Index], NVM_SUCCESS_IMAGE_EXAMINE_OK, TRUE);
       }
     }
+
+    if (!Examine && pDimmsCanBeUpdated[Index]) {
+      pDimms[Index]->FwUpdateStatus.State = FwUpdateStateQueued;
+    }
   }
 
   if (TRUE == Examine) {
@@ -5564,50 +5990,48 @@ UpdateFw(
     goto Finish;
   }
 
-  // upload FW image to all specified DIMMs
+  pJobs = AllocateZeroPool(sizeof(*pJobs) * DimmsToUpdate);
+  if (pJobs == NULL) {
+    NVDIMM_ERR("Out of memory");
+    pCommandStatus->GeneralStatus = NVM_ERR_NO_MEM;
+    goto Finish;
+  }
+
   for (Index = 0; Index < DimmsNum; Index++) {
     if (pDimmsCanBeUpdated[Index] == FALSE) {
       NVDIMM_DBG("Skipping dimm %d. It is marked as not being currently capable of this update", pDimms[Index]->DeviceHandle.AsUint32);
       continue;
     }
-
-    if (Recovery && FlashSPI) {
-      ReturnCode = RecoverDimmFw(pDimms[Index]->DeviceHandle.AsUint32,
-      pImageBuffer, BuffSize, pWorkingDirectory, &NvmStatus, pCommandStatus);
-      if (EFI_ERROR(ReturnCode))
-      {
-        NVDIMM_ERR("RecoverDimmFw returned: " FORMAT_EFI_STATUS ".\n", ReturnCode);
-      }
-    }
-    else {
-      ReturnCode = FwCmdUpdateFw(pDimms[Index], pImageBuffer, BuffSize, &NvmStatus, pCommandStatus);
+    pJobs[JobsNum].pDimm = pDimms[Index];
+    pJobs[JobsNum].ReturnCode = EFI_NOT_STARTED;
+    pJobs[JobsNum].NvmStatus = NVM_ERR_OPERATION_NOT_STARTED;
+    if (EFI_ERROR(InitializeCommandStatus(&pJobs[JobsNum].pCommandStatus))) {
+      NVDIMM_ERR("Out of memory");
+      pCommandStatus->GeneralStatus = NVM_ERR_NO_MEM;
+      goto Finish;
     }
+    pJobs[JobsNum].pCommandStatus->ObjectType = ObjectTypeDimm;
+    JobsNum++;
+  }
 
-    if (ReturnCode != EFI_SUCCESS) {
-      UpdateFailures++;
+  UpdateCtx.pJobs = pJobs;
+  UpdateCtx.pImageBuffer = pImageBuffer;
+  UpdateCtx.ImageBufferSize = BuffSize;
+  UpdateCtx.pWorkingDirectory = pWorkingDirectory;
+  UpdateCtx.RecoverSpi = Recovery && FlashSPI;
 
-      //Perform a check to see if it was a long operation that blocked the update and get more details about it
-      LongOpStatusReturnCode = CheckForLongOpStatusInProgress(pDimms[Index], &LongOpNvmStatus);
-      if (LongOpStatusReturnCode == EFI_SUCCESS && LongOpNvmStatus != NVM_SUCCESS) {
-        pCommandStatus->GeneralStatus = LongOpNvmStatus;
-        SetObjStatusForDimmWithErase(pCommandStatus, pDimms[Index], LongOpNvmStatus, TRUE);
-      }
-      else {
-        if (NvmStatus == NVM_SUCCESS) {
-          pCommandStatus->GeneralStatus = NVM_ERR_OPERATION_FAILED;
-          SetObjStatusForDimmWithErase(pCommandStatus, pDimms[Index], NVM_ERR_OPERATION_FAILED, TRUE);
-        }
-        else
-        {
-          pCommandStatus->GeneralStatus = NvmStatus;
-          SetObjStatusForDimmWithErase(pCommandStatus, pDimms[Index], NvmStatus, TRUE);
-        }
-      }
-    }
-    else
-    {
-      SetObjStatusForDimmWithErase(pCommandStatus, pDimms[Index], NvmStatus, TRUE);
+  // Upload FW image to all specified DIMMs. Staging is not waited on here,
+  // the caller polls GetFwUpdateStatus() (see BlockForFwStage in the CLI).
+  RunDimmJobs(JobsNum, FwUpdateTransferJob, &UpdateCtx);
+
+  // Each job only wrote to its own command status, collect them in DIMM order
+  for (JobIndex = 0; JobIndex < JobsNum; JobIndex++) {
+    MergeFwUpdateJobStatus(pCommandStatus, pJobs[JobIndex].pCommandStatus);
+    if (EFI_ERROR(pJobs[JobIndex].ReturnCode)) {
+      UpdateFailures++;
+      pCommandStatus->GeneralStatus = pJobs[JobIndex].NvmStatus;
     }
+    SetObjStatusForDimmWithErase(pCommandStatus, pJobs[JobIndex].pDimm, pJobs[JobIndex].NvmStatus, TRUE);
   }
 
   if (0 == UpdateFailures) {
@@ -5631,6 +6055,12 @@ Finish:
   FREE_POOL_SAFE(pImageBuffer);
   FREE_POOL_SAFE(pErrorMessage);
   FREE_POOL_SAFE(pDimmsCanBeUpdated);
+  if (pJobs != NULL) {
+    for (JobIndex = 0; JobIndex < JobsNum; JobIndex++) {
+      FreeCommandStatus(&pJobs[JobIndex].pCommandStatus);
+    }
+  }
+  FREE_POOL_SAFE(pJobs);
   NVDIMM_EXIT_I64(ReturnCode);
   return ReturnCode;
 }
@@ -8779,47 +9209,85 @@ GetDmiMemdevInfo(
   )
 {
   EFI_STATUS ReturnCode = EFI_DEVICE_ERROR;
-
-  SMBIOS_STRUCTURE_POINTER SmBiosStruct;
-  SMBIOS_STRUCTURE_POINTER BoundSmBiosStruct;
+  SMBIOS_INDEX *pSmbiosIndex = NULL;
+  SMBIOS_MEMDEV_ENTRY *pMemDev = NULL;
 
   NVDIMM_ENTRY();
 
-  ZeroMem(&SmBiosStruct, sizeof(SmBiosStruct));
-  ZeroMem(&BoundSmBiosStruct, sizeof(BoundSmBiosStruct));
-
   if (pDmiPhysicalDev == NULL || pDmiDeviceMappedAddr == NULL || pSmbiosVersion == NULL) {
     ReturnCode = EFI_INVALID_PARAMETER;
     goto Finish;
   }
 
-  GetFirstAndBoundSmBiosStructPointer(&SmBiosStruct, &BoundSmBiosStruct, pSmbiosVersion);
-  if (SmBiosStruct.Raw == NULL || BoundSmBiosStruct.Raw == NULL) {
+  pDmiPhysicalDev->Raw = NULL;
+  pDmiDeviceMappedAddr->Raw = NULL;
+
+  ReturnCode = GetSmbiosIndex(&pSmbiosIndex);
+  if (EFI_ERROR(ReturnCode)) {
     goto Finish;
   }
-  while (SmBiosStruct.Raw < BoundSmBiosStruct.Raw) {
-    if (SmBiosStruct.Hdr != NULL) {
-      if (SmBiosStruct.Hdr->Type == SMBIOS_TYPE_MEM_DEV && SmBiosStruct.Hdr->Handle == DimmPid) {
-        pDmiPhysicalDev->Raw = SmBiosStruct.Raw;
-      } else if (SmBiosStruct.Hdr->Type == SMBIOS_TYPE_MEM_DEV_MAPPED_ADDR &&
-                 SmBiosStruct.Type20->MemoryDeviceHandle == DimmPid) {
-        pDmiDeviceMappedAddr->Raw = SmBiosStruct.Raw;
-      }
-    } else {
-      NVDIMM_ERR("SmBios entry has invalid pointers set");
-    }
 
-    ReturnCode = GetNextSmbiosStruct(&SmBiosStruct);
-    if (EFI_ERROR(ReturnCode)) {
+  *pSmbiosVersion = pSmbiosIndex->Version;
+  pMemDev = FindSmbiosMemDev(pSmbiosIndex, DimmPid);
+  if (pMemDev != NULL) {
+    *pDmiPhysicalDev = pMemDev->Type17;
+    *pDmiDeviceMappedAddr = pMemDev->Type20;
+  }
+
+  ReturnCode = EFI_SUCCESS;
+
+Finish:
+  NVDIMM_EXIT_I64(ReturnCode);
+
+  return ReturnCode;
+}
+
+/**
+  Get the memory device index of the SMBIOS table. It is built on first use
+  and kept until the driver stops, so per DIMM lookups do not walk the table.
+
+  @param[out] ppSmbiosIndex Pointer to where the index is returned
+
+  @retval EFI_INVALID_PARAMETER passed NULL argument
+  @retval EFI_DEVICE_ERROR Failure to retrieve SMBIOS tables from gST
+  @retval EFI_SUCCESS Success
+  @retval Other errors from BuildSmbiosIndex
+**/
+EFI_STATUS
+GetSmbiosIndex(
+     OUT SMBIOS_INDEX **ppSmbiosIndex
+  )
+{
+  EFI_STATUS ReturnCode = EFI_DEVICE_ERROR;
+  SMBIOS_STRUCTURE_POINTER SmBiosStruct;
+  SMBIOS_STRUCTURE_POINTER BoundSmBiosStruct;
+  SMBIOS_VERSION SmbiosVersion;
+
+  NVDIMM_ENTRY();
+
+  if (ppSmbiosIndex == NULL) {
+    ReturnCode = EFI_INVALID_PARAMETER;
+    goto Finish;
+  }
+
+  if (gNvmDimmData->PMEMDev.pSmbiosIndex == NULL) {
+    ZeroMem(&SmBiosStruct, sizeof(SmBiosStruct));
+    ZeroMem(&BoundSmBiosStruct, sizeof(BoundSmBiosStruct));
+    ZeroMem(&SmbiosVersion, sizeof(SmbiosVersion));
+
+    GetFirstAndBoundSmBiosStructPointer(&SmBiosStruct, &BoundSmBiosStruct, &SmbiosVersion);
+    if (SmBiosStruct.Raw == NULL || BoundSmBiosStruct.Raw == NULL) {
       goto Finish;
     }
+    CHECK_RESULT(BuildSmbiosIndex(&SmBiosStruct, &BoundSmBiosStruct, SmbiosVersion,
+        &gNvmDimmData->PMEMDev.pSmbiosIndex), Finish);
   }
 
+  *ppSmbiosIndex = gNvmDimmData->PMEMDev.pSmbiosIndex;
   ReturnCode = EFI_SUCCESS;
 
 Finish:
   NVDIMM_EXIT_I64(ReturnCode);
-
   return ReturnCode;
 }
 
@@ -9047,10 +9515,11 @@ GetSystemTopologyFromSmbios(
 {
   EFI_STATUS ReturnCode = EFI_DEVICE_ERROR;
 
+  SMBIOS_INDEX *pSmbiosIndex = NULL;
+  SMBIOS_MEMDEV_ENTRY *pMemDev = NULL;
   SMBIOS_STRUCTURE_POINTER SmBiosStruct;
-  SMBIOS_STRUCTURE_POINTER BoundSmBiosStruct;
-  SMBIOS_VERSION SmbiosVersion;
   UINT8 CorrectedMemoryType;
+  UINT32 MemDevIndex = 0;
   UINT16 Index = 0;
   UINT64 Capacity = 0;
   DIMM* pDimm = NULL;
@@ -9067,33 +9536,30 @@ GetSystemTopologyFromSmbios(
     goto Finish;
   }
 
-  ZeroMem(&SmBiosStruct, sizeof(SmBiosStruct));
-  ZeroMem(&BoundSmBiosStruct, sizeof(BoundSmBiosStruct));
-  ZeroMem(&SmbiosVersion, sizeof(SmbiosVersion));
-
-  GetFirstAndBoundSmBiosStructPointer(&SmBiosStruct, &BoundSmBiosStruct, &SmbiosVersion);
-  if (SmBiosStruct.Raw == NULL || BoundSmBiosStruct.Raw == NULL) {
+  ReturnCode = GetSmbiosIndex(&pSmbiosIndex);
+  if (EFI_ERROR(ReturnCode)) {
     goto Finish;
   }
 
-  while (SmBiosStruct.Raw < BoundSmBiosStruct.Raw) {
+  for (MemDevIndex = 0; MemDevIndex < pSmbiosIndex->MemDevsNum; MemDevIndex++) {
+    pMemDev = &pSmbiosIndex->pMemDevs[MemDevIndex];
+    SmBiosStruct = pMemDev->Type17;
     if ((SmBiosStruct.Hdr != NULL) &&
-        (SmBiosStruct.Hdr->Type == SMBIOS_TYPE_MEM_DEV) &&
         ((SmBiosStruct.Type17->MemoryType == SMBIOS_MEMORY_TYPE_DDR4) ||
          (SmBiosStruct.Type17->MemoryType == SMBIOS_MEMORY_TYPE_LOGICAL_NON_VOLATILE) ||
          (SmBiosStruct.Type17->MemoryType == SMBIOS_MEMORY_TYPE_DCPM))) {
         (*ppTopologyDimm)[Index].DimmID = SmBiosStruct.Hdr->Handle;
 
-        ReturnCode = GetSmbiosCapacity(SmBiosStruct.Type17->Size, SmBiosStruct.Type17->ExtendedSize, SmbiosVersion,
+        ReturnCode = GetSmbiosCapacity(SmBiosStruct.Type17->Size, SmBiosStruct.Type17->ExtendedSize, pSmbiosIndex->Version,
           &Capacity);
         (*ppTopologyDimm)[Index].VolatileCapacity = Capacity;
-        ReturnCode = GetSmbiosString((SMBIOS_STRUCTURE_POINTER*)&SmBiosStruct.Type17,
+        ReturnCode = GetSmbiosMemDevString(pMemDev,
           SmBiosStruct.Type17->DeviceLocator, (*ppTopologyDimm)[Index].DeviceLocator,
           sizeof((*ppTopologyDimm)[Index].DeviceLocator));
         if (EFI_ERROR(ReturnCode)) {
           NVDIMM_WARN("Failed to retrieve attribute pDmiPhysicalDev->Type17->DeviceLocator (" FORMAT_EFI_STATUS ")", ReturnCode);
         }
-        ReturnCode = GetSmbiosString((SMBIOS_STRUCTURE_POINTER*)&SmBiosStruct.Type17,
+        ReturnCode = GetSmbiosMemDevString(pMemDev,
           SmBiosStruct.Type17->BankLocator, (*ppTopologyDimm)[Index].BankLabel,
           sizeof((*ppTopologyDimm)[Index].BankLabel));
         if (EFI_ERROR(ReturnCode)) {
@@ -9134,11 +9600,6 @@ GetSystemTopologyFromSmbios(
         Index++;
         (*pTopologyDimmsNumber) = Index;
     }
-
-    ReturnCode = GetNextSmbiosStruct(&SmBiosStruct);
-    if (EFI_ERROR(ReturnCode)) {
-      goto Finish;
-    }
   }
 
   ReturnCode = BubbleSort(*ppTopologyDimm, *pTopologyDimmsNumber, sizeof(**ppTopologyDimm), SortDimmTopologyByMemType);
@@ -10834,6 +11295,153 @@ Finish:
   return ReturnCode;
 }
 
+/**
+  Get the progress and timing of the firmware update of a PMem module,
+  the one under way or else the last one since the driver was loaded.
+  While the image is being staged the module is checked once on each call.
+
+  @param[in] pThis A pointer to the EFI_DCPMM_CONFIG2_PROTOCOL instance.
+  @param[in] DimmID Handle of the PMem module
+  @param[out] pFwUpdateStatus Progress and timing of the update
+
+  @retval EFI_SUCCESS Success
+  @retval EFI_INVALID_PARAMETER pThis or pFwUpdateStatus is NULL
+  @retval EFI_NOT_FOUND No PMem module with such handle
+**/
+EFI_STATUS
+EFIAPI
+GetFwUpdateStatus(
+  IN  EFI_DCPMM_CONFIG2_PROTOCOL *pThis,
+  IN  UINT16 DimmID,
+  OUT FW_UPDATE_STATUS *pFwUpdateStatus
+)
+{
+  EFI_STATUS ReturnCode = EFI_INVALID_PARAMETER;
+  DIMM *pDimm = NULL;
+
+  NVDIMM_ENTRY();
+
+  if (pThis == NULL || pFwUpdateStatus == NULL) {
+    NVDIMM_DBG("One or more parameters are NULL");
+    goto Finish;
+  }
+
+  pDimm = GetDimmByPid(DimmID, &gNvmDimmData->PMEMDev.Dimms);
+  if (pDimm == NULL) {
+    ReturnCode = EFI_NOT_FOUND;
+    goto Finish;
+  }
+
+  // Staging runs on the DIMM after UpdateFw() returned, check on it
+  if (pDimm->FwUpdateStatus.State == FwUpdateStateVerify) {
+    RefreshFwUpdateStage(pDimm);
+  }
+
+  // May be read while UpdateFw() is running on another thread, each field
+  // is written as a whole so a snapshot is consistent enough for reporting
+  CopyMem_S(pFwUpdateStatus, sizeof(*pFwUpdateStatus), &pDimm->FwUpdateStatus, sizeof(pDimm->FwUpdateStatus));
+  ReturnCode = EFI_SUCCESS;
+
+Finish:
+  NVDIMM_EXIT_I64(ReturnCode);
+  return ReturnCode;
+}
+
+/**
+  Get the transport resolved for a PMem module, resolving it first if the
+  transport attributes changed since.
+
+  @param[in] pThis A pointer to the EFI_DCPMM_CONFIG2_PROTOCOL instance.
+  @param[in] DimmID Handle of the PMem module
+  @param[out] pTransport The resolved transport
+
+  @retval EFI_SUCCESS Success
+  @retval EFI_INVALID_PARAMETER pThis or pTransport is NULL
+  @retval EFI_NOT_FOUND No PMem module with such handle
+**/
+EFI_STATUS
+EFIAPI
+GetDimmTransport(
+  IN  EFI_DCPMM_CONFIG2_PROTOCOL *pThis,
+  IN  UINT16 DimmID,
+  OUT DIMM_TRANSPORT_INFO *pTransport
+)
+{
+  EFI_STATUS ReturnCode = EFI_INVALID_PARAMETER;
+  DIMM *pDimm = NULL;
+
+  NVDIMM_ENTRY();
+
+  if (pThis == NULL || pTransport == NULL) {
+    NVDIMM_DBG("One or more parameters are NULL");
+    goto Finish;
+  }
+
+  pDimm = GetDimmByPid(DimmID, &gNvmDimmData->PMEMDev.Dimms);
+  if (pDimm == NULL) {
+    ReturnCode = EFI_NOT_FOUND;
+    goto Finish;
+  }
+
+  if (!pDimm->TransportValid) {
+    CHECK_RESULT(ResolveDimmTransport(pDimm), Finish);
+  }
+  CopyMem_S(pTransport, sizeof(*pTransport), &pDimm->Transport, sizeof(pDimm->Transport));
+  ReturnCode = EFI_SUCCESS;
+
+Finish:
+  NVDIMM_EXIT_I64(ReturnCode);
+  return ReturnCode;
+}
+
+#ifdef OS_BUILD
+/**
+  Get the firmware command statistics collected for a PMem module, one entry per
+  opcode/subopcode sent to it. Nothing is collected unless FW_CMD_STATS_ENABLED is set.
+
+  @param[in] pThis A pointer to the EFI_DCPMM_CONFIG2_PROTOCOL instance.
+  @param[in] DimmID Handle of the PMem module
+  @param[out] pStats Array of *pCount entries, may be NULL if *pCount is 0
+  @param[in,out] pCount Size of pStats on input, number of entries available on output
+
+  @retval EFI_SUCCESS Success
+  @retval EFI_INVALID_PARAMETER pThis or pCount is NULL
+  @retval EFI_NOT_FOUND No PMem module with such handle
+  @retval EFI_BUFFER_TOO_SMALL pStats is too small, *pCount is set to the size needed
+**/
+EFI_STATUS
+EFIAPI
+GetFwCmdStats(
+  IN     EFI_DCPMM_CONFIG2_PROTOCOL *pThis,
+  IN     UINT16 DimmID,
+     OUT FW_CMD_STATS *pStats OPTIONAL,
+  IN OUT UINT32 *pCount
+)
+{
+  EFI_STATUS ReturnCode = EFI_INVALID_PARAMETER;
+  DIMM *pDimm = NULL;
+
+  NVDIMM_ENTRY();
+
+  if (pThis == NULL || pCount == NULL) {
+    NVDIMM_DBG("One or more parameters are NULL");
+    goto Finish;
+  }
+
+  pDimm = GetDimmByPid(DimmID, &gNvmDimmData->PMEMDev.Dimms);
+  if (pDimm == NULL) {
+    ReturnCode = EFI_NOT_FOUND;
+    goto Finish;
+  }
+
+  ReturnCode = FwCmdStatsGet(pDimm->DeviceHandle.AsUint32, pStats, pCount);
+
+Finish:
+  NVDIMM_EXIT_I64(ReturnCode);
+  return ReturnCode;
+}
+#endif // OS_BUILD
+
 #ifndef OS_BUILD
 /**
   This function makes calls to the dimms required to initialize the driver.
@@ -10957,6 +11565,7 @@ SetFisTransportAttributes(
 )
 {
   EFI_STATUS ReturnCode = EFI_INVALID_PARAMETER;
+  LIST_ENTRY *pNode = NULL;
 
   NVDIMM_ENTRY();
 
@@ -10974,6 +11583,13 @@ SetFisTransportAttributes(
   gTransportAttribs.Protocol = Attribs.Protocol;
   gTransportAttribs.PayloadSize = Attribs.PayloadSize;
 
+  // The DIMMs resolved their transport against the previous attributes
+  if (gNvmDimmData != NULL) {
+    LIST_FOR_EACH(pNode, &gNvmDimmData->PMEMDev.Dimms) {
+      InvalidateDimmTransport(DIMM_FROM_NODE(pNode));
+    }
+  }
+
   ReturnCode = EFI_SUCCESS;
 
 Finish:
@@ -1589,6 +1589,72 @@ GetCommandEffectLog(
   IN OUT UINT32 *pEntryCount
 );
 
+/**
+  Get the progress and timing of the firmware update of a PMem module,
+  the one under way or else the last one since the driver was loaded.
+  While the image is being staged the module is checked once on each call.
+
+  @param[in] pThis A pointer to the EFI_DCPMM_CONFIG2_PROTOCOL instance.
+  @param[in] DimmID Handle of the PMem module
+  @param[out] pFwUpdateStatus Progress and timing of the update
+
+  @retval EFI_SUCCESS Success
+  @retval EFI_INVALID_PARAMETER pThis or pFwUpdateStatus is NULL
+  @retval EFI_NOT_FOUND No PMem module with such handle
+**/
+EFI_STATUS
+EFIAPI
+GetFwUpdateStatus(
+  IN  EFI_DCPMM_CONFIG2_PROTOCOL *pThis,
+  IN  UINT16 DimmID,
+  OUT FW_UPDATE_STATUS *pFwUpdateStatus
+);
+
+/**
+  Get the transport resolved for a PMem module, resolving it first if the
+  transport attributes changed since.
+
+  @param[in] pThis A pointer to the EFI_DCPMM_CONFIG2_PROTOCOL instance.
+  @param[in] DimmID Handle of the PMem module
+  @param[out] pTransport The resolved transport
+
+  @retval EFI_SUCCESS Success
+  @retval EFI_INVALID_PARAMETER pThis or pTransport is NULL
+  @retval EFI_NOT_FOUND No PMem module with such handle
+**/
+EFI_STATUS
+EFIAPI
+GetDimmTransport(
+  IN  EFI_DCPMM_CONFIG2_PROTOCOL *pThis,
+  IN  UINT16 DimmID,
+  OUT DIMM_TRANSPORT_INFO *pTransport
+);
+
+#ifdef OS_BUILD
+/**
+  Get the firmware command statistics collected for a PMem module, one entry per
+  opcode/subopcode sent to it. Nothing is collected unless FW_CMD_STATS_ENABLED is set.
+
+  @param[in] pThis A pointer to the EFI_DCPMM_CONFIG2_PROTOCOL instance.
+  @param[in] DimmID Handle of the PMem module
+  @param[out] pStats Array of *pCount entries, may be NULL if *pCount is 0
+  @param[in,out] pCount Size of pStats on input, number of entries available on output
+
+  @retval EFI_SUCCESS Success
+  @retval EFI_INVALID_PARAMETER pThis or pCount is NULL
+  @retval EFI_NOT_FOUND No PMem module with such handle
+  @retval EFI_BUFFER_TOO_SMALL pStats is too small, *pCount is set to the size needed
+**/
+EFI_STATUS
+EFIAPI
+GetFwCmdStats(
+  IN     EFI_DCPMM_CONFIG2_PROTOCOL *pThis,
+  IN     UINT16 DimmID,
+     OUT FW_CMD_STATS *pStats OPTIONAL,
+  IN OUT UINT32 *pCount
+);
+#endif // OS_BUILD
+
 #ifndef OS_BUILD
 /**
   This function makes calls to the PMem modules required to initialize the driver.
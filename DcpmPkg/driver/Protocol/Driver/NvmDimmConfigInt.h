@@ -221,6 +221,22 @@ GetDmiMemdevInfo(
   OUT SMBIOS_VERSION *pSmbiosVersion
 );
 
+/**
+  Get the memory device index of the SMBIOS table. It is built on first use
+  and kept until the driver stops, so per DIMM lookups do not walk the table.
+
+  @param[out] ppSmbiosIndex Pointer to where the index is returned
+
+  @retval EFI_INVALID_PARAMETER passed NULL argument
+  @retval EFI_DEVICE_ERROR Failure to retrieve SMBIOS tables from gST
+  @retval EFI_SUCCESS Success
+  @retval Other errors from BuildSmbiosIndex
+**/
+EFI_STATUS
+GetSmbiosIndex(
+     OUT SMBIOS_INDEX **ppSmbiosIndex
+  );
+
 /**
   Automatically provision capacity
   Decision logic for when to automatically provision capacity based on
@@ -61,6 +61,190 @@ CopyMemoryAndAddPointerToArray(
   IN     UINT32 *pNewPointerIndex
   );
 
+/**
+  Returns the slot a key hashes to in a parsed Nfit lookup index.
+
+  @param[in] pIndex pointer to the index, with Bits > 0.
+  @param[in] Key the key to hash.
+
+  @retval the starting slot for the key.
+**/
+STATIC
+UINT32
+NfitTableIndexSlot(
+  IN     NfitTableIndex *pIndex,
+  IN     UINT32 Key
+  )
+{
+  return (UINT32)((Key * 0x9E3779B1U) >> (32 - pIndex->Bits));
+}
+
+/**
+  Looks up a key in a parsed Nfit lookup index.
+
+  @param[in] pIndex pointer to the index.
+  @param[in] Key the key to look for.
+
+  @retval position of the subtable in its parsed array plus one, 0 if the key is not indexed.
+**/
+STATIC
+UINT32
+NfitTableIndexFind(
+  IN     NfitTableIndex *pIndex,
+  IN     UINT32 Key
+  )
+{
+  UINT32 Mask = 0;
+  UINT32 Slot = 0;
+
+  if (pIndex->Bits == 0) {
+    return 0;
+  }
+
+  Mask = (1U << pIndex->Bits) - 1;
+  for (Slot = NfitTableIndexSlot(pIndex, Key); pIndex->pPositions[Slot] != 0; Slot = (Slot + 1) & Mask) {
+    if (pIndex->pKeys[Slot] == Key) {
+      return pIndex->pPositions[Slot];
+    }
+  }
+  return 0;
+}
+
+/**
+  Adds a key to a parsed Nfit lookup index.
+
+  @param[in, out] pIndex pointer to the index, sized for all the entries.
+  @param[in] Key the key to add.
+  @param[in] Position position of the subtable in its parsed array.
+  @param[in] Overwrite replace the position if the key is already indexed, otherwise keep the first one.
+**/
+STATIC
+VOID
+NfitTableIndexInsert(
+  IN OUT NfitTableIndex *pIndex,
+  IN     UINT32 Key,
+  IN     UINT32 Position,
+  IN     BOOLEAN Overwrite
+  )
+{
+  UINT32 Mask = (1U << pIndex->Bits) - 1;
+  UINT32 Slot = 0;
+
+  for (Slot = NfitTableIndexSlot(pIndex, Key); pIndex->pPositions[Slot] != 0; Slot = (Slot + 1) & Mask) {
+    if (pIndex->pKeys[Slot] == Key) {
+      if (Overwrite) {
+        pIndex->pPositions[Slot] = Position + 1;
+      }
+      return;
+    }
+  }
+  pIndex->pKeys[Slot] = Key;
+  pIndex->pPositions[Slot] = Position + 1;
+}
+
+/**
+  Allocates an empty parsed Nfit lookup index for the given number of entries.
+
+  @param[out] pIndex pointer to the index.
+  @param[in] EntriesNum number of entries that will be added.
+
+  @retval EFI_SUCCESS the index was allocated, or there is nothing to index.
+  @retval EFI_OUT_OF_RESOURCES memory allocation failure.
+**/
+STATIC
+EFI_STATUS
+NfitTableIndexAllocate(
+     OUT NfitTableIndex *pIndex,
+  IN     UINT32 EntriesNum
+  )
+{
+  UINT32 Bits = 1;
+
+  if (EntriesNum == 0) {
+    return EFI_SUCCESS;
+  }
+
+  while ((1U << Bits) < EntriesNum * 2) {
+    Bits++;
+  }
+
+  pIndex->pKeys = AllocateZeroPool(sizeof(*pIndex->pKeys) << Bits);
+  pIndex->pPositions = AllocateZeroPool(sizeof(*pIndex->pPositions) << Bits);
+  if (pIndex->pKeys == NULL || pIndex->pPositions == NULL) {
+    FREE_POOL_SAFE(pIndex->pKeys);
+    FREE_POOL_SAFE(pIndex->pPositions);
+    return EFI_OUT_OF_RESOURCES;
+  }
+  pIndex->Bits = Bits;
+  return EFI_SUCCESS;
+}
+
+/**
+  Builds the lookup indexes over the parsed Nfit subtables, so the Get* helpers
+  below do not have to scan the subtable arrays on every call.
+
+  Duplicate keys resolve the same way the linear scans did: the first table wins,
+  except for Flush Hint tables where the last one wins.
+
+  @param[in, out] pParsedNfit pointer to the parsed NFit Header structure.
+
+  @retval EFI_SUCCESS the indexes were built.
+  @retval EFI_OUT_OF_RESOURCES memory allocation failure.
+**/
+STATIC
+EFI_STATUS
+BuildNfitIndexes(
+  IN OUT ParsedFitHeader *pParsedNfit
+  )
+{
+  EFI_STATUS ReturnCode = EFI_SUCCESS;
+  UINT32 Index = 0;
+  UINT32 Pid = 0;
+
+  CHECK_RESULT(NfitTableIndexAllocate(&pParsedNfit->SpaRangeIndex, pParsedNfit->SpaRangeTblesNum), Finish);
+  for (Index = 0; Index < pParsedNfit->SpaRangeTblesNum; Index++) {
+    NfitTableIndexInsert(&pParsedNfit->SpaRangeIndex,
+        pParsedNfit->ppSpaRangeTbles[Index]->SpaRangeDescriptionTableIndex, Index, FALSE);
+  }
+
+  CHECK_RESULT(NfitTableIndexAllocate(&pParsedNfit->InterleaveIndex, pParsedNfit->InterleaveTblesNum), Finish);
+  for (Index = 0; Index < pParsedNfit->InterleaveTblesNum; Index++) {
+    NfitTableIndexInsert(&pParsedNfit->InterleaveIndex,
+        pParsedNfit->ppInterleaveTbles[Index]->InterleaveStructureIndex, Index, FALSE);
+  }
+
+  CHECK_RESULT(NfitTableIndexAllocate(&pParsedNfit->ControlRegionIndex, pParsedNfit->ControlRegionTblesNum), Finish);
+  for (Index = 0; Index < pParsedNfit->ControlRegionTblesNum; Index++) {
+    NfitTableIndexInsert(&pParsedNfit->ControlRegionIndex,
+        pParsedNfit->ppControlRegionTbles[Index]->ControlRegionDescriptorTableIndex, Index, FALSE);
+  }
+
+  CHECK_RESULT(NfitTableIndexAllocate(&pParsedNfit->FlushHintIndex, pParsedNfit->FlushHintTblesNum), Finish);
+  for (Index = 0; Index < pParsedNfit->FlushHintTblesNum; Index++) {
+    NfitTableIndexInsert(&pParsedNfit->FlushHintIndex,
+        pParsedNfit->ppFlushHintTbles[Index]->DeviceHandle.AsUint32, Index, TRUE);
+  }
+
+  if (pParsedNfit->NvDimmRegionMappingStructuresNum == 0) {
+    goto Finish;
+  }
+
+  CHECK_RESULT(NfitTableIndexAllocate(&pParsedNfit->RegionPidIndex, pParsedNfit->NvDimmRegionMappingStructuresNum), Finish);
+  CHECK_RESULT_MALLOC(pParsedNfit->pNextRegionForPid,
+      AllocateZeroPool(sizeof(*pParsedNfit->pNextRegionForPid) * pParsedNfit->NvDimmRegionMappingStructuresNum), Finish);
+
+  // Walk backwards pushing each Region table onto the head of its physical ID
+  // chain, so every chain ends up in table order
+  for (Index = pParsedNfit->NvDimmRegionMappingStructuresNum; Index > 0; Index--) {
+    Pid = pParsedNfit->ppNvDimmRegionMappingStructures[Index - 1]->NvDimmPhysicalId;
+    pParsedNfit->pNextRegionForPid[Index - 1] = NfitTableIndexFind(&pParsedNfit->RegionPidIndex, Pid);
+    NfitTableIndexInsert(&pParsedNfit->RegionPidIndex, Pid, Index - 1, TRUE);
+  }
+
+Finish:
+  return ReturnCode;
+}
+
 /**
   ParseNfitTable - Performs deserialization from binary memory block into parsed structure of pointers.
 
@@ -171,6 +355,8 @@ ParseNfitTable(
     pTableHeader = (SubTableHeader *)pTabPointer;
   }
 
+  CHECK_RESULT(BuildNfitIndexes(pParsedNfit), Finish);
+
   ReturnCode = EFI_SUCCESS;
 
 Finish:
@@ -781,18 +967,17 @@ GetFlushHintTableForNvDimmRegionTable(
   )
 {
   EFI_STATUS ReturnCode = EFI_NOT_FOUND;
-  UINT32 Index = 0;
+  UINT32 Position = 0;
 
   if (pFitHead == NULL || pNvDimmRegionMappingStructure == NULL || ppFlushHintTable == NULL) {
     ReturnCode = EFI_INVALID_PARAMETER;
     goto Finish;
   }
 
-  for (Index = 0; Index < pFitHead->FlushHintTblesNum; Index++) {
-    if (pNvDimmRegionMappingStructure->DeviceHandle.AsUint32 == pFitHead->ppFlushHintTbles[Index]->DeviceHandle.AsUint32) {
-      *ppFlushHintTable = pFitHead->ppFlushHintTbles[Index];
-      ReturnCode = EFI_SUCCESS;
-    }
+  Position = NfitTableIndexFind(&pFitHead->FlushHintIndex, pNvDimmRegionMappingStructure->DeviceHandle.AsUint32);
+  if (Position != 0) {
+    *ppFlushHintTable = pFitHead->ppFlushHintTbles[Position - 1];
+    ReturnCode = EFI_SUCCESS;
   }
 
 Finish:
@@ -859,8 +1044,7 @@ GetControlRegionTableForNvDimmRegionTable(
   )
 {
   EFI_STATUS ReturnCode = EFI_NOT_FOUND;
-  UINT16 Index = 0;
-  UINT16 ControlTableIndex = 0;
+  UINT32 Position = 0;
 
   if (pFitHead == NULL || pNvDimmRegionMappingStructure == NULL || ppControlRegionTable == NULL) {
     ReturnCode = EFI_INVALID_PARAMETER;
@@ -868,14 +1052,11 @@ GetControlRegionTableForNvDimmRegionTable(
   }
 
   *ppControlRegionTable = NULL;
-  ControlTableIndex = pNvDimmRegionMappingStructure->NvdimmControlRegionDescriptorTableIndex;
-
-  for (Index = 0; Index < pFitHead->ControlRegionTblesNum; Index++) {
-    if (pFitHead->ppControlRegionTbles[Index]->ControlRegionDescriptorTableIndex == ControlTableIndex) {
-      *ppControlRegionTable = pFitHead->ppControlRegionTbles[Index];
-      ReturnCode = EFI_SUCCESS;
-      break;
-    }
+  Position = NfitTableIndexFind(&pFitHead->ControlRegionIndex,
+      pNvDimmRegionMappingStructure->NvdimmControlRegionDescriptorTableIndex);
+  if (Position != 0) {
+    *ppControlRegionTable = pFitHead->ppControlRegionTbles[Position - 1];
+    ReturnCode = EFI_SUCCESS;
   }
 
 Finish:
@@ -903,7 +1084,7 @@ GetControlRegionTablesForPID(
   )
 {
   EFI_STATUS ReturnCode = EFI_INVALID_PARAMETER;
-  UINT32 Index = 0;
+  UINT32 Position = 0;
   UINT32 Index2 = 0;
   UINT32 CurrentArrayNum = 0;
   ControlRegionTbl *pCtrlTable = NULL;
@@ -915,28 +1096,28 @@ GetControlRegionTablesForPID(
     goto Finish;
   }
 
-  for (Index = 0; Index < pFitHead->NvDimmRegionMappingStructuresNum; Index++) {
-    if (Pid == pFitHead->ppNvDimmRegionMappingStructures[Index]->NvDimmPhysicalId) {
-      ReturnCode = GetControlRegionTableForNvDimmRegionTable(
-          pFitHead, pFitHead->ppNvDimmRegionMappingStructures[Index], &pCtrlTable);
+  /** Only visit the Region tables of this PID, in table order **/
+  for (Position = NfitTableIndexFind(&pFitHead->RegionPidIndex, Pid); Position != 0;
+      Position = pFitHead->pNextRegionForPid[Position - 1]) {
+    ReturnCode = GetControlRegionTableForNvDimmRegionTable(
+        pFitHead, pFitHead->ppNvDimmRegionMappingStructures[Position - 1], &pCtrlTable);
 
-      /** Make sure the found Control Region table is not in the array already. **/
-      ContainedAlready = FALSE;
-      for (Index2 = 0; Index2 < CurrentArrayNum; Index2++) {
-        if (pCtrlTable == pControlRegionTables[Index2]) {
-          ContainedAlready = TRUE;
-        }
+    /** Make sure the found Control Region table is not in the array already. **/
+    ContainedAlready = FALSE;
+    for (Index2 = 0; Index2 < CurrentArrayNum; Index2++) {
+      if (pCtrlTable == pControlRegionTables[Index2]) {
+        ContainedAlready = TRUE;
       }
+    }
 
-      if (!ContainedAlready) {
-        if (CurrentArrayNum >= *pControlRegionTablesNum) {
-          NVDIMM_ERR("There are more Control Region tables than length of the input array.");
-          ReturnCode = EFI_BUFFER_TOO_SMALL;
-          goto Finish;
-        }
-        pControlRegionTables[CurrentArrayNum] = pCtrlTable;
-        CurrentArrayNum++;
+    if (!ContainedAlready) {
+      if (CurrentArrayNum >= *pControlRegionTablesNum) {
+        NVDIMM_ERR("There are more Control Region tables than length of the input array.");
+        ReturnCode = EFI_BUFFER_TOO_SMALL;
+        goto Finish;
       }
+      pControlRegionTables[CurrentArrayNum] = pCtrlTable;
+      CurrentArrayNum++;
     }
   }
 
@@ -967,7 +1148,7 @@ GetSpaRangeTable(
   )
 {
   EFI_STATUS ReturnCode = EFI_NOT_FOUND;
-  UINT16 Index = 0;
+  UINT32 Position = 0;
 
   if (pFitHead == NULL || ppSpaRangeTbl == NULL) {
     ReturnCode = EFI_INVALID_PARAMETER;
@@ -976,12 +1157,10 @@ GetSpaRangeTable(
 
   *ppSpaRangeTbl = NULL;
 
-  for (Index = 0; Index < pFitHead->SpaRangeTblesNum; Index++) {
-    if (pFitHead->ppSpaRangeTbles[Index]->SpaRangeDescriptionTableIndex == SpaRangeTblIndex) {
-      *ppSpaRangeTbl = pFitHead->ppSpaRangeTbles[Index];
-      ReturnCode = EFI_SUCCESS;
-      break;
-    }
+  Position = NfitTableIndexFind(&pFitHead->SpaRangeIndex, SpaRangeTblIndex);
+  if (Position != 0) {
+    *ppSpaRangeTbl = pFitHead->ppSpaRangeTbles[Position - 1];
+    ReturnCode = EFI_SUCCESS;
   }
 
 Finish:
@@ -1007,7 +1186,7 @@ GetInterleaveTable(
   )
 {
   EFI_STATUS ReturnCode = EFI_NOT_FOUND;
-  UINT16 Index = 0;
+  UINT32 Position = 0;
 
   if (pFitHead == NULL || ppInterleaveTbl == NULL) {
     ReturnCode = EFI_INVALID_PARAMETER;
@@ -1016,12 +1195,10 @@ GetInterleaveTable(
 
   *ppInterleaveTbl = NULL;
 
-  for (Index = 0; Index < pFitHead->InterleaveTblesNum; Index++) {
-    if (pFitHead->ppInterleaveTbles[Index]->InterleaveStructureIndex == InterleaveTblIndex) {
-      *ppInterleaveTbl = pFitHead->ppInterleaveTbles[Index];
-      ReturnCode = EFI_SUCCESS;
-      break;
-    }
+  Position = NfitTableIndexFind(&pFitHead->InterleaveIndex, InterleaveTblIndex);
+  if (Position != 0) {
+    *ppInterleaveTbl = pFitHead->ppInterleaveTbles[Position - 1];
+    ReturnCode = EFI_SUCCESS;
   }
 
 Finish:
@@ -1055,7 +1232,7 @@ GetNvDimmRegionMappingStructureForPid(
   )
 {
   EFI_STATUS ReturnCode = EFI_INVALID_PARAMETER;
-  UINT16 Index = 0;
+  UINT32 Position = 0;
   SpaRangeTbl *pSpaRangeTbl = NULL;
   UINT16 SpaIndexInNvDimmRegion = 0;
   BOOLEAN Found = FALSE;
@@ -1066,12 +1243,10 @@ GetNvDimmRegionMappingStructureForPid(
 
   *ppNvDimmRegionMappingStructure = NULL;
 
-  for (Index = 0; Index < pFitHead->NvDimmRegionMappingStructuresNum; Index++) {
-    if (pFitHead->ppNvDimmRegionMappingStructures[Index]->NvDimmPhysicalId != Pid) {
-      continue;
-    }
-
-    SpaIndexInNvDimmRegion = pFitHead->ppNvDimmRegionMappingStructures[Index]->SpaRangeDescriptionTableIndex;
+  /** Only visit the Region tables of this PID, in table order **/
+  for (Position = NfitTableIndexFind(&pFitHead->RegionPidIndex, Pid); Position != 0;
+      Position = pFitHead->pNextRegionForPid[Position - 1]) {
+    SpaIndexInNvDimmRegion = pFitHead->ppNvDimmRegionMappingStructures[Position - 1]->SpaRangeDescriptionTableIndex;
     Found = TRUE;
 
     if (SpaRangeIndexProvided && SpaIndexInNvDimmRegion != SpaRangeIndex) {
@@ -1090,7 +1265,7 @@ GetNvDimmRegionMappingStructureForPid(
     }
 
     if (Found) {
-      *ppNvDimmRegionMappingStructure = pFitHead->ppNvDimmRegionMappingStructures[Index];
+      *ppNvDimmRegionMappingStructure = pFitHead->ppNvDimmRegionMappingStructures[Position - 1];
       ReturnCode = EFI_SUCCESS;
       break;
     } else {
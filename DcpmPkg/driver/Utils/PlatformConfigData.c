@@ -9,6 +9,7 @@
 #include <Region.h>
 #include <Version.h>
 #include <NvmDimmDriver.h>
+#include <Checksum.h>
 
 #define NUM_OF_DIMMS_IN_SIX_WAY_INTERLEAVE_SET 6
 
@@ -371,7 +372,6 @@ GenerateChecksum(
 {
   UINT8 Checksum = 0;
   UINT8 *pByteData = (UINT8 *) pData;
-  UINT32 Index = 0;
 
   if (pData == NULL) {
     NVDIMM_DBG("One or more parameters are NULL");
@@ -380,9 +380,7 @@ GenerateChecksum(
 
   pByteData[ChecksumOffset] = 0;
 
-  for (Index = 0; Index < Length; Index++) {
-    Checksum += pByteData[Index];
-  }
+  Checksum = ChecksumSum8(pByteData, Length);
 
   pByteData[ChecksumOffset] = MAX_UINT8_VALUE - Checksum + 1;
 }
@@ -404,16 +402,13 @@ IsChecksumValid(
 {
   UINT8 Sum = 0;
   UINT8 *pByteData = (UINT8 *) pData;
-  UINT32 Index = 0;
 
   if (pData == NULL) {
     NVDIMM_DBG("One or more parameters are NULL");
     return FALSE;
   }
 
-  for (Index = 0; Index < Length; Index++) {
-    Sum += pByteData[Index];
-  }
+  Sum = ChecksumSum8(pByteData, Length);
 
   if (Sum != 0) {
     NVDIMM_DBG("Checksum(%d) missed by %d", pByteData[PCAT_TABLE_HEADER_CHECKSUM_OFFSET], Sum);
@@ -273,3 +273,260 @@ GetNextSmbiosStruct(
 Finish:
   return ReturnCode;
 }
+
+/**
+  Returns the slot a handle hashes to in an SMBIOS index.
+
+  @param[in] pIndex Pointer to the index
+  @param[in] Handle Memory device handle
+
+  @retval The starting slot for the handle
+**/
+STATIC
+UINT32
+SmbiosIndexHandleSlot(
+  IN     SMBIOS_INDEX *pIndex,
+  IN     UINT16 Handle
+  )
+{
+  return (UINT32)((Handle * 0x9E3779B1U) >> (32 - pIndex->HandleBits));
+}
+
+/**
+  Find the memory device entry of a handle, adding a new one if there is none yet.
+  The index must have room for one more entry.
+
+  @param[in, out] pIndex Pointer to the index
+  @param[in]      Handle Memory device handle
+
+  @retval Pointer to the entry
+**/
+STATIC
+SMBIOS_MEMDEV_ENTRY *
+GetOrAddSmbiosMemDev(
+  IN OUT SMBIOS_INDEX *pIndex,
+  IN     UINT16 Handle
+  )
+{
+  UINT32 Mask = (1U << pIndex->HandleBits) - 1;
+  UINT32 Slot = 0;
+
+  for (Slot = SmbiosIndexHandleSlot(pIndex, Handle); pIndex->pHandleSlots[Slot] != 0; Slot = (Slot + 1) & Mask) {
+    if (pIndex->pMemDevs[pIndex->pHandleSlots[Slot] - 1].Handle == Handle) {
+      return &pIndex->pMemDevs[pIndex->pHandleSlots[Slot] - 1];
+    }
+  }
+
+  pIndex->pMemDevs[pIndex->MemDevsNum].Handle = Handle;
+  pIndex->MemDevsNum++;
+  pIndex->pHandleSlots[Slot] = pIndex->MemDevsNum;
+  return &pIndex->pMemDevs[pIndex->MemDevsNum - 1];
+}
+
+/**
+  Locate the strings of the Type 17 structure of a memory device entry,
+  walking the unformatted section the same way GetSmbiosString does.
+
+  @param[in, out] pMemDev Pointer to the entry, with Type17 set
+**/
+STATIC
+VOID
+LocateSmbiosMemDevStrings(
+  IN OUT SMBIOS_MEMDEV_ENTRY *pMemDev
+  )
+{
+  CHAR8 *pString = (CHAR8 *) (pMemDev->Type17.Raw + pMemDev->Type17.Hdr->Length);
+
+  pMemDev->Type17StringsNum = 0;
+  while (pMemDev->Type17StringsNum < SMBIOS_INDEX_TYPE17_STRINGS_MAX) {
+    pMemDev->pType17Strings[pMemDev->Type17StringsNum] = pString;
+    pMemDev->Type17StringsNum++;
+
+    /** Skip string **/
+    for (; *pString != 0; pString++);
+    pString++;
+
+    if (*pString == 0) {
+      break;
+    }
+  }
+}
+
+/**
+  Build the memory device index of an SMBIOS table.
+
+  If a handle has several Type 17 or Type 20 structures, the last one in the table is indexed.
+
+  @param[in]  pSmBiosStruct       Pointer to the first SMBIOS structure of the table
+  @param[in]  pBoundSmBiosStruct  Pointer one after the last SMBIOS structure of the table
+  @param[in]  SmbiosVersion       The SMBIOS version of the table
+  @param[out] ppIndex             Pointer to where the allocated index is returned
+
+  @retval EFI_SUCCESS Index built
+  @retval EFI_INVALID_PARAMETER NULL parameter passed
+  @retval EFI_NOT_FOUND The table is malformed
+  @retval EFI_OUT_OF_RESOURCES Memory allocation failure
+**/
+EFI_STATUS
+BuildSmbiosIndex(
+  IN     SMBIOS_STRUCTURE_POINTER *pSmBiosStruct,
+  IN     SMBIOS_STRUCTURE_POINTER *pBoundSmBiosStruct,
+  IN     SMBIOS_VERSION SmbiosVersion,
+     OUT SMBIOS_INDEX **ppIndex
+  )
+{
+  EFI_STATUS ReturnCode = EFI_INVALID_PARAMETER;
+  SMBIOS_STRUCTURE_POINTER SmBiosStruct;
+  SMBIOS_INDEX *pIndex = NULL;
+  SMBIOS_MEMDEV_ENTRY *pMemDev = NULL;
+  UINT32 MemDevStructsNum = 0;
+  UINT32 HandleBits = 1;
+
+  NVDIMM_ENTRY();
+
+  if (pSmBiosStruct == NULL || pSmBiosStruct->Raw == NULL ||
+      pBoundSmBiosStruct == NULL || pBoundSmBiosStruct->Raw == NULL || ppIndex == NULL) {
+    goto Finish;
+  }
+
+  /** Count the structures to size the index **/
+  SmBiosStruct = *pSmBiosStruct;
+  while (SmBiosStruct.Raw < pBoundSmBiosStruct->Raw) {
+    if (SmBiosStruct.Hdr->Type == SMBIOS_TYPE_MEMORY_DEVICE ||
+        SmBiosStruct.Hdr->Type == SMBIOS_TYPE_MEMORY_DEVICE_MAPPED_ADDRESS) {
+      MemDevStructsNum++;
+    }
+    CHECK_RESULT(GetNextSmbiosStruct(&SmBiosStruct), Finish);
+  }
+
+  while ((1U << HandleBits) < MemDevStructsNum * 2) {
+    HandleBits++;
+  }
+
+  CHECK_RESULT_MALLOC(pIndex, AllocateZeroPool(sizeof(*pIndex)), Finish);
+  CHECK_RESULT_MALLOC(pIndex->pMemDevs,
+      AllocateZeroPool(sizeof(*pIndex->pMemDevs) * MAX(MemDevStructsNum, 1)), Finish);
+  CHECK_RESULT_MALLOC(pIndex->pHandleSlots, AllocateZeroPool(sizeof(*pIndex->pHandleSlots) << HandleBits), Finish);
+  pIndex->HandleBits = HandleBits;
+  pIndex->Version = SmbiosVersion;
+
+  SmBiosStruct = *pSmBiosStruct;
+  while (SmBiosStruct.Raw < pBoundSmBiosStruct->Raw) {
+    if (SmBiosStruct.Hdr->Type == SMBIOS_TYPE_MEMORY_DEVICE) {
+      pMemDev = GetOrAddSmbiosMemDev(pIndex, SmBiosStruct.Hdr->Handle);
+      pMemDev->Type17.Raw = SmBiosStruct.Raw;
+      LocateSmbiosMemDevStrings(pMemDev);
+    } else if (SmBiosStruct.Hdr->Type == SMBIOS_TYPE_MEMORY_DEVICE_MAPPED_ADDRESS) {
+      pMemDev = GetOrAddSmbiosMemDev(pIndex, SmBiosStruct.Type20->MemoryDeviceHandle);
+      pMemDev->Type20.Raw = SmBiosStruct.Raw;
+    }
+    CHECK_RESULT(GetNextSmbiosStruct(&SmBiosStruct), Finish);
+  }
+
+  *ppIndex = pIndex;
+  pIndex = NULL;
+  ReturnCode = EFI_SUCCESS;
+
+Finish:
+  FreeSmbiosIndex(&pIndex);
+  NVDIMM_EXIT_I64(ReturnCode);
+  return ReturnCode;
+}
+
+/**
+  Free an SMBIOS index and set the pointer to NULL.
+
+  @param[in, out] ppIndex Pointer to the index
+**/
+VOID
+FreeSmbiosIndex(
+  IN OUT SMBIOS_INDEX **ppIndex
+  )
+{
+  if (ppIndex == NULL || *ppIndex == NULL) {
+    return;
+  }
+
+  FREE_POOL_SAFE((*ppIndex)->pMemDevs);
+  FREE_POOL_SAFE((*ppIndex)->pHandleSlots);
+  FREE_POOL_SAFE(*ppIndex);
+}
+
+/**
+  Find the memory device entry of a handle in an SMBIOS index.
+
+  @param[in] pIndex Pointer to the index
+  @param[in] Handle Memory device handle
+
+  @retval Pointer to the entry, NULL if the handle has no Type 17 or Type 20 structure
+**/
+SMBIOS_MEMDEV_ENTRY *
+FindSmbiosMemDev(
+  IN     SMBIOS_INDEX *pIndex,
+  IN     UINT16 Handle
+  )
+{
+  UINT32 Mask = 0;
+  UINT32 Slot = 0;
+
+  if (pIndex == NULL) {
+    return NULL;
+  }
+
+  Mask = (1U << pIndex->HandleBits) - 1;
+  for (Slot = SmbiosIndexHandleSlot(pIndex, Handle); pIndex->pHandleSlots[Slot] != 0; Slot = (Slot + 1) & Mask) {
+    if (pIndex->pMemDevs[pIndex->pHandleSlots[Slot] - 1].Handle == Handle) {
+      return &pIndex->pMemDevs[pIndex->pHandleSlots[Slot] - 1];
+    }
+  }
+  return NULL;
+}
+
+/**
+  Retrieve a Type 17 string of an indexed memory device.
+  Same results as GetSmbiosString on the entry's Type 17 structure.
+
+  @param[in]  pMemDev         Pointer to the memory device entry
+  @param[in]  StringNumber    String number to return
+  @param[out] pSmbiosString   Pointer to a char buffer to where SMBIOS string will be copied
+  @param[in]  BufferLen       pSmbiosString buffer length
+
+  @retval EFI_SUCCESS String retrieved successfully
+  @retval EFI_INVALID_PARAMETER
+  @retval EFI_NOT_FOUND
+**/
+EFI_STATUS
+GetSmbiosMemDevString(
+  IN     SMBIOS_MEMDEV_ENTRY *pMemDev,
+  IN     UINT16 StringNumber,
+     OUT CHAR16 *pSmbiosString,
+  IN     UINT16 BufferLen
+  )
+{
+  CHAR8 *pString = NULL;
+
+  if (pMemDev == NULL || pSmbiosString == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+  if (BufferLen == 0 && StringNumber != SMBIOS_STRING_INVALID) {
+    return EFI_INVALID_PARAMETER;
+  }
+  if (pMemDev->Type17.Raw == NULL || StringNumber == SMBIOS_STRING_INVALID) {
+    return EFI_NOT_FOUND;
+  }
+
+  if (StringNumber > pMemDev->Type17StringsNum) {
+    if (pMemDev->Type17StringsNum < SMBIOS_INDEX_TYPE17_STRINGS_MAX) {
+      return EFI_NOT_FOUND;
+    }
+    /** Past the located strings, fall back to walking the structure **/
+    return GetSmbiosString(&pMemDev->Type17, StringNumber, pSmbiosString, BufferLen);
+  }
+
+  pString = pMemDev->pType17Strings[StringNumber - 1];
+  if (AsciiStrLen(pString) > (BufferLen * sizeof(CHAR16))) {
+    return EFI_INVALID_PARAMETER;
+  }
+  AsciiStrToUnicodeStrS(pString, pSmbiosString, BufferLen);
+  return EFI_SUCCESS;
+}
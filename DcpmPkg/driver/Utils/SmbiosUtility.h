@@ -100,4 +100,99 @@ GetFirstAndBoundSmBiosStructPointer(
 );
 #endif
 
+/** Type 17 strings located up front per memory device, later ones are looked up on demand **/
+#define SMBIOS_INDEX_TYPE17_STRINGS_MAX 8
+
+/**
+  SMBIOS Type 17 (memory device) and Type 20 (memory device mapped address)
+  structures of one memory device handle, with the Type 17 strings located.
+**/
+typedef struct {
+  UINT16 Handle;                                            ///< Memory device handle
+  SMBIOS_STRUCTURE_POINTER Type17;                          ///< Type 17 structure, Raw is NULL if there is none
+  SMBIOS_STRUCTURE_POINTER Type20;                          ///< Type 20 structure, Raw is NULL if there is none
+  UINT8 Type17StringsNum;                                   ///< Number of Type 17 strings located
+  CHAR8 *pType17Strings[SMBIOS_INDEX_TYPE17_STRINGS_MAX];   ///< String number N is at [N - 1]
+} SMBIOS_MEMDEV_ENTRY;
+
+/**
+  Memory device lookup index over an SMBIOS table, built in a single walk.
+  Entries point into the table, so it has to outlive the index.
+**/
+typedef struct {
+  SMBIOS_VERSION Version;                                   ///< SMBIOS version of the table
+  UINT32 MemDevsNum;                                        ///< Number of memory device entries
+  SMBIOS_MEMDEV_ENTRY *pMemDevs;                            ///< Entries in order of first appearance in the table
+  UINT32 HandleBits;                                        ///< log2 of the handle slot count
+  UINT32 *pHandleSlots;                                     ///< Open addressing on handle: pMemDevs position + 1, 0 for a free slot
+} SMBIOS_INDEX;
+
+/**
+  Build the memory device index of an SMBIOS table.
+
+  If a handle has several Type 17 or Type 20 structures, the last one in the table is indexed.
+
+  @param[in]  pSmBiosStruct       Pointer to the first SMBIOS structure of the table
+  @param[in]  pBoundSmBiosStruct  Pointer one after the last SMBIOS structure of the table
+  @param[in]  SmbiosVersion       The SMBIOS version of the table
+  @param[out] ppIndex             Pointer to where the allocated index is returned
+
+  @retval EFI_SUCCESS Index built
+  @retval EFI_INVALID_PARAMETER NULL parameter passed
+  @retval EFI_NOT_FOUND The table is malformed
+  @retval EFI_OUT_OF_RESOURCES Memory allocation failure
+**/
+EFI_STATUS
+BuildSmbiosIndex (
+  IN     SMBIOS_STRUCTURE_POINTER *pSmBiosStruct,
+  IN     SMBIOS_STRUCTURE_POINTER *pBoundSmBiosStruct,
+  IN     SMBIOS_VERSION SmbiosVersion,
+     OUT SMBIOS_INDEX **ppIndex
+  );
+
+/**
+  Free an SMBIOS index and set the pointer to NULL.
+
+  @param[in, out] ppIndex Pointer to the index
+**/
+VOID
+FreeSmbiosIndex (
+  IN OUT SMBIOS_INDEX **ppIndex
+  );
+
+/**
+  Find the memory device entry of a handle in an SMBIOS index.
+
+  @param[in] pIndex Pointer to the index
+  @param[in] Handle Memory device handle
+
+  @retval Pointer to the entry, NULL if the handle has no Type 17 or Type 20 structure
+**/
+SMBIOS_MEMDEV_ENTRY *
+FindSmbiosMemDev (
+  IN     SMBIOS_INDEX *pIndex,
+  IN     UINT16 Handle
+  );
+
+/**
+  Retrieve a Type 17 string of an indexed memory device.
+  Same results as GetSmbiosString on the entry's Type 17 structure.
+
+  @param[in]  pMemDev         Pointer to the memory device entry
+  @param[in]  StringNumber    String number to return
+  @param[out] pSmbiosString   Pointer to a char buffer to where SMBIOS string will be copied
+  @param[in]  BufferLen       pSmbiosString buffer length
+
+  @retval EFI_SUCCESS String retrieved successfully
+  @retval EFI_INVALID_PARAMETER
+  @retval EFI_NOT_FOUND
+**/
+EFI_STATUS
+GetSmbiosMemDevString (
+  IN     SMBIOS_MEMDEV_ENTRY *pMemDev,
+  IN     UINT16 StringNumber,
+     OUT CHAR16 *pSmbiosString,
+  IN     UINT16 BufferLen
+  );
+
 #endif /* _SMBIOSUTILITY_H_ */
@@ -0,0 +1,144 @@
+/*
+ * Copyright (c) 2018, Intel Corporation.
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+#include <Library/BaseMemoryLib.h>
+#include "DumpDbgLogCommand.h"
+#include "NvmDimmCli.h"
+#include "NvmInterface.h"
+#include "Debug.h"
+#include "Convert.h"
+#include <stdio.h>
+#include <os.h>
+#include <os_efi_preferences.h>
+#include <os_efi_log_ring.h>
+
+#define DBG_LOG_RING_FILE_PREFERENCE      "DBG_LOG_RING_FILE"
+
+/**
+  dump -dbglog syntax definition
+**/
+struct Command DumpDbgLogCommandSyntax =
+{
+  DUMP_VERB,                                                        //!< verb
+  {                                                                 //!< options
+    {L"", DESTINATION_OPTION, L"", DESTINATION_OPTION_HELP, L"Text file the messages are written to", FALSE, ValueRequired},
+    {L"", SOURCE_OPTION, L"", SOURCE_OPTION_HELP, L"Binary debug log, DBG_LOG_RING_FILE by default", FALSE, ValueRequired},
+    {VERBOSE_OPTION_SHORT, VERBOSE_OPTION, L"", L"",HELP_VERBOSE_DETAILS_TEXT, FALSE, ValueEmpty},
+    {OUTPUT_OPTION_SHORT, OUTPUT_OPTION, L"", OUTPUT_OPTION_HELP, HELP_OPTIONS_DETAILS_TEXT, FALSE, ValueRequired}
+  },
+  {
+    {DBG_LOG_TARGET, L"", L"", TRUE, ValueEmpty}
+  },
+  {{L"", L"", L"", FALSE, ValueOptional}},                          //!< properties
+  L"Decode the binary debug log of ipmctl and libipmctl into a text file.", //!< help
+  DumpDbgLogCommand,                                                //!< run function
+  TRUE
+};
+
+/**
+  Register the dump -dbglog command
+
+  @retval EFI_SUCCESS success
+  @retval EFI_ABORTED registering failure
+  @retval EFI_OUT_OF_RESOURCES memory allocation failure
+**/
+EFI_STATUS
+RegisterDumpDbgLogCommand(
+)
+{
+  EFI_STATUS ReturnCode = EFI_SUCCESS;
+  NVDIMM_ENTRY();
+
+  ReturnCode = RegisterCommand(&DumpDbgLogCommandSyntax);
+
+  NVDIMM_EXIT_I64(ReturnCode);
+  return ReturnCode;
+}
+
+/**
+  Decode the binary debug log written while DBG_LOG_RING_FILE is set into a text file
+
+  @param[in] pCmd Command from CLI
+
+  @retval EFI_SUCCESS Success
+  @retval EFI_INVALID_PARAMETER pCmd NULL or invalid command line parameters
+  @retval EFI_OUT_OF_RESOURCES Memory allocation failure
+  @retval EFI_NOT_FOUND The binary debug log could not be opened
+  @retval EFI_VOLUME_CORRUPTED The source is not a binary debug log
+**/
+EFI_STATUS
+DumpDbgLogCommand(
+  IN    struct Command *pCmd
+)
+{
+  EFI_STATUS ReturnCode = EFI_SUCCESS;
+  EFI_GUID Guid = { 0 };
+  PRINT_CONTEXT *pPrinterCtx = NULL;
+  CHAR16 *pDestination = NULL;
+  CHAR16 *pSource = NULL;
+  OS_PATH DestinationAscii = { 0 };
+  OS_PATH SourceAscii = { 0 };
+  CHAR16 SourceWide[OS_PATH_LEN] = { 0 };
+  FILE *pFile = NULL;
+  NVDIMM_ENTRY();
+
+  if (pCmd == NULL) {
+    ReturnCode = EFI_INVALID_PARAMETER;
+    NVDIMM_DBG("pCmd parameter is NULL.\n");
+    PRINTER_SET_MSG(pPrinterCtx, ReturnCode, CLI_ERR_NO_COMMAND);
+    goto Finish;
+  }
+
+  pPrinterCtx = pCmd->pPrintCtx;
+
+  pDestination = getOptionValue(pCmd, DESTINATION_OPTION);
+  if (pDestination == NULL) {
+    ReturnCode = EFI_INVALID_PARAMETER;
+    PRINTER_SET_MSG(pPrinterCtx, ReturnCode, CLI_PARSER_ERR_INVALID_OPTION_VALUES);
+    goto Finish;
+  }
+  CHECK_RESULT(UnicodeStrToAsciiStrS(pDestination, DestinationAscii, sizeof(DestinationAscii)), Finish);
+
+  if (containsOption(pCmd, SOURCE_OPTION)) {
+    pSource = getOptionValue(pCmd, SOURCE_OPTION);
+    if (pSource == NULL) {
+      ReturnCode = EFI_OUT_OF_RESOURCES;
+      PRINTER_SET_MSG(pPrinterCtx, ReturnCode, CLI_ERR_OUT_OF_MEMORY);
+      goto Finish;
+    }
+    CHECK_RESULT(UnicodeStrToAsciiStrS(pSource, SourceAscii, sizeof(SourceAscii)), Finish);
+  } else if (EFI_SUCCESS != preferences_get_string_ascii(DBG_LOG_RING_FILE_PREFERENCE, Guid,
+      sizeof(SourceAscii), SourceAscii) || SourceAscii[0] == '\0') {
+    ReturnCode = EFI_INVALID_PARAMETER;
+    PRINTER_SET_MSG(pPrinterCtx, ReturnCode, CLI_ERR_NO_DBG_LOG_SOURCE);
+    goto Finish;
+  }
+  CHECK_RESULT(AsciiStrToUnicodeStrS(SourceAscii, SourceWide, OS_PATH_LEN), Finish);
+
+  if (NULL == (pFile = fopen(DestinationAscii, "w"))) {
+    ReturnCode = EFI_INVALID_PARAMETER;
+    PRINTER_SET_MSG(pPrinterCtx, ReturnCode, CLI_ERR_WRONG_FILE_PATH);
+    goto Finish;
+  }
+
+  // Messages are only formatted here, they were stored binary while logged
+  ReturnCode = debug_log_ring_decode(SourceAscii, pFile);
+  fclose(pFile);
+  if (EFI_NOT_FOUND == ReturnCode) {
+    PRINTER_SET_MSG(pPrinterCtx, ReturnCode, CLI_ERR_DBG_LOG_NOT_FOUND, SourceWide);
+  } else if (EFI_VOLUME_CORRUPTED == ReturnCode) {
+    PRINTER_SET_MSG(pPrinterCtx, ReturnCode, CLI_ERR_DBG_LOG_CORRUPTED, SourceWide);
+  } else if (EFI_ERROR(ReturnCode)) {
+    PRINTER_SET_MSG(pPrinterCtx, ReturnCode, CLI_ERR_OUT_OF_MEMORY);
+  } else {
+    PRINTER_SET_MSG(pPrinterCtx, ReturnCode, CLI_INFO_DUMP_DBG_LOG_SUCCESS, pDestination);
+  }
+
+Finish:
+  PRINTER_PROCESS_SET_BUFFER(pPrinterCtx);
+  FREE_POOL_SAFE(pDestination);
+  FREE_POOL_SAFE(pSource);
+  NVDIMM_EXIT_I64(ReturnCode);
+  return ReturnCode;
+}
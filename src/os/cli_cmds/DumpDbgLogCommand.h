@@ -0,0 +1,40 @@
+/*
+ * Copyright (c) 2018, Intel Corporation.
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef _DUMP_DBG_LOG_COMMAND_H_
+#define _DUMP_DBG_LOG_COMMAND_H_
+
+#include <Uefi.h>
+#include "NvmInterface.h"
+#include "Common.h"
+
+/**
+  Register dump -dbglog command
+
+  @retval EFI_SUCCESS success
+  @retval EFI_ABORTED registering failure
+  @retval EFI_OUT_OF_RESOURCES memory allocation failure
+**/
+EFI_STATUS
+RegisterDumpDbgLogCommand(
+  );
+
+/**
+  Decode the binary debug log written while DBG_LOG_RING_FILE is set into a text file
+
+  @param[in] pCmd Command from CLI
+
+  @retval EFI_SUCCESS Success
+  @retval EFI_INVALID_PARAMETER pCmd NULL or invalid command line parameters
+  @retval EFI_OUT_OF_RESOURCES Memory allocation failure
+  @retval EFI_NOT_FOUND The binary debug log could not be opened
+  @retval EFI_VOLUME_CORRUPTED The source is not a binary debug log
+**/
+EFI_STATUS
+DumpDbgLogCommand(
+  IN    struct Command *pCmd
+  );
+
+#endif //_DUMP_DBG_LOG_COMMAND_H_
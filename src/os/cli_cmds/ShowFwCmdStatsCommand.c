@@ -0,0 +1,350 @@
+/*
+ * Copyright (c) 2018, Intel Corporation.
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+#include <Library/BaseMemoryLib.h>
+#include "ShowFwCmdStatsCommand.h"
+#include "NvmDimmCli.h"
+#include "NvmInterface.h"
+#include "LoadCommand.h"
+#include "Debug.h"
+#include "Convert.h"
+
+#define DS_ROOT_PATH                      L"/FwCmdStatsList"
+#define DS_DIMM_INDEX_PATH                L"/FwCmdStatsList/Dimm[%d]"
+#define DS_FW_CMD_INDEX_PATH              L"/FwCmdStatsList/Dimm[%d]/FwCmd[%d]"
+
+#define FW_CMD_NODE_STR                   L"FwCmd"
+#define OPCODE_STR                        L"Opcode"
+#define SUBOPCODE_STR                     L"SubOpcode"
+#define CALLS_STR                         L"Calls"
+#define RETRIES_STR                       L"Retries"
+#define ERRORS_STR                        L"Errors"
+#define BYTES_IN_STR                      L"BytesIn"
+#define BYTES_OUT_STR                     L"BytesOut"
+#define TOTAL_LATENCY_STR                 L"TotalLatency(us)"
+#define AVG_LATENCY_STR                   L"AvgLatency(us)"
+#define MIN_LATENCY_STR                   L"MinLatency(us)"
+#define MAX_LATENCY_STR                   L"MaxLatency(us)"
+#define FIS_STATUS_STR                    L"FisStatus"
+#define LATENCY_HISTOGRAM_STR             L"LatencyHistogram(us)"
+
+#define CLI_INFO_NO_FW_CMD_STATS          L"No firmware command statistics were collected. Set FW_CMD_STATS_ENABLED = 1 in the configuration file to collect them."
+
+/**
+  show -fwcmdstats syntax definition
+**/
+struct Command ShowFwCmdStatsCommandSyntax =
+{
+  SHOW_VERB,                                                           //!< verb
+  {                                                                    //!< options
+    {VERBOSE_OPTION_SHORT, VERBOSE_OPTION, L"", L"",HELP_VERBOSE_DETAILS_TEXT, FALSE, ValueEmpty},
+    {L"", PROTOCOL_OPTION_DDRT, L"", L"",HELP_DDRT_DETAILS_TEXT, FALSE, ValueEmpty},
+    {L"", PROTOCOL_OPTION_SMBUS, L"", L"",HELP_SMBUS_DETAILS_TEXT, FALSE, ValueEmpty},
+    { OUTPUT_OPTION_SHORT, OUTPUT_OPTION, L"", OUTPUT_OPTION_HELP, HELP_OPTIONS_DETAILS_TEXT,FALSE, ValueRequired }
+  },
+  {
+    {FW_CMD_STATS_TARGET, L"", L"", TRUE, ValueEmpty},
+    {DIMM_TARGET, L"", HELP_TEXT_DIMM_IDS, FALSE, ValueOptional}
+  },
+  {{L"", L"", L"", FALSE, ValueOptional}},                            //!< properties
+  L"Show the counters and latency histograms of the firmware commands sent to one or more " PMEM_MODULES_STR
+  L" by this process.",                                                //!< help
+  ShowFwCmdStatsCommand,                                               //!< run function
+  TRUE
+};
+
+/*
+*  PRINT LIST ATTRIBUTES
+*  ---DimmID=0x0001---
+*     ---Opcode=0x01 SubOpcode=0x00
+*        Calls=12
+*        ...
+*/
+PRINTER_LIST_ATTRIB ShowFwCmdStatsListAttributes =
+{
+ {
+    {
+      DIMM_NODE_STR,                                                          //GROUP LEVEL TYPE
+      L"---" DIMM_ID_STR L"=$(" DIMM_ID_STR L")---",                          //NULL or GROUP LEVEL HEADER
+      SHOW_LIST_IDENT FORMAT_STR L"=" FORMAT_STR,                             //NULL or KEY VAL FORMAT STR
+      DIMM_ID_STR                                                             //NULL or IGNORE KEY LIST (K1;K2)
+    },
+    {
+      FW_CMD_NODE_STR,                                                        //GROUP LEVEL TYPE
+      SHOW_LIST_IDENT L"---" OPCODE_STR L"=$(" OPCODE_STR L") " SUBOPCODE_STR L"=$(" SUBOPCODE_STR L")",  //NULL or GROUP LEVEL HEADER
+      SHOW_LIST_IDENT SHOW_LIST_IDENT FORMAT_STR L"=" FORMAT_STR,             //NULL or KEY VAL FORMAT STR
+      OPCODE_STR L";" SUBOPCODE_STR                                           //NULL or IGNORE KEY LIST (K1;K2)
+    }
+  }
+};
+
+PRINTER_DATA_SET_ATTRIBS ShowFwCmdStatsDataSetAttribs =
+{
+  &ShowFwCmdStatsListAttributes,
+  NULL
+};
+
+/**
+  Register the show -fwcmdstats command
+
+  @retval EFI_SUCCESS success
+  @retval EFI_ABORTED registering failure
+  @retval EFI_OUT_OF_RESOURCES memory allocation failure
+**/
+EFI_STATUS
+RegisterShowFwCmdStatsCommand(
+)
+{
+  EFI_STATUS ReturnCode = EFI_SUCCESS;
+  NVDIMM_ENTRY();
+
+  ReturnCode = RegisterCommand(&ShowFwCmdStatsCommandSyntax);
+
+  NVDIMM_EXIT_I64(ReturnCode);
+  return ReturnCode;
+}
+
+/**
+  Get the firmware command statistics of a PMem module
+
+  @param[in] pNvmDimmConfigProtocol The config protocol
+  @param[in] DimmID ID of the PMem module
+  @param[out] ppStats Newly allocated array of statistics, caller is responsible for freeing it
+  @param[out] pCount Number of entries in *ppStats
+
+  @retval EFI_SUCCESS success
+  @retval EFI_OUT_OF_RESOURCES memory allocation failure
+  @retval Other errors returned by GetFwCmdStats
+**/
+STATIC
+EFI_STATUS
+GetFwCmdStatsOfDimm(
+  IN     EFI_DCPMM_CONFIG2_PROTOCOL *pNvmDimmConfigProtocol,
+  IN     UINT16 DimmID,
+     OUT FW_CMD_STATS **ppStats,
+     OUT UINT32 *pCount
+)
+{
+  EFI_STATUS ReturnCode = EFI_SUCCESS;
+  FW_CMD_STATS *pStats = NULL;
+  UINT32 Count = 0;
+
+  // Commands sent in between may add entries, ask again until they fit
+  ReturnCode = pNvmDimmConfigProtocol->GetFwCmdStats(pNvmDimmConfigProtocol, DimmID, NULL, &Count);
+  while (EFI_BUFFER_TOO_SMALL == ReturnCode) {
+    FREE_POOL_SAFE(pStats);
+    pStats = AllocateZeroPool(sizeof(*pStats) * Count);
+    if (pStats == NULL) {
+      ReturnCode = EFI_OUT_OF_RESOURCES;
+      goto Finish;
+    }
+    ReturnCode = pNvmDimmConfigProtocol->GetFwCmdStats(pNvmDimmConfigProtocol, DimmID, pStats, &Count);
+  }
+  if (EFI_ERROR(ReturnCode)) {
+    goto Finish;
+  }
+
+  *ppStats = pStats;
+  *pCount = Count;
+  pStats = NULL;
+
+Finish:
+  FREE_POOL_SAFE(pStats);
+  return ReturnCode;
+}
+
+/**
+  Create the string of the non empty FIS status buckets, e.g. "0x00:12, 0x05:1"
+
+  @param[in] pStats Statistics of one opcode/subopcode
+
+  @retval Newly allocated string, NULL if out of memory
+**/
+STATIC
+CHAR16 *
+GetFisStatusStr(
+  IN     FW_CMD_STATS *pStats
+)
+{
+  CHAR16 *pReturnBuffer = NULL;
+  UINT32 Index = 0;
+
+  for (Index = 0; Index < FW_CMD_STATS_STATUS_BUCKETS; Index++) {
+    if (0 == pStats->FisStatus[Index]) {
+      continue;
+    }
+    if (NULL != pReturnBuffer) {
+      pReturnBuffer = CatSPrintClean(pReturnBuffer, L", ");
+    }
+    pReturnBuffer = CatSPrintClean(pReturnBuffer, L"0x%02x%ls:" FORMAT_UINT64, Index,
+      (FW_CMD_STATS_STATUS_BUCKETS - 1 == Index) ? L"+" : L"", pStats->FisStatus[Index]);
+  }
+  return pReturnBuffer;
+}
+
+/**
+  Create the string of the non empty latency buckets, e.g. "64-127:3, 128-255:40"
+
+  @param[in] pStats Statistics of one opcode/subopcode
+
+  @retval Newly allocated string, NULL if out of memory
+**/
+STATIC
+CHAR16 *
+GetLatencyHistogramStr(
+  IN     FW_CMD_STATS *pStats
+)
+{
+  CHAR16 *pReturnBuffer = NULL;
+  UINT32 Index = 0;
+  UINT64 Low = 0;
+
+  for (Index = 0; Index < FW_CMD_STATS_LATENCY_BUCKETS; Index++) {
+    if (0 == pStats->LatencyUs[Index]) {
+      continue;
+    }
+    if (NULL != pReturnBuffer) {
+      pReturnBuffer = CatSPrintClean(pReturnBuffer, L", ");
+    }
+    Low = (0 == Index) ? 0 : (1ULL << Index);
+    if (FW_CMD_STATS_LATENCY_BUCKETS - 1 == Index) {
+      pReturnBuffer = CatSPrintClean(pReturnBuffer, FORMAT_UINT64 L"+:" FORMAT_UINT64, Low, pStats->LatencyUs[Index]);
+    } else {
+      pReturnBuffer = CatSPrintClean(pReturnBuffer, FORMAT_UINT64 L"-" FORMAT_UINT64 L":" FORMAT_UINT64,
+        Low, (2ULL << Index) - 1, pStats->LatencyUs[Index]);
+    }
+  }
+  return pReturnBuffer;
+}
+
+/**
+  Show the firmware command statistics collected for one or more PMem modules
+
+  @param[in] pCmd Command from CLI
+
+  @retval EFI_SUCCESS Success
+  @retval EFI_INVALID_PARAMETER pCmd NULL or invalid command line parameters
+  @retval EFI_OUT_OF_RESOURCES Memory allocation failure
+  @retval EFI_NOT_FOUND No PMem module found
+**/
+EFI_STATUS
+ShowFwCmdStatsCommand(
+  IN    struct Command *pCmd
+)
+{
+  EFI_STATUS ReturnCode = EFI_SUCCESS;
+  PRINT_CONTEXT *pPrinterCtx = NULL;
+  EFI_DCPMM_CONFIG2_PROTOCOL *pNvmDimmConfigProtocol = NULL;
+  DIMM_INFO *pDimms = NULL;
+  UINT32 DimmCount = 0;
+  CHAR16 *pDimmsValue = NULL;
+  UINT16 *pDimmIds = NULL;
+  UINT32 DimmIdsNum = 0;
+  UINT32 DimmIndex = 0;
+  FW_CMD_STATS *pStats = NULL;
+  UINT32 StatsCount = 0;
+  UINT32 StatsIndex = 0;
+  UINT32 StatsTotal = 0;
+  CHAR16 DimmStr[MAX_DIMM_UID_LENGTH];
+  CHAR16 *pPath = NULL;
+  CHAR16 *pValue = NULL;
+
+  NVDIMM_ENTRY();
+
+  if (pCmd == NULL) {
+    ReturnCode = EFI_INVALID_PARAMETER;
+    NVDIMM_DBG("pCmd parameter is NULL.\n");
+    PRINTER_SET_MSG(pPrinterCtx, ReturnCode, FORMAT_STR_NL, CLI_ERR_NO_COMMAND);
+    goto Finish;
+  }
+
+  pPrinterCtx = pCmd->pPrintCtx;
+
+  ReturnCode = OpenNvmDimmProtocol(gNvmDimmConfigProtocolGuid, (VOID **)&pNvmDimmConfigProtocol, NULL);
+  if (EFI_ERROR(ReturnCode)) {
+    ReturnCode = EFI_NOT_FOUND;
+    PRINTER_SET_MSG(pPrinterCtx, ReturnCode, FORMAT_STR_NL, CLI_ERR_OPENING_CONFIG_PROTOCOL);
+    goto Finish;
+  }
+
+  ReturnCode = GetDimmList(pNvmDimmConfigProtocol, pCmd, DIMM_INFO_CATEGORY_NONE, &pDimms, &DimmCount);
+  if (EFI_ERROR(ReturnCode)) {
+    if (ReturnCode == EFI_NOT_FOUND) {
+      PRINTER_SET_MSG(pCmd->pPrintCtx, ReturnCode, CLI_INFO_NO_FUNCTIONAL_DIMMS);
+    }
+    goto Finish;
+  }
+
+  if (ContainTarget(pCmd, DIMM_TARGET)) {
+    pDimmsValue = GetTargetValue(pCmd, DIMM_TARGET);
+    ReturnCode = GetDimmIdsFromString(pCmd, pDimmsValue, pDimms, DimmCount, &pDimmIds, &DimmIdsNum);
+    if (EFI_ERROR(ReturnCode)) {
+      NVDIMM_WARN("Target value is not a valid Dimm ID");
+      goto Finish;
+    }
+  }
+
+  for (DimmIndex = 0; DimmIndex < DimmCount; DimmIndex++) {
+    if (DimmIdsNum > 0 && !ContainUint(pDimmIds, DimmIdsNum, pDimms[DimmIndex].DimmID)) {
+      continue;
+    }
+
+    ReturnCode = GetFwCmdStatsOfDimm(pNvmDimmConfigProtocol, pDimms[DimmIndex].DimmID, &pStats, &StatsCount);
+    if (EFI_ERROR(ReturnCode)) {
+      PRINTER_SET_MSG(pPrinterCtx, ReturnCode, CLI_ERR_INTERNAL_ERROR);
+      goto Finish;
+    }
+    if (0 == StatsCount) {
+      continue;
+    }
+
+    ReturnCode = GetPreferredDimmIdAsString(pDimms[DimmIndex].DimmHandle, pDimms[DimmIndex].DimmUid, DimmStr, MAX_DIMM_UID_LENGTH);
+    if (EFI_ERROR(ReturnCode)) {
+      goto Finish;
+    }
+
+    PRINTER_BUILD_KEY_PATH(pPath, DS_DIMM_INDEX_PATH, DimmIndex);
+    PRINTER_SET_KEY_VAL_WIDE_STR(pPrinterCtx, pPath, DIMM_ID_STR, DimmStr);
+
+    for (StatsIndex = 0; StatsIndex < StatsCount; StatsIndex++) {
+      PRINTER_BUILD_KEY_PATH(pPath, DS_FW_CMD_INDEX_PATH, DimmIndex, StatsIndex);
+      PRINTER_SET_KEY_VAL_UINT8(pPrinterCtx, pPath, OPCODE_STR, pStats[StatsIndex].Opcode, HEX);
+      PRINTER_SET_KEY_VAL_UINT8(pPrinterCtx, pPath, SUBOPCODE_STR, pStats[StatsIndex].SubOpcode, HEX);
+      PRINTER_SET_KEY_VAL_UINT64(pPrinterCtx, pPath, CALLS_STR, pStats[StatsIndex].Calls, DECIMAL);
+      PRINTER_SET_KEY_VAL_UINT64(pPrinterCtx, pPath, RETRIES_STR, pStats[StatsIndex].Retries, DECIMAL);
+      PRINTER_SET_KEY_VAL_UINT64(pPrinterCtx, pPath, ERRORS_STR, pStats[StatsIndex].Errors, DECIMAL);
+      PRINTER_SET_KEY_VAL_UINT64(pPrinterCtx, pPath, BYTES_IN_STR, pStats[StatsIndex].BytesIn, DECIMAL);
+      PRINTER_SET_KEY_VAL_UINT64(pPrinterCtx, pPath, BYTES_OUT_STR, pStats[StatsIndex].BytesOut, DECIMAL);
+      PRINTER_SET_KEY_VAL_UINT64(pPrinterCtx, pPath, TOTAL_LATENCY_STR, pStats[StatsIndex].TotalUs, DECIMAL);
+      PRINTER_SET_KEY_VAL_UINT64(pPrinterCtx, pPath, AVG_LATENCY_STR,
+        pStats[StatsIndex].TotalUs / pStats[StatsIndex].Calls, DECIMAL);
+      PRINTER_SET_KEY_VAL_UINT64(pPrinterCtx, pPath, MIN_LATENCY_STR, pStats[StatsIndex].MinUs, DECIMAL);
+      PRINTER_SET_KEY_VAL_UINT64(pPrinterCtx, pPath, MAX_LATENCY_STR, pStats[StatsIndex].MaxUs, DECIMAL);
+      pValue = GetFisStatusStr(&pStats[StatsIndex]);
+      PRINTER_SET_KEY_VAL_WIDE_STR(pPrinterCtx, pPath, FIS_STATUS_STR, pValue);
+      FREE_POOL_SAFE(pValue);
+      pValue = GetLatencyHistogramStr(&pStats[StatsIndex]);
+      PRINTER_SET_KEY_VAL_WIDE_STR(pPrinterCtx, pPath, LATENCY_HISTOGRAM_STR, pValue);
+      FREE_POOL_SAFE(pValue);
+    }
+    StatsTotal += StatsCount;
+    FREE_POOL_SAFE(pStats);
+  }
+
+  if (0 == StatsTotal) {
+    PRINTER_SET_MSG(pPrinterCtx, ReturnCode, CLI_INFO_NO_FW_CMD_STATS);
+    goto Finish;
+  }
+
+  PRINTER_CONFIGURE_DATA_ATTRIBUTES(pPrinterCtx, DS_ROOT_PATH, &ShowFwCmdStatsDataSetAttribs);
+Finish:
+  PRINTER_PROCESS_SET_BUFFER(pPrinterCtx);
+  FREE_POOL_SAFE(pPath);
+  FREE_POOL_SAFE(pValue);
+  FREE_POOL_SAFE(pDimms);
+  FREE_POOL_SAFE(pDimmIds);
+  FREE_POOL_SAFE(pStats);
+  NVDIMM_EXIT_I64(ReturnCode);
+  return ReturnCode;
+}
@@ -0,0 +1,39 @@
+/*
+ * Copyright (c) 2018, Intel Corporation.
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef _SHOW_FW_CMD_STATS_COMMAND_H_
+#define _SHOW_FW_CMD_STATS_COMMAND_H_
+
+#include <Uefi.h>
+#include "NvmInterface.h"
+#include "Common.h"
+
+/**
+  Register show -fwcmdstats command
+
+  @retval EFI_SUCCESS success
+  @retval EFI_ABORTED registering failure
+  @retval EFI_OUT_OF_RESOURCES memory allocation failure
+**/
+EFI_STATUS
+RegisterShowFwCmdStatsCommand(
+  );
+
+/**
+  Show the firmware command statistics collected for one or more PMem modules
+
+  @param[in] pCmd Command from CLI
+
+  @retval EFI_SUCCESS Success
+  @retval EFI_INVALID_PARAMETER pCmd NULL or invalid command line parameters
+  @retval EFI_OUT_OF_RESOURCES Memory allocation failure
+  @retval EFI_NOT_FOUND No PMem module found
+**/
+EFI_STATUS
+ShowFwCmdStatsCommand(
+  IN    struct Command *pCmd
+  );
+
+#endif //_SHOW_FW_CMD_STATS_COMMAND_H_
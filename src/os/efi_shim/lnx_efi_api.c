@@ -53,6 +53,21 @@ UINT64 GetCurrentMilliseconds()
   return retval;
 }
 
+/**
+  Used to serialize load and store operations.
+
+  All loads and stores that proceed calls to this function are guaranteed to be
+  globally visible when this function returns.
+**/
+VOID
+EFIAPI
+MemoryFence(
+  VOID
+  )
+{
+  __sync_synchronize();
+}
+
 /**
 Loads a table as specified in the args
 
@@ -92,6 +107,22 @@ passthru_os(
   return Rc;
 }
 
+VOID
+passthru_os_release(
+  VOID
+)
+{
+  passthrough_session_close();
+}
+
+UINT32
+passthru_os_last_retries(
+  VOID
+)
+{
+  return (UINT32)passthrough_get_last_retries();
+}
+
 EFI_STATUS
 get_nfit_table(
   OUT EFI_ACPI_DESCRIPTION_HEADER ** table,
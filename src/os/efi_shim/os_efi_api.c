@@ -46,6 +46,8 @@
 #include "Pbr.h"
 #include "PbrDcpmm.h"
 #include <os_str.h>
+#include "os_efi_preferences.h"
+#include "os_efi_log_ring.h"
 
 EFI_SYSTEM_TABLE *gST;
 EFI_SHELL_INTERFACE *mEfiShellInterface;
@@ -93,12 +95,27 @@ enum
 
 #define INI_PREFERENCES_LOG_LEVEL L"DBG_LOG_LEVEL"
 #define INI_PREFERENCES_LOG_STDOUT_ENABLED L"DBG_LOG_STDOUT_ENABLED"
+#define INI_PREFERENCES_LOG_RING_FILE "DBG_LOG_RING_FILE"
 
 /*
 * Debug logger context structure.
 */
 static struct debug_logger_config g_log_config = { 0 };
 
+/*
+* Serializes the reads of the logger configuration, created by the first
+* DebugLoggerInit() and kept until the process exits. DebugPrint() keeps
+* retrying the read while the configuration is missing, possibly from the
+* threads of RunDimmJobs().
+*/
+static OS_MUTEX *g_log_config_mutex = NULL;
+
+/*
+* Error levels DebugPrint emits, see OS_DEBUG_PRINT_ENABLED. Every level passes
+* until the logger configuration has been read.
+*/
+UINTN g_debug_print_mask = MAX_UINTN;
+
 static EFI_STATUS ConvertAsciiStrToUnicode(const CHAR8 * AsciiStr, CHAR16 * UnicodeStr, UINTN UnicodeStrMaxLength) {
   EFI_STATUS ReturnCode;
   if ((NULL == AsciiStr) || (NULL == UnicodeStr)) {
@@ -111,6 +128,250 @@ static EFI_STATUS ConvertAsciiStrToUnicode(const CHAR8 * AsciiStr, CHAR16 * Unic
   return ReturnCode;
 }
 
+/*
+* Serializes access to the playback/record session while firmware
+* commands are sent from more than one thread, NULL otherwise.
+*/
+static OS_MUTEX *gPbrPassThruMutex = NULL;
+
+EFI_STATUS
+EFIAPI
+SetPassThruPbrLocking(
+  IN     BOOLEAN Enable
+)
+{
+  if (Enable && NULL == gPbrPassThruMutex) {
+    gPbrPassThruMutex = os_mutex_init(NULL);
+    if (NULL == gPbrPassThruMutex) {
+      return EFI_OUT_OF_RESOURCES;
+    }
+  } else if (!Enable && NULL != gPbrPassThruMutex) {
+    os_mutex_delete(gPbrPassThruMutex, NULL);
+    gPbrPassThruMutex = NULL;
+  }
+  return EFI_SUCCESS;
+}
+
+#define INI_PREFERENCES_FW_CMD_STATS_ENABLED L"FW_CMD_STATS_ENABLED"
+#define FW_CMD_STATS_INITIAL_SLOTS 64
+
+/*
+* Firmware command statistics, an open addressing hash table keyed by
+* DIMM handle, opcode and subopcode. A slot is free while its Calls
+* counter is 0. The lock is created the first time the collection is
+* enabled and kept until the process exits, so that DefaultPassThru()
+* only has to read gFwCmdStatsEnabled while the collection is off.
+*/
+static volatile BOOLEAN gFwCmdStatsEnabled = FALSE;
+static OS_MUTEX *gFwCmdStatsMutex = NULL;
+static FW_CMD_STATS *gpFwCmdStats = NULL;
+static UINT32 gFwCmdStatsSlots = 0;
+static UINT32 gFwCmdStatsUsed = 0;
+
+/*
+* Returns the slot holding the given key, or the free slot it would take
+*/
+static UINT32 fw_cmd_stats_probe(FW_CMD_STATS *pTable, UINT32 Slots,
+  UINT32 DimmHandle, UINT8 Opcode, UINT8 SubOpcode)
+{
+  UINT64 Key = ((UINT64)DimmHandle << 16) | ((UINT64)Opcode << 8) | SubOpcode;
+  UINT32 Slot = (UINT32)((Key * 0x9E3779B97F4A7C15ULL) >> 32) & (Slots - 1);
+
+  while (0 != pTable[Slot].Calls &&
+    (pTable[Slot].DimmHandle != DimmHandle || pTable[Slot].Opcode != Opcode ||
+     pTable[Slot].SubOpcode != SubOpcode)) {
+    Slot = (Slot + 1) & (Slots - 1);
+  }
+  return Slot;
+}
+
+/*
+* Doubles the table, returns FALSE if it could not be allocated.
+* Must be called with gFwCmdStatsMutex held.
+*/
+static BOOLEAN fw_cmd_stats_grow()
+{
+  UINT32 Slots = (0 == gFwCmdStatsSlots) ? FW_CMD_STATS_INITIAL_SLOTS : gFwCmdStatsSlots * 2;
+  FW_CMD_STATS *pTable = calloc(Slots, sizeof(*pTable));
+  UINT32 Index;
+  UINT32 Slot;
+
+  if (NULL == pTable) {
+    return FALSE;
+  }
+  for (Index = 0; Index < gFwCmdStatsSlots; Index++) {
+    if (0 == gpFwCmdStats[Index].Calls) {
+      continue;
+    }
+    Slot = fw_cmd_stats_probe(pTable, Slots, gpFwCmdStats[Index].DimmHandle,
+      gpFwCmdStats[Index].Opcode, gpFwCmdStats[Index].SubOpcode);
+    pTable[Slot] = gpFwCmdStats[Index];
+  }
+  free(gpFwCmdStats);
+  gpFwCmdStats = pTable;
+  gFwCmdStatsSlots = Slots;
+  return TRUE;
+}
+
+/*
+* Accounts one command sent by DefaultPassThru()
+*/
+static void fw_cmd_stats_record(UINT32 DimmHandle, NVM_FW_CMD *pCmd,
+  EFI_STATUS Rc, UINT64 LatencyUs, UINT32 Retries)
+{
+  FW_CMD_STATS *pEntry = NULL;
+  UINT32 Slot;
+  UINT32 Bucket = 0;
+  UINT64 Value;
+
+  os_mutex_lock(gFwCmdStatsMutex);
+  if (0 != gFwCmdStatsSlots) {
+    Slot = fw_cmd_stats_probe(gpFwCmdStats, gFwCmdStatsSlots, DimmHandle, pCmd->Opcode, pCmd->SubOpcode);
+    if (0 != gpFwCmdStats[Slot].Calls) {
+      pEntry = &gpFwCmdStats[Slot];
+    }
+  }
+  if (NULL == pEntry) {
+    // Keep the table at most half full, a full one is only probed when growing failed
+    if (2 * (gFwCmdStatsUsed + 1) > gFwCmdStatsSlots && !fw_cmd_stats_grow() &&
+        gFwCmdStatsUsed + 1 >= gFwCmdStatsSlots) {
+      os_mutex_unlock(gFwCmdStatsMutex);
+      return;
+    }
+    Slot = fw_cmd_stats_probe(gpFwCmdStats, gFwCmdStatsSlots, DimmHandle, pCmd->Opcode, pCmd->SubOpcode);
+    pEntry = &gpFwCmdStats[Slot];
+    pEntry->DimmHandle = DimmHandle;
+    pEntry->Opcode = pCmd->Opcode;
+    pEntry->SubOpcode = pCmd->SubOpcode;
+    pEntry->MinUs = MAX_UINT64;
+    gFwCmdStatsUsed++;
+  }
+
+  pEntry->Calls++;
+  pEntry->Retries += Retries;
+  pEntry->BytesIn += (UINT64)pCmd->InputPayloadSize + pCmd->LargeInputPayloadSize;
+  if (EFI_ERROR(Rc)) {
+    pEntry->Errors++;
+  } else {
+    pEntry->BytesOut += (UINT64)pCmd->OutputPayloadSize + pCmd->LargeOutputPayloadSize;
+  }
+  pEntry->FisStatus[MIN(pCmd->Status, FW_CMD_STATS_STATUS_BUCKETS - 1)]++;
+
+  pEntry->TotalUs += LatencyUs;
+  pEntry->MinUs = MIN(pEntry->MinUs, LatencyUs);
+  pEntry->MaxUs = MAX(pEntry->MaxUs, LatencyUs);
+  for (Value = LatencyUs >> 1; 0 != Value && Bucket < FW_CMD_STATS_LATENCY_BUCKETS - 1; Value >>= 1) {
+    Bucket++;
+  }
+  pEntry->LatencyUs[Bucket]++;
+  os_mutex_unlock(gFwCmdStatsMutex);
+}
+
+VOID
+EFIAPI
+FwCmdStatsInit(
+)
+{
+  EFI_STATUS efi_status;
+  EFI_GUID guid = { 0 };
+  UINTN size;
+  UINT8 value = 0;
+
+  size = sizeof(value);
+  efi_status = GET_VARIABLE(INI_PREFERENCES_FW_CMD_STATS_ENABLED, guid, &size, &value);
+  if (EFI_SUCCESS == efi_status && 1 == value) {
+    FwCmdStatsEnable(TRUE);
+  }
+}
+
+EFI_STATUS
+EFIAPI
+FwCmdStatsEnable(
+  IN     BOOLEAN Enable
+)
+{
+  if (Enable && NULL == gFwCmdStatsMutex) {
+    gFwCmdStatsMutex = os_mutex_init(NULL);
+    if (NULL == gFwCmdStatsMutex) {
+      return EFI_OUT_OF_RESOURCES;
+    }
+  }
+  gFwCmdStatsEnabled = Enable;
+  return EFI_SUCCESS;
+}
+
+BOOLEAN
+EFIAPI
+FwCmdStatsEnabled(
+)
+{
+  return gFwCmdStatsEnabled;
+}
+
+VOID
+EFIAPI
+FwCmdStatsReset(
+)
+{
+  if (NULL == gFwCmdStatsMutex) {
+    return;
+  }
+  os_mutex_lock(gFwCmdStatsMutex);
+  free(gpFwCmdStats);
+  gpFwCmdStats = NULL;
+  gFwCmdStatsSlots = 0;
+  gFwCmdStatsUsed = 0;
+  os_mutex_unlock(gFwCmdStatsMutex);
+}
+
+EFI_STATUS
+EFIAPI
+FwCmdStatsGet(
+  IN     UINT32 DimmHandle,
+     OUT FW_CMD_STATS *pStats OPTIONAL,
+  IN OUT UINT32 *pCount
+)
+{
+  EFI_STATUS Rc = EFI_SUCCESS;
+  FW_CMD_STATS Entry;
+  UINT32 Found = 0;
+  UINT32 Index;
+  UINT32 Sorted;
+
+  if (NULL == pCount || (NULL == pStats && 0 != *pCount)) {
+    return EFI_INVALID_PARAMETER;
+  }
+  if (NULL == gFwCmdStatsMutex) {
+    *pCount = 0;
+    return EFI_SUCCESS;
+  }
+
+  os_mutex_lock(gFwCmdStatsMutex);
+  for (Index = 0; Index < gFwCmdStatsSlots; Index++) {
+    if (0 == gpFwCmdStats[Index].Calls || gpFwCmdStats[Index].DimmHandle != DimmHandle) {
+      continue;
+    }
+    if (Found < *pCount) {
+      // Insertion sort, a module only gets a few dozen different commands
+      Entry = gpFwCmdStats[Index];
+      for (Sorted = Found; Sorted > 0 &&
+        ((pStats[Sorted - 1].Opcode << 8) | pStats[Sorted - 1].SubOpcode) > ((Entry.Opcode << 8) | Entry.SubOpcode);
+        Sorted--) {
+        pStats[Sorted] = pStats[Sorted - 1];
+      }
+      pStats[Sorted] = Entry;
+    }
+    Found++;
+  }
+  os_mutex_unlock(gFwCmdStatsMutex);
+
+  if (Found > *pCount) {
+    Rc = EFI_BUFFER_TOO_SMALL;
+  }
+  *pCount = Found;
+  return Rc;
+}
+
 EFI_STATUS
 EFIAPI
 DefaultPassThru(
@@ -122,27 +383,45 @@ DefaultPassThru(
   EFI_STATUS Rc = EFI_SUCCESS;
   EFI_STATUS PbrRc = EFI_SUCCESS;
   UINT32 DimmID;
+  UINT64 StartUs;
   PbrContext *pContext = PBR_CTX();
 
   if (!pDimm || !pCmd)
     return EFI_INVALID_PARAMETER;
 
+  // Records are keyed by the device handle, in both modes
+  DimmID = pCmd->DimmID;
+  pCmd->DimmID = pDimm->DeviceHandle.AsUint32;
+
   if (PBR_PLAYBACK_MODE == PBR_GET_MODE(pContext))
   {
+    os_mutex_lock(gPbrPassThruMutex);
     Rc = PbrGetPassThruRecord(pContext, pCmd, &PbrRc);
+    os_mutex_unlock(gPbrPassThruMutex);
     if (EFI_SUCCESS == Rc) {
       Rc = PbrRc;
     }
+    pCmd->DimmID = DimmID;
     return Rc;
   }
 
-  DimmID = pCmd->DimmID;
-  pCmd->DimmID = pDimm->DeviceHandle.AsUint32;
-  Rc = passthru_os(pDimm, pCmd, (long)Timeout);
+  if (gFwCmdStatsEnabled)
+  {
+    StartUs = os_get_monotonic_us();
+    Rc = passthru_os(pDimm, pCmd, (long)Timeout);
+    fw_cmd_stats_record(pCmd->DimmID, pCmd, Rc, os_get_monotonic_us() - StartUs,
+      passthru_os_last_retries());
+  }
+  else
+  {
+    Rc = passthru_os(pDimm, pCmd, (long)Timeout);
+  }
 
   if (PBR_RECORD_MODE == PBR_GET_MODE(pContext))
   {
+      os_mutex_lock(gPbrPassThruMutex);
       PbrRc = PbrSetPassThruRecord(pContext, pCmd, Rc);
+      os_mutex_unlock(gPbrPassThruMutex);
 
       // If PBR fails, show error but don't abort
       if (EFI_SUCCESS != PbrRc) {
@@ -375,6 +654,28 @@ Finish:
   return ReturnCode;
 }
 
+/*
+* Error levels printed with the given configuration
+*/
+static UINTN get_logger_level_mask(struct debug_logger_config *p_log_config)
+{
+  if (LOGGER_OFF == p_log_config->level ||
+    (FALSE == p_log_config->stdout_enabled && !debug_log_ring_is_open()))
+    return 0;
+
+  switch (p_log_config->level)
+  {
+  case LOG_ERROR:
+    return OS_DEBUG_ERROR;
+  case LOG_WARNING:
+    return OS_DEBUG_ERROR | OS_DEBUG_WARN;
+  case LOG_INFO:
+    return OS_DEBUG_ERROR | OS_DEBUG_WARN | OS_DEBUG_INFO;
+  default:
+    return MAX_UINTN;
+  }
+}
+
 /*
 * Function get the ini configuration only on the first call
 */
@@ -383,25 +684,71 @@ static void get_logger_config(struct debug_logger_config *p_log_config)
   EFI_STATUS efi_status;
   EFI_GUID guid = { 0 };
   UINTN size;
+  OS_PATH ring_file = { 0 };
 
   if (p_log_config->initialized)
     return;
 
+  os_mutex_lock(g_log_config_mutex);
+  if (p_log_config->initialized)
+    goto finish;
+
   size = sizeof(p_log_config->level);
   efi_status = GET_VARIABLE(INI_PREFERENCES_LOG_LEVEL, guid, &size, &p_log_config->level);
   if (EFI_SUCCESS != efi_status)
-    return;
+    goto finish;
   size = sizeof(p_log_config->stdout_enabled);
   efi_status = GET_VARIABLE(INI_PREFERENCES_LOG_STDOUT_ENABLED, guid, &size, &p_log_config->stdout_enabled);
   if (EFI_SUCCESS != efi_status)
-    return;
+    goto finish;
   if (is_verbose_debug_print_enabled())
   {
     p_log_config->stdout_enabled = TRUE;
     p_log_config->level = LOG_VERBOSE;
   }
 
+  // Optional, the messages are also written to a binary file by a background thread
+  if (LOGGER_OFF != p_log_config->level &&
+    EFI_SUCCESS == preferences_get_string_ascii(INI_PREFERENCES_LOG_RING_FILE, guid, sizeof(ring_file), ring_file) &&
+    '\0' != ring_file[0])
+  {
+    debug_log_ring_open(ring_file, LOG_RING_DEFAULT_SIZE);
+  }
+
+  g_debug_print_mask = get_logger_level_mask(p_log_config);
   p_log_config->initialized = TRUE;
+
+finish:
+  os_mutex_unlock(g_log_config_mutex);
+}
+
+/*
+* Function reads the logger configuration, called once the preferences are loaded
+*/
+VOID
+EFIAPI
+DebugLoggerInit(
+  VOID
+)
+{
+  if (NULL == g_log_config_mutex)
+    g_log_config_mutex = os_mutex_init(NULL);
+  get_logger_config(&g_log_config);
+}
+
+/*
+* Function flushes and closes the binary log file, the configuration is read
+* again by the next DebugLoggerInit()
+*/
+VOID
+EFIAPI
+DebugLoggerUninit(
+  VOID
+)
+{
+  debug_log_ring_close();
+  g_log_config.initialized = FALSE;
+  g_debug_print_mask = MAX_UINTN;
 }
 
 /*
@@ -430,6 +777,7 @@ DebugLoggerEnable(
     if (TRUE == g_log_config.stdout_enabled)
       g_log_config.stdout_enabled = FALSE;
   }
+  g_debug_print_mask = get_logger_level_mask(&g_log_config);
 
   return 0;
 }
@@ -460,14 +808,13 @@ void (*rel_assert) (void) = NULL;
 static void write_system_event_to_stdout(const char* source, const char* message)
 {
   RETURN_STATUS ReturnCode = EFI_SUCCESS;
-  NVM_EVENT_MSG ascii_event_message = { 0 };
-  CHAR16 w_event_message[sizeof(ascii_event_message)] = { 0 };
+  NVM_EVENT_MSG ascii_event_message;
+  CHAR16 w_event_message[sizeof(ascii_event_message)];
 
-  // Prepare string
-  os_strcat(ascii_event_message, sizeof(ascii_event_message), source);
-  os_strcat(ascii_event_message, sizeof(ascii_event_message), " ");
-  os_strcat(ascii_event_message, sizeof(ascii_event_message), message);
-  os_strcat(ascii_event_message, sizeof(ascii_event_message), "\n");
+  // Prepare string, truncated like the message itself when too long
+  if (os_snprintf(ascii_event_message, sizeof(ascii_event_message), "%s %s\n", source, message) < 0)
+    ascii_event_message[0] = '\0';
+  ascii_event_message[sizeof(ascii_event_message) - 1] = '\0';
 
   // Convert to the unicode  --  length of array is sizeof(ascii_event_message)
   CHECK_RESULT(ConvertAsciiStrToUnicode(ascii_event_message, w_event_message, sizeof(ascii_event_message)), Finish);
@@ -522,14 +869,20 @@ DebugPrint(
 #else // NDEBUG
     assert(FALSE);
 #endif // NDEBUG
+    return;
   }
-  else if (LOGGER_OFF == g_log_config.level || g_log_config.stdout_enabled == FALSE)
+  else if (FALSE == g_log_config.initialized || 0 == (g_debug_print_mask & ErrorLevel))
     return;
 
-  if (((LOG_ERROR == g_log_config.level) & (ErrorLevel == OS_DEBUG_ERROR)) ||
-    ((LOG_WARNING == g_log_config.level) & ((ErrorLevel == OS_DEBUG_ERROR) || (ErrorLevel == OS_DEBUG_WARN))) ||
-    ((LOG_INFO == g_log_config.level) & ((ErrorLevel == OS_DEBUG_ERROR) || (ErrorLevel == OS_DEBUG_WARN) || (ErrorLevel == OS_DEBUG_INFO))) ||
-    (LOG_VERBOSE == g_log_config.level))
+  if (debug_log_ring_is_open())
+  {
+    // Stored unformatted, formatted when the file is decoded
+    VA_START(args, Format);
+    debug_log_ring_write(ErrorLevel, Format, args);
+    VA_END(args);
+  }
+
+  if (TRUE == g_log_config.stdout_enabled)
   {
     // Send the debug entry to the logger
     VA_START(args, Format);
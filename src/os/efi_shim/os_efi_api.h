@@ -157,6 +157,44 @@ passthru_os(
   IN     long Timeout
 );
 
+/**
+releases the OS resources passthru_os keeps open between commands,
+they are acquired again by the next passthru_os call
+**/
+VOID
+passthru_os_release(
+  VOID
+);
+
+/**
+returns the DSM retries the last passthru_os call of the calling
+thread needed, they are not reported as separate commands
+**/
+UINT32
+passthru_os_last_retries(
+  VOID
+);
+
+/**
+reads the debug logger configuration, called once the preferences
+are loaded
+**/
+VOID
+EFIAPI
+DebugLoggerInit(
+  VOID
+);
+
+/**
+flushes and closes the binary debug log, the configuration is read
+again by the next DebugLoggerInit
+**/
+VOID
+EFIAPI
+DebugLoggerUninit(
+  VOID
+);
+
 /**
 provides playback functionality
 
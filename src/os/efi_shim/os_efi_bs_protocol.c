@@ -33,13 +33,29 @@ extern EFI_GUID  gEfiSimpleFileSystemProtocolGuid;
 extern EFI_GUID gNvmDimmPbrProtocolGuid;
 extern EFI_DCPMM_PBR_PROTOCOL gNvmDimmDriverNvmDimmPbr;
 
+#define TIMER_EVENT_SIGNATURE SIGNATURE_32('O', 'S', 'T', 'E')
+// Interval used when SetTimer() asks for "the next timer tick" (TriggerTime 0)
+#define TIMER_EVENT_TICK_100NS 100000
+
 typedef struct _TIMER_EVENT_CONTEXT {
+	UINT32 signature;
 	void * notify_context;
 	EFI_TIMER_DELAY timer_type;
-	UINT64 timeout_sec;
-	INT64 timeout_sec_remaining;
+	UINT64 trigger_time; // in 100ns units, as passed to SetTimer()
+	OS_TIMER * p_timer;
 }TIMER_EVENT_CONTEXT;
 
+static TIMER_EVENT_CONTEXT *get_timer_event(EFI_EVENT Event)
+{
+	TIMER_EVENT_CONTEXT * pEc = (TIMER_EVENT_CONTEXT *)Event;
+
+	if (NULL == pEc || TIMER_EVENT_SIGNATURE != pEc->signature)
+	{
+		return NULL;
+	}
+	return pEc;
+}
+
 
 
 #define PROTOCOL_HANDLE_NVDIMM_CONFIG 0x1
@@ -124,16 +140,25 @@ create_event(
 	OUT EFI_EVENT                    *Event
 )
 {
+	if (NULL == Event)
+	{
+		return EFI_INVALID_PARAMETER;
+	}
 	if (EVT_TIMER == Type)
 	{
 		TIMER_EVENT_CONTEXT * pEc = (TIMER_EVENT_CONTEXT *)AllocatePool(sizeof(TIMER_EVENT_CONTEXT));
         if (NULL == pEc) {
             return EFI_OUT_OF_RESOURCES;
         }
+		pEc->p_timer = os_timer_create();
+		if (NULL == pEc->p_timer) {
+			FreePool(pEc);
+			return EFI_OUT_OF_RESOURCES;
+		}
+		pEc->signature = TIMER_EVENT_SIGNATURE;
 		pEc->notify_context = NotifyContext;
-		pEc->timer_type = Type;
-		pEc->timeout_sec = 0;
-		pEc->timeout_sec_remaining = 0;
+		pEc->timer_type = TimerCancel;
+		pEc->trigger_time = 0;
 		*Event = (EFI_EVENT)pEc;
 		return EFI_SUCCESS;
 	}
@@ -143,6 +168,13 @@ create_event(
 	}
 }
 
+/**
+Arms, rearms or cancels a timer event with full 100ns precision.
+
+A TriggerTime of 0 signals on the next TIMER_EVENT_TICK_100NS tick, as the
+UEFI spec describes for a platform timer. Periodic timers keep their phase
+from the moment SetTimer() was called rather than from each wait.
+**/
 EFI_STATUS
 set_timer(
 	IN  EFI_EVENT                Event,
@@ -150,19 +182,43 @@ set_timer(
 	IN  UINT64                   TriggerTime
 )
 {
-	TIMER_EVENT_CONTEXT * pEc = (TIMER_EVENT_CONTEXT *)Event;
+	TIMER_EVENT_CONTEXT * pEc = get_timer_event(Event);
+	UINT64 due = 0;
+	UINT64 period = 0;
 
 	if (NULL == pEc)
 	{
 		return EFI_INVALID_PARAMETER;
 	}
+	switch (Type)
+	{
+	case TimerCancel:
+		break;
+	case TimerPeriodic:
+		due = period = (0 == TriggerTime) ? TIMER_EVENT_TICK_100NS : TriggerTime;
+		break;
+	case TimerRelative:
+		due = (0 == TriggerTime) ? TIMER_EVENT_TICK_100NS : TriggerTime;
+		break;
+	default:
+		return EFI_INVALID_PARAMETER;
+	}
+	if (0 != os_timer_set(pEc->p_timer, due, period))
+	{
+		return EFI_DEVICE_ERROR;
+	}
 	pEc->timer_type = Type;
-	pEc->timeout_sec = pEc->timeout_sec_remaining = TriggerTime/ 10000000; //for now WA for UEFI/OS differences
-	if (0 == pEc->timeout_sec)
-		pEc->timeout_sec = pEc->timeout_sec_remaining = 1;
+	pEc->trigger_time = TriggerTime;
 	return EFI_SUCCESS;
 }
 
+/**
+Blocks until one of the timer events is signaled.
+
+Any mix of periodic and relative timers may be passed. Index receives the
+lowest signaled event, which is reset; other signaled events stay signaled
+for the next call, matching the UEFI WaitForEvent() contract.
+**/
 EFI_STATUS
 wait_for_event(
 	IN  UINTN                    NumberOfEvents,
@@ -170,39 +226,35 @@ wait_for_event(
 	OUT UINTN                    *Index
 )
 {
+	OS_TIMER * timers[OS_TIMER_WAIT_MAX];
+	TIMER_EVENT_CONTEXT * pEc = NULL;
+	unsigned int signaled = 0;
 	UINTN index;
-	TIMER_EVENT_CONTEXT ** pEc = (TIMER_EVENT_CONTEXT **)Event;
-	UINTN index_that_timed_out = 0;
-	BOOLEAN index_timed_out = FALSE;
-	INT64 lowest_timeout_val = pEc[0]->timeout_sec_remaining;
 
-	for (index = 0; index < NumberOfEvents; ++index)
+	if (NULL == Event || NULL == Index || 0 == NumberOfEvents)
 	{
-		if (pEc[index]->timeout_sec_remaining < lowest_timeout_val)
-			lowest_timeout_val = pEc[index]->timeout_sec_remaining;
-		if (0 >= pEc[index]->timeout_sec_remaining)
-		{
-			index_that_timed_out = index;
-			goto done;
-		}
+		return EFI_INVALID_PARAMETER;
+	}
+	if (OS_TIMER_WAIT_MAX < NumberOfEvents)
+	{
+		return EFI_UNSUPPORTED;
 	}
-
-	wait_for_sec((unsigned int)lowest_timeout_val);
 	for (index = 0; index < NumberOfEvents; ++index)
 	{
-		pEc[index]->timeout_sec_remaining -= lowest_timeout_val;
-		if (0 >= pEc[index]->timeout_sec_remaining && FALSE == index_timed_out)
+		pEc = get_timer_event(Event[index]);
+		if (NULL == pEc)
 		{
-			index_that_timed_out = index;
-			index_timed_out = TRUE;
+			*Index = index;
+			return EFI_INVALID_PARAMETER;
 		}
+		timers[index] = pEc->p_timer;
 	}
-done:
-	*Index = index_that_timed_out;
-	if (TimerPeriodic == pEc[index_that_timed_out]->timer_type)
+
+	if (0 != os_timer_wait(timers, (unsigned int)NumberOfEvents, &signaled))
 	{
-		pEc[index_that_timed_out]->timeout_sec_remaining = pEc[index_that_timed_out]->timeout_sec;
+		return EFI_DEVICE_ERROR;
 	}
+	*Index = signaled;
 	return EFI_SUCCESS;
 }
 
@@ -211,7 +263,15 @@ close_event(
 	IN EFI_EVENT                Event
 )
 {
-	FreePool(Event);
+	TIMER_EVENT_CONTEXT * pEc = get_timer_event(Event);
+
+	if (NULL == pEc)
+	{
+		return EFI_INVALID_PARAMETER;
+	}
+	os_timer_delete(pEc->p_timer);
+	pEc->signature = 0;
+	FreePool(pEc);
 	return EFI_SUCCESS;
 }
 
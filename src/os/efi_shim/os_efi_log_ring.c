@@ -0,0 +1,954 @@
+/*
+ * Copyright (c) 2018, Intel Corporation.
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <time.h>
+#include <wchar.h>
+#include "os.h"
+#include "os_str.h"
+#include "os_efi_log_ring.h"
+
+/*
+* Binary log file layout. Every record is a UINT16 type and a UINT16 payload
+* length followed by the payload, all fields in host byte order.
+*   SESSION  magic, version, reserved, UINT64 wall clock seconds, UINT64 start us
+*   FORMAT   UINT32 format id, format string without the terminator
+*   MESSAGE  UINT64 time us, UINT64 thread id, UINT32 level, UINT32 format id,
+*            the arguments in format string order
+*   DROPPED  UINT32 number of messages that did not fit in the ring
+* Integer, pointer and floating point arguments take 8 bytes, strings a UINT16
+* length followed by the characters. Format ids are only valid within the
+* session that defined them.
+*/
+#define LOG_RING_MAGIC            "IPMCTLDL"
+#define LOG_RING_MAGIC_LEN        8
+#define LOG_RING_VERSION          1
+
+#define LOG_RING_REC_SESSION      1
+#define LOG_RING_REC_FORMAT       2
+#define LOG_RING_REC_MESSAGE      3
+#define LOG_RING_REC_DROPPED      4
+
+#define LOG_RING_REC_HEADER_LEN   4
+#define LOG_RING_SESSION_LEN      32
+#define LOG_RING_MSG_HEADER_LEN   24
+#define LOG_RING_MAX_PAYLOAD      4096
+#define LOG_RING_MIN_SIZE         (16 * LOG_RING_MAX_PAYLOAD)
+#define LOG_RING_FORMAT_SLOTS     4096     // power of 2
+#define LOG_RING_FLUSH_MS         100
+#define LOG_RING_SPEC_MAX         64
+
+enum log_ring_arg_size
+{
+  LOG_RING_ARG_INT = 0,
+  LOG_RING_ARG_CHAR,
+  LOG_RING_ARG_SHORT,
+  LOG_RING_ARG_LONG,
+  LOG_RING_ARG_LONG_LONG,
+  LOG_RING_ARG_INTMAX,
+  LOG_RING_ARG_SIZE,
+  LOG_RING_ARG_PTRDIFF,
+  LOG_RING_ARG_LONG_DOUBLE
+};
+
+/*
+* One printf conversion specification
+*/
+struct log_ring_spec
+{
+  CONST CHAR8 *p_flags;
+  UINT32 flags_len;
+  BOOLEAN width_arg;          // '*' width, taken from the arguments
+  CONST CHAR8 *p_width;
+  UINT32 width_len;
+  BOOLEAN has_precision;
+  BOOLEAN precision_arg;      // '*' precision, taken from the arguments
+  CONST CHAR8 *p_precision;
+  UINT32 precision_len;
+  UINT32 precision;
+  enum log_ring_arg_size size;
+  CHAR8 conversion;
+  CONST CHAR8 *p_end;         // first character after the specification
+};
+
+struct log_ring_format_slot
+{
+  CONST CHAR8 *p_format;
+  UINT32 hash;
+  UINT32 id;
+};
+
+/*
+* Ring state, everything but the mutex is protected by the mutex
+*/
+static struct
+{
+  OS_MUTEX *p_mutex;          // created on the first open and never released
+  OS_NOTIFIER *p_notifier;
+  unsigned long long thread_id;
+  FILE *p_file;
+  UINT8 *p_ring;
+  UINT8 *p_chunk;             // ring content taken by the writer thread
+  UINT32 size;
+  UINT64 head;                // bytes put by the producers
+  UINT64 tail;                // bytes taken by the writer thread
+  UINT32 dropped;
+  UINT32 next_format_id;
+  UINT32 format_count;
+  BOOLEAN stop;
+  struct log_ring_format_slot formats[LOG_RING_FORMAT_SLOTS];
+} g_log_ring;
+
+static volatile BOOLEAN g_log_ring_open = FALSE;
+
+/*
+* Parse the conversion specification p_spec points to ('%'). Returns FALSE for
+* specifications the ring does not know how to store, the rest of the format
+* string is treated as text then.
+*/
+static BOOLEAN log_ring_parse_spec(CONST CHAR8 *p_spec, struct log_ring_spec *p)
+{
+  CONST CHAR8 *c = p_spec + 1;
+
+  memset(p, 0, sizeof(*p));
+  p->p_flags = c;
+  while ('\0' != *c && NULL != strchr("-+ #0'", *c)) {
+    c++;
+  }
+  p->flags_len = (UINT32)(c - p->p_flags);
+
+  if ('*' == *c) {
+    p->width_arg = TRUE;
+    c++;
+  } else {
+    p->p_width = c;
+    while (*c >= '0' && *c <= '9') {
+      c++;
+    }
+    p->width_len = (UINT32)(c - p->p_width);
+  }
+
+  if ('.' == *c) {
+    c++;
+    p->has_precision = TRUE;
+    if ('*' == *c) {
+      p->precision_arg = TRUE;
+      c++;
+    } else {
+      p->p_precision = c;
+      while (*c >= '0' && *c <= '9') {
+        if (p->precision < LOG_RING_MAX_PAYLOAD) {
+          p->precision = p->precision * 10 + (*c - '0');
+        }
+        c++;
+      }
+      p->precision_len = (UINT32)(c - p->p_precision);
+    }
+  }
+
+  switch (*c) {
+  case 'h':
+    c++;
+    p->size = LOG_RING_ARG_SHORT;
+    if ('h' == *c) {
+      c++;
+      p->size = LOG_RING_ARG_CHAR;
+    }
+    break;
+  case 'l':
+    c++;
+    p->size = LOG_RING_ARG_LONG;
+    if ('l' == *c) {
+      c++;
+      p->size = LOG_RING_ARG_LONG_LONG;
+    }
+    break;
+  case 'q':
+    c++;
+    p->size = LOG_RING_ARG_LONG_LONG;
+    break;
+  case 'j':
+    c++;
+    p->size = LOG_RING_ARG_INTMAX;
+    break;
+  case 'z':
+    c++;
+    p->size = LOG_RING_ARG_SIZE;
+    break;
+  case 't':
+    c++;
+    p->size = LOG_RING_ARG_PTRDIFF;
+    break;
+  case 'L':
+    c++;
+    p->size = LOG_RING_ARG_LONG_DOUBLE;
+    break;
+  case 'I':
+    // MSVC I64, I32 and I size prefixes
+    c++;
+    p->size = LOG_RING_ARG_SIZE;
+    if ('6' == c[0] && '4' == c[1]) {
+      c += 2;
+      p->size = LOG_RING_ARG_LONG_LONG;
+    } else if ('3' == c[0] && '2' == c[1]) {
+      c += 2;
+      p->size = LOG_RING_ARG_INT;
+    }
+    break;
+  default:
+    break;
+  }
+
+  p->conversion = *c;
+  if ('S' == p->conversion) {
+    p->conversion = 's';
+    p->size = LOG_RING_ARG_LONG;
+  }
+  if ('\0' == p->conversion || NULL == strchr("diouxXcspneEfFgGaA%", p->conversion)) {
+    return FALSE;
+  }
+  p->p_end = c + 1;
+  return TRUE;
+}
+
+static BOOLEAN log_ring_is_signed(CHAR8 conversion)
+{
+  return ('d' == conversion || 'i' == conversion);
+}
+
+static BOOLEAN log_ring_is_unsigned(CHAR8 conversion)
+{
+  return (NULL != strchr("ouxX", conversion));
+}
+
+static BOOLEAN log_ring_is_real(CHAR8 conversion)
+{
+  return (NULL != strchr("eEfFgGaA", conversion));
+}
+
+/*
+* Append value_size bytes to the captured arguments, FALSE when they do not fit
+*/
+static BOOLEAN log_ring_put_arg(UINT8 *p_out, UINT32 out_size, UINT32 *p_length,
+  CONST VOID *p_value, UINT32 value_size)
+{
+  if (out_size - *p_length < value_size) {
+    return FALSE;
+  }
+  memcpy(p_out + *p_length, p_value, value_size);
+  *p_length += value_size;
+  return TRUE;
+}
+
+/*
+* Store the arguments of a format string without formatting them
+*/
+static BOOLEAN log_ring_capture(CONST CHAR8 *p_format, va_list args, UINT8 *p_out, UINT32 out_size,
+  UINT32 *p_length)
+{
+  struct log_ring_spec spec;
+  CONST CHAR8 *p = p_format;
+  CONST CHAR8 *p_str = NULL;
+  CHAR8 wide_str[LOG_RING_MAX_PAYLOAD];
+  INT64 star = 0;
+  UINT64 value = 0;
+  double real = 0;
+  UINT32 limit = 0;
+  UINT16 str_len = 0;
+  BOOLEAN fits = TRUE;
+  va_list ap;
+
+  *p_length = 0;
+  va_copy(ap, args);
+  while (fits && NULL != (p = strchr(p, '%'))) {
+    if (!log_ring_parse_spec(p, &spec)) {
+      break;
+    }
+    p = spec.p_end;
+    if ('%' == spec.conversion) {
+      continue;
+    }
+
+    if (spec.width_arg) {
+      star = va_arg(ap, int);
+      fits = fits && log_ring_put_arg(p_out, out_size, p_length, &star, sizeof(star));
+    }
+    limit = spec.has_precision ? spec.precision : LOG_RING_MAX_PAYLOAD;
+    if (spec.precision_arg) {
+      star = va_arg(ap, int);
+      limit = (star < 0) ? LOG_RING_MAX_PAYLOAD : (UINT32)((star < LOG_RING_MAX_PAYLOAD) ? star : LOG_RING_MAX_PAYLOAD);
+      fits = fits && log_ring_put_arg(p_out, out_size, p_length, &star, sizeof(star));
+    }
+
+    if (log_ring_is_signed(spec.conversion)) {
+      switch (spec.size) {
+      case LOG_RING_ARG_CHAR:
+        value = (UINT64)(INT64)(signed char)va_arg(ap, int);
+        break;
+      case LOG_RING_ARG_SHORT:
+        value = (UINT64)(INT64)(short)va_arg(ap, int);
+        break;
+      case LOG_RING_ARG_LONG:
+        value = (UINT64)(INT64)va_arg(ap, long);
+        break;
+      case LOG_RING_ARG_LONG_LONG:
+        value = (UINT64)(INT64)va_arg(ap, long long);
+        break;
+      case LOG_RING_ARG_INTMAX:
+        value = (UINT64)(INT64)va_arg(ap, intmax_t);
+        break;
+      case LOG_RING_ARG_SIZE:
+        value = (UINT64)(INT64)(ptrdiff_t)va_arg(ap, size_t);
+        break;
+      case LOG_RING_ARG_PTRDIFF:
+        value = (UINT64)(INT64)va_arg(ap, ptrdiff_t);
+        break;
+      default:
+        value = (UINT64)(INT64)va_arg(ap, int);
+        break;
+      }
+      fits = fits && log_ring_put_arg(p_out, out_size, p_length, &value, sizeof(value));
+    } else if (log_ring_is_unsigned(spec.conversion)) {
+      switch (spec.size) {
+      case LOG_RING_ARG_CHAR:
+        value = (unsigned char)va_arg(ap, unsigned int);
+        break;
+      case LOG_RING_ARG_SHORT:
+        value = (unsigned short)va_arg(ap, unsigned int);
+        break;
+      case LOG_RING_ARG_LONG:
+        value = va_arg(ap, unsigned long);
+        break;
+      case LOG_RING_ARG_LONG_LONG:
+        value = va_arg(ap, unsigned long long);
+        break;
+      case LOG_RING_ARG_INTMAX:
+        value = va_arg(ap, uintmax_t);
+        break;
+      case LOG_RING_ARG_SIZE:
+        value = va_arg(ap, size_t);
+        break;
+      case LOG_RING_ARG_PTRDIFF:
+        value = (UINT64)va_arg(ap, ptrdiff_t);
+        break;
+      default:
+        value = va_arg(ap, unsigned int);
+        break;
+      }
+      fits = fits && log_ring_put_arg(p_out, out_size, p_length, &value, sizeof(value));
+    } else if (log_ring_is_real(spec.conversion)) {
+      real = (LOG_RING_ARG_LONG_DOUBLE == spec.size) ? (double)va_arg(ap, long double) : va_arg(ap, double);
+      fits = fits && log_ring_put_arg(p_out, out_size, p_length, &real, sizeof(real));
+    } else if ('c' == spec.conversion) {
+      value = (UINT64)va_arg(ap, int);
+      fits = fits && log_ring_put_arg(p_out, out_size, p_length, &value, sizeof(value));
+    } else if ('p' == spec.conversion) {
+      value = (UINT64)(uintptr_t)va_arg(ap, void *);
+      fits = fits && log_ring_put_arg(p_out, out_size, p_length, &value, sizeof(value));
+    } else if ('n' == spec.conversion) {
+      (void)va_arg(ap, void *);
+    } else {
+      // 's', wide strings are converted here, they are rare in debug messages
+      if (LOG_RING_ARG_LONG == spec.size) {
+        CONST wchar_t *p_wide = va_arg(ap, wchar_t *);
+        if (limit > sizeof(wide_str) - 1) {
+          limit = sizeof(wide_str) - 1;
+        }
+        if (NULL == p_wide || os_snprintf(wide_str, sizeof(wide_str), "%.*ls", (int)limit, p_wide) < 0) {
+          wide_str[0] = '\0';
+        }
+        p_str = wide_str;
+      } else {
+        p_str = va_arg(ap, char *);
+        if (NULL == p_str) {
+          p_str = "(null)";
+        }
+      }
+      if (out_size - *p_length < sizeof(str_len)) {
+        fits = FALSE;
+        break;
+      }
+      str_len = (UINT16)os_strnlen(p_str, out_size - *p_length - sizeof(str_len) < limit ?
+        out_size - *p_length - sizeof(str_len) : limit);
+      fits = fits && log_ring_put_arg(p_out, out_size, p_length, &str_len, sizeof(str_len));
+      fits = fits && log_ring_put_arg(p_out, out_size, p_length, p_str, str_len);
+    }
+  }
+  va_end(ap);
+
+  return fits;
+}
+
+/*
+* Copy bytes into the ring, the caller checked there is room for them
+*/
+static VOID log_ring_put(CONST VOID *p_data, UINT32 length)
+{
+  UINT32 offset = (UINT32)(g_log_ring.head % g_log_ring.size);
+  UINT32 first = (length < g_log_ring.size - offset) ? length : g_log_ring.size - offset;
+
+  if (0 == length) {
+    return;
+  }
+  memcpy(g_log_ring.p_ring + offset, p_data, first);
+  memcpy(g_log_ring.p_ring, (CONST UINT8 *)p_data + first, length - first);
+  g_log_ring.head += length;
+}
+
+static VOID log_ring_put_record(UINT16 type, CONST VOID *p_prefix, UINT32 prefix_len,
+  CONST VOID *p_payload, UINT32 payload_len)
+{
+  UINT16 header[2];
+
+  header[0] = type;
+  header[1] = (UINT16)(prefix_len + payload_len);
+  log_ring_put(header, sizeof(header));
+  log_ring_put(p_prefix, prefix_len);
+  log_ring_put(p_payload, payload_len);
+}
+
+/*
+* Slot of a format string, NULL when the table is full
+*/
+static struct log_ring_format_slot *log_ring_format_slot(CONST CHAR8 *p_format, UINT32 hash)
+{
+  UINT32 index = (UINT32)(((uintptr_t)p_format >> 3) ^ hash);
+  UINT32 probe = 0;
+  struct log_ring_format_slot *p_slot = NULL;
+
+  for (probe = 0; probe < LOG_RING_FORMAT_SLOTS; probe++) {
+    p_slot = &g_log_ring.formats[(index + probe) & (LOG_RING_FORMAT_SLOTS - 1)];
+    if (NULL == p_slot->p_format || (p_format == p_slot->p_format && hash == p_slot->hash)) {
+      return p_slot;
+    }
+  }
+  return NULL;
+}
+
+/*
+* Move the ring content to the file. Returns TRUE once the ring was closed and
+* everything it held is written.
+*/
+static BOOLEAN log_ring_flush()
+{
+  UINT32 length = 0;
+  UINT32 offset = 0;
+  UINT32 first = 0;
+  UINT32 dropped = 0;
+  UINT16 header[2];
+  BOOLEAN stop = FALSE;
+
+  os_mutex_lock(g_log_ring.p_mutex);
+  length = (UINT32)(g_log_ring.head - g_log_ring.tail);
+  offset = (UINT32)(g_log_ring.tail % g_log_ring.size);
+  first = (length < g_log_ring.size - offset) ? length : g_log_ring.size - offset;
+  memcpy(g_log_ring.p_chunk, g_log_ring.p_ring + offset, first);
+  memcpy(g_log_ring.p_chunk + first, g_log_ring.p_ring, length - first);
+  g_log_ring.tail = g_log_ring.head;
+  dropped = g_log_ring.dropped;
+  g_log_ring.dropped = 0;
+  stop = g_log_ring.stop;
+  os_mutex_unlock(g_log_ring.p_mutex);
+
+  if (0 != length) {
+    fwrite(g_log_ring.p_chunk, 1, length, g_log_ring.p_file);
+  }
+  if (0 != dropped) {
+    header[0] = LOG_RING_REC_DROPPED;
+    header[1] = sizeof(dropped);
+    fwrite(header, sizeof(header), 1, g_log_ring.p_file);
+    fwrite(&dropped, sizeof(dropped), 1, g_log_ring.p_file);
+  }
+  if (0 != length || 0 != dropped) {
+    fflush(g_log_ring.p_file);
+  }
+  return stop;
+}
+
+/*
+* Background thread writing the ring to the file
+*/
+static void *log_ring_writer(void *p_arg)
+{
+  unsigned long long seq = 0;
+  BOOLEAN stop = FALSE;
+
+  while (!stop) {
+    seq = os_notifier_seq(g_log_ring.p_notifier);
+    stop = log_ring_flush();
+    if (!stop) {
+      os_notifier_wait(g_log_ring.p_notifier, seq, LOG_RING_FLUSH_MS);
+    }
+  }
+  return NULL;
+}
+
+static VOID log_ring_release()
+{
+  if (NULL != g_log_ring.p_file) {
+    fclose(g_log_ring.p_file);
+    g_log_ring.p_file = NULL;
+  }
+  if (NULL != g_log_ring.p_notifier) {
+    os_notifier_delete(g_log_ring.p_notifier);
+    g_log_ring.p_notifier = NULL;
+  }
+  free(g_log_ring.p_ring);
+  g_log_ring.p_ring = NULL;
+  free(g_log_ring.p_chunk);
+  g_log_ring.p_chunk = NULL;
+}
+
+EFI_STATUS
+debug_log_ring_open(
+  IN CONST CHAR8 *p_path,
+  IN UINT32 ring_size
+)
+{
+  EFI_STATUS ReturnCode = EFI_SUCCESS;
+  UINT8 session[LOG_RING_SESSION_LEN] = { 0 };
+  UINT32 version = LOG_RING_VERSION;
+  UINT64 wall_clock = (UINT64)time(NULL);
+  UINT64 start_us = os_get_monotonic_us();
+
+  if (NULL == p_path || '\0' == p_path[0]) {
+    return EFI_INVALID_PARAMETER;
+  }
+  if (ring_size < LOG_RING_MIN_SIZE) {
+    ring_size = LOG_RING_MIN_SIZE;
+  }
+  // Unnamed, a named mutex would be shared between processes
+  if (NULL == g_log_ring.p_mutex && NULL == (g_log_ring.p_mutex = os_mutex_init(NULL))) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  os_mutex_lock(g_log_ring.p_mutex);
+  if (g_log_ring_open) {
+    ReturnCode = EFI_ALREADY_STARTED;
+    goto Finish;
+  }
+  if (NULL == (g_log_ring.p_file = fopen(p_path, "ab"))) {
+    ReturnCode = EFI_DEVICE_ERROR;
+    goto Finish;
+  }
+  g_log_ring.p_ring = (UINT8 *)malloc(ring_size);
+  g_log_ring.p_chunk = (UINT8 *)malloc(ring_size);
+  g_log_ring.p_notifier = os_notifier_create();
+  if (NULL == g_log_ring.p_ring || NULL == g_log_ring.p_chunk || NULL == g_log_ring.p_notifier) {
+    log_ring_release();
+    ReturnCode = EFI_OUT_OF_RESOURCES;
+    goto Finish;
+  }
+  g_log_ring.size = ring_size;
+  g_log_ring.head = 0;
+  g_log_ring.tail = 0;
+  g_log_ring.dropped = 0;
+  g_log_ring.next_format_id = 0;
+  g_log_ring.format_count = 0;
+  g_log_ring.stop = FALSE;
+  memset(g_log_ring.formats, 0, sizeof(g_log_ring.formats));
+
+  memcpy(session, LOG_RING_MAGIC, LOG_RING_MAGIC_LEN);
+  memcpy(session + 8, &version, sizeof(version));
+  memcpy(session + 16, &wall_clock, sizeof(wall_clock));
+  memcpy(session + 24, &start_us, sizeof(start_us));
+  log_ring_put_record(LOG_RING_REC_SESSION, session, sizeof(session), NULL, 0);
+
+  os_create_thread(&g_log_ring.thread_id, log_ring_writer, NULL);
+  if (0 == g_log_ring.thread_id) {
+    log_ring_release();
+    ReturnCode = EFI_OUT_OF_RESOURCES;
+    goto Finish;
+  }
+  g_log_ring_open = TRUE;
+
+Finish:
+  os_mutex_unlock(g_log_ring.p_mutex);
+  return ReturnCode;
+}
+
+VOID
+debug_log_ring_close(
+)
+{
+  if (NULL == g_log_ring.p_mutex) {
+    return;
+  }
+
+  os_mutex_lock(g_log_ring.p_mutex);
+  if (!g_log_ring_open) {
+    os_mutex_unlock(g_log_ring.p_mutex);
+    return;
+  }
+  // Producers check the flag under the mutex, nobody touches the ring after this
+  g_log_ring_open = FALSE;
+  g_log_ring.stop = TRUE;
+  os_mutex_unlock(g_log_ring.p_mutex);
+
+  os_notifier_signal(g_log_ring.p_notifier);
+  os_join_thread(g_log_ring.thread_id);
+  log_ring_release();
+}
+
+BOOLEAN
+debug_log_ring_is_open(
+)
+{
+  return g_log_ring_open;
+}
+
+VOID
+debug_log_ring_write(
+  IN UINTN level,
+  IN CONST CHAR8 *p_format,
+  IN va_list args
+)
+{
+  UINT8 payload[LOG_RING_MAX_PAYLOAD];
+  UINT32 args_len = 0;
+  UINT32 format_len = 0;
+  UINT32 format_id = 0;
+  UINT32 hash = 2166136261u;
+  UINT32 needed = 0;
+  UINT64 value = 0;
+  UINT32 level32 = (UINT32)level;
+  struct log_ring_format_slot *p_slot = NULL;
+  BOOLEAN new_format = FALSE;
+  BOOLEAN captured = FALSE;
+  BOOLEAN signal = FALSE;
+  CONST CHAR8 *c = NULL;
+
+  if (!g_log_ring_open || NULL == p_format) {
+    return;
+  }
+
+  // The pointer alone does not identify a format, callers may reuse a buffer
+  for (c = p_format; '\0' != *c; c++) {
+    hash = (hash ^ (UINT8)*c) * 16777619u;
+  }
+  format_len = (UINT32)(c - p_format);
+  if (format_len > LOG_RING_MAX_PAYLOAD - sizeof(format_id)) {
+    format_len = LOG_RING_MAX_PAYLOAD - sizeof(format_id);
+  }
+
+  value = os_get_monotonic_us();
+  memcpy(payload, &value, sizeof(value));
+  value = os_get_thread_id();
+  memcpy(payload + 8, &value, sizeof(value));
+  memcpy(payload + 16, &level32, sizeof(level32));
+  captured = log_ring_capture(p_format, args, payload + LOG_RING_MSG_HEADER_LEN,
+    sizeof(payload) - LOG_RING_MSG_HEADER_LEN, &args_len);
+
+  os_mutex_lock(g_log_ring.p_mutex);
+  if (!g_log_ring_open) {
+    goto Finish;
+  }
+  p_slot = log_ring_format_slot(p_format, hash);
+  new_format = (NULL == p_slot || 0 == p_slot->id);
+  needed = LOG_RING_REC_HEADER_LEN + LOG_RING_MSG_HEADER_LEN + args_len;
+  if (new_format) {
+    needed += LOG_RING_REC_HEADER_LEN + sizeof(format_id) + format_len;
+  }
+  if (!captured || g_log_ring.size - (UINT32)(g_log_ring.head - g_log_ring.tail) < needed) {
+    g_log_ring.dropped++;
+    goto Finish;
+  }
+
+  if (new_format) {
+    format_id = ++g_log_ring.next_format_id;
+    log_ring_put_record(LOG_RING_REC_FORMAT, &format_id, sizeof(format_id), p_format, format_len);
+    // Keep the table sparse, formats past that are defined again on every use
+    if (NULL != p_slot && g_log_ring.format_count < LOG_RING_FORMAT_SLOTS * 3 / 4) {
+      p_slot->p_format = p_format;
+      p_slot->hash = hash;
+      p_slot->id = format_id;
+      g_log_ring.format_count++;
+    }
+  } else {
+    format_id = p_slot->id;
+  }
+  memcpy(payload + 20, &format_id, sizeof(format_id));
+  log_ring_put_record(LOG_RING_REC_MESSAGE, payload, LOG_RING_MSG_HEADER_LEN + args_len, NULL, 0);
+  signal = (g_log_ring.head - g_log_ring.tail >= g_log_ring.size / 2);
+
+Finish:
+  os_mutex_unlock(g_log_ring.p_mutex);
+  // Otherwise the writer thread picks the records up on its next period
+  if (signal) {
+    os_notifier_signal(g_log_ring.p_notifier);
+  }
+}
+
+/*
+* Read the next argument of a MESSAGE record
+*/
+static BOOLEAN log_ring_get_arg(CONST UINT8 *p_args, UINT32 args_len, UINT32 *p_offset,
+  VOID *p_value, UINT32 value_size)
+{
+  if (args_len - *p_offset < value_size) {
+    return FALSE;
+  }
+  memcpy(p_value, p_args + *p_offset, value_size);
+  *p_offset += value_size;
+  return TRUE;
+}
+
+/*
+* Append count characters to a conversion specification being rebuilt
+*/
+static VOID log_ring_spec_append(CHAR8 *p_spec, UINT32 *p_len, CONST CHAR8 *p_text, UINT32 count)
+{
+  if (count > LOG_RING_SPEC_MAX - 1 - *p_len) {
+    count = LOG_RING_SPEC_MAX - 1 - *p_len;
+  }
+  memcpy(p_spec + *p_len, p_text, count);
+  *p_len += count;
+  p_spec[*p_len] = '\0';
+}
+
+/*
+* Format a MESSAGE record, returns the last character written
+*/
+static CHAR8 log_ring_print_message(FILE *p_out, CONST CHAR8 *p_format, CONST UINT8 *p_args, UINT32 args_len)
+{
+  struct log_ring_spec spec;
+  CONST CHAR8 *p = p_format;
+  CONST CHAR8 *p_spec = NULL;
+  CHAR8 spec_str[LOG_RING_SPEC_MAX];
+  CHAR8 number[24];
+  CHAR8 str[LOG_RING_MAX_PAYLOAD + 1];
+  CHAR8 last = '\0';
+  UINT32 spec_len = 0;
+  UINT32 offset = 0;
+  INT64 star = 0;
+  UINT64 value = 0;
+  double real = 0;
+  UINT16 str_len = 0;
+
+  while ('\0' != *p) {
+    if (NULL == (p_spec = strchr(p, '%')) || !log_ring_parse_spec(p_spec, &spec)) {
+      fputs(p, p_out);
+      last = p[strlen(p) - 1];
+      break;
+    }
+    if (p_spec != p) {
+      fwrite(p, 1, p_spec - p, p_out);
+      last = p_spec[-1];
+    }
+    p = spec.p_end;
+    if ('%' == spec.conversion) {
+      fputc('%', p_out);
+      last = '%';
+      continue;
+    }
+
+    // Rebuild the specification with the '*' values and a 64-bit size
+    spec_len = 0;
+    log_ring_spec_append(spec_str, &spec_len, "%", 1);
+    log_ring_spec_append(spec_str, &spec_len, spec.p_flags, spec.flags_len);
+    if (spec.width_arg) {
+      if (!log_ring_get_arg(p_args, args_len, &offset, &star, sizeof(star))) {
+        break;
+      }
+      os_snprintf(number, sizeof(number), "%lld", (long long)star);
+      log_ring_spec_append(spec_str, &spec_len, number, (UINT32)strlen(number));
+    } else {
+      log_ring_spec_append(spec_str, &spec_len, spec.p_width, spec.width_len);
+    }
+    if (spec.precision_arg) {
+      if (!log_ring_get_arg(p_args, args_len, &offset, &star, sizeof(star))) {
+        break;
+      }
+      // A negative precision is taken as if it was omitted
+      if (star >= 0) {
+        os_snprintf(number, sizeof(number), ".%lld", (long long)star);
+        log_ring_spec_append(spec_str, &spec_len, number, (UINT32)strlen(number));
+      }
+    } else if (spec.has_precision) {
+      log_ring_spec_append(spec_str, &spec_len, ".", 1);
+      log_ring_spec_append(spec_str, &spec_len, spec.p_precision, spec.precision_len);
+    }
+    if (log_ring_is_signed(spec.conversion) || log_ring_is_unsigned(spec.conversion)) {
+      log_ring_spec_append(spec_str, &spec_len, "ll", 2);
+    }
+    log_ring_spec_append(spec_str, &spec_len, &spec.conversion, 1);
+    last = '\0';
+
+    if (log_ring_is_signed(spec.conversion)) {
+      if (!log_ring_get_arg(p_args, args_len, &offset, &value, sizeof(value))) {
+        break;
+      }
+      fprintf(p_out, spec_str, (long long)value);
+    } else if (log_ring_is_unsigned(spec.conversion)) {
+      if (!log_ring_get_arg(p_args, args_len, &offset, &value, sizeof(value))) {
+        break;
+      }
+      fprintf(p_out, spec_str, (unsigned long long)value);
+    } else if (log_ring_is_real(spec.conversion)) {
+      if (!log_ring_get_arg(p_args, args_len, &offset, &real, sizeof(real))) {
+        break;
+      }
+      fprintf(p_out, spec_str, real);
+    } else if ('c' == spec.conversion) {
+      if (!log_ring_get_arg(p_args, args_len, &offset, &value, sizeof(value))) {
+        break;
+      }
+      fprintf(p_out, spec_str, (int)value);
+    } else if ('p' == spec.conversion) {
+      if (!log_ring_get_arg(p_args, args_len, &offset, &value, sizeof(value))) {
+        break;
+      }
+      fprintf(p_out, spec_str, (void *)(uintptr_t)value);
+    } else if ('s' == spec.conversion) {
+      if (!log_ring_get_arg(p_args, args_len, &offset, &str_len, sizeof(str_len)) ||
+          !log_ring_get_arg(p_args, args_len, &offset, str, str_len)) {
+        break;
+      }
+      str[str_len] = '\0';
+      fprintf(p_out, spec_str, str);
+      if (0 != str_len) {
+        last = str[str_len - 1];
+      }
+    }
+  }
+
+  return last;
+}
+
+EFI_STATUS
+debug_log_ring_decode(
+  IN CONST CHAR8 *p_path,
+  IN FILE *p_out
+)
+{
+  EFI_STATUS ReturnCode = EFI_SUCCESS;
+  FILE *p_in = NULL;
+  UINT8 *p_payload = NULL;
+  CHAR8 **pp_formats = NULL;
+  CHAR8 **pp_grown = NULL;
+  UINT32 formats_count = 0;
+  UINT32 format_id = 0;
+  UINT32 index = 0;
+  UINT32 dropped = 0;
+  UINT32 level = 0;
+  UINT16 header[2];
+  UINT64 start_us = 0;
+  UINT64 time_us = 0;
+  UINT64 thread_id = 0;
+  UINT64 wall_clock = 0;
+  BOOLEAN session = FALSE;
+  time_t session_time = 0;
+  CHAR8 time_str[64];
+
+  if (NULL == p_path || NULL == p_out) {
+    return EFI_INVALID_PARAMETER;
+  }
+  if (NULL == (p_in = fopen(p_path, "rb"))) {
+    return EFI_NOT_FOUND;
+  }
+  if (NULL == (p_payload = (UINT8 *)malloc(LOG_RING_MAX_PAYLOAD + 1))) {
+    ReturnCode = EFI_OUT_OF_RESOURCES;
+    goto Finish;
+  }
+
+  // A record cut short by a process still writing the file ends the decoding
+  while (1 == fread(header, sizeof(header), 1, p_in)) {
+    if (header[1] > LOG_RING_MAX_PAYLOAD ||
+        (0 != header[1] && 1 != fread(p_payload, header[1], 1, p_in))) {
+      break;
+    }
+    if (!session && LOG_RING_REC_SESSION != header[0]) {
+      ReturnCode = EFI_VOLUME_CORRUPTED;
+      goto Finish;
+    }
+
+    switch (header[0]) {
+    case LOG_RING_REC_SESSION:
+      if (header[1] < LOG_RING_SESSION_LEN || 0 != memcmp(p_payload, LOG_RING_MAGIC, LOG_RING_MAGIC_LEN)) {
+        ReturnCode = EFI_VOLUME_CORRUPTED;
+        goto Finish;
+      }
+      for (index = 0; index < formats_count; index++) {
+        free(pp_formats[index]);
+        pp_formats[index] = NULL;
+      }
+      memcpy(&wall_clock, p_payload + 16, sizeof(wall_clock));
+      memcpy(&start_us, p_payload + 24, sizeof(start_us));
+      session_time = (time_t)wall_clock;
+      if (0 == strftime(time_str, sizeof(time_str), "%Y-%m-%d %H:%M:%S", localtime(&session_time))) {
+        time_str[0] = '\0';
+      }
+      fprintf(p_out, "---- Session started %s ----\n", time_str);
+      session = TRUE;
+      break;
+    case LOG_RING_REC_FORMAT:
+      if (header[1] < sizeof(format_id)) {
+        break;
+      }
+      memcpy(&format_id, p_payload, sizeof(format_id));
+      if (format_id >= formats_count) {
+        pp_grown = (CHAR8 **)realloc(pp_formats, sizeof(*pp_formats) * (format_id + 64));
+        if (NULL == pp_grown) {
+          ReturnCode = EFI_OUT_OF_RESOURCES;
+          goto Finish;
+        }
+        pp_formats = pp_grown;
+        memset(pp_formats + formats_count, 0, sizeof(*pp_formats) * (format_id + 64 - formats_count));
+        formats_count = format_id + 64;
+      }
+      free(pp_formats[format_id]);
+      if (NULL == (pp_formats[format_id] = (CHAR8 *)malloc(header[1] - sizeof(format_id) + 1))) {
+        ReturnCode = EFI_OUT_OF_RESOURCES;
+        goto Finish;
+      }
+      memcpy(pp_formats[format_id], p_payload + sizeof(format_id), header[1] - sizeof(format_id));
+      pp_formats[format_id][header[1] - sizeof(format_id)] = '\0';
+      break;
+    case LOG_RING_REC_MESSAGE:
+      if (header[1] < LOG_RING_MSG_HEADER_LEN) {
+        break;
+      }
+      memcpy(&time_us, p_payload, sizeof(time_us));
+      memcpy(&thread_id, p_payload + 8, sizeof(thread_id));
+      memcpy(&level, p_payload + 16, sizeof(level));
+      memcpy(&format_id, p_payload + 20, sizeof(format_id));
+      time_us -= start_us;
+      fprintf(p_out, "[%llu.%06llu] [%llx] ", (unsigned long long)(time_us / 1000000),
+        (unsigned long long)(time_us % 1000000), (unsigned long long)thread_id);
+      if (format_id >= formats_count || NULL == pp_formats[format_id]) {
+        fprintf(p_out, "<unknown format %u, level 0x%x>\n", format_id, level);
+      } else if ('\n' != log_ring_print_message(p_out, pp_formats[format_id],
+          p_payload + LOG_RING_MSG_HEADER_LEN, header[1] - LOG_RING_MSG_HEADER_LEN)) {
+        fputc('\n', p_out);
+      }
+      break;
+    case LOG_RING_REC_DROPPED:
+      if (header[1] >= sizeof(dropped)) {
+        memcpy(&dropped, p_payload, sizeof(dropped));
+        fprintf(p_out, "---- %u messages dropped, the ring was full ----\n", dropped);
+      }
+      break;
+    default:
+      // Records of newer versions
+      break;
+    }
+  }
+
+  if (!session) {
+    ReturnCode = EFI_VOLUME_CORRUPTED;
+  }
+
+Finish:
+  for (index = 0; index < formats_count; index++) {
+    free(pp_formats[index]);
+  }
+  free(pp_formats);
+  free(p_payload);
+  fclose(p_in);
+  return ReturnCode;
+}
@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) 2018, Intel Corporation.
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef _OS_EFI_LOG_RING_H_
+#define _OS_EFI_LOG_RING_H_
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <Uefi.h>
+
+#define LOG_RING_DEFAULT_SIZE   (1024 * 1024)   //!< Bytes of records buffered in memory before messages get dropped
+
+/**
+  Start logging the debug messages to a binary log file. The messages are
+  copied unformatted into an in-memory ring and appended to the file by a
+  background thread. The file is opened in append mode, every call starts a
+  new session in it.
+
+  @param[in] p_path Binary log file
+  @param[in] ring_size Size of the in-memory ring in bytes
+
+  @retval EFI_SUCCESS Success
+  @retval EFI_ALREADY_STARTED The ring is already open
+  @retval EFI_INVALID_PARAMETER p_path is NULL or empty
+  @retval EFI_OUT_OF_RESOURCES Memory allocation failure
+  @retval EFI_DEVICE_ERROR The file could not be opened
+**/
+EFI_STATUS
+debug_log_ring_open(
+  IN CONST CHAR8 *p_path,
+  IN UINT32 ring_size
+);
+
+/**
+  Write the buffered records to the file, stop the background thread and
+  close the file
+**/
+VOID
+debug_log_ring_close(
+);
+
+/**
+  Returns TRUE when debug messages are being written to a binary log file
+**/
+BOOLEAN
+debug_log_ring_is_open(
+);
+
+/**
+  Capture a debug message into the ring. The format string is written to the
+  file once per session, the arguments are stored binary and are only
+  formatted when the file is decoded. Messages that do not fit in the ring
+  are dropped and counted.
+
+  @param[in] level Error level of the message
+  @param[in] p_format printf format string
+  @param[in] args Arguments of the format string
+**/
+VOID
+debug_log_ring_write(
+  IN UINTN level,
+  IN CONST CHAR8 *p_format,
+  IN va_list args
+);
+
+/**
+  Format the messages of a binary log file as text
+
+  @param[in] p_path Binary log file written by debug_log_ring_open()
+  @param[in] p_out Stream the text is written to
+
+  @retval EFI_SUCCESS Success
+  @retval EFI_INVALID_PARAMETER NULL parameter
+  @retval EFI_NOT_FOUND The file could not be opened
+  @retval EFI_VOLUME_CORRUPTED The file is not a binary debug log
+  @retval EFI_OUT_OF_RESOURCES Memory allocation failure
+**/
+EFI_STATUS
+debug_log_ring_decode(
+  IN CONST CHAR8 *p_path,
+  IN FILE *p_out
+);
+
+#endif //_OS_EFI_LOG_RING_H_
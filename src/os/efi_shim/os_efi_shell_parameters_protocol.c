@@ -102,8 +102,13 @@ EFI_STATUS init_protocol_shell_parameters_protocol(int argc, char *argv[])
           0 == s_strncmpi(tok, STR_ESXXML, strlen(STR_ESXXML) + 1) ||
           0 == s_strncmpi(tok, STR_ESXTABLE, strlen(STR_ESXTABLE) + 1))
         {
-          g_file_io = 1;
-          gOsShellParametersProtocol.StdOut = fopen("output.tmp", "w+");
+          // Captured until the command is known, see stop_output_capture()
+          if (!g_file_io && NULL != (gOsShellParametersProtocol.StdOut = tmpfile())) {
+            g_file_io = 1;
+          }
+          else if (!g_file_io) {
+            gOsShellParametersProtocol.StdOut = stdout;
+          }
         }
 
         tok = os_strtok(NULL, ",", &p_tok_context);
@@ -152,11 +157,25 @@ Final:
   return ReturnCode;
 }
 
+void stop_output_capture()
+{
+  if (g_file_io) {
+    fclose(gOsShellParametersProtocol.StdOut);
+    g_file_io = 0;
+  }
+  gOsShellParametersProtocol.StdOut = stdout;
+}
+
+BOOLEAN is_output_captured()
+{
+  return g_file_io ? TRUE : FALSE;
+}
+
 int uninit_protocol_shell_parameters_protocol()
 {
   int Index = 0;
-  if (g_file_io)
-    fclose(gOsShellParametersProtocol.StdOut);
+
+  stop_output_capture();
 
   for (Index = 0; Index < gOsShellParametersProtocol.Argc; ++Index)
   {
@@ -15,6 +15,14 @@ extern EFI_SHELL_PARAMETERS_PROTOCOL gOsShellParametersProtocol;
 
 EFI_STATUS init_protocol_shell_parameters_protocol(int argc, char *argv[]);
 int uninit_protocol_shell_parameters_protocol();
+
+/**
+  The text printed while an XML format is requested is captured, so process_output
+  can wrap it once the command is done. Commands rendering the format themselves
+  through the printer stop the capture and print straight to stdout.
+**/
+void stop_output_capture();
+BOOLEAN is_output_captured();
 BOOLEAN is_verbose_debug_print_enabled();
 
 
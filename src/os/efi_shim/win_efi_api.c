@@ -6,6 +6,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <sys\timeb.h> 
+#include <intrin.h>
 #include <Uefi.h>
 #include <Dimm.h>
 #include <win_scm2_passthrough.h>
@@ -57,6 +58,21 @@ UINT64 GetCurrentMilliseconds()
   return retval;
 }
 
+/**
+  Used to serialize load and store operations.
+
+  All loads and stores that proceed calls to this function are guaranteed to be
+  globally visible when this function returns.
+**/
+VOID
+EFIAPI
+MemoryFence(
+  VOID
+  )
+{
+  _mm_mfence();
+}
+
 /**
 Loads a table as specified in the args
 
@@ -102,6 +118,23 @@ passthru_os(
   return Rc;
 }
 
+VOID
+passthru_os_release(
+  VOID
+)
+{
+  // Every passthrough opens and closes its own handle, nothing is kept open
+}
+
+UINT32
+passthru_os_last_retries(
+  VOID
+)
+{
+  // The DSM is not retried on this OS
+  return 0;
+}
+
 EFI_STATUS
 get_nfit_table(
   OUT EFI_ACPI_DESCRIPTION_HEADER ** table,
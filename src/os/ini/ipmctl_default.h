@@ -42,6 +42,23 @@
 "# The other values will be ignored and won't affect the large payload access\n"
 "LARGE_PAYLOAD_DISABLED = 1\n"
 "\n"
+"# Maximum number of DIMMs sent firmware commands in parallel while the DIMM\n"
+"# inventory is built or queried (application start, show -dimm)\n"
+"# 0 or 1 talks to the DIMMs one at a time\n"
+"DIMM_PARALLEL_THREADS = 8\n"
+"\n"
+"# Lifetime in milliseconds of the PMem module info and sensor readings cached\n"
+"# by libipmctl, 0 (default) disables the cache. The value can be overridden\n"
+"# per info category with DIMM_INFO_CACHE_TTL_MS_<CATEGORY>, e.g.\n"
+"# SMART_AND_HEALTH, SECURITY, ARS_STATUS or FW_IMAGE_INFO\n"
+"# Changes made by other processes are only seen once an entry expires\n"
+"DIMM_INFO_CACHE_TTL_MS = 0\n"
+"\n"
+"# 0 - Disabled\n"
+"# 1 - Collect per PMem module and opcode counters and latency histograms of\n"
+"#     the firmware commands sent, see show -fwcmdstats\n"
+"FW_CMD_STATS_ENABLED = 0\n"
+"\n"
 "# Application temporary files path configuration\n"
 "# The app is going to use the path to store various files required\n"
 "# during the execution\n"
@@ -56,3 +73,8 @@
 "# 3 - Log INFOs and above\n"
 "# 4 - Verbose mode On\n"
 "DBG_LOG_LEVEL = 0\n"
+"\n"
+"# Binary file the debug messages of the enabled levels are also appended to,\n"
+"# uncomment to enable. They are buffered in memory and written unformatted by a\n"
+"# background thread, decode the file with dump -destination <file> -dbglog\n"
+"#DBG_LOG_RING_FILE = "TEMP_FILE_PATH"ipmctl_debug.bin\n"
@@ -3,10 +3,16 @@
  * SPDX-License-Identifier: BSD-3-Clause
  */
 #include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/epoll.h>
 #include <nvm_types.h>
 #include <export_api.h>
 #include "lnx_adapter_logging.h"
 #include "lnx_adapter.h"
+#include "lnx_adapter_acpi_events.h"
 
 
 struct nvm_dimm_acpi_event_ctx
@@ -15,10 +21,37 @@ struct nvm_dimm_acpi_event_ctx
 	unsigned int monitored_events;
 	unsigned int triggered_events;
 	int smart_health_fd;
+	unsigned int wait_events; // poll events that mean smart_health_fd fired
 	struct ndctl_ctx *ndctl_lib_ctx;
 	struct ndctl_dimm *ndctl_lib_dimm;
 };
 
+// Most events pulled from the kernel by one epoll_wait() call
+#define ACPI_EVENT_MONITOR_BATCH 64
+
+struct nvm_acpi_event_monitor
+{
+	int epoll_fd;
+	unsigned int last_fired_cnt;
+	struct nvm_dimm_acpi_event_ctx *last_fired[ACPI_EVENT_MONITOR_BATCH];
+};
+
+/*
+* Consume the pending notification so the descriptor only becomes ready
+* again on the next event. sysfs attributes need a read from offset 0,
+* pipes and eventfds (no seek) are simply drained.
+*/
+static void acpi_event_rearm(int fd)
+{
+	char buf[4096]; //4k based on ndctl example
+
+	lseek(fd, 0, SEEK_SET);
+	if (read(fd, buf, sizeof(buf)) < 0)
+	{
+		COMMON_LOG_DEBUG_F("Re-arming ACPI event fd %d failed, errno %d", fd, errno);
+	}
+}
+
 /*
 * Create a context for a particular dimm to be used by all other acpi_event_* APIs
 *
@@ -40,6 +73,8 @@ NVM_API int acpi_event_create_ctx(unsigned int dimm_handle, void ** ctx)
 		if (NVM_SUCCESS == (rc = get_dimm_by_handle(new_ctx->ndctl_lib_ctx, dimm_handle, &new_ctx->ndctl_lib_dimm)))
 		{
 			new_ctx->smart_health_fd = ndctl_dimm_get_health_eventfd(new_ctx->ndctl_lib_dimm);
+			// sysfs attributes always poll readable, a notification shows up as POLLPRI
+			new_ctx->wait_events = POLLPRI;
 		}
 		else
 		{
@@ -55,6 +90,39 @@ NVM_API int acpi_event_create_ctx(unsigned int dimm_handle, void ** ctx)
 	return rc;
 }
 
+/*
+* Create a context that reports ACPI events for a readable descriptor, such as
+* an eventfd or pipe, instead of the DIMM's sysfs health attribute. Used to
+* drive the event monitor without NVDIMM hardware.
+*
+* @param[in] dimm_handle - NFIT dimm handle reported with the events
+* @param[in] fd - descriptor that becomes readable when the event fires
+* @param[out] ctx - pointer to new context, freed by acpi_event_free_ctx
+* @return Returns one of the following
+*		NVM_ERR_INVALID_PARAMETER
+*		NVM_ERR_NO_MEM
+*		NVM_SUCCESS
+*/
+int acpi_event_create_ctx_from_fd(unsigned int dimm_handle, int fd, void ** ctx)
+{
+	struct nvm_dimm_acpi_event_ctx * new_ctx;
+
+	if (NULL == ctx || fd < 0)
+	{
+		return NVM_ERR_INVALID_PARAMETER;
+	}
+	new_ctx = *ctx = (struct nvm_dimm_acpi_event_ctx *)calloc(1, sizeof(struct nvm_dimm_acpi_event_ctx));
+	if (NULL == new_ctx)
+	{
+		COMMON_LOG_ERROR("Failed to allocate memory for ctx.");
+		return NVM_ERR_NO_MEM;
+	}
+	new_ctx->dimm_handle = dimm_handle;
+	new_ctx->smart_health_fd = fd;
+	new_ctx->wait_events = POLLIN;
+	return NVM_SUCCESS;
+}
+
 /*
 * Free a context previously created by acpi_event_create_ctx.
 *
@@ -67,7 +135,10 @@ NVM_API int acpi_event_free_ctx(void * ctx)
 	if (NULL != ctx)
 	{
 		struct nvm_dimm_acpi_event_ctx * p_ctx = (struct nvm_dimm_acpi_event_ctx *)ctx;
-		ndctl_unref(p_ctx->ndctl_lib_ctx);
+		if (NULL != p_ctx->ndctl_lib_ctx)
+		{
+			ndctl_unref(p_ctx->ndctl_lib_ctx);
+		}
 		free(ctx);
 	}
 
@@ -189,37 +260,39 @@ NVM_API int acpi_wait_for_event(void * acpi_event_contexts[], const NVM_UINT32 d
 {
 	COMMON_LOG_ENTRY();
 	struct nvm_dimm_acpi_event_ctx * context;
-	int rc = NVM_ERR_UNKNOWN;
-	char buf[4096]; //4k based on ndctl example
-	fd_set fds;
-	int max_fd = 0;
-	FD_ZERO(&fds);
+	struct pollfd * fds;
+	int rc;
+
+	if (NULL == acpi_event_contexts || NULL == event_result || 0 == dimm_cnt)
+	{
+		return NVM_ERR_INVALID_PARAMETER;
+	}
+	// poll() rather than select() so descriptors above FD_SETSIZE still work
+	fds = (struct pollfd *)calloc(dimm_cnt, sizeof(struct pollfd));
+	if (NULL == fds)
+	{
+		return NVM_ERR_NO_MEM;
+	}
 
 	//add all dimm smart health FDs to the set
-	//and re-arm them (lseek/pread)
-	for (int i = 0; i < dimm_cnt; ++i)
+	//and re-arm them
+	for (NVM_UINT32 i = 0; i < dimm_cnt; ++i)
 	{
 		context = (struct nvm_dimm_acpi_event_ctx *)acpi_event_contexts[i];
 		context->triggered_events = 0;
-		int fd = context->smart_health_fd;
-		if (fd > max_fd)
-			max_fd = fd;
-
-		lseek(fd, 0, SEEK_SET);
-		rc = pread(fd, buf, sizeof(buf), 0);
-		FD_SET(fd, &fds);
+		acpi_event_rearm(context->smart_health_fd);
+		fds[i].fd = context->smart_health_fd;
+		fds[i].events = (short)context->wait_events;
 	}
 
-	struct timeval tm;
-	tm.tv_sec = timeout_sec;
-	tm.tv_usec = 0;
 	//wait for event(s), can either have timeout or wait indefinitely for an event
-	if (0 < (rc = select(max_fd + 1, NULL, NULL, &fds, ((timeout_sec >= 0) ? &tm : NULL))))
+	if (0 < (rc = poll(fds, dimm_cnt, (timeout_sec >= 0) ? timeout_sec * 1000 : -1)))
 	{
-		for (int i = 0; i < dimm_cnt; ++i)
+		*event_result = ACPI_EVENT_UNKNOWN_RESULT;
+		for (NVM_UINT32 i = 0; i < dimm_cnt; ++i)
 		{
 			context = (struct nvm_dimm_acpi_event_ctx *)acpi_event_contexts[i];
-			if (FD_ISSET(context->smart_health_fd, &fds))
+			if (fds[i].revents & (context->wait_events | POLLERR))
 			{
 				context->triggered_events |= DIMM_ACPI_EVENT_SMART_HEALTH_MASK;
 				*event_result = ACPI_EVENT_SIGNALLED_RESULT;
@@ -230,5 +303,201 @@ NVM_API int acpi_wait_for_event(void * acpi_event_contexts[], const NVM_UINT32 d
 	{
 		*event_result = (rc == 0 ? ACPI_EVENT_TIMED_OUT_RESULT : ACPI_EVENT_UNKNOWN_RESULT);
 	}
+	free(fds);
+	return NVM_SUCCESS;
+}
+
+/*
+* Create an ACPI event monitor. Unlike acpi_wait_for_event, which rebuilds
+* its descriptor set on every call, contexts are registered with the monitor
+* once and each wait only touches the DIMMs that actually fired.
+*
+* @param[out] monitor - pointer to new monitor, freed by acpi_event_monitor_free
+* @return Returns one of the following
+*		NVM_ERR_INVALID_PARAMETER
+*		NVM_ERR_NO_MEM
+*		NVM_ERR_UNKNOWN
+*		NVM_SUCCESS
+*/
+NVM_API int acpi_event_monitor_create(void ** monitor)
+{
+	struct nvm_acpi_event_monitor * new_monitor;
+
+	if (NULL == monitor)
+	{
+		return NVM_ERR_INVALID_PARAMETER;
+	}
+	new_monitor = (struct nvm_acpi_event_monitor *)calloc(1, sizeof(struct nvm_acpi_event_monitor));
+	if (NULL == new_monitor)
+	{
+		COMMON_LOG_ERROR("Failed to allocate memory for ACPI event monitor.");
+		return NVM_ERR_NO_MEM;
+	}
+	new_monitor->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+	if (new_monitor->epoll_fd < 0)
+	{
+		COMMON_LOG_ERROR_F("epoll_create1 failed, errno %d", errno);
+		free(new_monitor);
+		return NVM_ERR_UNKNOWN;
+	}
+	*monitor = new_monitor;
+	return NVM_SUCCESS;
+}
+
+/*
+* Free a monitor created by acpi_event_monitor_create. Registered contexts
+* are not freed.
+*
+* @param[in] monitor - monitor created by acpi_event_monitor_create
+* @return Returns one of the following
+*		NVM_SUCCESS
+*/
+NVM_API int acpi_event_monitor_free(void * monitor)
+{
+	struct nvm_acpi_event_monitor * p_monitor = (struct nvm_acpi_event_monitor *)monitor;
+
+	if (NULL != p_monitor)
+	{
+		close(p_monitor->epoll_fd);
+		free(p_monitor);
+	}
+	return NVM_SUCCESS;
+}
+
+/*
+* Register a DIMM context with a monitor and arm its descriptor. The context
+* must stay valid until it is removed or the monitor is freed.
+*
+* @param[in] monitor - monitor created by acpi_event_monitor_create
+* @param[in] ctx - context created by acpi_event_create_ctx
+* @return Returns one of the following
+*		NVM_ERR_INVALID_PARAMETER
+*		NVM_ERR_UNKNOWN
+*		NVM_SUCCESS
+*/
+NVM_API int acpi_event_monitor_add(void * monitor, void * ctx)
+{
+	struct nvm_acpi_event_monitor * p_monitor = (struct nvm_acpi_event_monitor *)monitor;
+	struct nvm_dimm_acpi_event_ctx * p_ctx = (struct nvm_dimm_acpi_event_ctx *)ctx;
+	struct epoll_event event;
+
+	if (NULL == p_monitor || NULL == p_ctx || p_ctx->smart_health_fd < 0)
+	{
+		return NVM_ERR_INVALID_PARAMETER;
+	}
+	memset(&event, 0, sizeof(event));
+	event.events = p_ctx->wait_events;
+	event.data.ptr = p_ctx;
+	p_ctx->triggered_events = 0;
+	acpi_event_rearm(p_ctx->smart_health_fd);
+	if (0 != epoll_ctl(p_monitor->epoll_fd, EPOLL_CTL_ADD, p_ctx->smart_health_fd, &event))
+	{
+		COMMON_LOG_ERROR_F("Failed to monitor dimm 0x%x, errno %d", p_ctx->dimm_handle, errno);
+		return (EEXIST == errno) ? NVM_ERR_INVALID_PARAMETER : NVM_ERR_UNKNOWN;
+	}
+	return NVM_SUCCESS;
+}
+
+/*
+* Stop monitoring a DIMM context.
+*
+* @param[in] monitor - monitor created by acpi_event_monitor_create
+* @param[in] ctx - context previously passed to acpi_event_monitor_add
+* @return Returns one of the following
+*		NVM_ERR_INVALID_PARAMETER
+*		NVM_SUCCESS
+*/
+NVM_API int acpi_event_monitor_remove(void * monitor, void * ctx)
+{
+	struct nvm_acpi_event_monitor * p_monitor = (struct nvm_acpi_event_monitor *)monitor;
+	struct nvm_dimm_acpi_event_ctx * p_ctx = (struct nvm_dimm_acpi_event_ctx *)ctx;
+
+	if (NULL == p_monitor || NULL == p_ctx ||
+		0 != epoll_ctl(p_monitor->epoll_fd, EPOLL_CTL_DEL, p_ctx->smart_health_fd, NULL))
+	{
+		return NVM_ERR_INVALID_PARAMETER;
+	}
+	// don't let the next wait touch a context the caller may be about to free
+	for (unsigned int i = 0; i < p_monitor->last_fired_cnt; ++i)
+	{
+		if (p_monitor->last_fired[i] == p_ctx)
+		{
+			p_monitor->last_fired[i] = p_monitor->last_fired[--p_monitor->last_fired_cnt];
+			break;
+		}
+	}
+	return NVM_SUCCESS;
+}
+
+/*
+* Wait for ACPI notifications on any registered DIMM. Only the descriptors
+* that fired are re-armed, and each one is reported as an event record.
+* acpi_event_get_event_state keeps reporting the DIMMs from the latest wait.
+*
+* @param[in] monitor - monitor created by acpi_event_monitor_create
+* @param[in] timeout_ms - -1 - No timeout, otherwise the timeout in milliseconds
+* @param[out] records - receives one record per DIMM that fired
+* @param[in] max_records - capacity of records; remaining events are kept
+*		for the next call
+* @param[out] record_cnt - number of records filled in
+* @param[out] event_result - ACPI_EVENT_SIGNALLED_RESULT, ACPI_EVENT_TIMED_OUT_RESULT, ACPI_EVENT_UNKNOWN_RESULT
+* @return Returns one of the following
+*		NVM_ERR_INVALID_PARAMETER
+*		NVM_SUCCESS
+*/
+NVM_API int acpi_event_monitor_wait(void * monitor, const int timeout_ms,
+	struct acpi_event_record * records, const unsigned int max_records,
+	unsigned int * record_cnt, enum acpi_get_event_result * event_result)
+{
+	struct nvm_acpi_event_monitor * p_monitor = (struct nvm_acpi_event_monitor *)monitor;
+	struct epoll_event events[ACPI_EVENT_MONITOR_BATCH];
+	struct nvm_dimm_acpi_event_ctx * context;
+	int max_events;
+	int rc;
+
+	if (NULL == p_monitor || NULL == records || 0 == max_records ||
+		NULL == record_cnt || NULL == event_result)
+	{
+		return NVM_ERR_INVALID_PARAMETER;
+	}
+	*record_cnt = 0;
+
+	for (unsigned int i = 0; i < p_monitor->last_fired_cnt; ++i)
+	{
+		p_monitor->last_fired[i]->triggered_events = 0;
+	}
+	p_monitor->last_fired_cnt = 0;
+
+	max_events = (max_records < ACPI_EVENT_MONITOR_BATCH) ? (int)max_records : ACPI_EVENT_MONITOR_BATCH;
+	do
+	{
+		rc = epoll_wait(p_monitor->epoll_fd, events, max_events, (timeout_ms >= 0) ? timeout_ms : -1);
+	} while (rc < 0 && EINTR == errno);
+
+	if (rc < 0)
+	{
+		COMMON_LOG_ERROR_F("epoll_wait failed, errno %d", errno);
+		*event_result = ACPI_EVENT_UNKNOWN_RESULT;
+		return NVM_SUCCESS;
+	}
+	if (0 == rc)
+	{
+		*event_result = ACPI_EVENT_TIMED_OUT_RESULT;
+		return NVM_SUCCESS;
+	}
+
+	for (int i = 0; i < rc; ++i)
+	{
+		context = (struct nvm_dimm_acpi_event_ctx *)events[i].data.ptr;
+		acpi_event_rearm(context->smart_health_fd);
+		context->triggered_events |= DIMM_ACPI_EVENT_SMART_HEALTH_MASK;
+		p_monitor->last_fired[p_monitor->last_fired_cnt++] = context;
+
+		records[*record_cnt].ctx = context;
+		records[*record_cnt].dimm_handle = context->dimm_handle;
+		records[*record_cnt].triggered_events = context->triggered_events;
+		(*record_cnt)++;
+	}
+	*event_result = ACPI_EVENT_SIGNALLED_RESULT;
 	return NVM_SUCCESS;
 }
@@ -0,0 +1,51 @@
+/*
+ * Copyright (c) 2018, Intel Corporation.
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+/*
+ * Declarations of the Linux ACPI event interface, see
+ * lnx_adapter_acpi_events.c for the parameter details.
+ */
+
+#ifndef LNX_ADAPTER_ACPI_EVENTS_H_
+#define	LNX_ADAPTER_ACPI_EVENTS_H_
+
+#include <nvm_types.h>
+#include <export_api.h>
+
+NVM_API int acpi_event_create_ctx(unsigned int dimm_handle, void ** ctx);
+
+/*
+ * Context backed by a readable descriptor such as an eventfd or pipe instead
+ * of the DIMM's sysfs health attribute
+ */
+int acpi_event_create_ctx_from_fd(unsigned int dimm_handle, int fd, void ** ctx);
+
+NVM_API int acpi_event_free_ctx(void * ctx);
+
+NVM_API int acpi_event_ctx_get_dimm_handle(void * ctx, unsigned int * dev_handle);
+
+NVM_API int acpi_event_get_event_state(void * ctx, enum acpi_event_type event_type,
+	enum acpi_event_state *event_state);
+
+NVM_API int acpi_event_set_monitor_mask(void * ctx, const unsigned int acpi_monitored_event_mask);
+
+NVM_API int acpi_event_get_monitor_mask(void * ctx, unsigned int * mask);
+
+NVM_API int acpi_wait_for_event(void * acpi_event_contexts[], const NVM_UINT32 dimm_cnt,
+	const int timeout_sec, enum acpi_get_event_result * event_result);
+
+NVM_API int acpi_event_monitor_create(void ** monitor);
+
+NVM_API int acpi_event_monitor_free(void * monitor);
+
+NVM_API int acpi_event_monitor_add(void * monitor, void * ctx);
+
+NVM_API int acpi_event_monitor_remove(void * monitor, void * ctx);
+
+NVM_API int acpi_event_monitor_wait(void * monitor, const int timeout_ms,
+	struct acpi_event_record * records, const unsigned int max_records,
+	unsigned int * record_cnt, enum acpi_get_event_result * event_result);
+
+#endif /* LNX_ADAPTER_ACPI_EVENTS_H_ */
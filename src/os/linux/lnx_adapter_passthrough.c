@@ -15,8 +15,11 @@
 //#include <os/os_adapter.h>
 #include <string.h>
 #include <stdlib.h>
+#include <pthread.h>
 #include <os_types.h>
 #define DEV_SMALL_PAYLOAD_SIZE	128 /* 128B - Size for a passthrough command small payload */
+#define PT_SESSION_MIN_BUCKETS	64 /* Power of two, at least twice the expected DIMM count */
+#define PT_SESSION_MAX_ABSENT	16 /* Unknown handles remembered per index */
 
 #define DSM_TO_NVM_ERROR(dsm_vendor_error, p_fw_cmd, rc) \
   p_fw_cmd->Status = DSM_EXTENDED_ERROR(dsm_vendor_error); \
@@ -29,13 +32,6 @@
     rc = NVM_SUCCESS; \
   }
 
-#define	BIOS_INPUT(NAME, IN_LEN)		\
-struct NAME {								\
-	UINT32 size;						\
-	UINT32 offset;						\
-	UINT8  buffer[IN_LEN];				\
-}
-
 /*
 * Helper function to translate block driver errors to NVM Lib errors.
 */
@@ -86,6 +82,48 @@ int linux_err_to_nvm_lib_err(int crbd_err)
 	return (ret);
 }
 
+/*
+ * Large payload engine. The mailbox geometry of a DIMM does not change at
+ * runtime, so it is queried once and the DSM command objects sized to it are
+ * kept and resubmitted for every chunk. Moving a payload then costs one
+ * ioctl per rw_size chunk and no allocations.
+ */
+struct pt_large_payload
+{
+	pthread_mutex_t lock;
+	struct ndctl_dimm *p_dimm; // DIMM the commands below were built for
+	int geometry_valid;
+	struct pt_bios_get_size mb_size;
+	struct pt_bios_rw_header *p_write_buf; // header followed by rw_size bytes
+	struct ndctl_cmd *p_write_cmd; // full rw_size chunk
+	struct ndctl_cmd *p_write_tail_cmd; // shorter last chunk
+	unsigned int write_tail_size;
+	struct ndctl_cmd *p_read_cmd;
+	struct ndctl_cmd *p_read_tail_cmd;
+	unsigned int read_tail_size;
+};
+
+static const struct pt_dsm_backend g_pt_ndctl_backend =
+{
+	ndctl_dimm_cmd_new_vendor_specific,
+	ndctl_cmd_vendor_set_input,
+	ndctl_cmd_vendor_get_output,
+	ndctl_cmd_submit,
+	ndctl_cmd_get_firmware_status,
+	ndctl_cmd_unref
+};
+
+static const struct pt_dsm_backend *g_p_dsm = &g_pt_ndctl_backend;
+
+/*
+ * Route the large payload commands through another DSM backend, NULL
+ * restores libndctl
+ */
+void passthrough_set_dsm_backend(const struct pt_dsm_backend *p_backend)
+{
+	g_p_dsm = p_backend ? p_backend : &g_pt_ndctl_backend;
+}
+
 /*
  * Execute an emulated BIOS ioctl to retrieve information about the bios large mailboxes
  */
@@ -111,7 +149,7 @@ int bios_get_payload_size(struct ndctl_dimm *p_dimm, struct pt_bios_get_size *p_
 	{
 		memset(p_bios_mb_size, 0, sizeof (*p_bios_mb_size));
 		struct ndctl_cmd *p_vendor_cmd = NULL;
-		if ((p_vendor_cmd = ndctl_dimm_cmd_new_vendor_specific(p_dimm,
+		if ((p_vendor_cmd = g_p_dsm->cmd_new(p_dimm,
 			BUILD_DSM_OPCODE(BIOS_EMULATED_COMMAND, SUBOP_GET_PAYLOAD_SIZE), 128,
 			sizeof (struct pt_bios_get_size))) == NULL)
 		{
@@ -120,9 +158,9 @@ int bios_get_payload_size(struct ndctl_dimm *p_dimm, struct pt_bios_get_size *p_
 		}
 		else
 		{
-			if ((lnx_err_status = ndctl_cmd_submit(p_vendor_cmd)) == 0)
+			if ((lnx_err_status = g_p_dsm->submit(p_vendor_cmd)) == 0)
 			{
-				if ((dsm_vendor_err_status = ndctl_cmd_get_firmware_status(p_vendor_cmd))
+				if ((dsm_vendor_err_status = g_p_dsm->get_firmware_status(p_vendor_cmd))
 						!= DSM_VENDOR_SUCCESS)
 				{
           DSM_TO_NVM_ERROR(dsm_vendor_err_status, p_fw_cmd, rc);
@@ -132,7 +170,7 @@ int bios_get_payload_size(struct ndctl_dimm *p_dimm, struct pt_bios_get_size *p_
 				}
 				else
 				{
-					size_t return_size = ndctl_cmd_vendor_get_output(p_vendor_cmd,
+					size_t return_size = g_p_dsm->get_output(p_vendor_cmd,
 						p_bios_mb_size, sizeof (struct pt_bios_get_size));
 					if (return_size != sizeof (struct pt_bios_get_size))
 					{
@@ -149,256 +187,686 @@ int bios_get_payload_size(struct ndctl_dimm *p_dimm, struct pt_bios_get_size *p_
 								"Opcode- 0x%x SubOpcode- 0x%x ", lnx_err_status,
 										p_fw_cmd->Opcode, p_fw_cmd->SubOpcode);
 			}
-			ndctl_cmd_unref(p_vendor_cmd);
+			g_p_dsm->unref(p_vendor_cmd);
 		}
 	}
 	COMMON_LOG_EXIT_RETURN_I(rc);
 	return rc;
 }
 
+struct pt_large_payload *large_payload_new()
+{
+	struct pt_large_payload *p_lp = calloc(1, sizeof (struct pt_large_payload));
+
+	if (p_lp)
+	{
+		pthread_mutex_init(&p_lp->lock, NULL);
+	}
+	return p_lp;
+}
+
+/*
+ * Drop the cached geometry and command objects
+ */
+static void large_payload_reset(struct pt_large_payload *p_lp)
+{
+	struct ndctl_cmd **pp_cmds[] = { &p_lp->p_write_cmd, &p_lp->p_write_tail_cmd,
+		&p_lp->p_read_cmd, &p_lp->p_read_tail_cmd };
+	unsigned int i;
+
+	for (i = 0; i < sizeof (pp_cmds) / sizeof (pp_cmds[0]); i++)
+	{
+		if (*pp_cmds[i])
+		{
+			g_p_dsm->unref(*pp_cmds[i]);
+			*pp_cmds[i] = NULL;
+		}
+	}
+	free(p_lp->p_write_buf);
+	p_lp->p_write_buf = NULL;
+	p_lp->write_tail_size = 0;
+	p_lp->read_tail_size = 0;
+	p_lp->geometry_valid = 0;
+	p_lp->p_dimm = NULL;
+}
+
+void large_payload_free(struct pt_large_payload *p_lp)
+{
+	if (p_lp)
+	{
+		large_payload_reset(p_lp);
+		pthread_mutex_destroy(&p_lp->lock);
+		free(p_lp);
+	}
+}
+
+/*
+ * Query the mailbox geometry of the DIMM unless it is already known
+ */
+static int large_payload_prepare(struct pt_large_payload *p_lp, struct ndctl_dimm *p_dimm,
+		struct fw_cmd *p_fw_cmd)
+{
+	int rc = NVM_SUCCESS;
+
+	if (p_lp->p_dimm != p_dimm)
+	{
+		large_payload_reset(p_lp);
+	}
+	if (p_lp->geometry_valid)
+	{
+		return NVM_SUCCESS;
+	}
+
+	if ((rc = bios_get_payload_size(p_dimm, &p_lp->mb_size, p_fw_cmd)) != NVM_SUCCESS)
+	{
+		return rc;
+	}
+	if (p_lp->mb_size.rw_size == 0)
+	{
+		COMMON_LOG_ERROR("BIOS reported an empty large payload transfer size");
+		return NVM_ERR_BAD_SIZE;
+	}
+	if ((p_lp->p_write_buf = malloc(sizeof (struct pt_bios_rw_header) +
+			p_lp->mb_size.rw_size)) == NULL)
+	{
+		COMMON_LOG_ERROR("Failed to allocate memory for BIOS input payload");
+		return NVM_ERR_NO_MEM;
+	}
+	p_lp->p_dimm = p_dimm;
+	p_lp->geometry_valid = 1;
+	return NVM_SUCCESS;
+}
+
+/*
+ * Get a write or read command for a chunk of transfer_size bytes. Full chunks
+ * and the shorter last chunk each keep their own command, so the wire format
+ * matches what a command built for that exact size would send.
+ */
+static struct ndctl_cmd *large_payload_get_cmd(struct pt_large_payload *p_lp, int write,
+		unsigned int transfer_size)
+{
+	struct ndctl_cmd **pp_cmd;
+	unsigned int *p_cached_size = NULL;
+	unsigned int opcode;
+
+	if (write)
+	{
+		pp_cmd = transfer_size == p_lp->mb_size.rw_size ?
+			&p_lp->p_write_cmd : &p_lp->p_write_tail_cmd;
+		if (pp_cmd == &p_lp->p_write_tail_cmd)
+		{
+			p_cached_size = &p_lp->write_tail_size;
+		}
+		opcode = BUILD_DSM_OPCODE(BIOS_EMULATED_COMMAND, SUBOP_WRITE_LARGE_PAYLOAD_INPUT);
+	}
+	else
+	{
+		pp_cmd = transfer_size == p_lp->mb_size.rw_size ?
+			&p_lp->p_read_cmd : &p_lp->p_read_tail_cmd;
+		if (pp_cmd == &p_lp->p_read_tail_cmd)
+		{
+			p_cached_size = &p_lp->read_tail_size;
+		}
+		opcode = BUILD_DSM_OPCODE(BIOS_EMULATED_COMMAND, SUBOP_READ_LARGE_PAYLOAD_OUTPUT);
+	}
+
+	if (*pp_cmd && (p_cached_size == NULL || *p_cached_size == transfer_size))
+	{
+		return *pp_cmd;
+	}
+
+	if (*pp_cmd)
+	{
+		g_p_dsm->unref(*pp_cmd);
+	}
+	*pp_cmd = g_p_dsm->cmd_new(p_lp->p_dimm, opcode,
+		sizeof (struct pt_bios_rw_header) + (write ? transfer_size : 0),
+		write ? 0 : transfer_size);
+	if (*pp_cmd && p_cached_size)
+	{
+		*p_cached_size = transfer_size;
+	}
+	return *pp_cmd;
+}
+
+/*
+ * Submit one chunk and translate the driver and DSM status
+ */
+static int large_payload_submit(struct ndctl_cmd *p_vendor_cmd, struct fw_cmd *p_fw_cmd,
+		const char *p_op)
+{
+	int rc = NVM_SUCCESS;
+	int lnx_err_status = 0;
+	unsigned int dsm_vendor_err_status = 0;
+
+	if ((lnx_err_status = g_p_dsm->submit(p_vendor_cmd)) != 0)
+	{
+		rc = linux_err_to_nvm_lib_err(lnx_err_status);
+		COMMON_LOG_ERROR_F("BIOS %s failed: "
+				"Linux driver returned error %d for command with "
+				"Opcode - 0x%x SubOpcode - 0x%x ", p_op, lnx_err_status,
+				p_fw_cmd->Opcode, p_fw_cmd->SubOpcode);
+	}
+	else if ((dsm_vendor_err_status = g_p_dsm->get_firmware_status(p_vendor_cmd)) !=
+			DSM_VENDOR_SUCCESS)
+	{
+		DSM_TO_NVM_ERROR(dsm_vendor_err_status, p_fw_cmd, rc);
+		COMMON_LOG_ERROR_F("BIOS %s failed: "
+				"DSM returned error %d for command with "
+				"Opcode - 0x%x SubOpcode - 0x%x ", p_op, dsm_vendor_err_status,
+				p_fw_cmd->Opcode, p_fw_cmd->SubOpcode);
+	}
+	return rc;
+}
+
 /*
  * Populate the emulated bios large input mailbox
  */
-int bios_write_large_payload(struct ndctl_dimm *p_dimm, struct fw_cmd *p_fw_cmd)
+int bios_write_large_payload(struct ndctl_dimm *p_dimm, struct pt_large_payload *p_lp,
+		struct fw_cmd *p_fw_cmd)
 {
 	COMMON_LOG_ENTRY();
 	int rc = NVM_SUCCESS;
-	struct pt_bios_get_size mb_size;
+	unsigned int current_offset = 0;
 
-	if (!p_dimm)
+	if (!p_dimm || !p_lp)
 	{
-		COMMON_LOG_ERROR("Invalid parameter, Dimm is null");
-		rc = NVM_ERR_INVALID_PARAMETER;
+		COMMON_LOG_ERROR("Invalid parameter, Dimm or payload context is null");
+		COMMON_LOG_EXIT_RETURN_I(NVM_ERR_INVALID_PARAMETER);
+		return NVM_ERR_INVALID_PARAMETER;
 	}
-	else if ((rc = bios_get_payload_size(p_dimm, &mb_size, p_fw_cmd)) == NVM_SUCCESS)
+
+	pthread_mutex_lock(&p_lp->lock);
+	if ((rc = large_payload_prepare(p_lp, p_dimm, p_fw_cmd)) != NVM_SUCCESS)
+	{
+		goto finish;
+	}
+	if (p_lp->mb_size.large_input_payload_size < p_fw_cmd->LargeInputPayloadSize)
+	{
+		rc = NVM_ERR_BAD_SIZE;
+		goto finish;
+	}
+
+	while (current_offset < p_fw_cmd->LargeInputPayloadSize && rc == NVM_SUCCESS)
 	{
-		if (mb_size.large_input_payload_size < p_fw_cmd->LargeInputPayloadSize)
+		unsigned int transfer_size = p_fw_cmd->LargeInputPayloadSize - current_offset;
+		struct ndctl_cmd *p_vendor_cmd;
+		size_t input_size;
+
+		if (transfer_size > p_lp->mb_size.rw_size)
 		{
-			rc = NVM_ERR_BAD_SIZE;
+			transfer_size = p_lp->mb_size.rw_size;
 		}
-		else
+		if ((p_vendor_cmd = large_payload_get_cmd(p_lp, 1, transfer_size)) == NULL)
 		{
-			unsigned int transfer_size = mb_size.rw_size;
-			unsigned int current_offset = 0;
+			COMMON_LOG_ERROR("Failed to get vendor command from driver");
+			rc = NVM_ERR_GENERAL_OS_DRIVER_FAILURE;
+			break;
+		}
 
-			while (current_offset < p_fw_cmd->LargeInputPayloadSize &&
-					rc == NVM_SUCCESS)
-			{
-				if ((current_offset + mb_size.rw_size) > p_fw_cmd->LargeInputPayloadSize)
-				{
-					transfer_size = p_fw_cmd->LargeInputPayloadSize - current_offset;
-				}
+		p_lp->p_write_buf->size = transfer_size;
+		p_lp->p_write_buf->offset = current_offset;
+		memcpy(p_lp->p_write_buf + 1, p_fw_cmd->LargeInputPayload + current_offset,
+			transfer_size);
+		input_size = sizeof (struct pt_bios_rw_header) + transfer_size;
 
-				BIOS_INPUT(bios_InputPayload, transfer_size);
-				struct bios_InputPayload *p_dsm_input = calloc(1,
-					sizeof (struct bios_InputPayload));
-				if (p_dsm_input)
-				{
-					struct ndctl_cmd *p_vendor_cmd = NULL;
-					if ((p_vendor_cmd = ndctl_dimm_cmd_new_vendor_specific(
-							p_dimm, BUILD_DSM_OPCODE(BIOS_EMULATED_COMMAND,
-							SUBOP_WRITE_LARGE_PAYLOAD_INPUT),
-							sizeof (*p_dsm_input), 0)) == NULL)
-					{
-						COMMON_LOG_ERROR("Failed to get vendor command from driver");
-						rc = NVM_ERR_GENERAL_OS_DRIVER_FAILURE;
-					}
-					else
-					{
-						int lnx_err_status = 0;
-						unsigned int dsm_vendor_err_status = 0;
+		if (g_p_dsm->set_input(p_vendor_cmd, p_lp->p_write_buf, input_size) !=
+				(ssize_t)input_size)
+		{
+			COMMON_LOG_ERROR("Failed to write input payload");
+			rc = NVM_ERR_GENERAL_OS_DRIVER_FAILURE;
+		}
+		else if ((rc = large_payload_submit(p_vendor_cmd, p_fw_cmd, "write")) == NVM_SUCCESS)
+		{
+			current_offset += transfer_size;
+		}
+	}
 
-						p_dsm_input->size = transfer_size;
-						p_dsm_input->offset = current_offset;
+	if (rc == NVM_SUCCESS && current_offset != p_fw_cmd->LargeInputPayloadSize)
+	{
+		COMMON_LOG_ERROR("Failed to write large payload");
+		rc = NVM_ERR_UNKNOWN;
+	}
 
-						memmove(p_dsm_input->buffer,
-							p_fw_cmd->LargeInputPayload + current_offset,
-							sizeof (p_dsm_input->buffer));
+finish:
+	if (rc != NVM_SUCCESS)
+	{
+		// Requery everything next time, the DIMM may have gone away
+		large_payload_reset(p_lp);
+	}
+	pthread_mutex_unlock(&p_lp->lock);
+	COMMON_LOG_EXIT_RETURN_I(rc);
+	return rc;
+}
 
-						size_t bytes_written = ndctl_cmd_vendor_set_input(
-							p_vendor_cmd, p_dsm_input, sizeof (*p_dsm_input));
+/*
+ * Read the emulated bios large output mailbox
+ */
+int bios_read_large_payload(struct ndctl_dimm *p_dimm, struct pt_large_payload *p_lp,
+		struct fw_cmd *p_fw_cmd)
+{
+	COMMON_LOG_ENTRY();
+	int rc = NVM_SUCCESS;
+	unsigned int current_offset = 0;
+	struct pt_bios_rw_header dsm_input;
 
-						if (bytes_written != sizeof (*p_dsm_input))
-						{
-							COMMON_LOG_ERROR("Failed to write input payload");
-							rc = NVM_ERR_GENERAL_OS_DRIVER_FAILURE;
-						}
-						else
-						{
-							if ((lnx_err_status = ndctl_cmd_submit(p_vendor_cmd)) == 0)
-							{
-								if ((dsm_vendor_err_status =
-										ndctl_cmd_get_firmware_status(p_vendor_cmd))
-												!= DSM_VENDOR_SUCCESS)
-								{
-                  DSM_TO_NVM_ERROR(dsm_vendor_err_status, p_fw_cmd, rc);
-									COMMON_LOG_ERROR_F("BIOS write failed: "
-											"DSM returned error %d for command with "
-											"Opcode- 0x%x SubOpcode- 0x%x ", dsm_vendor_err_status,
-											p_fw_cmd->Opcode, p_fw_cmd->SubOpcode);
-								}
-								else
-								{
-										current_offset += transfer_size;
-								}
+	if (!p_dimm || !p_lp)
+	{
+		COMMON_LOG_ERROR("Invalid parameter, Dimm or payload context is null");
+		COMMON_LOG_EXIT_RETURN_I(NVM_ERR_INVALID_PARAMETER);
+		return NVM_ERR_INVALID_PARAMETER;
+	}
 
-							}
-							else
-							{
-								rc = linux_err_to_nvm_lib_err(lnx_err_status);
-								COMMON_LOG_ERROR_F("BIOS write failed: "
-										"Linux driver returned error %d for command with "
-											"Opcode- 0x%x SubOpcode- 0x%x ", lnx_err_status,
-												p_fw_cmd->Opcode, p_fw_cmd->SubOpcode);
+	pthread_mutex_lock(&p_lp->lock);
+	if ((rc = large_payload_prepare(p_lp, p_dimm, p_fw_cmd)) != NVM_SUCCESS)
+	{
+		goto finish;
+	}
+	if (p_lp->mb_size.large_output_payload_size < p_fw_cmd->LargeOutputPayloadSize)
+	{
+		rc = NVM_ERR_BAD_SIZE;
+		goto finish;
+	}
 
-							}
-						}
+	while (current_offset < p_fw_cmd->LargeOutputPayloadSize && rc == NVM_SUCCESS)
+	{
+		unsigned int transfer_size = p_fw_cmd->LargeOutputPayloadSize - current_offset;
+		struct ndctl_cmd *p_vendor_cmd;
 
-						ndctl_cmd_unref(p_vendor_cmd);
-					}
-					free(p_dsm_input);
-				}
-				else
-				{
-					COMMON_LOG_ERROR("Failed to allocate memory for BIOS input payload");
-					rc = NVM_ERR_NO_MEM;
-				}
-			} // end while
+		if (transfer_size > p_lp->mb_size.rw_size)
+		{
+			transfer_size = p_lp->mb_size.rw_size;
+		}
+		if ((p_vendor_cmd = large_payload_get_cmd(p_lp, 0, transfer_size)) == NULL)
+		{
+			COMMON_LOG_ERROR("Failed to get vendor command from driver");
+			rc = NVM_ERR_GENERAL_OS_DRIVER_FAILURE;
+			break;
+		}
 
-			if (current_offset != p_fw_cmd->LargeInputPayloadSize)
+		dsm_input.size = transfer_size;
+		dsm_input.offset = current_offset;
+		if (g_p_dsm->set_input(p_vendor_cmd, &dsm_input, sizeof (dsm_input)) !=
+				sizeof (dsm_input))
+		{
+			COMMON_LOG_ERROR("Failed to write input payload");
+			rc = NVM_ERR_GENERAL_OS_DRIVER_FAILURE;
+		}
+		else if ((rc = large_payload_submit(p_vendor_cmd, p_fw_cmd, "read")) == NVM_SUCCESS)
+		{
+			// Straight into the caller's buffer, no bounce copy
+			if (g_p_dsm->get_output(p_vendor_cmd,
+					p_fw_cmd->LargeOutputPayload + current_offset, transfer_size) !=
+					(ssize_t)transfer_size)
 			{
-				COMMON_LOG_ERROR("Failed to write large payload");
-				rc = NVM_ERR_UNKNOWN;
+				rc = NVM_ERR_GENERAL_OS_DRIVER_FAILURE;
+				COMMON_LOG_ERROR("Large Payload returned less data than requested");
+			}
+			else
+			{
+				current_offset += transfer_size;
 			}
 		}
 	}
 
+	if (rc == NVM_SUCCESS && current_offset != p_fw_cmd->LargeOutputPayloadSize)
+	{
+		COMMON_LOG_ERROR("Failed to read large payload");
+		rc = NVM_ERR_UNKNOWN;
+	}
+
+finish:
+	if (rc != NVM_SUCCESS)
+	{
+		large_payload_reset(p_lp);
+	}
+	pthread_mutex_unlock(&p_lp->lock);
 	COMMON_LOG_EXIT_RETURN_I(rc);
 	return rc;
 }
 
 /*
- * Read the emulated bios large output mailbox
+ * Process-lifetime passthrough session. The ndctl context is opened once and
+ * every DIMM is indexed by its NFIT handle, so a firmware command does not pay
+ * for ndctl_new() and a walk over every bus. The index is rebuilt only when a
+ * handle cannot be resolved or the driver reports that the device went away.
+ * A handle still missing from the rebuilt index is remembered as absent, so
+ * commands sent to it fail without another rebuild until the index goes stale.
+ * Each entry also owns the large payload context of its DIMM.
+ */
+struct pt_dimm_entry
+{
+	unsigned int handle;
+	struct ndctl_dimm *p_dimm; // NULL marks an empty bucket
+	struct pt_large_payload *p_lp;
+};
+
+struct pt_session
+{
+	struct ndctl_ctx *p_ctx;
+	struct pt_dimm_entry *p_buckets;
+	unsigned int bucket_cnt;
+	unsigned int dimm_cnt;
+	unsigned int generation;
+	unsigned int absent[PT_SESSION_MAX_ABSENT];
+	unsigned int absent_cnt;
+	int stale;
+	int exit_handler_registered;
+};
+
+static struct pt_session g_pt_session;
+static pthread_rwlock_t g_pt_session_lock = PTHREAD_RWLOCK_INITIALIZER;
+static int g_pt_session_enabled = 1;
+
+static unsigned int pt_hash_handle(unsigned int handle, unsigned int bucket_cnt)
+{
+	// NFIT handles only differ in a few low nibbles, mix before masking
+	handle ^= handle >> 16;
+	handle *= 0x45d9f3b;
+	handle ^= handle >> 16;
+	return handle & (bucket_cnt - 1);
+}
+
+static struct pt_dimm_entry *pt_session_lookup(unsigned int handle)
+{
+	unsigned int i;
+	unsigned int bucket;
+
+	if (g_pt_session.p_buckets == NULL)
+	{
+		return NULL;
+	}
+
+	bucket = pt_hash_handle(handle, g_pt_session.bucket_cnt);
+	for (i = 0; i < g_pt_session.bucket_cnt; i++)
+	{
+		struct pt_dimm_entry *p_entry = &g_pt_session.p_buckets[bucket];
+		if (p_entry->p_dimm == NULL)
+		{
+			break;
+		}
+		if (p_entry->handle == handle)
+		{
+			return p_entry;
+		}
+		bucket = (bucket + 1) & (g_pt_session.bucket_cnt - 1);
+	}
+	return NULL;
+}
+
+static int pt_session_is_absent(unsigned int handle)
+{
+	unsigned int i;
+
+	for (i = 0; i < g_pt_session.absent_cnt; i++)
+	{
+		if (g_pt_session.absent[i] == handle)
+		{
+			return 1;
+		}
+	}
+	return 0;
+}
+
+/*
+ * Drop the index and the ndctl context. Caller must hold the write lock.
  */
-int bios_read_large_payload(struct ndctl_dimm *p_dimm, struct fw_cmd *p_fw_cmd)
+static void pt_session_release_index()
+{
+	unsigned int i;
+
+	for (i = 0; i < g_pt_session.bucket_cnt; i++)
+	{
+		large_payload_free(g_pt_session.p_buckets[i].p_lp);
+	}
+	free(g_pt_session.p_buckets);
+	g_pt_session.p_buckets = NULL;
+	g_pt_session.bucket_cnt = 0;
+	g_pt_session.dimm_cnt = 0;
+	g_pt_session.absent_cnt = 0;
+	if (g_pt_session.p_ctx)
+	{
+		ndctl_unref(g_pt_session.p_ctx);
+		g_pt_session.p_ctx = NULL;
+	}
+}
+
+/*
+ * Open a fresh ndctl context and index every DIMM on every bus by handle.
+ * Caller must hold the write lock.
+ */
+static int pt_session_build_index()
 {
 	COMMON_LOG_ENTRY();
 	int rc = NVM_SUCCESS;
-	struct pt_bios_get_size mb_size;
+	struct ndctl_bus *p_bus;
+	struct ndctl_dimm *p_dimm;
+	unsigned int dimm_cnt = 0;
+	unsigned int bucket_cnt = PT_SESSION_MIN_BUCKETS;
 
-	if (!p_dimm)
+	pt_session_release_index();
+	g_pt_session.generation++;
+	g_pt_session.stale = 0;
+
+	if ((rc = ndctl_new(&g_pt_session.p_ctx)) < 0)
 	{
-		COMMON_LOG_ERROR("Invalid parameter, Dimm is null");
-		rc = NVM_ERR_INVALID_PARAMETER;
+		COMMON_LOG_ERROR("Failed to retrieve ctx");
+		g_pt_session.p_ctx = NULL;
+		rc = linux_err_to_nvm_lib_err(rc);
+		goto finish;
 	}
-	else if ((rc = bios_get_payload_size(p_dimm, &mb_size, p_fw_cmd)) == NVM_SUCCESS)
+
+	ndctl_bus_foreach(g_pt_session.p_ctx, p_bus)
 	{
-		if (mb_size.large_input_payload_size < p_fw_cmd->LargeOutputPayloadSize)
+		ndctl_dimm_foreach(p_bus, p_dimm)
 		{
-			rc = NVM_ERR_BAD_SIZE;
+			dimm_cnt++;
 		}
-		else
-		{
-			unsigned int transfer_size = mb_size.rw_size;
-			unsigned int current_offset = 0;
-			int lnx_err_status = 0;
-			unsigned int dsm_vendor_err_status = 0;
+	}
 
-			rc = NVM_SUCCESS;
-			while (current_offset < p_fw_cmd->LargeOutputPayloadSize &&
-					rc == NVM_SUCCESS)
-			{
-				if ((current_offset + mb_size.rw_size) > p_fw_cmd->LargeOutputPayloadSize)
-				{
-					transfer_size = p_fw_cmd->LargeOutputPayloadSize - current_offset;
-				}
+	while (bucket_cnt < dimm_cnt * 2)
+	{
+		bucket_cnt <<= 1;
+	}
 
-				BIOS_INPUT(bios_InputPayload, 0);
-				struct bios_InputPayload *p_dsm_input =
-					calloc(1, sizeof (struct bios_InputPayload));
-				if (p_dsm_input)
-				{
-					struct ndctl_cmd *p_vendor_cmd = NULL;
-					if ((p_vendor_cmd = ndctl_dimm_cmd_new_vendor_specific(p_dimm,
-						BUILD_DSM_OPCODE(BIOS_EMULATED_COMMAND, SUBOP_READ_LARGE_PAYLOAD_OUTPUT),
-						sizeof (*p_dsm_input), transfer_size)) == NULL)
-					{
-						rc = NVM_ERR_GENERAL_OS_DRIVER_FAILURE;
-						COMMON_LOG_ERROR("Failed to get vendor command from driver");
-					}
-					else
-					{
-						p_dsm_input->size = transfer_size;
-						p_dsm_input->offset = current_offset;
+	g_pt_session.p_buckets = calloc(bucket_cnt, sizeof (struct pt_dimm_entry));
+	if (g_pt_session.p_buckets == NULL)
+	{
+		COMMON_LOG_ERROR("Failed to allocate memory for the DIMM handle index");
+		rc = NVM_ERR_NO_MEM;
+		pt_session_release_index();
+		goto finish;
+	}
+	g_pt_session.bucket_cnt = bucket_cnt;
 
-						size_t bytes_written = ndctl_cmd_vendor_set_input(
-							p_vendor_cmd, p_dsm_input, sizeof (*p_dsm_input));
-						if (bytes_written != sizeof (*p_dsm_input))
-						{
-							COMMON_LOG_ERROR("Failed to write input payload");
-							rc = NVM_ERR_GENERAL_OS_DRIVER_FAILURE;
-						}
+	ndctl_bus_foreach(g_pt_session.p_ctx, p_bus)
+	{
+		ndctl_dimm_foreach(p_bus, p_dimm)
+		{
+			unsigned int handle = ndctl_dimm_get_handle(p_dimm);
+			unsigned int bucket = pt_hash_handle(handle, bucket_cnt);
 
-						if ((lnx_err_status = ndctl_cmd_submit(p_vendor_cmd)) == 0)
-						{
-							if ((dsm_vendor_err_status =
-									ndctl_cmd_get_firmware_status(p_vendor_cmd)) !=
-											DSM_VENDOR_SUCCESS)
-							{
-                DSM_TO_NVM_ERROR(dsm_vendor_err_status, p_fw_cmd, rc);
-								COMMON_LOG_ERROR_F("BIOS read failed: "
-										"DSM returned error %d for command with "
-										"Opcode - 0x%x SubOpcode - 0x%x ", dsm_vendor_err_status,
-										p_fw_cmd->Opcode, p_fw_cmd->SubOpcode);
-							}
-							else
-							{
-								size_t return_size = ndctl_cmd_vendor_get_output(p_vendor_cmd,
-										p_fw_cmd->LargeOutputPayload +
-										current_offset, transfer_size);
-								if (return_size != transfer_size)
-								{
-									rc = NVM_ERR_GENERAL_OS_DRIVER_FAILURE;
-									COMMON_LOG_ERROR("Large Payload returned "
-											"less data than requested");
-								}
-								else
-								{
-									current_offset += transfer_size;
-								}
-							}
-						}
-						else
-						{
-							rc = linux_err_to_nvm_lib_err(lnx_err_status);
-							COMMON_LOG_ERROR_F("BIOS read failed: "
-									"Linux driver returned error %d for command with "
-									"Opcode - 0x%x SubOpcode - 0x%x ", lnx_err_status,
-									p_fw_cmd->Opcode, p_fw_cmd->SubOpcode);
-						}
-						ndctl_cmd_unref(p_vendor_cmd);
-					}
-					free(p_dsm_input);
-				}
-				else
+			while (g_pt_session.p_buckets[bucket].p_dimm != NULL &&
+					g_pt_session.p_buckets[bucket].handle != handle)
+			{
+				bucket = (bucket + 1) & (bucket_cnt - 1);
+			}
+			// First DIMM found wins, same as get_dimm_by_handle()
+			if (g_pt_session.p_buckets[bucket].p_dimm == NULL)
+			{
+				if ((g_pt_session.p_buckets[bucket].p_lp = large_payload_new()) == NULL)
 				{
-					COMMON_LOG_ERROR("Failed to allocate memory for BIOS payload");
+					COMMON_LOG_ERROR("Failed to allocate memory for the large payload context");
 					rc = NVM_ERR_NO_MEM;
+					pt_session_release_index();
+					goto finish;
 				}
-			}  // end while
-
-			if (current_offset != p_fw_cmd->LargeOutputPayloadSize)
-			{
-				COMMON_LOG_ERROR("Failed to read large payload");
-				rc = NVM_ERR_UNKNOWN;
+				g_pt_session.p_buckets[bucket].handle = handle;
+				g_pt_session.p_buckets[bucket].p_dimm = p_dimm;
+				g_pt_session.dimm_cnt++;
 			}
 		}
 	}
 
+finish:
+	COMMON_LOG_EXIT_RETURN_I(rc);
+	return rc;
+}
+
+/*
+ * Resolve a DIMM handle through the session. On success the session read lock
+ * is held and must be dropped with passthrough_session_put_dimm().
+ */
+static int pt_session_get_dimm(unsigned int handle, struct ndctl_dimm **pp_dimm,
+		struct pt_large_payload **pp_lp)
+{
+	COMMON_LOG_ENTRY();
+	int rc = NVM_SUCCESS;
+	unsigned int seen_generation;
+	struct pt_dimm_entry *p_entry = NULL;
+
+	pthread_rwlock_rdlock(&g_pt_session_lock);
+	if (!g_pt_session.stale &&
+			(p_entry = pt_session_lookup(handle)) != NULL)
+	{
+		goto finish;
+	}
+	if (!g_pt_session.stale && g_pt_session.p_ctx != NULL &&
+			pt_session_is_absent(handle))
+	{
+		// Not there when the index was built, a rebuild would not find it either
+		pthread_rwlock_unlock(&g_pt_session_lock);
+		COMMON_LOG_ERROR("Failed to get DIMM from driver");
+		rc = NVM_ERR_GENERAL_OS_DRIVER_FAILURE;
+		goto finish;
+	}
+	seen_generation = g_pt_session.generation;
+	pthread_rwlock_unlock(&g_pt_session_lock);
+
+	// Unknown handle or stale index, the bus topology may have changed
+	pthread_rwlock_wrlock(&g_pt_session_lock);
+	if (!g_pt_session.exit_handler_registered)
+	{
+		atexit(passthrough_session_close);
+		g_pt_session.exit_handler_registered = 1;
+	}
+	// Another thread may have rebuilt the index while we waited
+	if (g_pt_session.p_ctx == NULL || g_pt_session.stale ||
+			g_pt_session.generation == seen_generation)
+	{
+		rc = pt_session_build_index();
+	}
+	if (rc == NVM_SUCCESS && pt_session_lookup(handle) == NULL &&
+			!pt_session_is_absent(handle) &&
+			g_pt_session.absent_cnt < PT_SESSION_MAX_ABSENT)
+	{
+		g_pt_session.absent[g_pt_session.absent_cnt++] = handle;
+	}
+	pthread_rwlock_unlock(&g_pt_session_lock);
+
+	pthread_rwlock_rdlock(&g_pt_session_lock);
+	if (rc == NVM_SUCCESS && (p_entry = pt_session_lookup(handle)) == NULL)
+	{
+		COMMON_LOG_ERROR("Failed to get DIMM from driver");
+		rc = NVM_ERR_GENERAL_OS_DRIVER_FAILURE;
+	}
+	if (rc != NVM_SUCCESS)
+	{
+		pthread_rwlock_unlock(&g_pt_session_lock);
+	}
+
+finish:
+	*pp_dimm = p_entry ? p_entry->p_dimm : NULL;
+	*pp_lp = p_entry ? p_entry->p_lp : NULL;
 	COMMON_LOG_EXIT_RETURN_I(rc);
 	return rc;
 }
 
+/*
+ * Look up the ndctl DIMM for an NFIT handle. When the session is disabled a
+ * private context is opened and returned in pp_private_ctx. pp_lp, when not
+ * NULL, receives the large payload context the session keeps for the DIMM,
+ * or NULL when the session is disabled.
+ */
+int passthrough_session_get_dimm(unsigned int handle, struct ndctl_dimm **pp_dimm,
+		struct ndctl_ctx **pp_private_ctx, struct pt_large_payload **pp_lp)
+{
+	int rc = NVM_SUCCESS;
+	struct pt_large_payload *p_lp = NULL;
+
+	*pp_dimm = NULL;
+	*pp_private_ctx = NULL;
+
+	if (g_pt_session_enabled)
+	{
+		rc = pt_session_get_dimm(handle, pp_dimm, &p_lp);
+	}
+	else if ((rc = ndctl_new(pp_private_ctx)) < 0)
+	{
+		COMMON_LOG_ERROR("Failed to retrieve ctx");
+		*pp_private_ctx = NULL;
+		rc = linux_err_to_nvm_lib_err(rc);
+	}
+	else if ((rc = get_dimm_by_handle(*pp_private_ctx, handle, pp_dimm)) != NVM_SUCCESS)
+	{
+		ndctl_unref(*pp_private_ctx);
+		*pp_private_ctx = NULL;
+	}
+	if (pp_lp)
+	{
+		*pp_lp = p_lp;
+	}
+	return rc;
+}
+
+/*
+ * Release a DIMM obtained with passthrough_session_get_dimm()
+ */
+void passthrough_session_put_dimm(struct ndctl_ctx *p_private_ctx)
+{
+	if (p_private_ctx)
+	{
+		ndctl_unref(p_private_ctx);
+	}
+	else
+	{
+		pthread_rwlock_unlock(&g_pt_session_lock);
+	}
+}
+
+/*
+ * Force the DIMM index to be rebuilt on the next command
+ */
+void passthrough_session_invalidate()
+{
+	pthread_rwlock_wrlock(&g_pt_session_lock);
+	g_pt_session.stale = 1;
+	pthread_rwlock_unlock(&g_pt_session_lock);
+}
+
+/*
+ * Close the ndctl context held by the session
+ */
+void passthrough_session_close()
+{
+	pthread_rwlock_wrlock(&g_pt_session_lock);
+	pt_session_release_index();
+	pthread_rwlock_unlock(&g_pt_session_lock);
+}
+
+/*
+ * Turn the session on or off. While off every command opens its own ndctl
+ * context, which is the legacy behavior.
+ */
+void passthrough_session_set_enabled(int enable)
+{
+	g_pt_session_enabled = enable ? 1 : 0;
+	if (!g_pt_session_enabled)
+	{
+		passthrough_session_close();
+	}
+}
+
 int get_dimm_by_handle(struct ndctl_ctx *ctx, unsigned int handle, struct ndctl_dimm **dimm)
 {
 	COMMON_LOG_ENTRY();
@@ -428,6 +896,16 @@ int get_dimm_by_handle(struct ndctl_ctx *ctx, unsigned int handle, struct ndctl_
 	return rc;
 }
 
+/*
+ * DSM retries needed by the last passthrough IOCTL of each thread
+ */
+static __thread int g_pt_last_retries = 0;
+
+int passthrough_get_last_retries()
+{
+	return g_pt_last_retries;
+}
+
 /*
  * Execute a passthrough IOCTL
  */
@@ -435,7 +913,11 @@ int ioctl_passthrough_fw_cmd(struct fw_cmd *p_fw_cmd)
 {
 	COMMON_LOG_ENTRY();
 	int rc = NVM_SUCCESS;
-	struct ndctl_ctx *ctx;
+	struct ndctl_ctx *p_private_ctx = NULL;
+	struct ndctl_dimm *p_dimm = NULL;
+	struct pt_large_payload *p_lp = NULL;
+	struct pt_large_payload *p_private_lp = NULL;
+	int device_gone = 0;
 	int retry = 0;
 
 	// check input parameters
@@ -462,16 +944,17 @@ int ioctl_passthrough_fw_cmd(struct fw_cmd *p_fw_cmd)
 		rc = NVM_LIB_ERR_NOTSUPPORTED;
 	}
 #endif
-	else if ((rc = ndctl_new(&ctx)) < 0)
-	{
-		COMMON_LOG_ERROR("Failed to retrieve ctx");
-		rc = linux_err_to_nvm_lib_err(rc);
-	}
 	else
 	{
-		struct ndctl_dimm *p_dimm = NULL;
-		if ((rc = get_dimm_by_handle(ctx, p_fw_cmd->DimmID, &p_dimm)) == NVM_SUCCESS)
+		if ((rc = passthrough_session_get_dimm(p_fw_cmd->DimmID, &p_dimm,
+				&p_private_ctx, &p_lp)) == NVM_SUCCESS)
 		{
+			// Without the session the context only lives for this command
+			if (p_lp == NULL && (p_fw_cmd->LargeInputPayloadSize > 0 ||
+					p_fw_cmd->LargeOutputPayloadSize > 0))
+			{
+				p_lp = p_private_lp = large_payload_new();
+			}
 			unsigned int Opcode = BUILD_DSM_OPCODE(p_fw_cmd->Opcode, p_fw_cmd->SubOpcode);
 			struct ndctl_cmd *p_vendor_cmd = NULL;
 			if ((p_vendor_cmd = ndctl_dimm_cmd_new_vendor_specific(
@@ -505,7 +988,7 @@ int ioctl_passthrough_fw_cmd(struct fw_cmd *p_fw_cmd)
 
 					if (p_fw_cmd->LargeInputPayloadSize > 0)
 					{
-						rc = bios_write_large_payload(p_dimm, p_fw_cmd);
+						rc = bios_write_large_payload(p_dimm, p_lp, p_fw_cmd);
 						if (rc != NVM_SUCCESS)
 						{
 							break;
@@ -565,13 +1048,14 @@ int ioctl_passthrough_fw_cmd(struct fw_cmd *p_fw_cmd)
 							if (p_fw_cmd->LargeOutputPayloadSize > 0)
 							{
 
-								rc = bios_read_large_payload(p_dimm, p_fw_cmd);
+								rc = bios_read_large_payload(p_dimm, p_lp, p_fw_cmd);
 							}
 							break;
 						}
 					}
 					else
 					{
+						device_gone = (lnx_err_status == -ENODEV || lnx_err_status == -ENXIO);
 						rc = linux_err_to_nvm_lib_err(lnx_err_status);
 						COMMON_LOG_ERROR_F("IOCTL passthrough failed "
 								"Linux driver returned error %d for command with "
@@ -582,10 +1066,16 @@ int ioctl_passthrough_fw_cmd(struct fw_cmd *p_fw_cmd)
 				}
 				ndctl_cmd_unref(p_vendor_cmd);
 			}
+			large_payload_free(p_private_lp);
+			passthrough_session_put_dimm(p_private_ctx);
+			if (device_gone)
+			{
+				passthrough_session_invalidate();
+			}
 		}
-		ndctl_unref(ctx);
 	}
 
+	g_pt_last_retries = retry;
 	memset(&p_fw_cmd, 0, sizeof(p_fw_cmd));
 	COMMON_LOG_EXIT_RETURN_I(rc);
 	return rc;
@@ -13,6 +13,7 @@
 //#include <os/os_adapter.h>
 #include <string.h>
 #include <stdlib.h>
+#include <sys/types.h>
 #include <os_types.h>
 
 
@@ -24,6 +25,15 @@ struct pt_bios_get_size {
 	unsigned int large_output_payload_size;
 	unsigned int rw_size;
 };
+
+/*
+ * Input header of the emulated BIOS large payload read and write commands,
+ * a write is followed by size bytes of payload
+ */
+struct pt_bios_rw_header {
+	unsigned int size;
+	unsigned int offset;
+};
 #pragma pack(pop)
 
 
@@ -32,3 +42,70 @@ struct pt_bios_get_size {
  * Execute a passthrough IOCTL
  */
 int ioctl_passthrough_fw_cmd(struct fw_cmd *p_fw_cmd);
+
+/*
+ * DSM retries the last ioctl_passthrough_fw_cmd() of the calling thread needed
+ */
+int passthrough_get_last_retries();
+
+struct ndctl_ctx;
+struct ndctl_dimm;
+struct ndctl_cmd;
+struct pt_large_payload;
+
+/*
+ * DSM transport used by the large payload engine. Defaults to libndctl,
+ * tests may substitute a fake backend.
+ */
+struct pt_dsm_backend
+{
+	struct ndctl_cmd *(*cmd_new)(struct ndctl_dimm *p_dimm, unsigned int opcode,
+		size_t input_size, size_t output_size);
+	ssize_t (*set_input)(struct ndctl_cmd *p_cmd, void *p_buf, unsigned int len);
+	ssize_t (*get_output)(struct ndctl_cmd *p_cmd, void *p_buf, unsigned int len);
+	int (*submit)(struct ndctl_cmd *p_cmd);
+	unsigned int (*get_firmware_status)(struct ndctl_cmd *p_cmd);
+	void (*unref)(struct ndctl_cmd *p_cmd);
+};
+
+void passthrough_set_dsm_backend(const struct pt_dsm_backend *p_backend);
+
+/*
+ * Per-DIMM large payload context holding the mailbox geometry and reusable
+ * DSM command objects. The passthrough session keeps one per DIMM.
+ */
+struct pt_large_payload *large_payload_new();
+void large_payload_free(struct pt_large_payload *p_lp);
+
+/*
+ * Move p_fw_cmd's large input payload into, or its large output payload out
+ * of, the emulated BIOS mailbox of the DIMM
+ */
+int bios_write_large_payload(struct ndctl_dimm *p_dimm, struct pt_large_payload *p_lp,
+		struct fw_cmd *p_fw_cmd);
+int bios_read_large_payload(struct ndctl_dimm *p_dimm, struct pt_large_payload *p_lp,
+		struct fw_cmd *p_fw_cmd);
+
+/*
+ * Resolve an NFIT handle to an ndctl DIMM through the process-lifetime
+ * passthrough session. Must be paired with passthrough_session_put_dimm().
+ */
+int passthrough_session_get_dimm(unsigned int handle, struct ndctl_dimm **pp_dimm,
+		struct ndctl_ctx **pp_private_ctx, struct pt_large_payload **pp_lp);
+void passthrough_session_put_dimm(struct ndctl_ctx *p_private_ctx);
+
+/*
+ * Force the DIMM index to be rebuilt on the next passthrough command
+ */
+void passthrough_session_invalidate();
+
+/*
+ * Release the ndctl context held by the passthrough session
+ */
+void passthrough_session_close();
+
+/*
+ * Enable (default) or disable the passthrough session. While disabled each
+ * command opens and closes its own ndctl context.
+ */
+void passthrough_session_set_enabled(int enable);
@@ -25,6 +25,10 @@
 #include <sys/types.h>
 #include <sys/ipc.h>
 #include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <time.h>
+#include <sys/timerfd.h>
 #include <nvm_management.h>
 #include <os.h>
 #include <lnx_adapter.h>
@@ -82,6 +86,248 @@ void os_sleep(unsigned long time)
 	nanosleep(&ts, NULL);
 }
 
+/*
+ * Milliseconds elapsed since an arbitrary point, unaffected by wall clock changes
+ */
+unsigned long long os_get_monotonic_ms()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((unsigned long long)ts.tv_sec * 1000) + ((unsigned long long)ts.tv_nsec / 1000000);
+}
+
+/*
+ * Microseconds elapsed since an arbitrary point, unaffected by wall clock changes
+ */
+unsigned long long os_get_monotonic_us()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((unsigned long long)ts.tv_sec * 1000000) + ((unsigned long long)ts.tv_nsec / 1000);
+}
+
+#define	TICKS_100NS_PER_SEC	10000000ULL
+
+struct lnx_timer
+{
+	int fd;
+};
+
+static void ticks_to_timespec(unsigned long long ticks_100ns, struct timespec *p_ts)
+{
+	p_ts->tv_sec = (time_t)(ticks_100ns / TICKS_100NS_PER_SEC);
+	p_ts->tv_nsec = (long)((ticks_100ns % TICKS_100NS_PER_SEC) * 100);
+}
+
+/*
+ * Create a disarmed timer driven by CLOCK_MONOTONIC
+ */
+OS_TIMER *os_timer_create()
+{
+	struct lnx_timer *p_timer = (struct lnx_timer *) malloc(sizeof(struct lnx_timer));
+	if (p_timer)
+	{
+		p_timer->fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+		if (p_timer->fd < 0)
+		{
+			free(p_timer);
+			p_timer = NULL;
+		}
+	}
+	return p_timer;
+}
+
+/*
+ * Arm a timer to expire due_100ns from now and then every period_100ns
+ * (0 for a one-shot timer). A due time of 0 disarms the timer. Any
+ * expiration still pending from the previous setting is discarded.
+ * Returns 0 on success.
+ */
+int os_timer_set(OS_TIMER *p_timer, unsigned long long due_100ns, unsigned long long period_100ns)
+{
+	struct itimerspec spec;
+
+	if (NULL == p_timer)
+	{
+		return -1;
+	}
+	ticks_to_timespec(due_100ns, &spec.it_value);
+	ticks_to_timespec(due_100ns ? period_100ns : 0, &spec.it_interval);
+	return timerfd_settime(((struct lnx_timer *)p_timer)->fd, 0, &spec, NULL);
+}
+
+/*
+ * Block until at least one of the timers expires. The lowest expired index
+ * is returned and only its expiration is consumed; the others stay pending
+ * for the next call. Periodic timers keep their original phase, so missed
+ * periods coalesce instead of drifting. Returns 0 on success.
+ */
+int os_timer_wait(OS_TIMER **pp_timers, unsigned int count, unsigned int *p_index)
+{
+	struct pollfd fds[OS_TIMER_WAIT_MAX];
+	unsigned long long expirations;
+	unsigned int i;
+
+	if (NULL == pp_timers || NULL == p_index || 0 == count || OS_TIMER_WAIT_MAX < count)
+	{
+		return -1;
+	}
+	for (i = 0; i < count; i++)
+	{
+		if (NULL == pp_timers[i])
+		{
+			return -1;
+		}
+		fds[i].fd = ((struct lnx_timer *)pp_timers[i])->fd;
+		fds[i].events = POLLIN;
+		fds[i].revents = 0;
+	}
+
+	for (;;)
+	{
+		if (poll(fds, count, -1) < 0)
+		{
+			if (EINTR == errno)
+			{
+				continue;
+			}
+			return -1;
+		}
+		for (i = 0; i < count; i++)
+		{
+			// a concurrent os_timer_set() may have drained it since poll() returned
+			if ((fds[i].revents & POLLIN) &&
+				read(fds[i].fd, &expirations, sizeof(expirations)) == sizeof(expirations))
+			{
+				*p_index = i;
+				return 0;
+			}
+		}
+	}
+}
+
+/*
+ * Release a timer created by os_timer_create()
+ */
+int os_timer_delete(OS_TIMER *p_timer)
+{
+	int rc = -1;
+	if (p_timer)
+	{
+		rc = close(((struct lnx_timer *)p_timer)->fd);
+		free(p_timer);
+	}
+	return rc;
+}
+
+
+struct lnx_notifier
+{
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+	unsigned long long seq;
+};
+
+/*
+ * Create a notifier: a sequence number that threads can wait on to change.
+ * Read the sequence, check the state it guards, then wait for a newer one;
+ * a signal in between is never lost.
+ */
+OS_NOTIFIER *os_notifier_create()
+{
+	pthread_condattr_t attr;
+	struct lnx_notifier *p_notifier = (struct lnx_notifier *) calloc(1, sizeof(struct lnx_notifier));
+	if (p_notifier)
+	{
+		pthread_condattr_init(&attr);
+		pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+		pthread_mutex_init(&p_notifier->mutex, NULL);
+		pthread_cond_init(&p_notifier->cond, &attr);
+		pthread_condattr_destroy(&attr);
+	}
+	return p_notifier;
+}
+
+/*
+ * Current sequence number of a notifier
+ */
+unsigned long long os_notifier_seq(OS_NOTIFIER *p_notifier)
+{
+	struct lnx_notifier *p_n = (struct lnx_notifier *)p_notifier;
+	unsigned long long seq;
+
+	pthread_mutex_lock(&p_n->mutex);
+	seq = p_n->seq;
+	pthread_mutex_unlock(&p_n->mutex);
+	return seq;
+}
+
+/*
+ * Advance the sequence number and wake every waiter
+ */
+void os_notifier_signal(OS_NOTIFIER *p_notifier)
+{
+	struct lnx_notifier *p_n = (struct lnx_notifier *)p_notifier;
+
+	pthread_mutex_lock(&p_n->mutex);
+	p_n->seq++;
+	pthread_cond_broadcast(&p_n->cond);
+	pthread_mutex_unlock(&p_n->mutex);
+}
+
+/*
+ * Block until the sequence number differs from seen_seq or timeout_ms
+ * (negative for no timeout) passes. Returns 0 when signaled, 1 on timeout.
+ */
+int os_notifier_wait(OS_NOTIFIER *p_notifier, unsigned long long seen_seq, long timeout_ms)
+{
+	struct lnx_notifier *p_n = (struct lnx_notifier *)p_notifier;
+	struct timespec deadline;
+	int rc = 0;
+
+	clock_gettime(CLOCK_MONOTONIC, &deadline);
+	if (timeout_ms > 0)
+	{
+		deadline.tv_sec += timeout_ms / 1000;
+		deadline.tv_nsec += (timeout_ms % 1000) * 1000000;
+		if (deadline.tv_nsec >= 1000000000)
+		{
+			deadline.tv_sec++;
+			deadline.tv_nsec -= 1000000000;
+		}
+	}
+
+	pthread_mutex_lock(&p_n->mutex);
+	while (p_n->seq == seen_seq && 0 == rc)
+	{
+		if (timeout_ms < 0)
+		{
+			pthread_cond_wait(&p_n->cond, &p_n->mutex);
+		}
+		else if (ETIMEDOUT == pthread_cond_timedwait(&p_n->cond, &p_n->mutex, &deadline))
+		{
+			rc = (p_n->seq == seen_seq) ? 1 : 0;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&p_n->mutex);
+	return rc;
+}
+
+/*
+ * Release a notifier created by os_notifier_create()
+ */
+void os_notifier_delete(OS_NOTIFIER *p_notifier)
+{
+	struct lnx_notifier *p_n = (struct lnx_notifier *)p_notifier;
+
+	if (p_n)
+	{
+		pthread_cond_destroy(&p_n->cond);
+		pthread_mutex_destroy(&p_n->mutex);
+		free(p_n);
+	}
+}
 
 /*
  * Start a process
@@ -122,11 +368,28 @@ int os_stop_process(unsigned int process_id)
  */
 void os_create_thread(unsigned long long *p_thread_id, void *(*callback)(void *), void *callback_arg)
 {
-	pthread_create(
+	if (0 != pthread_create(
 			(pthread_t *)p_thread_id,
 			NULL, // default attributes
 			callback,
-			callback_arg);
+			callback_arg))
+	{
+		// a zero id tells os_join_thread there is nothing to wait for
+		*p_thread_id = 0;
+	}
+}
+
+/*
+ * Wait for a thread created by os_create_thread to finish
+ */
+int os_join_thread(unsigned long long thread_id)
+{
+	int rc = -1;
+	if (0 != thread_id && 0 == pthread_join((pthread_t)thread_id, NULL))
+	{
+		rc = 0;
+	}
+	return rc;
 }
 
 /*
@@ -0,0 +1,32 @@
+/*
+ * Copyright (c) 2018, Intel Corporation.
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <stdio.h>
+#include "../unittest/BttTestVolume.h"
+
+#define BTT_BENCH_OPS 40000
+
+TEST(Btt_Bench, LaneScaling)
+{
+  BttTestVolume volume;
+  std::vector<unsigned long long> versions(BTT_TEST_LBAS, 1);
+  std::atomic<unsigned int> errors(0);
+
+  ASSERT_TRUE(volume.Open());
+  ASSERT_TRUE(volume.WriteAll(1));
+  for (unsigned int threads = 1; threads <= BTT_TEST_THREADS; threads *= 2)
+  {
+    auto start = std::chrono::steady_clock::now();
+    volume.RunThreads(threads, BTT_BENCH_OPS / threads, versions, errors);
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    printf("%u thread(s): %u random 4 KiB I/Os (half writes) in %.1f ms, %.0f MiB/s\n",
+      threads, BTT_BENCH_OPS, ms, (double)BTT_BENCH_OPS * BTT_TEST_LBA_SIZE / (1 << 20) / (ms / 1000));
+  }
+  EXPECT_EQ(0u, errors.load());
+  EXPECT_EQ(EFI_SUCCESS, BttCheck(volume.p_btt));
+}
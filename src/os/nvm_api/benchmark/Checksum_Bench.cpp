@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) 2018, Intel Corporation.
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <gtest/gtest.h>
+#include <chrono>
+#include <random>
+#include <vector>
+#include <stdio.h>
+#include "../unittest/ChecksumReference.h"
+
+#define CHECKSUM_BENCH_MIN_LENGTH   256
+#define CHECKSUM_BENCH_MAX_LENGTH   (1024 * 1024)
+#define CHECKSUM_BENCH_BYTES        (256ull * 1024 * 1024)
+
+TEST(Checksum_Bench, Throughput)
+{
+  std::mt19937 rng(2018);
+  std::vector<CHECKSUM_KERNEL> kernels;
+  std::vector<unsigned char> data(CHECKSUM_BENCH_MAX_LENGTH);
+  for (auto &byte : data)
+  {
+    byte = (unsigned char)rng();
+  }
+  for (int kernel = ChecksumKernelPortable; kernel < ChecksumKernelMax; kernel++)
+  {
+    if (ChecksumSelectKernel((CHECKSUM_KERNEL)kernel) == EFI_SUCCESS)
+    {
+      kernels.push_back((CHECKSUM_KERNEL)kernel);
+    }
+  }
+
+  for (size_t length = CHECKSUM_BENCH_MIN_LENGTH; length <= CHECKSUM_BENCH_MAX_LENGTH; length *= 4)
+  {
+    unsigned long long iterations = CHECKSUM_BENCH_BYTES / length / 8;
+    volatile unsigned long long sink = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for (unsigned long long i = 0; i < iterations; i++)
+    {
+      sink += reference_fletcher64(data.data(), length, (size_t)-1);
+    }
+    double ref_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("%8zu B  fletcher64 word loop %7.2f GiB/s", length, (double)iterations * length / (1 << 30) / ref_s);
+
+    for (CHECKSUM_KERNEL kernel : kernels)
+    {
+      ChecksumSelectKernel(kernel);
+      start = std::chrono::steady_clock::now();
+      for (unsigned long long i = 0; i < iterations; i++)
+      {
+        FLETCHER64_CONTEXT context;
+        Fletcher64Init(&context);
+        Fletcher64Update(&context, data.data(), length);
+        sink += Fletcher64Final(&context);
+      }
+      double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+      printf("  %s %7.2f GiB/s", g_checksum_kernel_names[kernel], (double)iterations * length / (1 << 30) / s);
+    }
+    printf("\n");
+
+    start = std::chrono::steady_clock::now();
+    for (unsigned long long i = 0; i < iterations; i++)
+    {
+      sink += reference_byte_checksum(data.data(), (unsigned int)length, 0);
+    }
+    ref_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("%8zu B  byte sum loop        %7.2f GiB/s", length, (double)iterations * length / (1 << 30) / ref_s);
+
+    for (CHECKSUM_KERNEL kernel : kernels)
+    {
+      ChecksumSelectKernel(kernel);
+      start = std::chrono::steady_clock::now();
+      for (unsigned long long i = 0; i < iterations; i++)
+      {
+        sink += ChecksumSum8(data.data(), length);
+      }
+      double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+      printf("  %s %7.2f GiB/s", g_checksum_kernel_names[kernel], (double)iterations * length / (1 << 30) / s);
+    }
+    printf("\n");
+  }
+  ChecksumSelectKernel(ChecksumKernelAuto);
+}
@@ -0,0 +1,69 @@
+/*
+ * Copyright (c) 2018, Intel Corporation.
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <gtest/gtest.h>
+#include <chrono>
+#include <string>
+#include <stdio.h>
+
+extern "C" {
+#include <AutoGen.h>
+#include <DataSet.h>
+}
+
+#define DATA_SET_BENCH_DIMMS        100
+#define DATA_SET_BENCH_ERRORS       1000
+
+TEST(DataSet_Bench, Build)
+{
+  DATA_SET_CONTEXT *p_root = CreateDataSet(NULL, (CHAR16 *)L"Root", NULL);
+  ASSERT_NE((void *)NULL, p_root);
+
+  auto start = std::chrono::steady_clock::now();
+  for (int dimm = 0; dimm < DATA_SET_BENCH_DIMMS; dimm++)
+  {
+    for (int error = 0; error < DATA_SET_BENCH_ERRORS; error++)
+    {
+      DATA_SET_CONTEXT *p_error = GetDataSet(p_root, (CHAR16 *)L"/Root/DimmList/Dimm[%d]/Error[%d]", dimm, error);
+      ASSERT_NE((void *)NULL, p_error);
+      SetKeyValueUint32(p_error, L"DimmID", dimm, HEX);
+      SetKeyValueUint64(p_error, L"SystemTimestamp", 1500000000ull + error, DECIMAL);
+      SetKeyValueUint64(p_error, L"DPA", error * 64ull, HEX);
+      SetKeyValueUint8(p_error, L"ErrorType", error % 4, DECIMAL);
+      SetKeyValueWideStr(p_error, L"Description", L"Media error");
+    }
+  }
+  double build_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+  start = std::chrono::steady_clock::now();
+  unsigned long long nodes = 0;
+  unsigned long long chars = 0;
+  DATA_SET_CONTEXT *p_list = GetDataSet(p_root, (CHAR16 *)L"/Root/DimmList");
+  DATA_SET_CONTEXT *p_dimm = NULL;
+  while (NULL != (p_dimm = GetNextChildDataSet(p_list, p_dimm)))
+  {
+    DATA_SET_CONTEXT *p_error = NULL;
+    while (NULL != (p_error = GetNextChildDataSet(p_dimm, p_error)))
+    {
+      KEY_VAL_INFO *p_info = NULL;
+      while (NULL != (p_info = GetNextKey(p_error, p_info)))
+      {
+        CHAR16 *p_val = NULL;
+        GetKeyValueWideStr(p_error, p_info->Key, &p_val, (CHAR16 *)L"");
+        chars += p_val ? std::wstring(p_val).size() : 0;
+      }
+      nodes++;
+    }
+  }
+  double print_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+  EXPECT_EQ((unsigned long long)DATA_SET_BENCH_DIMMS * DATA_SET_BENCH_ERRORS, nodes);
+
+  start = std::chrono::steady_clock::now();
+  FreeDataSet(p_root);
+  double free_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+  printf("%llu nodes with 5 keys: build %.1f ms, format %llu chars %.1f ms, free %.1f ms\n",
+    nodes, build_ms, chars, print_ms, free_ms);
+}
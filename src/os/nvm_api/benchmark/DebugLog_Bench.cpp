@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) 2018, Intel Corporation.
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <gtest/gtest.h>
+#include <nvm_management.h>
+#include <chrono>
+#include <vector>
+#include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+extern "C" {
+#include <AutoGen.h>
+#include <os_common.h>
+#include <os_efi_log_ring.h>
+}
+
+#define DBG_LOG_BENCH_RING_FILE   "debug_log_bench.bin"
+#define DBG_LOG_BENCH_ITERATIONS  20
+
+// Time the show -dimm equivalent with the logging configuration in effect
+static double show_dimm_ms()
+{
+  unsigned int count = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < DBG_LOG_BENCH_ITERATIONS; i++)
+  {
+    EXPECT_EQ(NVM_SUCCESS, nvm_get_number_of_devices(&count));
+    if (count > 0)
+    {
+      std::vector<struct device_discovery> devices(count);
+      EXPECT_EQ(NVM_SUCCESS, nvm_get_devices(devices.data(), (NVM_UINT8)count));
+    }
+  }
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() /
+    DBG_LOG_BENCH_ITERATIONS;
+}
+
+// The levels are set in memory only, the DBG_LOG_LEVEL preference is not touched
+TEST(DebugLog_Bench, ShowDimmLoggingOverhead)
+{
+  int saved_stdout = dup(STDOUT_FILENO);
+  int null_fd = open("/dev/null", O_WRONLY);
+  ASSERT_GE(saved_stdout, 0);
+  ASSERT_GE(null_fd, 0);
+
+  nvm_init();
+  int saved_enabled = nvm_debug_logging_enabled();
+  UINTN saved_mask = g_debug_print_mask;
+
+  g_debug_print_mask = 0;
+  double off_ms = show_dimm_ms();
+
+  // The messages printed to stdout are discarded, only their cost is measured
+  fflush(stdout);
+  dup2(null_fd, STDOUT_FILENO);
+  EXPECT_EQ(NVM_SUCCESS, nvm_toggle_debug_logging(1));
+  g_debug_print_mask = OS_DEBUG_ERROR | OS_DEBUG_WARN;
+  double default_ms = show_dimm_ms();
+  g_debug_print_mask = MAX_UINTN;
+  double verbose_ms = show_dimm_ms();
+  fflush(stdout);
+  dup2(saved_stdout, STDOUT_FILENO);
+
+  // Full verbosity captured by the binary ring instead of stdout
+  remove(DBG_LOG_BENCH_RING_FILE);
+  EXPECT_EQ(EFI_SUCCESS, debug_log_ring_open(DBG_LOG_BENCH_RING_FILE, LOG_RING_DEFAULT_SIZE));
+  EXPECT_EQ(NVM_SUCCESS, nvm_toggle_debug_logging(0));
+  g_debug_print_mask = MAX_UINTN;
+  double ring_ms = show_dimm_ms();
+  debug_log_ring_close();
+  remove(DBG_LOG_BENCH_RING_FILE);
+
+  nvm_toggle_debug_logging((NVM_BOOL)saved_enabled);
+  g_debug_print_mask = saved_mask;
+  nvm_uninit();
+  close(null_fd);
+  close(saved_stdout);
+
+  printf("show -dimm x%d: logging off %.2f ms, warnings to stdout %.2f ms, "
+    "verbose to stdout %.2f ms, verbose to ring %.2f ms per iteration\n",
+    DBG_LOG_BENCH_ITERATIONS, off_ms, default_ms, verbose_ms, ring_ms);
+}
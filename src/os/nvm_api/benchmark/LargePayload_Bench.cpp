@@ -0,0 +1,53 @@
+/*
+ * Copyright (c) 2018, Intel Corporation.
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <gtest/gtest.h>
+#include <nvm_management.h>
+#include <chrono>
+#include <stdio.h>
+#include "../unittest/LargePayloadFake.h"
+
+#define LP_BENCH_ITERATIONS 64
+
+TEST(LargePayload_Bench, MailboxThroughput)
+{
+  struct ndctl_dimm *p_dimm = (struct ndctl_dimm *)&g_fake_mailbox;
+  std::vector<unsigned char> in_payload(LP_MAILBOX_SIZE);
+  std::vector<unsigned char> out_payload(LP_MAILBOX_SIZE);
+  struct fw_cmd cmd;
+
+  for (unsigned int i = 0; i < LP_MAILBOX_SIZE; i++)
+  {
+    in_payload[i] = (unsigned char)(i * 7 + (i >> 12));
+  }
+  memset(&cmd, 0, sizeof(cmd));
+  cmd.LargeInputPayloadSize = LP_MAILBOX_SIZE;
+  cmd.LargeInputPayload = in_payload.data();
+  cmd.LargeOutputPayloadSize = LP_MAILBOX_SIZE;
+  cmd.LargeOutputPayload = out_payload.data();
+
+  passthrough_set_dsm_backend(&g_fake_dsm_backend);
+  struct pt_large_payload *p_lp = large_payload_new();
+  ASSERT_TRUE(p_lp != NULL);
+
+  // Warm up the geometry query and the write and read commands
+  ASSERT_EQ(bios_write_large_payload(p_dimm, p_lp, &cmd), NVM_SUCCESS);
+  ASSERT_EQ(bios_read_large_payload(p_dimm, p_lp, &cmd), NVM_SUCCESS);
+
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < LP_BENCH_ITERATIONS; i++)
+  {
+    ASSERT_EQ(bios_write_large_payload(p_dimm, p_lp, &cmd), NVM_SUCCESS);
+    ASSERT_EQ(bios_read_large_payload(p_dimm, p_lp, &cmd), NVM_SUCCESS);
+  }
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  EXPECT_EQ(memcmp(in_payload.data(), out_payload.data(), in_payload.size()), 0);
+
+  printf("Large payload write+read of a 1 MiB mailbox: %.1f MiB/s\n",
+    2.0 * LP_BENCH_ITERATIONS / seconds);
+
+  large_payload_free(p_lp);
+  passthrough_set_dsm_backend(NULL);
+}
@@ -0,0 +1,52 @@
+/*
+ * Copyright (c) 2018, Intel Corporation.
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <gtest/gtest.h>
+#include <nvm_management.h>
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include "../unittest/NlogTestData.h"
+
+extern "C" {
+#include <AutoGen.h>
+#include <Nlog.h>
+}
+
+#define NLOG_BENCH_DICT_FILE     "nlog_bench_dict.txt"
+#define NLOG_BENCH_DECODED_FILE  "nlog_bench_decoded.txt"
+#define NLOG_BENCH_LOG_SIZE      (64ull * 1024 * 1024)
+
+TEST(NlogDecode_Bench, Decode64MiBLog)
+{
+  unsigned int version = 0;
+  unsigned long long entries = 0;
+  unsigned char *p_log = (unsigned char *)calloc(1, NLOG_BENCH_LOG_SIZE);
+  ASSERT_NE(p_log, (unsigned char *)NULL);
+
+  nvm_init();
+  ASSERT_TRUE(NlogTestData::WriteDict(NLOG_BENCH_DICT_FILE));
+  unsigned long long records = NlogTestData::FillLog(p_log, NLOG_BENCH_LOG_SIZE);
+
+  auto start = std::chrono::steady_clock::now();
+  nlog_dict *p_dict = load_nlog_dict(NULL, (CHAR16 *)L"" NLOG_BENCH_DICT_FILE, &version, &entries);
+  auto loaded = std::chrono::steady_clock::now();
+  ASSERT_NE(p_dict, (nlog_dict *)NULL);
+  decode_nlog_binary(NULL, (CHAR16 *)L"" NLOG_BENCH_DECODED_FILE, p_log, NLOG_BENCH_LOG_SIZE, p_dict);
+  auto decoded = std::chrono::steady_clock::now();
+
+  EXPECT_EQ(NlogTestData::CountLines(NLOG_BENCH_DECODED_FILE), records + 2);
+
+  printf("Dictionary of %llu entries loaded in %.1f ms, %llu records (%llu MiB) decoded in %.1f ms\n",
+    entries, std::chrono::duration<double, std::milli>(loaded - start).count(),
+    records, NLOG_BENCH_LOG_SIZE >> 20,
+    std::chrono::duration<double, std::milli>(decoded - loaded).count());
+
+  free_nlog_dict(p_dict);
+  free(p_log);
+  remove(NLOG_BENCH_DICT_FILE);
+  remove(NLOG_BENCH_DECODED_FILE);
+  nvm_uninit();
+}
@@ -0,0 +1,62 @@
+/*
+ * Copyright (c) 2018, Intel Corporation.
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <gtest/gtest.h>
+#include <nvm_management.h>
+#include <chrono>
+#include <string.h>
+
+extern "C" {
+#include <lnx_adapter_passthrough.h>
+}
+
+#define PT_BENCH_ITERATIONS 200
+
+// Average latency in microseconds of an Identify DIMM passthrough
+static double identify_latency_us(unsigned int handle, int session_enabled)
+{
+  struct fw_cmd cmd;
+  double elapsed_us = 0;
+
+  passthrough_session_set_enabled(session_enabled);
+  for (int i = 0; i < PT_BENCH_ITERATIONS; i++)
+  {
+    memset(&cmd, 0, sizeof(cmd));
+    cmd.DimmID = handle;
+    cmd.Opcode = 0x01;     // Identify
+    cmd.SubOpcode = 0x00;  // DIMM
+    cmd.OutputPayloadSize = OUT_PAYLOAD_SIZE;
+
+    auto start = std::chrono::steady_clock::now();
+    int rc = ioctl_passthrough_fw_cmd(&cmd);
+    elapsed_us += std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+    if (NVM_SUCCESS != rc)
+    {
+      ADD_FAILURE() << "Identify DIMM failed: " << rc;
+      break;
+    }
+  }
+  passthrough_session_set_enabled(1);
+  return elapsed_us / PT_BENCH_ITERATIONS;
+}
+
+TEST(PassthroughSession_Bench, IdentifyLatency)
+{
+  unsigned int dimm_cnt = 0;
+  if (NVM_SUCCESS != nvm_get_number_of_devices(&dimm_cnt) || 0 == dimm_cnt)
+  {
+    GTEST_SKIP() << "no DCPMM DIMMs found";
+  }
+
+  device_discovery *p_devices = (device_discovery *)calloc(dimm_cnt, sizeof(device_discovery));
+  ASSERT_EQ(NVM_SUCCESS, nvm_get_devices(p_devices, dimm_cnt));
+
+  double off_us = identify_latency_us(p_devices->device_handle.handle, 0);
+  double on_us = identify_latency_us(p_devices->device_handle.handle, 1);
+  printf("Identify DIMM passthrough latency: session off %.1f us, session on %.1f us\n",
+    off_us, on_us);
+
+  free(p_devices);
+}
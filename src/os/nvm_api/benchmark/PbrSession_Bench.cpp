@@ -0,0 +1,70 @@
+/*
+ * Copyright (c) 2018, Intel Corporation.
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <gtest/gtest.h>
+#include <chrono>
+#include <stdio.h>
+#include "../unittest/PbrTestSession.h"
+
+#define PBR_BENCH_RECORDS 1000000
+
+static double elapsed_ms(std::chrono::steady_clock::time_point start)
+{
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+TEST(PbrSession_Bench, ReplayMillionPassThruCommands)
+{
+  PbrTestSession session;
+  ASSERT_TRUE(session.Open());
+
+  auto start = std::chrono::steady_clock::now();
+  session.Record(PBR_BENCH_RECORDS);
+  double record_ms = elapsed_ms(start);
+
+  start = std::chrono::steady_clock::now();
+  session.Reload();
+  double load_ms = elapsed_ms(start);
+
+  // Saved as the session file, then mapped the way the next command would
+  start = std::chrono::steady_clock::now();
+  ASSERT_EQ(EFI_SUCCESS, PbrUninit());
+  ASSERT_EQ(EFI_SUCCESS, PbrInit());
+  double map_ms = elapsed_ms(start);
+
+  CONST VOID *p_view = NULL;
+  UINT32 size = 0;
+  start = std::chrono::steady_clock::now();
+  for (UINT32 i = 0; i < PBR_BENCH_RECORDS; i++)
+  {
+    ASSERT_EQ(EFI_SUCCESS, PbrGetDataView(PBR_PASS_THRU_SIG, GET_NEXT_DATA_INDEX, &p_view, &size, NULL));
+    ASSERT_EQ(i, *(CONST UINT32 *)p_view);
+  }
+  double view_ms = elapsed_ms(start);
+
+  start = std::chrono::steady_clock::now();
+  for (UINT32 i = 0; i < PBR_BENCH_RECORDS; i++)
+  {
+    UINT32 index = (UINT32)(((UINT64)i * 7919) % PBR_BENCH_RECORDS);
+    ASSERT_EQ(EFI_SUCCESS, PbrGetDataView(PBR_PASS_THRU_SIG, (INT32)index, &p_view, &size, NULL));
+    ASSERT_EQ(index, *(CONST UINT32 *)p_view);
+  }
+  double indexed_ms = elapsed_ms(start);
+
+  start = std::chrono::steady_clock::now();
+  for (UINT32 i = 0; i < PBR_BENCH_RECORDS; i++)
+  {
+    VOID *p_copy = NULL;
+    ASSERT_EQ(EFI_SUCCESS, PbrGetData(PBR_PASS_THRU_SIG, (INT32)i, &p_copy, &size, NULL));
+    ASSERT_EQ(i, *(UINT32 *)p_copy);
+    free(p_copy);
+  }
+  double copy_ms = elapsed_ms(start);
+
+  printf("%d pass through records: record %.0f ms, load %.0f ms, save and map %.0f ms\n",
+    PBR_BENCH_RECORDS, record_ms, load_ms, map_ms);
+  printf("replay: in place %.0f ms, random index %.0f ms, copied %.0f ms\n",
+    view_ms, indexed_ms, copy_ms);
+}
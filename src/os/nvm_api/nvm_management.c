@@ -52,13 +52,40 @@ OS_MUTEX *g_api_mutex;
 unsigned int g_dimm_cnt;
 int g_basic_commands = 0;
 DIMM_INFO *g_dimms;
+/*
+ * UID lookup table over g_dimms, built along with it so get_dimm_id() does
+ * not convert and compare every PMem module UID on each call. Open addressing,
+ * each slot holds a g_dimms position + 1, 0 for a free slot.
+ */
+static UINT32 *g_dimm_uid_slots;
+static UINT32 g_dimm_uid_bits;
 int get_dimm_id(const char *uid, UINT16 *dimm_id, unsigned int *dimm_handle);
+static void free_dimm_uid_table(void);
 void dimm_info_to_device_discovery(DIMM_INFO *p_dimm, struct device_discovery *p_device);
 int g_nvm_initialized = 0;
 int get_fw_err_log_stats(const unsigned int dimm_id, const unsigned char log_level, const unsigned char log_type, LOG_INFO_DATA_RETURN *log_info);
 static int nvm_internal_init(BOOLEAN binding_start);
 static void nvm_internal_uninit(BOOLEAN binding_stop);
 
+/*
+ * Session opened by nvm_create_context(). While it is open the state the
+ * library builds on init (ACPI tables, SMBIOS, PMem module inventory, PCD
+ * and LSA caches, the passthrough handle) stays resident across API calls
+ * and nvm_uninit() is deferred until the last nvm_free_context().
+ */
+typedef struct _NVM_CONTEXT {
+  UINT32 RefCount;
+  BOOLEAN OwnsInit;       ///< The library was initialized by nvm_create_context()
+  BOOLEAN UninitPending;  ///< nvm_uninit() was called while the context was open
+} NVM_CONTEXT;
+static NVM_CONTEXT g_nvm_context;
+static EFI_STATUS get_dimm_info_cached(UINT16 dimm_id, DIMM_INFO_CATEGORIES categories, DIMM_INFO *p_dimm_info);
+static EFI_STATUS get_sensors_info_cached(UINT16 dimm_id, DIMM_SENSOR dimm_sensors_set[SENSOR_TYPE_COUNT]);
+static int dimm_info_cache_init();
+static void dimm_info_cache_invalidate();
+static void dimm_info_cache_uninit();
+static void job_engine_uninit();
+
 extern EFI_SHELL_PARAMETERS_PROTOCOL gOsShellParametersProtocol;
 extern NVMDIMMDRIVER_DATA *gNvmDimmData;
 extern EFI_DRIVER_BINDING_PROTOCOL gNvmDimmDriverDriverBinding;
@@ -92,8 +119,12 @@ static int nvm_internal_init(BOOLEAN binding_start)
 
   if (g_nvm_initialized) {
 
-    // Clear PCD cache on any API entry point
-    ClearPcdCacheOnDimmList();
+    // Clear PCD cache on any API entry point, unless a context keeps it
+    os_mutex_lock(g_api_mutex);
+    if (0 == g_nvm_context.RefCount) {
+      ClearPcdCacheOnDimmList();
+    }
+    os_mutex_unlock(g_api_mutex);
 
     return rc;
   }
@@ -117,6 +148,13 @@ static int nvm_internal_init(BOOLEAN binding_start)
     return NVM_ERR_UNKNOWN;
   }
 
+  if (NVM_SUCCESS != dimm_info_cache_init())
+  {
+    NVDIMM_ERR("Failed to intialize the DIMM info cache\n");
+    rc = NVM_ERR_UNKNOWN;
+    goto cleanup_mutex;
+  }
+
   EFI_HANDLE FakeBindHandle = (EFI_HANDLE)0x1;
   init_protocol_bs();
   init_protocol_simple_file_system_protocol();
@@ -128,6 +166,7 @@ static int nvm_internal_init(BOOLEAN binding_start)
     rc = NVM_ERR_UNKNOWN;
     goto cleanup_mutex;
   }
+  DebugLoggerInit();
 
   if (EFI_SUCCESS != NvmDimmDriverDriverEntryPoint(0, NULL))
   {
@@ -154,6 +193,7 @@ static int nvm_internal_init(BOOLEAN binding_start)
   g_nvm_initialized = 1;
   return rc;
 cleanup_mutex:
+  dimm_info_cache_uninit();
   os_mutex_delete(g_api_mutex, NVM_API_MUTEX);
   g_api_mutex = NULL;
   return rc;
@@ -161,25 +201,44 @@ cleanup_mutex:
 
 NVM_API void nvm_uninit()
 {
+  os_mutex_lock(g_api_mutex);
+  if (0 != g_nvm_context.RefCount) {
+    // Done by the last nvm_free_context()
+    g_nvm_context.UninitPending = TRUE;
+    os_mutex_unlock(g_api_mutex);
+    return;
+  }
   nvm_internal_uninit(TRUE);
 }
 
+/*
+ * Called with g_api_mutex held so that the decision to uninit and the
+ * uninit itself are atomic with respect to the context calls. The mutex
+ * is released and deleted along with the rest of the library state.
+ */
 static void nvm_internal_uninit(BOOLEAN binding_stop)
 {
   EFI_HANDLE FakeBindHandle = (EFI_HANDLE)0x1;
+  OS_MUTEX *p_api_mutex = g_api_mutex;
 
   if (binding_stop && (!g_fast_path && !g_basic_commands)) {
     NvmDimmDriverDriverBindingStop(&gNvmDimmDriverDriverBinding, FakeBindHandle, 0, NULL);
   }
   NvmDimmDriverUnload(FakeBindHandle);
   uninit_protocol_shell_parameters_protocol();
+  DebugLoggerUninit();
   preferences_uninit();
+  job_engine_uninit();
+  dimm_info_cache_uninit();
+  free_dimm_uid_table();
+  g_dimm_cnt = 0;
+  g_nvm_initialized = 0;
 
-  if (g_api_mutex) {
-    os_mutex_delete(g_api_mutex, NVM_API_MUTEX);
+  if (p_api_mutex) {
     g_api_mutex = NULL;
+    os_mutex_unlock(p_api_mutex);
+    os_mutex_delete(p_api_mutex, NVM_API_MUTEX);
   }
-  g_nvm_initialized = 0;
 }
 
 /**
@@ -252,11 +311,13 @@ NVM_API int nvm_run_cli(int argc, char *argv[])
     FREE_POOL_SAFE(ErrStr);
     return nvm_status;
   }
+  // Any CLI command may change the PMem modules state
+  dimm_info_cache_invalidate();
   rc = UefiToOsReturnCode(UefiMain(0, NULL));
 
-  //gOsShellParametersProtocol.StdOut will be overriden when
-  //-o xml is used (temp hack)
-  if (gOsShellParametersProtocol.StdOut != stdout) {
+  // Only text printed outside of the printer (help, syntax errors) is still
+  // captured when an XML format is requested
+  if (is_output_captured()) {
     enum DisplayType dt;
     UINT8 d;
     wchar_t disp_name[DISP_NAME_LEN];
@@ -265,6 +326,13 @@ NVM_API int nvm_run_cli(int argc, char *argv[])
     dt = (enum DisplayType)d;
     process_output(dt, disp_name, disp_delims, (int)rc, gOsShellParametersProtocol.StdOut, argc, argv);
   }
+  os_mutex_lock(g_api_mutex);
+  if (0 != g_nvm_context.RefCount) {
+    // An open context keeps the library state, the last nvm_free_context()
+    // releases it
+    os_mutex_unlock(g_api_mutex);
+    return (int)rc;
+  }
   nvm_internal_uninit(FALSE);
   return (int)rc;
 }
@@ -683,7 +751,7 @@ NVM_API int nvm_get_device_discovery(const NVM_UID    device_uid,
     NVDIMM_ERR("Failed to get dimm ID %d\n", rc);
     return NVM_ERR_DIMM_NOT_FOUND;
   }
-  ReturnCode = gNvmDimmDriverNvmDimmConfig.GetDimm(&gNvmDimmDriverNvmDimmConfig, dimm_id, DIMM_INFO_CATEGORY_NONE, &dimm_info);
+  ReturnCode = get_dimm_info_cached(dimm_id, DIMM_INFO_CATEGORY_NONE, &dimm_info);
   if (EFI_ERROR(ReturnCode)) {
     NVDIMM_ERR_W(FORMAT_STR_NL, CLI_ERR_INTERNAL_ERROR);
     return NVM_ERR_DIMM_NOT_FOUND;
@@ -760,7 +828,7 @@ NVM_API int nvm_get_device_status(const NVM_UID   device_uid,
     p_status->is_missing = TRUE;
     return NVM_ERR_DIMM_NOT_FOUND;
   }
-  ReturnCode = gNvmDimmDriverNvmDimmConfig.GetDimm(&gNvmDimmDriverNvmDimmConfig, dimm_id, DIMM_INFO_CATEGORY_ALL, &dimm_info);
+  ReturnCode = get_dimm_info_cached(dimm_id, DIMM_INFO_CATEGORY_ALL, &dimm_info);
   if (EFI_ERROR(ReturnCode)) {
     NVDIMM_ERR_W(FORMAT_STR_NL, CLI_ERR_INTERNAL_ERROR);
     p_status->is_missing = TRUE;
@@ -818,6 +886,7 @@ NVM_API int nvm_set_pmon_registers(const NVM_UID   device_uid,
     NVDIMM_ERR("Failed to intialize nvm library %d\n", nvm_status);
     return nvm_status;
   }
+  dimm_info_cache_invalidate();
   if (NVM_SUCCESS != (rc = get_dimm_id(device_uid, &dimm_id, NULL))) {
     NVDIMM_ERR("Failed to get dimm ID %d\n", rc);
     return NVM_ERR_DIMM_NOT_FOUND;
@@ -895,7 +964,7 @@ NVM_API int nvm_get_device_details(const NVM_UID    device_uid,
     NVDIMM_ERR("Failed to get dimm ID %d\n", rc);
     return NVM_ERR_DIMM_NOT_FOUND;
   }
-  ReturnCode = gNvmDimmDriverNvmDimmConfig.GetDimm(&gNvmDimmDriverNvmDimmConfig, dimm_id, DIMM_INFO_CATEGORY_ALL, &dimm_info);
+  ReturnCode = get_dimm_info_cached(dimm_id, DIMM_INFO_CATEGORY_ALL, &dimm_info);
   if (EFI_ERROR(ReturnCode)) {
     NVDIMM_ERR_W(FORMAT_STR_NL, CLI_ERR_INTERNAL_ERROR);
     return NVM_ERR_DIMM_NOT_FOUND;
@@ -1194,6 +1263,7 @@ NVM_API int nvm_update_device_fw(const NVM_UID device_uid,
     NVDIMM_ERR("Failed to intialize nvm library %d\n", rc);
     return rc;
   }
+  dimm_info_cache_invalidate();
   ReturnCode = InitializeCommandStatus(&p_command_status);
   if (EFI_ERROR(ReturnCode))
     return NVM_ERR_UNKNOWN;
@@ -1274,6 +1344,140 @@ NVM_API int nvm_examine_device_fw(const NVM_UID device_uid,
   return rc;
 }
 
+/*
+ * Convert the driver firmware update record of a DIMM
+ */
+static void fw_update_status_to_device(const NVM_UID device_uid,
+  const FW_UPDATE_STATUS *p_fw_update_status, struct device_fw_update_status *p_status)
+{
+  memset(p_status, 0, sizeof(*p_status));
+  s_strcpy(p_status->uid, device_uid, NVM_MAX_UID_LEN);
+  p_status->state = (enum device_fw_update_state)p_fw_update_status->State;
+  p_status->progress = p_fw_update_status->Progress;
+  p_status->ars_retries = p_fw_update_status->ArsRetries;
+  p_status->result = p_fw_update_status->NvmStatus;
+  p_status->transfer_time_ms = p_fw_update_status->TransferTimeMs;
+  p_status->stage_time_ms = p_fw_update_status->StageTimeMs;
+}
+
+NVM_API int nvm_update_devices_fw(const NVM_UID *p_device_uids, const NVM_UINT32 device_count,
+  const NVM_PATH path, const NVM_SIZE path_len, const NVM_BOOL force,
+  struct device_fw_update_status *p_status)
+{
+  int rc = NVM_SUCCESS;
+  EFI_STATUS ReturnCode;
+  COMMAND_STATUS *p_command_status;
+  CHAR16 file_name[NVM_PATH_LEN];
+  UINT16 dimm_ids[MAX_DIMMS];
+  FW_UPDATE_STATUS fw_update_status;
+  NVM_UINT32 i;
+
+  if (NULL == p_device_uids || NULL == p_status || NULL == path ||
+      0 == device_count || device_count > MAX_DIMMS || path_len > NVM_PATH_LEN)
+    return NVM_ERR_INVALID_PARAMETER;
+
+  if (NVM_SUCCESS != (rc = nvm_init())) {
+    NVDIMM_ERR("Failed to intialize nvm library %d\n", rc);
+    return rc;
+  }
+  dimm_info_cache_invalidate();
+  for (i = 0; i < device_count; i++) {
+    if (NVM_SUCCESS != (rc = get_dimm_id(p_device_uids[i], &dimm_ids[i], NULL))) {
+      NVDIMM_ERR("Failed to get DIMM ID %d\n", rc);
+      return rc;
+    }
+  }
+  ReturnCode = AsciiStrToUnicodeStrS(path, file_name, NVM_PATH_LEN);
+  if (NVM_SUCCESS != ReturnCode) {
+    NVDIMM_ERR("Failed to convert path (%s) to Unicode. Return code %d", path, ReturnCode);
+    return NVM_ERR_UNKNOWN;
+  }
+  ReturnCode = InitializeCommandStatus(&p_command_status);
+  if (EFI_ERROR(ReturnCode))
+    return NVM_ERR_UNKNOWN;
+
+  // One call for all the DIMMs so the image is loaded and verified once
+  ReturnCode = gNvmDimmDriverNvmDimmConfig.UpdateFw(&gNvmDimmDriverNvmDimmConfig, dimm_ids, device_count, file_name,
+                NULL, FALSE, force, FALSE, FALSE, NULL, p_command_status);
+  if (EFI_ERROR(ReturnCode)) {
+    NVDIMM_ERR("Failed to update the FW, file %s. Return code %d", path, ReturnCode);
+    rc = p_command_status->GeneralStatus;
+  }
+
+  for (i = 0; i < device_count; i++) {
+    ZeroMem(&fw_update_status, sizeof(fw_update_status));
+    gNvmDimmDriverNvmDimmConfig.GetFwUpdateStatus(&gNvmDimmDriverNvmDimmConfig, dimm_ids[i], &fw_update_status);
+    fw_update_status_to_device(p_device_uids[i], &fw_update_status, &p_status[i]);
+    // Never got to the DIMM, the whole command failed
+    if (DEVICE_FW_UPDATE_STATE_NONE == p_status[i].state)
+      p_status[i].result = p_command_status->GeneralStatus;
+  }
+  FreeCommandStatus(&p_command_status);
+  return rc;
+}
+
+NVM_API int nvm_get_device_fw_update_status(const NVM_UID device_uid, struct device_fw_update_status *p_status)
+{
+  int rc = NVM_SUCCESS;
+  EFI_STATUS ReturnCode;
+  FW_UPDATE_STATUS fw_update_status;
+  UINT16 dimm_id;
+
+  if (NULL == p_status)
+    return NVM_ERR_INVALID_PARAMETER;
+
+  if (NVM_SUCCESS != (rc = nvm_init())) {
+    NVDIMM_ERR("Failed to intialize nvm library %d\n", rc);
+    return rc;
+  }
+  if (NVM_SUCCESS != (rc = get_dimm_id(device_uid, &dimm_id, NULL))) {
+    NVDIMM_ERR("Failed to get DIMM ID %d\n", rc);
+    return rc;
+  }
+  ReturnCode = gNvmDimmDriverNvmDimmConfig.GetFwUpdateStatus(&gNvmDimmDriverNvmDimmConfig, dimm_id, &fw_update_status);
+  if (EFI_NOT_FOUND == ReturnCode)
+    return NVM_ERR_DIMM_NOT_FOUND;
+  else if (EFI_ERROR(ReturnCode))
+    return NVM_ERR_UNKNOWN;
+
+  fw_update_status_to_device(device_uid, &fw_update_status, p_status);
+  return NVM_SUCCESS;
+}
+
+NVM_API int nvm_get_device_transport(const NVM_UID device_uid, struct device_transport *p_transport)
+{
+  int rc = NVM_SUCCESS;
+  EFI_STATUS ReturnCode;
+  DIMM_TRANSPORT_INFO transport;
+  UINT16 dimm_id;
+
+  if (NULL == p_transport)
+    return NVM_ERR_INVALID_PARAMETER;
+
+  if (NVM_SUCCESS != (rc = nvm_init())) {
+    NVDIMM_ERR("Failed to intialize nvm library %d\n", rc);
+    return rc;
+  }
+  if (NVM_SUCCESS != (rc = get_dimm_id(device_uid, &dimm_id, NULL))) {
+    NVDIMM_ERR("Failed to get DIMM ID %d\n", rc);
+    return rc;
+  }
+  ReturnCode = gNvmDimmDriverNvmDimmConfig.GetDimmTransport(&gNvmDimmDriverNvmDimmConfig, dimm_id, &transport);
+  if (EFI_NOT_FOUND == ReturnCode)
+    return NVM_ERR_DIMM_NOT_FOUND;
+  else if (EFI_ERROR(ReturnCode))
+    return NVM_ERR_UNKNOWN;
+
+  memset(p_transport, 0, sizeof(*p_transport));
+  p_transport->mailbox_ready = transport.MailboxReady;
+  p_transport->large_payload_available = transport.LargePayloadAvailable;
+  p_transport->small_payload_method = (enum device_transport_method)transport.SmallPayloadMethod;
+  p_transport->large_payload_method = (enum device_transport_method)transport.LargePayloadMethod;
+  p_transport->large_input_payload_size = transport.LargeInputPayloadSize;
+  p_transport->large_output_payload_size = transport.LargeOutputPayloadSize;
+  return NVM_SUCCESS;
+}
+
 int driver_features_to_nvm_features(
   const struct driver_feature_flags * p_driver_features,
   struct nvm_features *     p_nvm_features)
@@ -1464,6 +1668,7 @@ NVM_API int nvm_set_passphrase(const NVM_UID device_uid,
     NVDIMM_ERR("Failed to intialize nvm library %d\n", rc);
     return rc;
   }
+  dimm_info_cache_invalidate();
   SystemCapabilitiesInfo.PtrInterleaveFormatsSupported = 0;
 
   ReturnCode = gNvmDimmDriverNvmDimmConfig.GetSystemCapabilitiesInfo(&gNvmDimmDriverNvmDimmConfig,
@@ -1503,6 +1708,7 @@ NVM_API int nvm_remove_passphrase(const NVM_UID device_uid,
     rc = nvm_status;
     goto Finish;
   }
+  dimm_info_cache_invalidate();
 
   ReturnCode = InitializeCommandStatus(&p_command_status);
   if (EFI_ERROR(ReturnCode)) {
@@ -1561,6 +1767,7 @@ NVM_API int nvm_unlock_device(const NVM_UID device_uid,
     NVDIMM_ERR("Failed to intialize nvm library %d\n", rc);
     return rc;
   }
+  dimm_info_cache_invalidate();
   SystemCapabilitiesInfo.PtrInterleaveFormatsSupported = 0;
 
   ReturnCode = gNvmDimmDriverNvmDimmConfig.GetSystemCapabilitiesInfo(&gNvmDimmDriverNvmDimmConfig,
@@ -1590,6 +1797,7 @@ NVM_API int nvm_freezelock_device(const NVM_UID device_uid)
     NVDIMM_ERR("Failed to intialize nvm library %d\n", rc);
     return rc;
   }
+  dimm_info_cache_invalidate();
   SystemCapabilitiesInfo.PtrInterleaveFormatsSupported = 0;
 
   ReturnCode = gNvmDimmDriverNvmDimmConfig.GetSystemCapabilitiesInfo(&gNvmDimmDriverNvmDimmConfig,
@@ -1620,6 +1828,7 @@ NVM_API int nvm_erase_device(const NVM_UID device_uid,
     NVDIMM_ERR("Failed to intialize nvm library %d\n", rc);
     return rc;
   }
+  dimm_info_cache_invalidate();
   SystemCapabilitiesInfo.PtrInterleaveFormatsSupported = 0;
 
   ReturnCode = gNvmDimmDriverNvmDimmConfig.GetSystemCapabilitiesInfo(&gNvmDimmDriverNvmDimmConfig,
@@ -1665,6 +1874,7 @@ NVM_API int nvm_set_master_passphrase(const NVM_UID device_uid,
     NVDIMM_ERR("Failed to intialize nvm library %d\n", rc);
     return rc;
   }
+  dimm_info_cache_invalidate();
   SystemCapabilitiesInfo.PtrInterleaveFormatsSupported = 0;
 
   ReturnCode = InitializeCommandStatus(&p_command_status);
@@ -1797,7 +2007,7 @@ NVM_API int nvm_get_sensors(const NVM_UID device_uid, struct sensor *p_sensors,
     goto Finish;
   }
 
-  ReturnCode = GetSensorsInfo(&gNvmDimmDriverNvmDimmConfig, dimm_id, DimmSensorsSet);
+  ReturnCode = get_sensors_info_cached(dimm_id, DimmSensorsSet);
   if (EFI_ERROR(ReturnCode)) {
     NVDIMM_ERR_W(L"Failed to GetSensorsInfo\n");
     rc = NVM_ERR_UNKNOWN;
@@ -1839,7 +2049,7 @@ NVM_API int nvm_get_sensor(const NVM_UID device_uid, const enum sensor_type type
     goto Finish;
   }
 
-  EFIReturnCode = GetSensorsInfo(&gNvmDimmDriverNvmDimmConfig, dimm_id, DimmSensorsSet);
+  EFIReturnCode = get_sensors_info_cached(dimm_id, DimmSensorsSet);
   if (EFI_ERROR(EFIReturnCode)) {
     NVDIMM_ERR_W(L"Failed to GetSensorsInfo\n");
     rc = NVM_ERR_OPERATION_FAILED;
@@ -1873,6 +2083,7 @@ NVM_API int nvm_set_sensor_settings(const NVM_UID device_uid,
     NVDIMM_ERR("Failed to intialize nvm library %d\n", rc);
     goto Finish;
   }
+  dimm_info_cache_invalidate();
 
   if (NVM_SUCCESS != (rc = get_dimm_id(device_uid, &dimm_id, NULL))) {
     NVDIMM_ERR("Failed to get dimm ID %d\n", rc);
@@ -2037,6 +2248,7 @@ NVM_API int nvm_create_config_goal(NVM_UID *p_device_uids, NVM_UINT32 device_uid
     NVDIMM_ERR("Failed to intialize nvm library %d\n", rc);
     goto Finish;
   }
+  dimm_info_cache_invalidate();
 
   // If user passed DIMM uids, convert to id
   if (p_device_uids != NULL && device_uids_count > 0) {
@@ -2184,6 +2396,7 @@ NVM_API int nvm_delete_config_goal(NVM_UID *p_device_uids, NVM_UINT32 device_uid
     NVDIMM_ERR("Failed to intialize nvm library %d\n", rc);
     goto Finish;
   }
+  dimm_info_cache_invalidate();
 
   // If user passed DIMM uids, convert to id
   if (p_device_uids != NULL && device_uids_count > 0) {
@@ -2269,6 +2482,7 @@ NVM_API int nvm_load_goal_config(const NVM_PATH file,
     NVDIMM_ERR("Failed to intialize nvm library %d\n", rc);
     return rc;
   }
+  dimm_info_cache_invalidate();
   ReturnCode = InitializeCommandStatus(&p_command_status);
   if (EFI_ERROR(ReturnCode)) {
     rc = NVM_ERR_UNKNOWN;
@@ -2420,6 +2634,8 @@ EFI_STATUS execute_cli_cmd(wchar_t * cmdline)
     ReturnCode = ExecuteCmd(&Command);
   }
   FreeCommandInput(&Input);
+  // Registered again by the next command run in this process
+  FreeCommands();
   return ReturnCode;
 }
 
@@ -2486,6 +2702,7 @@ NVM_API int nvm_inject_device_error(const NVM_UID  device_uid,
     NVDIMM_ERR("Failed to intialize nvm library %d\n", rc);
     goto Finish;
   }
+  dimm_info_cache_invalidate();
   if (NVM_SUCCESS != (rc = get_dimm_id(device_uid, &DimmId, NULL))) {
     NVDIMM_ERR("Failed to get dimm ID %d\n", rc);
     goto Finish;
@@ -2525,6 +2742,7 @@ NVM_API int nvm_clear_injected_device_error(const NVM_UID device_uid,
     NVDIMM_ERR("Failed to intialize nvm library %d\n", rc);
     goto Finish;
   }
+  dimm_info_cache_invalidate();
   if (NVM_SUCCESS != (rc = get_dimm_id(device_uid, &DimmId, NULL))) {
     NVDIMM_ERR("Failed to get dimm ID %d\n", rc);
     goto Finish;
@@ -2626,6 +2844,7 @@ NVM_API int nvm_set_user_preference(const NVM_PREFERENCE_KEY  key,
     NVDIMM_ERR("Failed to intialize nvm library %d\n", nvm_status);
     return nvm_status;
   }
+  dimm_info_cache_invalidate();
 
   ReturnCode = AsciiStrToUnicodeStrS(key, KeyWide, NVM_THRESHOLD_STR_LEN);
   if (EFI_ERROR(ReturnCode)) {
@@ -2684,15 +2903,177 @@ NVM_API int nvm_toggle_debug_logging(const NVM_BOOL enabled)
   return DebugLoggerEnable(enabled);
 }
 
+NVM_API int nvm_fw_cmd_stats_enabled()
+{
+  int rc = NVM_SUCCESS;
+
+  if (NVM_SUCCESS != (rc = nvm_init())) {
+    NVDIMM_ERR("Failed to intialize nvm library %d\n", rc);
+    return rc;
+  }
+  return FwCmdStatsEnabled();
+}
+
+NVM_API int nvm_toggle_fw_cmd_stats(const NVM_BOOL enabled)
+{
+  int rc = NVM_SUCCESS;
+
+  if (NVM_SUCCESS != (rc = nvm_init())) {
+    NVDIMM_ERR("Failed to intialize nvm library %d\n", rc);
+    return rc;
+  }
+  if (EFI_ERROR(FwCmdStatsEnable(enabled ? TRUE : FALSE)))
+    return NVM_ERR_NO_MEM;
+  return NVM_SUCCESS;
+}
+
+NVM_API int nvm_reset_fw_cmd_stats()
+{
+  int rc = NVM_SUCCESS;
+
+  if (NVM_SUCCESS != (rc = nvm_init())) {
+    NVDIMM_ERR("Failed to intialize nvm library %d\n", rc);
+    return rc;
+  }
+  FwCmdStatsReset();
+  return NVM_SUCCESS;
+}
+
+/*
+ * Fetches the statistics of a device, *p_count is updated to the number available
+ */
+static int get_fw_cmd_stats(const NVM_UID device_uid, FW_CMD_STATS *p_stats, UINT32 *p_count)
+{
+  int rc = NVM_SUCCESS;
+  EFI_STATUS ReturnCode;
+  UINT16 dimm_id;
+
+  if (NVM_SUCCESS != (rc = nvm_init())) {
+    NVDIMM_ERR("Failed to intialize nvm library %d\n", rc);
+    return rc;
+  }
+  if (NVM_SUCCESS != (rc = get_dimm_id(device_uid, &dimm_id, NULL))) {
+    NVDIMM_ERR("Failed to get DIMM ID %d\n", rc);
+    return rc;
+  }
+  ReturnCode = gNvmDimmDriverNvmDimmConfig.GetFwCmdStats(&gNvmDimmDriverNvmDimmConfig, dimm_id, p_stats, p_count);
+  if (EFI_NOT_FOUND == ReturnCode)
+    return NVM_ERR_DIMM_NOT_FOUND;
+  else if (EFI_BUFFER_TOO_SMALL == ReturnCode)
+    return NVM_ERR_BAD_SIZE;
+  else if (EFI_ERROR(ReturnCode))
+    return NVM_ERR_UNKNOWN;
+  return NVM_SUCCESS;
+}
+
+NVM_API int nvm_get_number_of_fw_cmd_stats(const NVM_UID device_uid, NVM_UINT32 *count)
+{
+  UINT32 stats_count = 0;
+  int rc;
+
+  if (NULL == count)
+    return NVM_ERR_INVALID_PARAMETER;
+
+  rc = get_fw_cmd_stats(device_uid, NULL, &stats_count);
+  *count = (NVM_SUCCESS == rc || NVM_ERR_BAD_SIZE == rc) ? stats_count : 0;
+  return (NVM_ERR_BAD_SIZE == rc) ? NVM_SUCCESS : rc;
+}
+
+NVM_API int nvm_get_fw_cmd_stats(const NVM_UID device_uid, struct device_fw_cmd_stats *p_stats,
+  const NVM_UINT32 count)
+{
+  FW_CMD_STATS *p_fw_stats = NULL;
+  UINT32 stats_count = count;
+  UINT32 i;
+  int rc;
+
+  if (NULL == p_stats || 0 == count)
+    return NVM_ERR_INVALID_PARAMETER;
+
+  p_fw_stats = AllocateZeroPool(sizeof(*p_fw_stats) * count);
+  if (NULL == p_fw_stats)
+    return NVM_ERR_NO_MEM;
+
+  memset(p_stats, 0, sizeof(*p_stats) * count);
+  rc = get_fw_cmd_stats(device_uid, p_fw_stats, &stats_count);
+  if (NVM_SUCCESS == rc) {
+    for (i = 0; i < stats_count; i++) {
+      p_stats[i].opcode = p_fw_stats[i].Opcode;
+      p_stats[i].sub_opcode = p_fw_stats[i].SubOpcode;
+      p_stats[i].calls = p_fw_stats[i].Calls;
+      p_stats[i].retries = p_fw_stats[i].Retries;
+      p_stats[i].errors = p_fw_stats[i].Errors;
+      p_stats[i].bytes_in = p_fw_stats[i].BytesIn;
+      p_stats[i].bytes_out = p_fw_stats[i].BytesOut;
+      p_stats[i].total_us = p_fw_stats[i].TotalUs;
+      p_stats[i].min_us = p_fw_stats[i].MinUs;
+      p_stats[i].max_us = p_fw_stats[i].MaxUs;
+      memcpy(p_stats[i].fis_status, p_fw_stats[i].FisStatus, sizeof(p_stats[i].fis_status));
+      memcpy(p_stats[i].latency_us, p_fw_stats[i].LatencyUs, sizeof(p_stats[i].latency_us));
+    }
+  }
+  FreePool(p_fw_stats);
+  return rc;
+}
+
+/*
+ * Long operation status of a DIMM as reported by GetLongOpStatus
+ */
+typedef struct _LONG_OP_QUERY {
+  EFI_STATUS ReturnCode;        ///< Result of the query itself
+  EFI_STATUS LongOpStatus;      ///< Mailbox status of the long operation
+  UINT8 Opcode;
+  UINT8 SubOpcode;
+  UINT16 Percent;               ///< BCD encoded
+} LONG_OP_QUERY;
+
+static void query_long_op(UINT16 dimm_id, LONG_OP_QUERY *p_query)
+{
+  ZeroMem(p_query, sizeof(*p_query));
+  p_query->ReturnCode = gNvmDimmDriverNvmDimmConfig.GetLongOpStatus(&gNvmDimmDriverNvmDimmConfig, dimm_id,
+    &p_query->Opcode, &p_query->SubOpcode, &p_query->Percent, NULL, &p_query->LongOpStatus);
+}
+
+static enum nvm_job_type long_op_job_type(UINT8 opcode, UINT8 subopcode)
+{
+  if ((opcode == PtSetSecInfo) && (subopcode == SubopOverwriteDimm)) {
+    return NVM_JOB_TYPE_SANITIZE;
+  }
+  if ((opcode == PtSetFeatures) && (subopcode == SubopAddressRangeScrub)) {
+    return NVM_JOB_TYPE_ARS;
+  }
+  if ((opcode == PtUpdateFw) && (subopcode == SubopUpdateFw)) {
+    return NVM_JOB_TYPE_FW_UPDATE;
+  }
+  return NVM_JOB_TYPE_UNKNOWN;
+}
+
+static void long_op_query_to_job(const LONG_OP_QUERY *p_query, struct job *p_job)
+{
+  if (EFI_ERROR(p_query->ReturnCode)) {
+    p_job->status = NVM_JOB_STATUS_UNKNOWN;
+    return;
+  }
+  if (p_query->LongOpStatus == EFI_NO_RESPONSE) {
+    p_job->status = NVM_JOB_STATUS_RUNNING;
+  }
+  else if (p_query->LongOpStatus == EFI_NOT_STARTED) {
+    p_job->status = NVM_JOB_STATUS_NOT_STARTED;
+  }
+  else {
+    p_job->status = NVM_JOB_STATUS_COMPLETE;
+  }
+  p_job->type = long_op_job_type(p_query->Opcode, p_query->SubOpcode);
+  p_job->percent_complete = BCD_TO_BYTE(p_query->Percent);
+}
+
 NVM_API int nvm_get_jobs(struct job *p_jobs, const NVM_UINT32 count)
 {
   EFI_STATUS ReturnCode = EFI_SUCCESS;
   int rc = NVM_SUCCESS;
-  NVM_FW_CMD *cmd;
   DIMM_INFO *pDimms = NULL;
   UINT32 DimmCount = 0;
-  PT_OUTPUT_PAYLOAD_FW_LONG_OP_STATUS *pLongOpStatus;
-  int job_index = 0;
+  LONG_OP_QUERY query;
   unsigned int i, j;
   int nvm_status = 0;
   struct Command CmdStub;
@@ -2717,19 +3098,11 @@ NVM_API int nvm_get_jobs(struct job *p_jobs, const NVM_UINT32 count)
     return NVM_ERR_BAD_SIZE;
   }
 
-  if (NULL == (cmd = (NVM_FW_CMD *)AllocatePool(sizeof(NVM_FW_CMD)))) {
-    NVDIMM_ERR("Failed to allocate memory\n");
-    return NVM_ERR_NOT_ENOUGH_FREE_SPACE;
-  }
-
-  ZeroMem(cmd, sizeof(NVM_FW_CMD));
-  pLongOpStatus = (PT_OUTPUT_PAYLOAD_FW_LONG_OP_STATUS *)cmd->OutPayload;
   // Populate the list of DIMM_INFO structures with relevant information
   CmdStub.pPrintCtx = NULL;
   ReturnCode = GetDimmList(&gNvmDimmDriverNvmDimmConfig, &CmdStub, DIMM_INFO_CATEGORY_NONE, &pDimms, &DimmCount);
   if (EFI_ERROR(ReturnCode)) {
     NVDIMM_ERR("Failed to get dimm list %d\n", (int)ReturnCode);
-    FreePool(cmd);
     return NVM_ERR_OPERATION_FAILED;
   }
 
@@ -2737,39 +3110,8 @@ NVM_API int nvm_get_jobs(struct job *p_jobs, const NVM_UINT32 count)
     if (i >= count)
       break;
 
-    cmd->DimmID = pDimms[i].DimmID; //PassThruCommand needs the dimm_id (not handle)
-    cmd->Opcode = PtGetLog;
-    cmd->SubOpcode = SubopLongOperationStat;
-    cmd->OutputPayloadSize = sizeof(PT_OUTPUT_PAYLOAD_FW_LONG_OP_STATUS);
-
-    if (EFI_SUCCESS == PassThruCommand(cmd, PT_TIMEOUT_INTERVAL)) {
-      if (pLongOpStatus->Status == MailboxDeviceBusy) {
-        p_jobs[i].status = NVM_JOB_STATUS_RUNNING;
-      }
-      else if (pLongOpStatus->Status == MailboxDataNotSet) {
-        p_jobs[i].status = NVM_JOB_STATUS_NOT_STARTED;
-      }
-      else {
-        p_jobs[i].status = NVM_JOB_STATUS_COMPLETE;
-      }
-
-      if ((pLongOpStatus->CmdOpcode == PtSetSecInfo) && (pLongOpStatus->CmdSubcode == SubopOverwriteDimm)) {
-        p_jobs[i].type = NVM_JOB_TYPE_SANITIZE;
-      }
-      else if ((pLongOpStatus->CmdOpcode == PtSetFeatures) && (pLongOpStatus->CmdSubcode == SubopAddressRangeScrub)) {
-        p_jobs[i].type = NVM_JOB_TYPE_ARS;
-      }
-      else if ((pLongOpStatus->CmdOpcode == PtUpdateFw) && (pLongOpStatus->CmdSubcode == SubopUpdateFw)) {
-        p_jobs[i].type = NVM_JOB_TYPE_FW_UPDATE;
-      }
-      else {
-        p_jobs[i].type = NVM_JOB_TYPE_UNKNOWN;
-      }
-      p_jobs[i].percent_complete = BCD_TO_BYTE(pLongOpStatus->Percent);
-    }
-    else {
-      p_jobs[i].status = NVM_JOB_STATUS_UNKNOWN;
-    }
+    query_long_op(pDimms[i].DimmID, &query);
+    long_op_query_to_job(&query, &p_jobs[i]);
 
     for (j = 0; j < MAX_DIMM_UID_LENGTH; j++)
     {
@@ -2782,19 +3124,61 @@ NVM_API int nvm_get_jobs(struct job *p_jobs, const NVM_UINT32 count)
     }
 
     p_jobs[i].result = NULL;
-    job_index++;
   }
-  FreePool(cmd);
   return NVM_SUCCESS;
 }
 
 NVM_API int nvm_create_context()
 {
+  int rc = NVM_SUCCESS;
+  BOOLEAN was_initialized = g_nvm_initialized ? TRUE : FALSE;
+
+  if (NVM_SUCCESS != (rc = nvm_init())) {
+    NVDIMM_ERR("Failed to intialize nvm library %d\n", rc);
+    return rc;
+  }
+
+  os_mutex_lock(g_api_mutex);
+  if (0 == g_nvm_context.RefCount) {
+    // Start from fresh PCD data, it is kept from now on
+    ClearPcdCacheOnDimmList();
+    g_nvm_context.OwnsInit = !was_initialized;
+    g_nvm_context.UninitPending = FALSE;
+  }
+  g_nvm_context.RefCount++;
+  os_mutex_unlock(g_api_mutex);
   return NVM_SUCCESS;
 }
 
 NVM_API int nvm_free_context(const NVM_BOOL force)
 {
+  BOOLEAN uninit = FALSE;
+
+  os_mutex_lock(g_api_mutex);
+  if (0 == g_nvm_context.RefCount) {
+    os_mutex_unlock(g_api_mutex);
+    return NVM_SUCCESS;
+  }
+  g_nvm_context.RefCount--;
+  if (!force && 0 != g_nvm_context.RefCount) {
+    os_mutex_unlock(g_api_mutex);
+    return NVM_SUCCESS;
+  }
+
+  uninit = g_nvm_context.OwnsInit || g_nvm_context.UninitPending;
+  ZeroMem(&g_nvm_context, sizeof(g_nvm_context));
+
+  ClearPcdCacheOnDimmList();
+  dimm_info_cache_invalidate();
+  free_dimm_uid_table();
+  g_dimm_cnt = 0;
+  passthru_os_release();
+
+  if (uninit && g_nvm_initialized) {
+    nvm_internal_uninit(TRUE);
+    return NVM_SUCCESS;
+  }
+  os_mutex_unlock(g_api_mutex);
   return NVM_SUCCESS;
 }
 
@@ -2951,44 +3335,127 @@ NVM_API int nvm_get_dimm_id(const NVM_UID device_uid,
   return rc;
 }
 
-int get_dimm_id(const char *uid, UINT16 *dimm_id, unsigned int *dimm_handle)
+/*
+ * FNV-1a hash of a UID. The wide variant hashes the same value for the
+ * UniCode form of an ASCII UID.
+ */
+static UINT32 dimm_uid_hash(const char *uid)
 {
-  EFI_STATUS rc;
-  CHAR16 uid_wide[MAX_DIMM_UID_LENGTH];
-  unsigned int i;
+  UINT32 hash = 2166136261U;
 
-  if (NULL == g_dimms) {
-    if (NVM_SUCCESS != nvm_get_number_of_devices(&g_dimm_cnt)) {
-      NVDIMM_ERR("Failed to get number of devices\n");
-      return NVM_ERR_UNKNOWN;
-    }
+  for (; *uid != '\0'; uid++) {
+    hash = (hash ^ (UINT8)*uid) * 16777619U;
+  }
+  return hash;
+}
 
-    g_dimms = (DIMM_INFO *)AllocatePool(sizeof(DIMM_INFO) * g_dimm_cnt);
-    if (NULL == g_dimms) {
-      NVDIMM_ERR("Failed to allocate memory\n");
-      return NVM_ERR_UNKNOWN;
-    }
+static UINT32 dimm_uid_hash_wide(const CHAR16 *uid_wide)
+{
+  UINT32 hash = 2166136261U;
 
-    rc = gNvmDimmDriverNvmDimmConfig.GetDimms(&gNvmDimmDriverNvmDimmConfig, (UINT32)g_dimm_cnt, DIMM_INFO_CATEGORY_NONE, g_dimms);
-    if (EFI_ERROR(rc)) {
-      FreePool(g_dimms);
-      g_dimms = NULL;
-      NVDIMM_ERR("GetDimms failed (%d)\n", rc);
-      return NVM_ERR_UNKNOWN;
-    }
+  for (; *uid_wide != L'\0'; uid_wide++) {
+    hash = (hash ^ (UINT8)*uid_wide) * 16777619U;
   }
+  return hash;
+}
 
-  rc = AsciiStrToUnicodeStrS(uid, uid_wide, MAX_DIMM_UID_LENGTH);
-  if (EFI_ERROR(rc)) {
-    NVDIMM_ERR("Failed while converting uid (%s) to UniCode. (%d)\n", uid, rc);
-    return NVM_ERR_UNKNOWN;
+/*
+ * Same as StrCmp() of the ASCII uid converted to UniCode against uid_wide
+ */
+static BOOLEAN dimm_uid_equal(const char *uid, const CHAR16 *uid_wide)
+{
+  for (; *uid != '\0'; uid++, uid_wide++) {
+    if ((CHAR16)(UINT8)*uid != *uid_wide) {
+      return FALSE;
+    }
   }
-  for (i = 0; i < g_dimm_cnt; ++i) {
-    if (0 == StrCmp(uid_wide, g_dimms[i].DimmUid)) {
-      if (dimm_id)
-        *dimm_id = g_dimms[i].DimmID;
-      if (dimm_handle)
-        *dimm_handle = g_dimms[i].DimmHandle;
+  return *uid_wide == L'\0';
+}
+
+static void free_dimm_uid_table(void)
+{
+  FREE_POOL_SAFE(g_dimms);
+  FREE_POOL_SAFE(g_dimm_uid_slots);
+  g_dimm_uid_bits = 0;
+}
+
+/*
+ * Fill g_dimms and the UID lookup table over it. On duplicate UIDs the first
+ * PMem module wins, as with the linear search this replaces.
+ */
+static int load_dimm_uid_table(void)
+{
+  EFI_STATUS rc;
+  UINT32 bits = 1;
+  UINT32 mask;
+  UINT32 slot;
+  unsigned int i;
+
+  if (NVM_SUCCESS != nvm_get_number_of_devices(&g_dimm_cnt)) {
+    NVDIMM_ERR("Failed to get number of devices\n");
+    return NVM_ERR_UNKNOWN;
+  }
+
+  while ((1U << bits) < g_dimm_cnt * 2) {
+    bits++;
+  }
+  mask = (1U << bits) - 1;
+
+  g_dimms = (DIMM_INFO *)AllocatePool(sizeof(DIMM_INFO) * g_dimm_cnt);
+  g_dimm_uid_slots = (UINT32 *)AllocateZeroPool(sizeof(*g_dimm_uid_slots) << bits);
+  if (NULL == g_dimms || NULL == g_dimm_uid_slots) {
+    free_dimm_uid_table();
+    NVDIMM_ERR("Failed to allocate memory\n");
+    return NVM_ERR_UNKNOWN;
+  }
+
+  rc = gNvmDimmDriverNvmDimmConfig.GetDimms(&gNvmDimmDriverNvmDimmConfig, (UINT32)g_dimm_cnt, DIMM_INFO_CATEGORY_NONE, g_dimms);
+  if (EFI_ERROR(rc)) {
+    free_dimm_uid_table();
+    NVDIMM_ERR("GetDimms failed (%d)\n", rc);
+    return NVM_ERR_UNKNOWN;
+  }
+
+  g_dimm_uid_bits = bits;
+  for (i = 0; i < g_dimm_cnt; ++i) {
+    for (slot = dimm_uid_hash_wide(g_dimms[i].DimmUid) & mask; 0 != g_dimm_uid_slots[slot]; slot = (slot + 1) & mask) {
+      if (0 == StrCmp(g_dimms[i].DimmUid, g_dimms[g_dimm_uid_slots[slot] - 1].DimmUid)) {
+        break;
+      }
+    }
+    if (0 == g_dimm_uid_slots[slot]) {
+      g_dimm_uid_slots[slot] = i + 1;
+    }
+  }
+  return NVM_SUCCESS;
+}
+
+int get_dimm_id(const char *uid, UINT16 *dimm_id, unsigned int *dimm_handle)
+{
+  int rc;
+  UINT32 mask;
+  UINT32 slot;
+  DIMM_INFO *p_dimm;
+
+  if (NULL == g_dimms) {
+    if (NVM_SUCCESS != (rc = load_dimm_uid_table())) {
+      return rc;
+    }
+  }
+
+  if (NULL == uid || AsciiStrnLenS(uid, MAX_DIMM_UID_LENGTH) >= MAX_DIMM_UID_LENGTH) {
+    NVDIMM_ERR("Invalid uid\n");
+    return NVM_ERR_UNKNOWN;
+  }
+
+  mask = (1U << g_dimm_uid_bits) - 1;
+  for (slot = dimm_uid_hash(uid) & mask; 0 != g_dimm_uid_slots[slot]; slot = (slot + 1) & mask) {
+    p_dimm = &g_dimms[g_dimm_uid_slots[slot] - 1];
+    if (dimm_uid_equal(uid, p_dimm->DimmUid)) {
+      if (dimm_id)
+        *dimm_id = p_dimm->DimmID;
+      if (dimm_handle)
+        *dimm_handle = p_dimm->DimmHandle;
       return NVM_SUCCESS;
     }
   }
@@ -3100,10 +3567,19 @@ NVM_API int nvm_send_device_passthrough_cmd(const NVM_UID   device_uid,
 
   }
 
+  if ((p_cmd->large_input_payload_size > 0 && NULL == p_cmd->large_input_payload) ||
+    (p_cmd->large_output_payload_size > 0 && NULL == p_cmd->large_output_payload))
+  {
+    NVDIMM_ERR("Invalid large payload buffer(s)\n");
+    rc = NVM_ERR_INVALID_PARAMETER;
+    goto finish;
+  }
+
   if (NVM_SUCCESS != (rc = nvm_init())) {
     NVDIMM_ERR("Failed to intialize nvm library %d\n", rc);
     return rc;
   }
+  dimm_info_cache_invalidate();
 
   if (NULL == (cmd = (NVM_FW_CMD *)AllocatePool(sizeof(NVM_FW_CMD)))) {
     NVDIMM_ERR("Failed to allocate memory\n");
@@ -3125,7 +3601,9 @@ NVM_API int nvm_send_device_passthrough_cmd(const NVM_UID   device_uid,
   cmd->OutputPayloadSize = p_cmd->output_payload_size;
   cmd->LargeInputPayloadSize = p_cmd->large_input_payload_size;
   cmd->LargeOutputPayloadSize = p_cmd->large_output_payload_size;
-  CopyMem_S(cmd->LargeInputPayload, sizeof(cmd->LargeInputPayload), p_cmd->large_input_payload, cmd->LargeInputPayloadSize);
+  // Large payloads are used in place, no staging copy
+  cmd->LargeInputPayload = (UINT8 *)p_cmd->large_input_payload;
+  cmd->LargeOutputPayload = (UINT8 *)p_cmd->large_output_payload;
 
   if (EFI_SUCCESS != PassThruCommand(cmd, PT_TIMEOUT_INTERVAL))
   {
@@ -3147,7 +3625,6 @@ NVM_API int nvm_send_device_passthrough_cmd(const NVM_UID   device_uid,
       rc = NVM_ERR_INVALID_PARAMETER;
       goto finish;
     }
-    CopyMem_S(p_cmd->large_output_payload, p_cmd->large_output_payload_size, cmd->LargeOutputPayload, cmd->LargeOutputPayloadSize);
     p_cmd->large_output_payload_size = cmd->LargeOutputPayloadSize;
   }
   else if (cmd->OutputPayloadSize)
@@ -3166,3 +3643,823 @@ finish:
   FREE_POOL_SAFE(cmd);
   return rc;
 }
+
+/*
+ * DIMM_INFO and sensor results cache
+ *
+ * Results are kept per DIMM and per set of requested DIMM_INFO categories.
+ * An entry lives for the shortest TTL among its categories, so a category
+ * with a TTL of 0 is never cached. Sensors share the SMART and health TTL.
+ * The cache is off unless DIMM_INFO_CACHE_TTL_MS is set.
+ *
+ * The cache lock is never held across a firmware query. A result fetched
+ * while the cache was invalidated is returned but not kept, the generation
+ * tells when that happened.
+ */
+#define DIMM_INFO_CACHE_TTL_MS_DEFAULT    0
+#define DIMM_INFO_CACHE_SIZE              (MAX_DIMMS * 4)
+#define DIMM_INFO_CACHE_CATEGORIES_NUM    16
+#define DIMM_INFO_CACHE_SENSORS_KEY       (1 << DIMM_INFO_CACHE_CATEGORIES_NUM)
+
+typedef struct _DIMM_INFO_CACHE_ENTRY {
+  BOOLEAN Valid;
+  UINT16 DimmId;
+  UINT32 Key;                       ///< Requested categories or DIMM_INFO_CACHE_SENSORS_KEY
+  unsigned long long ExpiresMs;
+  union {
+    DIMM_INFO DimmInfo;
+    DIMM_SENSOR Sensors[SENSOR_TYPE_COUNT];
+  } Data;
+} DIMM_INFO_CACHE_ENTRY;
+
+typedef struct _DIMM_INFO_CACHE {
+  OS_MUTEX *pLock;
+  UINT64 Generation;                ///< Bumped by every invalidation
+  BOOLEAN TtlsLoaded;
+  UINT32 TtlMs[DIMM_INFO_CACHE_CATEGORIES_NUM];
+  DIMM_INFO_CACHE_ENTRY *pEntries;
+  unsigned long long Hits;
+  unsigned long long Misses;
+  unsigned long long Invalidations;
+} DIMM_INFO_CACHE;
+
+static DIMM_INFO_CACHE g_dimm_info_cache;
+
+/*
+ * Per category TTL overrides, the categories not listed here and the ones
+ * not set in the ini file use DIMM_INFO_CACHE_TTL_MS
+ */
+static const struct {
+  DIMM_INFO_CATEGORIES Category;
+  const char *pTtlName;
+} g_dimm_info_cache_ttl_names[] = {
+  { DIMM_INFO_CATEGORY_SECURITY, "DIMM_INFO_CACHE_TTL_MS_SECURITY" },
+  { DIMM_INFO_CATEGORY_PACKAGE_SPARING, "DIMM_INFO_CACHE_TTL_MS_PACKAGE_SPARING" },
+  { DIMM_INFO_CATEGORY_ARS_STATUS, "DIMM_INFO_CACHE_TTL_MS_ARS_STATUS" },
+  { DIMM_INFO_CATEGORY_SMART_AND_HEALTH, "DIMM_INFO_CACHE_TTL_MS_SMART_AND_HEALTH" },
+  { DIMM_INFO_CATEGORY_POWER_MGMT_POLICY, "DIMM_INFO_CACHE_TTL_MS_POWER_MGMT_POLICY" },
+  { DIMM_INFO_CATEGORY_OPTIONAL_CONFIG_DATA_POLICY, "DIMM_INFO_CACHE_TTL_MS_OPTIONAL_CONFIG_DATA_POLICY" },
+  { DIMM_INFO_CATEGORY_OVERWRITE_DIMM_STATUS, "DIMM_INFO_CACHE_TTL_MS_OVERWRITE_DIMM_STATUS" },
+  { DIMM_INFO_CATEGORY_FW_IMAGE_INFO, "DIMM_INFO_CACHE_TTL_MS_FW_IMAGE_INFO" },
+  { DIMM_INFO_CATEGORY_MEM_INFO_PAGE_3, "DIMM_INFO_CACHE_TTL_MS_MEM_INFO_PAGE_3" },
+  { DIMM_INFO_CATEGORY_VIRAL_POLICY, "DIMM_INFO_CACHE_TTL_MS_VIRAL_POLICY" },
+  { DIMM_INFO_CATEGORY_DEVICE_CHARACTERISTICS, "DIMM_INFO_CACHE_TTL_MS_DEVICE_CHARACTERISTICS" },
+  { DIMM_INFO_CATEGORY_MEM_INFO_PAGE_4, "DIMM_INFO_CACHE_TTL_MS_MEM_INFO_PAGE_4" },
+  { DIMM_INFO_CATEGORY_EXTENDED_ADR, "DIMM_INFO_CACHE_TTL_MS_EXTENDED_ADR" },
+  { DIMM_INFO_CATEGORY_LATCH_SYSTEM_SHUTDOWN_STATE, "DIMM_INFO_CACHE_TTL_MS_LATCH_SYSTEM_SHUTDOWN_STATE" },
+};
+
+static void dimm_info_cache_load_ttls()
+{
+  EFI_GUID g = { 0x0, 0x0, 0x0, { 0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0 } };
+  UINT32 default_ttl = DIMM_INFO_CACHE_TTL_MS_DEFAULT;
+  UINT32 ttl = 0;
+  UINTN size = 0;
+  UINT32 i = 0;
+  UINT32 bit = 0;
+
+  size = sizeof(default_ttl);
+  preferences_get_var_ascii("DIMM_INFO_CACHE_TTL_MS", g, &default_ttl, &size);
+  for (bit = 0; bit < DIMM_INFO_CACHE_CATEGORIES_NUM; bit++) {
+    g_dimm_info_cache.TtlMs[bit] = default_ttl;
+  }
+
+  for (i = 0; i < sizeof(g_dimm_info_cache_ttl_names) / sizeof(g_dimm_info_cache_ttl_names[0]); i++) {
+    size = sizeof(ttl);
+    if (EFI_SUCCESS != preferences_get_var_ascii(g_dimm_info_cache_ttl_names[i].pTtlName, g, &ttl, &size)) {
+      continue;
+    }
+    for (bit = 0; bit < DIMM_INFO_CACHE_CATEGORIES_NUM; bit++) {
+      if (g_dimm_info_cache_ttl_names[i].Category == (1 << bit)) {
+        g_dimm_info_cache.TtlMs[bit] = ttl;
+      }
+    }
+  }
+  g_dimm_info_cache.TtlsLoaded = TRUE;
+}
+
+/*
+ * TTL of a cache entry holding the given categories, the shortest one wins.
+ * DIMM_INFO_CATEGORY_NONE results only hold identity data and use the default.
+ * Called with the cache lock held.
+ */
+static UINT32 dimm_info_cache_ttl(UINT32 key)
+{
+  UINT32 ttl = MAX_UINT32;
+  UINT32 bit = 0;
+
+  if (!g_dimm_info_cache.TtlsLoaded) {
+    dimm_info_cache_load_ttls();
+  }
+
+  if (DIMM_INFO_CACHE_SENSORS_KEY == key) {
+    key = DIMM_INFO_CATEGORY_SMART_AND_HEALTH;
+  }
+  if (DIMM_INFO_CATEGORY_NONE == key) {
+    key = DIMM_INFO_CATEGORY_RESERVED;
+  }
+  for (bit = 0; bit < DIMM_INFO_CACHE_CATEGORIES_NUM; bit++) {
+    if ((key & (1 << bit)) && g_dimm_info_cache.TtlMs[bit] < ttl) {
+      ttl = g_dimm_info_cache.TtlMs[bit];
+    }
+  }
+  return ttl;
+}
+
+/*
+ * Find the live entry for the key, or NULL. When not found and p_slot is
+ * given it returns the slot to fill: a free or expired one, otherwise the
+ * one closest to expiring. Called with the cache lock held.
+ */
+static DIMM_INFO_CACHE_ENTRY *dimm_info_cache_find(UINT16 dimm_id, UINT32 key, DIMM_INFO_CACHE_ENTRY **p_slot)
+{
+  unsigned long long now = os_get_monotonic_ms();
+  DIMM_INFO_CACHE_ENTRY *p_entry = NULL;
+  DIMM_INFO_CACHE_ENTRY *p_victim = NULL;
+  UINT32 i = 0;
+
+  if (NULL == g_dimm_info_cache.pEntries) {
+    g_dimm_info_cache.pEntries = AllocateZeroPool(sizeof(DIMM_INFO_CACHE_ENTRY) * DIMM_INFO_CACHE_SIZE);
+    if (NULL == g_dimm_info_cache.pEntries) {
+      return NULL;
+    }
+  }
+
+  for (i = 0; i < DIMM_INFO_CACHE_SIZE; i++) {
+    p_entry = &g_dimm_info_cache.pEntries[i];
+    if (p_entry->Valid && p_entry->ExpiresMs <= now) {
+      p_entry->Valid = FALSE;
+    }
+    if (p_entry->Valid && p_entry->DimmId == dimm_id && p_entry->Key == key) {
+      return p_entry;
+    }
+    if (NULL == p_victim || (p_victim->Valid && (!p_entry->Valid || p_entry->ExpiresMs < p_victim->ExpiresMs))) {
+      p_victim = p_entry;
+    }
+  }
+
+  if (NULL != p_slot) {
+    *p_slot = p_victim;
+  }
+  return NULL;
+}
+
+static int dimm_info_cache_init()
+{
+  if (NULL == g_dimm_info_cache.pLock) {
+    g_dimm_info_cache.pLock = os_mutex_init(NULL);
+    if (NULL == g_dimm_info_cache.pLock) {
+      return NVM_ERR_UNKNOWN;
+    }
+  }
+  return NVM_SUCCESS;
+}
+
+/*
+ * Drop every cached result. Called by the APIs that change the state of
+ * the PMem modules so the next query reads it from the firmware.
+ */
+static void dimm_info_cache_invalidate()
+{
+  UINT32 i = 0;
+
+  if (NULL == g_dimm_info_cache.pLock) {
+    return;
+  }
+  os_mutex_lock(g_dimm_info_cache.pLock);
+  // Pick up TTL changes made through nvm_set_user_preference()
+  g_dimm_info_cache.TtlsLoaded = FALSE;
+  g_dimm_info_cache.Generation++;
+  if (NULL != g_dimm_info_cache.pEntries) {
+    for (i = 0; i < DIMM_INFO_CACHE_SIZE; i++) {
+      g_dimm_info_cache.pEntries[i].Valid = FALSE;
+    }
+    g_dimm_info_cache.Invalidations++;
+  }
+  os_mutex_unlock(g_dimm_info_cache.pLock);
+}
+
+static void dimm_info_cache_uninit()
+{
+  if (NULL != g_dimm_info_cache.pLock) {
+    os_mutex_delete(g_dimm_info_cache.pLock, NULL);
+  }
+  FREE_POOL_SAFE(g_dimm_info_cache.pEntries);
+  ZeroMem(&g_dimm_info_cache, sizeof(g_dimm_info_cache));
+}
+
+/*
+ * Look up a cached result and copy it to p_data. On a miss it returns the
+ * generation to pass to dimm_info_cache_store() and whether the result may
+ * be cached at all.
+ */
+static BOOLEAN dimm_info_cache_lookup(UINT16 dimm_id, UINT32 key, VOID *p_data, UINTN size,
+  UINT64 *p_generation, BOOLEAN *p_cacheable)
+{
+  DIMM_INFO_CACHE_ENTRY *p_entry = NULL;
+  BOOLEAN hit = FALSE;
+
+  *p_cacheable = FALSE;
+  if (NULL == g_dimm_info_cache.pLock) {
+    return FALSE;
+  }
+  os_mutex_lock(g_dimm_info_cache.pLock);
+  if (0 != dimm_info_cache_ttl(key)) {
+    *p_cacheable = TRUE;
+    if (NULL != (p_entry = dimm_info_cache_find(dimm_id, key, NULL))) {
+      CopyMem_S(p_data, size, &p_entry->Data, size);
+      hit = TRUE;
+    }
+  }
+  if (hit) {
+    g_dimm_info_cache.Hits++;
+  } else {
+    g_dimm_info_cache.Misses++;
+  }
+  *p_generation = g_dimm_info_cache.Generation;
+  os_mutex_unlock(g_dimm_info_cache.pLock);
+  return hit;
+}
+
+/*
+ * Keep a result fetched after dimm_info_cache_lookup() returned generation,
+ * unless the cache was invalidated in the meantime
+ */
+static void dimm_info_cache_store(UINT16 dimm_id, UINT32 key, CONST VOID *p_data, UINTN size, UINT64 generation)
+{
+  DIMM_INFO_CACHE_ENTRY *p_entry = NULL;
+  DIMM_INFO_CACHE_ENTRY *p_slot = NULL;
+  UINT32 ttl = 0;
+
+  os_mutex_lock(g_dimm_info_cache.pLock);
+  ttl = dimm_info_cache_ttl(key);
+  if (generation == g_dimm_info_cache.Generation && 0 != ttl) {
+    p_entry = dimm_info_cache_find(dimm_id, key, &p_slot);
+    if (NULL == p_entry) {
+      p_entry = p_slot;
+    }
+    if (NULL != p_entry) {
+      p_entry->Valid = TRUE;
+      p_entry->DimmId = dimm_id;
+      p_entry->Key = key;
+      p_entry->ExpiresMs = os_get_monotonic_ms() + ttl;
+      CopyMem_S(&p_entry->Data, sizeof(p_entry->Data), p_data, size);
+    }
+  }
+  os_mutex_unlock(g_dimm_info_cache.pLock);
+}
+
+/*
+ * GetDimm() backed by the cache
+ */
+static EFI_STATUS get_dimm_info_cached(UINT16 dimm_id, DIMM_INFO_CATEGORIES categories, DIMM_INFO *p_dimm_info)
+{
+  EFI_STATUS ReturnCode = EFI_SUCCESS;
+  UINT64 generation = 0;
+  BOOLEAN cacheable = FALSE;
+
+  if (dimm_info_cache_lookup(dimm_id, categories, p_dimm_info, sizeof(*p_dimm_info), &generation, &cacheable)) {
+    return EFI_SUCCESS;
+  }
+
+  ReturnCode = gNvmDimmDriverNvmDimmConfig.GetDimm(&gNvmDimmDriverNvmDimmConfig, dimm_id, categories, p_dimm_info);
+  if (!EFI_ERROR(ReturnCode) && cacheable) {
+    dimm_info_cache_store(dimm_id, categories, p_dimm_info, sizeof(*p_dimm_info), generation);
+  }
+  return ReturnCode;
+}
+
+/*
+ * GetSensorsInfo() backed by the cache
+ */
+static EFI_STATUS get_sensors_info_cached(UINT16 dimm_id, DIMM_SENSOR dimm_sensors_set[SENSOR_TYPE_COUNT])
+{
+  EFI_STATUS ReturnCode = EFI_SUCCESS;
+  UINT64 generation = 0;
+  BOOLEAN cacheable = FALSE;
+  UINTN size = sizeof(DIMM_SENSOR) * SENSOR_TYPE_COUNT;
+
+  if (dimm_info_cache_lookup(dimm_id, DIMM_INFO_CACHE_SENSORS_KEY, dimm_sensors_set, size, &generation, &cacheable)) {
+    return EFI_SUCCESS;
+  }
+
+  ReturnCode = GetSensorsInfo(&gNvmDimmDriverNvmDimmConfig, dimm_id, dimm_sensors_set);
+  if (!EFI_ERROR(ReturnCode) && cacheable) {
+    dimm_info_cache_store(dimm_id, DIMM_INFO_CACHE_SENSORS_KEY, dimm_sensors_set, size, generation);
+  }
+  return ReturnCode;
+}
+
+NVM_API int nvm_get_dimm_info_cache_stats(struct dimm_info_cache_stats *p_stats)
+{
+  int rc = NVM_SUCCESS;
+
+  if (NULL == p_stats) {
+    NVDIMM_ERR("NULL input parameter\n");
+    return NVM_ERR_INVALID_PARAMETER;
+  }
+  if (NVM_SUCCESS != (rc = nvm_init())) {
+    NVDIMM_ERR("Failed to intialize nvm library %d\n", rc);
+    return rc;
+  }
+
+  ZeroMem(p_stats, sizeof(*p_stats));
+  os_mutex_lock(g_dimm_info_cache.pLock);
+  p_stats->hits = g_dimm_info_cache.Hits;
+  p_stats->misses = g_dimm_info_cache.Misses;
+  p_stats->invalidations = g_dimm_info_cache.Invalidations;
+  os_mutex_unlock(g_dimm_info_cache.pLock);
+  return NVM_SUCCESS;
+}
+
+NVM_API int nvm_invalidate_dimm_info_cache()
+{
+  int rc = NVM_SUCCESS;
+
+  if (NVM_SUCCESS != (rc = nvm_init())) {
+    NVDIMM_ERR("Failed to intialize nvm library %d\n", rc);
+    return rc;
+  }
+  dimm_info_cache_invalidate();
+  return NVM_SUCCESS;
+}
+
+/*
+ * Long operation jobs
+ *
+ * Jobs submitted by nvm_submit_job() are polled by the callers waiting on
+ * them, one at a time, so the driver is only entered from API calls and
+ * never from a thread of the library's own. Each round queries a DIMM once
+ * for all of its due jobs, and a job's poll interval doubles from
+ * JOB_POLL_MIN_MS up to JOB_POLL_MAX_MS while its progress stalls.
+ */
+#define JOB_POLL_MIN_MS     100
+#define JOB_POLL_MAX_MS     2000
+#define JOB_MAX             64
+
+typedef struct _NVM_JOB {
+  NVM_JOB_HANDLE Handle;          ///< 0 for a free slot
+  UINT16 DimmId;
+  UINT8 Opcode;                   ///< Long operation to wait for, 0 for any
+  UINT8 SubOpcode;
+  BOOLEAN Done;
+  EFI_STATUS ReturnCode;          ///< Outcome once Done
+  UINT32 IntervalMs;
+  unsigned long long NextPollMs;
+  unsigned long long DeadlineMs;  ///< 0 for no timeout
+  struct job Job;                 ///< Last polled state
+  nvm_job_callback Callback;
+  void *pContext;
+} NVM_JOB;
+
+typedef struct _NVM_JOB_ENGINE {
+  OS_MUTEX *pLock;                ///< Guards the job table
+  OS_NOTIFIER *pNotifier;         ///< Signaled on submit and after each poll round
+  NVM_JOB *pJobs;                 ///< JOB_MAX slots
+  NVM_JOB_HANDLE LastHandle;
+  BOOLEAN Polling;                ///< A caller is querying the DIMMs
+} NVM_JOB_ENGINE;
+
+static NVM_JOB_ENGINE g_job_engine;
+
+typedef struct _NVM_JOB_COMPLETION {
+  NVM_JOB_HANDLE Handle;
+  struct job Job;
+  int Result;
+  nvm_job_callback Callback;
+  void *pContext;
+} NVM_JOB_COMPLETION;
+
+static int job_return_code_to_nvm(EFI_STATUS ReturnCode)
+{
+  switch (ReturnCode) {
+  case EFI_SUCCESS:
+    return NVM_SUCCESS;
+  case EFI_NO_RESPONSE:
+    return NVM_ERR_BUSY_DEVICE;
+  case EFI_TIMEOUT:
+    return NVM_ERR_TIMEOUT;
+  case EFI_NOT_STARTED:
+    return NVM_ERR_OPERATION_NOT_STARTED;
+  case EFI_UNSUPPORTED:
+    return NVM_ERR_API_NOT_SUPPORTED;
+  case EFI_DEVICE_ERROR:
+    return NVM_ERR_DEVICE_ERROR;
+  default:
+    return NVM_ERR_OPERATION_FAILED;
+  }
+}
+
+static NVM_JOB *job_find(NVM_JOB_HANDLE handle)
+{
+  UINT32 i;
+
+  if (0 == handle || NULL == g_job_engine.pJobs) {
+    return NULL;
+  }
+  for (i = 0; i < JOB_MAX; i++) {
+    if (g_job_engine.pJobs[i].Handle == handle) {
+      return &g_job_engine.pJobs[i];
+    }
+  }
+  return NULL;
+}
+
+/*
+ * Apply a status query to a running job, the same way PollLongOpStatus
+ * judges one poll
+ */
+static void job_update(NVM_JOB *p_job, const LONG_OP_QUERY *p_query, unsigned long long now)
+{
+  UINT8 percent = p_job->Job.percent_complete;
+
+  p_job->Done = TRUE;
+  if (EFI_ERROR(p_query->ReturnCode)) {
+    p_job->ReturnCode = p_query->ReturnCode;
+    p_job->Job.status = NVM_JOB_STATUS_UNKNOWN;
+    return;
+  }
+  long_op_query_to_job(p_query, &p_job->Job);
+  if (0 != p_job->Opcode &&
+      (p_job->Opcode != p_query->Opcode || p_job->SubOpcode != p_query->SubOpcode)) {
+    // Another long operation ran last, assume < FIS 1.6 and not supported
+    p_job->ReturnCode = EFI_INCOMPATIBLE_VERSION;
+    return;
+  }
+  if (EFI_NO_RESPONSE != p_query->LongOpStatus) {
+    p_job->ReturnCode = p_query->LongOpStatus;
+    return;
+  }
+  if (0 != p_job->DeadlineMs && now >= p_job->DeadlineMs) {
+    p_job->ReturnCode = EFI_TIMEOUT;
+    return;
+  }
+
+  p_job->Done = FALSE;
+  if (p_job->Job.percent_complete != percent) {
+    p_job->IntervalMs = JOB_POLL_MIN_MS;
+  }
+  else if (p_job->IntervalMs < JOB_POLL_MAX_MS) {
+    p_job->IntervalMs = MIN(p_job->IntervalMs * 2, JOB_POLL_MAX_MS);
+  }
+  p_job->NextPollMs = now + p_job->IntervalMs;
+  if (0 != p_job->DeadlineMs && p_job->NextPollMs > p_job->DeadlineMs) {
+    p_job->NextPollMs = p_job->DeadlineMs;
+  }
+}
+
+/*
+ * Query the DIMMs with a job due and apply the results. Called with
+ * g_job_engine.pLock held, which is released around the queries and the
+ * completion callbacks. Returns when the next job is due.
+ */
+static unsigned long long job_poll(void)
+{
+  UINT16 due_dimms[JOB_MAX];
+  LONG_OP_QUERY queries[JOB_MAX];
+  NVM_JOB_COMPLETION completions[JOB_MAX];
+  UINT32 due_cnt = 0;
+  UINT32 completed_cnt = 0;
+  UINT32 i, j;
+  NVM_JOB *p_job;
+  unsigned long long now = os_get_monotonic_ms();
+  unsigned long long next_poll = now + JOB_POLL_MAX_MS;
+
+  // Collect the DIMMs with a job due, each one is queried once
+  for (i = 0; i < JOB_MAX; i++) {
+    p_job = &g_job_engine.pJobs[i];
+    if (0 == p_job->Handle || p_job->Done) {
+      continue;
+    }
+    if (p_job->NextPollMs > now) {
+      next_poll = MIN(next_poll, p_job->NextPollMs);
+      continue;
+    }
+    for (j = 0; j < due_cnt && due_dimms[j] != p_job->DimmId; j++);
+    if (j == due_cnt) {
+      due_dimms[due_cnt++] = p_job->DimmId;
+    }
+  }
+  if (0 == due_cnt) {
+    return next_poll;
+  }
+
+  g_job_engine.Polling = TRUE;
+  os_mutex_unlock(g_job_engine.pLock);
+  for (j = 0; j < due_cnt; j++) {
+    query_long_op(due_dimms[j], &queries[j]);
+  }
+  os_mutex_lock(g_job_engine.pLock);
+  g_job_engine.Polling = FALSE;
+
+  // Jobs submitted or released meanwhile are picked up next round
+  now = os_get_monotonic_ms();
+  next_poll = now + JOB_POLL_MAX_MS;
+  for (i = 0; i < JOB_MAX; i++) {
+    p_job = &g_job_engine.pJobs[i];
+    if (0 == p_job->Handle || p_job->Done) {
+      continue;
+    }
+    for (j = 0; j < due_cnt && due_dimms[j] != p_job->DimmId; j++);
+    if (j < due_cnt && p_job->NextPollMs <= now) {
+      job_update(p_job, &queries[j], now);
+    }
+    if (!p_job->Done) {
+      next_poll = MIN(next_poll, p_job->NextPollMs);
+    }
+    else if (NULL != p_job->Callback) {
+      completions[completed_cnt].Handle = p_job->Handle;
+      completions[completed_cnt].Job = p_job->Job;
+      completions[completed_cnt].Result = job_return_code_to_nvm(p_job->ReturnCode);
+      completions[completed_cnt].Callback = p_job->Callback;
+      completions[completed_cnt].pContext = p_job->pContext;
+      // Reported once
+      p_job->Callback = NULL;
+      completed_cnt++;
+    }
+  }
+  os_notifier_signal(g_job_engine.pNotifier);
+
+  if (0 != completed_cnt) {
+    os_mutex_unlock(g_job_engine.pLock);
+    for (i = 0; i < completed_cnt; i++) {
+      completions[i].Callback(completions[i].Handle, &completions[i].Job,
+        completions[i].Result, completions[i].pContext);
+    }
+    os_mutex_lock(g_job_engine.pLock);
+  }
+  return next_poll;
+}
+
+static int job_engine_init()
+{
+  if (NULL != g_job_engine.pJobs) {
+    return NVM_SUCCESS;
+  }
+  g_job_engine.pLock = os_mutex_init(NULL);
+  g_job_engine.pNotifier = os_notifier_create();
+  g_job_engine.pJobs = AllocateZeroPool(sizeof(NVM_JOB) * JOB_MAX);
+  if (NULL == g_job_engine.pLock || NULL == g_job_engine.pNotifier || NULL == g_job_engine.pJobs) {
+    job_engine_uninit();
+    return NVM_ERR_NO_MEM;
+  }
+  return NVM_SUCCESS;
+}
+
+/*
+ * Drop every job, their handles become invalid
+ */
+static void job_engine_uninit()
+{
+  if (NULL != g_job_engine.pLock) {
+    os_mutex_delete(g_job_engine.pLock, NULL);
+  }
+  if (NULL != g_job_engine.pNotifier) {
+    os_notifier_delete(g_job_engine.pNotifier);
+  }
+  FREE_POOL_SAFE(g_job_engine.pJobs);
+  ZeroMem(&g_job_engine, sizeof(g_job_engine));
+}
+
+/*
+ * Add a job to the table. Called with the engine initialized and
+ * g_job_engine.pLock not held.
+ */
+static int job_submit(UINT16 dimm_id, const char *uid, UINT8 opcode, UINT8 subopcode, unsigned long long timeout_ms,
+  nvm_job_callback callback, void *p_context, NVM_JOB_HANDLE *p_handle)
+{
+  NVM_JOB *p_job = NULL;
+  unsigned long long now = os_get_monotonic_ms();
+  int rc = NVM_SUCCESS;
+  UINT32 i;
+
+  os_mutex_lock(g_job_engine.pLock);
+  for (i = 0; i < JOB_MAX && NULL == p_job; i++) {
+    if (0 == g_job_engine.pJobs[i].Handle) {
+      p_job = &g_job_engine.pJobs[i];
+    }
+  }
+  if (NULL == p_job) {
+    NVDIMM_ERR("Too many jobs tracked\n");
+    rc = NVM_ERR_NO_MEM;
+    goto Finish;
+  }
+
+  ZeroMem(p_job, sizeof(*p_job));
+  do {
+    g_job_engine.LastHandle++;
+  } while (0 == g_job_engine.LastHandle || NULL != job_find(g_job_engine.LastHandle));
+  p_job->Handle = g_job_engine.LastHandle;
+  p_job->DimmId = dimm_id;
+  p_job->Opcode = opcode;
+  p_job->SubOpcode = subopcode;
+  p_job->ReturnCode = EFI_NO_RESPONSE;
+  p_job->IntervalMs = JOB_POLL_MIN_MS;
+  p_job->NextPollMs = now + JOB_POLL_MIN_MS;
+  p_job->DeadlineMs = (0 != timeout_ms) ? now + timeout_ms : 0;
+  p_job->Job.status = NVM_JOB_STATUS_RUNNING;
+  p_job->Job.type = long_op_job_type(opcode, subopcode);
+  if (NULL != uid) {
+    s_strcpy(p_job->Job.uid, uid, NVM_MAX_UID_LEN);
+    s_strcpy(p_job->Job.affected_element, uid, NVM_MAX_UID_LEN);
+  }
+  p_job->Callback = callback;
+  p_job->pContext = p_context;
+  *p_handle = p_job->Handle;
+
+Finish:
+  os_mutex_unlock(g_job_engine.pLock);
+  os_notifier_signal(g_job_engine.pNotifier);
+  return rc;
+}
+
+/*
+ * Block until the jobs finish, polling them from the calling thread unless
+ * another caller is already doing it. Called with g_job_engine.pLock held,
+ * which is released while querying and waiting.
+ */
+static int job_wait(const NVM_JOB_HANDLE *p_jobs, UINT32 count, BOOLEAN wait_all, int timeout_ms, UINT32 *p_index)
+{
+  unsigned long long deadline = os_get_monotonic_ms() + (timeout_ms > 0 ? timeout_ms : 0);
+  unsigned long long now;
+  unsigned long long wake;
+  unsigned long long seq;
+  NVM_JOB *p_job;
+  UINT32 done_cnt;
+  UINT32 first_done;
+  UINT32 i;
+
+  for (;;) {
+    done_cnt = 0;
+    first_done = count;
+    for (i = 0; i < count; i++) {
+      if (NULL == (p_job = job_find(p_jobs[i]))) {
+        return NVM_ERR_INVALID_PARAMETER;
+      }
+      if (p_job->Done) {
+        done_cnt++;
+        first_done = MIN(first_done, i);
+      }
+    }
+    if (wait_all ? (done_cnt == count) : (0 != done_cnt)) {
+      if (NULL != p_index) {
+        *p_index = first_done;
+      }
+      return NVM_SUCCESS;
+    }
+
+    now = os_get_monotonic_ms();
+    if (timeout_ms >= 0 && now >= deadline) {
+      return NVM_ERR_TIMEOUT;
+    }
+    // Either poll or sleep until the caller that polls reports a round
+    seq = os_notifier_seq(g_job_engine.pNotifier);
+    wake = g_job_engine.Polling ? now + JOB_POLL_MAX_MS : job_poll();
+    if (seq != os_notifier_seq(g_job_engine.pNotifier)) {
+      continue;
+    }
+    if (timeout_ms >= 0) {
+      wake = MIN(wake, deadline);
+    }
+    now = os_get_monotonic_ms();
+    if (wake > now) {
+      os_mutex_unlock(g_job_engine.pLock);
+      os_notifier_wait(g_job_engine.pNotifier, seq, (long)(wake - now));
+      os_mutex_lock(g_job_engine.pLock);
+    }
+  }
+}
+
+/*
+ * PollLongOpStatus for the OS build, see Utility.h
+ */
+EFI_STATUS
+WaitForLongOp(
+  IN     UINT16 DimmId,
+  IN     UINT8 OpcodeToPoll OPTIONAL,
+  IN     UINT8 SubOpcodeToPoll OPTIONAL,
+  IN     UINT64 Timeout
+  )
+{
+  EFI_STATUS ReturnCode = EFI_DEVICE_ERROR;
+  NVM_JOB_HANDLE handle = 0;
+  NVM_JOB *p_job;
+
+  if (NVM_SUCCESS != job_engine_init()) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+  // Timeout is in 100ns units, round up to keep a non-zero timeout non-zero
+  if (NVM_SUCCESS != job_submit(DimmId, NULL, OpcodeToPoll, SubOpcodeToPoll, (Timeout + 9999) / 10000, NULL, NULL, &handle)) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  os_mutex_lock(g_job_engine.pLock);
+  if (NVM_SUCCESS == job_wait(&handle, 1, TRUE, -1, NULL) && NULL != (p_job = job_find(handle))) {
+    ReturnCode = p_job->ReturnCode;
+    p_job->Handle = 0;
+  }
+  os_mutex_unlock(g_job_engine.pLock);
+  return ReturnCode;
+}
+
+NVM_API int nvm_submit_job(const NVM_UID device_uid, const enum nvm_job_type type,
+  const NVM_UINT32 timeout_ms, nvm_job_callback callback, void *p_context, NVM_JOB_HANDLE *p_job)
+{
+  int rc = NVM_SUCCESS;
+  UINT16 dimm_id = 0;
+  UINT8 opcode = 0;
+  UINT8 subopcode = 0;
+
+  if (NULL == device_uid || NULL == p_job) {
+    NVDIMM_ERR("NULL input parameter\n");
+    return NVM_ERR_INVALID_PARAMETER;
+  }
+  if (NVM_SUCCESS != (rc = nvm_init())) {
+    NVDIMM_ERR("Failed to intialize nvm library %d\n", rc);
+    return rc;
+  }
+  if (NVM_SUCCESS != (rc = get_dimm_id(device_uid, &dimm_id, NULL))) {
+    NVDIMM_ERR("Failed to get dimm ID %d\n", rc);
+    return rc;
+  }
+
+  switch (type) {
+  case NVM_JOB_TYPE_SANITIZE:
+    opcode = PtSetSecInfo;
+    subopcode = SubopOverwriteDimm;
+    break;
+  case NVM_JOB_TYPE_ARS:
+    opcode = PtSetFeatures;
+    subopcode = SubopAddressRangeScrub;
+    break;
+  case NVM_JOB_TYPE_FW_UPDATE:
+    opcode = PtUpdateFw;
+    subopcode = SubopUpdateFw;
+    break;
+  case NVM_JOB_TYPE_UNKNOWN:
+    break;
+  default:
+    return NVM_ERR_INVALID_PARAMETER;
+  }
+
+  if (NVM_SUCCESS != (rc = job_engine_init())) {
+    return rc;
+  }
+  return job_submit(dimm_id, device_uid, opcode, subopcode, timeout_ms, callback, p_context, p_job);
+}
+
+NVM_API int nvm_get_job_status(const NVM_JOB_HANDLE job, struct job *p_job, int *p_result)
+{
+  int rc = NVM_ERR_INVALID_PARAMETER;
+  NVM_JOB *p_entry;
+
+  if (NULL == g_job_engine.pLock) {
+    return NVM_ERR_INVALID_PARAMETER;
+  }
+  os_mutex_lock(g_job_engine.pLock);
+  if (NULL != job_find(job) && !g_job_engine.Polling) {
+    job_poll();
+  }
+  if (NULL != (p_entry = job_find(job))) {
+    if (NULL != p_job) {
+      *p_job = p_entry->Job;
+    }
+    if (NULL != p_result) {
+      *p_result = p_entry->Done ? job_return_code_to_nvm(p_entry->ReturnCode) : NVM_ERR_BUSY_DEVICE;
+    }
+    rc = NVM_SUCCESS;
+  }
+  os_mutex_unlock(g_job_engine.pLock);
+  return rc;
+}
+
+NVM_API int nvm_wait_for_jobs(const NVM_JOB_HANDLE *p_jobs, const NVM_UINT32 count,
+  const NVM_BOOL wait_all, const int timeout_ms, NVM_UINT32 *p_index)
+{
+  int rc;
+
+  if (NULL == p_jobs || 0 == count || NULL == g_job_engine.pLock) {
+    return NVM_ERR_INVALID_PARAMETER;
+  }
+  os_mutex_lock(g_job_engine.pLock);
+  rc = job_wait(p_jobs, count, wait_all ? TRUE : FALSE, timeout_ms, p_index);
+  os_mutex_unlock(g_job_engine.pLock);
+  return rc;
+}
+
+NVM_API int nvm_release_job(const NVM_JOB_HANDLE job)
+{
+  int rc = NVM_ERR_INVALID_PARAMETER;
+  NVM_JOB *p_entry;
+
+  if (NULL == g_job_engine.pLock) {
+    return NVM_ERR_INVALID_PARAMETER;
+  }
+  os_mutex_lock(g_job_engine.pLock);
+  if (NULL != (p_entry = job_find(job))) {
+    p_entry->Handle = 0;
+    rc = NVM_SUCCESS;
+  }
+  os_mutex_unlock(g_job_engine.pLock);
+  return rc;
+}
@@ -1131,6 +1131,102 @@ struct job {
   NVM_UINT8		reserved[64];		///< reserved
 };
 
+/**
+ * Handle of a long operation tracked by nvm_submit_job(), 0 is never a valid handle.
+ */
+typedef NVM_UINT32 NVM_JOB_HANDLE;
+
+/**
+ * Called once a job finishes, from the nvm_wait_for_jobs() or
+ * nvm_get_job_status() call that polled it to completion.
+ * @param job Handle returned by nvm_submit_job()
+ * @param p_job Final state of the job
+ * @param result Outcome of the long operation, see nvm_get_job_status()
+ * @param p_context Context passed to nvm_submit_job()
+ */
+typedef void (*nvm_job_callback)(const NVM_JOB_HANDLE job, const struct job *p_job,
+  const int result, void *p_context);
+
+/**
+ * Counters of the DIMM_INFO and sensor results cache, see nvm_get_dimm_info_cache_stats().
+ */
+struct dimm_info_cache_stats {
+  NVM_UINT64	hits;                   ///< Queries answered from the cache
+  NVM_UINT64	misses;                 ///< Queries sent to the firmware
+  NVM_UINT64	invalidations;          ///< Times the cache was emptied by a state changing call
+  NVM_UINT8	reserved[32];           ///< reserved
+};
+
+/**
+ * Steps of the firmware update of a PMem module, see device_fw_update_status.
+ */
+enum device_fw_update_state {
+  DEVICE_FW_UPDATE_STATE_NONE = 0,      ///< No update attempted since the library was loaded
+  DEVICE_FW_UPDATE_STATE_QUEUED = 1,    ///< Image accepted for the module, transfer not started yet
+  DEVICE_FW_UPDATE_STATE_TRANSFER = 2,  ///< Sending the image
+  DEVICE_FW_UPDATE_STATE_VERIFY = 3,    ///< Image sent, firmware authenticating and staging it
+  DEVICE_FW_UPDATE_STATE_STAGED = 4,    ///< Image staged, activated on the next reset
+  DEVICE_FW_UPDATE_STATE_FAILED = 5     ///< Update failed, see result
+};
+
+/**
+ * Progress and timing of the firmware update of a PMem module.
+ */
+struct device_fw_update_status {
+  NVM_UID	uid;                            ///< UID of the PMem module
+  enum device_fw_update_state	state;      ///< Current step
+  NVM_UINT8	progress;                     ///< Percent of the image sent
+  NVM_UINT16	ars_retries;                ///< Packets resent after ARS kept the module busy
+  int	result;                             ///< NVM_SUCCESS_FW_RESET_REQUIRED once staged, the error once failed
+  NVM_UINT64	transfer_time_ms;           ///< Time spent sending the image
+  NVM_UINT64	stage_time_ms;              ///< Time from the end of the transfer until a status call saw the image staged
+  NVM_UINT8	reserved[32];                 ///< reserved
+};
+
+/**
+ * Interface and mailbox firmware commands are sent over, see device_transport.
+ */
+enum device_transport_method {
+  DEVICE_TRANSPORT_DDRT_LARGE_PAYLOAD = 0,  ///< DDRT, large mailbox
+  DEVICE_TRANSPORT_DDRT_SMALL_PAYLOAD = 1,  ///< DDRT, small mailbox
+  DEVICE_TRANSPORT_SMBUS_SMALL_PAYLOAD = 2  ///< SMBus, small mailbox
+};
+
+/**
+ * Transport resolved for the firmware commands of a PMem module.
+ */
+struct device_transport {
+  NVM_BOOL	mailbox_ready;                          ///< 0 if the module did not answer over any interface
+  NVM_BOOL	large_payload_available;                ///< Large payload commands use the DDRT large mailbox
+  enum device_transport_method	small_payload_method; ///< Used by commands without a large payload
+  enum device_transport_method	large_payload_method; ///< Used by large payload commands
+  NVM_UINT32	large_input_payload_size;             ///< Large input mailbox size, 0 if not available
+  NVM_UINT32	large_output_payload_size;            ///< Large output mailbox size, 0 if not available
+  NVM_UINT8	reserved[32];                           ///< reserved
+};
+
+#define NVM_FW_CMD_STATS_STATUS_BUCKETS   32  ///< One per FIS status code, the last one also counts the codes above it
+#define NVM_FW_CMD_STATS_LATENCY_BUCKETS  32  ///< Log2 buckets of microseconds
+
+/**
+ * Counters of the firmware commands of one opcode/sub-opcode sent to a PMem module.
+ */
+struct device_fw_cmd_stats {
+  NVM_UINT8	opcode;
+  NVM_UINT8	sub_opcode;
+  NVM_UINT64	calls;                                          ///< Commands sent
+  NVM_UINT64	retries;                                        ///< DSM retries suggested by the platform
+  NVM_UINT64	errors;                                         ///< Commands that failed
+  NVM_UINT64	bytes_in;                                       ///< Input payload bytes sent
+  NVM_UINT64	bytes_out;                                      ///< Output payload bytes received
+  NVM_UINT64	total_us;                                       ///< Sum of the latencies
+  NVM_UINT64	min_us;
+  NVM_UINT64	max_us;
+  NVM_UINT64	fis_status[NVM_FW_CMD_STATS_STATUS_BUCKETS];    ///< Commands per FIS mailbox status code
+  NVM_UINT64	latency_us[NVM_FW_CMD_STATS_LATENCY_BUCKETS];   ///< Bucket N counts latencies of [2^N, 2^(N+1)) us
+  NVM_UINT8	reserved[32];                                   ///< reserved
+};
+
 #define TEMP_POSITIVE           0
 #define TEMP_NEGATIVE           1
 #define TEMP_USER_ALARM         0
@@ -1157,6 +1253,17 @@ NVM_API int nvm_init();
  */
 NVM_API void nvm_uninit();
 
+/**
+* @brief  Run one ipmctl command line, as the ipmctl executable does.
+* @param[in] argc
+*            Number of arguments, including the program name.
+* @param[in] argv
+*            The arguments, e.g. { "ipmctl", "show", "-o", "nvmxml", "-dimm" }.
+* @remarks The output is printed to stdout.
+* @return The exit code of the command.
+*/
+NVM_API int nvm_run_cli(int argc, char *argv[]);
+
 /**
 * @brief    Initialize the config file. Only the first call to the
 * function changes the conf file configuration, the following
@@ -1575,6 +1682,89 @@ NVM_API int nvm_update_device_fw(const NVM_UID device_uid, const NVM_PATH path,
  */
 NVM_API int nvm_examine_device_fw(const NVM_UID device_uid, const NVM_PATH path, const NVM_SIZE path_len, NVM_VERSION image_version, const NVM_SIZE image_version_len);
 
+/**
+ * @brief Push a new FW image to several devices at once.
+ *
+ * The image is read and verified once and sent to all the devices concurrently.
+ * The call returns once the image is sent. Each device then authenticates and
+ * stages it on its own, poll nvm_get_device_fw_update_status() until the state
+ * is DEVICE_FW_UPDATE_STATE_STAGED or DEVICE_FW_UPDATE_STATE_FAILED.
+ *
+ * @remarks A device that already has an image staged is not sent the new one,
+ * its result is ::NVM_ERR_FIRMWARE_ALREADY_LOADED.
+ *
+ * @remarks If Address Range Scrub (ARS) is in progress on a target PMem module,
+ * an attempt will be made to abort ARS on that module and the proceed with its
+ * firmware update, the other modules are not held up.
+ *
+ * @remarks A reboot is required to activate the updated firmware image.
+ *
+ * @param[in] p_device_uids
+ *              Array of device identifiers.
+ * @param[in] device_count
+ *              Number of elements in p_device_uids and p_status.
+ * @param[in] path
+ *              Absolute file path to the new firmware image.
+ * @param[in] path_len
+ *              String length of path, should be < NVM_PATH_LEN.
+ * @param[in] force
+ *              If attempting to downgrade the minor version, force must be true.
+ * @param[out] p_status
+ *              Outcome, progress and timing of the update of each device.
+ * @pre The caller has administrative privileges.
+ * @pre The devices are manageable.
+ *
+ * @return
+ *            ::NVM_SUCCESS the image was sent to all the devices @n
+ *            ::NVM_ERR_INVALID_PARAMETER @n
+ *            ::NVM_ERR_NO_MEM @n
+ *            ::NVM_ERR_UNKNOWN @n
+ *            Otherwise the status of the last device that failed, see p_status
+ */
+NVM_API int nvm_update_devices_fw(const NVM_UID *p_device_uids, const NVM_UINT32 device_count,
+  const NVM_PATH path, const NVM_SIZE path_len, const NVM_BOOL force,
+  struct device_fw_update_status *p_status);
+
+/**
+ * @brief Get the progress and timing of the firmware update of a device.
+ *
+ * Reports the update under way, from another thread of the caller, or else the
+ * last one since the library was loaded. While the image is being staged each
+ * call checks the device once and moves it to the staged or failed state.
+ *
+ * @param[in] device_uid
+ *              The device identifier.
+ * @param[out] p_status
+ *              Progress and timing of the update.
+ *
+ * @return
+ *            ::NVM_SUCCESS @n
+ *            ::NVM_ERR_INVALID_PARAMETER @n
+ *            ::NVM_ERR_DIMM_NOT_FOUND @n
+ *            ::NVM_ERR_UNKNOWN @n
+ */
+NVM_API int nvm_get_device_fw_update_status(const NVM_UID device_uid, struct device_fw_update_status *p_status);
+
+/**
+ * @brief Get the transport the firmware commands of a device are sent over.
+ *
+ * The transport is resolved when the device is initialized and again after the
+ * transport attributes change. A device that answers over DDRT reports a DDRT
+ * method, a SMBus method there means the library fell back to SMBus.
+ *
+ * @param[in] device_uid
+ *              The device identifier.
+ * @param[out] p_transport
+ *              The resolved transport.
+ *
+ * @return
+ *            ::NVM_SUCCESS @n
+ *            ::NVM_ERR_INVALID_PARAMETER @n
+ *            ::NVM_ERR_DIMM_NOT_FOUND @n
+ *            ::NVM_ERR_UNKNOWN @n
+ */
+NVM_API int nvm_get_device_transport(const NVM_UID device_uid, struct device_transport *p_transport);
+
 /**
  * @brief Retrieve the supported capabilities for all devices in aggregate.
  * @param[in,out] p_capabilties
@@ -2271,6 +2461,71 @@ NVM_API int nvm_debug_logging_enabled();
  */
 NVM_API int nvm_toggle_debug_logging(const NVM_BOOL enabled);
 
+/**
+ * @brief Determine if the firmware command statistics are being collected.
+ * @return Returns true (1) if they are collected and false (0) if not,
+ * or
+ *            ::NVM_ERR_UNKNOWN @n
+ */
+NVM_API int nvm_fw_cmd_stats_enabled();
+
+/**
+ * @brief Toggle whether the library collects per device and opcode counters and
+ * latency histograms of the firmware commands it sends.
+ * @param[in] enabled @n
+ *              0: Stop collecting, the statistics collected are kept. @n
+ *              1: Collect. @n
+ * @remarks The collection starts enabled when FW_CMD_STATS_ENABLED is set in the
+ * configuration file. The cost of a disabled collection is a single test per command.
+ * @return
+ *            ::NVM_SUCCESS @n
+ *            ::NVM_ERR_NO_MEM @n
+ *            ::NVM_ERR_UNKNOWN @n
+ */
+NVM_API int nvm_toggle_fw_cmd_stats(const NVM_BOOL enabled);
+
+/**
+ * @brief Drop the firmware command statistics collected so far.
+ * @return
+ *            ::NVM_SUCCESS @n
+ *            ::NVM_ERR_UNKNOWN @n
+ */
+NVM_API int nvm_reset_fw_cmd_stats();
+
+/**
+ * @brief Retrieve the number of opcode/sub-opcode pairs with firmware command
+ * statistics for a device.
+ * @param[in] device_uid
+ *              The device identifier.
+ * @param[out] count
+ *              The number of #device_fw_cmd_stats entries available.
+ * @return
+ *            ::NVM_SUCCESS @n
+ *            ::NVM_ERR_INVALID_PARAMETER @n
+ *            ::NVM_ERR_DIMM_NOT_FOUND @n
+ *            ::NVM_ERR_UNKNOWN @n
+ */
+NVM_API int nvm_get_number_of_fw_cmd_stats(const NVM_UID device_uid, NVM_UINT32 *count);
+
+/**
+ * @brief Retrieve the firmware command statistics of a device, sorted by
+ * opcode and sub-opcode.
+ * @param[in] device_uid
+ *              The device identifier.
+ * @param[in,out] p_stats
+ *              An array of #device_fw_cmd_stats structures allocated by the caller.
+ * @param[in] count
+ *              The number of elements in the array, see #nvm_get_number_of_fw_cmd_stats.
+ * @return
+ *            ::NVM_SUCCESS @n
+ *            ::NVM_ERR_INVALID_PARAMETER @n
+ *            ::NVM_ERR_DIMM_NOT_FOUND @n
+ *            ::NVM_ERR_BAD_SIZE @n
+ *            ::NVM_ERR_UNKNOWN @n
+ */
+NVM_API int nvm_get_fw_cmd_stats(const NVM_UID device_uid, struct device_fw_cmd_stats *p_stats,
+  const NVM_UINT32 count);
+
 /**
  * @brief Retrieves #job information about each device in the system
  * @param[in,out] p_jobs
@@ -2291,13 +2546,103 @@ NVM_API int nvm_toggle_debug_logging(const NVM_BOOL enabled);
  */
 NVM_API int nvm_get_jobs(struct job *p_jobs, const NVM_UINT32 count);
 
+/**
+ * @brief Start tracking a long operation on a PMem module without blocking
+ *
+ * The operation itself is started with the matching API (firmware update,
+ * sanitize/overwrite or ARS). Jobs are polled from nvm_wait_for_jobs() and
+ * nvm_get_job_status(), querying each PMem module once per round and backing
+ * off while a job makes no progress. No thread is started.
+ * @param[in] device_uid
+ *              The PMem module running the operation.
+ * @param[in] type
+ *              Long operation to wait for. NVM_JOB_TYPE_UNKNOWN accepts any.
+ * @param[in] timeout_ms
+ *              Time after which the job completes with NVM_ERR_TIMEOUT, 0 for none.
+ * @param[in] callback
+ *              Optional, invoked when the job finishes, see nvm_job_callback.
+ * @param[in] p_context
+ *              Passed to the callback.
+ * @param[out] p_job
+ *              Handle to wait on, released with nvm_release_job().
+ * @return
+ *            ::NVM_SUCCESS @n
+ *            ::NVM_ERR_INVALID_PARAMETER @n
+ *            ::NVM_ERR_NO_MEM @n
+ *            ::NVM_ERR_UNKNOWN @n
+ */
+NVM_API int nvm_submit_job(const NVM_UID device_uid, const enum nvm_job_type type,
+  const NVM_UINT32 timeout_ms, nvm_job_callback callback, void *p_context, NVM_JOB_HANDLE *p_job);
+
+/**
+ * @brief Latest state of a job submitted by nvm_submit_job(), polling it
+ * first if it is due
+ * @param[in] job
+ *              Job handle.
+ * @param[out] p_job
+ *              Optional, receives the last polled state and progress.
+ * @param[out] p_result
+ *              Optional, receives NVM_ERR_BUSY_DEVICE while the job runs, then
+ *              NVM_SUCCESS or the error the long operation finished with.
+ * @return
+ *            ::NVM_SUCCESS @n
+ *            ::NVM_ERR_INVALID_PARAMETER @n
+ */
+NVM_API int nvm_get_job_status(const NVM_JOB_HANDLE job, struct job *p_job, int *p_result);
+
+/**
+ * @brief Wait for any or all of a set of jobs to finish
+ * @param[in] p_jobs
+ *              Job handles.
+ * @param[in] count
+ *              The number of elements in p_jobs.
+ * @param[in] wait_all
+ *              Wait for every job rather than the first one.
+ * @param[in] timeout_ms
+ *              Maximum time to wait, negative to wait indefinitely.
+ * @param[out] p_index
+ *              Optional, index in p_jobs of the first finished job.
+ * @return
+ *            ::NVM_SUCCESS @n
+ *            ::NVM_ERR_INVALID_PARAMETER @n
+ *            ::NVM_ERR_TIMEOUT @n
+ */
+NVM_API int nvm_wait_for_jobs(const NVM_JOB_HANDLE *p_jobs, const NVM_UINT32 count,
+  const NVM_BOOL wait_all, const int timeout_ms, NVM_UINT32 *p_index);
+
+/**
+ * @brief Stop tracking a job and free its handle, whether it finished or not
+ * @param[in] job
+ *              Job handle.
+ * @return
+ *            ::NVM_SUCCESS @n
+ *            ::NVM_ERR_INVALID_PARAMETER @n
+ */
+NVM_API int nvm_release_job(const NVM_JOB_HANDLE job);
+
 /**
  * @brief Initialize a new context
+ *
+ * Until the matching nvm_free_context() the library keeps the ACPI tables,
+ * SMBIOS data, PMem module inventory, PCD/LSA caches and the passthrough
+ * handle resident instead of refreshing them on each API call, and defers
+ * nvm_uninit(). Contexts nest, the outermost one owns the resources.
+ * @return
+ *            ::NVM_SUCCESS @n
+ *            ::NVM_ERR_UNKNOWN @n
+ *            ::NVM_ERR_INVALID_PERMISSIONS @n
  */
 NVM_API int nvm_create_context();
 
 /**
  * @brief Clean up the current context
+ *
+ * Releases what the context kept resident once the outermost context is
+ * freed. The library is uninitialized too when the context initialized it
+ * or nvm_uninit() was called while it was open.
+ * @param force Free every nested context at once
+ * @return
+ *            ::NVM_SUCCESS @n
  */
 NVM_API int nvm_free_context(const NVM_BOOL force);
 
@@ -2382,6 +2727,27 @@ NVM_API int nvm_get_fw_error_log_entry_cmd(const NVM_UID   device_uid, const uns
 
 NVM_API int nvm_get_fw_err_log_stats(const NVM_UID device_uid, struct device_error_log_status *error_log_stats);
 
+/**
+* @brief Retrieve the counters of the DIMM_INFO and sensor results cache.
+* nvm_get_device_status, nvm_get_device_details, nvm_get_device_discovery
+* and nvm_get_sensor(s) results are kept for the DIMM_INFO_CACHE_TTL_MS*
+* preferences (0, no caching, by default) and dropped by the calls changing
+* the PMem modules state.
+* @param[out] p_stats Pointer to #dimm_info_cache_stats.
+* @return
+*            ::NVM_SUCCESS @n
+*            ::NVM_ERR_INVALID_PARAMETER @n
+*/
+NVM_API int nvm_get_dimm_info_cache_stats(struct dimm_info_cache_stats *p_stats);
+
+/**
+* @brief Drop every result held by the DIMM_INFO and sensor results cache,
+* e.g. after the PMem modules were changed by another process.
+* @return
+*            ::NVM_SUCCESS @n
+*/
+NVM_API int nvm_invalidate_dimm_info_cache();
+
 /**
 * @brief Lock API
 */
@@ -22,15 +22,6 @@
 extern "C"
 {
 #endif
-#define NEW_BRANCH_IDENTIFIER                   L"---"
-#define TABLE_TOK_DELIM                         L" \t"
-#define TABBED_TABLE_TOK_DELIM                  L"\t"
-#define KEY_VALUE_TOK_DELIM                     L"=:"
-#define XML_ROOT_LIST_BEGIN_TAG                 L"<%lsList>\n"
-#define XML_ROOT_LIST_END_TAG                   L"</%lsList>\n"
-#define XML_ROOT_KEY_VALS_BEGIN_TAG             L"<%ls>\n"
-#define XML_ROOT_KEY_VALS_END_TAG               L"</%ls>\n"
-#define XML_KEY_VAL_PAIR_TAGS                   L"\t<%ls>%ls</%ls>\n"
 #define XML_RESULT_BEGIN                        L"<Results>\n<Result>\n"
 #define XML_RESULT_END                          L"</Result>\n</Results>\n"
 #define XML_ERROR_BEGIN                         L"<Error Type=\"%d\">"
@@ -39,54 +30,7 @@ extern "C"
 #define ESX_XML_FILE_END                        L"</output>"
 #define ESX_XML_STRING_BEGIN                    L"<string><![CDATA["
 #define ESX_XML_STRING_END                      L"]]></string>"
-#define ESX_XML_LIST_STRUCT_BEGIN               L"<list type=\"structure\">"
-#define ESX_XML_LIST_STRUCT_END                 L"</list>"
-#define ESX_XML_KEY_VAL_TYPE_STRUCT_BEGIN       L"<structure typeName=\"KeyValue\">"
-#define ESX_XML_STRUCT_BEGIN                    L"<structure typeName=\"%ls\">"
-#define ESX_XML_KEY_VAL_TYPE_STRUCT_END         L"</structure>"
-#define ESX_XML_FIELD_ATTRIB_NAME_BEGIN         L"<field name = \"Attribute Name\">"
-#define ESX_XML_FIELD_VALUE_BEGIN               L"<field name = \"Value\">"
-#define ESX_XML_FIELD_BEGIN                     L"<field name = \"%ls\">"
-#define ESX_XML_FIELD_END                       L"</field>"
-#define ESX_XML_STRING_BEGIN_AND_END            L"<string>%ls</string>"
-#ifdef __ESX__
-#define NUM_DICTIONARIES_MAX                    100
-#else
-#define NUM_DICTIONARIES_MAX                    1024
-#endif
-#define PAIR_NAME_SZ                            256
-#define PAIR_VALUE_SZ                           1533
 #define READ_FD_LINE_SZ                         512
-#define COLUMN_HEADER_SZ                        256
-#define ROW_VALUE_SZ                            1024
-#define MAX_NUMBER_COLUMNS                      100
-#define MAX_KEY_VALUE_PAIRS                     1024
-
-struct column
-{
-   wchar_t header_name[COLUMN_HEADER_SZ];
-   wchar_t *row_value[ROW_VALUE_SZ];
-   int row_cnt;
-};
-
-struct table
-{
-   wchar_t name[COLUMN_HEADER_SZ];
-   struct column columns[MAX_NUMBER_COLUMNS];
-   int column_cnt;
-};
-
-struct pair
-{
-   wchar_t name[PAIR_NAME_SZ];
-   wchar_t value[PAIR_VALUE_SZ];
-};
-
-struct dict
-{
-   struct pair items[MAX_KEY_VALUE_PAIRS];
-   int item_cnt;
-};
 
 enum OutputType
 {
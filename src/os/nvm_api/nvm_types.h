@@ -250,6 +250,16 @@ enum acpi_event_type
   ACPI_UNCORRECTABLE
 };
 
+/**
+ * One DIMM reported by acpi_event_monitor_wait()
+ */
+struct acpi_event_record
+{
+  void *ctx;                      ///< Context created by acpi_event_create_ctx
+  unsigned int dimm_handle;       ///< NFIT handle of the DIMM that signalled
+  unsigned int triggered_events;  ///< DIMM_ACPI_EVENT_*_MASK bits that fired
+};
+
 #define MAX_ERROR_LOG_SZ 64
 
 /**
@@ -0,0 +1,6 @@
+/*
+ * Copyright (c) 2018, Intel Corporation.
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "AcpiEventMonitor_Tests.h"
@@ -0,0 +1,158 @@
+/*
+ * Copyright (c) 2018, Intel Corporation.
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+#ifndef ACPI_EVENT_MONITOR_TESTS_H
+#define ACPI_EVENT_MONITOR_TESTS_H
+
+#ifdef __linux__
+#include <gtest/gtest.h>
+#include <nvm_management.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <set>
+
+extern "C" {
+#include <lnx_adapter_acpi_events.h>
+}
+
+// Enough fake DIMMs that per-wakeup O(DIMM) work would stand out
+#define ACPI_MON_DIMMS      256
+#define ACPI_MON_RECORDS    16
+
+// Drives the monitor with one eventfd per fake DIMM in place of the sysfs
+// health attribute; writing to the eventfd plays the role of a notification
+class AcpiEventMonitor_Tests : public ::testing::Test
+{
+protected:
+  void *monitor = NULL;
+  int fds[ACPI_MON_DIMMS];
+  void *ctxs[ACPI_MON_DIMMS];
+  struct acpi_event_record records[ACPI_MON_RECORDS];
+  unsigned int record_cnt = 0;
+  enum acpi_get_event_result result = ACPI_EVENT_UNKNOWN_RESULT;
+
+  virtual void SetUp()
+  {
+    ASSERT_EQ(acpi_event_monitor_create(&monitor), NVM_SUCCESS);
+    for (unsigned int i = 0; i < ACPI_MON_DIMMS; i++)
+    {
+      fds[i] = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+      ASSERT_GE(fds[i], 0);
+      ASSERT_EQ(acpi_event_create_ctx_from_fd(0x1000 + i, fds[i], &ctxs[i]), NVM_SUCCESS);
+      ASSERT_EQ(acpi_event_monitor_add(monitor, ctxs[i]), NVM_SUCCESS);
+    }
+  }
+
+  virtual void TearDown()
+  {
+    acpi_event_monitor_free(monitor);
+    for (unsigned int i = 0; i < ACPI_MON_DIMMS; i++)
+    {
+      acpi_event_free_ctx(ctxs[i]);
+      close(fds[i]);
+    }
+  }
+
+  void Signal(unsigned int dimm)
+  {
+    unsigned long long one = 1;
+    ASSERT_EQ(write(fds[dimm], &one, sizeof(one)), (ssize_t)sizeof(one));
+  }
+
+  void Wait(int timeout_ms)
+  {
+    ASSERT_EQ(acpi_event_monitor_wait(monitor, timeout_ms, records, ACPI_MON_RECORDS,
+      &record_cnt, &result), NVM_SUCCESS);
+  }
+};
+
+TEST_F(AcpiEventMonitor_Tests, TimesOutWithoutEvents)
+{
+  Wait(10);
+  EXPECT_EQ(result, ACPI_EVENT_TIMED_OUT_RESULT);
+  EXPECT_EQ(record_cnt, 0u);
+}
+
+TEST_F(AcpiEventMonitor_Tests, ReportsOnlyTheDimmsThatFired)
+{
+  std::set<unsigned int> expected = { 0x1000 + 3, 0x1000 + 77, 0x1000 + 255 };
+  std::set<unsigned int> reported;
+
+  Signal(3);
+  Signal(77);
+  Signal(255);
+  Wait(100);
+
+  ASSERT_EQ(result, ACPI_EVENT_SIGNALLED_RESULT);
+  ASSERT_EQ(record_cnt, 3u);
+  for (unsigned int i = 0; i < record_cnt; i++)
+  {
+    reported.insert(records[i].dimm_handle);
+    EXPECT_EQ(records[i].triggered_events, (unsigned int)DIMM_ACPI_EVENT_SMART_HEALTH_MASK);
+  }
+  EXPECT_EQ(reported, expected);
+
+  enum acpi_event_state state;
+  ASSERT_EQ(acpi_event_get_event_state(ctxs[77], ACPI_SMART_HEALTH, &state), NVM_SUCCESS);
+  EXPECT_EQ(state, ACPI_EVENT_SIGNALLED);
+  ASSERT_EQ(acpi_event_get_event_state(ctxs[78], ACPI_SMART_HEALTH, &state), NVM_SUCCESS);
+  EXPECT_EQ(state, ACPI_EVENT_NOT_SIGNALLED);
+}
+
+TEST_F(AcpiEventMonitor_Tests, FiredDimmsAreRearmed)
+{
+  Signal(10);
+  Wait(100);
+  ASSERT_EQ(result, ACPI_EVENT_SIGNALLED_RESULT);
+  ASSERT_EQ(record_cnt, 1u);
+
+  // consumed by the previous wait, so nothing is pending any more
+  Wait(10);
+  EXPECT_EQ(result, ACPI_EVENT_TIMED_OUT_RESULT);
+
+  enum acpi_event_state state;
+  ASSERT_EQ(acpi_event_get_event_state(ctxs[10], ACPI_SMART_HEALTH, &state), NVM_SUCCESS);
+  EXPECT_EQ(state, ACPI_EVENT_NOT_SIGNALLED);
+
+  Signal(10);
+  Wait(100);
+  ASSERT_EQ(record_cnt, 1u);
+  EXPECT_EQ(records[0].dimm_handle, 0x1000u + 10);
+}
+
+TEST_F(AcpiEventMonitor_Tests, EventsBeyondRecordCapacityAreKept)
+{
+  unsigned int total = 0;
+
+  for (unsigned int i = 0; i < ACPI_MON_RECORDS * 2; i++)
+  {
+    Signal(i * 5);
+  }
+  do
+  {
+    Wait(10);
+    EXPECT_LE(record_cnt, (unsigned int)ACPI_MON_RECORDS);
+    total += record_cnt;
+  } while (result == ACPI_EVENT_SIGNALLED_RESULT);
+
+  EXPECT_EQ(total, (unsigned int)ACPI_MON_RECORDS * 2);
+}
+
+TEST_F(AcpiEventMonitor_Tests, RemovedDimmIsNotReported)
+{
+  ASSERT_EQ(acpi_event_monitor_remove(monitor, ctxs[42]), NVM_SUCCESS);
+  EXPECT_NE(acpi_event_monitor_remove(monitor, ctxs[42]), NVM_SUCCESS);
+
+  Signal(42);
+  Wait(10);
+  EXPECT_EQ(result, ACPI_EVENT_TIMED_OUT_RESULT);
+}
+
+TEST_F(AcpiEventMonitor_Tests, RejectsDuplicateRegistration)
+{
+  EXPECT_NE(acpi_event_monitor_add(monitor, ctxs[0]), NVM_SUCCESS);
+}
+
+#endif // __linux__
+#endif // ACPI_EVENT_MONITOR_TESTS_H
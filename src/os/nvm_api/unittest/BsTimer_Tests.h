@@ -0,0 +1,154 @@
+/*
+ * Copyright (c) 2018, Intel Corporation.
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+#ifndef BS_TIMER_TESTS_H
+#define BS_TIMER_TESTS_H
+
+#ifdef __linux__
+#include <gtest/gtest.h>
+#include <chrono>
+
+extern "C" {
+#include <AutoGen.h>
+#include <os_efi_bs_protocol.h>
+#include <Library/UefiBootServicesTableLib.h>
+}
+
+#define BS_100NS_PER_MS       10000ULL
+// Long enough to never fire during a test, only bounds a broken wait
+#define BS_TIMER_GUARD_MS     10000ULL
+
+// Only lower bounds are checked, a loaded host may wake any timer late
+class BsTimer_Tests : public ::testing::Test
+{
+protected:
+  EFI_EVENT events[2] = { NULL, NULL };
+
+  virtual void SetUp()
+  {
+    init_protocol_bs();
+    for (int i = 0; i < 2; i++)
+    {
+      ASSERT_EQ(gBS->CreateEvent(EVT_TIMER, TPL_CALLBACK, NULL, NULL, &events[i]), EFI_SUCCESS);
+    }
+  }
+
+  virtual void TearDown()
+  {
+    for (int i = 0; i < 2; i++)
+    {
+      if (events[i])
+      {
+        EXPECT_EQ(gBS->CloseEvent(events[i]), EFI_SUCCESS);
+      }
+    }
+  }
+
+  // Milliseconds spent waiting on the given events; Index receives the signaled one
+  double TimedWait(UINTN count, UINTN *p_index)
+  {
+    auto start = std::chrono::steady_clock::now();
+    EXPECT_EQ(gBS->WaitForEvent(count, events, p_index), EFI_SUCCESS);
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(end - start).count();
+  }
+};
+
+TEST_F(BsTimer_Tests, RelativeTimerDoesNotFireEarly)
+{
+  UINTN index = 99;
+
+  ASSERT_EQ(gBS->SetTimer(events[0], TimerRelative, 150 * BS_100NS_PER_MS), EFI_SUCCESS);
+  double elapsed_ms = TimedWait(1, &index);
+
+  EXPECT_EQ(index, 0u);
+  EXPECT_GE(elapsed_ms, 149.0);
+}
+
+TEST_F(BsTimer_Tests, PeriodicTimerFiresEveryPeriod)
+{
+  UINTN index = 99;
+
+  ASSERT_EQ(gBS->SetTimer(events[0], TimerPeriodic, 50 * BS_100NS_PER_MS), EFI_SUCCESS);
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < 6; i++)
+  {
+    TimedWait(1, &index);
+    EXPECT_EQ(index, 0u);
+  }
+  auto end = std::chrono::steady_clock::now();
+  double elapsed_ms = std::chrono::duration<double, std::milli>(end - start).count();
+
+  EXPECT_GE(elapsed_ms, 299.0);
+}
+
+TEST_F(BsTimer_Tests, MixedTimersSignalInDeadlineOrder)
+{
+  UINTN index = 99;
+  int polls = 0;
+
+  // the poll/timeout pattern used for long operations: a periodic poll timer
+  // in slot 0 and an overall relative timeout in slot 1
+  auto start = std::chrono::steady_clock::now();
+  ASSERT_EQ(gBS->SetTimer(events[0], TimerPeriodic, 40 * BS_100NS_PER_MS), EFI_SUCCESS);
+  ASSERT_EQ(gBS->SetTimer(events[1], TimerRelative, 100 * BS_100NS_PER_MS), EFI_SUCCESS);
+
+  TimedWait(2, &index);
+  EXPECT_EQ(index, 0u);
+
+  // polls keep coming until the timeout shows up
+  do
+  {
+    polls++;
+    TimedWait(2, &index);
+  } while (index != 1);
+  auto end = std::chrono::steady_clock::now();
+  double elapsed_ms = std::chrono::duration<double, std::milli>(end - start).count();
+
+  EXPECT_GE(polls, 2);
+  EXPECT_GE(elapsed_ms, 99.0);
+}
+
+TEST_F(BsTimer_Tests, CancelledTimerIsNotSignaled)
+{
+  UINTN index = 99;
+
+  ASSERT_EQ(gBS->SetTimer(events[0], TimerRelative, 10 * BS_100NS_PER_MS), EFI_SUCCESS);
+  ASSERT_EQ(gBS->SetTimer(events[0], TimerCancel, 0), EFI_SUCCESS);
+  ASSERT_EQ(gBS->SetTimer(events[1], TimerRelative, 60 * BS_100NS_PER_MS), EFI_SUCCESS);
+
+  double elapsed_ms = TimedWait(2, &index);
+  EXPECT_EQ(index, 1u);
+  EXPECT_GE(elapsed_ms, 59.0);
+}
+
+TEST_F(BsTimer_Tests, ExpiredEventStaysSignaledUntilWaitedOn)
+{
+  UINTN index = 99;
+
+  ASSERT_EQ(gBS->SetTimer(events[0], TimerRelative, 20 * BS_100NS_PER_MS), EFI_SUCCESS);
+  ASSERT_EQ(gBS->SetTimer(events[1], TimerRelative, 10 * BS_100NS_PER_MS), EFI_SUCCESS);
+
+  TimedWait(1, &index);
+  EXPECT_EQ(index, 0u);
+
+  // events[1] expired while nobody waited on it and must win over the re-armed guard
+  ASSERT_EQ(gBS->SetTimer(events[0], TimerRelative, BS_TIMER_GUARD_MS * BS_100NS_PER_MS), EFI_SUCCESS);
+  TimedWait(2, &index);
+  EXPECT_EQ(index, 1u);
+}
+
+TEST_F(BsTimer_Tests, RejectsForeignEvents)
+{
+  UINTN index = 99;
+  UINT64 not_an_event[4] = { 0 };
+  EFI_EVENT foreign[1] = { not_an_event };
+
+  EXPECT_NE(gBS->SetTimer(not_an_event, TimerRelative, 1), EFI_SUCCESS);
+  EXPECT_NE(gBS->WaitForEvent(1, foreign, &index), EFI_SUCCESS);
+  EXPECT_NE(gBS->WaitForEvent(0, events, &index), EFI_SUCCESS);
+}
+
+#endif // __linux__
+#endif // BS_TIMER_TESTS_H
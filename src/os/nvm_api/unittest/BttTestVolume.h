@@ -0,0 +1,192 @@
+/*
+ * Copyright (c) 2018, Intel Corporation.
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+#ifndef BTT_TEST_VOLUME_H
+#define BTT_TEST_VOLUME_H
+
+#include <atomic>
+#include <random>
+#include <thread>
+#include <vector>
+#include <string.h>
+#include <limits.h>
+
+extern "C" {
+#include <AutoGen.h>
+#include <Btt.h>
+}
+
+#define BTT_TEST_RAW_SIZE         (32ull << 20)
+#define BTT_TEST_LBA_SIZE         4096
+#define BTT_TEST_LBAS             4096
+#define BTT_TEST_THREADS          8
+
+// Memory-backed namespace. Once the write budget runs out every write is
+// lost, as if the power failed right there.
+struct fake_namespace
+{
+  std::vector<unsigned char> media;
+  std::atomic<long long> write_budget;
+};
+
+static EFI_STATUS fake_ns_read(VOID *p_namespace, UINT64 offset, VOID *p_buffer, UINT64 length)
+{
+  fake_namespace *p_ns = (fake_namespace *)p_namespace;
+  memcpy(p_buffer, p_ns->media.data() + offset, length);
+  return EFI_SUCCESS;
+}
+
+static EFI_STATUS fake_ns_write(VOID *p_namespace, UINT64 offset, VOID *p_buffer, UINT64 length)
+{
+  fake_namespace *p_ns = (fake_namespace *)p_namespace;
+  if (p_ns->write_budget.fetch_sub(1) <= 0)
+  {
+    return EFI_DEVICE_ERROR;
+  }
+  memcpy(p_ns->media.data() + offset, p_buffer, length);
+  return EFI_SUCCESS;
+}
+
+static const BTT_IO_BACKEND g_fake_ns_io = { fake_ns_read, fake_ns_write };
+
+// A BTT over a fake namespace, shared by the tests and the benchmark
+class BttTestVolume
+{
+public:
+  fake_namespace ns;
+  GUID parent_uuid = { 0x42, 0x54, 0x54 };
+  BTT *p_btt = NULL;
+
+  BttTestVolume()
+  {
+    ns.media.assign(BTT_TEST_RAW_SIZE, 0);
+    ns.write_budget = LLONG_MAX;
+  }
+
+  ~BttTestVolume()
+  {
+    Close();
+  }
+
+  bool Open()
+  {
+    p_btt = BttOpen(BTT_TEST_RAW_SIZE, BTT_TEST_LBA_SIZE, &parent_uuid, 0, &ns, &g_fake_ns_io);
+    return p_btt != NULL;
+  }
+
+  void Close()
+  {
+    if (p_btt)
+    {
+      BttRelease(p_btt);
+      p_btt = NULL;
+    }
+  }
+
+  // Power cycle: drop the run-time state and recover from the media
+  bool Reopen()
+  {
+    Close();
+    ns.write_budget = LLONG_MAX;
+    return Open();
+  }
+
+  // A block holds its LBA and version, then a fill derived from both
+  static void FillBlock(std::vector<unsigned char> &block, unsigned long long lba, unsigned long long version)
+  {
+    block.resize(BTT_TEST_LBA_SIZE);
+    memcpy(&block[0], &lba, sizeof(lba));
+    memcpy(&block[8], &version, sizeof(version));
+    memset(&block[16], (int)((lba * 31 + version) & 0xff), BTT_TEST_LBA_SIZE - 16);
+  }
+
+  // Returns the version of a consistent block of that LBA, -1 if torn or misplaced
+  static long long BlockVersion(const std::vector<unsigned char> &block, unsigned long long lba)
+  {
+    unsigned long long stamp_lba = 0;
+    unsigned long long version = 0;
+    memcpy(&stamp_lba, &block[0], sizeof(stamp_lba));
+    memcpy(&version, &block[8], sizeof(version));
+    if (stamp_lba != lba)
+    {
+      return -1;
+    }
+    for (unsigned int i = 16; i < BTT_TEST_LBA_SIZE; i++)
+    {
+      if (block[i] != (unsigned char)((lba * 31 + version) & 0xff))
+      {
+        return -1;
+      }
+    }
+    return (long long)version;
+  }
+
+  bool WriteAll(unsigned long long version)
+  {
+    std::vector<unsigned char> block;
+    for (unsigned long long lba = 0; lba < BTT_TEST_LBAS; lba++)
+    {
+      FillBlock(block, lba, version);
+      if (EFI_SUCCESS != BttWrite(p_btt, lba, block.data()))
+      {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // Random 4 KiB I/Os, each thread writing its own LBAs and reading any
+  void RunThreads(unsigned int threads, unsigned int ops, std::vector<unsigned long long> &versions,
+    std::atomic<unsigned int> &errors)
+  {
+    std::vector<std::thread> workers;
+    for (unsigned int t = 0; t < threads; t++)
+    {
+      workers.push_back(std::thread([&, t]()
+      {
+        std::mt19937 rng(t + 1);
+        std::vector<unsigned char> block(BTT_TEST_LBA_SIZE);
+        for (unsigned int i = 0; i < ops; i++)
+        {
+          unsigned long long lba = rng() % BTT_TEST_LBAS;
+          if (i & 1)
+          {
+            lba -= lba % threads;
+            lba += t;
+            if (lba >= BTT_TEST_LBAS)
+            {
+              continue;
+            }
+            FillBlock(block, lba, versions[lba] + 1);
+            if (BttWrite(p_btt, lba, block.data()) != EFI_SUCCESS)
+            {
+              errors++;
+              continue;
+            }
+            versions[lba]++;
+          }
+          else
+          {
+            long long version = -1;
+            if (BttRead(p_btt, lba, block.data()) == EFI_SUCCESS)
+            {
+              version = BlockVersion(block, lba);
+            }
+            // Other threads' LBAs may have moved on, own LBAs must be exact
+            if (version < 0 || (lba % threads == t && (unsigned long long)version != versions[lba]))
+            {
+              errors++;
+            }
+          }
+        }
+      }));
+    }
+    for (auto &worker : workers)
+    {
+      worker.join();
+    }
+  }
+};
+
+#endif // BTT_TEST_VOLUME_H
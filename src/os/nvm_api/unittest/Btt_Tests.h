@@ -0,0 +1,109 @@
+/*
+ * Copyright (c) 2018, Intel Corporation.
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+#ifndef BTT_TESTS_H
+#define BTT_TESTS_H
+
+#ifdef __linux__
+#include <gtest/gtest.h>
+#include <atomic>
+#include <random>
+#include <vector>
+#include "BttTestVolume.h"
+
+#define BTT_TEST_STRESS_OPS       4000
+#define BTT_TEST_CRASH_TRIALS     32
+
+class Btt_Tests : public ::testing::Test, public BttTestVolume
+{
+protected:
+  virtual void SetUp()
+  {
+    ASSERT_TRUE(Open());
+  }
+
+  virtual void TearDown()
+  {
+    Close();
+  }
+};
+
+TEST_F(Btt_Tests, BlocksSurviveReopen)
+{
+  std::vector<unsigned char> block(BTT_TEST_LBA_SIZE);
+
+  // Nothing laid out yet, reads return zeros
+  ASSERT_EQ(EFI_SUCCESS, BttRead(p_btt, 7, block.data()));
+  EXPECT_EQ(std::vector<unsigned char>(BTT_TEST_LBA_SIZE, 0), block);
+
+  ASSERT_TRUE(WriteAll(1));
+  ASSERT_TRUE(WriteAll(2));
+  EXPECT_EQ(EFI_SUCCESS, BttCheck(p_btt));
+
+  ASSERT_TRUE(Reopen());
+  EXPECT_EQ(EFI_SUCCESS, BttCheck(p_btt));
+  for (unsigned long long lba = 0; lba < BTT_TEST_LBAS; lba++)
+  {
+    ASSERT_EQ(EFI_SUCCESS, BttRead(p_btt, lba, block.data()));
+    ASSERT_EQ(2, BlockVersion(block, lba));
+  }
+}
+
+TEST_F(Btt_Tests, ConcurrentLanesStress)
+{
+  std::vector<unsigned long long> versions(BTT_TEST_LBAS, 1);
+  std::atomic<unsigned int> errors(0);
+
+  ASSERT_TRUE(WriteAll(1));
+  RunThreads(BTT_TEST_THREADS, BTT_TEST_STRESS_OPS, versions, errors);
+  EXPECT_EQ(0u, errors.load());
+  EXPECT_EQ(EFI_SUCCESS, BttCheck(p_btt));
+
+  ASSERT_TRUE(Reopen());
+  std::vector<unsigned char> block(BTT_TEST_LBA_SIZE);
+  for (unsigned long long lba = 0; lba < BTT_TEST_LBAS; lba++)
+  {
+    ASSERT_EQ(EFI_SUCCESS, BttRead(p_btt, lba, block.data()));
+    ASSERT_EQ((long long)versions[lba], BlockVersion(block, lba));
+  }
+}
+
+TEST_F(Btt_Tests, ConsistentAfterInterruptedWrites)
+{
+  std::mt19937 rng(2018);
+  std::vector<unsigned char> block(BTT_TEST_LBA_SIZE);
+
+  ASSERT_TRUE(WriteAll(1));
+  for (unsigned int trial = 0; trial < BTT_TEST_CRASH_TRIALS; trial++)
+  {
+    std::vector<unsigned long long> versions(BTT_TEST_LBAS);
+    std::atomic<unsigned int> errors(0);
+
+    // Versions acknowledged so far, the interrupted write may land or not
+    for (unsigned long long lba = 0; lba < BTT_TEST_LBAS; lba++)
+    {
+      ASSERT_EQ(EFI_SUCCESS, BttRead(p_btt, lba, block.data()));
+      versions[lba] = BlockVersion(block, lba);
+    }
+    std::vector<unsigned long long> acked = versions;
+
+    // Lose power after a random number of media writes
+    ns.write_budget = rng() % 20000;
+    RunThreads(BTT_TEST_THREADS, BTT_TEST_STRESS_OPS, versions, errors);
+    ASSERT_TRUE(Reopen());
+
+    ASSERT_EQ(EFI_SUCCESS, BttCheck(p_btt)) << "trial " << trial;
+    for (unsigned long long lba = 0; lba < BTT_TEST_LBAS; lba++)
+    {
+      ASSERT_EQ(EFI_SUCCESS, BttRead(p_btt, lba, block.data()));
+      long long version = BlockVersion(block, lba);
+      ASSERT_TRUE(version == (long long)versions[lba] || version == (long long)versions[lba] + 1)
+        << "trial " << trial << " lba " << lba << " version " << version
+        << " acknowledged " << versions[lba] << " before " << acked[lba];
+    }
+  }
+}
+#endif // __linux__
+
+#endif // BTT_TESTS_H
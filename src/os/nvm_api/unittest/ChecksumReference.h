@@ -0,0 +1,64 @@
+/*
+ * Copyright (c) 2018, Intel Corporation.
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+#ifndef CHECKSUM_REFERENCE_H
+#define CHECKSUM_REFERENCE_H
+
+#include <stddef.h>
+#include <string.h>
+
+extern "C" {
+#include <AutoGen.h>
+#include <Checksum.h>
+}
+
+static const char *g_checksum_kernel_names[ChecksumKernelMax] = { "auto", "portable", "sse2", "avx2" };
+
+// Byte and word at a time loops the checksum kernels replaced, shared by the
+// tests and the benchmark
+// The word at a time Fletcher64 ChecksumOperations used to compute
+static unsigned long long reference_fletcher64(const unsigned char *p_data, size_t length, size_t checksum_offset)
+{
+  unsigned int lo32 = 0;
+  unsigned int hi32 = 0;
+  for (size_t i = 0; i < length; i += 4)
+  {
+    if (i == checksum_offset)
+    {
+      hi32 += lo32;
+      hi32 += lo32;
+      i += 4;
+      continue;
+    }
+    unsigned int word;
+    memcpy(&word, p_data + i, sizeof(word));
+    lo32 += word;
+    hi32 += lo32;
+  }
+  return (unsigned long long)hi32 << 32 | lo32;
+}
+
+// The byte at a time loop of RunningChecksum
+static unsigned int reference_running_checksum(const unsigned char *p_data, unsigned int length, unsigned int csum)
+{
+  csum = ~csum + 1;
+  for (unsigned int i = 0; i < length; i++)
+  {
+    csum = csum + p_data[i] * (1 << (8 * (i % 4)));
+  }
+  return ~csum + 1;
+}
+
+// The byte at a time loop of GenerateChecksum
+static unsigned char reference_byte_checksum(const unsigned char *p_data, unsigned int length, unsigned int checksum_offset)
+{
+  unsigned char sum = 0;
+  for (unsigned int i = 0; i < length; i++)
+  {
+    sum += (i == checksum_offset) ? 0 : p_data[i];
+  }
+  return (unsigned char)(0xff - sum + 1);
+}
+
+#endif // CHECKSUM_REFERENCE_H
@@ -0,0 +1,151 @@
+/*
+ * Copyright (c) 2018, Intel Corporation.
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+#ifndef CHECKSUM_TESTS_H
+#define CHECKSUM_TESTS_H
+
+#ifdef __linux__
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <random>
+#include <vector>
+#include <string.h>
+#include "ChecksumReference.h"
+
+extern "C" {
+#include <Utility.h>
+#include <FwUtility.h>
+#include <PlatformConfigData.h>
+}
+
+#define CHECKSUM_TEST_MAX_LENGTH    8192
+#define CHECKSUM_TEST_ROUNDS        2000
+
+class Checksum_Tests : public ::testing::Test
+{
+protected:
+  std::mt19937 rng;
+  std::vector<unsigned char> buffer;
+  std::vector<CHECKSUM_KERNEL> kernels;
+
+  virtual void SetUp()
+  {
+    rng.seed(2018);
+    buffer.resize(CHECKSUM_TEST_MAX_LENGTH + 64);
+    for (auto &byte : buffer)
+    {
+      byte = (unsigned char)rng();
+    }
+    for (int kernel = ChecksumKernelPortable; kernel < ChecksumKernelMax; kernel++)
+    {
+      if (ChecksumSelectKernel((CHECKSUM_KERNEL)kernel) == EFI_SUCCESS)
+      {
+        kernels.push_back((CHECKSUM_KERNEL)kernel);
+      }
+    }
+  }
+
+  virtual void TearDown()
+  {
+    ChecksumSelectKernel(ChecksumKernelAuto);
+  }
+};
+
+TEST_F(Checksum_Tests, ChecksumOperationsBitExact)
+{
+  ASSERT_FALSE(kernels.empty());
+  for (CHECKSUM_KERNEL kernel : kernels)
+  {
+    ASSERT_EQ(EFI_SUCCESS, ChecksumSelectKernel(kernel));
+    for (int round = 0; round < CHECKSUM_TEST_ROUNDS; round++)
+    {
+      size_t align = rng() % 4;
+      size_t length = (rng() % (CHECKSUM_TEST_MAX_LENGTH / 4) + 1) * 4;
+      // The field anywhere in the area, including half past its end, or outside of it
+      size_t checksum_offset = (rng() % (length / 4 + 2)) * 4;
+      unsigned char *p_data = buffer.data() + align;
+      std::vector<unsigned char> saved(p_data, p_data + length + 8);
+      unsigned long long expected = reference_fletcher64(p_data, length, checksum_offset);
+      UINT64 *p_checksum = (UINT64 *)(p_data + checksum_offset);
+
+      ASSERT_TRUE(ChecksumOperations(p_data, length, p_checksum, 1));
+      unsigned long long inserted = 0;
+      memcpy(&inserted, p_checksum, sizeof(inserted));
+      if (checksum_offset < length)
+      {
+        ASSERT_EQ(expected, inserted) << g_checksum_kernel_names[kernel] << " length " << length
+          << " align " << align << " checksum at " << checksum_offset;
+        ASSERT_TRUE(ChecksumOperations(p_data, length, p_checksum, 0));
+        // Any flipped bit outside of the field changes the low sum
+        size_t flipped = rng() % length;
+        if (flipped < checksum_offset || flipped >= checksum_offset + 8)
+        {
+          p_data[flipped] ^= 1 << (rng() % 8);
+          ASSERT_FALSE(ChecksumOperations(p_data, length, p_checksum, 0));
+        }
+      }
+      memcpy(p_data, saved.data(), saved.size());
+    }
+  }
+}
+
+TEST_F(Checksum_Tests, StreamingMatchesOneShot)
+{
+  for (CHECKSUM_KERNEL kernel : kernels)
+  {
+    ASSERT_EQ(EFI_SUCCESS, ChecksumSelectKernel(kernel));
+    for (int round = 0; round < CHECKSUM_TEST_ROUNDS; round++)
+    {
+      size_t align = rng() % 8;
+      size_t length = rng() % CHECKSUM_TEST_MAX_LENGTH;
+      const unsigned char *p_data = buffer.data() + align;
+
+      // Reference with the last partial word padded with zeros
+      std::vector<unsigned char> padded(p_data, p_data + length);
+      padded.resize((length + 3) / 4 * 4, 0);
+      unsigned long long expected = reference_fletcher64(padded.data(), padded.size(), (size_t)-1);
+
+      FLETCHER64_CONTEXT context;
+      Fletcher64Init(&context);
+      for (size_t done = 0; done < length;)
+      {
+        size_t piece = rng() % 3 ? rng() % 8 : rng() % 1024;
+        piece = std::min(piece, length - done);
+        Fletcher64Update(&context, p_data + done, piece);
+        done += piece;
+      }
+      ASSERT_EQ(expected, Fletcher64Final(&context)) << g_checksum_kernel_names[kernel] << " length " << length;
+      ASSERT_EQ((unsigned int)expected, ChecksumSum32(p_data, length));
+    }
+  }
+}
+
+TEST_F(Checksum_Tests, ByteChecksumsBitExact)
+{
+  for (CHECKSUM_KERNEL kernel : kernels)
+  {
+    ASSERT_EQ(EFI_SUCCESS, ChecksumSelectKernel(kernel));
+    for (int round = 0; round < CHECKSUM_TEST_ROUNDS; round++)
+    {
+      unsigned int align = rng() % 32;
+      unsigned int length = rng() % CHECKSUM_TEST_MAX_LENGTH + 1;
+      unsigned int checksum_offset = rng() % length;
+      unsigned int csum = rng();
+      unsigned char *p_data = buffer.data() + align;
+
+      ASSERT_EQ(reference_running_checksum(p_data, length, csum), RunningChecksum(p_data, length, csum))
+        << g_checksum_kernel_names[kernel] << " length " << length;
+
+      unsigned char expected = reference_byte_checksum(p_data, length, checksum_offset);
+      GenerateChecksum(p_data, length, checksum_offset);
+      ASSERT_EQ(expected, p_data[checksum_offset]) << g_checksum_kernel_names[kernel] << " length " << length;
+      ASSERT_TRUE(IsChecksumValid(p_data, length));
+      p_data[checksum_offset]++;
+      ASSERT_FALSE(IsChecksumValid(p_data, length));
+    }
+  }
+}
+#endif // __linux__
+
+#endif // CHECKSUM_TESTS_H
@@ -0,0 +1,247 @@
+/*
+ * Copyright (c) 2018, Intel Corporation.
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+#ifndef CLI_OUTPUT_HARNESS_H
+#define CLI_OUTPUT_HARNESS_H
+
+#include <gtest/gtest.h>
+#include <nvm_management.h>
+#include <algorithm>
+#include <fstream>
+#include <functional>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+// Directory of recorded PBR sessions (*.pbr), their golden files live next to them
+#define CLI_OUTPUT_CORPUS_ENV       "IPMCTL_PBR_CORPUS"
+// Set to rewrite the golden files from the current output instead of comparing
+#define CLI_OUTPUT_UPDATE_ENV       "IPMCTL_UPDATE_GOLDEN"
+// ipmctl executable that writes the golden files instead of the library under test,
+// e.g. a build of the release whose output has to be kept
+#define CLI_OUTPUT_GOLDEN_CLI_ENV   "IPMCTL_GOLDEN_CLI"
+// Stands for the library version in the golden files
+#define CLI_OUTPUT_VERSION_MARK     "@VERSION@"
+
+// Golden files of the commands that do not depend on the PMem modules of the host
+#ifndef CLI_OUTPUT_GOLDEN_DIR
+#define CLI_OUTPUT_GOLDEN_DIR       "src/os/nvm_api/unittest/cli_output"
+#endif
+
+// A command line, with its golden file name (without the format suffix)
+struct cli_command
+{
+  const char *p_name;
+  const char *p_verb;
+  const char *p_options;
+  const char *p_targets;
+};
+
+// Commands whose output does not depend on the PMem modules of the host
+static const cli_command g_cli_host_commands[] = {
+  { "version", "version", "", "" },
+  { "version_help", "version", "-help", "" },
+  { "syntax_error", "version", "", "-nosuchtarget" },
+};
+
+// show commands that build a DataSet, run against the recorded sessions
+static const cli_command g_cli_show_commands[] = {
+  { "dimm", "show", "-a", "-dimm" },
+  { "topology", "show", "", "-topology" },
+  { "memoryresources", "show", "", "-memoryresources" },
+  { "region", "show", "-a", "-region" },
+  { "sensor", "show", "", "-sensor" },
+  { "socket", "show", "", "-socket" },
+  { "capabilities", "show", "", "-system -capabilities" },
+  { "goal", "show", "", "-goal" },
+  { "firmware", "show", "", "-dimm -firmware" },
+  { "performance", "show", "", "-dimm -performance" },
+  { "preferences", "show", "", "-preferences" },
+};
+
+// Runs CLI commands and compares their output with golden files, shared by the output format suites
+class CliOutputHarness
+{
+public:
+  std::string corpus;
+  std::vector<std::string> sessions;
+
+  // Find the recorded sessions of the corpus, false when there are none
+  bool LoadSessions()
+  {
+    const char *p_corpus = getenv(CLI_OUTPUT_CORPUS_ENV);
+    if (NULL == p_corpus)
+    {
+      return false;
+    }
+    corpus = p_corpus;
+    DIR *p_dir = opendir(p_corpus);
+    if (NULL == p_dir)
+    {
+      return false;
+    }
+    struct dirent *p_entry;
+    while (NULL != (p_entry = readdir(p_dir)))
+    {
+      std::string name = p_entry->d_name;
+      if (name.size() > 4 && name.compare(name.size() - 4, 4, ".pbr") == 0)
+      {
+        sessions.push_back(name.substr(0, name.size() - 4));
+      }
+    }
+    closedir(p_dir);
+    std::sort(sessions.begin(), sessions.end());
+    return !sessions.empty();
+  }
+
+  // Run body in a child process with stdout going to a file, returning what it printed.
+  // The CLI prints wide characters, which a stdout gtest already wrote narrow text to would drop,
+  // and each command runs in a process of its own like the ipmctl executable.
+  std::string RunCaptured(const std::function<int()> &body, int *p_rc = NULL)
+  {
+    char capture_path[] = "/tmp/ipmctl_cli_output_XXXXXX";
+    int capture_fd = mkstemp(capture_path);
+    EXPECT_GE(capture_fd, 0);
+    if (capture_fd < 0)
+    {
+      return "";
+    }
+    close(capture_fd);
+
+    fflush(stdout);
+    fflush(stderr);
+    pid_t pid = fork();
+    if (0 == pid)
+    {
+      int rc = 255;
+      if (NULL != freopen(capture_path, "w", stdout))
+      {
+        rc = body();
+        fflush(stdout);
+      }
+      _exit(rc & 0xFF);
+    }
+
+    int status = 0;
+    EXPECT_GT(pid, 0);
+    if (pid > 0)
+    {
+      EXPECT_EQ(pid, waitpid(pid, &status, 0));
+      EXPECT_TRUE(WIFEXITED(status)) << "the command did not exit, status " << status;
+    }
+    if (NULL != p_rc)
+    {
+      *p_rc = WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+    }
+
+    std::ifstream captured(capture_path);
+    std::stringstream text;
+    text << captured.rdbuf();
+    remove(capture_path);
+    return text.str();
+  }
+
+  // Run "ipmctl <verb> [-o <format>] <options> <targets>", returning what it printed.
+  // The library version in the output is replaced by CLI_OUTPUT_VERSION_MARK.
+  std::string RunCli(const std::string &verb, const std::string &options, const std::string &targets,
+    const char *p_format = NULL, int *p_rc = NULL)
+  {
+    std::vector<std::string> words;
+    std::istringstream stream(verb + " " + (p_format ? std::string("-o ") + p_format : "") + " " + options + " " + targets);
+    std::string word;
+    std::vector<char *> argv;
+    const char *p_golden_cli = getenv(CLI_OUTPUT_GOLDEN_CLI_ENV);
+    bool update = NULL != getenv(CLI_OUTPUT_UPDATE_ENV) && NULL != p_golden_cli;
+
+    words.push_back(update ? p_golden_cli : "ipmctl");
+    while (stream >> word)
+    {
+      words.push_back(word);
+    }
+    for (auto &w : words)
+    {
+      argv.push_back(&w[0]);
+    }
+    argv.push_back(NULL);
+
+    std::string output = RunCaptured([&]() {
+      if (update)
+      {
+        execv(argv[0], argv.data());
+        return 255;
+      }
+      return nvm_run_cli((int)words.size(), argv.data());
+    }, p_rc);
+
+    NVM_VERSION version;
+    if (NVM_SUCCESS == nvm_get_version(version, sizeof(version)) && '\0' != version[0])
+    {
+      size_t pos = 0;
+      while (std::string::npos != (pos = output.find(version, pos)))
+      {
+        output.replace(pos, strlen(version), CLI_OUTPUT_VERSION_MARK);
+        pos += strlen(CLI_OUTPUT_VERSION_MARK);
+      }
+    }
+    return output;
+  }
+
+  std::string RunCli(const cli_command &cmd, const char *p_format = NULL, int *p_rc = NULL)
+  {
+    return RunCli(cmd.p_verb, cmd.p_options, cmd.p_targets, p_format, p_rc);
+  }
+
+  // Load a recorded session and play it back to the commands that follow
+  bool StartSession(const std::string &session)
+  {
+    int rc = 0;
+    RunCli("load", "-source " + corpus + "/" + session + ".pbr", "-session", NULL, &rc);
+    if (0 != rc)
+    {
+      return false;
+    }
+    RunCli("start", "-f", "-session -mode playback_manual", NULL, &rc);
+    return 0 == rc;
+  }
+
+  void StopSession()
+  {
+    RunCli("stop", "-f", "-session");
+  }
+
+  // Golden file of a host independent command
+  static std::string GoldenPath(const cli_command &cmd, const char *p_suffix)
+  {
+    return std::string(CLI_OUTPUT_GOLDEN_DIR) + "/" + cmd.p_name + "." + p_suffix;
+  }
+
+  // Golden file of a command played back from a recorded session
+  std::string GoldenPath(const std::string &session, const cli_command &cmd, const char *p_suffix)
+  {
+    return corpus + "/" + session + "." + cmd.p_name + "." + p_suffix;
+  }
+
+  void CompareWithGolden(const std::string &golden_path, const std::string &output)
+  {
+    if (NULL != getenv(CLI_OUTPUT_UPDATE_ENV))
+    {
+      std::ofstream golden(golden_path);
+      golden << output;
+      return;
+    }
+    std::ifstream golden(golden_path);
+    ASSERT_TRUE(golden.good()) << "missing golden file " << golden_path;
+    std::stringstream expected;
+    expected << golden.rdbuf();
+    EXPECT_EQ(expected.str(), output) << golden_path;
+  }
+};
+
+#endif // CLI_OUTPUT_HARNESS_H
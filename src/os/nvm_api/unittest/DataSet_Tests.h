@@ -0,0 +1,165 @@
+/*
+ * Copyright (c) 2018, Intel Corporation.
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+#ifndef DATA_SET_TESTS_H
+#define DATA_SET_TESTS_H
+
+#ifdef __linux__
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+
+extern "C" {
+#include <AutoGen.h>
+#include <DataSet.h>
+}
+
+#define DATA_SET_TEST_CHILDREN      1000
+#define DATA_SET_TEST_KEYS          64
+
+static std::wstring key_string(DATA_SET_CONTEXT *p_data_set, const CHAR16 *p_key)
+{
+  CHAR16 *p_val = NULL;
+  GetKeyValueWideStr(p_data_set, p_key, &p_val, (CHAR16 *)L"<none>");
+  return p_val ? p_val : L"<null>";
+}
+
+class DataSet_Tests : public ::testing::Test
+{
+protected:
+  DATA_SET_CONTEXT *p_root = NULL;
+
+  virtual void SetUp()
+  {
+    p_root = CreateDataSet(NULL, (CHAR16 *)L"Root", NULL);
+    ASSERT_NE((void *)NULL, p_root);
+  }
+
+  virtual void TearDown()
+  {
+    FreeDataSet(p_root);
+  }
+};
+
+TEST_F(DataSet_Tests, PathsFindTheSameNodes)
+{
+  std::vector<DATA_SET_CONTEXT *> items;
+  for (int i = 0; i < DATA_SET_TEST_CHILDREN; i++)
+  {
+    // Other names in between, instances count per name
+    GetDataSet(p_root, (CHAR16 *)L"/Root/List/Other[%d]", i);
+    items.push_back(GetDataSet(p_root, (CHAR16 *)L"/Root/List/Item[%d]", i));
+    ASSERT_NE((void *)NULL, items.back());
+  }
+  for (int i = DATA_SET_TEST_CHILDREN - 1; i >= 0; i--)
+  {
+    ASSERT_EQ(items[i], GetDataSet(p_root, (CHAR16 *)L"/Root/List/Item[%d]", i));
+  }
+
+  // Children keep their order, items and others alternating
+  DATA_SET_CONTEXT *p_list = GetDataSet(p_root, (CHAR16 *)L"/Root/List");
+  DATA_SET_CONTEXT *p_child = NULL;
+  int count = 0;
+  while (NULL != (p_child = GetNextChildDataSet(p_list, p_child)))
+  {
+    EXPECT_STREQ(count % 2 ? L"Item" : L"Other", GetDataSetName(p_child));
+    if (count % 2)
+    {
+      EXPECT_EQ(items[count / 2], p_child);
+    }
+    count++;
+  }
+  EXPECT_EQ(2 * DATA_SET_TEST_CHILDREN, count);
+
+  // Children are also found by name and instance without a path
+  EXPECT_EQ(items[0], GetChildDataSet(p_list, (CHAR16 *)L"Item", 0));
+  EXPECT_EQ(items[DATA_SET_TEST_CHILDREN - 1], GetChildDataSet(p_list, (CHAR16 *)L"Item", DATA_SET_TEST_CHILDREN - 1));
+  EXPECT_EQ((void *)NULL, GetChildDataSet(p_list, (CHAR16 *)L"Item", DATA_SET_TEST_CHILDREN));
+  EXPECT_EQ((void *)NULL, GetChildDataSet(p_list, (CHAR16 *)L"Missing", 0));
+
+  // A missing instance brings the ones before it
+  DATA_SET_CONTEXT *p_gap = GetDataSet(p_root, (CHAR16 *)L"/Root/Gap[3]");
+  EXPECT_EQ(p_gap, GetDataSet(p_root, (CHAR16 *)L"/Root/Gap[3]"));
+  EXPECT_NE(p_gap, GetDataSet(p_root, (CHAR16 *)L"/Root/Gap[2]"));
+  EXPECT_EQ(p_gap, GetDataSet(p_root, (CHAR16 *)L"/Root/Gap[3]"));
+
+  // The path has to start at the root
+  EXPECT_EQ((void *)NULL, GetDataSet(p_root, (CHAR16 *)L"/NotRoot/List"));
+
+  // Paths longer than the formatting buffer
+  std::wstring long_name(400, L'x');
+  DATA_SET_CONTEXT *p_long = GetDataSet(p_root, (CHAR16 *)L"/Root/%ls[1]", long_name.c_str());
+  ASSERT_NE((void *)NULL, p_long);
+  EXPECT_EQ(long_name, GetDataSetName(p_long));
+  EXPECT_EQ(p_long, GetDataSet(p_root, (CHAR16 *)L"/Root/%ls[1]", long_name.c_str()));
+}
+
+TEST_F(DataSet_Tests, FreedAndRenamedChildrenLeaveTheIndex)
+{
+  for (int i = 0; i < DATA_SET_TEST_CHILDREN; i++)
+  {
+    SetKeyValueUint32(GetDataSet(p_root, (CHAR16 *)L"/Root/Item[%d]", i), L"Index", i, DECIMAL);
+  }
+
+  FreeDataSet(GetDataSet(p_root, (CHAR16 *)L"/Root/Item[10]"));
+  EXPECT_EQ(L"11", key_string(GetDataSet(p_root, (CHAR16 *)L"/Root/Item[10]"), L"Index"));
+  EXPECT_EQ(L"999", key_string(GetDataSet(p_root, (CHAR16 *)L"/Root/Item[998]"), L"Index"));
+
+  SetDataSetName(GetDataSet(p_root, (CHAR16 *)L"/Root/Item[0]"), (CHAR16 *)L"First");
+  EXPECT_EQ(L"0", key_string(GetDataSet(p_root, (CHAR16 *)L"/Root/First"), L"Index"));
+  EXPECT_EQ(L"1", key_string(GetDataSet(p_root, (CHAR16 *)L"/Root/Item[0]"), L"Index"));
+}
+
+TEST_F(DataSet_Tests, KeysKeepOrderAndFormatOnDemand)
+{
+  DATA_SET_CONTEXT *p_node = GetDataSet(p_root, (CHAR16 *)L"/Root/Node");
+  EXPECT_FALSE(IsDirty(p_root));
+
+  for (int i = 0; i < DATA_SET_TEST_KEYS; i++)
+  {
+    std::wstring key = L"Key" + std::to_wstring(i);
+    ASSERT_EQ(EFI_SUCCESS, SetKeyValueUint64(p_node, key.c_str(), i, DECIMAL));
+  }
+  EXPECT_TRUE(IsDirty(p_root));
+  EXPECT_EQ((UINT32)DATA_SET_TEST_KEYS, GetKeyCount(p_node));
+
+  // Overwriting keeps the position and may change the type
+  SetKeyValueWideStr(p_node, L"Key3", L"three");
+  SetKeyValueUint64(p_node, L"Key4", 0x1234, HEX);
+  SetKeyValueUint8(p_node, L"Key5", 0xab, HEX);
+  SetKeyValueInt8(p_node, L"Key6", -5, DECIMAL);
+  SetKeyValueBool(p_node, L"Key7", TRUE);
+  SetKeyValueUint32(p_node, L"Key8", 42, DECIMAL);
+  EXPECT_EQ((UINT32)DATA_SET_TEST_KEYS, GetKeyCount(p_node));
+
+  int i = 0;
+  KEY_VAL_INFO *p_info = NULL;
+  while (NULL != (p_info = GetNextKey(p_node, p_info)))
+  {
+    EXPECT_EQ(L"Key" + std::to_wstring(i), p_info->Key);
+    i++;
+  }
+  EXPECT_EQ(DATA_SET_TEST_KEYS, i);
+
+  EXPECT_EQ(L"2", key_string(p_node, L"Key2"));
+  EXPECT_EQ(L"three", key_string(p_node, L"Key3"));
+  EXPECT_EQ(L"0x0000000000001234", key_string(p_node, L"Key4"));
+  EXPECT_EQ(L"0xab", key_string(p_node, L"Key5"));
+  EXPECT_EQ(L"-5", key_string(p_node, L"Key6"));
+  EXPECT_EQ(L"True", key_string(p_node, L"Key7"));
+  EXPECT_EQ(L"42", key_string(p_node, L"Key8"));
+  EXPECT_EQ(L"<none>", key_string(p_node, L"Missing"));
+
+  // A new value drops the string of the previous one
+  SetKeyValueUint64(p_node, L"Key2", 20, DECIMAL);
+  EXPECT_EQ(L"20", key_string(p_node, L"Key2"));
+  UINT64 value = 0;
+  UINT64 def = 0;
+  GetKeyValueUint64(p_node, L"Key4", &value, &def);
+  EXPECT_EQ(0x1234ull, value);
+}
+
+#endif // __linux__
+
+#endif // DATA_SET_TESTS_H
@@ -0,0 +1,158 @@
+/*
+ * Copyright (c) 2018, Intel Corporation.
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+#ifndef DEBUG_LOG_TESTS_H
+#define DEBUG_LOG_TESTS_H
+
+#ifdef __linux__
+#include <gtest/gtest.h>
+#include <nvm_management.h>
+#include <string>
+#include <vector>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+#define DBG_LOG_TEST_RING_FILE      "debug_log_test.bin"
+#define DBG_LOG_TEST_DECODED_FILE   "debug_log_test.txt"
+#define DBG_LOG_TEST_RING_SIZE      (64 * 1024)
+#define DBG_LOG_TEST_LEVEL          OS_DEBUG_VERBOSE
+
+extern "C" {
+#include <AutoGen.h>
+#include <os_common.h>
+#include <os_efi_log_ring.h>
+}
+
+class DebugLog_Tests : public ::testing::Test
+{
+protected:
+  std::vector<std::string> expected;
+
+  void Log(const char *p_format, ...)
+  {
+    char buf[1024];
+    va_list args;
+
+    va_start(args, p_format);
+    vsnprintf(buf, sizeof(buf), p_format, args);
+    va_end(args);
+    expected.push_back(buf);
+
+    va_start(args, p_format);
+    debug_log_ring_write(DBG_LOG_TEST_LEVEL, p_format, args);
+    va_end(args);
+  }
+
+  // Decoded messages without the "[time] [thread] " prefix
+  std::vector<std::string> Decoded()
+  {
+    std::vector<std::string> lines;
+    char buf[1024];
+    FILE *p_file = fopen(DBG_LOG_TEST_DECODED_FILE, "r");
+    if (NULL == p_file)
+    {
+      return lines;
+    }
+    while (fgets(buf, sizeof(buf), p_file))
+    {
+      if (buf[0] != '[')
+      {
+        continue;
+      }
+      const char *p_msg = strstr(buf, "] [");
+      p_msg = p_msg ? strstr(p_msg + 3, "] ") : NULL;
+      if (p_msg)
+      {
+        lines.push_back(p_msg + 2);
+      }
+    }
+    fclose(p_file);
+    return lines;
+  }
+
+  // Argument of the messages, counts how many were formatted
+  int Evaluated()
+  {
+    return ++evaluated;
+  }
+
+  int evaluated = 0;
+  UINTN saved_mask = 0;
+
+  virtual void SetUp()
+  {
+    // Loads the logger configuration, the tests only override its mask
+    nvm_init();
+    saved_mask = g_debug_print_mask;
+  }
+
+  virtual void TearDown()
+  {
+    g_debug_print_mask = saved_mask;
+    nvm_uninit();
+    remove(DBG_LOG_TEST_RING_FILE);
+    remove(DBG_LOG_TEST_DECODED_FILE);
+  }
+};
+
+TEST_F(DebugLog_Tests, RingDecodesLikePrintf)
+{
+  remove(DBG_LOG_TEST_RING_FILE);
+  ASSERT_EQ(EFI_SUCCESS, debug_log_ring_open(DBG_LOG_TEST_RING_FILE, DBG_LOG_TEST_RING_SIZE));
+
+  Log("plain message\n");
+  Log("int %d unsigned %u hex 0x%08x neg %i\n", -42, 42u, 0xbeef, -1);
+  Log("long %ld ull %llu size %zu char %c\n", -1234567890l, 18446744073709551615ull, (size_t)77, 'x');
+  Log("string '%s' padded '%-8s|%8s' precision '%.3s'\n", "abc", "left", "right", "truncated");
+  Log("star '%*d' '%.*s' percent %%\n", 6, 12, 2, "xyz");
+  Log("double %.2f %e pointer %p\n", 3.14159, 1.5e10, (void *)0x1000);
+  Log("no newline");
+  debug_log_ring_close();
+
+  FILE *p_out = fopen(DBG_LOG_TEST_DECODED_FILE, "w");
+  ASSERT_NE(p_out, (FILE *)NULL);
+  EXPECT_EQ(EFI_SUCCESS, debug_log_ring_decode(DBG_LOG_TEST_RING_FILE, p_out));
+  fclose(p_out);
+
+  std::vector<std::string> decoded = Decoded();
+  ASSERT_EQ(decoded.size(), expected.size());
+  for (size_t i = 0; i < expected.size(); i++)
+  {
+    std::string msg = expected[i];
+    // The decoder terminates every message with a newline
+    if (msg.empty() || msg[msg.size() - 1] != '\n')
+    {
+      msg += "\n";
+    }
+    EXPECT_EQ(decoded[i], msg);
+  }
+}
+
+TEST_F(DebugLog_Tests, FilteredLevelIsNotEvaluated)
+{
+  g_debug_print_mask = OS_DEBUG_ERROR | OS_DEBUG_WARN;
+  OS_DEBUG_PRINT(OS_DEBUG_VERBOSE, "filtered %d\n", Evaluated());
+  OS_DEBUG_PRINT(OS_DEBUG_INFO, "filtered %d\n", Evaluated());
+  EXPECT_EQ(0, evaluated);
+
+  g_debug_print_mask = 0;
+  OS_DEBUG_PRINT(OS_DEBUG_ERROR, "filtered %d\n", Evaluated());
+  EXPECT_EQ(0, evaluated);
+}
+
+TEST_F(DebugLog_Tests, EnabledLevelIsEvaluated)
+{
+  // Only the ring is written to, stdout is left as configured
+  remove(DBG_LOG_TEST_RING_FILE);
+  ASSERT_EQ(EFI_SUCCESS, debug_log_ring_open(DBG_LOG_TEST_RING_FILE, DBG_LOG_TEST_RING_SIZE));
+  g_debug_print_mask = OS_DEBUG_VERBOSE;
+  OS_DEBUG_PRINT(OS_DEBUG_VERBOSE, "enabled %d\n", Evaluated());
+  OS_DEBUG_PRINT(OS_DEBUG_WARN, "filtered %d\n", Evaluated());
+  debug_log_ring_close();
+  EXPECT_EQ(1, evaluated);
+}
+#endif // __linux__
+
+#endif // DEBUG_LOG_TESTS_H
@@ -0,0 +1,395 @@
+/*
+ * Copyright (c) 2018, Intel Corporation.
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+#ifndef JSON_OUTPUT_TESTS_H
+#define JSON_OUTPUT_TESTS_H
+
+#ifdef __linux__
+#include <gtest/gtest.h>
+#include <sstream>
+#include <string>
+#include <ctype.h>
+#include <string.h>
+#include "CliOutputHarness.h"
+
+extern "C" {
+#include <AutoGen.h>
+#include <Printer.h>
+}
+
+// Enough DIMMs for the printer to group them through the child index of the data set
+#define JSON_TEST_DIMMS             12
+#define JSON_TEST_SENSORS           4
+
+// Host independent commands whose JSON output is compared with the committed golden files
+static const cli_command g_json_host_commands[] = {
+  { "version", "version", "", "" },
+};
+
+// Data sets printed by the printer directly, laid out like the ones of show -dimm and show -sensor
+static const cli_command g_json_rendered_dimms = { "rendered_dimm", "", "", "" };
+static const cli_command g_json_rendered_sensors = { "rendered_sensor", "", "", "" };
+
+// Look up the data set at path, creating it the way the PRINTER_SET_KEY_VAL_* macros do
+static DATA_SET_CONTEXT *json_data_set(PRINT_CONTEXT *p_ctx, const std::wstring &path)
+{
+  DATA_SET_CONTEXT *p_data_set = NULL;
+  std::wstring lookup_path = path;
+  LookupDataSet(p_ctx, &lookup_path[0], &p_data_set);
+  return p_data_set;
+}
+
+// A DIMM list like show -dimm -a builds: strings, decimal and hex numbers and booleans
+static void json_build_dimms(PRINT_CONTEXT *p_ctx)
+{
+  for (int dimm = 0; dimm < JSON_TEST_DIMMS; dimm++)
+  {
+    DATA_SET_CONTEXT *p_dimm = json_data_set(p_ctx, L"/DimmList/Dimm[" + std::to_wstring(dimm) + L"]");
+    ASSERT_TRUE(NULL != p_dimm);
+    SetKeyValueUint16(p_dimm, L"DimmID", (UINT16)(((dimm / 6) << 12) | ((dimm % 6) << 4)), HEX);
+    SetKeyValueUint64(p_dimm, L"Capacity", 136365211648ull + dimm, DECIMAL);
+    SetKeyValueWideStr(p_dimm, L"HealthState", (0 == dimm % 5) ? L"Noncritical failure" : L"Healthy");
+    SetKeyValueBool(p_dimm, L"IsNew", 0 == dimm % 4);
+    // Strings are escaped, and trimmed like in the XML output
+    SetKeyValueWideStr(p_dimm, L"PartNumber", (0 == dimm % 7) ? L" NMA1XXD128GPS \\\"rev\"\t" : L"NMA1XXD128GPS");
+  }
+}
+
+// A sensor list like show -sensor builds: a list of DIMMs each holding a list of sensors.
+// Some data sets are looked up but get no keys, they are left out of the output.
+static void json_build_sensors(PRINT_CONTEXT *p_ctx)
+{
+  static const wchar_t *sensor_types[JSON_TEST_SENSORS] = {
+    L"Health", L"MediaTemperature", L"ControllerTemperature", L"PercentageRemaining"
+  };
+
+  for (int dimm = 0; dimm < JSON_TEST_DIMMS; dimm++)
+  {
+    std::wstring dimm_path = L"/SensorList/Dimm[" + std::to_wstring(dimm) + L"]";
+    DATA_SET_CONTEXT *p_dimm = json_data_set(p_ctx, dimm_path);
+    ASSERT_TRUE(NULL != p_dimm);
+    if (3 == dimm)
+    {
+      json_data_set(p_ctx, dimm_path + L"/Sensor[0]");
+      continue;
+    }
+    SetKeyValueUint16(p_dimm, L"DimmID", (UINT16)(((dimm / 6) << 12) | ((dimm % 6) << 4)), HEX);
+    for (int sensor = 0; sensor < JSON_TEST_SENSORS; sensor++)
+    {
+      DATA_SET_CONTEXT *p_sensor = json_data_set(p_ctx, dimm_path + L"/Sensor[" + std::to_wstring(sensor) + L"]");
+      ASSERT_TRUE(NULL != p_sensor);
+      if (1 == dimm % 4 && 0 == sensor)
+      {
+        continue;
+      }
+      SetKeyValueWideStr(p_sensor, L"Type", sensor_types[sensor]);
+      SetKeyValueInt32(p_sensor, L"CurrentValue", 30 + dimm - 10 * sensor, DECIMAL);
+    }
+  }
+}
+
+// Just enough of a JSON parser to tell whether a document is well formed
+class json_checker
+{
+public:
+  explicit json_checker(const std::string &text) : m_text(text), m_pos(0) {}
+
+  bool document()
+  {
+    skip_ws();
+    if (!value())
+    {
+      return false;
+    }
+    skip_ws();
+    return m_pos == m_text.size();
+  }
+
+private:
+  const std::string &m_text;
+  size_t m_pos;
+
+  void skip_ws()
+  {
+    while (m_pos < m_text.size() && strchr(" \t\r\n", m_text[m_pos]))
+    {
+      m_pos++;
+    }
+  }
+
+  bool literal(const char *p_word)
+  {
+    size_t len = strlen(p_word);
+    if (m_text.compare(m_pos, len, p_word) != 0)
+    {
+      return false;
+    }
+    m_pos += len;
+    return true;
+  }
+
+  bool string()
+  {
+    if (m_pos >= m_text.size() || m_text[m_pos++] != '"')
+    {
+      return false;
+    }
+    while (m_pos < m_text.size())
+    {
+      char c = m_text[m_pos++];
+      if (c == '"')
+      {
+        return true;
+      }
+      if ((unsigned char)c < 0x20)
+      {
+        return false;
+      }
+      if (c == '\\')
+      {
+        if (m_pos >= m_text.size())
+        {
+          return false;
+        }
+        c = m_text[m_pos++];
+        if (c == 'u')
+        {
+          for (int i = 0; i < 4; i++)
+          {
+            if (m_pos >= m_text.size() || !isxdigit((unsigned char)m_text[m_pos++]))
+            {
+              return false;
+            }
+          }
+        }
+        else if (!strchr("\"\\/bfnrt", c))
+        {
+          return false;
+        }
+      }
+    }
+    return false;
+  }
+
+  bool number()
+  {
+    size_t start = m_pos;
+    if (m_pos < m_text.size() && m_text[m_pos] == '-')
+    {
+      m_pos++;
+    }
+    while (m_pos < m_text.size() && (isdigit((unsigned char)m_text[m_pos]) || strchr(".eE+-", m_text[m_pos])))
+    {
+      m_pos++;
+    }
+    return m_pos > start && isdigit((unsigned char)m_text[m_pos - 1]);
+  }
+
+  bool members(char close, bool keyed)
+  {
+    m_pos++;
+    skip_ws();
+    if (m_pos < m_text.size() && m_text[m_pos] == close)
+    {
+      m_pos++;
+      return true;
+    }
+    while (true)
+    {
+      skip_ws();
+      if (keyed)
+      {
+        if (!string())
+        {
+          return false;
+        }
+        skip_ws();
+        if (m_pos >= m_text.size() || m_text[m_pos++] != ':')
+        {
+          return false;
+        }
+        skip_ws();
+      }
+      if (!value())
+      {
+        return false;
+      }
+      skip_ws();
+      if (m_pos >= m_text.size())
+      {
+        return false;
+      }
+      char c = m_text[m_pos++];
+      if (c == close)
+      {
+        return true;
+      }
+      if (c != ',')
+      {
+        return false;
+      }
+    }
+  }
+
+  bool value()
+  {
+    if (m_pos >= m_text.size())
+    {
+      return false;
+    }
+    switch (m_text[m_pos])
+    {
+    case '{':
+      return members('}', true);
+    case '[':
+      return members(']', false);
+    case '"':
+      return string();
+    case 't':
+      return literal("true");
+    case 'f':
+      return literal("false");
+    case 'n':
+      return literal("null");
+    default:
+      return number();
+    }
+  }
+};
+
+// Number of times p_what appears in text
+static size_t count_of(const std::string &text, const char *p_what)
+{
+  size_t count = 0;
+  for (size_t pos = text.find(p_what); std::string::npos != pos; pos = text.find(p_what, pos + 1))
+  {
+    count++;
+  }
+  return count;
+}
+
+class JsonOutput_Tests : public ::testing::Test, public CliOutputHarness
+{
+protected:
+  // Print a data set through the printer in a child process, as a show command would
+  std::string RenderDataSet(void (*p_build)(PRINT_CONTEXT *), bool ndjson)
+  {
+    return RunCaptured([p_build, ndjson]() {
+      PRINT_CONTEXT *p_ctx = NULL;
+      if (NVM_SUCCESS != nvm_init() || EFI_SUCCESS != PrinterCreateCtx(&p_ctx))
+      {
+        return 1;
+      }
+      p_ctx->FormatType = JSON;
+      if (ndjson)
+      {
+        PRINTER_ENABLE_NDJSON_FORMAT(p_ctx);
+      }
+      p_build(p_ctx);
+      EFI_STATUS rc = PrinterProcessSetBuffer(p_ctx);
+      PrinterDestroyCtx(p_ctx);
+      return (EFI_SUCCESS == rc) ? 0 : 1;
+    });
+  }
+
+  // Check a JSON document, and every line of an NDJSON stream, the last one the return code
+  void CheckJson(const std::string &what, const std::string &json, const std::string &ndjson)
+  {
+    EXPECT_TRUE(json_checker(json).document()) << what << "\n" << json;
+
+    std::istringstream lines(ndjson);
+    std::string line;
+    std::string last;
+    while (std::getline(lines, line))
+    {
+      EXPECT_TRUE(json_checker(line).document()) << what << "\n" << line;
+      last = line;
+    }
+    EXPECT_EQ(0u, last.find("{\"ReturnCode\":")) << what;
+  }
+};
+
+TEST_F(JsonOutput_Tests, HostCommandsMatchGolden)
+{
+  for (auto &cmd : g_json_host_commands)
+  {
+    std::string json = RunCli(cmd, "json");
+    std::string ndjson = RunCli(cmd, "ndjson");
+    CheckJson(cmd.p_name, json, ndjson);
+    CompareWithGolden(GoldenPath(cmd, "json"), json);
+    CompareWithGolden(GoldenPath(cmd, "ndjson"), ndjson);
+  }
+}
+
+TEST_F(JsonOutput_Tests, RenderedDataSetsMatchGolden)
+{
+  const struct
+  {
+    const cli_command *p_golden;
+    void (*p_build)(PRINT_CONTEXT *);
+  } rendered[] = {
+    { &g_json_rendered_dimms, json_build_dimms },
+    { &g_json_rendered_sensors, json_build_sensors },
+  };
+
+  for (auto &data_set : rendered)
+  {
+    std::string json = RenderDataSet(data_set.p_build, false);
+    std::string ndjson = RenderDataSet(data_set.p_build, true);
+    CheckJson(data_set.p_golden->p_name, json, ndjson);
+    CompareWithGolden(GoldenPath(*data_set.p_golden, "json"), json);
+    CompareWithGolden(GoldenPath(*data_set.p_golden, "ndjson"), ndjson);
+  }
+
+  // Children of one name are a single array, in the order they were added
+  std::string json = RenderDataSet(json_build_dimms, false);
+  EXPECT_EQ(json.find("\"Dimm\":["), json.rfind("\"Dimm\":[")) << json;
+  EXPECT_LT(json.find("\"DimmID\":\"0x0000\""), json.find("\"DimmID\":\"0x1050\"")) << json;
+
+  // The DIMM without sensors and the sensors without keys are left out
+  std::string sensors = RenderDataSet(json_build_sensors, false);
+  EXPECT_EQ((size_t)JSON_TEST_DIMMS - 1, count_of(sensors, "\"DimmID\":"));
+  EXPECT_EQ(0u, count_of(sensors, "{}")) << sensors;
+}
+
+TEST_F(JsonOutput_Tests, ShowCommandsMatchGolden)
+{
+  if (!LoadSessions())
+  {
+    GTEST_SKIP() << "set " CLI_OUTPUT_CORPUS_ENV " to a directory of recorded sessions to run this test";
+  }
+
+  for (auto &session : sessions)
+  {
+    ASSERT_TRUE(StartSession(session)) << session;
+    for (auto &cmd : g_cli_show_commands)
+    {
+      std::string json = RunCli(cmd, "json");
+      std::string ndjson = RunCli(cmd, "ndjson");
+      CheckJson(session + ": " + cmd.p_name, json, ndjson);
+      CompareWithGolden(GoldenPath(session, cmd, "json"), json);
+      CompareWithGolden(GoldenPath(session, cmd, "ndjson"), ndjson);
+    }
+    StopSession();
+  }
+}
+
+TEST_F(JsonOutput_Tests, InvalidCommandReportsError)
+{
+  if (!LoadSessions())
+  {
+    GTEST_SKIP() << "set " CLI_OUTPUT_CORPUS_ENV " to a directory of recorded sessions to run this test";
+  }
+
+  ASSERT_TRUE(StartSession(sessions[0])) << sessions[0];
+  std::string json = RunCli("show", "", "-dimm 0xdead", "json");
+  StopSession();
+
+  EXPECT_TRUE(json_checker(json).document()) << json;
+  EXPECT_EQ(0u, json.find("{\"ReturnCode\":")) << json;
+  EXPECT_EQ(std::string::npos, json.find("{\"ReturnCode\":0,")) << json;
+}
+#endif // __linux__
+
+#endif // JSON_OUTPUT_TESTS_H
@@ -0,0 +1,122 @@
+/*
+ * Copyright (c) 2018, Intel Corporation.
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+#ifndef LARGE_PAYLOAD_FAKE_H
+#define LARGE_PAYLOAD_FAKE_H
+
+#include <vector>
+#include <errno.h>
+#include <string.h>
+
+extern "C" {
+#include <lnx_adapter_passthrough.h>
+}
+
+#define LP_MAILBOX_SIZE       (1 << 20)
+#define LP_RW_SIZE            4096
+#define LP_SUBOP(opcode)      ((opcode) >> 8)
+
+// In-memory stand-in for the emulated BIOS large payload DSM commands,
+// shared by the tests and the benchmark
+struct fake_dsm_cmd
+{
+  unsigned int opcode;
+  std::vector<unsigned char> in;
+  std::vector<unsigned char> out;
+};
+
+static std::vector<unsigned char> g_fake_mailbox(LP_MAILBOX_SIZE);
+static unsigned int g_fake_cmd_new_cnt;
+static unsigned int g_fake_submit_cnt;
+
+static struct ndctl_cmd *fake_cmd_new(struct ndctl_dimm *p_dimm, unsigned int opcode,
+  size_t input_size, size_t output_size)
+{
+  fake_dsm_cmd *p_cmd = new fake_dsm_cmd;
+  p_cmd->opcode = opcode;
+  p_cmd->in.resize(input_size);
+  p_cmd->out.resize(output_size);
+  g_fake_cmd_new_cnt++;
+  return (struct ndctl_cmd *)p_cmd;
+}
+
+static ssize_t fake_set_input(struct ndctl_cmd *p_cmd, void *p_buf, unsigned int len)
+{
+  fake_dsm_cmd *p_fake = (fake_dsm_cmd *)p_cmd;
+  if (len > p_fake->in.size())
+  {
+    return -EINVAL;
+  }
+  memcpy(p_fake->in.data(), p_buf, len);
+  return len;
+}
+
+static ssize_t fake_get_output(struct ndctl_cmd *p_cmd, void *p_buf, unsigned int len)
+{
+  fake_dsm_cmd *p_fake = (fake_dsm_cmd *)p_cmd;
+  if (len > p_fake->out.size())
+  {
+    len = p_fake->out.size();
+  }
+  memcpy(p_buf, p_fake->out.data(), len);
+  return len;
+}
+
+static int fake_submit(struct ndctl_cmd *p_cmd)
+{
+  fake_dsm_cmd *p_fake = (fake_dsm_cmd *)p_cmd;
+  struct pt_bios_rw_header *p_header = (struct pt_bios_rw_header *)p_fake->in.data();
+
+  g_fake_submit_cnt++;
+  switch (LP_SUBOP(p_fake->opcode))
+  {
+  case SUBOP_GET_PAYLOAD_SIZE:
+  {
+    struct pt_bios_get_size size = { LP_MAILBOX_SIZE, LP_MAILBOX_SIZE, LP_RW_SIZE };
+    memcpy(p_fake->out.data(), &size, sizeof(size));
+    return 0;
+  }
+  case SUBOP_WRITE_LARGE_PAYLOAD_INPUT:
+    // The command must be sized for exactly this chunk
+    if (p_fake->in.size() != sizeof(*p_header) + p_header->size ||
+        p_header->offset + p_header->size > LP_MAILBOX_SIZE)
+    {
+      return -EINVAL;
+    }
+    memcpy(g_fake_mailbox.data() + p_header->offset, p_header + 1, p_header->size);
+    return 0;
+  case SUBOP_READ_LARGE_PAYLOAD_OUTPUT:
+    if (p_fake->out.size() != p_header->size ||
+        p_header->offset + p_header->size > LP_MAILBOX_SIZE)
+    {
+      return -EINVAL;
+    }
+    memcpy(p_fake->out.data(), g_fake_mailbox.data() + p_header->offset, p_header->size);
+    return 0;
+  default:
+    return -ENOTTY;
+  }
+}
+
+static unsigned int fake_get_firmware_status(struct ndctl_cmd *p_cmd)
+{
+  return DSM_VENDOR_SUCCESS;
+}
+
+static void fake_unref(struct ndctl_cmd *p_cmd)
+{
+  delete (fake_dsm_cmd *)p_cmd;
+}
+
+static const struct pt_dsm_backend g_fake_dsm_backend =
+{
+  fake_cmd_new,
+  fake_set_input,
+  fake_get_output,
+  fake_submit,
+  fake_get_firmware_status,
+  fake_unref
+};
+
+#endif // LARGE_PAYLOAD_FAKE_H
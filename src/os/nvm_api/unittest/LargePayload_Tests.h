@@ -0,0 +1,96 @@
+/*
+ * Copyright (c) 2018, Intel Corporation.
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+#ifndef LARGE_PAYLOAD_TESTS_H
+#define LARGE_PAYLOAD_TESTS_H
+
+#ifdef __linux__
+#include <gtest/gtest.h>
+#include <nvm_management.h>
+#include <vector>
+#include <string.h>
+#include "LargePayloadFake.h"
+
+class LargePayload_Tests : public ::testing::Test
+{
+protected:
+  struct pt_large_payload *p_lp = NULL;
+  struct ndctl_dimm *p_dimm = (struct ndctl_dimm *)&g_fake_mailbox;
+  struct fw_cmd cmd;
+  std::vector<unsigned char> in_payload;
+  std::vector<unsigned char> out_payload;
+
+  virtual void SetUp()
+  {
+    passthrough_set_dsm_backend(&g_fake_dsm_backend);
+    g_fake_cmd_new_cnt = 0;
+    g_fake_submit_cnt = 0;
+    p_lp = large_payload_new();
+    ASSERT_TRUE(p_lp != NULL);
+  }
+
+  virtual void TearDown()
+  {
+    large_payload_free(p_lp);
+    passthrough_set_dsm_backend(NULL);
+  }
+
+  void PrepareCmd(unsigned int size)
+  {
+    in_payload.resize(size);
+    out_payload.assign(size, 0);
+    for (unsigned int i = 0; i < size; i++)
+    {
+      in_payload[i] = (unsigned char)(i * 7 + (i >> 12));
+    }
+    memset(&cmd, 0, sizeof(cmd));
+    cmd.LargeInputPayloadSize = size;
+    cmd.LargeInputPayload = in_payload.data();
+    cmd.LargeOutputPayloadSize = size;
+    cmd.LargeOutputPayload = out_payload.data();
+  }
+};
+
+TEST_F(LargePayload_Tests, RoundTripWithShortLastChunk)
+{
+  PrepareCmd(LP_MAILBOX_SIZE - 100);
+
+  EXPECT_EQ(bios_write_large_payload(p_dimm, p_lp, &cmd), NVM_SUCCESS);
+  EXPECT_EQ(bios_read_large_payload(p_dimm, p_lp, &cmd), NVM_SUCCESS);
+  EXPECT_EQ(memcmp(in_payload.data(), out_payload.data(), in_payload.size()), 0);
+}
+
+TEST_F(LargePayload_Tests, OversizedPayloadIsRejected)
+{
+  PrepareCmd(LP_MAILBOX_SIZE + 1);
+
+  EXPECT_EQ(bios_write_large_payload(p_dimm, p_lp, &cmd), NVM_ERR_BAD_SIZE);
+  EXPECT_EQ(bios_read_large_payload(p_dimm, p_lp, &cmd), NVM_ERR_BAD_SIZE);
+}
+
+TEST_F(LargePayload_Tests, WarmSessionReusesCommands)
+{
+  unsigned int chunks = LP_MAILBOX_SIZE / LP_RW_SIZE;
+
+  PrepareCmd(LP_MAILBOX_SIZE);
+
+  // Cold: geometry query plus one write and one read command
+  ASSERT_EQ(bios_write_large_payload(p_dimm, p_lp, &cmd), NVM_SUCCESS);
+  ASSERT_EQ(bios_read_large_payload(p_dimm, p_lp, &cmd), NVM_SUCCESS);
+  EXPECT_EQ(g_fake_cmd_new_cnt, 3u);
+  EXPECT_EQ(g_fake_submit_cnt, 1 + 2 * chunks);
+
+  // Warm: no allocations and exactly one submit per chunk
+  g_fake_cmd_new_cnt = 0;
+  g_fake_submit_cnt = 0;
+  out_payload.assign(out_payload.size(), 0);
+  ASSERT_EQ(bios_write_large_payload(p_dimm, p_lp, &cmd), NVM_SUCCESS);
+  ASSERT_EQ(bios_read_large_payload(p_dimm, p_lp, &cmd), NVM_SUCCESS);
+  EXPECT_EQ(g_fake_cmd_new_cnt, 0u);
+  EXPECT_EQ(g_fake_submit_cnt, 2 * chunks);
+  EXPECT_EQ(memcmp(in_payload.data(), out_payload.data(), in_payload.size()), 0);
+}
+#endif // __linux__
+
+#endif // LARGE_PAYLOAD_TESTS_H
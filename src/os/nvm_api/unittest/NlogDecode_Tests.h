@@ -0,0 +1,116 @@
+/*
+ * Copyright (c) 2018, Intel Corporation.
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+#ifndef NLOG_DECODE_TESTS_H
+#define NLOG_DECODE_TESTS_H
+
+#ifdef __linux__
+#include <gtest/gtest.h>
+#include <nvm_management.h>
+#include <stdlib.h>
+#include <string.h>
+#include "NlogTestData.h"
+
+extern "C" {
+#include <AutoGen.h>
+#include <Nlog.h>
+}
+
+#define NLOG_TEST_DICT_FILE     "nlog_test_dict.txt"
+#define NLOG_TEST_DECODED_FILE  "nlog_test_decoded.txt"
+// Spans several stream chunks so the output file is written more than once
+#define NLOG_TEST_LOG_SIZE      (4ull * 1024 * 1024)
+
+class NlogDecode_Tests : public ::testing::Test
+{
+protected:
+  nlog_dict *p_dict;
+
+  virtual void SetUp()
+  {
+    unsigned int version = 0;
+    unsigned long long entries = 0;
+
+    // File access goes through the boot services shim set up by nvm_init
+    nvm_init();
+    ASSERT_TRUE(NlogTestData::WriteDict(NLOG_TEST_DICT_FILE));
+    p_dict = load_nlog_dict(NULL, (CHAR16 *)L"" NLOG_TEST_DICT_FILE, &version, &entries);
+    ASSERT_NE(p_dict, (nlog_dict *)NULL);
+    EXPECT_EQ(version, 2u);
+    EXPECT_EQ(entries, (unsigned long long)NLOG_TEST_DICT_ENTRIES);
+  }
+
+  virtual void TearDown()
+  {
+    if (NULL != p_dict)
+    {
+      free_nlog_dict(p_dict);
+    }
+    remove(NLOG_TEST_DICT_FILE);
+    remove(NLOG_TEST_DECODED_FILE);
+    nvm_uninit();
+  }
+
+  unsigned long long Decode(unsigned long long size)
+  {
+    unsigned char *p_log = (unsigned char *)calloc(1, size);
+    if (NULL == p_log)
+    {
+      ADD_FAILURE() << "failed to allocate the log";
+      return 0;
+    }
+    unsigned long long records = NlogTestData::FillLog(p_log, size);
+    decode_nlog_binary(NULL, (CHAR16 *)L"" NLOG_TEST_DECODED_FILE, p_log, size, p_dict);
+    free(p_log);
+    return records;
+  }
+};
+
+TEST_F(NlogDecode_Tests, DictionaryLookupFindsEveryHash)
+{
+  for (unsigned int i = 0; i < NLOG_TEST_DICT_ENTRIES; i++)
+  {
+    nlog_dict_entry *p_entry = get_nlog_entry(NlogTestData::Hash(i), p_dict);
+    ASSERT_NE(p_entry, (nlog_dict_entry *)NULL);
+    EXPECT_EQ(p_entry->Hash, NlogTestData::Hash(i));
+    EXPECT_EQ(p_entry->Args, (UINT64)(i % 3));
+  }
+  EXPECT_EQ(get_nlog_entry(3, p_dict), (nlog_dict_entry *)NULL);
+}
+
+TEST_F(NlogDecode_Tests, DecodeWritesOneLinePerRecord)
+{
+  unsigned long long records = Decode(NLOG_TEST_LOG_SIZE);
+  ASSERT_GT(records, 0ull);
+
+  // Two header lines, then one line per record
+  EXPECT_EQ(NlogTestData::CountLines(NLOG_TEST_DECODED_FILE), records + 2);
+
+  char line[512];
+  FILE *p_file = fopen(NLOG_TEST_DECODED_FILE, "r");
+  ASSERT_NE(p_file, (FILE *)NULL);
+  ASSERT_NE(fgets(line, sizeof(line), p_file), (char *)NULL);
+  EXPECT_EQ(0, strncmp(line, "TIMESTAMP ::", strlen("TIMESTAMP ::")));
+  ASSERT_NE(fgets(line, sizeof(line), p_file), (char *)NULL);
+  ASSERT_NE(fgets(line, sizeof(line), p_file), (char *)NULL);
+  EXPECT_NE(strstr(line, " message "), (char *)NULL);
+  fclose(p_file);
+}
+
+TEST_F(NlogDecode_Tests, DecodeReplacesExistingFile)
+{
+  FILE *p_file = fopen(NLOG_TEST_DECODED_FILE, "w");
+  ASSERT_NE(p_file, (FILE *)NULL);
+  for (int i = 0; i < 100000; i++)
+  {
+    fputs("stale line\n", p_file);
+  }
+  fclose(p_file);
+
+  unsigned long long records = Decode(NLOG_TEST_SECTION_SIZE * 4);
+  EXPECT_EQ(NlogTestData::CountLines(NLOG_TEST_DECODED_FILE), records + 2);
+}
+
+#endif // __linux__
+#endif // NLOG_DECODE_TESTS_H
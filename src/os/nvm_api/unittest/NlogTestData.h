@@ -0,0 +1,98 @@
+/*
+ * Copyright (c) 2018, Intel Corporation.
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+#ifndef NLOG_TEST_DATA_H
+#define NLOG_TEST_DATA_H
+
+#include <stdio.h>
+#include <string.h>
+
+#define NLOG_TEST_DICT_ENTRIES  20000
+#define NLOG_TEST_V2_HEADER     (11928997 | (2u << 24))
+#define NLOG_TEST_SECTION_SIZE  256
+
+// Synthetic NLOG dictionaries and logs shared by the tests and the benchmark
+class NlogTestData
+{
+public:
+  static unsigned int Hash(unsigned int index)
+  {
+    return 1000 + index * 7919u;
+  }
+
+  // Version 2 dictionary, entry i takes i % 3 arguments
+  static bool WriteDict(const char *p_path)
+  {
+    FILE *p_file = fopen(p_path, "w");
+    if (NULL == p_file)
+    {
+      return false;
+    }
+    fprintf(p_file, "version=2\n");
+    for (unsigned int i = 0; i < NLOG_TEST_DICT_ENTRIES; i++)
+    {
+      fprintf(p_file, "%u,%u,%s,file_%u.c, message %u%s%s\n", Hash(i), i % 3,
+        (i % 2) ? "INFO" : "ERROR", i, i,
+        (i % 3 > 0) ? " arg %d" : "", (i % 3 > 1) ? ", 0x%08X" : "");
+    }
+    fclose(p_file);
+    return true;
+  }
+
+  // V2 sections filled with records of known hashes, returns the record count
+  static unsigned long long FillLog(unsigned char *p_log, unsigned long long size)
+  {
+    unsigned long long records = 0;
+    unsigned int words[NLOG_TEST_SECTION_SIZE / sizeof(unsigned int)];
+    unsigned int seed = 1;
+
+    for (unsigned long long section = 0; section < size; section += NLOG_TEST_SECTION_SIZE)
+    {
+      unsigned int w = 0;
+      memset(words, 0, sizeof(words));
+      words[w++] = NLOG_TEST_V2_HEADER;
+      for (;;)
+      {
+        seed = seed * 1103515245 + 12345;
+        unsigned int index = (seed >> 8) % NLOG_TEST_DICT_ENTRIES;
+        unsigned int args = index % 3;
+        if (w + 2 + args > sizeof(words) / sizeof(words[0]))
+        {
+          break;
+        }
+        words[w++] = Hash(index);
+        words[w++] = (unsigned int)(section / NLOG_TEST_SECTION_SIZE) + 1;
+        for (unsigned int a = 0; a < args; a++)
+        {
+          words[w++] = seed;
+        }
+        records++;
+      }
+      memcpy(p_log + section, words, sizeof(words));
+    }
+    return records;
+  }
+
+  static unsigned long long CountLines(const char *p_path)
+  {
+    unsigned long long lines = 0;
+    int c;
+    FILE *p_file = fopen(p_path, "r");
+    if (NULL == p_file)
+    {
+      return 0;
+    }
+    while (EOF != (c = fgetc(p_file)))
+    {
+      if ('\n' == c)
+      {
+        lines++;
+      }
+    }
+    fclose(p_file);
+    return lines;
+  }
+};
+
+#endif // NLOG_TEST_DATA_H
@@ -177,4 +177,122 @@ TEST_F(NvmApi_Tests, SetMasterPassphrase)
 
   free(p_devices);
 }
+
+TEST_F(NvmApi_Tests, WaitForJobsOnAllDimms)
+{
+  unsigned int dimm_cnt = 0;
+  int result = NVM_SUCCESS;
+  struct job job_state;
+
+  ASSERT_EQ(nvm_get_number_of_devices(&dimm_cnt), NVM_SUCCESS);
+  if (0 == dimm_cnt) {
+    GTEST_SKIP() << "no DCPMM DIMMs found";
+  }
+  device_discovery *p_devices = (device_discovery *)malloc(sizeof(device_discovery) * dimm_cnt);
+  NVM_JOB_HANDLE *p_jobs = (NVM_JOB_HANDLE *)malloc(sizeof(NVM_JOB_HANDLE) * dimm_cnt);
+
+  nvm_get_devices(p_devices, dimm_cnt);
+
+  // With no long operation running every job finishes on its first poll
+  for (unsigned int i = 0; i < dimm_cnt; i++) {
+    ASSERT_EQ(nvm_submit_job(p_devices[i].uid, NVM_JOB_TYPE_UNKNOWN, 5000, NULL, NULL, &p_jobs[i]), NVM_SUCCESS);
+  }
+  EXPECT_EQ(nvm_wait_for_jobs(p_jobs, dimm_cnt, 1, 10000, NULL), NVM_SUCCESS);
+
+  for (unsigned int i = 0; i < dimm_cnt; i++) {
+    EXPECT_EQ(nvm_get_job_status(p_jobs[i], &job_state, &result), NVM_SUCCESS);
+    EXPECT_NE(result, NVM_ERR_BUSY_DEVICE);
+    EXPECT_STREQ(job_state.uid, p_devices[i].uid);
+    EXPECT_EQ(nvm_release_job(p_jobs[i]), NVM_SUCCESS);
+  }
+  EXPECT_NE(nvm_get_job_status(p_jobs[0], &job_state, &result), NVM_SUCCESS);
+
+  free(p_jobs);
+  free(p_devices);
+}
+
+TEST_F(NvmApi_Tests, VerifyJobApiReturnsErrorWithInvalidParam)
+{
+  NVM_JOB_HANDLE job = 0;
+
+  EXPECT_NE(nvm_submit_job("Asdfg", NVM_JOB_TYPE_FW_UPDATE, 0, NULL, NULL, &job), NVM_SUCCESS);
+  EXPECT_NE(nvm_wait_for_jobs(&job, 1, 1, 0, NULL), NVM_SUCCESS);
+  EXPECT_NE(nvm_release_job(job), NVM_SUCCESS);
+}
+TEST_F(NvmApi_Tests, VerifyFwUpdateApiReturnsErrorWithInvalidParam)
+{
+  NVM_UID uids[1] = { "Asdfg" };
+  struct device_fw_update_status status;
+
+  EXPECT_EQ(nvm_update_devices_fw(uids, 1, NULL, 0, 0, &status), NVM_ERR_INVALID_PARAMETER);
+  EXPECT_EQ(nvm_update_devices_fw(uids, 1, "fw.bin", 6, 0, NULL), NVM_ERR_INVALID_PARAMETER);
+  EXPECT_EQ(nvm_get_device_fw_update_status(uids[0], NULL), NVM_ERR_INVALID_PARAMETER);
+  EXPECT_NE(nvm_get_device_fw_update_status(uids[0], &status), NVM_SUCCESS);
+}
+
+TEST_F(NvmApi_Tests, GetDeviceTransport)
+{
+  unsigned int dimm_cnt = 0;
+  struct device_transport transport;
+
+  EXPECT_EQ(nvm_get_device_transport("Asdfg", NULL), NVM_ERR_INVALID_PARAMETER);
+  EXPECT_NE(nvm_get_device_transport("Asdfg", &transport), NVM_SUCCESS);
+
+  nvm_get_number_of_devices(&dimm_cnt);
+  device_discovery *p_devices = (device_discovery *)malloc(sizeof(device_discovery) * dimm_cnt);
+  nvm_get_devices(p_devices, dimm_cnt);
+
+  for (unsigned int i = 0; i < dimm_cnt; i++) {
+    ASSERT_EQ(nvm_get_device_transport(p_devices[i].uid, &transport), NVM_SUCCESS);
+    if (transport.mailbox_ready && transport.large_payload_available) {
+      EXPECT_EQ(transport.large_payload_method, DEVICE_TRANSPORT_DDRT_LARGE_PAYLOAD);
+      EXPECT_GT(transport.large_input_payload_size, 0u);
+    }
+  }
+  free(p_devices);
+}
+
+TEST_F(NvmApi_Tests, FwCmdStats)
+{
+  unsigned int dimm_cnt = 0;
+  NVM_UINT32 stats_cnt = 0;
+  struct device_error_log_status log_status;
+  struct device_fw_cmd_stats stats;
+
+  EXPECT_EQ(nvm_get_number_of_fw_cmd_stats("Asdfg", NULL), NVM_ERR_INVALID_PARAMETER);
+  EXPECT_EQ(nvm_get_fw_cmd_stats("Asdfg", NULL, 1), NVM_ERR_INVALID_PARAMETER);
+  EXPECT_EQ(nvm_get_fw_cmd_stats("Asdfg", &stats, 0), NVM_ERR_INVALID_PARAMETER);
+
+  nvm_get_number_of_devices(&dimm_cnt);
+  if (0 == dimm_cnt)
+    return;
+  device_discovery *p_devices = (device_discovery *)malloc(sizeof(device_discovery) * dimm_cnt);
+  nvm_get_devices(p_devices, dimm_cnt);
+
+  ASSERT_EQ(nvm_toggle_fw_cmd_stats(1), NVM_SUCCESS);
+  EXPECT_EQ(nvm_fw_cmd_stats_enabled(), 1);
+  EXPECT_EQ(nvm_reset_fw_cmd_stats(), NVM_SUCCESS);
+  nvm_get_fw_err_log_stats(p_devices[0].uid, &log_status);
+  ASSERT_EQ(nvm_toggle_fw_cmd_stats(0), NVM_SUCCESS);
+
+  ASSERT_EQ(nvm_get_number_of_fw_cmd_stats(p_devices[0].uid, &stats_cnt), NVM_SUCCESS);
+  ASSERT_GT(stats_cnt, 0u);
+  struct device_fw_cmd_stats *p_stats = (struct device_fw_cmd_stats *)malloc(sizeof(*p_stats) * stats_cnt);
+  ASSERT_EQ(nvm_get_fw_cmd_stats(p_devices[0].uid, p_stats, stats_cnt), NVM_SUCCESS);
+  for (NVM_UINT32 i = 0; i < stats_cnt; i++) {
+    NVM_UINT64 bucketed = 0;
+    for (int bucket = 0; bucket < NVM_FW_CMD_STATS_LATENCY_BUCKETS; bucket++)
+      bucketed += p_stats[i].latency_us[bucket];
+    EXPECT_GT(p_stats[i].calls, 0u);
+    EXPECT_EQ(bucketed, p_stats[i].calls);
+    EXPECT_LE(p_stats[i].min_us, p_stats[i].max_us);
+    if (i > 0)
+      EXPECT_LT((p_stats[i - 1].opcode << 8) | p_stats[i - 1].sub_opcode, (p_stats[i].opcode << 8) | p_stats[i].sub_opcode);
+  }
+  EXPECT_EQ(nvm_reset_fw_cmd_stats(), NVM_SUCCESS);
+  EXPECT_EQ(nvm_get_number_of_fw_cmd_stats(p_devices[0].uid, &stats_cnt), NVM_SUCCESS);
+  EXPECT_EQ(stats_cnt, 0u);
+  free(p_stats);
+  free(p_devices);
+}
 #endif //NVM_API_TESTS_H
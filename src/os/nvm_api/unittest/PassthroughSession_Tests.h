@@ -0,0 +1,107 @@
+/*
+ * Copyright (c) 2018, Intel Corporation.
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+#ifndef PASSTHROUGH_SESSION_TESTS_H
+#define PASSTHROUGH_SESSION_TESTS_H
+
+#ifdef __linux__
+#include <gtest/gtest.h>
+#include <nvm_management.h>
+#include <string.h>
+
+extern "C" {
+#include <lnx_adapter_passthrough.h>
+}
+
+#define PT_TEST_ITERATIONS 8
+
+class PassthroughSession_Tests : public ::testing::Test
+{
+protected:
+  unsigned int handle;
+
+  virtual void SetUp()
+  {
+    unsigned int dimm_cnt = 0;
+    if (NVM_SUCCESS != nvm_get_number_of_devices(&dimm_cnt) || 0 == dimm_cnt)
+    {
+      GTEST_SKIP() << "no DCPMM DIMMs found";
+    }
+
+    device_discovery *p_devices = (device_discovery *)calloc(dimm_cnt, sizeof(device_discovery));
+    ASSERT_EQ(NVM_SUCCESS, nvm_get_devices(p_devices, dimm_cnt));
+    handle = p_devices->device_handle.handle;
+    free(p_devices);
+  }
+
+  virtual void TearDown()
+  {
+    passthrough_session_set_enabled(1);
+  }
+
+  // Identify DIMM output payload
+  void Identify(unsigned char *p_payload)
+  {
+    struct fw_cmd cmd;
+    memset(&cmd, 0, sizeof(cmd));
+    cmd.DimmID = handle;
+    cmd.Opcode = 0x01;     // Identify
+    cmd.SubOpcode = 0x00;  // DIMM
+    cmd.OutputPayloadSize = OUT_PAYLOAD_SIZE;
+    ASSERT_EQ(NVM_SUCCESS, ioctl_passthrough_fw_cmd(&cmd));
+    memcpy(p_payload, cmd.OutPayload, OUT_PAYLOAD_SIZE);
+  }
+};
+
+TEST_F(PassthroughSession_Tests, SessionMatchesPerCommandContext)
+{
+  unsigned char expected[OUT_PAYLOAD_SIZE];
+  unsigned char payload[OUT_PAYLOAD_SIZE];
+
+  passthrough_session_set_enabled(0);
+  Identify(expected);
+
+  passthrough_session_set_enabled(1);
+  for (int i = 0; i < PT_TEST_ITERATIONS; i++)
+  {
+    Identify(payload);
+    EXPECT_EQ(0, memcmp(expected, payload, sizeof(payload))) << "command " << i;
+  }
+}
+
+TEST_F(PassthroughSession_Tests, InvalidatedSessionIsRebuilt)
+{
+  unsigned char expected[OUT_PAYLOAD_SIZE];
+  unsigned char payload[OUT_PAYLOAD_SIZE];
+
+  Identify(expected);
+  passthrough_session_invalidate();
+  Identify(payload);
+  EXPECT_EQ(0, memcmp(expected, payload, sizeof(payload)));
+
+  passthrough_session_close();
+  Identify(payload);
+  EXPECT_EQ(0, memcmp(expected, payload, sizeof(payload)));
+}
+
+TEST_F(PassthroughSession_Tests, UnknownHandleFails)
+{
+  struct fw_cmd cmd;
+  memset(&cmd, 0, sizeof(cmd));
+  cmd.DimmID = 0xffffffff;
+  cmd.Opcode = 0x01;
+  cmd.SubOpcode = 0x00;
+  cmd.OutputPayloadSize = OUT_PAYLOAD_SIZE;
+  // Remembered as absent after the first miss, known handles keep working
+  for (int i = 0; i < PT_TEST_ITERATIONS; i++)
+  {
+    EXPECT_NE(NVM_SUCCESS, ioctl_passthrough_fw_cmd(&cmd)) << "command " << i;
+  }
+
+  unsigned char payload[OUT_PAYLOAD_SIZE];
+  Identify(payload);
+}
+#endif // __linux__
+
+#endif // PASSTHROUGH_SESSION_TESTS_H
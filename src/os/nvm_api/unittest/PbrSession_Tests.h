@@ -0,0 +1,385 @@
+/*
+ * Copyright (c) 2018, Intel Corporation.
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+#ifndef PBR_SESSION_TESTS_H
+#define PBR_SESSION_TESTS_H
+
+#ifdef __linux__
+#include <gtest/gtest.h>
+#include <fstream>
+#include <vector>
+#include "PbrTestSession.h"
+
+extern "C" {
+#include <Checksum.h>
+}
+
+#define PBR_TEST_RECORDS            1000
+#define PBR_TEST_LEGACY_RECORDS     10
+// Playback of the converted legacy session goes on from this item
+#define PBR_TEST_LEGACY_CURSOR      3
+// Pass through recorded with a size past the end of the session
+#define PBR_TEST_CORRUPTED_RECORD   5
+
+// Files of the session, in the current and in the previous format
+#define PBR_TEST_CTX_FILE           "pbr_session_ctx.tmp"
+#define PBR_TEST_SESSION_FILE       "pbr_session.tmp"
+#define PBR_TEST_LEGACY_CTX_FILE    "pbr_ctx.tmp"
+#define PBR_TEST_LEGACY_MAIN_FILE   "pbr_main.tmp"
+
+#pragma pack(push)
+#pragma pack(1)
+// PbrContext of the previous format, as its context file holds it
+struct pbr_legacy_ctx
+{
+  UINT32 mode;
+  VOID *p_main_header;
+  struct
+  {
+    UINT32 signature;
+    UINT32 size;
+    UINT32 logical_data_cnt;
+    UINT32 current_offset;
+    UINT32 end_offset;
+    VOID *p_data;
+  } partitions[MAX_PARTITIONS];
+};
+#pragma pack(pop)
+
+// Items of a pass through partition as the previous format lays them out
+static std::vector<UINT8> pbr_test_legacy_partition(UINT32 count)
+{
+  std::vector<UINT8> partition;
+  for (UINT32 i = 0; i < count; i++)
+  {
+    PbrPartitionLogicalDataItem item = { PBR_LOGICAL_DATA_SIG, PBR_TEST_RECORD_SIZE, i };
+    UINT8 record[PBR_TEST_RECORD_SIZE];
+    pbr_test_record(i, record);
+    partition.insert(partition.end(), (UINT8 *)&item, (UINT8 *)(&item + 1));
+    partition.insert(partition.end(), record, record + sizeof(record));
+  }
+  return partition;
+}
+
+// Selects the recorded pass through whose number pMatchCtx points to
+static BOOLEAN pbr_test_match_record(VOID *p_data, UINT32 size, VOID *p_match_ctx)
+{
+  return size >= sizeof(UINT32) && 0 == memcmp(p_data, p_match_ctx, sizeof(UINT32));
+}
+
+static void pbr_test_write_file(const std::string &path, const VOID *p_data, size_t size)
+{
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  file.write((const char *)p_data, size);
+  ASSERT_TRUE(file.good()) << path;
+}
+
+class PbrSession_Tests : public ::testing::Test
+{
+protected:
+  PbrTestSession session;
+
+  virtual void SetUp()
+  {
+    ASSERT_TRUE(session.Open());
+  }
+
+  virtual void TearDown()
+  {
+    session.Close();
+  }
+
+  // Save the session the way a command exits, leaving the next one in playback
+  void SaveForPlayback()
+  {
+    session.Record(PBR_TEST_LEGACY_RECORDS);
+    ASSERT_EQ(EFI_SUCCESS, PbrUninit());
+    ASSERT_EQ(EFI_SUCCESS, PbrInit());
+    ASSERT_EQ(EFI_SUCCESS, PbrSetMode(PBR_PLAYBACK_MODE));
+    ASSERT_EQ(EFI_SUCCESS, PbrUninit());
+  }
+
+  void ExpectNormalMode()
+  {
+    UINT32 mode = PBR_RECORD_MODE;
+    ASSERT_EQ(EFI_SUCCESS, PbrGetMode(&mode));
+    EXPECT_EQ((UINT32)PBR_NORMAL_MODE, mode);
+  }
+};
+
+TEST_F(PbrSession_Tests, ContainerRoundTrips)
+{
+  session.Record(PBR_TEST_RECORDS);
+  UINT8 table[64] = { 0x5a };
+  ASSERT_EQ(EFI_SUCCESS, PbrSetData(PBR_SMBIOS_SIG, table, sizeof(table), TRUE, NULL, NULL));
+  session.Reload();
+
+  // Indexed lookups, any order
+  CONST VOID *p_view = NULL;
+  UINT32 size = 0;
+  UINT32 logical_index = 0;
+  for (INT32 i = PBR_TEST_RECORDS - 1; i >= 0; i -= 7)
+  {
+    ASSERT_EQ(EFI_SUCCESS, PbrGetDataView(PBR_PASS_THRU_SIG, i, &p_view, &size, &logical_index));
+    EXPECT_TRUE(pbr_test_record_matches(i, p_view, size));
+    EXPECT_EQ((UINT32)i, logical_index);
+  }
+  EXPECT_NE(EFI_SUCCESS, PbrGetDataView(PBR_PASS_THRU_SIG, PBR_TEST_RECORDS, &p_view, &size, NULL));
+
+  // Next item, copied and in place, then the end of the partition
+  for (UINT32 i = 0; i < PBR_TEST_RECORDS; i++)
+  {
+    if (i % 2)
+    {
+      ASSERT_EQ(EFI_SUCCESS, PbrGetDataView(PBR_PASS_THRU_SIG, GET_NEXT_DATA_INDEX, &p_view, &size, NULL));
+      EXPECT_TRUE(pbr_test_record_matches(i, p_view, size));
+    }
+    else
+    {
+      VOID *p_copy = NULL;
+      ASSERT_EQ(EFI_SUCCESS, PbrGetData(PBR_PASS_THRU_SIG, GET_NEXT_DATA_INDEX, &p_copy, &size, NULL));
+      EXPECT_TRUE(pbr_test_record_matches(i, p_copy, size));
+      free(p_copy);
+    }
+  }
+  EXPECT_NE(EFI_SUCCESS, PbrGetDataView(PBR_PASS_THRU_SIG, GET_NEXT_DATA_INDEX, &p_view, &size, NULL));
+
+  ASSERT_EQ(EFI_SUCCESS, PbrGetDataView(PBR_SMBIOS_SIG, 0, &p_view, &size, NULL));
+  EXPECT_EQ(sizeof(table), size);
+  EXPECT_EQ(0, memcmp(table, p_view, sizeof(table)));
+}
+
+TEST_F(PbrSession_Tests, DamagedContainersAreRejected)
+{
+  session.Record(PBR_TEST_RECORDS);
+  VOID *p_session = NULL;
+  UINT32 size = 0;
+  ASSERT_EQ(EFI_SUCCESS, PbrGetSession(&p_session, &size));
+
+  // Every copy is handed over to the session
+  std::vector<UINT8> saved((UINT8 *)p_session, (UINT8 *)p_session + size);
+  free(p_session);
+  const size_t damage[] = { 8, 200, size / 2, size - 1 };
+  for (size_t offset : damage)
+  {
+    UINT8 *p_copy = (UINT8 *)malloc(size);
+    memcpy(p_copy, saved.data(), size);
+    p_copy[offset] ^= 0x01;
+    EXPECT_NE(EFI_SUCCESS, PbrSetSession(p_copy, size)) << "byte " << offset;
+  }
+
+  UINT8 *p_copy = (UINT8 *)malloc(size);
+  memcpy(p_copy, saved.data(), size);
+  EXPECT_NE(EFI_SUCCESS, PbrSetSession(p_copy, size - 1));
+
+  p_copy = (UINT8 *)malloc(size);
+  memcpy(p_copy, saved.data(), size);
+  EXPECT_EQ(EFI_SUCCESS, PbrSetSession(p_copy, size));
+}
+
+TEST_F(PbrSession_Tests, ItemSizesAreBoundedByThePartition)
+{
+  SaveForPlayback();
+  std::vector<UINT8> saved;
+  {
+    std::ifstream file(session.Path(PBR_TEST_SESSION_FILE), std::ios::binary);
+    saved.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+  }
+  ASSERT_LE(sizeof(PbrSessionHeader), saved.size());
+
+  // The items of a mapped session are not checked on load, as if its writer had recorded a bad size
+  PbrSessionHeader *p_header = (PbrSessionHeader *)saved.data();
+  PbrSessionPartition *p_entry = (PbrSessionPartition *)(saved.data() + p_header->DirectoryOffset);
+  PbrSessionPartition *p_end = p_entry + p_header->PartitionCnt;
+  while (p_entry < p_end && PBR_PASS_THRU_SIG != p_entry->Signature)
+  {
+    p_entry++;
+  }
+  ASSERT_LT(p_entry, p_end);
+  UINT32 *p_item_offsets = (UINT32 *)(saved.data() + p_entry->ItemTableOffset);
+  PbrPartitionLogicalDataItem *p_item = (PbrPartitionLogicalDataItem *)(saved.data() + p_entry->DataOffset +
+    p_item_offsets[PBR_TEST_CORRUPTED_RECORD]);
+  p_item->Size = 0xFFFFFF00;
+  p_entry->DataChecksum = Fletcher64(saved.data() + p_entry->DataOffset, p_entry->DataSize);
+  p_header->DirectoryChecksum = Fletcher64(saved.data() + p_header->DirectoryOffset,
+    p_header->PartitionCnt * sizeof(*p_entry));
+  p_header->HeaderChecksum = Fletcher64(p_header, OFFSET_OF(PbrSessionHeader, HeaderChecksum));
+  pbr_test_write_file(session.Path(PBR_TEST_SESSION_FILE), saved.data(), saved.size());
+
+  // Play back from the start of the recording
+  PbrContext saved_ctx;
+  {
+    std::ifstream file(session.Path(PBR_TEST_CTX_FILE), std::ios::binary);
+    file.read((char *)&saved_ctx, sizeof(saved_ctx));
+    ASSERT_TRUE(file.good());
+  }
+  for (auto &partition : saved_ctx.PartitionContexts)
+  {
+    partition.PartitionCurrentOffset = 0;
+  }
+  pbr_test_write_file(session.Path(PBR_TEST_CTX_FILE), &saved_ctx, sizeof(saved_ctx));
+
+  ASSERT_EQ(EFI_SUCCESS, PbrInit());
+  UINT32 mode = PBR_NORMAL_MODE;
+  ASSERT_EQ(EFI_SUCCESS, PbrGetMode(&mode));
+  ASSERT_EQ((UINT32)PBR_PLAYBACK_MODE, mode);
+
+  // Indexed lookups only miss the bad item
+  CONST VOID *p_view = NULL;
+  UINT32 size = 0;
+  for (INT32 i = 0; i < PBR_TEST_LEGACY_RECORDS; i++)
+  {
+    if (PBR_TEST_CORRUPTED_RECORD == i)
+    {
+      EXPECT_EQ(EFI_NOT_FOUND, PbrGetDataView(PBR_PASS_THRU_SIG, i, &p_view, &size, NULL));
+      continue;
+    }
+    ASSERT_EQ(EFI_SUCCESS, PbrGetDataView(PBR_PASS_THRU_SIG, i, &p_view, &size, NULL));
+    EXPECT_TRUE(pbr_test_record_matches(i, p_view, size));
+  }
+
+  // Matching stops the scan at the bad item
+  UINT32 record = PBR_TEST_CORRUPTED_RECORD + 1;
+  EXPECT_EQ(EFI_NOT_FOUND, PbrGetMatchingDataView(PBR_PASS_THRU_SIG, pbr_test_match_record, &record, &p_view, &size));
+  record = 0;
+  ASSERT_EQ(EFI_SUCCESS, PbrGetMatchingDataView(PBR_PASS_THRU_SIG, pbr_test_match_record, &record, &p_view, &size));
+  EXPECT_TRUE(pbr_test_record_matches(record, p_view, size));
+
+  // Playback in order stops at it too, without moving past it
+  for (UINT32 i = 1; i < PBR_TEST_CORRUPTED_RECORD; i++)
+  {
+    ASSERT_EQ(EFI_SUCCESS, PbrGetDataView(PBR_PASS_THRU_SIG, GET_NEXT_DATA_INDEX, &p_view, &size, NULL));
+    EXPECT_TRUE(pbr_test_record_matches(i, p_view, size));
+  }
+  EXPECT_EQ(EFI_NOT_FOUND, PbrGetDataView(PBR_PASS_THRU_SIG, GET_NEXT_DATA_INDEX, &p_view, &size, NULL));
+  EXPECT_EQ(EFI_NOT_FOUND, PbrGetDataView(PBR_PASS_THRU_SIG, GET_NEXT_DATA_INDEX, &p_view, &size, NULL));
+}
+
+TEST_F(PbrSession_Tests, LegacyImagesAreConverted)
+{
+  // Pass through partition with unused space behind the items, and a singleton that shrank
+  std::vector<UINT8> pass_thru = pbr_test_legacy_partition(PBR_TEST_RECORDS);
+  pass_thru.resize(pass_thru.size() + 100 * (sizeof(PbrPartitionLogicalDataItem) + PBR_TEST_RECORD_SIZE), 0);
+
+  std::vector<UINT8> singleton(sizeof(PbrPartitionLogicalDataItem) + 64, 0xee);
+  PbrPartitionLogicalDataItem item = { PBR_LOGICAL_DATA_SIG, 16, 0 };
+  memcpy(singleton.data(), &item, sizeof(item));
+  // Left over from the larger table it replaced
+  item.Size = 36;
+  memcpy(singleton.data() + sizeof(item) + 16, &item, sizeof(item));
+
+  std::vector<UINT8> image(sizeof(PbrHeader), 0);
+  PbrHeader *p_header = (PbrHeader *)image.data();
+  p_header->Signature = PBR_HEADER_SIG;
+  strcpy(p_header->SwVersion, "01.00.00.0000");
+  p_header->PartitionTable.Partitions[0] = { PBR_PASS_THRU_SIG, (UINT32)pass_thru.size(),
+    (UINT32)image.size(), PBR_TEST_RECORDS };
+  p_header->PartitionTable.Partitions[1] = { PBR_SMBIOS_SIG, (UINT32)singleton.size(),
+    (UINT32)(image.size() + pass_thru.size()), 1 };
+  image.insert(image.end(), pass_thru.begin(), pass_thru.end());
+  image.insert(image.end(), singleton.begin(), singleton.end());
+
+  VOID *p_session = NULL;
+  UINT32 session_size = 0;
+  EXPECT_NE(EFI_SUCCESS, PbrConvertLegacySession(image.data(), (UINT32)image.size() - 1, &p_session, &session_size));
+  ASSERT_EQ(EFI_SUCCESS, PbrConvertLegacySession(image.data(), (UINT32)image.size(), &p_session, &session_size));
+  ASSERT_EQ(PBR_SESSION_SIG, *(UINT32 *)p_session);
+  // The unused space is left behind, the item offsets take less
+  EXPECT_LT(session_size, image.size());
+  free(p_session);
+
+  // Loading a legacy image converts it too
+  VOID *p_image = malloc(image.size());
+  memcpy(p_image, image.data(), image.size());
+  ASSERT_EQ(EFI_SUCCESS, PbrSetSession(p_image, (UINT32)image.size()));
+  ASSERT_EQ(EFI_SUCCESS, PbrSetMode(PBR_PLAYBACK_MODE));
+
+  CONST VOID *p_view = NULL;
+  UINT32 size = 0;
+  for (UINT32 i = 0; i < PBR_TEST_RECORDS; i++)
+  {
+    ASSERT_EQ(EFI_SUCCESS, PbrGetDataView(PBR_PASS_THRU_SIG, GET_NEXT_DATA_INDEX, &p_view, &size, NULL));
+    EXPECT_TRUE(pbr_test_record_matches(i, p_view, size));
+  }
+  EXPECT_NE(EFI_SUCCESS, PbrGetDataView(PBR_PASS_THRU_SIG, GET_NEXT_DATA_INDEX, &p_view, &size, NULL));
+  ASSERT_EQ(EFI_SUCCESS, PbrGetDataView(PBR_SMBIOS_SIG, 0, &p_view, &size, NULL));
+  EXPECT_EQ(16u, size);
+  EXPECT_NE(EFI_SUCCESS, PbrGetDataView(PBR_SMBIOS_SIG, 1, &p_view, &size, NULL));
+}
+
+TEST_F(PbrSession_Tests, LegacyFilesAreConvertedOnInit)
+{
+  SaveForPlayback();
+  // As the previous release left them: no container, a file per partition
+  ASSERT_EQ(0, remove(session.Path(PBR_TEST_CTX_FILE).c_str()));
+  remove(session.Path(PBR_TEST_SESSION_FILE).c_str());
+
+  std::vector<UINT8> pass_thru = pbr_test_legacy_partition(PBR_TEST_LEGACY_RECORDS);
+  size_t item_size = sizeof(PbrPartitionLogicalDataItem) + PBR_TEST_RECORD_SIZE;
+  pbr_legacy_ctx legacy_ctx;
+  memset(&legacy_ctx, 0, sizeof(legacy_ctx));
+  legacy_ctx.mode = PBR_PLAYBACK_MODE;
+  legacy_ctx.partitions[0].signature = PBR_PASS_THRU_SIG;
+  legacy_ctx.partitions[0].size = (UINT32)pass_thru.size();
+  legacy_ctx.partitions[0].logical_data_cnt = PBR_TEST_LEGACY_RECORDS;
+  legacy_ctx.partitions[0].current_offset = (UINT32)(PBR_TEST_LEGACY_CURSOR * item_size);
+  legacy_ctx.partitions[0].end_offset = (UINT32)pass_thru.size();
+  pbr_test_write_file(session.Path(PBR_TEST_LEGACY_CTX_FILE), &legacy_ctx, sizeof(legacy_ctx));
+
+  PbrHeader header;
+  memset(&header, 0, sizeof(header));
+  header.Signature = PBR_HEADER_SIG;
+  pbr_test_write_file(session.Path(PBR_TEST_LEGACY_MAIN_FILE), &header, sizeof(header));
+
+  char partition_file[32];
+  snprintf(partition_file, sizeof(partition_file), "%x.pbr", PBR_PASS_THRU_SIG);
+  pbr_test_write_file(session.Path(partition_file), pass_thru.data(), pass_thru.size());
+
+  ASSERT_EQ(EFI_SUCCESS, PbrInit());
+  UINT32 mode = PBR_NORMAL_MODE;
+  ASSERT_EQ(EFI_SUCCESS, PbrGetMode(&mode));
+  EXPECT_EQ((UINT32)PBR_PLAYBACK_MODE, mode);
+
+  CONST VOID *p_view = NULL;
+  UINT32 size = 0;
+  for (UINT32 i = PBR_TEST_LEGACY_CURSOR; i < PBR_TEST_LEGACY_RECORDS; i++)
+  {
+    ASSERT_EQ(EFI_SUCCESS, PbrGetDataView(PBR_PASS_THRU_SIG, GET_NEXT_DATA_INDEX, &p_view, &size, NULL));
+    EXPECT_TRUE(pbr_test_record_matches(i, p_view, size));
+  }
+  EXPECT_NE(EFI_SUCCESS, PbrGetDataView(PBR_PASS_THRU_SIG, GET_NEXT_DATA_INDEX, &p_view, &size, NULL));
+
+  // Saved again as a container, the next command does not convert it
+  EXPECT_TRUE(session.Exists(PBR_TEST_CTX_FILE));
+  EXPECT_TRUE(session.Exists(PBR_TEST_SESSION_FILE));
+}
+
+TEST_F(PbrSession_Tests, UnusableSessionFilesAreIgnored)
+{
+  SaveForPlayback();
+  ASSERT_TRUE(session.Exists(PBR_TEST_SESSION_FILE));
+
+  // Damaged container
+  std::vector<UINT8> zeros(64, 0);
+  {
+    std::fstream file(session.Path(PBR_TEST_SESSION_FILE), std::ios::binary | std::ios::in | std::ios::out);
+    file.write((const char *)zeros.data(), zeros.size());
+  }
+  ASSERT_EQ(EFI_SUCCESS, PbrInit());
+  ExpectNormalMode();
+
+  // Context file of another size, e.g. written by another release
+  pbr_test_write_file(session.Path(PBR_TEST_CTX_FILE), zeros.data(), zeros.size());
+  ASSERT_EQ(EFI_SUCCESS, PbrInit());
+  ExpectNormalMode();
+
+  // Truncated legacy files
+  ASSERT_EQ(0, remove(session.Path(PBR_TEST_CTX_FILE).c_str()));
+  pbr_test_write_file(session.Path(PBR_TEST_LEGACY_CTX_FILE), zeros.data(), zeros.size());
+  ASSERT_EQ(EFI_SUCCESS, PbrInit());
+  ExpectNormalMode();
+}
+#endif // __linux__
+
+#endif // PBR_SESSION_TESTS_H
@@ -0,0 +1,144 @@
+/*
+ * Copyright (c) 2018, Intel Corporation.
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+#ifndef PBR_TEST_SESSION_H
+#define PBR_TEST_SESSION_H
+
+#include <gtest/gtest.h>
+#include <string>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+
+extern "C" {
+#include <AutoGen.h>
+#include <Pbr.h>
+#include <FwUtility.h>
+#include <PbrDcpmm.h>
+#include <PbrOs.h>
+}
+
+// An Identify DIMM pass through: request and response headers and a small output payload
+#define PBR_TEST_RECORD_SIZE        (24 + 32 + 128)
+#define PBR_TEST_DIR_TEMPLATE       "/tmp/ipmctl_pbr_test_XXXXXX"
+
+// Contents of the recorded pass through number i
+static void pbr_test_record(UINT32 i, UINT8 *p_record)
+{
+  for (UINT32 byte = 0; byte < PBR_TEST_RECORD_SIZE; byte++)
+  {
+    p_record[byte] = (UINT8)(i * 31 + byte);
+  }
+  memcpy(p_record, &i, sizeof(i));
+}
+
+static bool pbr_test_record_matches(UINT32 i, const VOID *p_data, UINT32 size)
+{
+  UINT8 expected[PBR_TEST_RECORD_SIZE];
+  pbr_test_record(i, expected);
+  return PBR_TEST_RECORD_SIZE == size && 0 == memcmp(expected, p_data, size);
+}
+
+// A recording session kept in a directory of its own, so the session of the
+// user in PBR_TMP_DIR is left alone. Shared by the tests and the benchmark.
+class PbrTestSession
+{
+public:
+  std::string dir;
+
+  ~PbrTestSession()
+  {
+    Close();
+  }
+
+  bool Open()
+  {
+    char dir_template[] = PBR_TEST_DIR_TEMPLATE;
+    if (NULL == mkdtemp(dir_template))
+    {
+      return false;
+    }
+    dir = std::string(dir_template) + "/";
+    return EFI_SUCCESS == PbrSetTmpDir(dir.c_str()) &&
+      EFI_SUCCESS == PbrSetSession(NULL, 0) &&
+      EFI_SUCCESS == PbrSetMode(PBR_RECORD_MODE);
+  }
+
+  // Drop the session, its files and the shared memory keyed on the directory
+  void Close()
+  {
+    if (dir.empty())
+    {
+      return;
+    }
+    PbrSetMode(PBR_NORMAL_MODE);
+    PbrUninit();
+
+    const int ids[] = { 'h', 'i' };
+    for (int id : ids)
+    {
+      int shm_id = shmget(ftok(dir.c_str(), id), 0, 0);
+      if (-1 != shm_id)
+      {
+        shmctl(shm_id, IPC_RMID, NULL);
+      }
+    }
+
+    DIR *p_dir = opendir(dir.c_str());
+    if (NULL != p_dir)
+    {
+      struct dirent *p_entry;
+      while (NULL != (p_entry = readdir(p_dir)))
+      {
+        if (0 != strcmp(".", p_entry->d_name) && 0 != strcmp("..", p_entry->d_name))
+        {
+          remove(Path(p_entry->d_name).c_str());
+        }
+      }
+      closedir(p_dir);
+    }
+    rmdir(dir.c_str());
+    PbrSetTmpDir(NULL);
+    dir.clear();
+  }
+
+  std::string Path(const std::string &file_name) const
+  {
+    return dir + file_name;
+  }
+
+  bool Exists(const std::string &file_name) const
+  {
+    return 0 == access(Path(file_name).c_str(), F_OK);
+  }
+
+  void Record(UINT32 count)
+  {
+    UINT8 record[PBR_TEST_RECORD_SIZE];
+    UINT32 logical_index = 0;
+    for (UINT32 i = 0; i < count; i++)
+    {
+      pbr_test_record(i, record);
+      ASSERT_EQ(EFI_SUCCESS, PbrSetData(PBR_PASS_THRU_SIG, record, sizeof(record), FALSE, NULL, &logical_index));
+      ASSERT_EQ(i, logical_index);
+    }
+  }
+
+  // Replace the session by the container of the recorded one
+  void Reload()
+  {
+    VOID *p_session = NULL;
+    UINT32 size = 0;
+    ASSERT_EQ(EFI_SUCCESS, PbrGetSession(&p_session, &size));
+    ASSERT_EQ(PBR_SESSION_SIG, *(UINT32 *)p_session);
+    ASSERT_EQ(EFI_SUCCESS, PbrSetSession(p_session, size));
+    ASSERT_EQ(EFI_SUCCESS, PbrSetMode(PBR_PLAYBACK_MODE));
+  }
+};
+
+#endif // PBR_TEST_SESSION_H
@@ -0,0 +1,244 @@
+/*
+ * Copyright (c) 2018, Intel Corporation.
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+#ifndef TEXT_TABLE_TESTS_H
+#define TEXT_TABLE_TESTS_H
+
+#ifdef __linux__
+#include <gtest/gtest.h>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <wchar.h>
+#include "CliOutputHarness.h"
+
+extern "C" {
+#include <AutoGen.h>
+#include <Printer.h>
+}
+
+#define TEXT_TABLE_TEST_SOCKETS     2
+#define TEXT_TABLE_TEST_DIMMS       40
+#define TEXT_TABLE_TEST_ROOT_PATH   L"/SocketList"
+#define TEXT_TABLE_TEST_SOCKET_PATH L"/SocketList/Socket"
+#define TEXT_TABLE_TEST_DIMM_PATH   L"/SocketList/Socket/Dimm"
+
+// Output format suffixes of the golden files, text tables by default and streamed
+#define TEXT_TABLE_DEFAULT_SUFFIX   "text"
+#define TEXT_TABLE_STREAM_FORMAT    "stream"
+
+// show commands displayed as a table by default
+static const cli_command g_table_show_commands[] = {
+  { "dimm", "show", "", "-dimm" },
+  { "topology", "show", "", "-topology" },
+  { "region", "show", "", "-region" },
+  { "sensor", "show", "", "-sensor" },
+  { "socket", "show", "", "-socket" },
+  { "goal", "show", "", "-goal" },
+  { "firmware", "show", "", "-dimm -firmware" },
+};
+
+// Table printed by the printer directly, the columns come from two levels of the data set
+static const cli_command g_rendered_table = { "table", "", "", "" };
+
+static PRINTER_TABLE_ATTRIB g_text_table_test_attribs =
+{
+  {
+    { L"SocketID", 10, TEXT_TABLE_TEST_SOCKET_PATH PATH_KEY_DELIM L"SocketID" },
+    { L"DimmID", 8, TEXT_TABLE_TEST_DIMM_PATH PATH_KEY_DELIM L"DimmID" },
+    { L"Capacity", 16, TEXT_TABLE_TEST_DIMM_PATH PATH_KEY_DELIM L"Capacity" },
+    { L"HealthState", 12, TEXT_TABLE_TEST_DIMM_PATH PATH_KEY_DELIM L"HealthState" },
+    { L"FWVersion", 16, TEXT_TABLE_TEST_DIMM_PATH PATH_KEY_DELIM L"FWVersion" },
+  }
+};
+
+static PRINTER_DATA_SET_ATTRIBS g_text_table_test_data_set_attribs =
+{
+  NULL,
+  &g_text_table_test_attribs
+};
+
+// Split the lines of a table into trimmed cells
+static std::vector<std::vector<std::string> > table_cells(const std::string &text)
+{
+  std::vector<std::vector<std::string> > rows;
+  std::istringstream lines(text);
+  std::string line;
+  while (std::getline(lines, line))
+  {
+    std::vector<std::string> cells;
+    std::istringstream fields(line);
+    std::string cell;
+    while (std::getline(fields, cell, '|'))
+    {
+      size_t first = cell.find_first_not_of(' ');
+      size_t last = cell.find_last_not_of(' ');
+      cells.push_back(std::string::npos == first ? "" : cell.substr(first, last - first + 1));
+    }
+    rows.push_back(cells);
+  }
+  return rows;
+}
+
+// Set a key of the data set at path, the way the PRINTER_SET_KEY_VAL_WIDE_STR macro does
+static void set_table_key(PRINT_CONTEXT *p_ctx, const std::wstring &path, const CHAR16 *p_key, const std::wstring &val)
+{
+  DATA_SET_CONTEXT *p_data_set = NULL;
+  std::wstring key_path = path;
+  if (EFI_SUCCESS == LookupDataSet(p_ctx, &key_path[0], &p_data_set))
+  {
+    SetKeyValueWideStr(p_data_set, p_key, val.c_str());
+  }
+}
+
+class TextTable_Tests : public ::testing::Test, public CliOutputHarness
+{
+protected:
+  // Print the test table through the printer in a child process, as a show command would
+  std::string RenderTable(bool streaming)
+  {
+    return RunCaptured([streaming]() {
+      PRINT_CONTEXT *p_ctx = NULL;
+      if (NVM_SUCCESS != nvm_init() || EFI_SUCCESS != PrinterCreateCtx(&p_ctx))
+      {
+        return 1;
+      }
+      p_ctx->FormatType = TEXT;
+      PRINTER_ENABLE_TEXT_TABLE_FORMAT(p_ctx);
+      if (streaming)
+      {
+        PRINTER_ENABLE_TEXT_TABLE_STREAMING(p_ctx);
+      }
+
+      for (int socket = 0; socket < TEXT_TABLE_TEST_SOCKETS; socket++)
+      {
+        std::wstring socket_path = TEXT_TABLE_TEST_SOCKET_PATH L"[" + std::to_wstring(socket) + L"]";
+        wchar_t socket_id[16];
+        swprintf(socket_id, 16, L"0x%04x", socket);
+        set_table_key(p_ctx, socket_path, L"SocketID", socket_id);
+
+        for (int dimm = 0; dimm < TEXT_TABLE_TEST_DIMMS; dimm++)
+        {
+          std::wstring dimm_path = socket_path + L"/Dimm[" + std::to_wstring(dimm) + L"]";
+          wchar_t dimm_id[16];
+          swprintf(dimm_id, 16, L"0x%04x", (socket << 12) | (dimm << 4));
+          set_table_key(p_ctx, dimm_path, L"DimmID", dimm_id);
+          // Values wider than the column are cut
+          set_table_key(p_ctx, dimm_path, L"Capacity",
+            (0 == dimm % 9) ? L"1234567890123.000 GiB" : std::to_wstring(126 + dimm) + L".375 GiB");
+          // Missing values are shown as X, values may hold format specifiers
+          if (0 != dimm % 7)
+          {
+            set_table_key(p_ctx, dimm_path, L"HealthState", (0 == dimm % 5) ? L"100%s" : L"Healthy");
+          }
+          // The last column is not cut
+          set_table_key(p_ctx, dimm_path, L"FWVersion",
+            (0 == dimm % 11) ? L"01.02.00.5375, 01.02.00.5367 staged" : L"01.02.00." + std::to_wstring(5300 + dimm));
+        }
+      }
+
+      SetDataSetPrinterAttribs(p_ctx, (CHAR16 *)TEXT_TABLE_TEST_ROOT_PATH, &g_text_table_test_data_set_attribs);
+      EFI_STATUS rc = PrinterProcessSetBuffer(p_ctx);
+      PrinterDestroyCtx(p_ctx);
+      return (EFI_SUCCESS == rc) ? 0 : 1;
+    });
+  }
+
+  // Only the column widths differ between a table and its streamed version, and the separator with them
+  void CheckSameCells(const std::string &what, const std::string &sized, const std::string &streamed)
+  {
+    std::vector<std::vector<std::string> > sized_cells = table_cells(sized);
+    std::vector<std::vector<std::string> > streamed_cells = table_cells(streamed);
+    ASSERT_EQ(sized_cells.size(), streamed_cells.size()) << what;
+    for (size_t row = 0; row < sized_cells.size(); row++)
+    {
+      if (1 == row)
+      {
+        continue;
+      }
+      EXPECT_EQ(sized_cells[row], streamed_cells[row]) << what << " row " << row;
+    }
+
+    // Streamed columns all have their max width, the header line gives it
+    std::istringstream lines(streamed);
+    std::string header;
+    std::getline(lines, header);
+    std::string separator;
+    std::getline(lines, separator);
+    EXPECT_EQ(std::string(header.size(), '='), separator) << what;
+  }
+};
+
+TEST_F(TextTable_Tests, HostCommandsMatchGolden)
+{
+  for (auto &cmd : g_cli_host_commands)
+  {
+    int rc = 0;
+    std::string text = RunCli(cmd, NULL, &rc);
+    CompareWithGolden(GoldenPath(cmd, TEXT_TABLE_DEFAULT_SUFFIX), text);
+
+    // Streaming only changes tables
+    int stream_rc = 0;
+    EXPECT_EQ(text, RunCli(cmd, TEXT_TABLE_STREAM_FORMAT, &stream_rc)) << cmd.p_name;
+    EXPECT_EQ(rc, stream_rc) << cmd.p_name;
+  }
+}
+
+TEST_F(TextTable_Tests, RenderedTableMatchesGolden)
+{
+  std::string sized = RenderTable(false);
+  std::string streamed = RenderTable(true);
+  CompareWithGolden(GoldenPath(g_rendered_table, TEXT_TABLE_DEFAULT_SUFFIX), sized);
+  CompareWithGolden(GoldenPath(g_rendered_table, TEXT_TABLE_STREAM_FORMAT), streamed);
+
+  // A header, the separator and a row per DIMM
+  EXPECT_EQ((size_t)TEXT_TABLE_TEST_SOCKETS * TEXT_TABLE_TEST_DIMMS + 2, table_cells(sized).size());
+  CheckSameCells(g_rendered_table.p_name, sized, streamed);
+}
+
+TEST_F(TextTable_Tests, ShowCommandsMatchGolden)
+{
+  if (!LoadSessions())
+  {
+    GTEST_SKIP() << "set " CLI_OUTPUT_CORPUS_ENV " to a directory of recorded sessions to run this test";
+  }
+
+  for (auto &session : sessions)
+  {
+    ASSERT_TRUE(StartSession(session)) << session;
+    for (auto &cmd : g_table_show_commands)
+    {
+      CompareWithGolden(GoldenPath(session, cmd, TEXT_TABLE_DEFAULT_SUFFIX), RunCli(cmd));
+      CompareWithGolden(GoldenPath(session, cmd, TEXT_TABLE_STREAM_FORMAT), RunCli(cmd, TEXT_TABLE_STREAM_FORMAT));
+    }
+    StopSession();
+  }
+}
+
+TEST_F(TextTable_Tests, StreamedTablesHoldTheSameCells)
+{
+  if (!LoadSessions())
+  {
+    GTEST_SKIP() << "set " CLI_OUTPUT_CORPUS_ENV " to a directory of recorded sessions to run this test";
+  }
+
+  for (auto &session : sessions)
+  {
+    ASSERT_TRUE(StartSession(session)) << session;
+    for (auto &cmd : g_table_show_commands)
+    {
+      int rc = 0;
+      int stream_rc = 0;
+      std::string sized = RunCli(cmd, NULL, &rc);
+      std::string streamed = RunCli(cmd, TEXT_TABLE_STREAM_FORMAT, &stream_rc);
+      ASSERT_EQ(0, rc) << session << " " << cmd.p_name;
+      ASSERT_EQ(0, stream_rc) << session << " " << cmd.p_name;
+      CheckSameCells(session + " " + cmd.p_name, sized, streamed);
+    }
+    StopSession();
+  }
+}
+#endif // __linux__
+
+#endif // TEXT_TABLE_TESTS_H
@@ -0,0 +1,111 @@
+/*
+ * Copyright (c) 2018, Intel Corporation.
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+#ifndef XML_OUTPUT_TESTS_H
+#define XML_OUTPUT_TESTS_H
+
+#ifdef __linux__
+#include <gtest/gtest.h>
+#include <string>
+#include "CliOutputHarness.h"
+
+// Output formats wrapped in XML, also the suffix of their golden files
+static const char *g_xml_formats[] = { "nvmxml", "esx", "esxtable" };
+
+class XmlOutput_Tests : public ::testing::Test, public CliOutputHarness
+{
+};
+
+TEST_F(XmlOutput_Tests, HostCommandsMatchGolden)
+{
+  for (auto &cmd : g_cli_host_commands)
+  {
+    for (auto p_format : g_xml_formats)
+    {
+      CompareWithGolden(GoldenPath(cmd, p_format), RunCli(cmd, p_format));
+    }
+  }
+}
+
+TEST_F(XmlOutput_Tests, ShowCommandsMatchGolden)
+{
+  if (!LoadSessions())
+  {
+    GTEST_SKIP() << "set " CLI_OUTPUT_CORPUS_ENV " to a directory of recorded sessions to run this test";
+  }
+
+  for (auto &session : sessions)
+  {
+    ASSERT_TRUE(StartSession(session)) << session;
+    for (auto &cmd : g_cli_show_commands)
+    {
+      for (auto p_format : g_xml_formats)
+      {
+        CompareWithGolden(GoldenPath(session, cmd, p_format), RunCli(cmd, p_format));
+      }
+    }
+    StopSession();
+  }
+}
+
+TEST_F(XmlOutput_Tests, CapturedHelpIsWrapped)
+{
+  std::string xml = RunCli("version", "-help", "", "nvmxml");
+  EXPECT_EQ(0u, xml.find("<Results>\n<Result>\n")) << xml;
+  EXPECT_NE(std::string::npos, xml.find("</Result>\n</Results>\n")) << xml;
+
+  std::string esx = RunCli("version", "-help", "", "esx");
+  EXPECT_EQ(0u, esx.find("<?xml")) << esx;
+  EXPECT_NE(std::string::npos, esx.find("<![CDATA[")) << esx;
+}
+
+TEST_F(XmlOutput_Tests, CapturedSyntaxErrorIsWrapped)
+{
+  int rc = 0;
+  std::string xml = RunCli("show", "", "-nosuchtarget", "nvmxml", &rc);
+  EXPECT_NE(0, rc);
+  EXPECT_EQ(0u, xml.find("<Error Type=\"")) << xml;
+  EXPECT_NE(std::string::npos, xml.find("</Error>\n")) << xml;
+
+  // ESX takes errors as one line of text
+  std::string esx = RunCli("show", "", "-nosuchtarget", "esx");
+  EXPECT_EQ(0u, esx.find("ERROR: ")) << esx;
+  EXPECT_EQ(std::string::npos, esx.find('\n')) << esx;
+}
+
+TEST_F(XmlOutput_Tests, StdoutUsableAfterCapture)
+{
+  // Used to close stdout once a command stopped its capture, losing the output of the next ones
+  std::string text = RunCaptured([]() {
+    char arg0[] = "ipmctl";
+    char version[] = "version";
+    char help[] = "help";
+    char output[] = "-o";
+    char nvmxml[] = "nvmxml";
+    char *captured_version[] = { arg0, version, output, nvmxml, NULL };
+    char *captured_help[] = { arg0, help, output, nvmxml, NULL };
+    char *plain_version[] = { arg0, version, NULL };
+
+    for (int i = 0; i < 4; i++)
+    {
+      nvm_run_cli(4, captured_version);
+      nvm_run_cli(4, captured_help);
+    }
+    return nvm_run_cli(2, plain_version);
+  });
+
+  // Every captured command printed its own output, and the last one plain text
+  size_t count = 0;
+  for (size_t pos = 0; std::string::npos != (pos = text.find("<SoftwareList>", pos)); pos++)
+  {
+    count++;
+  }
+  EXPECT_EQ(4u, count) << text;
+  size_t last_line = text.rfind('\n', text.size() - 2);
+  ASSERT_NE(std::string::npos, last_line) << text;
+  EXPECT_NE(std::string::npos, text.find(" Version ", last_line)) << text;
+}
+#endif // __linux__
+
+#endif // XML_OUTPUT_TESTS_H
@@ -28,6 +28,11 @@ typedef wchar_t OS_WPATH[OS_PATH_LEN];
 typedef char OS_PATH[OS_PATH_LEN];
 typedef void OS_MUTEX;
 typedef void OS_RWLOCK;
+typedef void OS_TIMER;
+typedef void OS_NOTIFIER;
+
+// Most timers a single os_timer_wait() call can block on (Windows MAXIMUM_WAIT_OBJECTS)
+#define	OS_TIMER_WAIT_MAX	64
 
 
 
@@ -76,7 +81,22 @@ extern int os_mkdir(char *path);
 extern int os_start_process(const char *process_name, unsigned int *p_process_id);
 extern int os_stop_process(unsigned int process_id);
 extern void os_sleep(unsigned long time);
+extern unsigned long long os_get_monotonic_ms();
+extern unsigned long long os_get_monotonic_us();
+
+extern OS_TIMER *os_timer_create();
+extern int os_timer_set(OS_TIMER *p_timer, unsigned long long due_100ns, unsigned long long period_100ns);
+extern int os_timer_wait(OS_TIMER **pp_timers, unsigned int count, unsigned int *p_index);
+extern int os_timer_delete(OS_TIMER *p_timer);
+
+extern OS_NOTIFIER *os_notifier_create();
+extern unsigned long long os_notifier_seq(OS_NOTIFIER *p_notifier);
+extern void os_notifier_signal(OS_NOTIFIER *p_notifier);
+extern int os_notifier_wait(OS_NOTIFIER *p_notifier, unsigned long long seen_seq, long timeout_ms);
+extern void os_notifier_delete(OS_NOTIFIER *p_notifier);
+
 extern void os_create_thread(unsigned long long *p_thread_id, void *(*callback)(void *), void *callback_arg);
+extern int os_join_thread(unsigned long long thread_id);
 extern unsigned long long os_get_thread_id();
 
 extern OS_MUTEX *os_mutex_init(const char *name);
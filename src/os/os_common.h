@@ -20,23 +20,36 @@ DebugPrint(
 #define OS_DEBUG_ERROR     0x80000000
 #define OS_DEBUG_CRIT      0x80000001
 
+/*
+* Error levels DebugPrint currently emits, cached from the logger configuration.
+* The macros below test it first so the arguments of filtered messages are not
+* even evaluated. Critical messages are always printed.
+*/
+extern UINTN g_debug_print_mask;
+
+#define OS_DEBUG_PRINT_ENABLED(ErrorLevel) \
+  (0 != (g_debug_print_mask & (ErrorLevel)))
+
+#define OS_DEBUG_PRINT(ErrorLevel, fmt, ...) \
+  (OS_DEBUG_PRINT_ENABLED(ErrorLevel) ? DebugPrint(ErrorLevel, fmt, ## __VA_ARGS__) : (VOID)0)
+
 #define OS_NVDIMM_VERB(fmt, ...)  \
-  DebugPrint(OS_DEBUG_VERBOSE, "NVDIMM-VERB:%s::%s:%d: " fmt "\n", \
+  OS_DEBUG_PRINT(OS_DEBUG_VERBOSE, "NVDIMM-VERB:%s::%s:%d: " fmt "\n", \
     FileFromPath(__FILE__), __FUNCTION__, __LINE__, ## __VA_ARGS__)
 
 #define OS_NVDIMM_DBG(fmt, ...)  \
-  DebugPrint(OS_DEBUG_INFO, "NVDIMM-DBG:%s::%s:%d: " fmt "\n", \
+  OS_DEBUG_PRINT(OS_DEBUG_INFO, "NVDIMM-DBG:%s::%s:%d: " fmt "\n", \
     FileFromPath(__FILE__), __FUNCTION__, __LINE__, ## __VA_ARGS__)
 
 #define OS_NVDIMM_DBG_CLEAN(fmt, ...)  \
-  DebugPrint(OS_DEBUG_INFO, fmt, ## __VA_ARGS__)
+  OS_DEBUG_PRINT(OS_DEBUG_INFO, fmt, ## __VA_ARGS__)
 
 #define OS_NVDIMM_WARN(fmt, ...) \
-  DebugPrint(OS_DEBUG_WARN, "NVDIMM-WARN:%s::%s:%d: " fmt "\n", \
+  OS_DEBUG_PRINT(OS_DEBUG_WARN, "NVDIMM-WARN:%s::%s:%d: " fmt "\n", \
     FileFromPath(__FILE__), __FUNCTION__, __LINE__, ## __VA_ARGS__)
 
 #define OS_NVDIMM_ERR(fmt, ...)  \
-  DebugPrint(OS_DEBUG_ERROR, "NVDIMM-ERR:%s::%s:%d: " fmt "\n", \
+  OS_DEBUG_PRINT(OS_DEBUG_ERROR, "NVDIMM-ERR:%s::%s:%d: " fmt "\n", \
     FileFromPath(__FILE__), __FUNCTION__, __LINE__, ## __VA_ARGS__)
 
 #define OS_NVDIMM_CRIT(fmt, ...) \
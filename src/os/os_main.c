@@ -8,8 +8,6 @@
 #include <nvm_management.h>
 #include <os_types.h>
 
-extern NVM_API int nvm_run_cli(int argc, char *argv[]);
-
 int main(int argc, char *argv[])
 {
 	return nvm_run_cli(argc, argv);
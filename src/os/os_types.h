@@ -91,9 +91,9 @@ struct fw_cmd {
    unsigned int OutputPayloadSize;
    unsigned int LargeOutputPayloadSize;
    unsigned char InputPayload[IN_PAYLOAD_SIZE + IN_PAYLOAD_SIZE_EXT_PAD_OS];
-   unsigned char LargeInputPayload[IN_MB_SIZE];
+   unsigned char *LargeInputPayload;
    unsigned char OutPayload[OUT_PAYLOAD_SIZE];
-   unsigned char LargeOutputPayload[OUT_MB_SIZE];
+   unsigned char *LargeOutputPayload;
    unsigned int DimmID;
    unsigned char Opcode;
    unsigned char SubOpcode;
@@ -138,6 +138,190 @@ void os_sleep(unsigned long time)
 	Sleep(time);
 }
 
+/*
+ * Milliseconds elapsed since an arbitrary point, unaffected by wall clock changes
+ */
+unsigned long long os_get_monotonic_ms()
+{
+	return GetTickCount64();
+}
+
+/*
+ * Microseconds elapsed since an arbitrary point, unaffected by wall clock changes
+ */
+unsigned long long os_get_monotonic_us()
+{
+	static LARGE_INTEGER frequency = { 0 };
+	LARGE_INTEGER counter;
+
+	if (0 == frequency.QuadPart)
+	{
+		QueryPerformanceFrequency(&frequency);
+	}
+	QueryPerformanceCounter(&counter);
+	return ((unsigned long long)(counter.QuadPart / frequency.QuadPart) * 1000000) +
+		((unsigned long long)(counter.QuadPart % frequency.QuadPart) * 1000000 / frequency.QuadPart);
+}
+
+/*
+ * Create a disarmed auto-reset timer; high resolution where the OS supports it
+ */
+OS_TIMER *os_timer_create()
+{
+	HANDLE timer = NULL;
+#ifdef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+	timer = CreateWaitableTimerExW(NULL, NULL, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+#endif
+	if (NULL == timer)
+	{
+		timer = CreateWaitableTimer(NULL, FALSE, NULL);
+	}
+	return (OS_TIMER *)timer;
+}
+
+/*
+ * Arm a timer to expire due_100ns from now and then every period_100ns
+ * (0 for a one-shot timer). A due time of 0 disarms the timer. Any
+ * expiration still pending from the previous setting is discarded.
+ * Windows only takes periods in milliseconds, so they are rounded up.
+ * Returns 0 on success.
+ */
+int os_timer_set(OS_TIMER *p_timer, unsigned long long due_100ns, unsigned long long period_100ns)
+{
+	LARGE_INTEGER due;
+	LONG period_ms;
+
+	if (NULL == p_timer)
+	{
+		return -1;
+	}
+	if (0 == due_100ns)
+	{
+		CancelWaitableTimer((HANDLE)p_timer);
+		// drop an expiration that was signaled before the cancel
+		WaitForSingleObject((HANDLE)p_timer, 0);
+		return 0;
+	}
+	// negative due times are relative to now
+	due.QuadPart = -(LONGLONG)due_100ns;
+	period_ms = (LONG)((period_100ns + 9999) / 10000);
+	return SetWaitableTimer((HANDLE)p_timer, &due, period_ms, NULL, NULL, FALSE) ? 0 : -1;
+}
+
+/*
+ * Block until at least one of the timers expires. The lowest expired index
+ * is returned and only its expiration is consumed. Returns 0 on success.
+ */
+int os_timer_wait(OS_TIMER **pp_timers, unsigned int count, unsigned int *p_index)
+{
+	DWORD result;
+
+	if (NULL == pp_timers || NULL == p_index || 0 == count || OS_TIMER_WAIT_MAX < count)
+	{
+		return -1;
+	}
+	result = WaitForMultipleObjects(count, (HANDLE *)pp_timers, FALSE, INFINITE);
+	if (result >= WAIT_OBJECT_0 + count)
+	{
+		return -1;
+	}
+	*p_index = result - WAIT_OBJECT_0;
+	return 0;
+}
+
+/*
+ * Release a timer created by os_timer_create()
+ */
+int os_timer_delete(OS_TIMER *p_timer)
+{
+	return (p_timer && CloseHandle((HANDLE)p_timer)) ? 0 : -1;
+}
+
+struct win_notifier
+{
+	SRWLOCK lock;
+	CONDITION_VARIABLE cond;
+	unsigned long long seq;
+};
+
+/*
+ * Create a notifier: a sequence number that threads can wait on to change.
+ * Read the sequence, check the state it guards, then wait for a newer one;
+ * a signal in between is never lost.
+ */
+OS_NOTIFIER *os_notifier_create()
+{
+	struct win_notifier *p_notifier = (struct win_notifier *) calloc(1, sizeof(struct win_notifier));
+	if (p_notifier)
+	{
+		InitializeSRWLock(&p_notifier->lock);
+		InitializeConditionVariable(&p_notifier->cond);
+	}
+	return p_notifier;
+}
+
+/*
+ * Current sequence number of a notifier
+ */
+unsigned long long os_notifier_seq(OS_NOTIFIER *p_notifier)
+{
+	struct win_notifier *p_n = (struct win_notifier *)p_notifier;
+	unsigned long long seq;
+
+	AcquireSRWLockShared(&p_n->lock);
+	seq = p_n->seq;
+	ReleaseSRWLockShared(&p_n->lock);
+	return seq;
+}
+
+/*
+ * Advance the sequence number and wake every waiter
+ */
+void os_notifier_signal(OS_NOTIFIER *p_notifier)
+{
+	struct win_notifier *p_n = (struct win_notifier *)p_notifier;
+
+	AcquireSRWLockExclusive(&p_n->lock);
+	p_n->seq++;
+	ReleaseSRWLockExclusive(&p_n->lock);
+	WakeAllConditionVariable(&p_n->cond);
+}
+
+/*
+ * Block until the sequence number differs from seen_seq or timeout_ms
+ * (negative for no timeout) passes. Returns 0 when signaled, 1 on timeout.
+ */
+int os_notifier_wait(OS_NOTIFIER *p_notifier, unsigned long long seen_seq, long timeout_ms)
+{
+	struct win_notifier *p_n = (struct win_notifier *)p_notifier;
+	ULONGLONG deadline = GetTickCount64() + (timeout_ms > 0 ? timeout_ms : 0);
+	ULONGLONG now;
+	int rc = 0;
+
+	AcquireSRWLockExclusive(&p_n->lock);
+	while (p_n->seq == seen_seq)
+	{
+		now = GetTickCount64();
+		if (timeout_ms >= 0 && now >= deadline)
+		{
+			rc = 1;
+			break;
+		}
+		SleepConditionVariableSRW(&p_n->cond, &p_n->lock,
+			(timeout_ms < 0) ? INFINITE : (DWORD)(deadline - now), 0);
+	}
+	ReleaseSRWLockExclusive(&p_n->lock);
+	return rc;
+}
+
+/*
+ * Release a notifier created by os_notifier_create()
+ */
+void os_notifier_delete(OS_NOTIFIER *p_notifier)
+{
+	free(p_notifier);
+}
+
 /*
  * Create a thread on the current process
  */
@@ -152,6 +336,28 @@ void os_create_thread(unsigned long long *p_thread_id, void *(*callback)(void *)
 			(LPDWORD)p_thread_id);
 }
 
+/*
+ * Wait for a thread created by os_create_thread to finish
+ */
+int os_join_thread(unsigned long long thread_id)
+{
+	int rc = -1;
+	HANDLE handle = NULL;
+	if (0 != thread_id)
+	{
+		handle = OpenThread(SYNCHRONIZE, FALSE, (DWORD)thread_id);
+	}
+	if (handle)
+	{
+		if (WAIT_OBJECT_0 == WaitForSingleObject(handle, INFINITE))
+		{
+			rc = 0;
+		}
+		CloseHandle(handle);
+	}
+	return rc;
+}
+
 /*
  * Retrieve the id of the current thread
  */